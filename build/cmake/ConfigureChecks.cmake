@@ -45,10 +45,30 @@ check_include_file(sys/stat.h HAVE_SYS_STAT_H)
 check_include_file(sys/un.h HAVE_SYS_UN_H)
 check_include_file(sys/poll.h HAVE_SYS_POLL_H)
 check_include_file(sys/select.h HAVE_SYS_SELECT_H)
+check_include_file(sys/eventfd.h HAVE_SYS_EVENTFD_H)
+check_include_file(sys/epoll.h HAVE_SYS_EPOLL_H)
+check_include_file(linux/io_uring.h HAVE_LINUX_IO_URING_H)
 check_include_file(sched.h HAVE_SCHED_H)
+check_include_file(lz4.h HAVE_LZ4_H)
+check_include_file(zstd.h HAVE_ZSTD_H)
+check_include_file(snappy-c.h HAVE_SNAPPY_C_H)
 check_include_file(string.h HAVE_STRING_H)
 check_include_file(strings.h HAVE_STRINGS_H)
 
+# THeaderTransport codecs need the library as well as the header
+find_library(LZ4_LIBRARY lz4)
+if(NOT LZ4_LIBRARY)
+    set(HAVE_LZ4_H OFF)
+endif()
+find_library(ZSTD_LIBRARY zstd)
+if(NOT ZSTD_LIBRARY)
+    set(HAVE_ZSTD_H OFF)
+endif()
+find_library(SNAPPY_LIBRARY snappy)
+if(NOT SNAPPY_LIBRARY)
+    set(HAVE_SNAPPY_C_H OFF)
+endif()
+
 check_function_exists(gethostbyname HAVE_GETHOSTBYNAME)
 check_function_exists(gethostbyname_r HAVE_GETHOSTBYNAME_R)
 check_function_exists(strerror_r HAVE_STRERROR_R)
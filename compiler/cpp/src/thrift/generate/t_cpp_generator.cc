@@ -22,9 +22,12 @@
  */
 
 #include <cassert>
+#include <cctype>
 
 #include <fstream>
 #include <iostream>
+#include <map>
+#include <set>
 #include <sstream>
 #include <string>
 #include <vector>
@@ -59,6 +62,7 @@ public:
     gen_pure_enums_ = false;
     use_include_prefix_ = false;
     gen_cob_style_ = false;
+    gen_future_style_ = false;
     gen_no_client_completion_ = false;
     gen_no_default_operators_ = false;
     gen_templates_ = false;
@@ -66,6 +70,14 @@ public:
     gen_moveable_ = false;
     gen_no_ostream_operators_ = false;
     gen_no_skeleton_ = false;
+    gen_zero_copy_strings_ = false;
+    gen_arena_ = false;
+    gen_reuse_objects_ = false;
+    gen_flat_containers_ = false;
+    gen_hash_containers_ = false;
+    gen_tables_ = false;
+    gen_serialized_size_ = false;
+    gen_ordered_reads_ = false;
 
     for( iter = parsed_options.begin(); iter != parsed_options.end(); ++iter) {
       if( iter->first.compare("pure_enums") == 0) {
@@ -74,6 +86,8 @@ public:
         use_include_prefix_ = true;
       } else if( iter->first.compare("cob_style") == 0) {
         gen_cob_style_ = true;
+      } else if( iter->first.compare("future_style") == 0) {
+        gen_future_style_ = true;
       } else if( iter->first.compare("no_client_completion") == 0) {
         gen_no_client_completion_ = true;
       } else if( iter->first.compare("no_default_operators") == 0) {
@@ -87,11 +101,36 @@ public:
         gen_no_ostream_operators_ = true;
       } else if ( iter->first.compare("no_skeleton") == 0) {
         gen_no_skeleton_ = true;
+      } else if ( iter->first.compare("zero_copy_strings") == 0) {
+        gen_zero_copy_strings_ = true;
+      } else if ( iter->first.compare("arena") == 0) {
+        gen_arena_ = true;
+      } else if ( iter->first.compare("reuse_objects") == 0) {
+        gen_reuse_objects_ = true;
+      } else if ( iter->first.compare("containers") == 0) {
+        if (iter->second == "flat") {
+          gen_flat_containers_ = true;
+        } else if (iter->second == "hash") {
+          gen_hash_containers_ = true;
+        } else {
+          throw "cpp:containers must be flat or hash, not \"" + iter->second + "\"";
+        }
+      } else if ( iter->first.compare("tables") == 0) {
+        gen_tables_ = true;
+      } else if ( iter->first.compare("serialized_size") == 0) {
+        gen_serialized_size_ = true;
+      } else if ( iter->first.compare("ordered_reads") == 0) {
+        gen_ordered_reads_ = true;
       } else {
         throw "unknown option cpp:" + iter->first;
       }
     }
 
+    if (gen_reuse_objects_ && gen_arena_) {
+      // Pooled objects would outlive the arena of the call that filled them.
+      throw "cpp:reuse_objects cannot be combined with cpp:arena";
+    }
+
     out_dir_base_ = "gen-cpp";
   }
 
@@ -148,9 +187,23 @@ public:
   void generate_move_assignment_operator(std::ofstream& out, t_struct* tstruct);
   void generate_assignment_helper(std::ofstream& out, t_struct* tstruct, bool is_move);
   void generate_struct_reader(std::ofstream& out, t_struct* tstruct, bool pointers = false);
+  void generate_ordered_reader(std::ofstream& out, t_struct* tstruct, bool pointers);
+  void generate_struct_reader_field(std::ofstream& out,
+                                    t_struct* tstruct,
+                                    t_field* tfield,
+                                    bool pointers);
   void generate_struct_writer(std::ofstream& out, t_struct* tstruct, bool pointers = false);
   void generate_struct_result_writer(std::ofstream& out, t_struct* tstruct, bool pointers = false);
   void generate_struct_swap(std::ofstream& out, t_struct* tstruct);
+  void generate_struct_clear(std::ofstream& out, t_struct* tstruct);
+  void generate_lazy_field_helpers(std::ofstream& out, t_struct* tstruct);
+  void generate_struct_table(std::ofstream& out, t_struct* tstruct);
+  void generate_table_reader_writer(std::ofstream& out, t_struct* tstruct);
+  std::string table_value_spec(std::ofstream& out, t_type* ttype);
+  void generate_struct_serialized_size(std::ostream& out, t_struct* tstruct);
+  void generate_struct_constructor(std::ofstream& out, t_struct* tstruct, bool arena);
+  std::string arena_initializer(t_type* ttype);
+  void generate_size_value(std::ostream& out, t_type* ttype, std::string name, bool pointer);
   void generate_struct_print_method(std::ofstream& out, t_struct* tstruct);
   void generate_exception_what_method(std::ofstream& out, t_struct* tstruct);
 
@@ -164,6 +217,7 @@ public:
   void generate_service_multiface(t_service* tservice);
   void generate_service_helpers(t_service* tservice);
   void generate_service_client(t_service* tservice, string style);
+  void generate_service_future_client(t_service* tservice);
   void generate_service_processor(t_service* tservice, string style);
   void generate_service_skeleton(t_service* tservice);
   void generate_process_function(t_service* tservice,
@@ -261,6 +315,87 @@ public:
 
   bool is_reference(t_field* tfield) { return tfield->get_reference(); }
 
+  /**
+   * True if a field is annotated cpp.lazy and generated as a TLazy.  cpp.ref
+   * takes precedence.
+   */
+  bool is_lazy(t_field* tfield) {
+    std::map<string, string>::const_iterator it = tfield->annotations_.find("cpp.lazy");
+    return it != tfield->annotations_.end() && it->second != "false" && !is_reference(tfield);
+  }
+
+  /**
+   * True if values of a type can be described in a struct table; see
+   * TTableSerializer.h.  Tables only know the default representations.
+   */
+  bool is_table_type(t_type* ttype) {
+    if (ttype->annotations_.find("cpp.type") != ttype->annotations_.end()) {
+      return false;
+    }
+    ttype = get_true_type(ttype);
+    if (ttype->annotations_.find("cpp.type") != ttype->annotations_.end()) {
+      return false;
+    }
+    if (ttype->is_base_type()) {
+      return !ttype->is_void() && !(ttype->is_string() && (gen_zero_copy_strings_ || gen_arena_));
+    }
+    if (ttype->is_enum() || ttype->is_struct() || ttype->is_xception()) {
+      return true;
+    }
+    if (!ttype->is_container() || ((t_container*)ttype)->has_cpp_name() || gen_arena_
+        || is_flat_container(ttype) || is_hash_container(ttype)) {
+      return false;
+    }
+    if (ttype->is_map()) {
+      return is_table_type(((t_map*)ttype)->get_key_type())
+             && is_table_type(((t_map*)ttype)->get_val_type());
+    } else if (ttype->is_set()) {
+      return is_table_type(((t_set*)ttype)->get_elem_type());
+    }
+    // std::vector<bool> has no contiguous elements.
+    t_type* elem = ((t_list*)ttype)->get_elem_type();
+    return !get_true_type(elem)->is_bool() && is_table_type(elem);
+  }
+
+  /**
+   * The first field of a struct that a table cannot describe, or NULL.
+   */
+  t_field* non_table_field(t_struct* tstruct) {
+    const vector<t_field*>& members = tstruct->get_members();
+    int required = 0;
+    for (vector<t_field*>::const_iterator m_iter = members.begin(); m_iter != members.end();
+         ++m_iter) {
+      if ((*m_iter)->get_req() == t_field::T_REQUIRED && ++required > 64) {
+        return *m_iter;
+      }
+      if (is_reference(*m_iter) || is_lazy(*m_iter) || !is_table_type((*m_iter)->get_type())) {
+        return *m_iter;
+      }
+    }
+    return NULL;
+  }
+
+  /**
+   * True if a struct is read and written through a table, as asked by its
+   * cpp.table annotation or else the tables option.
+   */
+  bool is_table_struct(t_struct* tstruct) {
+    std::map<string, string>::const_iterator it = tstruct->annotations_.find("cpp.table");
+    bool wanted = it != tstruct->annotations_.end() ? it->second != "false" : gen_tables_;
+    return wanted && non_table_field(tstruct) == NULL;
+  }
+
+  bool has_lazy_fields(t_struct* tstruct) {
+    const vector<t_field*>& members = tstruct->get_members();
+    for (vector<t_field*>::const_iterator m_iter = members.begin(); m_iter != members.end();
+         ++m_iter) {
+      if (is_lazy(*m_iter)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
   bool is_complex_type(t_type* ttype) {
     ttype = get_true_type(ttype);
 
@@ -269,6 +404,83 @@ public:
                && (((t_base_type*)ttype)->get_base() == t_base_type::TYPE_STRING));
   }
 
+  /**
+   * True if a string/binary type is generated as a TStringView, i.e. the
+   * zero_copy_strings option is on and no cpp.type overrides it.
+   */
+  bool is_string_view(t_type* ttype) {
+    return gen_zero_copy_strings_
+           && ttype->annotations_.find("cpp.type") == ttype->annotations_.end();
+  }
+
+  /**
+   * True if a string/binary type is generated as a TArenaString.
+   */
+  bool is_arena_string(t_type* ttype) {
+    return gen_arena_ && !gen_zero_copy_strings_ && ttype->is_string()
+           && ttype->annotations_.find("cpp.type") == ttype->annotations_.end();
+  }
+
+  /**
+   * True if a map or set is generated as a TFlatMap or TFlatSet.
+   */
+  bool is_flat_container(t_type* ttype) {
+    ttype = get_true_type(ttype);
+    return gen_flat_containers_ && (ttype->is_map() || ttype->is_set())
+           && !((t_container*)ttype)->has_cpp_name();
+  }
+
+  /**
+   * True if a map or set is generated as a THashMap or THashSet.  That takes
+   * keys boost::hash knows, so maps and sets keyed by structs, containers or
+   * cpp.type overrides stay std::map and std::set.
+   */
+  bool is_hash_container(t_type* ttype) {
+    ttype = get_true_type(ttype);
+    if (!gen_hash_containers_ || !(ttype->is_map() || ttype->is_set())
+        || ((t_container*)ttype)->has_cpp_name()) {
+      return false;
+    }
+    t_type* key = ttype->is_map() ? ((t_map*)ttype)->get_key_type()
+                                  : ((t_set*)ttype)->get_elem_type();
+    if (key->annotations_.find("cpp.type") != key->annotations_.end()) {
+      return false;
+    }
+    key = get_true_type(key);
+    return key->is_enum()
+           || (key->is_base_type() && key->annotations_.find("cpp.type") == key->annotations_.end());
+  }
+
+  /**
+   * Returns the type part of the TProtocol bulk list methods (readI32List,
+   * writeDoubleList and so on) that can handle a list of this type in one
+   * call, or "" if its elements must be handled one at a time.
+   */
+  string bulk_list_method(t_type* ttype) {
+    if (!ttype->is_list() || ((t_container*)ttype)->has_cpp_name()
+        || ttype->annotations_.find("cpp.type") != ttype->annotations_.end()) {
+      return "";
+    }
+    t_type* elem = get_true_type(((t_list*)ttype)->get_elem_type());
+    if (!elem->is_base_type() || elem->annotations_.find("cpp.type") != elem->annotations_.end()) {
+      return "";
+    }
+    switch (((t_base_type*)elem)->get_base()) {
+    case t_base_type::TYPE_I8:
+      return "Byte";
+    case t_base_type::TYPE_I16:
+      return "I16";
+    case t_base_type::TYPE_I32:
+      return "I32";
+    case t_base_type::TYPE_I64:
+      return "I64";
+    case t_base_type::TYPE_DOUBLE:
+      return "Double";
+    default:
+      return "";
+    }
+  }
+
   void set_use_include_prefix(bool use_include_prefix) { use_include_prefix_ = use_include_prefix; }
 
   /**
@@ -320,6 +532,53 @@ private:
    */
   bool gen_no_ostream_operators_;
 
+  /**
+   * True if string and binary fields should be ::apache::thrift::TStringView
+   * rather than std::string, so they can refer to the transport's buffer.
+   */
+  bool gen_zero_copy_strings_;
+
+  /**
+   * True if strings and containers should use ::apache::thrift::TArenaAllocator
+   * so that objects built during a request come from the request's arena.
+   */
+  bool gen_arena_;
+
+  /**
+   * True if structs should get a __clear() method and processors should
+   * reuse their args and result objects from call to call.
+   */
+  bool gen_reuse_objects_;
+
+  /**
+   * True if maps and sets should be generated as ::apache::thrift::TFlatMap
+   * and TFlatSet, sorted vectors.
+   */
+  bool gen_flat_containers_;
+
+  /**
+   * True if maps and sets with hashable keys should be generated as
+   * ::apache::thrift::THashMap and THashSet.
+   */
+  bool gen_hash_containers_;
+
+  /**
+   * True if structs should be read and written through field tables unless
+   * they are annotated cpp.table = "false".
+   */
+  bool gen_tables_;
+
+  /**
+   * True if structs should have a serializedSize<Protocol_>() method.
+   */
+  bool gen_serialized_size_;
+
+  /**
+   * True if read() should expect fields in the order write() writes them,
+   * and only switch on the field id when they are not.
+   */
+  bool gen_ordered_reads_;
+
   /**
    * True iff we should use a path prefix in our #include statements for other
    * thrift-generated header files.
@@ -331,6 +590,11 @@ private:
    */
   bool gen_cob_style_;
 
+  /**
+   * True if we should generate a client whose methods return futures.
+   */
+  bool gen_future_style_;
+
   /**
    * True if we should omit calls to completion__() in CobClient class.
    */
@@ -361,6 +625,8 @@ private:
   std::ofstream f_types_;
   std::ofstream f_types_impl_;
   std::ofstream f_types_tcc_;
+  /// serializedSize() definitions, which go at the end of the types header.
+  std::ostringstream f_types_size_;
   std::ofstream f_header_;
   std::ofstream f_service_;
   std::ofstream f_service_tcc_;
@@ -418,6 +684,32 @@ void t_cpp_generator::init_generator() {
            << endl;
   // Include C++xx compatibility header
   f_types_ << "#include <thrift/stdcxx.h>" << endl;
+  if (gen_flat_containers_) {
+    f_types_ << "#include <thrift/TFlatMap.h>" << endl;
+  }
+  if (gen_hash_containers_) {
+    f_types_ << "#include <thrift/THashMap.h>" << endl;
+  }
+  vector<t_struct*> structs = program_->get_structs();
+  const vector<t_struct*>& xceptions = program_->get_xceptions();
+  structs.insert(structs.end(), xceptions.begin(), xceptions.end());
+  for (vector<t_struct*>::const_iterator s_iter = structs.begin(); s_iter != structs.end();
+       ++s_iter) {
+    if (has_lazy_fields(*s_iter)) {
+      f_types_ << "#include <thrift/TLazy.h>" << endl;
+      break;
+    }
+  }
+  for (vector<t_struct*>::const_iterator s_iter = structs.begin(); s_iter != structs.end();
+       ++s_iter) {
+    if (is_table_struct(*s_iter)) {
+      f_types_ << "#include <thrift/protocol/TTableSerializer.h>" << endl;
+      break;
+    }
+  }
+  if (gen_serialized_size_) {
+    f_types_ << "#include <thrift/protocol/TSerializedSize.h>" << endl;
+  }
 
   // Include other Thrift includes
   const vector<t_program*>& includes = program_->get_includes();
@@ -470,6 +762,9 @@ void t_cpp_generator::init_generator() {
  * Closes the output files.
  */
 void t_cpp_generator::close_generator() {
+  // The serializedSize() templates come after all the structs they use.
+  f_types_ << f_types_size_.str();
+
   // Close namespace
   f_types_ << ns_close_ << endl << endl;
   f_types_impl_ << ns_close_ << endl;
@@ -821,13 +1116,42 @@ void t_cpp_generator::generate_forward_declaration(t_struct* tstruct) {
  * @param tstruct The struct definition
  */
 void t_cpp_generator::generate_cpp_struct(t_struct* tstruct, bool is_exception) {
+  const vector<t_field*>& members = tstruct->get_members();
+  for (vector<t_field*>::const_iterator m_iter = members.begin(); m_iter != members.end();
+       ++m_iter) {
+    t_type* t = get_true_type((*m_iter)->get_type());
+    if (is_lazy(*m_iter) && !(t->is_struct() || t->is_xception() || t->is_container())) {
+      throw "cpp.lazy is only supported on struct, list, set and map fields: "
+          + tstruct->get_name() + "." + (*m_iter)->get_name();
+    }
+  }
+
+  std::map<string, string>::const_iterator table = tstruct->annotations_.find("cpp.table");
+  t_field* non_table = non_table_field(tstruct);
+  if (table != tstruct->annotations_.end() && table->second != "false" && non_table != NULL) {
+    throw "cpp.table does not support field " + tstruct->get_name() + "." + non_table->get_name();
+  }
+
   generate_struct_declaration(f_types_, tstruct, is_exception, false, true, true, true, true);
   generate_struct_definition(f_types_impl_, f_types_impl_, tstruct, true, true);
+  generate_lazy_field_helpers(f_types_impl_, tstruct);
+
+  if (gen_serialized_size_) {
+    generate_struct_serialized_size(f_types_size_, tstruct);
+  }
 
   std::ofstream& out = (gen_templates_ ? f_types_tcc_ : f_types_impl_);
-  generate_struct_reader(out, tstruct);
-  generate_struct_writer(out, tstruct);
+  if (is_table_struct(tstruct)) {
+    generate_struct_table(f_types_impl_, tstruct);
+    generate_table_reader_writer(out, tstruct);
+  } else {
+    generate_struct_reader(out, tstruct);
+    generate_struct_writer(out, tstruct);
+  }
   generate_struct_swap(f_types_impl_, tstruct);
+  if (gen_reuse_objects_) {
+    generate_struct_clear(f_types_impl_, tstruct);
+  }
   generate_copy_constructor(f_types_impl_, tstruct, is_exception);
   if (gen_moveable_) {
     generate_move_constructor(f_types_impl_, tstruct, is_exception);
@@ -975,7 +1299,10 @@ void t_cpp_generator::generate_struct_declaration(ofstream& out,
     extends = " : public ::apache::thrift::TException";
   } else {
     if (is_user_struct && !gen_templates_) {
-      extends = " : public virtual ::apache::thrift::TBase";
+      // Table structs take the offsetof() of their members, which needs a
+      // class without virtual bases.
+      extends = is_table_struct(tstruct) ? " : public ::apache::thrift::TBase"
+                                         : " : public virtual ::apache::thrift::TBase";
     }
   }
 
@@ -1051,46 +1378,10 @@ void t_cpp_generator::generate_struct_declaration(ofstream& out,
     }
 
     // Default constructor
-    indent(out) << tstruct->get_name() << "()";
-
-    bool init_ctor = false;
-
-    for (m_iter = members.begin(); m_iter != members.end(); ++m_iter) {
-      t_type* t = get_true_type((*m_iter)->get_type());
-      if (t->is_base_type() || t->is_enum() || is_reference(*m_iter)) {
-        string dval;
-        if (t->is_enum()) {
-          dval += "(" + type_name(t) + ")";
-        }
-        dval += (t->is_string() || is_reference(*m_iter)) ? "" : "0";
-        t_const_value* cv = (*m_iter)->get_value();
-        if (cv != NULL) {
-          dval = render_const_value(out, (*m_iter)->get_name(), t, cv);
-        }
-        if (!init_ctor) {
-          init_ctor = true;
-          out << " : ";
-          out << (*m_iter)->get_name() << "(" << dval << ")";
-        } else {
-          out << ", " << (*m_iter)->get_name() << "(" << dval << ")";
-        }
-      }
-    }
-    out << " {" << endl;
-    indent_up();
-    // TODO(dreiss): When everything else in Thrift is perfect,
-    // do more of these in the initializer list.
-    for (m_iter = members.begin(); m_iter != members.end(); ++m_iter) {
-      t_type* t = get_true_type((*m_iter)->get_type());
-
-      if (!t->is_base_type()) {
-        t_const_value* cv = (*m_iter)->get_value();
-        if (cv != NULL) {
-          print_const_value(out, (*m_iter)->get_name(), t, cv);
-        }
-      }
+    generate_struct_constructor(out, tstruct, false);
+    if (gen_arena_) {
+      generate_struct_constructor(out, tstruct, true);
     }
-    scope_down(out);
   }
 
   if (tstruct->annotations_.find("final") == tstruct->annotations_.end()) {
@@ -1110,6 +1401,10 @@ void t_cpp_generator::generate_struct_declaration(ofstream& out,
     out << endl << indent() << "_" << tstruct->get_name() << "__isset __isset;" << endl;
   }
 
+  if (!pointers && gen_reuse_objects_) {
+    out << endl << indent() << "void __clear();" << endl;
+  }
+
   // Create a setter function for each field
   for (m_iter = members.begin(); m_iter != members.end(); ++m_iter) {
     if (pointers) {
@@ -1183,6 +1478,33 @@ void t_cpp_generator::generate_struct_declaration(ofstream& out,
   }
   out << endl;
 
+  if (is_user_struct && is_table_struct(tstruct)) {
+    out << indent() << "static const ::apache::thrift::protocol::TStructSpec __table;" << endl
+        << endl;
+  }
+
+  if (is_user_struct && gen_serialized_size_) {
+    out << indent() << "/**" << endl
+        << indent() << " * The number of bytes that write() would write with a Protocol_," << endl
+        << indent() << " * which is a TBinaryProtocolT or a TCompactProtocolT." << endl
+        << indent() << " */" << endl
+        << indent() << "template <class Protocol_>" << endl
+        << indent() << "uint32_t serializedSize() const;" << endl << endl;
+  }
+
+  // Readers and writers that a TLazy field calls when it has to decode or
+  // encode its value
+  for (m_iter = members.begin(); m_iter != members.end(); ++m_iter) {
+    if (is_lazy(*m_iter)) {
+      string type = type_name((*m_iter)->get_type());
+      out << indent() << "static uint32_t __read_" << (*m_iter)->get_name()
+          << "(::apache::thrift::protocol::TProtocol* iprot, " << type << "& value);" << endl
+          << indent() << "static uint32_t __write_" << (*m_iter)->get_name()
+          << "(::apache::thrift::protocol::TProtocol* oprot, const " << type << "& value);"
+          << endl << endl;
+    }
+  }
+
   if (is_user_struct && !has_custom_ostream(tstruct)) {
     out << indent() << "virtual ";
     generate_struct_print_method_decl(out, NULL);
@@ -1302,71 +1624,56 @@ void t_cpp_generator::generate_struct_reader(ofstream& out, t_struct* tstruct, b
   }
   out << endl;
 
-  // Loop over reading in fields
-  indent(out) << "while (true)" << endl;
-  scope_up(out);
-
-  // Read beginning field marker
-  indent(out) << "xfer += iprot->readFieldBegin(fname, ftype, fid);" << endl;
-
-  // Check for field STOP marker
-  out << indent() << "if (ftype == ::apache::thrift::protocol::T_STOP) {" << endl << indent()
-      << "  break;" << endl << indent() << "}" << endl;
-
-  if (fields.empty()) {
-    out << indent() << "xfer += iprot->skip(ftype);" << endl;
+  if (gen_ordered_reads_ && !fields.empty()) {
+    generate_ordered_reader(out, tstruct, pointers);
   } else {
-    // Switch statement on the field we are reading
-    indent(out) << "switch (fid)" << endl;
-
+    // Loop over reading in fields
+    indent(out) << "while (true)" << endl;
     scope_up(out);
 
-    // Generate deserialization code for known cases
-    for (f_iter = fields.begin(); f_iter != fields.end(); ++f_iter) {
-      indent(out) << "case " << (*f_iter)->get_key() << ":" << endl;
-      indent_up();
-      indent(out) << "if (ftype == " << type_to_enum((*f_iter)->get_type()) << ") {" << endl;
-      indent_up();
+    // Read beginning field marker
+    indent(out) << "xfer += iprot->readFieldBegin(fname, ftype, fid);" << endl;
 
-      const char* isset_prefix = ((*f_iter)->get_req() != t_field::T_REQUIRED) ? "this->__isset."
-                                                                               : "isset_";
+    // Check for field STOP marker
+    out << indent() << "if (ftype == ::apache::thrift::protocol::T_STOP) {" << endl << indent()
+        << "  break;" << endl << indent() << "}" << endl;
 
-#if 0
-          // This code throws an exception if the same field is encountered twice.
-          // We've decided to leave it out for performance reasons.
-          // TODO(dreiss): Generate this code and "if" it out to make it easier
-          // for people recompiling thrift to include it.
-          out <<
-            indent() << "if (" << isset_prefix << (*f_iter)->get_name() << ")" << endl <<
-            indent() << "  throw TProtocolException(TProtocolException::INVALID_DATA);" << endl;
-#endif
+    if (fields.empty()) {
+      out << indent() << "xfer += iprot->skip(ftype);" << endl;
+    } else {
+      // Switch statement on the field we are reading
+      indent(out) << "switch (fid)" << endl;
 
-      if (pointers && !(*f_iter)->get_type()->is_xception()) {
-        generate_deserialize_field(out, *f_iter, "(*(this->", "))");
-      } else {
-        generate_deserialize_field(out, *f_iter, "this->");
+      scope_up(out);
+
+      // Generate deserialization code for known cases
+      for (f_iter = fields.begin(); f_iter != fields.end(); ++f_iter) {
+        indent(out) << "case " << (*f_iter)->get_key() << ":" << endl;
+        indent_up();
+        indent(out) << "if (ftype == " << type_to_enum((*f_iter)->get_type()) << ") {" << endl;
+        indent_up();
+        generate_struct_reader_field(out, tstruct, *f_iter, pointers);
+        indent_down();
+        out << indent() << "} else {" << endl << indent() << "  xfer += iprot->skip(ftype);" << endl
+            <<
+            // TODO(dreiss): Make this an option when thrift structs
+            // have a common base class.
+            // indent() << "  throw TProtocolException(TProtocolException::INVALID_DATA);" << endl <<
+            indent() << "}" << endl << indent() << "break;" << endl;
+        indent_down();
       }
-      out << indent() << isset_prefix << (*f_iter)->get_name() << " = true;" << endl;
-      indent_down();
-      out << indent() << "} else {" << endl << indent() << "  xfer += iprot->skip(ftype);" << endl
-          <<
-          // TODO(dreiss): Make this an option when thrift structs
-          // have a common base class.
-          // indent() << "  throw TProtocolException(TProtocolException::INVALID_DATA);" << endl <<
-          indent() << "}" << endl << indent() << "break;" << endl;
-      indent_down();
-    }
 
-    // In the default case we skip the field
-    out << indent() << "default:" << endl << indent() << "  xfer += iprot->skip(ftype);" << endl
-        << indent() << "  break;" << endl;
+      // In the default case we skip the field
+      out << indent() << "default:" << endl << indent() << "  xfer += iprot->skip(ftype);" << endl
+          << indent() << "  break;" << endl;
 
-    scope_down(out);
-  } //!fields.empty()
-  // Read field end marker
-  indent(out) << "xfer += iprot->readFieldEnd();" << endl;
+      scope_down(out);
+    } //!fields.empty()
+    // Read field end marker
+    indent(out) << "xfer += iprot->readFieldEnd();" << endl;
 
-  scope_down(out);
+    scope_down(out);
+  }
 
   out << endl << indent() << "xfer += iprot->readStructEnd();" << endl;
 
@@ -1386,6 +1693,92 @@ void t_cpp_generator::generate_struct_reader(ofstream& out, t_struct* tstruct, b
   indent(out) << "}" << endl << endl;
 }
 
+/**
+ * Generates the body of read() for cpp:ordered_reads.  Every field has a
+ * label, and after reading one field read() goes straight on to the next if
+ * its id and type are the ones that write() writes next.  Anything else,
+ * including the stop marker, goes to the switch on the field id, which jumps
+ * back to the field's label, so that a struct with some fields missing gets
+ * back on the fast path after each gap.
+ *
+ * @param out Stream to write to
+ * @param tstruct The struct
+ */
+void t_cpp_generator::generate_ordered_reader(ofstream& out, t_struct* tstruct, bool pointers) {
+  const vector<t_field*>& fields = tstruct->get_sorted_members();
+  vector<t_field*>::const_iterator f_iter;
+
+  indent(out) << "xfer += iprot->readFieldBegin(fname, ftype, fid);" << endl;
+
+  // The labels of fields start with read_, so others cannot clash with them.
+  for (f_iter = fields.begin(); f_iter != fields.end(); ++f_iter) {
+    out << indent() << "if (fid != " << (*f_iter)->get_key()
+        << " || ftype != " << type_to_enum((*f_iter)->get_type()) << ") {" << endl
+        << indent() << "  goto unexpected_field;" << endl
+        << indent() << "}" << endl;
+    indent(out) << "read_" << (*f_iter)->get_name() << ":" << endl;
+    scope_up(out);
+    generate_struct_reader_field(out, tstruct, *f_iter, pointers);
+    scope_down(out);
+    out << indent() << "xfer += iprot->readFieldEnd();" << endl
+        << indent() << "xfer += iprot->readFieldBegin(fname, ftype, fid);" << endl;
+  }
+
+  out << endl << indent() << "unexpected_field:" << endl
+      << indent() << "if (ftype == ::apache::thrift::protocol::T_STOP) {" << endl
+      << indent() << "  goto struct_end;" << endl
+      << indent() << "}" << endl;
+  indent(out) << "switch (fid)" << endl;
+  scope_up(out);
+  for (f_iter = fields.begin(); f_iter != fields.end(); ++f_iter) {
+    out << indent() << "case " << (*f_iter)->get_key() << ":" << endl
+        << indent() << "  if (ftype == " << type_to_enum((*f_iter)->get_type()) << ") {" << endl
+        << indent() << "    goto read_" << (*f_iter)->get_name() << ";" << endl
+        << indent() << "  }" << endl
+        << indent() << "  break;" << endl;
+  }
+  out << indent() << "default:" << endl << indent() << "  break;" << endl;
+  scope_down(out);
+  out << indent() << "xfer += iprot->skip(ftype);" << endl
+      << indent() << "xfer += iprot->readFieldEnd();" << endl
+      << indent() << "xfer += iprot->readFieldBegin(fname, ftype, fid);" << endl
+      << indent() << "goto unexpected_field;" << endl;
+
+  out << endl << indent() << "struct_end:" << endl;
+}
+
+/**
+ * Generates the code that reads one field, once its header has been read,
+ * and marks it as set.
+ */
+void t_cpp_generator::generate_struct_reader_field(ofstream& out,
+                                                   t_struct* tstruct,
+                                                   t_field* tfield,
+                                                   bool pointers) {
+  const char* isset_prefix = (tfield->get_req() != t_field::T_REQUIRED) ? "this->__isset."
+                                                                        : "isset_";
+
+#if 0
+  // This code throws an exception if the same field is encountered twice.
+  // We've decided to leave it out for performance reasons.
+  // TODO(dreiss): Generate this code and "if" it out to make it easier
+  // for people recompiling thrift to include it.
+  out <<
+    indent() << "if (" << isset_prefix << tfield->get_name() << ")" << endl <<
+    indent() << "  throw TProtocolException(TProtocolException::INVALID_DATA);" << endl;
+#endif
+
+  if (pointers && !tfield->get_type()->is_xception()) {
+    generate_deserialize_field(out, tfield, "(*(this->", "))");
+  } else if (is_lazy(tfield)) {
+    indent(out) << "xfer += this->" << tfield->get_name() << ".read(iprot, ftype, &"
+                << tstruct->get_name() << "::__read_" << tfield->get_name() << ");" << endl;
+  } else {
+    generate_deserialize_field(out, tfield, "this->");
+  }
+  out << indent() << isset_prefix << tfield->get_name() << " = true;" << endl;
+}
+
 /**
  * Generates the write function.
  *
@@ -1428,6 +1821,9 @@ void t_cpp_generator::generate_struct_writer(ofstream& out, t_struct* tstruct, b
     // Write field contents
     if (pointers && !(*f_iter)->get_type()->is_xception()) {
       generate_serialize_field(out, *f_iter, "(*(this->", "))");
+    } else if (is_lazy(*f_iter)) {
+      indent(out) << "xfer += this->" << (*f_iter)->get_name() << ".write(oprot, &" << name
+                  << "::__write_" << (*f_iter)->get_name() << ");" << endl;
     } else {
       generate_serialize_field(out, *f_iter, "this->");
     }
@@ -1499,64 +1895,634 @@ void t_cpp_generator::generate_struct_result_writer(ofstream& out,
     if (pointers) {
       generate_serialize_field(out, *f_iter, "(*(this->", "))");
     } else {
-      generate_serialize_field(out, *f_iter, "this->");
+      generate_serialize_field(out, *f_iter, "this->");
+    }
+    // Write field closer
+    indent(out) << "xfer += oprot->writeFieldEnd();" << endl;
+
+    indent_down();
+    indent(out) << "}";
+  }
+
+  // Write the struct map
+  out << endl << indent() << "xfer += oprot->writeFieldStop();" << endl << indent()
+      << "xfer += oprot->writeStructEnd();" << endl << indent() << "return xfer;" << endl;
+
+  indent_down();
+  indent(out) << "}" << endl << endl;
+}
+
+/**
+ * Generates the swap function.
+ *
+ * @param out Stream to write to
+ * @param tstruct The struct
+ */
+void t_cpp_generator::generate_struct_swap(ofstream& out, t_struct* tstruct) {
+  out << indent() << "void swap(" << tstruct->get_name() << " &a, " << tstruct->get_name()
+      << " &b) {" << endl;
+  indent_up();
+
+  // Let argument-dependent name lookup find the correct swap() function to
+  // use based on the argument types.  If none is found in the arguments'
+  // namespaces, fall back to ::std::swap().
+  out << indent() << "using ::std::swap;" << endl;
+
+  bool has_nonrequired_fields = false;
+  const vector<t_field*>& fields = tstruct->get_members();
+  for (vector<t_field*>::const_iterator f_iter = fields.begin(); f_iter != fields.end(); ++f_iter) {
+    t_field* tfield = *f_iter;
+
+    if (tfield->get_req() != t_field::T_REQUIRED) {
+      has_nonrequired_fields = true;
+    }
+
+    t_type* t = get_true_type(tfield->get_type());
+    if (gen_arena_ && !is_reference(tfield) && !is_lazy(tfield) && !t->is_struct()
+        && !t->is_xception() && !arena_initializer(t).empty()) {
+      // The two may come from different arenas.
+      out << indent() << "::apache::thrift::arenaSwap(a." << tfield->get_name() << ", b."
+          << tfield->get_name() << ");" << endl;
+      continue;
+    }
+    out << indent() << "swap(a." << tfield->get_name() << ", b." << tfield->get_name() << ");"
+        << endl;
+  }
+
+  if (has_nonrequired_fields) {
+    out << indent() << "swap(a.__isset, b.__isset);" << endl;
+  }
+
+  // handle empty structs
+  if (fields.size() == 0) {
+    out << indent() << "(void) a;" << endl;
+    out << indent() << "(void) b;" << endl;
+  }
+
+  scope_down(out);
+  out << endl;
+}
+
+/**
+ * Generates the __clear() method, which puts every field back to the value
+ * the default constructor gives it.  Strings and containers are cleared
+ * rather than replaced, and nested structs cleared in turn, so that a reused
+ * object keeps the memory it already has.
+ *
+ * @param out Stream to write to
+ * @param tstruct The struct
+ */
+void t_cpp_generator::generate_struct_clear(ofstream& out, t_struct* tstruct) {
+  out << indent() << "void " << tstruct->get_name() << "::__clear() {" << endl;
+  indent_up();
+
+  bool has_nonrequired_fields = false;
+  const vector<t_field*>& fields = tstruct->get_members();
+  for (vector<t_field*>::const_iterator f_iter = fields.begin(); f_iter != fields.end(); ++f_iter) {
+    t_field* tfield = *f_iter;
+    t_type* t = get_true_type(tfield->get_type());
+    t_const_value* cv = tfield->get_value();
+    string name = tfield->get_name();
+
+    if (tfield->get_req() != t_field::T_REQUIRED) {
+      has_nonrequired_fields = true;
+    }
+
+    if (is_reference(tfield)) {
+      out << indent() << "this->" << name << ".reset();" << endl;
+    } else if (is_lazy(tfield)) {
+      out << indent() << "this->" << name << ".reset();" << endl;
+      if (cv != NULL) {
+        print_const_value(out, name + ".getMutable()", t, cv);
+      }
+    } else if (t->is_base_type() || t->is_enum()) {
+      if (t->is_string() && cv == NULL) {
+        out << indent() << "this->" << name << ".clear();" << endl;
+      } else {
+        string dval;
+        if (cv != NULL) {
+          dval = render_const_value(out, name, t, cv);
+        } else if (t->is_enum()) {
+          dval = "(" + type_name(t) + ")0";
+        } else {
+          dval = "0";
+        }
+        out << indent() << "this->" << name << " = " << dval << ";" << endl;
+      }
+    } else {
+      out << indent() << "this->" << name << (t->is_container() ? ".clear();" : ".__clear();")
+          << endl;
+      if (cv != NULL) {
+        print_const_value(out, name, t, cv);
+      }
+    }
+  }
+
+  if (has_nonrequired_fields) {
+    out << indent() << "__isset = _" << tstruct->get_name() << "__isset();" << endl;
+  }
+
+  scope_down(out);
+  out << endl;
+}
+
+/**
+ * Generates the table that describes a struct's fields to readTable() and
+ * writeTable().  Fields go by ascending id, the order they are written in.
+ *
+ * @param out Stream to write to
+ * @param tstruct The struct
+ */
+void t_cpp_generator::generate_struct_table(ofstream& out, t_struct* tstruct) {
+  string ns = "::apache::thrift::protocol::";
+  string name = tstruct->get_name();
+
+  // Non-required fields have __isset bits in declaration order, and required
+  // ones are numbered for the check that they were all read.
+  std::map<t_field*, int> bits;
+  vector<t_field*> isset_fields;
+  int required = 0;
+  const vector<t_field*>& members = tstruct->get_members();
+  vector<t_field*>::const_iterator f_iter;
+  for (f_iter = members.begin(); f_iter != members.end(); ++f_iter) {
+    if ((*f_iter)->get_req() == t_field::T_REQUIRED) {
+      bits[*f_iter] = required++;
+    } else {
+      bits[*f_iter] = static_cast<int>(isset_fields.size());
+      isset_fields.push_back(*f_iter);
+    }
+  }
+
+  // The __isset members are reached by name, since where the compiler puts
+  // bit-fields depends on the ABI.
+  string test_isset = "NULL";
+  string set_isset = "NULL";
+  if (!isset_fields.empty()) {
+    test_isset = tmp("_" + name + "_testIsset");
+    set_isset = tmp("_" + name + "_setIsset");
+    out << "static bool " << test_isset << "(const void* obj, uint16_t bit) {" << endl;
+    indent_up();
+    indent(out) << "const " << name << "* s = static_cast<const " << name << "*>(obj);" << endl;
+    indent(out) << "switch (bit) {" << endl;
+    for (size_t i = 0; i < isset_fields.size(); ++i) {
+      indent(out) << "case " << i << ": return s->__isset." << isset_fields[i]->get_name() << ";"
+                  << endl;
+    }
+    indent(out) << "default: return false;" << endl;
+    indent(out) << "}" << endl;
+    indent_down();
+    out << "}" << endl << endl;
+
+    out << "static void " << set_isset << "(void* obj, uint16_t bit) {" << endl;
+    indent_up();
+    indent(out) << name << "* s = static_cast<" << name << "*>(obj);" << endl;
+    indent(out) << "switch (bit) {" << endl;
+    for (size_t i = 0; i < isset_fields.size(); ++i) {
+      indent(out) << "case " << i << ": s->__isset." << isset_fields[i]->get_name()
+                  << " = true; break;" << endl;
+    }
+    indent(out) << "default: break;" << endl;
+    indent(out) << "}" << endl;
+    indent_down();
+    out << "}" << endl << endl;
+  }
+
+  // Table structs have virtual methods but no virtual bases, so offsetof() is
+  // well-defined in practice on GCC/Clang/MSVC; GCC still warns about any
+  // class that is not standard-layout.
+  out << "BOOST_STATIC_ASSERT(!(::boost::is_virtual_base_of< ::apache::thrift::TBase, " << name
+      << ">::value));" << endl << endl;
+  out << "#if defined(__GNUC__)" << endl
+      << "#pragma GCC diagnostic push" << endl
+      << "#pragma GCC diagnostic ignored \"-Winvalid-offsetof\"" << endl
+      << "#endif" << endl;
+
+  const vector<t_field*>& fields = tstruct->get_sorted_members();
+  vector<string> specs;
+  for (f_iter = fields.begin(); f_iter != fields.end(); ++f_iter) {
+    specs.push_back(table_value_spec(out, (*f_iter)->get_type()));
+  }
+
+  string fields_name = "NULL";
+  if (!fields.empty()) {
+    fields_name = tmp("_" + name + "_fields");
+    out << "static const " << ns << "TFieldSpec " << fields_name << "[] = {" << endl;
+    indent_up();
+    for (size_t i = 0; i < fields.size(); ++i) {
+      t_field* tfield = fields[i];
+      string flags = "0";
+      if (tfield->get_req() == t_field::T_REQUIRED) {
+        flags = ns + "T_FIELD_REQUIRED";
+      } else if (tfield->get_req() == t_field::T_OPTIONAL || tfield->get_type()->is_xception()) {
+        flags = ns + "T_FIELD_CHECK_ISSET";
+      }
+      indent(out) << "{" << tfield->get_key() << ", " << flags << ", " << bits[tfield]
+                  << ", offsetof(" << name << ", " << tfield->get_name() << "), \""
+                  << tfield->get_name() << "\", " << specs[i] << "}"
+                  << (i + 1 < fields.size() ? "," : "") << endl;
+    }
+    indent_down();
+    out << "};" << endl << endl;
+  }
+
+  out << "const " << ns << "TStructSpec " << name << "::__table = {\"" << name << "\", "
+      << fields_name << ", " << fields.size() << ", " << required << ", "
+      << test_isset << ", " << set_isset << "};" << endl;
+
+  out << "#if defined(__GNUC__)" << endl
+      << "#pragma GCC diagnostic pop" << endl
+      << "#endif" << endl << endl;
+}
+
+/**
+ * Returns the initializer of a TValueSpec for values of the given type,
+ * after writing out the specs of its elements that it points to.
+ */
+string t_cpp_generator::table_value_spec(ofstream& out, t_type* ttype) {
+  string ns = "::apache::thrift::protocol::";
+  t_type* type = get_true_type(ttype);
+  string wire = type_to_enum(type);
+
+  if (type->is_base_type()) {
+    string kind;
+    switch (((t_base_type*)type)->get_base()) {
+    case t_base_type::TYPE_BOOL:
+      kind = "T_KIND_BOOL";
+      break;
+    case t_base_type::TYPE_I8:
+      kind = "T_KIND_BYTE";
+      break;
+    case t_base_type::TYPE_I16:
+      kind = "T_KIND_I16";
+      break;
+    case t_base_type::TYPE_I32:
+      kind = "T_KIND_I32";
+      break;
+    case t_base_type::TYPE_I64:
+      kind = "T_KIND_I64";
+      break;
+    case t_base_type::TYPE_DOUBLE:
+      kind = "T_KIND_DOUBLE";
+      break;
+    case t_base_type::TYPE_STRING:
+      kind = type->is_binary() ? "T_KIND_BINARY" : "T_KIND_STRING";
+      break;
+    default:
+      throw "compiler error: no table kind for base type " + type->get_name();
+    }
+    return "{" + wire + ", " + ns + kind + ", NULL, NULL, NULL, NULL, NULL}";
+  } else if (type->is_enum()) {
+    return "{" + wire + ", " + ns + "T_KIND_ENUM, NULL, NULL, NULL, NULL, NULL}";
+  } else if (type->is_struct() || type->is_xception()) {
+    // Structs of this program with tables are read by the same loop; others
+    // through their read() and write().
+    string sname = type_name(type);
+    string table = "NULL";
+    if (type->get_program() == program_ && is_table_struct((t_struct*)type)) {
+      table = "&" + sname + "::__table";
+    }
+    return "{" + wire + ", " + ns + "T_KIND_STRUCT, " + table + ", &" + ns + "TStructMethods<"
+           + sname + " >::ops, NULL, NULL, NULL}";
+  }
+
+  // Element specs are written out before the spec that points to them.
+  string cname = type_name(ttype);
+  string key = "NULL";
+  string elem;
+  string ops;
+  string kind;
+  if (type->is_map()) {
+    string key_spec = table_value_spec(out, ((t_map*)type)->get_key_type());
+    key = tmp("_spec");
+    out << "static const " << ns << "TValueSpec " << key << " = " << key_spec << ";" << endl;
+    key = "&" + key;
+    string val_spec = table_value_spec(out, ((t_map*)type)->get_val_type());
+    elem = tmp("_spec");
+    out << "static const " << ns << "TValueSpec " << elem << " = " << val_spec << ";" << endl;
+    ops = "TMapOps";
+    kind = "T_KIND_MAP";
+  } else {
+    t_type* elem_type = type->is_set() ? ((t_set*)type)->get_elem_type()
+                                       : ((t_list*)type)->get_elem_type();
+    string elem_spec = table_value_spec(out, elem_type);
+    elem = tmp("_spec");
+    out << "static const " << ns << "TValueSpec " << elem << " = " << elem_spec << ";" << endl;
+    ops = type->is_set() ? "TSetOps" : "TListOps";
+    kind = type->is_set() ? "T_KIND_SET" : "T_KIND_LIST";
+  }
+  return "{" + wire + ", " + ns + kind + ", NULL, NULL, &" + ns + ops + "<" + cname + " >::ops, &"
+         + elem + ", " + key + "}";
+}
+
+/**
+ * Generates read() and write() of a struct with a table.
+ *
+ * @param out Stream to write to
+ * @param tstruct The struct
+ */
+void t_cpp_generator::generate_table_reader_writer(ofstream& out, t_struct* tstruct) {
+  string name = tstruct->get_name();
+  if (gen_templates_) {
+    out << indent() << "template <class Protocol_>" << endl << indent() << "uint32_t " << name
+        << "::read(Protocol_* iprot) {" << endl;
+  } else {
+    out << indent() << "uint32_t " << name
+        << "::read(::apache::thrift::protocol::TProtocol* iprot) {" << endl;
+  }
+  out << indent() << "  return ::apache::thrift::protocol::readTable(iprot, this, __table);"
+      << endl << indent() << "}" << endl << endl;
+
+  if (gen_templates_) {
+    out << indent() << "template <class Protocol_>" << endl << indent() << "uint32_t " << name
+        << "::write(Protocol_* oprot) const {" << endl;
+  } else {
+    out << indent() << "uint32_t " << name
+        << "::write(::apache::thrift::protocol::TProtocol* oprot) const {" << endl;
+  }
+  out << indent() << "  return ::apache::thrift::protocol::writeTable(oprot, this, __table);"
+      << endl << indent() << "}" << endl << endl;
+}
+
+/**
+ * Generates the default constructor of a struct, or with arena its
+ * constructor for cpp:arena code that allocates the strings and containers
+ * of the struct from the given arena.
+ *
+ * @param out Stream to write to
+ * @param tstruct The struct
+ * @param arena Whether to generate the arena constructor
+ */
+void t_cpp_generator::generate_struct_constructor(ofstream& out, t_struct* tstruct, bool arena) {
+  const vector<t_field*>& members = tstruct->get_members();
+  vector<t_field*>::const_iterator m_iter;
+  if (arena) {
+    indent(out) << "explicit " << tstruct->get_name() << "(::apache::thrift::TArena* arena)";
+  } else {
+    indent(out) << tstruct->get_name() << "()";
+  }
+
+  bool init_ctor = false;
+  bool uses_arena = false;
+
+  for (m_iter = members.begin(); m_iter != members.end(); ++m_iter) {
+    t_type* t = get_true_type((*m_iter)->get_type());
+    string init;
+    if (arena && !is_reference(*m_iter) && !is_lazy(*m_iter)) {
+      init = arena_initializer(t);
+    }
+    if (!init.empty()) {
+      out << (init_ctor ? ", " : " : ") << (*m_iter)->get_name() << "(" << init << ")";
+      init_ctor = true;
+      uses_arena = true;
+    } else if (t->is_base_type() || t->is_enum() || is_reference(*m_iter)) {
+      string dval;
+      if (t->is_enum()) {
+        dval += "(" + type_name(t) + ")";
+      }
+      dval += (t->is_string() || is_reference(*m_iter)) ? "" : "0";
+      t_const_value* cv = (*m_iter)->get_value();
+      if (cv != NULL) {
+        dval = render_const_value(out, (*m_iter)->get_name(), t, cv);
+      }
+      if (!init_ctor) {
+        init_ctor = true;
+        out << " : ";
+        out << (*m_iter)->get_name() << "(" << dval << ")";
+      } else {
+        out << ", " << (*m_iter)->get_name() << "(" << dval << ")";
+      }
+    }
+  }
+  out << " {" << endl;
+  indent_up();
+  if (arena && !uses_arena) {
+    indent(out) << "(void) arena;" << endl;
+  }
+  // TODO(dreiss): When everything else in Thrift is perfect,
+  // do more of these in the initializer list.
+  for (m_iter = members.begin(); m_iter != members.end(); ++m_iter) {
+    t_type* t = get_true_type((*m_iter)->get_type());
+
+    if (!t->is_base_type()) {
+      t_const_value* cv = (*m_iter)->get_value();
+      if (cv != NULL) {
+        print_const_value(out,
+                          (*m_iter)->get_name() + (is_lazy(*m_iter) ? ".getMutable()" : ""),
+                          t,
+                          cv);
+      }
+    }
+  }
+  scope_down(out);
+}
+
+/**
+ * Returns the initializer of a member of the given type that allocates from
+ * arena, or "" if it has no allocator.
+ */
+string t_cpp_generator::arena_initializer(t_type* ttype) {
+  if (ttype->is_struct() || ttype->is_xception()) {
+    return "arena";
+  }
+  if (is_arena_string(ttype)) {
+    return "::apache::thrift::TArenaAllocator<char>(arena)";
+  }
+  if (!ttype->is_container() || ((t_container*)ttype)->has_cpp_name()) {
+    return "";
+  }
+
+  string tname = type_name(ttype);
+  string alloc = tname + "::allocator_type(arena)";
+  if (ttype->is_list()) {
+    return alloc;
+  }
+  if (is_hash_container(ttype)) {
+    return tname + "::hasher(), " + tname + "::key_equal(), " + alloc;
+  }
+  return tname + "::key_compare(), " + alloc;
+}
+
+/**
+ * Generates serializedSize(), which adds up what write() would write by
+ * making the same calls on a sizer.
+ *
+ * @param out Stream to write to
+ * @param tstruct The struct
+ */
+void t_cpp_generator::generate_struct_serialized_size(std::ostream& out, t_struct* tstruct) {
+  const vector<t_field*>& fields = tstruct->get_sorted_members();
+  vector<t_field*>::const_iterator f_iter;
+
+  out << indent() << "template <class Protocol_>" << endl << indent() << "uint32_t "
+      << tstruct->get_name() << "::serializedSize() const {" << endl;
+  indent_up();
+  out << indent()
+      << "typename ::apache::thrift::protocol::TSerializedSize<Protocol_>::Sizer sizer;" << endl
+      << indent() << "uint32_t xfer = 0;" << endl
+      << indent() << "xfer += sizer.structBegin();" << endl;
+
+  for (f_iter = fields.begin(); f_iter != fields.end(); ++f_iter) {
+    bool check_if_set = (*f_iter)->get_req() == t_field::T_OPTIONAL
+                        || (*f_iter)->get_type()->is_xception();
+    if (check_if_set) {
+      out << indent() << "if (this->__isset." << (*f_iter)->get_name() << ") {" << endl;
+      indent_up();
+    }
+    out << indent() << "xfer += sizer.fieldBegin(" << type_to_enum((*f_iter)->get_type()) << ", "
+        << (*f_iter)->get_key() << ");" << endl;
+    string name = "this->" + (*f_iter)->get_name();
+    if (is_lazy(*f_iter)) {
+      // Kept bytes of the same encoding are written as they are, so they
+      // are sized without decoding them.
+      out << indent() << "if (" << name << ".hasBytes() && " << name << ".getEncoding() == "
+          << "::apache::thrift::protocol::TSerializedSize<Protocol_>::encoding()) {" << endl;
+      indent(out) << "  xfer += static_cast<uint32_t>(" << name << ".getBytes().size());" << endl;
+      indent(out) << "} else {" << endl;
+      indent_up();
+      generate_size_value(out, (*f_iter)->get_type(), name + ".get()", false);
+      indent_down();
+      indent(out) << "}" << endl;
+    } else {
+      generate_size_value(out, (*f_iter)->get_type(), name, is_reference(*f_iter));
+    }
+    if (check_if_set) {
+      indent_down();
+      indent(out) << "}" << endl;
     }
-    // Write field closer
-    indent(out) << "xfer += oprot->writeFieldEnd();" << endl;
-
-    indent_down();
-    indent(out) << "}";
   }
 
-  // Write the struct map
-  out << endl << indent() << "xfer += oprot->writeFieldStop();" << endl << indent()
-      << "xfer += oprot->writeStructEnd();" << endl << indent() << "return xfer;" << endl;
-
+  out << indent() << "xfer += sizer.fieldStop();" << endl
+      << indent() << "xfer += sizer.structEnd();" << endl
+      << indent() << "return xfer;" << endl;
   indent_down();
   indent(out) << "}" << endl << endl;
 }
 
 /**
- * Generates the swap function.
+ * Adds the size of a value to xfer, as generate_serialize_field() writes it.
+ */
+void t_cpp_generator::generate_size_value(std::ostream& out,
+                                          t_type* ttype,
+                                          string name,
+                                          bool pointer) {
+  t_type* type = get_true_type(ttype);
+
+  if (type->is_struct() || type->is_xception()) {
+    if (pointer) {
+      // A missing struct is written as an empty one.
+      indent(out) << "xfer += " << name << " ? " << name
+                  << "->serializedSize<Protocol_>() : sizer.fieldStop();" << endl;
+    } else {
+      indent(out) << "xfer += " << name << ".serializedSize<Protocol_>();" << endl;
+    }
+  } else if (type->is_container()) {
+    scope_up(out);
+    if (type->is_map()) {
+      indent(out) << "xfer += sizer.mapBegin(" << type_to_enum(((t_map*)type)->get_key_type())
+                  << ", " << type_to_enum(((t_map*)type)->get_val_type())
+                  << ", static_cast<uint32_t>(" << name << ".size()));" << endl;
+    } else if (type->is_set()) {
+      indent(out) << "xfer += sizer.setBegin(" << type_to_enum(((t_set*)type)->get_elem_type())
+                  << ", static_cast<uint32_t>(" << name << ".size()));" << endl;
+    } else {
+      indent(out) << "xfer += sizer.listBegin(" << type_to_enum(((t_list*)type)->get_elem_type())
+                  << ", static_cast<uint32_t>(" << name << ".size()));" << endl;
+    }
+
+    string bulk = bulk_list_method(type);
+    if (!bulk.empty()) {
+      bulk[0] = static_cast<char>(tolower(bulk[0]));
+      indent(out) << "if (!" << name << ".empty()) {" << endl;
+      indent(out) << "  xfer += sizer." << bulk << "List(&" << name << "[0], "
+                  << "static_cast<uint32_t>(" << name << ".size()));" << endl;
+      indent(out) << "}" << endl;
+    } else {
+      string iter = tmp("_iter");
+      out << indent() << type_name(type) << "::const_iterator " << iter << ";" << endl
+          << indent() << "for (" << iter << " = " << name << ".begin(); " << iter << " != "
+          << name << ".end(); ++" << iter << ")" << endl;
+      scope_up(out);
+      if (type->is_map()) {
+        generate_size_value(out, ((t_map*)type)->get_key_type(), iter + "->first", false);
+        generate_size_value(out, ((t_map*)type)->get_val_type(), iter + "->second", false);
+      } else if (type->is_set()) {
+        generate_size_value(out, ((t_set*)type)->get_elem_type(), "(*" + iter + ")", false);
+      } else {
+        generate_size_value(out, ((t_list*)type)->get_elem_type(), "(*" + iter + ")", false);
+      }
+      scope_down(out);
+    }
+    scope_down(out);
+  } else if (type->is_enum()) {
+    indent(out) << "xfer += sizer.i32((int32_t)" << name << ");" << endl;
+  } else if (type->is_base_type()) {
+    string method;
+    switch (((t_base_type*)type)->get_base()) {
+    case t_base_type::TYPE_STRING:
+      method = "string";
+      break;
+    case t_base_type::TYPE_BOOL:
+      method = "boolean";
+      break;
+    case t_base_type::TYPE_I8:
+      method = "byte";
+      break;
+    case t_base_type::TYPE_I16:
+      method = "i16";
+      break;
+    case t_base_type::TYPE_I32:
+      method = "i32";
+      break;
+    case t_base_type::TYPE_I64:
+      method = "i64";
+      break;
+    case t_base_type::TYPE_DOUBLE:
+      method = "dbl";
+      break;
+    default:
+      throw "compiler error: cannot size field " + name + " of type " + type->get_name();
+    }
+    indent(out) << "xfer += sizer." << method << "(" << name << ");" << endl;
+  } else {
+    throw "compiler error: cannot size field " + name + " of type " + type->get_name();
+  }
+}
+
+/**
+ * Generates the static readers and writers of the struct's cpp.lazy fields,
+ * which the fields' TLazy wrappers call to decode and encode their values.
  *
  * @param out Stream to write to
  * @param tstruct The struct
  */
-void t_cpp_generator::generate_struct_swap(ofstream& out, t_struct* tstruct) {
-  out << indent() << "void swap(" << tstruct->get_name() << " &a, " << tstruct->get_name()
-      << " &b) {" << endl;
-  indent_up();
-
-  // Let argument-dependent name lookup find the correct swap() function to
-  // use based on the argument types.  If none is found in the arguments'
-  // namespaces, fall back to ::std::swap().
-  out << indent() << "using ::std::swap;" << endl;
-
-  bool has_nonrequired_fields = false;
+void t_cpp_generator::generate_lazy_field_helpers(ofstream& out, t_struct* tstruct) {
   const vector<t_field*>& fields = tstruct->get_members();
   for (vector<t_field*>::const_iterator f_iter = fields.begin(); f_iter != fields.end(); ++f_iter) {
-    t_field* tfield = *f_iter;
-
-    if (tfield->get_req() != t_field::T_REQUIRED) {
-      has_nonrequired_fields = true;
+    if (!is_lazy(*f_iter)) {
+      continue;
     }
+    string type = type_name((*f_iter)->get_type());
+    t_field value((*f_iter)->get_type(), "value");
 
-    out << indent() << "swap(a." << tfield->get_name() << ", b." << tfield->get_name() << ");"
-        << endl;
-  }
-
-  if (has_nonrequired_fields) {
-    out << indent() << "swap(a.__isset, b.__isset);" << endl;
-  }
+    out << indent() << "uint32_t " << tstruct->get_name() << "::__read_" << (*f_iter)->get_name()
+        << "(::apache::thrift::protocol::TProtocol* iprot, " << type << "& value) {" << endl;
+    indent_up();
+    out << indent() << "uint32_t xfer = 0;" << endl;
+    generate_deserialize_field(out, &value);
+    out << indent() << "return xfer;" << endl;
+    scope_down(out);
+    out << endl;
 
-  // handle empty structs
-  if (fields.size() == 0) {
-    out << indent() << "(void) a;" << endl;
-    out << indent() << "(void) b;" << endl;
+    out << indent() << "uint32_t " << tstruct->get_name() << "::__write_" << (*f_iter)->get_name()
+        << "(::apache::thrift::protocol::TProtocol* oprot, const " << type << "& value) {"
+        << endl;
+    indent_up();
+    out << indent() << "uint32_t xfer = 0;" << endl;
+    generate_serialize_field(out, &value);
+    out << indent() << "return xfer;" << endl;
+    scope_down(out);
+    out << endl;
   }
-
-  scope_down(out);
-  out << endl;
 }
 
 void t_cpp_generator::generate_struct_ostream_operator_decl(std::ofstream& out, t_struct* tstruct) {
@@ -1705,6 +2671,17 @@ void t_cpp_generator::generate_exception_what_method(std::ofstream& out, t_struc
 void t_cpp_generator::generate_service(t_service* tservice) {
   string svcname = tservice->get_name();
 
+  // Argument and result structs hold pointers to their fields while writing,
+  // which leaves no place for lazily decoded values.
+  const vector<t_function*>& functions = tservice->get_functions();
+  for (vector<t_function*>::const_iterator f_iter = functions.begin(); f_iter != functions.end();
+       ++f_iter) {
+    if (has_lazy_fields((*f_iter)->get_arglist()) || has_lazy_fields((*f_iter)->get_xceptions())) {
+      throw "cpp.lazy is not supported on function arguments or exceptions: " + svcname + "."
+          + (*f_iter)->get_name();
+    }
+  }
+
   // Make output files
   string f_header_name = get_out_dir() + svcname + ".h";
   f_header_.open(f_header_name.c_str());
@@ -1724,6 +2701,12 @@ void t_cpp_generator::generate_service(t_service* tservice) {
     f_header_ << "#include <thrift/async/TAsyncDispatchProcessor.h>" << endl;
   }
   f_header_ << "#include <thrift/async/TConcurrentClientSyncInfo.h>" << endl;
+  if (gen_future_style_) {
+    f_header_ << "#include <thrift/async/TFutureClient.h>" << endl;
+  }
+  if (gen_reuse_objects_) {
+    f_header_ << "#include <thrift/processor/TObjectPool.h>" << endl;
+  }
   f_header_ << "#include \"" << get_include_prefix(*get_program()) << program_name_ << "_types.h\""
             << endl;
 
@@ -1799,6 +2782,10 @@ void t_cpp_generator::generate_service(t_service* tservice) {
    
   }
 
+  if (gen_future_style_) {
+    generate_service_future_client(tservice);
+  }
+
   f_header_ << "#ifdef _MSC_VER\n"
                "  #pragma warning( pop )\n"
                "#endif\n\n";
@@ -1845,6 +2832,9 @@ void t_cpp_generator::generate_service_helpers(t_service* tservice) {
     generate_struct_definition(out, f_service_, ts, false);
     generate_struct_reader(out, ts);
     generate_struct_writer(out, ts);
+    if (gen_reuse_objects_) {
+      generate_struct_clear(f_service_, ts);
+    }
     ts->set_name(tservice->get_name() + "_" + (*f_iter)->get_name() + "_pargs");
     generate_struct_declaration(f_header_, ts, false, true, false, true);
     generate_struct_definition(out, f_service_, ts, false);
@@ -2615,8 +3605,8 @@ void t_cpp_generator::generate_service_client(t_service* tservice, string style)
         if(style == "Concurrent") {
           out <<
             endl <<
-            indent() << "// the read mutex gets dropped and reacquired as part of waitForWork()" << endl <<
-            indent() << "// The destructor of this sentry wakes up other clients" << endl <<
+            indent() << "// the read token is handed on and taken back as part of waitForWork()" << endl <<
+            indent() << "// The destructor of this sentry passes the read token on to other clients" << endl <<
             indent() << "::apache::thrift::async::TConcurrentRecvSentry sentry(&this->sync_, seqid);" << endl;
         }
         if (style == "Cob" && !gen_no_client_completion_) {
@@ -2773,7 +3763,7 @@ void t_cpp_generator::generate_service_client(t_service* tservice, string style)
             indent() << "  // seqid != rseqid" << endl <<
             indent() << "  this->sync_.updatePending(fname, mtype, rseqid);" << endl <<
             endl <<
-            indent() << "  // this will temporarily unlock the readMutex, and let other clients get work done" << endl <<
+            indent() << "  // this hands the read token to the client the reply is for, and waits to get it back" << endl <<
             indent() << "  this->sync_.waitForWork(seqid);" << endl <<
             indent() << "} // end while(true)" << endl;
         }
@@ -2812,6 +3802,7 @@ public:
 
   void generate_class_definition();
   void generate_dispatch_call(bool template_protocol);
+  void generate_method_switch(const vector<t_function*>& functions);
   void generate_process_functions();
   void generate_factory();
 
@@ -2942,29 +3933,18 @@ void ProcessorGenerator::generate_class_definition() {
   f_header_ << " private:" << endl;
   indent_up();
 
-  // Declare processMap_
-  f_header_ << indent() << "typedef  void (" << class_name_ << "::*"
-            << "ProcessFunction)(" << finish_cob_decl_ << "int32_t, "
-            << "::apache::thrift::protocol::TProtocol*, "
-            << "::apache::thrift::protocol::TProtocol*" << call_context_decl_ << ");" << endl;
-  if (generator_->gen_templates_) {
-    f_header_ << indent() << "typedef void (" << class_name_ << "::*"
-              << "SpecializedProcessFunction)(" << finish_cob_decl_ << "int32_t, "
-              << "Protocol_*, Protocol_*" << call_context_decl_ << ");" << endl << indent()
-              << "struct ProcessFunctions {" << endl << indent() << "  ProcessFunction generic;"
-              << endl << indent() << "  SpecializedProcessFunction specialized;" << endl << indent()
-              << "  ProcessFunctions(ProcessFunction g, "
-              << "SpecializedProcessFunction s) :" << endl << indent() << "    generic(g)," << endl
-              << indent() << "    specialized(s) {}" << endl << indent()
-              << "  ProcessFunctions() : generic(NULL), specialized(NULL) "
-              << "{}" << endl << indent() << "};" << endl << indent()
-              << "typedef std::map<std::string, ProcessFunctions> "
-              << "ProcessMap;" << endl;
-  } else {
-    f_header_ << indent() << "typedef std::map<std::string, ProcessFunction> "
-              << "ProcessMap;" << endl;
+  // Idle args and result objects, kept with the memory they grew
+  if (generator_->gen_reuse_objects_ && style_ != "Cob") {
+    for (f_iter = functions.begin(); f_iter != functions.end(); ++f_iter) {
+      string prefix = service_name_ + "_" + (*f_iter)->get_name();
+      f_header_ << indent() << "::apache::thrift::processor::TObjectPool<" << prefix << "_args> "
+                << (*f_iter)->get_name() << "_args_pool_;" << endl;
+      if (!(*f_iter)->is_oneway()) {
+        f_header_ << indent() << "::apache::thrift::processor::TObjectPool<" << prefix
+                  << "_result> " << (*f_iter)->get_name() << "_result_pool_;" << endl;
+      }
+    }
   }
-  f_header_ << indent() << "ProcessMap processMap_;" << endl;
 
   for (f_iter = functions.begin(); f_iter != functions.end(); ++f_iter) {
     indent(f_header_) << "void process_" << (*f_iter)->get_name() << "(" << finish_cob_
@@ -3009,28 +3989,7 @@ void ProcessorGenerator::generate_class_definition() {
   if (!extends_.empty()) {
     f_header_ << indent() << "  " << extends_ << "(iface)," << endl;
   }
-  f_header_ << indent() << "  iface_(iface) {" << endl;
-  indent_up();
-
-  for (f_iter = functions.begin(); f_iter != functions.end(); ++f_iter) {
-    f_header_ << indent() << "processMap_[\"" << (*f_iter)->get_name() << "\"] = ";
-    if (generator_->gen_templates_) {
-      f_header_ << "ProcessFunctions(" << endl;
-      if (generator_->gen_templates_only_) {
-        indent(f_header_) << "  NULL," << endl;
-      } else {
-        indent(f_header_) << "  &" << class_name_ << "::process_" << (*f_iter)->get_name() << ","
-                          << endl;
-      }
-      indent(f_header_) << "  &" << class_name_ << "::process_" << (*f_iter)->get_name() << ")";
-    } else {
-      f_header_ << "&" << class_name_ << "::process_" << (*f_iter)->get_name();
-    }
-    f_header_ << ";" << endl;
-  }
-
-  indent_down();
-  f_header_ << indent() << "}" << endl << endl << indent() << "virtual ~" << class_name_ << "() {}"
+  f_header_ << indent() << "  iface_(iface) {}" << endl << endl << indent() << "virtual ~" << class_name_ << "() {}"
             << endl;
   indent_down();
   f_header_ << "};" << endl << endl;
@@ -3071,53 +4030,107 @@ void ProcessorGenerator::generate_dispatch_call(bool template_protocol) {
          << "const std::string& fname, int32_t seqid" << call_context_ << ") {" << endl;
   indent_up();
 
-  // HOT: member function pointer map
-  f_out_ << indent() << typename_str_ << "ProcessMap::iterator pfn;" << endl << indent()
-         << "pfn = processMap_.find(fname);" << endl << indent()
-         << "if (pfn == processMap_.end()) {" << endl;
+  // HOT: resolve the method name with a switch on its length and then on
+  // the characters that tell the names of that length apart, so a call
+  // costs a few jumps and a single string compare.
+  vector<t_function*> functions = service_->get_functions();
+  if (!functions.empty()) {
+    std::map<size_t, vector<t_function*> > by_length;
+    vector<t_function*>::const_iterator f_iter;
+    for (f_iter = functions.begin(); f_iter != functions.end(); ++f_iter) {
+      by_length[(*f_iter)->get_name().size()].push_back(*f_iter);
+    }
+
+    f_out_ << indent() << "switch (fname.size()) {" << endl;
+    std::map<size_t, vector<t_function*> >::const_iterator l_iter;
+    for (l_iter = by_length.begin(); l_iter != by_length.end(); ++l_iter) {
+      f_out_ << indent() << "case " << l_iter->first << ":" << endl;
+      indent_up();
+      generate_method_switch(l_iter->second);
+      f_out_ << indent() << "break;" << endl;
+      indent_down();
+    }
+    f_out_ << indent() << "}" << endl;
+  }
+
   if (extends_.empty()) {
-    f_out_ << indent() << "  iprot->skip(::apache::thrift::protocol::T_STRUCT);" << endl << indent()
-           << "  iprot->readMessageEnd();" << endl << indent()
-           << "  iprot->getTransport()->readEnd();" << endl << indent()
-           << "  ::apache::thrift::TApplicationException "
+    if (functions.empty() && !call_context_.empty()) {
+      // Only the method calls pass the context on.
+      f_out_ << indent() << "(void)callContext;" << endl;
+    }
+    f_out_ << indent() << "iprot->skip(::apache::thrift::protocol::T_STRUCT);" << endl << indent()
+           << "iprot->readMessageEnd();" << endl << indent()
+           << "iprot->getTransport()->readEnd();" << endl << indent()
+           << "::apache::thrift::TApplicationException "
               "x(::apache::thrift::TApplicationException::UNKNOWN_METHOD, \"Invalid method name: "
               "'\"+fname+\"'\");" << endl << indent()
-           << "  oprot->writeMessageBegin(fname, ::apache::thrift::protocol::T_EXCEPTION, seqid);"
-           << endl << indent() << "  x.write(oprot);" << endl << indent()
-           << "  oprot->writeMessageEnd();" << endl << indent()
-           << "  oprot->getTransport()->writeEnd();" << endl << indent()
-           << "  oprot->getTransport()->flush();" << endl << indent()
-           << (style_ == "Cob" ? "  return cob(true);" : "  return true;") << endl;
+           << "oprot->writeMessageBegin(fname, ::apache::thrift::protocol::T_EXCEPTION, seqid);"
+           << endl << indent() << "x.write(oprot);" << endl << indent()
+           << "oprot->writeMessageEnd();" << endl << indent()
+           << "oprot->getTransport()->writeEnd();" << endl << indent()
+           << "oprot->getTransport()->flush();" << endl << indent()
+           << (style_ == "Cob" ? "return cob(true);" : "return true;") << endl;
   } else {
-    f_out_ << indent() << "  return " << extends_ << "::dispatchCall("
+    f_out_ << indent() << "return " << extends_ << "::dispatchCall("
            << (style_ == "Cob" ? "cob, " : "") << "iprot, oprot, fname, seqid" << call_context_arg_
            << ");" << endl;
   }
-  f_out_ << indent() << "}" << endl;
-  if (template_protocol) {
-    f_out_ << indent() << "(this->*(pfn->second.specialized))";
-  } else {
-    if (generator_->gen_templates_only_) {
-      // TODO: This is a null pointer, so nothing good will come from calling
-      // it.  Throw an exception instead.
-      f_out_ << indent() << "(this->*(pfn->second.generic))";
-    } else if (generator_->gen_templates_) {
-      f_out_ << indent() << "(this->*(pfn->second.generic))";
-    } else {
-      f_out_ << indent() << "(this->*(pfn->second))";
+
+  indent_down();
+  f_out_ << "}" << endl << endl;
+}
+
+/**
+ * Generates the lookup of a method among functions, whose names all have the
+ * same length.  Switches on the character position that splits them into
+ * the most groups, until only a couple of candidates are left to compare.
+ * Positions already switched on have a single value left, so they are never
+ * picked again.
+ */
+void ProcessorGenerator::generate_method_switch(const vector<t_function*>& functions) {
+  vector<t_function*>::const_iterator f_iter;
+  if (functions.size() <= 2) {
+    for (f_iter = functions.begin(); f_iter != functions.end(); ++f_iter) {
+      f_out_ << indent() << "if (fname == \"" << (*f_iter)->get_name() << "\") {" << endl;
+      indent_up();
+      f_out_ << indent() << "process_" << (*f_iter)->get_name() << "(" << cob_arg_
+             << "seqid, iprot, oprot" << call_context_arg_ << ");" << endl << indent()
+             << (style_ == "Cob" ? "return;" : "return true;") << endl;
+      indent_down();
+      f_out_ << indent() << "}" << endl;
     }
+    return;
   }
-  f_out_ << "(" << cob_arg_ << "seqid, iprot, oprot" << call_context_arg_ << ");" << endl;
 
-  // TODO(dreiss): return pfn ret?
-  if (style_ == "Cob") {
-    f_out_ << indent() << "return;" << endl;
-  } else {
-    f_out_ << indent() << "return true;" << endl;
+  size_t length = functions.front()->get_name().size();
+  size_t best_pos = 0;
+  size_t best_count = 0;
+  for (size_t pos = 0; pos < length; ++pos) {
+    std::set<char> chars;
+    for (f_iter = functions.begin(); f_iter != functions.end(); ++f_iter) {
+      chars.insert((*f_iter)->get_name()[pos]);
+    }
+    if (chars.size() > best_count) {
+      best_pos = pos;
+      best_count = chars.size();
+    }
   }
 
-  indent_down();
-  f_out_ << "}" << endl << endl;
+  std::map<char, vector<t_function*> > by_char;
+  for (f_iter = functions.begin(); f_iter != functions.end(); ++f_iter) {
+    by_char[(*f_iter)->get_name()[best_pos]].push_back(*f_iter);
+  }
+
+  f_out_ << indent() << "switch (fname[" << best_pos << "]) {" << endl;
+  std::map<char, vector<t_function*> >::const_iterator c_iter;
+  for (c_iter = by_char.begin(); c_iter != by_char.end(); ++c_iter) {
+    f_out_ << indent() << "case '" << c_iter->first << "':" << endl;
+    indent_up();
+    generate_method_switch(c_iter->second);
+    f_out_ << indent() << "break;" << endl;
+    indent_down();
+  }
+  f_out_ << indent() << "}" << endl;
 }
 
 void ProcessorGenerator::generate_process_functions() {
@@ -3183,6 +4196,140 @@ void ProcessorGenerator::generate_factory() {
   f_out_ << indent() << "}" << endl << endl;
 }
 
+/**
+ * Generates the future client of a service.  Every method writes its request
+ * into a TFutureCall of its own and returns the future of the result, which
+ * a static recv_ function completes once the channel has the reply.
+ *
+ * @param tservice The service to generate a client for.
+ */
+void t_cpp_generator::generate_service_future_client(t_service* tservice) {
+  string class_name = service_name_ + "FutureClient";
+  string base_name = "::apache::thrift::async::TFutureClient";
+  if (tservice->get_extends() != NULL) {
+    base_name = type_name(tservice->get_extends()) + "FutureClient";
+  }
+  string call_ptr = "::apache::thrift::stdcxx::shared_ptr< ::apache::thrift::async::TFutureCall>";
+
+  f_header_ << "// The \'future\' client returns the future of the result of every call, so\n"
+               "// that a single thread can keep any number of calls in flight.\n"
+            << "class " << class_name << " : public " << base_name << " {" << endl
+            << " public:" << endl;
+  indent_up();
+  f_header_ << indent() << class_name
+            << "(::apache::thrift::stdcxx::shared_ptr< ::apache::thrift::async::TAsyncChannel> "
+               "channel, ::apache::thrift::stdcxx::shared_ptr< "
+               "::apache::thrift::protocol::TProtocolFactory> protocolFactory) :" << endl
+            << indent() << "  " << base_name << "(channel, protocolFactory) {}" << endl;
+
+  vector<t_function*> functions = tservice->get_functions();
+  vector<t_function*>::const_iterator f_iter;
+  for (f_iter = functions.begin(); f_iter != functions.end(); ++f_iter) {
+    string future_type = "::apache::thrift::async::TFuture< "
+                         + type_name((*f_iter)->get_returntype()) + " >";
+    f_header_ << indent() << future_type << " " << (*f_iter)->get_name() << "("
+              << argument_list((*f_iter)->get_arglist()) << ");" << endl;
+  }
+
+  indent_down();
+  f_header_ << " protected:" << endl;
+  indent_up();
+  for (f_iter = functions.begin(); f_iter != functions.end(); ++f_iter) {
+    if ((*f_iter)->is_oneway()) {
+      continue;
+    }
+    f_header_ << indent() << "static void recv_" << (*f_iter)->get_name() << "(" << call_ptr
+              << " call, ::apache::thrift::async::TPromise< "
+              << type_name((*f_iter)->get_returntype()) << " > promise);" << endl;
+  }
+  indent_down();
+  f_header_ << "};" << endl << endl;
+
+  for (f_iter = functions.begin(); f_iter != functions.end(); ++f_iter) {
+    t_type* returntype = (*f_iter)->get_returntype();
+    string fname = (*f_iter)->get_name();
+    string promise_type = "::apache::thrift::async::TPromise< " + type_name(returntype) + " >";
+    string argsname = tservice->get_name() + "_" + fname + "_pargs";
+    string resultname = tservice->get_name() + "_" + fname + "_presult";
+
+    // Send the request
+    f_service_ << "::apache::thrift::async::TFuture< " << type_name(returntype) << " > "
+               << class_name << "::" << fname << "(" << argument_list((*f_iter)->get_arglist())
+               << ")" << endl;
+    scope_up(f_service_);
+    f_service_ << indent() << call_ptr << " call = this->newCall();" << endl << indent()
+               << "::apache::thrift::protocol::TProtocol* oprot = call->getOutputProtocol();"
+               << endl << indent() << "oprot->writeMessageBegin(\"" << fname
+               << "\", ::apache::thrift::protocol::" << ((*f_iter)->is_oneway() ? "T_ONEWAY" : "T_CALL")
+               << ", call->getSeqid());" << endl << endl << indent() << argsname << " args;" << endl;
+
+    const vector<t_field*>& fields = (*f_iter)->get_arglist()->get_members();
+    vector<t_field*>::const_iterator fld_iter;
+    for (fld_iter = fields.begin(); fld_iter != fields.end(); ++fld_iter) {
+      f_service_ << indent() << "args." << (*fld_iter)->get_name() << " = &"
+                 << (*fld_iter)->get_name() << ";" << endl;
+    }
+    f_service_ << indent() << "args.write(oprot);" << endl << endl << indent()
+               << "oprot->writeMessageEnd();" << endl << indent()
+               << "oprot->getTransport()->writeEnd();" << endl << indent()
+               << "oprot->getTransport()->flush();" << endl << endl;
+
+    if ((*f_iter)->is_oneway()) {
+      f_service_ << indent() << "return this->sendOneway(call);" << endl;
+      scope_down(f_service_);
+      f_service_ << endl;
+      continue;
+    }
+
+    f_service_ << indent() << promise_type << " promise;" << endl << indent()
+               << "this->send(call, ::apache::thrift::stdcxx::bind(&" << class_name << "::recv_"
+               << fname << ", call, promise));" << endl << indent() << "return promise.getFuture();"
+               << endl;
+    scope_down(f_service_);
+    f_service_ << endl;
+
+    // Complete the future with the reply
+    f_service_ << "void " << class_name << "::recv_" << fname << "(" << call_ptr << " call, "
+               << promise_type << " promise)" << endl;
+    scope_up(f_service_);
+    if (!returntype->is_void()) {
+      t_field returnfield(returntype, "_return");
+      f_service_ << indent() << declare_field(&returnfield) << endl;
+    }
+    f_service_ << indent() << resultname << " result;" << endl;
+    if (!returntype->is_void()) {
+      f_service_ << indent() << "result.success = &_return;" << endl;
+    }
+    f_service_ << indent() << "if (!call->readResult(\"" << fname << "\", result, promise)) {"
+               << endl << indent() << "  return;" << endl << indent() << "}" << endl;
+
+    if (!returntype->is_void()) {
+      f_service_ << indent() << "if (result.__isset.success) {" << endl << indent()
+                 << "  promise.setValue(_return);" << endl << indent() << "  return;" << endl
+                 << indent() << "}" << endl;
+    }
+
+    const std::vector<t_field*>& xceptions = (*f_iter)->get_xceptions()->get_members();
+    vector<t_field*>::const_iterator x_iter;
+    for (x_iter = xceptions.begin(); x_iter != xceptions.end(); ++x_iter) {
+      f_service_ << indent() << "if (result.__isset." << (*x_iter)->get_name() << ") {" << endl
+                 << indent() << "  promise.setException(result." << (*x_iter)->get_name() << ");"
+                 << endl << indent() << "  return;" << endl << indent() << "}" << endl;
+    }
+
+    if (returntype->is_void()) {
+      f_service_ << indent() << "promise.setValue();" << endl;
+    } else {
+      f_service_ << indent()
+                 << "promise.setException(::apache::thrift::TApplicationException(::apache::"
+                    "thrift::TApplicationException::MISSING_RESULT, \"" << fname
+                 << " failed: unknown result\"));" << endl;
+    }
+    scope_down(f_service_);
+    f_service_ << endl;
+  }
+}
+
 /**
  * Generates a service processor definition.
  *
@@ -3222,6 +4369,9 @@ void t_cpp_generator::generate_function_helpers(t_service* tservice, t_function*
   generate_struct_definition(out, f_service_, &result, false);
   generate_struct_reader(out, &result);
   generate_struct_result_writer(out, &result);
+  if (gen_reuse_objects_) {
+    generate_struct_clear(f_service_, &result);
+  }
 
   result.set_name(tservice->get_name() + "_" + tfunction->get_name() + "_presult");
   generate_struct_declaration(f_header_, &result, false, true, true, gen_cob_style_);
@@ -3287,8 +4437,24 @@ void t_cpp_generator::generate_process_function(t_service* tservice,
         << "this->eventHandler_.get(), ctx, " << service_func_name << ");" << endl << endl
         << indent() << "if (this->eventHandler_.get() != NULL) {" << endl << indent()
         << "  this->eventHandler_->preRead(ctx, " << service_func_name << ");" << endl << indent()
-        << "}" << endl << endl << indent() << argsname << " args;" << endl << indent()
-        << "args.read(iprot);" << endl << indent() << "iprot->readMessageEnd();" << endl << indent()
+        << "}" << endl << endl;
+    if (gen_reuse_objects_) {
+      out << indent() << "::apache::thrift::processor::TObjectPool<" << argsname
+          << ">::Lease argsLease(this->" << tfunction->get_name() << "_args_pool_);" << endl
+          << indent() << argsname << "& args = *argsLease;" << endl;
+    } else if (gen_arena_) {
+      out << indent() << "::apache::thrift::TArena* arena = ::apache::thrift::TArena::request();"
+          << endl << indent() << argsname << " args(arena);" << endl;
+    } else {
+      out << indent() << argsname << " args;" << endl;
+    }
+    if (gen_arena_) {
+      out << indent() << "{" << endl << indent() << "  ::apache::thrift::TArenaScope scope(arena);"
+          << endl << indent() << "  args.read(iprot);" << endl << indent() << "}" << endl;
+    } else {
+      out << indent() << "args.read(iprot);" << endl;
+    }
+    out << indent() << "iprot->readMessageEnd();" << endl << indent()
         << "uint32_t bytes = iprot->getTransport()->readEnd();" << endl << endl << indent()
         << "if (this->eventHandler_.get() != NULL) {" << endl << indent()
         << "  this->eventHandler_->postRead(ctx, " << service_func_name << ", bytes);" << endl
@@ -3296,7 +4462,13 @@ void t_cpp_generator::generate_process_function(t_service* tservice,
 
     // Declare result
     if (!tfunction->is_oneway()) {
-      out << indent() << resultname << " result;" << endl;
+      if (gen_reuse_objects_) {
+        out << indent() << "::apache::thrift::processor::TObjectPool<" << resultname
+            << ">::Lease resultLease(this->" << tfunction->get_name() << "_result_pool_);" << endl
+            << indent() << resultname << "& result = *resultLease;" << endl;
+      } else {
+        out << indent() << resultname << (gen_arena_ ? " result(arena);" : " result;") << endl;
+      }
     }
 
     // Try block for functions with exceptions
@@ -3740,6 +4912,9 @@ void t_cpp_generator::generate_deserialize_field(ofstream& out,
     generate_deserialize_struct(out, (t_struct*)type, name, is_reference(tfield));
   } else if (type->is_container()) {
     generate_deserialize_container(out, type, name);
+  } else if (is_arena_string(type)) {
+    indent(out) << "xfer += ::apache::thrift::protocol::readArenaString(*iprot, " << name
+                << (type->is_binary() ? ", true" : "") << ");" << endl;
   } else if (type->is_base_type()) {
     indent(out) << "xfer += iprot->";
     t_base_type::t_base tbase = ((t_base_type*)type)->get_base();
@@ -3749,9 +4924,9 @@ void t_cpp_generator::generate_deserialize_field(ofstream& out,
       break;
     case t_base_type::TYPE_STRING:
       if (type->is_binary()) {
-        out << "readBinary(" << name << ");";
+        out << (is_string_view(type) ? "readBinaryView(" : "readBinary(") << name << ");";
       } else {
-        out << "readString(" << name << ");";
+        out << (is_string_view(type) ? "readStringView(" : "readString(") << name << ");";
       }
       break;
     case t_base_type::TYPE_BOOL:
@@ -3845,23 +5020,44 @@ void t_cpp_generator::generate_deserialize_container(ofstream& out, t_type* ttyp
       indent(out) << prefix << ".resize(" << size << ");" << endl;
     }
   }
+  if (is_flat_container(ttype) || is_hash_container(ttype)) {
+    // One allocation for the elements, and one for the hash table
+    indent(out) << prefix << ".reserve(" << size << ");" << endl;
+  }
 
-  // For loop iterates over elements
-  string i = tmp("_i");
-  out << indent() << "uint32_t " << i << ";" << endl << indent() << "for (" << i << " = 0; " << i
-      << " < " << size << "; ++" << i << ")" << endl;
+  string bulk = bulk_list_method(ttype);
+  if (!bulk.empty()) {
+    // Primitive lists are read in one call straight into the vector
+    indent(out) << "if (" << size << " > 0) {" << endl;
+    indent_up();
+    indent(out) << "xfer += iprot->read" << bulk << "List(&" << prefix << "[0], " << size << ");"
+                << endl;
+    indent_down();
+    indent(out) << "}" << endl;
+  } else {
+    // For loop iterates over elements
+    string i = tmp("_i");
+    out << indent() << "uint32_t " << i << ";" << endl << indent() << "for (" << i << " = 0; "
+        << i << " < " << size << "; ++" << i << ")" << endl;
 
-  scope_up(out);
+    scope_up(out);
 
-  if (ttype->is_map()) {
-    generate_deserialize_map_element(out, (t_map*)ttype, prefix);
-  } else if (ttype->is_set()) {
-    generate_deserialize_set_element(out, (t_set*)ttype, prefix);
-  } else if (ttype->is_list()) {
-    generate_deserialize_list_element(out, (t_list*)ttype, prefix, use_push, i);
+    if (ttype->is_map()) {
+      generate_deserialize_map_element(out, (t_map*)ttype, prefix);
+    } else if (ttype->is_set()) {
+      generate_deserialize_set_element(out, (t_set*)ttype, prefix);
+    } else if (ttype->is_list()) {
+      generate_deserialize_list_element(out, (t_list*)ttype, prefix, use_push, i);
+    }
+
+    scope_down(out);
   }
 
-  scope_down(out);
+  if (is_flat_container(ttype)) {
+    // Elements were appended as they came; this only checks the order when
+    // the writer's map or set was ordered too.
+    indent(out) << prefix << ".sort();" << endl;
+  }
 
   // Read container end
   if (ttype->is_map()) {
@@ -3887,8 +5083,9 @@ void t_cpp_generator::generate_deserialize_map_element(ofstream& out, t_map* tma
   out << indent() << declare_field(&fkey) << endl;
 
   generate_deserialize_field(out, &fkey);
-  indent(out) << declare_field(&fval, false, false, false, true) << " = " << prefix << "[" << key
-              << "];" << endl;
+  indent(out) << declare_field(&fval, false, false, false, true) << " = " << prefix
+              << (is_flat_container(tmap) ? ".append(" + key + ")" : "[" + key + "]") << ";"
+              << endl;
 
   generate_deserialize_field(out, &fval);
 }
@@ -3901,7 +5098,8 @@ void t_cpp_generator::generate_deserialize_set_element(ofstream& out, t_set* tse
 
   generate_deserialize_field(out, &felem);
 
-  indent(out) << prefix << ".insert(" << elem << ");" << endl;
+  indent(out) << prefix << (is_flat_container(tset) ? ".append(" : ".insert(") << elem << ");"
+              << endl;
 }
 
 void t_cpp_generator::generate_deserialize_list_element(ofstream& out,
@@ -3942,6 +5140,9 @@ void t_cpp_generator::generate_serialize_field(ofstream& out,
 
   if (type->is_struct() || type->is_xception()) {
     generate_serialize_struct(out, (t_struct*)type, name, is_reference(tfield));
+  } else if (is_arena_string(type)) {
+    indent(out) << "xfer += ::apache::thrift::protocol::writeArenaString(*oprot, " << name
+                << (type->is_binary() ? ", true" : "") << ");" << endl;
   } else if (type->is_container()) {
     generate_serialize_container(out, type, name);
   } else if (type->is_base_type() || type->is_enum()) {
@@ -3956,9 +5157,9 @@ void t_cpp_generator::generate_serialize_field(ofstream& out,
         break;
       case t_base_type::TYPE_STRING:
         if (type->is_binary()) {
-          out << "writeBinary(" << name << ");";
+          out << (is_string_view(type) ? "writeBinaryView(" : "writeBinary(") << name << ");";
         } else {
-          out << "writeString(" << name << ");";
+          out << (is_string_view(type) ? "writeStringView(" : "writeString(") << name << ");";
         }
         break;
       case t_base_type::TYPE_BOOL:
@@ -4034,19 +5235,29 @@ void t_cpp_generator::generate_serialize_container(ofstream& out, t_type* ttype,
                 << "static_cast<uint32_t>(" << prefix << ".size()));" << endl;
   }
 
-  string iter = tmp("_iter");
-  out << indent() << type_name(ttype) << "::const_iterator " << iter << ";" << endl << indent()
-      << "for (" << iter << " = " << prefix << ".begin(); " << iter << " != " << prefix
-      << ".end(); ++" << iter << ")" << endl;
-  scope_up(out);
-  if (ttype->is_map()) {
-    generate_serialize_map_element(out, (t_map*)ttype, iter);
-  } else if (ttype->is_set()) {
-    generate_serialize_set_element(out, (t_set*)ttype, iter);
-  } else if (ttype->is_list()) {
-    generate_serialize_list_element(out, (t_list*)ttype, iter);
+  string bulk = bulk_list_method(ttype);
+  if (!bulk.empty()) {
+    indent(out) << "if (!" << prefix << ".empty()) {" << endl;
+    indent_up();
+    indent(out) << "xfer += oprot->write" << bulk << "List(&" << prefix << "[0], "
+                << "static_cast<uint32_t>(" << prefix << ".size()));" << endl;
+    indent_down();
+    indent(out) << "}" << endl;
+  } else {
+    string iter = tmp("_iter");
+    out << indent() << type_name(ttype) << "::const_iterator " << iter << ";" << endl << indent()
+        << "for (" << iter << " = " << prefix << ".begin(); " << iter << " != " << prefix
+        << ".end(); ++" << iter << ")" << endl;
+    scope_up(out);
+    if (ttype->is_map()) {
+      generate_serialize_map_element(out, (t_map*)ttype, iter);
+    } else if (ttype->is_set()) {
+      generate_serialize_set_element(out, (t_set*)ttype, iter);
+    } else if (ttype->is_list()) {
+      generate_serialize_list_element(out, (t_list*)ttype, iter);
+    }
+    scope_down(out);
   }
-  scope_down(out);
 
   if (ttype->is_map()) {
     indent(out) << "xfer += oprot->writeMapEnd();" << endl;
@@ -4198,14 +5409,61 @@ string t_cpp_generator::type_name(t_type* ttype, bool in_typedef, bool arg) {
       cname = tcontainer->get_cpp_name();
     } else if (ttype->is_map()) {
       t_map* tmap = (t_map*)ttype;
-      cname = "std::map<" + type_name(tmap->get_key_type(), in_typedef) + ", "
-              + type_name(tmap->get_val_type(), in_typedef) + "> ";
+      string kname = type_name(tmap->get_key_type(), in_typedef);
+      string vname = type_name(tmap->get_val_type(), in_typedef);
+      if (is_flat_container(ttype)) {
+        cname = "::apache::thrift::TFlatMap<" + kname + ", " + vname;
+        if (gen_arena_) {
+          cname += ", std::less<" + kname + " >, ::apache::thrift::TArenaAllocator<std::pair<"
+                   + kname + ", " + vname + " > > ";
+        }
+        cname += "> ";
+      } else if (is_hash_container(ttype)) {
+        cname = "::apache::thrift::THashMap<" + kname + ", " + vname;
+        if (gen_arena_) {
+          cname += ", boost::hash<" + kname + " >, std::equal_to<" + kname + " >, "
+                   + "::apache::thrift::TArenaAllocator<std::pair<" + kname + ", " + vname
+                   + " > > ";
+        }
+        cname += "> ";
+      } else if (gen_arena_) {
+        cname = "std::map<" + kname + ", " + vname + ", std::less<" + kname + " >, "
+                + "::apache::thrift::TArenaAllocator<std::pair<const " + kname + ", " + vname
+                + " > > > ";
+      } else {
+        cname = "std::map<" + kname + ", " + vname + "> ";
+      }
     } else if (ttype->is_set()) {
       t_set* tset = (t_set*)ttype;
-      cname = "std::set<" + type_name(tset->get_elem_type(), in_typedef) + "> ";
+      string ename = type_name(tset->get_elem_type(), in_typedef);
+      if (is_flat_container(ttype)) {
+        cname = "::apache::thrift::TFlatSet<" + ename;
+        if (gen_arena_) {
+          cname += ", std::less<" + ename + " >, ::apache::thrift::TArenaAllocator<" + ename
+                   + " > ";
+        }
+        cname += "> ";
+      } else if (is_hash_container(ttype)) {
+        cname = "::apache::thrift::THashSet<" + ename;
+        if (gen_arena_) {
+          cname += ", boost::hash<" + ename + " >, std::equal_to<" + ename + " >, "
+                   + "::apache::thrift::TArenaAllocator<" + ename + " > ";
+        }
+        cname += "> ";
+      } else if (gen_arena_) {
+        cname = "std::set<" + ename + ", std::less<" + ename + " >, "
+                + "::apache::thrift::TArenaAllocator<" + ename + " > > ";
+      } else {
+        cname = "std::set<" + ename + "> ";
+      }
     } else if (ttype->is_list()) {
       t_list* tlist = (t_list*)ttype;
-      cname = "std::vector<" + type_name(tlist->get_elem_type(), in_typedef) + "> ";
+      string ename = type_name(tlist->get_elem_type(), in_typedef);
+      if (gen_arena_) {
+        cname = "std::vector<" + ename + ", ::apache::thrift::TArenaAllocator<" + ename + " > > ";
+      } else {
+        cname = "std::vector<" + ename + "> ";
+      }
     }
 
     if (arg) {
@@ -4255,7 +5513,10 @@ string t_cpp_generator::base_type_name(t_base_type::t_base tbase) {
   case t_base_type::TYPE_VOID:
     return "void";
   case t_base_type::TYPE_STRING:
-    return "std::string";
+    if (gen_zero_copy_strings_) {
+      return "::apache::thrift::TStringView";
+    }
+    return gen_arena_ ? "::apache::thrift::TArenaString" : "std::string";
   case t_base_type::TYPE_BOOL:
     return "bool";
   case t_base_type::TYPE_I8:
@@ -4292,6 +5553,8 @@ string t_cpp_generator::declare_field(t_field* tfield,
   result += type_name(tfield->get_type());
   if (is_reference(tfield)) {
     result = "::apache::thrift::stdcxx::shared_ptr<" + result + ">";
+  } else if (is_lazy(tfield)) {
+    result = "::apache::thrift::TLazy<" + result + ">";
   }
   if (pointer) {
     result += "*";
@@ -4473,6 +5736,9 @@ THRIFT_REGISTER_GENERATOR(
     cpp,
     "C++",
     "    cob_style:       Generate \"Continuation OBject\"-style classes.\n"
+    "    future_style:    Generate a FutureClient class whose methods return a\n"
+    "                     ::apache::thrift::async::TFuture of the result, for use with a\n"
+    "                     TAsyncChannel such as TFramedClientChannel.\n"
     "    no_client_completion:\n"
     "                     Omit calls to completion__() in CobClient class.\n"
     "    no_default_operators:\n"
@@ -4483,4 +5749,27 @@ THRIFT_REGISTER_GENERATOR(
     "    moveable_types:  Generate move constructors and assignment operators.\n"
     "    no_ostream_operators:\n"
     "                     Omit generation of ostream definitions.\n"
-    "    no_skeleton:     Omits generation of skeleton.\n")
+    "    no_skeleton:     Omits generation of skeleton.\n"
+    "    zero_copy_strings:\n"
+    "                     Use ::apache::thrift::TStringView for string and binary fields,\n"
+    "                     referring to the transport's buffer instead of copying.\n"
+    "    arena:           Use ::apache::thrift::TArenaAllocator for strings and containers, so\n"
+    "                     objects built inside a TArenaScope, or given an arena, are allocated\n"
+    "                     from it. Processors build call arguments and results in the server's\n"
+    "                     per-request arena.\n"
+    "    reuse_objects:   Generate a __clear() method for structs, and keep the args and result\n"
+    "                     objects of processors for reuse, so their strings and containers\n"
+    "                     keep their memory. Included files need the same option.\n"
+    "    containers=flat: Use ::apache::thrift::TFlatMap and TFlatSet, sorted vectors, for maps\n"
+    "                     and sets.\n"
+    "    containers=hash: Use ::apache::thrift::THashMap and THashSet, open addressing hash\n"
+    "                     tables, for maps and sets with keys of base or enum types.\n"
+    "    tables:          Read and write structs through constant field tables and one shared\n"
+    "                     loop instead of unrolled methods, for smaller code. Structs can opt\n"
+    "                     in or out with the cpp.table annotation. These structs derive\n"
+    "                     from TBase non-virtually.\n"
+    "    serialized_size: Add serializedSize<Protocol>() to structs, which counts the bytes\n"
+    "                     that write() would write with the binary or compact protocol.\n"
+    "    ordered_reads:   Make read() expect fields in the order that write() writes them, and\n"
+    "                     only look fields up by id when they come in another order. This\n"
+    "                     pays off for structs that have most of their fields set.\n")
@@ -0,0 +1,127 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <thrift/TArena.h>
+
+#include <algorithm>
+#include <cstdlib>
+
+#if !defined(BOOST_NO_CXX11_THREAD_LOCAL)
+#define THRIFT_ARENA_TLS thread_local
+#elif defined(_MSC_VER)
+#define THRIFT_ARENA_TLS __declspec(thread)
+#else
+#define THRIFT_ARENA_TLS __thread
+#endif
+
+namespace apache {
+namespace thrift {
+
+namespace {
+THRIFT_ARENA_TLS TArena* currentArena = NULL;
+THRIFT_ARENA_TLS TArena* requestArena = NULL;
+}
+
+const size_t TArena::DEFAULT_BLOCK_SIZE;
+const size_t TArena::MAX_RETAINED_SIZE;
+const size_t TArena::ALIGNMENT;
+
+TArena::TArena(size_t blockSize)
+  : blocks_(NULL), pos_(NULL), end_(NULL), blockSize_(blockSize), used_(0), reserved_(0) {
+}
+
+TArena::~TArena() {
+  freeBlocks();
+}
+
+TArena* TArena::current() {
+  return currentArena;
+}
+
+void TArena::setCurrent(TArena* arena) {
+  currentArena = arena;
+}
+
+TArena* TArena::request() {
+  return requestArena;
+}
+
+void TArena::setRequest(TArena* arena) {
+  requestArena = arena;
+}
+
+void* TArena::allocateSlow(size_t size) {
+  // Oversized requests get a block of their own; otherwise start a new
+  // standard block and abandon the tail of the old one.
+  addBlock((std::max)(size, blockSize_));
+  void* result = pos_;
+  pos_ += size;
+  used_ += size;
+  return result;
+}
+
+void TArena::addBlock(size_t size) {
+  size_t header = (sizeof(Block) + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+  Block* block = static_cast<Block*>(std::malloc(header + size));
+  if (block == NULL) {
+    throw std::bad_alloc();
+  }
+  block->next = blocks_;
+  block->size = size;
+  blocks_ = block;
+  reserved_ += size;
+  pos_ = reinterpret_cast<char*>(block) + header;
+  end_ = pos_ + size;
+}
+
+void TArena::freeBlocks() {
+  while (blocks_ != NULL) {
+    Block* next = blocks_->next;
+    std::free(blocks_);
+    blocks_ = next;
+  }
+  pos_ = end_ = NULL;
+  reserved_ = 0;
+}
+
+void TArena::reset() {
+  if (scratch_.capacity() > MAX_RETAINED_SIZE) {
+    std::string().swap(scratch_);
+  }
+
+  size_t header = (sizeof(Block) + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+  if (blocks_ != NULL && blocks_->next == NULL
+      && blocks_->size <= (std::max)(blockSize_, MAX_RETAINED_SIZE)) {
+    // Everything fit in one block; rewind it.
+    pos_ = reinterpret_cast<char*>(blocks_) + header;
+    used_ = 0;
+    return;
+  }
+
+  // Replace the chain with a single block big enough for the last round.
+  bool hadBlocks = blocks_ != NULL;
+  size_t wanted = (std::max)((std::min)(used_, MAX_RETAINED_SIZE), blockSize_);
+  freeBlocks();
+  used_ = 0;
+  if (hadBlocks) {
+    addBlock(wanted);
+  }
+}
+}
+} // apache::thrift
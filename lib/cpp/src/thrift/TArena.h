@@ -0,0 +1,281 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _THRIFT_TARENA_H_
+#define _THRIFT_TARENA_H_ 1
+
+#include <boost/config.hpp>
+#include <boost/noncopyable.hpp>
+#include <cstddef>
+#include <limits>
+#include <new>
+#include <string>
+#include <utility>
+
+#ifndef BOOST_NO_CXX11_ALLOCATOR
+#include <type_traits>
+#endif
+
+namespace apache {
+namespace thrift {
+
+/**
+ * A bump-pointer memory arena.  Allocation is a pointer increment within a
+ * block; individual frees are no-ops and all memory is given back at once by
+ * reset().  After a reset the arena keeps a single block sized for the
+ * previous round, so a steady stream of similar requests does not touch the
+ * heap at all.
+ *
+ * Anything allocated from the arena must be destroyed before reset() is
+ * called.  A TArena is not thread safe; use one per connection or thread.
+ */
+class TArena : boost::noncopyable {
+public:
+  static const size_t DEFAULT_BLOCK_SIZE = 8 * 1024;
+
+  /// Upper bound on the block kept around across reset().
+  static const size_t MAX_RETAINED_SIZE = 1024 * 1024;
+
+  explicit TArena(size_t blockSize = DEFAULT_BLOCK_SIZE);
+
+  ~TArena();
+
+  /**
+   * Returns size bytes aligned for any fundamental type.
+   *
+   * @throws std::bad_alloc if a new block cannot be allocated
+   */
+  void* allocate(size_t size) {
+    size = (size + ALIGNMENT - 1) & ~(ALIGNMENT - 1);
+    if (size <= static_cast<size_t>(end_ - pos_)) {
+      void* result = pos_;
+      pos_ += size;
+      used_ += size;
+      return result;
+    }
+    return allocateSlow(size);
+  }
+
+  /**
+   * Releases everything allocated since the last reset.
+   */
+  void reset();
+
+  /// Bytes handed out since the last reset.
+  size_t bytesUsed() const { return used_; }
+
+  /// Bytes currently held from the heap.
+  size_t bytesReserved() const { return reserved_; }
+
+  /**
+   * A heap string owned by the arena that protocol code can read into before
+   * copying into arena memory.  It keeps its capacity across reset().
+   */
+  std::string& scratch() { return scratch_; }
+
+  /**
+   * The arena that default-constructed TArenaAllocators on this thread
+   * allocate from, or NULL if they use the heap.
+   */
+  static TArena* current();
+
+  /**
+   * The arena of the call being processed on this thread, or NULL.  Code
+   * generated with cpp:arena builds the arguments and result of the call in
+   * it; nothing else picks it up.
+   */
+  static TArena* request();
+
+private:
+  friend class TArenaScope;
+  friend class TRequestArenaScope;
+
+  static const size_t ALIGNMENT = 16;
+
+  struct Block {
+    Block* next;
+    size_t size;
+  };
+
+  static void setCurrent(TArena* arena);
+  static void setRequest(TArena* arena);
+
+  void* allocateSlow(size_t size);
+  void addBlock(size_t size);
+  void freeBlocks();
+
+  Block* blocks_;
+  char* pos_;
+  char* end_;
+  size_t blockSize_;
+  size_t used_;
+  size_t reserved_;
+  std::string scratch_;
+};
+
+/**
+ * Makes an arena current on this thread for the lifetime of the scope, and
+ * restores the previous one afterwards.  Passing NULL makes arena-aware
+ * containers created inside the scope use the heap, which is how data that
+ * must outlive the arena is copied out of it.
+ */
+class TArenaScope : boost::noncopyable {
+public:
+  explicit TArenaScope(TArena* arena) : previous_(TArena::current()) {
+    TArena::setCurrent(arena);
+  }
+
+  ~TArenaScope() { TArena::setCurrent(previous_); }
+
+private:
+  TArena* previous_;
+};
+
+/**
+ * Makes an arena the request arena of this thread for the lifetime of the
+ * scope.  Servers enter one around every call and reset the arena after
+ * it.  Unlike a TArenaScope it leaves alone the containers that a handler
+ * builds, which may well outlive the call.
+ */
+class TRequestArenaScope : boost::noncopyable {
+public:
+  explicit TRequestArenaScope(TArena* arena) : previous_(TArena::request()) {
+    TArena::setRequest(arena);
+  }
+
+  ~TRequestArenaScope() { TArena::setRequest(previous_); }
+
+private:
+  TArena* previous_;
+};
+
+/**
+ * STL allocator that draws from a TArena.  A default-constructed allocator
+ * binds to the thread's current arena (see TArenaScope) and keeps using it
+ * for its whole life; with no current arena it uses the heap.  Generated
+ * processors give the arguments and result of a call the request arena
+ * explicitly, and make it current only while they read the arguments, so
+ * containers built by the handler come from the heap.
+ */
+template <typename T>
+class TArenaAllocator {
+public:
+  typedef T value_type;
+  typedef T* pointer;
+  typedef const T* const_pointer;
+  typedef T& reference;
+  typedef const T& const_reference;
+  typedef std::size_t size_type;
+  typedef std::ptrdiff_t difference_type;
+
+#ifndef BOOST_NO_CXX11_ALLOCATOR
+  // A container moved into keeps its own arena, or the heap, and takes the
+  // elements over one by one if the other one's is different: a handler
+  // may move a field of a request into something that outlives the arena.
+  typedef std::false_type propagate_on_container_move_assignment;
+  // Swapping takes the memory and the allocators along.  Containers of
+  // different arenas are swapped with arenaSwap() instead.
+  typedef std::true_type propagate_on_container_swap;
+#endif
+
+  template <typename U>
+  struct rebind {
+    typedef TArenaAllocator<U> other;
+  };
+
+  TArenaAllocator() : arena_(TArena::current()) {}
+
+  explicit TArenaAllocator(TArena* arena) : arena_(arena) {}
+
+  template <typename U>
+  TArenaAllocator(const TArenaAllocator<U>& that) : arena_(that.arena()) {}
+
+  TArena* arena() const { return arena_; }
+
+  pointer address(reference x) const { return &x; }
+  const_pointer address(const_reference x) const { return &x; }
+
+  pointer allocate(size_type n, const void* /* hint */ = 0) {
+    if (n > max_size()) {
+      throw std::bad_alloc();
+    }
+    if (arena_ != NULL) {
+      return static_cast<pointer>(arena_->allocate(n * sizeof(T)));
+    }
+    return static_cast<pointer>(::operator new(n * sizeof(T)));
+  }
+
+  void deallocate(pointer p, size_type /* n */) {
+    if (arena_ == NULL) {
+      ::operator delete(p);
+    }
+  }
+
+  size_type max_size() const { return (std::numeric_limits<size_type>::max)() / sizeof(T); }
+
+#ifdef BOOST_NO_CXX11_ALLOCATOR
+  void construct(pointer p, const T& value) { new (static_cast<void*>(p)) T(value); }
+  void destroy(pointer p) { p->~T(); }
+#endif
+
+  /// Copies bind to whatever arena is current where the copy is made.
+  TArenaAllocator select_on_container_copy_construction() const { return TArenaAllocator(); }
+
+private:
+  TArena* arena_;
+};
+
+template <typename T, typename U>
+inline bool operator==(const TArenaAllocator<T>& a, const TArenaAllocator<U>& b) {
+  return a.arena() == b.arena();
+}
+
+template <typename T, typename U>
+inline bool operator!=(const TArenaAllocator<T>& a, const TArenaAllocator<U>& b) {
+  return a.arena() != b.arena();
+}
+
+/// String type used for string and binary fields by cpp:arena code.
+typedef std::basic_string<char, std::char_traits<char>, TArenaAllocator<char> > TArenaString;
+
+/**
+ * Swaps the contents of two strings or containers that use TArenaAllocator
+ * and leaves each with its own allocator, so neither ends up with memory
+ * of an arena it may outlive.  The swap() of cpp:arena structs uses it.
+ */
+template <typename Container>
+void arenaSwap(Container& a, Container& b) {
+  if (a.get_allocator() == b.get_allocator()) {
+    a.swap(b);
+    return;
+  }
+#ifndef BOOST_NO_CXX11_RVALUE_REFERENCES
+  Container tmp(std::move(a));
+  a = std::move(b);
+  b = std::move(tmp);
+#else
+  Container tmp(a);
+  a = b;
+  b = tmp;
+#endif
+}
+}
+} // apache::thrift
+
+#endif // #ifndef _THRIFT_TARENA_H_
@@ -0,0 +1,475 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _THRIFT_TFLATMAP_H_
+#define _THRIFT_TFLATMAP_H_ 1
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <thrift/TToString.h>
+
+namespace apache {
+namespace thrift {
+
+/**
+ * A map kept as a vector of pairs sorted by key, which is what maps are
+ * generated as with the cpp:containers=flat option.  Lookups are binary
+ * searches over contiguous memory, iteration is a walk over an array, and
+ * the whole map is one allocation instead of one per element.  Inserting or
+ * erasing in the middle moves the elements behind it, so a map that is
+ * built one random key at a time should be built with append() and sort(),
+ * the way generated code reads maps.
+ *
+ * Elements are std::pair<K, V>, not std::pair<const K, V>, so that they can
+ * be moved around in the vector; changing a key through an iterator breaks
+ * the order.
+ */
+template <typename K,
+          typename V,
+          typename Compare = std::less<K>,
+          typename Alloc = std::allocator<std::pair<K, V> > >
+class TFlatMap {
+public:
+  typedef K key_type;
+  typedef V mapped_type;
+  typedef std::pair<K, V> value_type;
+  typedef Compare key_compare;
+  typedef Alloc allocator_type;
+  typedef std::vector<value_type, Alloc> container_type;
+  typedef typename container_type::size_type size_type;
+  typedef typename container_type::difference_type difference_type;
+  typedef typename container_type::reference reference;
+  typedef typename container_type::const_reference const_reference;
+  typedef typename container_type::iterator iterator;
+  typedef typename container_type::const_iterator const_iterator;
+  typedef typename container_type::reverse_iterator reverse_iterator;
+  typedef typename container_type::const_reverse_iterator const_reverse_iterator;
+
+  TFlatMap() {}
+
+  explicit TFlatMap(const Compare& comp, const Alloc& alloc = Alloc())
+    : elems_(alloc), comp_(comp) {}
+
+  template <typename InputIterator>
+  TFlatMap(InputIterator first, InputIterator last) {
+    insert(first, last);
+  }
+
+  iterator begin() { return elems_.begin(); }
+  const_iterator begin() const { return elems_.begin(); }
+  iterator end() { return elems_.end(); }
+  const_iterator end() const { return elems_.end(); }
+  reverse_iterator rbegin() { return elems_.rbegin(); }
+  const_reverse_iterator rbegin() const { return elems_.rbegin(); }
+  reverse_iterator rend() { return elems_.rend(); }
+  const_reverse_iterator rend() const { return elems_.rend(); }
+
+  bool empty() const { return elems_.empty(); }
+  size_type size() const { return elems_.size(); }
+  size_type max_size() const { return elems_.max_size(); }
+  size_type capacity() const { return elems_.capacity(); }
+  void reserve(size_type n) { elems_.reserve(n); }
+  void clear() { elems_.clear(); }
+
+  void swap(TFlatMap& that) {
+    elems_.swap(that.elems_);
+    std::swap(comp_, that.comp_);
+  }
+
+  key_compare key_comp() const { return comp_; }
+  allocator_type get_allocator() const { return elems_.get_allocator(); }
+
+  V& operator[](const K& key) {
+    iterator it = lower_bound(key);
+    if (it == elems_.end() || comp_(key, it->first)) {
+      it = elems_.insert(it, value_type(key, V()));
+    }
+    return it->second;
+  }
+
+  V& at(const K& key) {
+    iterator it = find(key);
+    if (it == elems_.end()) {
+      throw std::out_of_range("TFlatMap::at");
+    }
+    return it->second;
+  }
+
+  const V& at(const K& key) const {
+    const_iterator it = find(key);
+    if (it == elems_.end()) {
+      throw std::out_of_range("TFlatMap::at");
+    }
+    return it->second;
+  }
+
+  std::pair<iterator, bool> insert(const value_type& value) {
+    iterator it = lower_bound(value.first);
+    if (it != elems_.end() && !comp_(value.first, it->first)) {
+      return std::make_pair(it, false);
+    }
+    return std::make_pair(elems_.insert(it, value), true);
+  }
+
+  /**
+   * Inserts right before hint without a search if that keeps the order,
+   * which makes building a map in key order linear.
+   */
+  iterator insert(iterator hint, const value_type& value) {
+    if ((hint == elems_.end() || comp_(value.first, hint->first))
+        && (hint == elems_.begin() || comp_((hint - 1)->first, value.first))) {
+      return elems_.insert(hint, value);
+    }
+    return insert(value).first;
+  }
+
+  template <typename InputIterator>
+  void insert(InputIterator first, InputIterator last) {
+    for (; first != last; ++first) {
+      insert(*first);
+    }
+  }
+
+  iterator erase(iterator pos) { return elems_.erase(pos); }
+
+  iterator erase(iterator first, iterator last) { return elems_.erase(first, last); }
+
+  size_type erase(const K& key) {
+    iterator it = find(key);
+    if (it == elems_.end()) {
+      return 0;
+    }
+    elems_.erase(it);
+    return 1;
+  }
+
+  iterator find(const K& key) {
+    iterator it = lower_bound(key);
+    return it != elems_.end() && !comp_(key, it->first) ? it : elems_.end();
+  }
+
+  const_iterator find(const K& key) const {
+    const_iterator it = lower_bound(key);
+    return it != elems_.end() && !comp_(key, it->first) ? it : elems_.end();
+  }
+
+  size_type count(const K& key) const { return find(key) != elems_.end() ? 1 : 0; }
+
+  iterator lower_bound(const K& key) {
+    return std::lower_bound(elems_.begin(), elems_.end(), key, KeyCompare(comp_));
+  }
+
+  const_iterator lower_bound(const K& key) const {
+    return std::lower_bound(elems_.begin(), elems_.end(), key, KeyCompare(comp_));
+  }
+
+  iterator upper_bound(const K& key) {
+    return std::upper_bound(elems_.begin(), elems_.end(), key, KeyCompare(comp_));
+  }
+
+  const_iterator upper_bound(const K& key) const {
+    return std::upper_bound(elems_.begin(), elems_.end(), key, KeyCompare(comp_));
+  }
+
+  std::pair<iterator, iterator> equal_range(const K& key) {
+    iterator first = lower_bound(key);
+    iterator last = first;
+    if (last != elems_.end() && !comp_(key, last->first)) {
+      ++last;
+    }
+    return std::make_pair(first, last);
+  }
+
+  std::pair<const_iterator, const_iterator> equal_range(const K& key) const {
+    const_iterator first = lower_bound(key);
+    const_iterator last = first;
+    if (last != elems_.end() && !comp_(key, last->first)) {
+      ++last;
+    }
+    return std::make_pair(first, last);
+  }
+
+  /**
+   * Adds an element at the end, without looking for its key, and returns
+   * its value.  The map is out of order until sort() is called; only
+   * append(), reserve() and sort() may be used in between.
+   */
+  V& append(const K& key) {
+    elems_.push_back(value_type(key, V()));
+    return elems_.back().second;
+  }
+
+  /**
+   * Puts the elements added by append() in order.  A key appended more than
+   * once keeps its last value, as it would through operator[].  Elements
+   * appended in order, as everything written from an ordered map is, are
+   * only checked.
+   */
+  void sort() {
+    if (std::adjacent_find(elems_.begin(), elems_.end(), NotLess(comp_)) == elems_.end()) {
+      return;
+    }
+    std::stable_sort(elems_.begin(), elems_.end(), ElemCompare(comp_));
+    iterator out = elems_.begin();
+    for (iterator it = elems_.begin(); it != elems_.end();) {
+      iterator next = it + 1;
+      while (next != elems_.end() && !comp_(it->first, next->first)) {
+        it = next++;
+      }
+      if (out != it) {
+        using std::swap;
+        swap(out->first, it->first);
+        swap(out->second, it->second);
+      }
+      ++out;
+      it = next;
+    }
+    elems_.erase(out, elems_.end());
+  }
+
+  bool operator==(const TFlatMap& that) const { return elems_ == that.elems_; }
+  bool operator!=(const TFlatMap& that) const { return elems_ != that.elems_; }
+  bool operator<(const TFlatMap& that) const { return elems_ < that.elems_; }
+
+private:
+  class KeyCompare {
+  public:
+    explicit KeyCompare(const Compare& comp) : comp_(comp) {}
+    bool operator()(const value_type& a, const K& b) const { return comp_(a.first, b); }
+    bool operator()(const K& a, const value_type& b) const { return comp_(a, b.first); }
+
+  private:
+    Compare comp_;
+  };
+
+  class ElemCompare {
+  public:
+    explicit ElemCompare(const Compare& comp) : comp_(comp) {}
+    bool operator()(const value_type& a, const value_type& b) const {
+      return comp_(a.first, b.first);
+    }
+
+  private:
+    Compare comp_;
+  };
+
+  class NotLess {
+  public:
+    explicit NotLess(const Compare& comp) : comp_(comp) {}
+    bool operator()(const value_type& a, const value_type& b) const {
+      return !comp_(a.first, b.first);
+    }
+
+  private:
+    Compare comp_;
+  };
+
+  container_type elems_;
+  Compare comp_;
+};
+
+/**
+ * A set kept as a sorted vector; the set counterpart of TFlatMap, generated
+ * for sets with the cpp:containers=flat option.
+ */
+template <typename T, typename Compare = std::less<T>, typename Alloc = std::allocator<T> >
+class TFlatSet {
+public:
+  typedef T key_type;
+  typedef T value_type;
+  typedef Compare key_compare;
+  typedef Compare value_compare;
+  typedef Alloc allocator_type;
+  typedef std::vector<T, Alloc> container_type;
+  typedef typename container_type::size_type size_type;
+  typedef typename container_type::difference_type difference_type;
+  typedef typename container_type::const_reference reference;
+  typedef typename container_type::const_reference const_reference;
+  typedef typename container_type::const_iterator iterator;
+  typedef typename container_type::const_iterator const_iterator;
+  typedef typename container_type::const_reverse_iterator reverse_iterator;
+  typedef typename container_type::const_reverse_iterator const_reverse_iterator;
+
+  TFlatSet() {}
+
+  explicit TFlatSet(const Compare& comp, const Alloc& alloc = Alloc())
+    : elems_(alloc), comp_(comp) {}
+
+  template <typename InputIterator>
+  TFlatSet(InputIterator first, InputIterator last) {
+    insert(first, last);
+  }
+
+  const_iterator begin() const { return elems_.begin(); }
+  const_iterator end() const { return elems_.end(); }
+  const_reverse_iterator rbegin() const { return elems_.rbegin(); }
+  const_reverse_iterator rend() const { return elems_.rend(); }
+
+  bool empty() const { return elems_.empty(); }
+  size_type size() const { return elems_.size(); }
+  size_type max_size() const { return elems_.max_size(); }
+  size_type capacity() const { return elems_.capacity(); }
+  void reserve(size_type n) { elems_.reserve(n); }
+  void clear() { elems_.clear(); }
+
+  void swap(TFlatSet& that) {
+    elems_.swap(that.elems_);
+    std::swap(comp_, that.comp_);
+  }
+
+  key_compare key_comp() const { return comp_; }
+  value_compare value_comp() const { return comp_; }
+  allocator_type get_allocator() const { return elems_.get_allocator(); }
+
+  std::pair<iterator, bool> insert(const T& value) {
+    typename container_type::iterator it = mutableLowerBound(value);
+    if (it != elems_.end() && !comp_(value, *it)) {
+      return std::make_pair(iterator(it), false);
+    }
+    return std::make_pair(iterator(elems_.insert(it, value)), true);
+  }
+
+  template <typename InputIterator>
+  void insert(InputIterator first, InputIterator last) {
+    for (; first != last; ++first) {
+      insert(*first);
+    }
+  }
+
+  iterator erase(iterator pos) { return elems_.erase(elems_.begin() + (pos - begin())); }
+
+  iterator erase(iterator first, iterator last) {
+    return elems_.erase(elems_.begin() + (first - begin()), elems_.begin() + (last - begin()));
+  }
+
+  size_type erase(const T& value) {
+    typename container_type::iterator it = mutableLowerBound(value);
+    if (it == elems_.end() || comp_(value, *it)) {
+      return 0;
+    }
+    elems_.erase(it);
+    return 1;
+  }
+
+  const_iterator find(const T& value) const {
+    const_iterator it = lower_bound(value);
+    return it != elems_.end() && !comp_(value, *it) ? it : elems_.end();
+  }
+
+  size_type count(const T& value) const { return find(value) != elems_.end() ? 1 : 0; }
+
+  const_iterator lower_bound(const T& value) const {
+    return std::lower_bound(elems_.begin(), elems_.end(), value, comp_);
+  }
+
+  const_iterator upper_bound(const T& value) const {
+    return std::upper_bound(elems_.begin(), elems_.end(), value, comp_);
+  }
+
+  std::pair<const_iterator, const_iterator> equal_range(const T& value) const {
+    const_iterator first = lower_bound(value);
+    const_iterator last = first;
+    if (last != elems_.end() && !comp_(value, *last)) {
+      ++last;
+    }
+    return std::make_pair(first, last);
+  }
+
+  /**
+   * Adds an element at the end, without looking for it.  The set is out of
+   * order until sort() is called; only append(), reserve() and sort() may
+   * be used in between.
+   */
+  void append(const T& value) { elems_.push_back(value); }
+
+  /**
+   * Puts the elements added by append() in order and drops duplicates.
+   * Elements appended in order are only checked.
+   */
+  void sort() {
+    if (std::adjacent_find(elems_.begin(), elems_.end(), NotLess(comp_)) == elems_.end()) {
+      return;
+    }
+    std::sort(elems_.begin(), elems_.end(), comp_);
+    elems_.erase(std::unique(elems_.begin(), elems_.end(), Equivalent(comp_)), elems_.end());
+  }
+
+  bool operator==(const TFlatSet& that) const { return elems_ == that.elems_; }
+  bool operator!=(const TFlatSet& that) const { return elems_ != that.elems_; }
+  bool operator<(const TFlatSet& that) const { return elems_ < that.elems_; }
+
+private:
+  class NotLess {
+  public:
+    explicit NotLess(const Compare& comp) : comp_(comp) {}
+    bool operator()(const T& a, const T& b) const { return !comp_(a, b); }
+
+  private:
+    Compare comp_;
+  };
+
+  class Equivalent {
+  public:
+    explicit Equivalent(const Compare& comp) : comp_(comp) {}
+    bool operator()(const T& a, const T& b) const { return !comp_(a, b) && !comp_(b, a); }
+
+  private:
+    Compare comp_;
+  };
+
+  typename container_type::iterator mutableLowerBound(const T& value) {
+    return std::lower_bound(elems_.begin(), elems_.end(), value, comp_);
+  }
+
+  container_type elems_;
+  Compare comp_;
+};
+
+template <typename K, typename V, typename C, typename A>
+void swap(TFlatMap<K, V, C, A>& a, TFlatMap<K, V, C, A>& b) {
+  a.swap(b);
+}
+
+template <typename T, typename C, typename A>
+void swap(TFlatSet<T, C, A>& a, TFlatSet<T, C, A>& b) {
+  a.swap(b);
+}
+
+template <typename K, typename V, typename C, typename A>
+std::string to_string(const TFlatMap<K, V, C, A>& m) {
+  std::ostringstream o;
+  o << "{" << to_string(m.begin(), m.end()) << "}";
+  return o.str();
+}
+
+template <typename T, typename C, typename A>
+std::string to_string(const TFlatSet<T, C, A>& s) {
+  std::ostringstream o;
+  o << "{" << to_string(s.begin(), s.end()) << "}";
+  return o.str();
+}
+}
+} // apache::thrift
+
+#endif // #ifndef _THRIFT_TFLATMAP_H_
@@ -0,0 +1,594 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _THRIFT_THASHMAP_H_
+#define _THRIFT_THASHMAP_H_ 1
+
+#include <algorithm>
+#include <functional>
+#include <memory>
+#include <stdexcept>
+#include <utility>
+#include <vector>
+
+#include <boost/functional/hash.hpp>
+
+#include <thrift/TStringView.h>
+#include <thrift/TToString.h>
+#include <thrift/Thrift.h>
+
+namespace apache {
+namespace thrift {
+
+inline std::size_t hash_value(const TStringView& str) {
+  return boost::hash_range(str.begin(), str.end());
+}
+
+namespace detail {
+
+/**
+ * The open addressing index shared by THashMap and THashSet.  Each slot is
+ * 0 when free, and otherwise holds 32 bits of the element's hash above the
+ * element's position in the entry vector plus one.  The table is a power of
+ * two in size, at most three quarters full, and probed linearly from the
+ * slot picked by the top bits of the hash; comparing the stored hash bits
+ * first means keys are almost only compared when they are equal.
+ */
+class THashIndex {
+public:
+  static const uint32_t npos = 0xffffffffu;
+
+  THashIndex() : bits_(0) {}
+
+  void clear() { std::fill(slots_.begin(), slots_.end(), static_cast<uint64_t>(0)); }
+
+  void swap(THashIndex& that) {
+    slots_.swap(that.slots_);
+    std::swap(bits_, that.bits_);
+  }
+
+  /// Spreads the bits of a std::size_t hash over 32 bits.
+  static uint32_t tag(std::size_t hash) {
+    return static_cast<uint32_t>((static_cast<uint64_t>(hash) * 0x9E3779B97F4A7C15ULL) >> 32);
+  }
+
+  /// Grows the table, if needed, to hold entries entries.
+  void reserve(std::size_t entries) {
+    if (entries * 4 > slots_.size() * 3) {
+      rehash(entries);
+    }
+  }
+
+  /**
+   * Returns the entry with this tag for which matches(entry) is true, or
+   * npos; slot is set to where it is, or to the free slot that ended the
+   * search.
+   */
+  template <typename Matches>
+  uint32_t find(uint32_t tag, const Matches& matches, std::size_t& slot) const {
+    if (slots_.empty()) {
+      return npos;
+    }
+    std::size_t mask = slots_.size() - 1;
+    for (slot = home(tag);; slot = (slot + 1) & mask) {
+      uint64_t s = slots_[slot];
+      if (s == 0) {
+        return npos;
+      }
+      if (static_cast<uint32_t>(s >> 32) == tag) {
+        uint32_t entry = static_cast<uint32_t>(s) - 1;
+        if (matches(entry)) {
+          return entry;
+        }
+      }
+    }
+  }
+
+  /// Adds entry, which must not be in the table yet.
+  void insert(uint32_t tag, uint32_t entry) {
+    std::size_t mask = slots_.size() - 1;
+    std::size_t slot = home(tag);
+    while (slots_[slot] != 0) {
+      slot = (slot + 1) & mask;
+    }
+    slots_[slot] = (static_cast<uint64_t>(tag) << 32) | (entry + 1);
+  }
+
+  /// The slot holding entry, which must be in the table with this tag.
+  std::size_t slotOf(uint32_t tag, uint32_t entry) const {
+    std::size_t mask = slots_.size() - 1;
+    std::size_t slot = home(tag);
+    while (static_cast<uint32_t>(slots_[slot]) != entry + 1) {
+      slot = (slot + 1) & mask;
+    }
+    return slot;
+  }
+
+  /// Points the slot to another entry.
+  void move(std::size_t slot, uint32_t entry) {
+    slots_[slot] = (slots_[slot] & 0xffffffff00000000ULL) | (entry + 1);
+  }
+
+  /**
+   * Frees a slot, and shifts back the slots after it that would otherwise
+   * no longer be found, so that no tombstones are needed.
+   */
+  void remove(std::size_t slot) {
+    std::size_t mask = slots_.size() - 1;
+    slots_[slot] = 0;
+    for (std::size_t next = (slot + 1) & mask; slots_[next] != 0; next = (next + 1) & mask) {
+      std::size_t want = home(static_cast<uint32_t>(slots_[next] >> 32));
+      // The entry at next can move to slot unless its home is in (slot, next].
+      bool stays = slot <= next ? (slot < want && want <= next) : (slot < want || want <= next);
+      if (!stays) {
+        slots_[slot] = slots_[next];
+        slots_[next] = 0;
+        slot = next;
+      }
+    }
+  }
+
+private:
+  std::size_t home(uint32_t tag) const { return bits_ == 0 ? 0 : tag >> (32 - bits_); }
+
+  void rehash(std::size_t entries) {
+    unsigned bits = 3;
+    while ((static_cast<std::size_t>(1) << bits) * 3 < entries * 4) {
+      ++bits;
+    }
+    std::vector<uint64_t> old(static_cast<std::size_t>(1) << bits, 0);
+    old.swap(slots_);
+    bits_ = bits;
+    for (std::size_t i = 0; i < old.size(); ++i) {
+      if (old[i] != 0) {
+        insert(static_cast<uint32_t>(old[i] >> 32), static_cast<uint32_t>(old[i]) - 1);
+      }
+    }
+  }
+
+  std::vector<uint64_t> slots_;
+  unsigned bits_;
+};
+}
+
+/**
+ * An unordered map, which is what maps with keys of base or enum types are
+ * generated as with the cpp:containers=hash option.  The elements are kept
+ * in a vector in the order they were inserted, and found through an open
+ * addressing table of 8 byte slots next to it: a lookup is a hash and, most
+ * of the time, one probe and one key comparison, and reading a map from the
+ * wire after reserve() allocates twice, not once per element.
+ *
+ * Erasing an element moves the last element into its place.  Iterators and
+ * references are invalidated by insertions that grow the vector, and by
+ * erasing.
+ */
+template <typename K,
+          typename V,
+          typename Hash = boost::hash<K>,
+          typename Pred = std::equal_to<K>,
+          typename Alloc = std::allocator<std::pair<K, V> > >
+class THashMap {
+public:
+  typedef K key_type;
+  typedef V mapped_type;
+  typedef std::pair<K, V> value_type;
+  typedef Hash hasher;
+  typedef Pred key_equal;
+  typedef Alloc allocator_type;
+  typedef std::vector<value_type, Alloc> container_type;
+  typedef typename container_type::size_type size_type;
+  typedef typename container_type::difference_type difference_type;
+  typedef typename container_type::reference reference;
+  typedef typename container_type::const_reference const_reference;
+  typedef typename container_type::iterator iterator;
+  typedef typename container_type::const_iterator const_iterator;
+
+  THashMap() {}
+
+  explicit THashMap(const Hash& hash, const Pred& eq = Pred(), const Alloc& alloc = Alloc())
+    : elems_(alloc), hash_(hash), eq_(eq) {}
+
+  template <typename InputIterator>
+  THashMap(InputIterator first, InputIterator last) {
+    insert(first, last);
+  }
+
+  iterator begin() { return elems_.begin(); }
+  const_iterator begin() const { return elems_.begin(); }
+  iterator end() { return elems_.end(); }
+  const_iterator end() const { return elems_.end(); }
+
+  bool empty() const { return elems_.empty(); }
+  size_type size() const { return elems_.size(); }
+  size_type max_size() const { return elems_.max_size(); }
+
+  /// Makes room for n elements, in the vector and in the table.
+  void reserve(size_type n) {
+    elems_.reserve(n);
+    index_.reserve(n);
+  }
+
+  /// Removes all elements, keeping the memory for as many.
+  void clear() {
+    elems_.clear();
+    index_.clear();
+  }
+
+  void swap(THashMap& that) {
+    elems_.swap(that.elems_);
+    index_.swap(that.index_);
+    std::swap(hash_, that.hash_);
+    std::swap(eq_, that.eq_);
+  }
+
+  hasher hash_function() const { return hash_; }
+  key_equal key_eq() const { return eq_; }
+  allocator_type get_allocator() const { return elems_.get_allocator(); }
+
+  V& operator[](const K& key) {
+    uint32_t tag = detail::THashIndex::tag(hash_(key));
+    std::size_t slot;
+    uint32_t entry = index_.find(tag, Matches(*this, key), slot);
+    if (entry == detail::THashIndex::npos) {
+      entry = add(tag, value_type(key, V()));
+    }
+    return elems_[entry].second;
+  }
+
+  V& at(const K& key) {
+    iterator it = find(key);
+    if (it == elems_.end()) {
+      throw std::out_of_range("THashMap::at");
+    }
+    return it->second;
+  }
+
+  const V& at(const K& key) const {
+    const_iterator it = find(key);
+    if (it == elems_.end()) {
+      throw std::out_of_range("THashMap::at");
+    }
+    return it->second;
+  }
+
+  std::pair<iterator, bool> insert(const value_type& value) {
+    uint32_t tag = detail::THashIndex::tag(hash_(value.first));
+    std::size_t slot;
+    uint32_t entry = index_.find(tag, Matches(*this, value.first), slot);
+    if (entry != detail::THashIndex::npos) {
+      return std::make_pair(elems_.begin() + entry, false);
+    }
+    return std::make_pair(elems_.begin() + add(tag, value), true);
+  }
+
+  template <typename InputIterator>
+  void insert(InputIterator first, InputIterator last) {
+    for (; first != last; ++first) {
+      insert(*first);
+    }
+  }
+
+  iterator find(const K& key) {
+    uint32_t entry = lookup(key);
+    return entry == detail::THashIndex::npos ? elems_.end() : elems_.begin() + entry;
+  }
+
+  const_iterator find(const K& key) const {
+    uint32_t entry = lookup(key);
+    return entry == detail::THashIndex::npos ? elems_.end() : elems_.begin() + entry;
+  }
+
+  size_type count(const K& key) const { return lookup(key) == detail::THashIndex::npos ? 0 : 1; }
+
+  size_type erase(const K& key) {
+    uint32_t tag = detail::THashIndex::tag(hash_(key));
+    std::size_t slot;
+    uint32_t entry = index_.find(tag, Matches(*this, key), slot);
+    if (entry == detail::THashIndex::npos) {
+      return 0;
+    }
+    remove(slot, entry);
+    return 1;
+  }
+
+  /// Returns an iterator to the element moved into pos, or end().
+  iterator erase(iterator pos) {
+    uint32_t entry = static_cast<uint32_t>(pos - elems_.begin());
+    uint32_t tag = detail::THashIndex::tag(hash_(pos->first));
+    remove(index_.slotOf(tag, entry), entry);
+    return elems_.begin() + entry;
+  }
+
+  /// Equal if they hold the same elements, in any order.
+  bool operator==(const THashMap& that) const {
+    if (elems_.size() != that.elems_.size()) {
+      return false;
+    }
+    for (const_iterator it = elems_.begin(); it != elems_.end(); ++it) {
+      const_iterator other = that.find(it->first);
+      if (other == that.end() || !(other->second == it->second)) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool operator!=(const THashMap& that) const { return !(*this == that); }
+
+  /**
+   * Orders by size, and then by the elements in key order, so that maps
+   * that are equal compare equivalent.  This sorts copies of both maps; it
+   * is meant for the rare map used as a key of an ordered container.
+   */
+  bool operator<(const THashMap& that) const {
+    if (elems_.size() != that.elems_.size()) {
+      return elems_.size() < that.elems_.size();
+    }
+    std::vector<value_type> a(elems_.begin(), elems_.end());
+    std::vector<value_type> b(that.elems_.begin(), that.elems_.end());
+    std::sort(a.begin(), a.end());
+    std::sort(b.begin(), b.end());
+    return a < b;
+  }
+
+private:
+  class Matches {
+  public:
+    Matches(const THashMap& map, const K& key) : map_(map), key_(key) {}
+    bool operator()(uint32_t entry) const { return map_.eq_(map_.elems_[entry].first, key_); }
+
+  private:
+    const THashMap& map_;
+    const K& key_;
+  };
+
+  uint32_t lookup(const K& key) const {
+    std::size_t slot;
+    return index_.find(detail::THashIndex::tag(hash_(key)), Matches(*this, key), slot);
+  }
+
+  uint32_t add(uint32_t tag, const value_type& value) {
+    index_.reserve(elems_.size() + 1);
+    uint32_t entry = static_cast<uint32_t>(elems_.size());
+    elems_.push_back(value);
+    index_.insert(tag, entry);
+    return entry;
+  }
+
+  /// Removes the entry in slot, and moves the last entry into its place.
+  void remove(std::size_t slot, uint32_t entry) {
+    index_.remove(slot);
+    uint32_t last = static_cast<uint32_t>(elems_.size() - 1);
+    if (entry != last) {
+      uint32_t tag = detail::THashIndex::tag(hash_(elems_[last].first));
+      index_.move(index_.slotOf(tag, last), entry);
+      using std::swap;
+      swap(elems_[entry].first, elems_[last].first);
+      swap(elems_[entry].second, elems_[last].second);
+    }
+    elems_.pop_back();
+  }
+
+  container_type elems_;
+  detail::THashIndex index_;
+  Hash hash_;
+  Pred eq_;
+};
+
+/**
+ * An unordered set; the set counterpart of THashMap, generated for sets of
+ * base or enum types with the cpp:containers=hash option.
+ */
+template <typename T,
+          typename Hash = boost::hash<T>,
+          typename Pred = std::equal_to<T>,
+          typename Alloc = std::allocator<T> >
+class THashSet {
+public:
+  typedef T key_type;
+  typedef T value_type;
+  typedef Hash hasher;
+  typedef Pred key_equal;
+  typedef Alloc allocator_type;
+  typedef std::vector<T, Alloc> container_type;
+  typedef typename container_type::size_type size_type;
+  typedef typename container_type::difference_type difference_type;
+  typedef typename container_type::const_reference reference;
+  typedef typename container_type::const_reference const_reference;
+  typedef typename container_type::const_iterator iterator;
+  typedef typename container_type::const_iterator const_iterator;
+
+  THashSet() {}
+
+  explicit THashSet(const Hash& hash, const Pred& eq = Pred(), const Alloc& alloc = Alloc())
+    : elems_(alloc), hash_(hash), eq_(eq) {}
+
+  template <typename InputIterator>
+  THashSet(InputIterator first, InputIterator last) {
+    insert(first, last);
+  }
+
+  const_iterator begin() const { return elems_.begin(); }
+  const_iterator end() const { return elems_.end(); }
+
+  bool empty() const { return elems_.empty(); }
+  size_type size() const { return elems_.size(); }
+  size_type max_size() const { return elems_.max_size(); }
+
+  /// Makes room for n elements, in the vector and in the table.
+  void reserve(size_type n) {
+    elems_.reserve(n);
+    index_.reserve(n);
+  }
+
+  /// Removes all elements, keeping the memory for as many.
+  void clear() {
+    elems_.clear();
+    index_.clear();
+  }
+
+  void swap(THashSet& that) {
+    elems_.swap(that.elems_);
+    index_.swap(that.index_);
+    std::swap(hash_, that.hash_);
+    std::swap(eq_, that.eq_);
+  }
+
+  hasher hash_function() const { return hash_; }
+  key_equal key_eq() const { return eq_; }
+  allocator_type get_allocator() const { return elems_.get_allocator(); }
+
+  std::pair<iterator, bool> insert(const T& value) {
+    uint32_t tag = detail::THashIndex::tag(hash_(value));
+    std::size_t slot;
+    uint32_t entry = index_.find(tag, Matches(*this, value), slot);
+    if (entry == detail::THashIndex::npos) {
+      index_.reserve(elems_.size() + 1);
+      entry = static_cast<uint32_t>(elems_.size());
+      elems_.push_back(value);
+      index_.insert(tag, entry);
+      return std::make_pair(begin() + entry, true);
+    }
+    return std::make_pair(begin() + entry, false);
+  }
+
+  template <typename InputIterator>
+  void insert(InputIterator first, InputIterator last) {
+    for (; first != last; ++first) {
+      insert(*first);
+    }
+  }
+
+  const_iterator find(const T& value) const {
+    uint32_t entry = lookup(value);
+    return entry == detail::THashIndex::npos ? end() : begin() + entry;
+  }
+
+  size_type count(const T& value) const {
+    return lookup(value) == detail::THashIndex::npos ? 0 : 1;
+  }
+
+  size_type erase(const T& value) {
+    uint32_t tag = detail::THashIndex::tag(hash_(value));
+    std::size_t slot;
+    uint32_t entry = index_.find(tag, Matches(*this, value), slot);
+    if (entry == detail::THashIndex::npos) {
+      return 0;
+    }
+    remove(slot, entry);
+    return 1;
+  }
+
+  /// Returns an iterator to the element moved into pos, or end().
+  iterator erase(iterator pos) {
+    uint32_t entry = static_cast<uint32_t>(pos - begin());
+    uint32_t tag = detail::THashIndex::tag(hash_(*pos));
+    remove(index_.slotOf(tag, entry), entry);
+    return begin() + entry;
+  }
+
+  /// Equal if they hold the same elements, in any order.
+  bool operator==(const THashSet& that) const {
+    if (elems_.size() != that.elems_.size()) {
+      return false;
+    }
+    for (const_iterator it = elems_.begin(); it != elems_.end(); ++it) {
+      if (that.lookup(*it) == detail::THashIndex::npos) {
+        return false;
+      }
+    }
+    return true;
+  }
+
+  bool operator!=(const THashSet& that) const { return !(*this == that); }
+
+  /// Orders like THashMap::operator<.
+  bool operator<(const THashSet& that) const {
+    if (elems_.size() != that.elems_.size()) {
+      return elems_.size() < that.elems_.size();
+    }
+    std::vector<T> a(elems_.begin(), elems_.end());
+    std::vector<T> b(that.elems_.begin(), that.elems_.end());
+    std::sort(a.begin(), a.end());
+    std::sort(b.begin(), b.end());
+    return a < b;
+  }
+
+private:
+  class Matches {
+  public:
+    Matches(const THashSet& set, const T& value) : set_(set), value_(value) {}
+    bool operator()(uint32_t entry) const { return set_.eq_(set_.elems_[entry], value_); }
+
+  private:
+    const THashSet& set_;
+    const T& value_;
+  };
+
+  uint32_t lookup(const T& value) const {
+    std::size_t slot;
+    return index_.find(detail::THashIndex::tag(hash_(value)), Matches(*this, value), slot);
+  }
+
+  void remove(std::size_t slot, uint32_t entry) {
+    index_.remove(slot);
+    uint32_t last = static_cast<uint32_t>(elems_.size() - 1);
+    if (entry != last) {
+      uint32_t tag = detail::THashIndex::tag(hash_(elems_[last]));
+      index_.move(index_.slotOf(tag, last), entry);
+      using std::swap;
+      swap(elems_[entry], elems_[last]);
+    }
+    elems_.pop_back();
+  }
+
+  container_type elems_;
+  detail::THashIndex index_;
+  Hash hash_;
+  Pred eq_;
+};
+
+template <typename K, typename V, typename H, typename P, typename A>
+void swap(THashMap<K, V, H, P, A>& a, THashMap<K, V, H, P, A>& b) {
+  a.swap(b);
+}
+
+template <typename T, typename H, typename P, typename A>
+void swap(THashSet<T, H, P, A>& a, THashSet<T, H, P, A>& b) {
+  a.swap(b);
+}
+
+template <typename K, typename V, typename H, typename P, typename A>
+std::string to_string(const THashMap<K, V, H, P, A>& m) {
+  std::ostringstream o;
+  o << "{" << to_string(m.begin(), m.end()) << "}";
+  return o.str();
+}
+
+template <typename T, typename H, typename P, typename A>
+std::string to_string(const THashSet<T, H, P, A>& s) {
+  std::ostringstream o;
+  o << "{" << to_string(s.begin(), s.end()) << "}";
+  return o.str();
+}
+}
+} // apache::thrift
+
+#endif // #ifndef _THRIFT_THASHMAP_H_
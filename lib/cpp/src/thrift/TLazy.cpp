@@ -0,0 +1,89 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <thrift/TLazy.h>
+
+#include <thrift/protocol/TBinaryProtocol.h>
+#include <thrift/protocol/TCompactProtocol.h>
+#include <thrift/transport/TBufferTransports.h>
+
+namespace apache {
+namespace thrift {
+
+using protocol::TProtocol;
+using protocol::TProtocolException;
+using transport::TMemoryBuffer;
+using transport::TTransport;
+
+bool TLazyBase::capture(TProtocol* iprot, protocol::TType type, uint32_t& xfer) {
+  protocol::TValueEncoding encoding = iprot->getValueEncoding();
+  if (encoding == protocol::T_VALUE_ENCODING_NONE) {
+    return false;
+  }
+  stdcxx::shared_ptr<TTransport> trans = iprot->getTransport();
+  stdcxx::shared_ptr<void> owner;
+  uint32_t avail = 0;
+  const uint8_t* start = trans->borrowShared(&avail, owner);
+  if (start == NULL) {
+    return false;
+  }
+
+  xfer += iprot->skip(type);
+
+  // The value must have come out of the lent window, and not from data the
+  // transport read in after it.
+  uint32_t none = 0;
+  const uint8_t* end = trans->borrow(NULL, &none);
+  if (end == NULL || end < start || end > start + avail) {
+    throw TProtocolException(TProtocolException::INVALID_DATA,
+                             "Lazy field spans more than one transport buffer");
+  }
+  bytes_ = TStringView(reinterpret_cast<const char*>(start), end - start, owner);
+  encoding_ = encoding;
+  return true;
+}
+
+bool TLazyBase::writeBytes(TProtocol* oprot, uint32_t& xfer) const {
+  if (!hasBytes() || oprot->getValueEncoding() != encoding_) {
+    return false;
+  }
+  oprot->getTransport()->write(reinterpret_cast<const uint8_t*>(bytes_.data()),
+                               static_cast<uint32_t>(bytes_.size()));
+  xfer += static_cast<uint32_t>(bytes_.size());
+  return true;
+}
+
+stdcxx::shared_ptr<TProtocol> TLazyBase::bytesProtocol() const {
+  stdcxx::shared_ptr<TMemoryBuffer> buf(
+      new TMemoryBuffer(reinterpret_cast<uint8_t*>(const_cast<char*>(bytes_.data())),
+                        static_cast<uint32_t>(bytes_.size())));
+  switch (encoding_) {
+  case protocol::T_VALUE_ENCODING_BINARY:
+    return stdcxx::shared_ptr<TProtocol>(new protocol::TBinaryProtocolT<TMemoryBuffer>(buf));
+  case protocol::T_VALUE_ENCODING_BINARY_LE:
+    return stdcxx::shared_ptr<TProtocol>(
+        new protocol::TBinaryProtocolT<TMemoryBuffer, protocol::TNetworkLittleEndian>(buf));
+  case protocol::T_VALUE_ENCODING_COMPACT:
+    return stdcxx::shared_ptr<TProtocol>(new protocol::TCompactProtocolT<TMemoryBuffer>(buf));
+  default:
+    throw TProtocolException(TProtocolException::INVALID_DATA, "No bytes to decode");
+  }
+}
+}
+} // apache::thrift
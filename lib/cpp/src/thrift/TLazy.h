@@ -0,0 +1,212 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _THRIFT_TLAZY_H_
+#define _THRIFT_TLAZY_H_ 1
+
+#include <thrift/TStringView.h>
+#include <thrift/TToString.h>
+#include <thrift/protocol/TProtocol.h>
+#include <thrift/stdcxx.h>
+
+namespace apache {
+namespace thrift {
+
+/**
+ * The encoded bytes of a value, kept by TLazy until they are needed.
+ */
+class TLazyBase {
+public:
+  TLazyBase() : encoding_(protocol::T_VALUE_ENCODING_NONE) {}
+
+  /// Whether the encoded bytes of the value are held.
+  bool hasBytes() const { return encoding_ != protocol::T_VALUE_ENCODING_NONE; }
+
+  /// The encoded bytes, if hasBytes().
+  const TStringView& getBytes() const { return bytes_; }
+
+  /// The encoding of getBytes(), if hasBytes().
+  protocol::TValueEncoding getEncoding() const { return encoding_; }
+
+protected:
+  /**
+   * Skips the next value of the given type on iprot and keeps its bytes.
+   * Returns false, having read nothing, if the protocol's values do not
+   * stand on their own or its transport cannot lend out its buffer.
+   */
+  bool capture(protocol::TProtocol* iprot, protocol::TType type, uint32_t& xfer);
+
+  /**
+   * Writes the kept bytes to oprot if it uses their encoding.  Returns false,
+   * having written nothing, otherwise.
+   */
+  bool writeBytes(protocol::TProtocol* oprot, uint32_t& xfer) const;
+
+  /// A protocol of the kept encoding reading from the kept bytes.
+  stdcxx::shared_ptr<protocol::TProtocol> bytesProtocol() const;
+
+  void dropBytes() {
+    bytes_.clear();
+    encoding_ = protocol::T_VALUE_ENCODING_NONE;
+  }
+
+  bool sameBytes(const TLazyBase& that) const {
+    return hasBytes() && encoding_ == that.encoding_ && bytes_ == that.bytes_;
+  }
+
+private:
+  TStringView bytes_;
+  protocol::TValueEncoding encoding_;
+};
+
+/**
+ * A field that is only decoded when it is first used.
+ *
+ * This is the type of struct, list, set and map fields annotated cpp.lazy in
+ * generated code.  When such a field is read with a protocol whose values are
+ * self-contained (see TProtocol::getValueEncoding) from a transport that can
+ * lend out its buffer (see TTransport::borrowShared), read() only skips over
+ * it and keeps a handle on its bytes.  The value is decoded by the first call
+ * to get(), and if it was never changed write() copies the original bytes
+ * out again, provided the output protocol has the same encoding.  Otherwise
+ * the field is read and written like any other.
+ *
+ * The kept bytes hold the buffer they point into alive, typically a whole
+ * frame.  Errors in the encoded value are thrown from get() rather than from
+ * read().  An undecoded value is modified by get() and must not be used from
+ * more than one thread at a time, as for any non-const access.
+ */
+template <typename T>
+class TLazy : public TLazyBase {
+public:
+  typedef uint32_t (*Reader)(protocol::TProtocol* iprot, T& value);
+  typedef uint32_t (*Writer)(protocol::TProtocol* oprot, const T& value);
+
+  TLazy() : value_(), decoded_(true), reader_(NULL) {}
+
+  TLazy(const T& value) : value_(value), decoded_(true), reader_(NULL) {}
+
+  TLazy& operator=(const T& value) {
+    value_ = value;
+    decoded_ = true;
+    dropBytes();
+    return *this;
+  }
+
+  /**
+   * The value, decoded from the kept bytes on first use.  The bytes are kept
+   * so that writing the value out stays a copy.
+   */
+  const T& get() const {
+    if (!decoded_) {
+      decode();
+    }
+    return value_;
+  }
+
+  /**
+   * The value, for changing it.  The kept bytes are dropped, so the value is
+   * encoded again when it is written.
+   */
+  T& getMutable() {
+    get();
+    dropBytes();
+    return value_;
+  }
+
+  bool isDecoded() const { return decoded_; }
+
+  /// Makes the value T() again.
+  void reset() {
+    value_ = T();
+    decoded_ = true;
+    dropBytes();
+  }
+
+  /**
+   * Reads a value of the given type, keeping its bytes if the protocol allows
+   * and otherwise decoding it with reader right away.
+   */
+  uint32_t read(protocol::TProtocol* iprot, protocol::TType type, Reader reader) {
+    uint32_t xfer = 0;
+    reader_ = reader;
+    if (capture(iprot, type, xfer)) {
+      value_ = T();
+      decoded_ = false;
+      return xfer;
+    }
+    dropBytes();
+    decoded_ = true;
+    return reader(iprot, value_);
+  }
+
+  /**
+   * Writes the kept bytes if oprot has their encoding, and otherwise encodes
+   * the value with writer.
+   */
+  uint32_t write(protocol::TProtocol* oprot, Writer writer) const {
+    uint32_t xfer = 0;
+    if (writeBytes(oprot, xfer)) {
+      return xfer;
+    }
+    return writer(oprot, get());
+  }
+
+  void swap(TLazy& that) {
+    using std::swap;
+    swap(static_cast<TLazyBase&>(*this), static_cast<TLazyBase&>(that));
+    swap(value_, that.value_);
+    swap(decoded_, that.decoded_);
+    swap(reader_, that.reader_);
+  }
+
+  bool operator==(const TLazy& that) const { return sameBytes(that) || get() == that.get(); }
+
+  bool operator!=(const TLazy& that) const { return !(*this == that); }
+
+  bool operator<(const TLazy& that) const { return get() < that.get(); }
+
+private:
+  void decode() const {
+    stdcxx::shared_ptr<protocol::TProtocol> iprot = bytesProtocol();
+    T value;
+    reader_(iprot.get(), value);
+    using std::swap;
+    swap(value_, value);
+    decoded_ = true;
+  }
+
+  mutable T value_;
+  mutable bool decoded_;
+  Reader reader_;
+};
+
+template <typename T>
+void swap(TLazy<T>& a, TLazy<T>& b) {
+  a.swap(b);
+}
+
+template <typename T>
+std::string to_string(const TLazy<T>& value) {
+  return to_string(value.get());
+}
+}
+} // apache::thrift
+
+#endif // #ifndef _THRIFT_TLAZY_H_
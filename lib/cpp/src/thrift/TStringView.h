@@ -0,0 +1,148 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _THRIFT_TSTRINGVIEW_H_
+#define _THRIFT_TSTRINGVIEW_H_ 1
+
+#include <thrift/stdcxx.h>
+#include <algorithm>
+#include <cstring>
+#include <ostream>
+#include <string>
+
+namespace apache {
+namespace thrift {
+
+/**
+ * Immutable string or binary value that may refer to memory owned by
+ * someone else.
+ *
+ * This is the field type used for string and binary fields by code generated
+ * with the cpp:zero_copy_strings option.  When such a field is read from a
+ * transport that can lend out its buffer (see TTransport::borrowShared), the
+ * view points straight into that buffer and holds a handle that keeps it
+ * alive, so no bytes are copied.  Views built from a std::string or a C string
+ * hold their own private copy instead.  Copying a view never copies the bytes.
+ */
+class TStringView {
+public:
+  TStringView() : data_(NULL), size_(0) {}
+
+  TStringView(const char* str) : data_(NULL), size_(0) { assign(str, std::strlen(str)); }
+
+  TStringView(const std::string& str) : data_(NULL), size_(0) { assign(str.data(), str.size()); }
+
+  /**
+   * Refers to size bytes at data, which stay valid for as long as owner
+   * (or any copy of it) is alive.  With an empty owner the caller must keep
+   * the data alive for as long as the view is used.
+   */
+  TStringView(const char* data, size_t size, const stdcxx::shared_ptr<void>& owner)
+    : data_(data), size_(size), owner_(owner) {}
+
+  /**
+   * Shares the contents of str without copying them.  The string must not be
+   * modified afterwards.
+   */
+  explicit TStringView(const stdcxx::shared_ptr<std::string>& str)
+    : data_(str->data()), size_(str->size()), owner_(str) {}
+
+  const char* data() const { return data_; }
+  size_t size() const { return size_; }
+  size_t length() const { return size_; }
+  bool empty() const { return size_ == 0; }
+
+  const char* begin() const { return data_; }
+  const char* end() const { return data_ + size_; }
+  char operator[](size_t i) const { return data_[i]; }
+
+  /**
+   * The handle keeping data() alive, or an empty pointer if the view is
+   * empty.
+   */
+  const stdcxx::shared_ptr<void>& owner() const { return owner_; }
+
+  std::string str() const { return size_ == 0 ? std::string() : std::string(data_, size_); }
+
+  /**
+   * Replaces the contents with a private copy of size bytes at data.
+   */
+  void assign(const char* data, size_t size) {
+    if (size == 0) {
+      clear();
+      return;
+    }
+    stdcxx::shared_ptr<std::string> copy(new std::string(data, size));
+    data_ = copy->data();
+    size_ = size;
+    owner_ = copy;
+  }
+
+  void clear() {
+    data_ = NULL;
+    size_ = 0;
+    owner_.reset();
+  }
+
+  void swap(TStringView& that) {
+    using std::swap;
+    swap(data_, that.data_);
+    swap(size_, that.size_);
+    owner_.swap(that.owner_);
+  }
+
+  int compare(const TStringView& that) const {
+    int cmp = size_ == 0 || that.size_ == 0
+                  ? 0
+                  : std::memcmp(data_, that.data_, (std::min)(size_, that.size_));
+    if (cmp != 0) {
+      return cmp;
+    }
+    return size_ < that.size_ ? -1 : (size_ > that.size_ ? 1 : 0);
+  }
+
+private:
+  const char* data_;
+  size_t size_;
+  stdcxx::shared_ptr<void> owner_;
+};
+
+inline bool operator==(const TStringView& a, const TStringView& b) {
+  return a.size() == b.size() && a.compare(b) == 0;
+}
+
+inline bool operator!=(const TStringView& a, const TStringView& b) {
+  return !(a == b);
+}
+
+inline bool operator<(const TStringView& a, const TStringView& b) {
+  return a.compare(b) < 0;
+}
+
+inline void swap(TStringView& a, TStringView& b) {
+  a.swap(b);
+}
+
+inline std::ostream& operator<<(std::ostream& out, const TStringView& str) {
+  return out.write(str.data(), static_cast<std::streamsize>(str.size()));
+}
+}
+} // apache::thrift
+
+#endif // #ifndef _THRIFT_TSTRINGVIEW_H_
@@ -20,28 +20,68 @@
 #include <thrift/async/TConcurrentClientSyncInfo.h>
 #include <thrift/TApplicationException.h>
 #include <thrift/transport/TTransportException.h>
+#include <algorithm>
 #include <limits>
 
 namespace apache { namespace thrift { namespace async {
 
 using namespace ::apache::thrift::concurrency;
 
+/**
+ * Where a caller sleeps until another thread hands it the read token.  A
+ * wakeup that comes before the caller parks is not lost, and a stale one is
+ * harmless because callers recheck their slot after every wakeup.
+ */
+class TConcurrentClientSyncInfo::Parker
+{
+public:
+  Parker() : signaled_(false) {}
+
+  void wait()
+  {
+    Synchronized s(monitor_);
+    while(!signaled_)
+      monitor_.waitForever();
+    signaled_ = false;
+  }
+
+  void wake()
+  {
+    Synchronized s(monitor_);
+    signaled_ = true;
+    monitor_.notify();
+  }
+
+private:
+  Monitor monitor_;
+  bool signaled_;
+};
+
 TConcurrentClientSyncInfo::TConcurrentClientSyncInfo() :
   stop_(false),
-  seqidMutex_(),
+  mutex_(),
   // test rollover all the time
-  nextseqid_((std::numeric_limits<int32_t>::max)()-10),
-  seqidToMonitorMap_(),
-  freeMonitors_(),
+  nextseqid_(static_cast<uint32_t>((std::numeric_limits<int32_t>::max)()-10)),
+  slots_(INITIAL_SLOTS),
+  slotsInUse_(0),
+  readerActive_(false),
+  waiters_(),
+  parkers_(),
+  freeParkers_(),
   writeMutex_(),
-  readMutex_(),
   recvPending_(false),
-  wakeupSomeone_(false),
   seqidPending_(0),
   fnamePending_(),
   mtypePending_(::apache::thrift::protocol::T_CALL)
 {
-  freeMonitors_.reserve(MONITOR_CACHE_SIZE);
+  for(size_t i = 0; i < slots_.size(); ++i)
+    slots_[i].inUse = false;
+}
+
+TConcurrentClientSyncInfo::~TConcurrentClientSyncInfo()
+{
+  for(size_t i = 0; i < parkers_.size(); ++i)
+    delete parkers_[i];
 }
 
 bool TConcurrentClientSyncInfo::getPending(
@@ -51,7 +91,6 @@ bool TConcurrentClientSyncInfo::getPending(
 {
   if(stop_)
     throwDeadConnection_();
-  wakeupSomeone_ = false;
   if(recvPending_)
   {
     recvPending_ = false;
@@ -68,42 +107,38 @@ void TConcurrentClientSyncInfo::updatePending(
   ::apache::thrift::protocol::TMessageType mtype,
   int32_t rseqid)
 {
+  {
+    Guard g(mutex_);
+    if(findSlot_(rseqid) == NULL)
+      throwBadSeqId_();
+  }
   recvPending_ = true;
   seqidPending_ = rseqid;
   fnamePending_ = fname;
   mtypePending_ = mtype;
-  MonitorPtr monitor;
-  {
-    Guard seqidGuard(seqidMutex_);
-    MonitorMap::iterator i = seqidToMonitorMap_.find(rseqid);
-    if(i == seqidToMonitorMap_.end())
-      throwBadSeqId_();
-    monitor = i->second;
-  }
-  monitor->notify();
 }
 
 void TConcurrentClientSyncInfo::waitForWork(int32_t seqid)
 {
-  MonitorPtr m;
-  {
-    Guard seqidGuard(seqidMutex_);
-    m = seqidToMonitorMap_[seqid];
-  }
-  while(true)
+  // Pass the token and the pending header to the caller they belong to,
+  // then wait until the token comes back to us.
+  Parker* parker;
+  Parker* wake;
   {
-    // be very careful about setting state in this loop that affects waking up.  You may exit
-    // this function, attempt to grab some work, and someone else could have beaten you (or not
-    // left) the read mutex, and that will put you right back in this loop, with the mangled
-    // state you left behind.
+    Guard g(mutex_);
     if(stop_)
       throwDeadConnection_();
-    if(wakeupSomeone_)
-      return;
-    if(recvPending_ && seqidPending_ == seqid)
-      return;
-    m->waitForever();
+    Slot* owner = findSlot_(seqidPending_);
+    if(owner == NULL)
+      throwBadSeqId_();
+    Slot* self = findSlot_(seqid);
+    self->handed = false;
+    parker = park_(*self);
+    wake = handTo_(*owner);
   }
+  if(wake)
+    wake->wake();
+  waitForToken_(seqid, parker);
 }
 
 void TConcurrentClientSyncInfo::throwBadSeqId_()
@@ -120,72 +155,165 @@ void TConcurrentClientSyncInfo::throwDeadConnection_()
     "this client died on another thread, and is now in an unusable state");
 }
 
-void TConcurrentClientSyncInfo::wakeupAnyone_(const Guard &)
+TConcurrentClientSyncInfo::Slot* TConcurrentClientSyncInfo::findSlot_(int32_t seqid)
 {
-  wakeupSomeone_ = true;
-  if(!seqidToMonitorMap_.empty())
-  {
-    // The monitor map maps integers to monitors.  Larger integers are more recent
-    // messages.  Since this is ordered, it means that the last element is the most recent.
-    // We are trying to guess which thread will have its message complete next, so we are picking
-    // the most recent. The oldest message is likely to be some polling, long lived message.
-    // If we guess right, the thread we wake up will handle the message that comes in.
-    // If we guess wrong, the thread we wake up will hand off the work to the correct thread,
-    // costing us an extra context switch.
-    seqidToMonitorMap_.rbegin()->second->notify();
-  }
+  Slot& slot = slots_[static_cast<uint32_t>(seqid) & (slots_.size() - 1)];
+  if(!slot.inUse || slot.seqid != seqid)
+    return NULL;
+  return &slot;
 }
 
-void TConcurrentClientSyncInfo::markBad_(const Guard &)
+void TConcurrentClientSyncInfo::growSlots_()
 {
-  wakeupSomeone_ = true;
-  stop_ = true;
-  for(MonitorMap::iterator i = seqidToMonitorMap_.begin(); i != seqidToMonitorMap_.end(); ++i)
-    i->second->notify();
+  // Seqids that differ in the old ring still differ in one twice its size.
+  std::vector<Slot> slots(slots_.size() * 2);
+  for(size_t i = 0; i < slots.size(); ++i)
+    slots[i].inUse = false;
+  for(size_t i = 0; i < slots_.size(); ++i)
+    if(slots_[i].inUse)
+      slots[static_cast<uint32_t>(slots_[i].seqid) & (slots.size() - 1)] = slots_[i];
+  slots_.swap(slots);
 }
 
-TConcurrentClientSyncInfo::MonitorPtr
-TConcurrentClientSyncInfo::newMonitor_(const Guard &)
+TConcurrentClientSyncInfo::Parker* TConcurrentClientSyncInfo::park_(Slot &slot)
 {
-  if(freeMonitors_.empty())
-    return MonitorPtr(new Monitor(&readMutex_));
-  MonitorPtr retval;
-  //swapping to avoid an atomic operation
-  retval.swap(freeMonitors_.back());
-  freeMonitors_.pop_back();
-  return retval;
+  if(slot.parker == NULL)
+  {
+    if(freeParkers_.empty())
+    {
+      parkers_.push_back(new Parker());
+      freeParkers_.push_back(parkers_.back());
+    }
+    slot.parker = freeParkers_.back();
+    freeParkers_.pop_back();
+  }
+  slot.waiting = true;
+  waiters_.push_back(slot.seqid);
+  return slot.parker;
 }
 
-void TConcurrentClientSyncInfo::deleteMonitor_(
-  const Guard &,
-  TConcurrentClientSyncInfo::MonitorPtr &m) /*noexcept*/
+TConcurrentClientSyncInfo::Parker* TConcurrentClientSyncInfo::handTo_(Slot &slot)
 {
-  if(freeMonitors_.size() > MONITOR_CACHE_SIZE)
+  slot.handed = true;
+  if(!slot.waiting)
   {
-    m.reset();
-    return;
+    // The caller has not started receiving yet and takes the token when it does.
+    return NULL;
   }
-  //freeMonitors_ was reserved up to MONITOR_CACHE_SIZE in the ctor,
-  //so this shouldn't throw
-  freeMonitors_.push_back(TConcurrentClientSyncInfo::MonitorPtr());
-  //swapping to avoid an atomic operation
-  m.swap(freeMonitors_.back());
+  slot.waiting = false;
+  waiters_.erase(std::find(waiters_.begin(), waiters_.end(), slot.seqid));
+  return slot.parker;
+}
+
+void TConcurrentClientSyncInfo::freeSlot_(Slot &slot)
+{
+  if(slot.waiting)
+    waiters_.erase(std::find(waiters_.begin(), waiters_.end(), slot.seqid));
+  if(slot.parker != NULL)
+    freeParkers_.push_back(slot.parker);
+  slot.inUse = false;
+  --slotsInUse_;
+}
+
+void TConcurrentClientSyncInfo::markBad_()
+{
+  stop_ = true;
+  for(size_t i = 0; i < slots_.size(); ++i)
+    if(slots_[i].inUse && slots_[i].waiting)
+      slots_[i].parker->wake();
 }
 
 int32_t TConcurrentClientSyncInfo::generateSeqId()
 {
-  Guard seqidGuard(seqidMutex_);
+  Guard g(mutex_);
   if(stop_)
     throwDeadConnection_();
 
-  if(!seqidToMonitorMap_.empty())
-    if(nextseqid_ == seqidToMonitorMap_.begin()->first)
-      throw apache::thrift::TApplicationException(
-        TApplicationException::BAD_SEQUENCE_ID,
-        "about to repeat a seqid");
-  int32_t newSeqId = nextseqid_++;
-  seqidToMonitorMap_[newSeqId] = newMonitor_(seqidGuard);
-  return newSeqId;
+  if((slotsInUse_ + 1) * 2 > slots_.size())
+    growSlots_();
+  // Skip seqids whose slot still holds a call from one ring ago.
+  uint32_t id = nextseqid_;
+  while(slots_[id & (slots_.size() - 1)].inUse)
+    ++id;
+  nextseqid_ = id + 1;
+
+  Slot& slot = slots_[id & (slots_.size() - 1)];
+  slot.seqid = static_cast<int32_t>(id);
+  slot.inUse = true;
+  slot.handed = false;
+  slot.waiting = false;
+  slot.parker = NULL;
+  ++slotsInUse_;
+  return slot.seqid;
+}
+
+void TConcurrentClientSyncInfo::acquireReadToken_(int32_t seqid)
+{
+  Parker* parker;
+  {
+    Guard g(mutex_);
+    Slot* slot = findSlot_(seqid);
+    if(slot == NULL)
+      throwBadSeqId_();
+    // after a failure getPending() throws for everyone
+    if(stop_ || slot->handed)
+      return;
+    if(!readerActive_)
+    {
+      readerActive_ = true;
+      slot->handed = true;
+      return;
+    }
+    parker = park_(*slot);
+  }
+  waitForToken_(seqid, parker);
+}
+
+void TConcurrentClientSyncInfo::waitForToken_(int32_t seqid, Parker* parker)
+{
+  while(true)
+  {
+    parker->wait();
+    Guard g(mutex_);
+    Slot* slot = findSlot_(seqid);
+    if(stop_ || slot->handed)
+      return;
+    if(!readerActive_)
+    {
+      // woken to read, and nobody got there first
+      readerActive_ = true;
+      handTo_(*slot);
+      return;
+    }
+  }
+}
+
+void TConcurrentClientSyncInfo::releaseReadToken_(int32_t seqid, bool committed)
+{
+  Parker* wake = NULL;
+  {
+    Guard g(mutex_);
+    Slot* slot = findSlot_(seqid);
+    bool holder = slot != NULL && slot->handed;
+    if(slot != NULL)
+      freeSlot_(*slot);
+    if(!committed)
+    {
+      markBad_();
+    }
+    else if(holder)
+    {
+      // Someone has to read for the callers still waiting.  Wake the most
+      // recent one, as the oldest is likely some long poll; but leave the
+      // token free so that a caller that comes along first, likely the one
+      // running right now, can take it without a context switch.
+      readerActive_ = false;
+      if(!waiters_.empty())
+        wake = findSlot_(waiters_.back())->parker;
+    }
+  }
+  if(wake)
+    wake->wake();
 }
 
 TConcurrentRecvSentry::TConcurrentRecvSentry(TConcurrentClientSyncInfo *sync, int32_t seqid) :
@@ -193,22 +321,12 @@ TConcurrentRecvSentry::TConcurrentRecvSentry(TConcurrentClientSyncInfo *sync, in
   seqid_(seqid),
   committed_(false)
 {
-  sync_.getReadMutex().lock();
+  sync_.acquireReadToken_(seqid_);
 }
 
 TConcurrentRecvSentry::~TConcurrentRecvSentry()
 {
-  {
-    Guard seqidGuard(sync_.seqidMutex_);
-    sync_.deleteMonitor_(seqidGuard, sync_.seqidToMonitorMap_[seqid_]);
-
-    sync_.seqidToMonitorMap_.erase(seqid_);
-    if(committed_)
-      sync_.wakeupAnyone_(seqidGuard);
-    else
-      sync_.markBad_(seqidGuard);
-  }
-  sync_.getReadMutex().unlock();
+  sync_.releaseReadToken_(seqid_, committed_);
 }
 
 void TConcurrentRecvSentry::commit()
@@ -227,8 +345,8 @@ TConcurrentSendSentry::~TConcurrentSendSentry()
 {
   if(!committed_)
   {
-    Guard seqidGuard(sync_.seqidMutex_);
-    sync_.markBad_(seqidGuard);
+    Guard g(sync_.mutex_);
+    sync_.markBad_();
   }
   sync_.getWriteMutex().unlock();
 }
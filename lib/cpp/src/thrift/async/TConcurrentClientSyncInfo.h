@@ -23,9 +23,9 @@
 #include <thrift/concurrency/Mutex.h>
 #include <thrift/concurrency/Monitor.h>
 #include <thrift/stdcxx.h>
+#include <boost/atomic.hpp>
 #include <vector>
 #include <string>
-#include <map>
 
 namespace apache {
 namespace thrift {
@@ -45,6 +45,12 @@ private:
   bool committed_;
 };
 
+/**
+ * Held by a thread while it receives the reply to one call.  The constructor
+ * returns once the thread holds the read token: either nobody was reading,
+ * or a reader handed it the token, with the header of its reply if the
+ * reader already read that.
+ */
 class TConcurrentRecvSentry {
 public:
   TConcurrentRecvSentry(TConcurrentClientSyncInfo* sync, int32_t seqid);
@@ -58,63 +64,89 @@ private:
   bool committed_;
 };
 
+/**
+ * Lets many threads share the connection of a concurrent client.
+ *
+ * Calls in flight live in a ring of slots indexed by seqid, which grows when
+ * it gets half full.  One thread at a time holds the read token and reads
+ * from the connection.  A reader that finds a reply for another call hands
+ * the token together with the header straight to the caller waiting for it
+ * and parks; a reader done with its own reply frees the token and wakes the
+ * most recent waiter to take it.  Every caller parks on a monitor of its
+ * own, so each wakeup reaches exactly one thread.  The slot state is guarded
+ * by one mutex that is only held for bookkeeping, never while reading or
+ * waiting.
+ */
 class TConcurrentClientSyncInfo {
-private: // typedefs
-  typedef stdcxx::shared_ptr< ::apache::thrift::concurrency::Monitor> MonitorPtr;
-  typedef std::map<int32_t, MonitorPtr> MonitorMap;
-
 public:
   TConcurrentClientSyncInfo();
+  ~TConcurrentClientSyncInfo();
 
   int32_t generateSeqId();
 
   bool getPending(std::string& fname,
                   ::apache::thrift::protocol::TMessageType& mtype,
-                  int32_t& rseqid); /* requires readMutex_ */
+                  int32_t& rseqid); /* requires the read token */
 
   void updatePending(const std::string& fname,
                      ::apache::thrift::protocol::TMessageType mtype,
-                     int32_t rseqid); /* requires readMutex_ */
+                     int32_t rseqid); /* requires the read token */
 
-  void waitForWork(int32_t seqid); /* requires readMutex_ */
+  void waitForWork(int32_t seqid); /* requires the read token */
 
-  ::apache::thrift::concurrency::Mutex& getReadMutex() { return readMutex_; }
   ::apache::thrift::concurrency::Mutex& getWriteMutex() { return writeMutex_; }
 
+private: // types
+  class Parker;
+
+  struct Slot {
+    int32_t seqid;
+    bool inUse;
+    /// the call holds the read token, or will once it starts receiving
+    bool handed;
+    /// the call is parked in waiters_
+    bool waiting;
+    Parker* parker;
+  };
+
 private: // constants
-  enum { MONITOR_CACHE_SIZE = 10 };
+  enum { INITIAL_SLOTS = 64 };
 
 private: // functions
-  MonitorPtr newMonitor_(
-      const ::apache::thrift::concurrency::Guard& seqidGuard); /* requires seqidMutex_ */
-  void deleteMonitor_(const ::apache::thrift::concurrency::Guard& seqidGuard, MonitorPtr& m);
-      /*noexcept*/ /* requires seqidMutex_ */
-  void wakeupAnyone_(
-      const ::apache::thrift::concurrency::Guard& seqidGuard);           /* requires seqidMutex_ */
-  void markBad_(const ::apache::thrift::concurrency::Guard& seqidGuard); /* requires seqidMutex_ */
+  Slot* findSlot_(int32_t seqid); /* requires mutex_ */
+  void growSlots_();             /* requires mutex_ */
+  Parker* park_(Slot& slot);     /* requires mutex_ */
+  Parker* handTo_(Slot& slot);   /* requires mutex_ */
+  void freeSlot_(Slot& slot);    /* requires mutex_ */
+  void markBad_();               /* requires mutex_ */
+  void acquireReadToken_(int32_t seqid);
+  void releaseReadToken_(int32_t seqid, bool committed);
+  void waitForToken_(int32_t seqid, Parker* parker);
   void throwBadSeqId_();
   void throwDeadConnection_();
 
 private: // data members
-  volatile bool stop_;
-
-  ::apache::thrift::concurrency::Mutex seqidMutex_;
-  // begin seqidMutex_ protected members
-  int32_t nextseqid_;
-  MonitorMap seqidToMonitorMap_;
-  std::vector<MonitorPtr> freeMonitors_;
-  // end seqidMutex_ protected members
+  boost::atomic<bool> stop_;
+
+  ::apache::thrift::concurrency::Mutex mutex_;
+  // begin mutex_ protected members
+  uint32_t nextseqid_;
+  std::vector<Slot> slots_;
+  size_t slotsInUse_;
+  bool readerActive_;
+  std::vector<int32_t> waiters_; // most recent last
+  std::vector<Parker*> parkers_;
+  std::vector<Parker*> freeParkers_;
+  // end mutex_ protected members
 
   ::apache::thrift::concurrency::Mutex writeMutex_;
 
-  ::apache::thrift::concurrency::Mutex readMutex_;
-  // begin readMutex_ protected members
+  // begin read token protected members
   bool recvPending_;
-  bool wakeupSomeone_;
   int32_t seqidPending_;
   std::string fnamePending_;
   ::apache::thrift::protocol::TMessageType mtypePending_;
-  // end readMutex_ protected members
+  // end read token protected members
 
   friend class TConcurrentSendSentry;
   friend class TConcurrentRecvSentry;
@@ -0,0 +1,394 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <thrift/thrift-config.h>
+
+#include <thrift/async/TFramedClientChannel.h>
+
+#include <algorithm>
+#include <cstring>
+
+#ifdef HAVE_SYS_SOCKET_H
+#include <sys/socket.h>
+#endif
+
+#ifdef HAVE_ARPA_INET_H
+#include <arpa/inet.h>
+#endif
+
+using apache::thrift::concurrency::Guard;
+using apache::thrift::transport::TMemoryBuffer;
+using apache::thrift::transport::TSocket;
+using apache::thrift::transport::TTransportException;
+
+namespace apache {
+namespace thrift {
+namespace async {
+
+TFramedClientChannel::TFramedClientChannel(
+    const std::string& host,
+    int port,
+    struct event_base* eb,
+    const stdcxx::shared_ptr<protocol::TProtocolFactory>& protocolFactory)
+  : socket_(new TSocket(host, port)),
+    eventBase_(eb),
+    writing_(false),
+    maxFrameSize_(transport::TFramedTransport::DEFAULT_MAX_FRAME_SIZE),
+    wakeUpSent_(false),
+    requestBuffer_(new TMemoryBuffer()),
+    requestProtocol_(protocolFactory->getProtocol(requestBuffer_)),
+    failed_(false),
+    closing_(false),
+    writePos_(0),
+    readEnd_(0),
+    replyBuffer_(new TMemoryBuffer()),
+    replyProtocol_(protocolFactory->getProtocol(replyBuffer_)) {
+  socket_->open();
+  if (evutil_make_socket_nonblocking(socket_->getSocketFD()) < 0) {
+    throw TTransportException(TTransportException::UNKNOWN,
+                              "TFramedClientChannel: cannot make socket nonblocking");
+  }
+
+  if (evutil_socketpair(AF_LOCAL, SOCK_STREAM, 0, notifyFDs_) == -1) {
+    throw TException("TFramedClientChannel: cannot create notification pipe");
+  }
+  if (evutil_make_socket_nonblocking(notifyFDs_[0]) < 0
+      || evutil_make_socket_nonblocking(notifyFDs_[1]) < 0) {
+    ::THRIFT_CLOSESOCKET(notifyFDs_[0]);
+    ::THRIFT_CLOSESOCKET(notifyFDs_[1]);
+    throw TException("TFramedClientChannel: cannot make notification pipe nonblocking");
+  }
+
+  event_set(&socketEvent_,
+            socket_->getSocketFD(),
+            EV_READ | EV_PERSIST,
+            TFramedClientChannel::socketHandler,
+            this);
+  event_base_set(eventBase_, &socketEvent_);
+  event_set(&notifyEvent_,
+            notifyFDs_[0],
+            EV_READ | EV_PERSIST,
+            TFramedClientChannel::notifyHandler,
+            this);
+  event_base_set(eventBase_, &notifyEvent_);
+  if (event_add(&socketEvent_, 0) == -1 || event_add(&notifyEvent_, 0) == -1) {
+    event_del(&socketEvent_);
+    ::THRIFT_CLOSESOCKET(notifyFDs_[0]);
+    ::THRIFT_CLOSESOCKET(notifyFDs_[1]);
+    throw TException("TFramedClientChannel: event_add() failed");
+  }
+}
+
+TFramedClientChannel::~TFramedClientChannel() {
+  fail(NULL);
+  ::THRIFT_CLOSESOCKET(notifyFDs_[0]);
+  ::THRIFT_CLOSESOCKET(notifyFDs_[1]);
+}
+
+void TFramedClientChannel::sendAndRecvMessage(const VoidCallback& cob,
+                                              TMemoryBuffer* sendBuf,
+                                              TMemoryBuffer* recvBuf) {
+  bool wake = false;
+  bool queued = false;
+  {
+    Guard g(mutex_);
+    if (!failed_ && !closing_) {
+      uint8_t* data;
+      uint32_t size;
+      sendBuf->getBuffer(&data, &size);
+      requestBuffer_->resetBuffer(data, size);
+      std::string name;
+      protocol::TMessageType type;
+      int32_t seqid;
+      requestProtocol_->readMessageBegin(name, type, seqid);
+
+      Call call;
+      call.cob = cob;
+      call.recvBuf = recvBuf;
+      calls_[seqid].push_back(call);
+      wake = !wakeUpSent_;
+      queue(sendBuf);
+      queued = true;
+    }
+  }
+
+  if (!queued) {
+    recvBuf->resetBuffer();
+    cob();
+  } else if (wake) {
+    wakeUp();
+  }
+}
+
+void TFramedClientChannel::sendMessage(const VoidCallback& cob, TMemoryBuffer* message) {
+  bool wake = false;
+  {
+    Guard g(mutex_);
+    if (!failed_ && !closing_) {
+      wake = !wakeUpSent_;
+      queue(message);
+    }
+  }
+  if (wake) {
+    wakeUp();
+  }
+  cob();
+}
+
+void TFramedClientChannel::recvMessage(const VoidCallback& cob, TMemoryBuffer* message) {
+  (void)cob;
+  (void)message;
+  throw TException("Unexpected call to TFramedClientChannel::recvMessage");
+}
+
+void TFramedClientChannel::close() {
+  {
+    Guard g(mutex_);
+    if (failed_ || closing_) {
+      return;
+    }
+    closing_ = true;
+  }
+  wakeUp();
+}
+
+bool TFramedClientChannel::good() const {
+  Guard g(mutex_);
+  return !failed_;
+}
+
+bool TFramedClientChannel::error() const {
+  Guard g(mutex_);
+  return failed_;
+}
+
+void TFramedClientChannel::queue(TMemoryBuffer* message) {
+  uint8_t* data;
+  uint32_t size;
+  message->getBuffer(&data, &size);
+  uint32_t frameSize = htonl(size);
+  const uint8_t* header = reinterpret_cast<const uint8_t*>(&frameSize);
+  queued_.insert(queued_.end(), header, header + sizeof(frameSize));
+  queued_.insert(queued_.end(), data, data + size);
+  wakeUpSent_ = true;
+}
+
+void TFramedClientChannel::wakeUp() {
+  char wakeup = 0;
+  // A full pipe already holds a wakeup the loop has yet to see.
+  if (send(notifyFDs_[1], &wakeup, 1, 0) < 0
+      && THRIFT_GET_SOCKET_ERROR != THRIFT_EWOULDBLOCK && THRIFT_GET_SOCKET_ERROR != THRIFT_EAGAIN) {
+    GlobalOutput.perror("TFramedClientChannel: wakeUp() send(): ", THRIFT_GET_SOCKET_ERROR);
+  }
+}
+
+void TFramedClientChannel::notifyHandler(evutil_socket_t fd, short which, void* v) {
+  (void)which;
+  TFramedClientChannel* channel = static_cast<TFramedClientChannel*>(v);
+  char buf[64];
+  while (recv(fd, buf, sizeof(buf), 0) > 0) {
+  }
+
+  bool closing;
+  {
+    Guard g(channel->mutex_);
+    closing = channel->closing_;
+  }
+  if (closing) {
+    channel->fail(NULL);
+  } else {
+    channel->writeQueued();
+  }
+}
+
+void TFramedClientChannel::socketHandler(evutil_socket_t fd, short which, void* v) {
+  (void)fd;
+  TFramedClientChannel* channel = static_cast<TFramedClientChannel*>(v);
+  if (which & EV_WRITE) {
+    channel->writeQueued();
+  }
+  if ((which & EV_READ) && channel->good()) {
+    channel->readReplies();
+  }
+}
+
+void TFramedClientChannel::writeQueued() {
+  for (;;) {
+    if (writePos_ == writeBuffer_.size()) {
+      writeBuffer_.clear();
+      writePos_ = 0;
+      {
+        Guard g(mutex_);
+        if (failed_) {
+          return;
+        }
+        // Take everything queued so far and write it in as few sends as the
+        // socket allows.
+        writeBuffer_.swap(queued_);
+        wakeUpSent_ = false;
+      }
+      if (writeBuffer_.empty()) {
+        setWriting(false);
+        return;
+      }
+    }
+
+    uint32_t sent;
+    try {
+      sent = socket_->write_partial(&writeBuffer_[writePos_],
+                                    static_cast<uint32_t>(writeBuffer_.size() - writePos_));
+    } catch (const TTransportException& te) {
+      fail(te.what());
+      return;
+    }
+    if (sent == 0) {
+      // The socket takes no more for now.
+      setWriting(true);
+      return;
+    }
+    writePos_ += sent;
+  }
+}
+
+void TFramedClientChannel::readReplies() {
+  if (readBuffer_.size() - readEnd_ < 4096) {
+    readBuffer_.resize(std::max<size_t>(readBuffer_.size() * 2, 16384));
+  }
+
+  uint32_t got;
+  try {
+    got = socket_->read(&readBuffer_[readEnd_], static_cast<uint32_t>(readBuffer_.size() - readEnd_));
+  } catch (const TTransportException& te) {
+    if (te.getType() != TTransportException::TIMED_OUT) {
+      fail(te.what());
+    }
+    return;
+  }
+  if (got == 0) {
+    fail("connection closed by peer");
+    return;
+  }
+  readEnd_ += got;
+
+  size_t pos = 0;
+  while (readEnd_ - pos >= sizeof(uint32_t)) {
+    uint32_t frameSize;
+    std::memcpy(&frameSize, &readBuffer_[pos], sizeof(frameSize));
+    frameSize = ntohl(frameSize);
+    if (frameSize > maxFrameSize_) {
+      fail("frame size too large");
+      return;
+    }
+    if (readEnd_ - pos - sizeof(frameSize) < frameSize) {
+      if (sizeof(frameSize) + frameSize > readBuffer_.size()) {
+        readBuffer_.resize(sizeof(frameSize) + frameSize);
+      }
+      break;
+    }
+
+    uint8_t* frame = &readBuffer_[pos + sizeof(frameSize)];
+    pos += sizeof(frameSize) + frameSize;
+
+    std::string name;
+    protocol::TMessageType type;
+    int32_t seqid;
+    try {
+      replyBuffer_->resetBuffer(frame, frameSize);
+      replyProtocol_->readMessageBegin(name, type, seqid);
+    } catch (const TException& te) {
+      fail(te.what());
+      return;
+    }
+
+    Call call;
+    {
+      Guard g(mutex_);
+      CallMap::iterator it = calls_.find(seqid);
+      if (it == calls_.end()) {
+        call.recvBuf = NULL;
+      } else {
+        call = it->second.front();
+        it->second.pop_front();
+        if (it->second.empty()) {
+          calls_.erase(it);
+        }
+      }
+    }
+    if (call.recvBuf == NULL) {
+      GlobalOutput.printf("TFramedClientChannel: dropping reply with unknown seqid %d", seqid);
+      continue;
+    }
+    call.recvBuf->resetBuffer();
+    call.recvBuf->write(frame, frameSize);
+    call.cob();
+  }
+
+  // Keep the start of a frame that is not complete yet.
+  if (pos > 0) {
+    std::memmove(&readBuffer_[0], &readBuffer_[pos], readEnd_ - pos);
+    readEnd_ -= pos;
+  }
+}
+
+void TFramedClientChannel::setWriting(bool writing) {
+  if (writing == writing_) {
+    return;
+  }
+  writing_ = writing;
+  event_del(&socketEvent_);
+  event_set(&socketEvent_,
+            socket_->getSocketFD(),
+            EV_READ | EV_PERSIST | (writing ? EV_WRITE : 0),
+            TFramedClientChannel::socketHandler,
+            this);
+  event_base_set(eventBase_, &socketEvent_);
+  if (event_add(&socketEvent_, 0) == -1) {
+    fail("event_add() failed");
+  }
+}
+
+void TFramedClientChannel::fail(const char* reason) {
+  CallMap calls;
+  {
+    Guard g(mutex_);
+    if (failed_) {
+      return;
+    }
+    failed_ = true;
+    calls.swap(calls_);
+    queued_.clear();
+  }
+  if (reason != NULL) {
+    GlobalOutput.printf("TFramedClientChannel: %s", reason);
+  }
+
+  event_del(&socketEvent_);
+  event_del(&notifyEvent_);
+  socket_->close();
+
+  for (CallMap::iterator it = calls.begin(); it != calls.end(); ++it) {
+    for (size_t i = 0; i < it->second.size(); ++i) {
+      it->second[i].recvBuf->resetBuffer();
+      it->second[i].cob();
+    }
+  }
+}
+}
+}
+} // apache::thrift::async
@@ -0,0 +1,162 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _THRIFT_ASYNC_TFRAMEDCLIENTCHANNEL_H_
+#define _THRIFT_ASYNC_TFRAMEDCLIENTCHANNEL_H_ 1
+
+#include <deque>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <thrift/async/TAsyncChannel.h>
+#include <thrift/concurrency/Mutex.h>
+#include <thrift/protocol/TProtocol.h>
+#include <thrift/stdcxx.h>
+#include <thrift/transport/PlatformSocket.h>
+#include <thrift/transport/TBufferTransports.h>
+#include <thrift/transport/TSocket.h>
+
+#include <event.h>
+
+namespace apache {
+namespace thrift {
+namespace async {
+
+/**
+ * A TAsyncChannel that sends calls as TFramedTransport frames over one TCP
+ * connection, driven by a libevent event base.  Unlike TEvhttpClientChannel
+ * it keeps any number of calls in flight and takes their replies in any
+ * order: it reads the seqid of every request and reply message with the
+ * protocol the client uses, and completes the oldest call with the seqid of
+ * the reply.  This suits the future clients of the cpp:future_style option
+ * and a TNonblockingServer that pipelines requests.
+ *
+ * Calls may be sent from any thread.  Their callbacks run on the thread that
+ * runs the event loop, which must only be started once the channel is built,
+ * and must be stopped, or must be the calling thread, when it is destroyed.
+ * If the connection fails or is closed, outstanding and later calls complete
+ * at once with an empty reply buffer, and error() returns true.
+ */
+class TFramedClientChannel : public TAsyncChannel {
+public:
+  using TAsyncChannel::VoidCallback;
+
+  /**
+   * Connects to host:port, blocking until connected.
+   *
+   * @param protocolFactory makes the protocol that the clients of the
+   *        channel use, for the channel to read their seqids with.
+   */
+  TFramedClientChannel(const std::string& host,
+                       int port,
+                       struct event_base* eb,
+                       const stdcxx::shared_ptr<protocol::TProtocolFactory>& protocolFactory);
+  ~TFramedClientChannel();
+
+  virtual void sendAndRecvMessage(const VoidCallback& cob,
+                                  apache::thrift::transport::TMemoryBuffer* sendBuf,
+                                  apache::thrift::transport::TMemoryBuffer* recvBuf);
+
+  /**
+   * Sends a message that has no reply, such as a oneway call.  cob is
+   * called once the message is queued for the connection.
+   */
+  virtual void sendMessage(const VoidCallback& cob,
+                           apache::thrift::transport::TMemoryBuffer* message);
+  virtual void recvMessage(const VoidCallback& cob,
+                           apache::thrift::transport::TMemoryBuffer* message);
+
+  /**
+   * Closes the connection from the event loop thread, failing outstanding
+   * calls.  Once closed, the channel no longer keeps the event loop running.
+   * May be called from any thread.
+   */
+  void close();
+
+  virtual bool good() const;
+  virtual bool error() const;
+  virtual bool timedOut() const { return false; }
+
+  /// Largest reply frame the channel accepts.
+  void setMaxFrameSize(uint32_t maxFrameSize) { maxFrameSize_ = maxFrameSize; }
+  uint32_t getMaxFrameSize() const { return maxFrameSize_; }
+
+private:
+  struct Call {
+    VoidCallback cob;
+    apache::thrift::transport::TMemoryBuffer* recvBuf;
+  };
+  typedef std::map<int32_t, std::deque<Call> > CallMap;
+
+  static void socketHandler(evutil_socket_t fd, short which, void* v);
+  static void notifyHandler(evutil_socket_t fd, short which, void* v);
+
+  /// Queues a framed message and wakes up the event loop if needed.
+  void queue(apache::thrift::transport::TMemoryBuffer* message);
+  void wakeUp();
+  void writeQueued();
+  void readReplies();
+  void setWriting(bool writing);
+  void fail(const char* reason);
+
+  stdcxx::shared_ptr<transport::TSocket> socket_;
+  struct event_base* eventBase_;
+  struct event socketEvent_;
+  struct event notifyEvent_;
+  bool writing_;
+  THRIFT_SOCKET notifyFDs_[2];
+  uint32_t maxFrameSize_;
+
+  /// Guards all members from here to closing_.
+  mutable concurrency::Mutex mutex_;
+
+  /// Frames queued since the event loop last took them
+  std::vector<uint8_t> queued_;
+
+  /// Set once the loop has been woken up for the frames in queued_
+  bool wakeUpSent_;
+
+  /// Calls waiting for a reply, oldest first for every seqid
+  CallMap calls_;
+
+  /// Reads the seqids of requests
+  stdcxx::shared_ptr<transport::TMemoryBuffer> requestBuffer_;
+  stdcxx::shared_ptr<protocol::TProtocol> requestProtocol_;
+
+  bool failed_;
+  bool closing_;
+
+  /// Frames being written by the event loop, and how far it got
+  std::vector<uint8_t> writeBuffer_;
+  size_t writePos_;
+
+  /// Bytes read and not yet taken as replies
+  std::vector<uint8_t> readBuffer_;
+  size_t readEnd_;
+
+  /// Reads the seqids of replies
+  stdcxx::shared_ptr<transport::TMemoryBuffer> replyBuffer_;
+  stdcxx::shared_ptr<protocol::TProtocol> replyProtocol_;
+};
+}
+}
+} // apache::thrift::async
+
+#endif // #ifndef _THRIFT_ASYNC_TFRAMEDCLIENTCHANNEL_H_
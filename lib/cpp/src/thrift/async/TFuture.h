@@ -0,0 +1,264 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _THRIFT_ASYNC_TFUTURE_H_
+#define _THRIFT_ASYNC_TFUTURE_H_ 1
+
+#include <vector>
+
+#include <thrift/Thrift.h>
+#include <thrift/concurrency/Monitor.h>
+#include <thrift/stdcxx.h>
+
+namespace apache {
+namespace thrift {
+namespace async {
+
+/**
+ * The exception a failed future holds.  Unlike a TDelayedException it can be
+ * thrown any number of times, once for every get() of the future.
+ */
+class TFutureError {
+public:
+  virtual ~TFutureError() {}
+  virtual void rethrow() const = 0;
+};
+
+template <class E>
+class TFutureErrorImpl : public TFutureError {
+public:
+  explicit TFutureErrorImpl(const E& e) : e_(e) {}
+  virtual void rethrow() const { throw e_; }
+
+private:
+  E e_;
+};
+
+/**
+ * State shared by a promise and its futures: whether the result is there,
+ * the exception if it failed, and the continuations waiting for it.
+ */
+class TFutureStateBase {
+public:
+  typedef stdcxx::function<void()> VoidCallback;
+
+  TFutureStateBase() : claimed_(false), ready_(false) {}
+  virtual ~TFutureStateBase() {}
+
+  bool isReady() const {
+    concurrency::Synchronized s(monitor_);
+    return ready_;
+  }
+
+  void wait() const {
+    concurrency::Synchronized s(monitor_);
+    while (!ready_) {
+      monitor_.waitForever();
+    }
+  }
+
+  /**
+   * Runs cob once the result is there: right away if it already is,
+   * otherwise on the thread that sets it.
+   */
+  void then(const VoidCallback& cob) {
+    {
+      concurrency::Synchronized s(monitor_);
+      if (!ready_) {
+        callbacks_.push_back(cob);
+        return;
+      }
+    }
+    cob();
+  }
+
+  /// Throws the exception of a failed result; only valid once ready.
+  void rethrowError() const {
+    if (error_) {
+      error_->rethrow();
+    }
+  }
+
+  void setError(TFutureError* error) {
+    claim(error);
+    error_.reset(error);
+    complete();
+  }
+
+protected:
+  /// Reserves the result for one setter, so that it can fill it in unlocked.
+  void claim(TFutureError* error = NULL) {
+    concurrency::Synchronized s(monitor_);
+    if (claimed_) {
+      delete error;
+      throw TException("TPromise: result already set");
+    }
+    claimed_ = true;
+  }
+
+  /// Publishes the result and runs the continuations.
+  void complete() {
+    std::vector<VoidCallback> callbacks;
+    {
+      concurrency::Synchronized s(monitor_);
+      ready_ = true;
+      callbacks.swap(callbacks_);
+      monitor_.notifyAll();
+    }
+    for (size_t i = 0; i < callbacks.size(); ++i) {
+      callbacks[i]();
+    }
+  }
+
+private:
+  concurrency::Monitor monitor_;
+  bool claimed_;
+  bool ready_;
+  stdcxx::scoped_ptr<TFutureError> error_;
+  std::vector<VoidCallback> callbacks_;
+};
+
+template <class T>
+class TFutureState : public TFutureStateBase {
+public:
+  const T& value() const { return value_; }
+
+  void setValue(const T& value) {
+    claim();
+    value_ = value;
+    complete();
+  }
+
+private:
+  T value_;
+};
+
+template <>
+class TFutureState<void> : public TFutureStateBase {
+public:
+  void setValue() {
+    claim();
+    complete();
+  }
+};
+
+template <class T>
+class TFuture;
+
+template <class T>
+class TFutureBase {
+public:
+  /// Whether this future refers to a result at all.
+  bool valid() const { return state_.get() != NULL; }
+
+  bool isReady() const { return state_->isReady(); }
+
+  /// Blocks until the result is there.
+  void wait() const { state_->wait(); }
+
+  /**
+   * Calls cob with this future once the result is there: right away if it
+   * already is, otherwise on the thread that sets it, which for the calls of
+   * a future client is the event loop thread of its channel.  Continuations
+   * must not throw.
+   */
+  void then(const stdcxx::function<void(const TFuture<T>&)>& cob) const {
+    state_->then(stdcxx::bind(cob, static_cast<const TFuture<T>&>(*this)));
+  }
+
+protected:
+  TFutureBase() {}
+  explicit TFutureBase(const stdcxx::shared_ptr<TFutureState<T> >& state) : state_(state) {}
+
+  stdcxx::shared_ptr<TFutureState<T> > state_;
+};
+
+/**
+ * The result of an asynchronous call, which is either a value or an
+ * exception.  Copies of a future refer to the same result.
+ */
+template <class T>
+class TFuture : public TFutureBase<T> {
+public:
+  TFuture() {}
+  explicit TFuture(const stdcxx::shared_ptr<TFutureState<T> >& state) : TFutureBase<T>(state) {}
+
+  /**
+   * Blocks until the result is there and returns the value, or throws the
+   * exception of the call.
+   */
+  const T& get() const {
+    this->state_->wait();
+    this->state_->rethrowError();
+    return this->state_->value();
+  }
+};
+
+template <>
+class TFuture<void> : public TFutureBase<void> {
+public:
+  TFuture() {}
+  explicit TFuture(const stdcxx::shared_ptr<TFutureState<void> >& state)
+    : TFutureBase<void>(state) {}
+
+  /// Blocks until the call is done, and throws its exception if it failed.
+  void get() const {
+    state_->wait();
+    state_->rethrowError();
+  }
+};
+
+template <class T>
+class TPromiseBase {
+public:
+  TFuture<T> getFuture() const { return TFuture<T>(state_); }
+
+  /// Fails the futures with a copy of e.  A result can only be set once.
+  template <class E>
+  void setException(const E& e) const {
+    state_->setError(new TFutureErrorImpl<E>(e));
+  }
+
+protected:
+  TPromiseBase() : state_(new TFutureState<T>) {}
+
+  stdcxx::shared_ptr<TFutureState<T> > state_;
+};
+
+/**
+ * The side of a result that sets it.  Copies of a promise refer to the same
+ * result, so that a promise can be bound into a callback.  Whoever holds the
+ * promise must set its result, or the futures wait forever.
+ */
+template <class T>
+class TPromise : public TPromiseBase<T> {
+public:
+  void setValue(const T& value) const { this->state_->setValue(value); }
+};
+
+template <>
+class TPromise<void> : public TPromiseBase<void> {
+public:
+  void setValue() const { state_->setValue(); }
+};
+}
+}
+} // apache::thrift::async
+
+#endif // #ifndef _THRIFT_ASYNC_TFUTURE_H_
@@ -0,0 +1,73 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <thrift/async/TFutureClient.h>
+
+namespace apache {
+namespace thrift {
+namespace async {
+
+using stdcxx::shared_ptr;
+using transport::TMemoryBuffer;
+
+TFutureCall::TFutureCall(protocol::TProtocolFactory& protocolFactory, int32_t seqid)
+  : seqid_(seqid),
+    otrans_(new TMemoryBuffer()),
+    itrans_(new TMemoryBuffer()),
+    oprot_(protocolFactory.getProtocol(otrans_)),
+    iprot_(protocolFactory.getProtocol(itrans_)) {
+}
+
+TFutureClient::TFutureClient(shared_ptr<TAsyncChannel> channel,
+                             shared_ptr<protocol::TProtocolFactory> protocolFactory)
+  : channel_(channel), protocolFactory_(protocolFactory), seqid_(0) {
+}
+
+shared_ptr<TFutureCall> TFutureClient::newCall() {
+  int32_t seqid = seqid_.fetch_add(1, boost::memory_order_relaxed) + 1;
+  return shared_ptr<TFutureCall>(new TFutureCall(*protocolFactory_, seqid));
+}
+
+void TFutureClient::send(const shared_ptr<TFutureCall>& call,
+                         const TAsyncChannel::VoidCallback& recv) {
+  channel_->sendAndRecvMessage(recv, call->getSendBuffer(), call->getRecvBuffer());
+}
+
+TFuture<void> TFutureClient::sendOneway(const shared_ptr<TFutureCall>& call) {
+  TPromise<void> promise;
+  channel_->sendMessage(stdcxx::bind(&TFutureClient::sent, channel_, call, promise),
+                        call->getSendBuffer());
+  return promise.getFuture();
+}
+
+void TFutureClient::sent(shared_ptr<TAsyncChannel> channel,
+                         shared_ptr<TFutureCall> call,
+                         TPromise<void> promise) {
+  // call is only bound to keep the send buffer alive until the channel is done with it.
+  (void)call;
+  if (channel->error()) {
+    promise.setException(transport::TTransportException(transport::TTransportException::NOT_OPEN,
+                                                        "TFutureClient: channel failed"));
+  } else {
+    promise.setValue();
+  }
+}
+}
+}
+} // apache::thrift::async
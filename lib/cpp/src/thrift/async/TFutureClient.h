@@ -0,0 +1,149 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _THRIFT_ASYNC_TFUTURECLIENT_H_
+#define _THRIFT_ASYNC_TFUTURECLIENT_H_ 1
+
+#include <string>
+
+#include <boost/atomic.hpp>
+
+#include <thrift/TApplicationException.h>
+#include <thrift/async/TAsyncChannel.h>
+#include <thrift/async/TFuture.h>
+#include <thrift/protocol/TProtocol.h>
+#include <thrift/stdcxx.h>
+#include <thrift/transport/TBufferTransports.h>
+
+namespace apache {
+namespace thrift {
+namespace async {
+
+/**
+ * The buffers and protocols of one call of a future client, from the time
+ * its request is written until its reply is read.
+ */
+class TFutureCall {
+public:
+  TFutureCall(protocol::TProtocolFactory& protocolFactory, int32_t seqid);
+
+  int32_t getSeqid() const { return seqid_; }
+
+  protocol::TProtocol* getOutputProtocol() const { return oprot_.get(); }
+
+  transport::TMemoryBuffer* getSendBuffer() const { return otrans_.get(); }
+  transport::TMemoryBuffer* getRecvBuffer() const { return itrans_.get(); }
+
+  /**
+   * Reads the reply to a call of method name into result.  If there is no
+   * reply because the channel failed, the server answered with an exception,
+   * or the reply cannot be read, fails promise instead and returns false.
+   */
+  template <class Result, class T>
+  bool readResult(const char* name, Result& result, const TPromise<T>& promise) {
+    if (itrans_->available_read() == 0) {
+      promise.setException(transport::TTransportException(transport::TTransportException::NOT_OPEN,
+                                                          "TFutureCall: channel failed"));
+      return false;
+    }
+    try {
+      std::string fname;
+      protocol::TMessageType mtype;
+      int32_t rseqid;
+      iprot_->readMessageBegin(fname, mtype, rseqid);
+      if (mtype == protocol::T_EXCEPTION) {
+        TApplicationException x;
+        x.read(iprot_.get());
+        finishRead();
+        promise.setException(x);
+        return false;
+      }
+      if (mtype != protocol::T_REPLY || fname.compare(name) != 0) {
+        iprot_->skip(protocol::T_STRUCT);
+        finishRead();
+        promise.setException(TApplicationException(mtype != protocol::T_REPLY
+                                                       ? TApplicationException::INVALID_MESSAGE_TYPE
+                                                       : TApplicationException::WRONG_METHOD_NAME));
+        return false;
+      }
+      result.read(iprot_.get());
+      finishRead();
+      return true;
+    } catch (const protocol::TProtocolException& x) {
+      promise.setException(x);
+    } catch (const transport::TTransportException& x) {
+      promise.setException(x);
+    } catch (const TException& x) {
+      promise.setException(x);
+    }
+    return false;
+  }
+
+private:
+  void finishRead() {
+    iprot_->readMessageEnd();
+    iprot_->getTransport()->readEnd();
+  }
+
+  int32_t seqid_;
+  stdcxx::shared_ptr<transport::TMemoryBuffer> otrans_;
+  stdcxx::shared_ptr<transport::TMemoryBuffer> itrans_;
+  stdcxx::shared_ptr<protocol::TProtocol> oprot_;
+  stdcxx::shared_ptr<protocol::TProtocol> iprot_;
+};
+
+/**
+ * Base of the future clients generated with the cpp:future_style option,
+ * whose methods return a TFuture of the result right after the request is
+ * handed to the channel.  Any number of calls may be in flight at once, and
+ * any thread may make them; the futures are completed on the thread that
+ * runs the channel.
+ */
+class TFutureClient {
+public:
+  TFutureClient(stdcxx::shared_ptr<TAsyncChannel> channel,
+                stdcxx::shared_ptr<protocol::TProtocolFactory> protocolFactory);
+  virtual ~TFutureClient() {}
+
+  stdcxx::shared_ptr<TAsyncChannel> getChannel() const { return channel_; }
+
+protected:
+  /// Starts a call with a fresh seqid.
+  stdcxx::shared_ptr<TFutureCall> newCall();
+
+  /// Sends the request of call, and has recv read its reply.
+  void send(const stdcxx::shared_ptr<TFutureCall>& call, const TAsyncChannel::VoidCallback& recv);
+
+  /// Sends the request of a oneway call; the future is done once it is sent.
+  TFuture<void> sendOneway(const stdcxx::shared_ptr<TFutureCall>& call);
+
+private:
+  static void sent(stdcxx::shared_ptr<TAsyncChannel> channel,
+                   stdcxx::shared_ptr<TFutureCall> call,
+                   TPromise<void> promise);
+
+  stdcxx::shared_ptr<TAsyncChannel> channel_;
+  stdcxx::shared_ptr<protocol::TProtocolFactory> protocolFactory_;
+  boost::atomic<int32_t> seqid_;
+};
+}
+}
+} // apache::thrift::async
+
+#endif // #ifndef _THRIFT_ASYNC_TFUTURECLIENT_H_
@@ -200,6 +200,18 @@ public:
   static stdcxx::shared_ptr<ThreadManager> newSimpleThreadManager(size_t count = 4,
                                                                  size_t pendingTaskCountMax = 0);
 
+  /**
+   * Creates a thread manager with count worker threads that keeps pending tasks
+   * in count separate queues, one per worker, instead of a single shared one.
+   * Workers serve their own queue first and steal from the others when it runs
+   * dry.  Use it where many producers and workers contend on the task queue;
+   * tasks are no longer started in strict submission order.  pendingTaskCountMax
+   * works as for newSimpleThreadManager.
+   */
+  static stdcxx::shared_ptr<ThreadManager> newWorkStealingThreadManager(
+      size_t count = 4,
+      size_t pendingTaskCountMax = 0);
+
   class Task;
 
   class Worker;
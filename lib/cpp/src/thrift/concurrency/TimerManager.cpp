@@ -22,8 +22,11 @@
 #include <thrift/concurrency/Util.h>
 
 #include <assert.h>
+#include <algorithm>
+#include <cstddef>
 #include <iostream>
-#include <set>
+#include <limits>
+#include <vector>
 
 namespace apache {
 namespace thrift {
@@ -32,17 +35,106 @@ namespace concurrency {
 using stdcxx::shared_ptr;
 using stdcxx::weak_ptr;
 
+namespace {
+/// Wakeup time of a dispatcher with nothing to wait for.
+const int64_t NO_WAKEUP = (std::numeric_limits<int64_t>::max)();
+/// Wakeup time of a dispatcher that is awake and will look at new timers.
+const int64_t AWAKE = (std::numeric_limits<int64_t>::min)();
+}
+
+/**
+ * Hierarchical timing wheel
+ *
+ * Four levels of 256 slots each.  Level 0 has one slot per millisecond tick,
+ * every further level covers 256 slots of the level below, and timers more
+ * than 2^32ms away wait on an overflow list.  A timer goes into the lowest
+ * level whose range covers its distance from the current tick.  Whenever the
+ * current tick crosses a slot boundary of a higher level, that slot is
+ * cascaded: its timers are placed again, which moves them down a level.
+ *
+ * Slots are intrusive circular lists of tasks, so placing and cancelling a
+ * timer is O(1).  All methods are called with the manager's monitor held.
+ *
+ * @version $Id:$
+ */
+class TimerManager::Wheel {
+
+public:
+  struct Link {
+    Link() : prev(this), next(this) {}
+
+    bool linked() const { return next != this; }
+
+    void unlink() {
+      prev->next = next;
+      next->prev = prev;
+      prev = next = this;
+    }
+
+    void append(Link* item) {
+      item->prev = prev;
+      item->next = this;
+      prev->next = item;
+      prev = item;
+    }
+
+    Link* prev;
+    Link* next;
+  };
+
+  explicit Wheel(int64_t now) : base_(now) {
+    for (int ix = 0; ix <= LEVELS; ix++) {
+      counts_[ix] = 0;
+    }
+  }
+
+  ~Wheel() { clear(); }
+
+  /// Puts task on the wheel to fire at expiry; the wheel holds a reference.
+  void schedule(shared_ptr<Task> task, int64_t expiry);
+
+  /// Takes task off the wheel.  The caller must hold its own reference.
+  void cancel(Task* task);
+
+  /// Cancels every timer that runs runnable; returns how many there were.
+  size_t cancel(const shared_ptr<Runnable>& runnable);
+
+  /// Moves the wheel up to tick now, appending every task due to expired.
+  void advance(int64_t now, std::vector<shared_ptr<Task> >& expired);
+
+  /// Returns the next tick at which advance() has work, or NO_WAKEUP.
+  int64_t nextWakeup() const;
+
+  /// Drops every pending timer.
+  void clear();
+
+private:
+  enum { LEVEL_BITS = 8, SLOTS = 1 << LEVEL_BITS, LEVELS = 4, OVERFLOW_SLOT = LEVELS * SLOTS };
+
+  void place(Task* task);
+
+  /// Places again every task on slot, which belongs to level.
+  void cascade(Link& slot, int level);
+
+  Link slots_[LEVELS * SLOTS + 1];
+  size_t counts_[LEVELS + 1];
+
+  /// The next tick to process; everything before it has fired.
+  int64_t base_;
+};
+
 /**
  * TimerManager class
  *
  * @version $Id:$
  */
-class TimerManager::Task : public Runnable {
+class TimerManager::Task : public Runnable, public TimerManager::Wheel::Link {
 
 public:
   enum STATE { WAITING, EXECUTING, CANCELLED, COMPLETE };
 
-  Task(shared_ptr<Runnable> runnable) : runnable_(runnable), state_(WAITING) {}
+  Task(shared_ptr<Runnable> runnable)
+    : runnable_(runnable), state_(WAITING), expiry_(0LL), level_(-1) {}
 
   ~Task() {}
 
@@ -55,14 +147,347 @@ public:
 
   bool operator==(const shared_ptr<Runnable> & runnable) const { return runnable_ == runnable; }
 
-  task_iterator it_;
-
 private:
   shared_ptr<Runnable> runnable_;
   friend class TimerManager::Dispatcher;
+  friend class TimerManager;
+  friend class TimerManager::Wheel;
   STATE state_;
+  int64_t expiry_;
+  int level_;                     // wheel level while scheduled, -1 otherwise
+  shared_ptr<Task> self_;         // keeps the task alive while scheduled
+};
+
+/**
+ * Free list of task nodes
+ *
+ * add() allocates each task together with its shared_ptr control block
+ * through this pool.  When the last handle on a task is gone the memory goes
+ * back on the free list for the next add() instead of to the heap.  Timer
+ * handles can outlive the manager, so the pool deletes itself once the
+ * manager has released it and the last node has come back.
+ *
+ * @version $Id:$
+ */
+class TimerManager::TaskPool {
+
+public:
+  template <typename T>
+  class Allocator;
+
+  TaskPool() : free_(NULL), nodeSize_(0), freeCount_(0), liveCount_(0), released_(false) {}
+
+  void* allocate(size_t size) {
+    {
+      Guard g(mutex_);
+      liveCount_++;
+      if (free_ != NULL && size == nodeSize_) {
+        Node* node = free_;
+        free_ = node->next;
+        freeCount_--;
+        return node;
+      }
+    }
+    return ::operator new((std::max)(size, sizeof(Node)));
+  }
+
+  void deallocate(void* p, size_t size) {
+    bool last;
+    {
+      Guard g(mutex_);
+      liveCount_--;
+      last = released_ && liveCount_ == 0;
+      // Tasks all have the same node size; anything else is not kept.
+      if (!last && (nodeSize_ == 0 || size == nodeSize_) && freeCount_ < MAX_FREE) {
+        nodeSize_ = size;
+        Node* node = static_cast<Node*>(p);
+        node->next = free_;
+        free_ = node;
+        freeCount_++;
+        return;
+      }
+    }
+    ::operator delete(p);
+    if (last) {
+      delete this;
+    }
+  }
+
+  /// Called by the manager on destruction; the pool goes once it is unused.
+  void release() {
+    bool last;
+    {
+      Guard g(mutex_);
+      released_ = true;
+      last = liveCount_ == 0;
+    }
+    if (last) {
+      delete this;
+    }
+  }
+
+private:
+  /// Most nodes kept on the free list; the rest go back to the heap.
+  enum { MAX_FREE = 4096 };
+
+  struct Node {
+    Node* next;
+  };
+
+  ~TaskPool() {
+    while (free_ != NULL) {
+      Node* node = free_;
+      free_ = node->next;
+      ::operator delete(node);
+    }
+  }
+
+  Mutex mutex_;
+  Node* free_;
+  size_t nodeSize_;
+  size_t freeCount_;
+  size_t liveCount_;
+  bool released_;
+};
+
+template <typename T>
+class TimerManager::TaskPool::Allocator {
+public:
+  typedef T value_type;
+  typedef T* pointer;
+  typedef const T* const_pointer;
+  typedef T& reference;
+  typedef const T& const_reference;
+  typedef std::size_t size_type;
+  typedef std::ptrdiff_t difference_type;
+
+  template <typename U>
+  struct rebind {
+    typedef Allocator<U> other;
+  };
+
+  explicit Allocator(TaskPool* pool) : pool_(pool) {}
+
+  template <typename U>
+  Allocator(const Allocator<U>& that) : pool_(that.pool()) {}
+
+  TaskPool* pool() const { return pool_; }
+
+  pointer address(reference x) const { return &x; }
+  const_pointer address(const_reference x) const { return &x; }
+
+  pointer allocate(size_type n, const void* /* hint */ = 0) {
+    if (n != 1) {
+      return static_cast<pointer>(::operator new(n * sizeof(T)));
+    }
+    return static_cast<pointer>(pool_->allocate(sizeof(T)));
+  }
+
+  void deallocate(pointer p, size_type n) {
+    if (n != 1) {
+      ::operator delete(p);
+      return;
+    }
+    pool_->deallocate(p, sizeof(T));
+  }
+
+  size_type max_size() const { return (std::numeric_limits<size_type>::max)() / sizeof(T); }
+
+#ifdef BOOST_NO_CXX11_ALLOCATOR
+  void construct(pointer p, const T& value) { new (static_cast<void*>(p)) T(value); }
+  void destroy(pointer p) { p->~T(); }
+#endif
+
+  template <typename U>
+  bool operator==(const Allocator<U>& that) const {
+    return pool_ == that.pool();
+  }
+
+  template <typename U>
+  bool operator!=(const Allocator<U>& that) const {
+    return pool_ != that.pool();
+  }
+
+private:
+  TaskPool* pool_;
 };
 
+void TimerManager::Wheel::schedule(shared_ptr<Task> task, int64_t expiry) {
+  task->expiry_ = expiry;
+  task->self_ = task;
+  place(task.get());
+}
+
+void TimerManager::Wheel::place(Task* task) {
+  int64_t delta = task->expiry_ - base_;
+  int level = 0;
+  size_t slot;
+  if (delta < SLOTS) {
+    // Overdue timers fire on the next tick.
+    slot = static_cast<size_t>((delta < 0 ? base_ : task->expiry_) & (SLOTS - 1));
+  } else {
+    level = LEVELS;
+    for (int ix = 1; ix < LEVELS; ix++) {
+      if (delta < (static_cast<int64_t>(1) << (LEVEL_BITS * (ix + 1)))) {
+        level = ix;
+        break;
+      }
+    }
+    slot = level == LEVELS
+               ? static_cast<size_t>(OVERFLOW_SLOT)
+               : level * SLOTS
+                     + static_cast<size_t>((task->expiry_ >> (LEVEL_BITS * level)) & (SLOTS - 1));
+  }
+  task->level_ = level;
+  counts_[level]++;
+  slots_[slot].append(task);
+}
+
+void TimerManager::Wheel::cancel(Task* task) {
+  task->unlink();
+  counts_[task->level_]--;
+  task->level_ = -1;
+  task->self_.reset();
+}
+
+size_t TimerManager::Wheel::cancel(const shared_ptr<Runnable>& runnable) {
+  size_t count = 0;
+  for (int ix = 0; ix <= OVERFLOW_SLOT; ix++) {
+    Link& slot = slots_[ix];
+    for (Link* link = slot.next; link != &slot;) {
+      Task* task = static_cast<Task*>(link);
+      link = link->next;
+      if (*task == runnable) {
+        shared_ptr<Task> keep = task->self_;
+        cancel(task);
+        count++;
+      }
+    }
+  }
+  return count;
+}
+
+void TimerManager::Wheel::cascade(Link& slot, int level) {
+  if (!slot.linked()) {
+    return;
+  }
+  Link pending;
+  pending.next = slot.next;
+  pending.prev = slot.prev;
+  pending.next->prev = &pending;
+  pending.prev->next = &pending;
+  slot.prev = slot.next = &slot;
+
+  while (pending.linked()) {
+    Task* task = static_cast<Task*>(pending.next);
+    task->unlink();
+    counts_[level]--;
+    place(task);
+  }
+}
+
+void TimerManager::Wheel::advance(int64_t now, std::vector<shared_ptr<Task> >& expired) {
+  while (base_ <= now) {
+    if ((base_ & (SLOTS - 1)) == 0) {
+      int level = 1;
+      for (; level < LEVELS; level++) {
+        size_t index = static_cast<size_t>((base_ >> (LEVEL_BITS * level)) & (SLOTS - 1));
+        cascade(slots_[level * SLOTS + index], level);
+        if (index != 0) {
+          break;
+        }
+      }
+      if (level == LEVELS) {
+        cascade(slots_[OVERFLOW_SLOT], LEVELS);
+      }
+    }
+
+    Link& slot = slots_[base_ & (SLOTS - 1)];
+    while (slot.linked()) {
+      Task* task = static_cast<Task*>(slot.next);
+      task->unlink();
+      counts_[0]--;
+      task->level_ = -1;
+      expired.push_back(task->self_);
+      task->self_.reset();
+    }
+    ++base_;
+
+    // With the lower levels empty nothing can fire or cascade before the
+    // next slot boundary of the lowest occupied level; jump straight there.
+    if (counts_[0] == 0) {
+      int lowest = 1;
+      while (lowest <= LEVELS && counts_[lowest] == 0) {
+        lowest++;
+      }
+      if (lowest > LEVELS) {
+        base_ = now + 1;
+        break;
+      }
+      int64_t mask = (static_cast<int64_t>(1) << (LEVEL_BITS * lowest)) - 1;
+      if ((base_ & mask) != 0) {
+        int64_t boundary = (base_ | mask) + 1;
+        base_ = boundary < now + 1 ? boundary : now + 1;
+      }
+    }
+  }
+}
+
+int64_t TimerManager::Wheel::nextWakeup() const {
+  int64_t next = NO_WAKEUP;
+  if (counts_[0] > 0) {
+    for (int64_t tick = base_; tick < base_ + SLOTS; tick++) {
+      if (slots_[tick & (SLOTS - 1)].linked()) {
+        next = tick;
+        break;
+      }
+    }
+  }
+  for (int level = 1; level < LEVELS; level++) {
+    if (counts_[level] == 0) {
+      continue;
+    }
+    // Timers of a level sit up to SLOTS slots ahead of the current one; the
+    // wheel has to come back at the start of the first occupied slot.  The
+    // current slot is still pending only if base_ sits right at its start.
+    int64_t mask = (static_cast<int64_t>(1) << (LEVEL_BITS * level)) - 1;
+    int64_t current = base_ >> (LEVEL_BITS * level);
+    int64_t first = (base_ & mask) == 0 ? current : current + 1;
+    for (int64_t ix = first; ix <= current + SLOTS; ix++) {
+      if (slots_[level * SLOTS + (ix & (SLOTS - 1))].linked()) {
+        int64_t start = ix << (LEVEL_BITS * level);
+        if (start < next) {
+          next = start;
+        }
+        break;
+      }
+    }
+  }
+  if (counts_[LEVELS] > 0) {
+    int64_t mask = (static_cast<int64_t>(1) << (LEVEL_BITS * LEVELS)) - 1;
+    int64_t start = (base_ & mask) == 0 ? base_ : (base_ | mask) + 1;
+    if (start < next) {
+      next = start;
+    }
+  }
+  return next;
+}
+
+void TimerManager::Wheel::clear() {
+  for (int ix = 0; ix <= OVERFLOW_SLOT; ix++) {
+    Link& slot = slots_[ix];
+    while (slot.linked()) {
+      Task* task = static_cast<Task*>(slot.next);
+      task->unlink();
+      task->level_ = -1;
+      task->self_.reset();
+    }
+  }
+  for (int ix = 0; ix <= LEVELS; ix++) {
+    counts_[ix] = 0;
+  }
+}
+
 class TimerManager::Dispatcher : public Runnable {
 
 public:
@@ -73,8 +498,9 @@ public:
   /**
    * Dispatcher entry point
    *
-   * As long as dispatcher thread is running, pull tasks off the task taskMap_
-   * and execute.
+   * As long as dispatcher thread is running, advance the timer wheel and
+   * execute the tasks that fall due, sleeping until the next tick that has
+   * work in between.
    */
   void run() {
     {
@@ -86,45 +512,40 @@ public:
     }
 
     do {
-      std::set<shared_ptr<TimerManager::Task> > expiredTasks;
+      std::vector<shared_ptr<TimerManager::Task> > expiredTasks;
       {
         Synchronized s(manager_->monitor_);
-        task_iterator expiredTaskEnd;
         int64_t now = Util::currentTime();
-        while (manager_->state_ == TimerManager::STARTED
-               && (expiredTaskEnd = manager_->taskMap_.upper_bound(now))
-                  == manager_->taskMap_.begin()) {
-          int64_t timeout = 0LL;
-          if (!manager_->taskMap_.empty()) {
-            timeout = manager_->taskMap_.begin()->first - now;
+        while (manager_->state_ == TimerManager::STARTED) {
+          manager_->wheel_->advance(now, expiredTasks);
+          if (!expiredTasks.empty()) {
+            break;
           }
-          assert((timeout != 0 && manager_->taskCount_ > 0)
-                 || (timeout == 0 && manager_->taskCount_ == 0));
+          int64_t wakeup = manager_->wheel_->nextWakeup();
+          assert(wakeup > now);
+          assert((wakeup != NO_WAKEUP && manager_->taskCount_ > 0)
+                 || (wakeup == NO_WAKEUP && manager_->taskCount_ == 0));
+          manager_->wakeup_ = wakeup;
           try {
-            manager_->monitor_.wait(timeout);
+            manager_->monitor_.wait(wakeup == NO_WAKEUP ? 0LL : wakeup - now);
           } catch (TimedOutException&) {
           }
+          manager_->wakeup_ = AWAKE;
           now = Util::currentTime();
         }
 
         if (manager_->state_ == TimerManager::STARTED) {
-          for (task_iterator ix = manager_->taskMap_.begin(); ix != expiredTaskEnd; ix++) {
-            shared_ptr<TimerManager::Task> task = ix->second;
-            expiredTasks.insert(task);
-            task->it_ = manager_->taskMap_.end();
-            if (task->state_ == TimerManager::Task::WAITING) {
-              task->state_ = TimerManager::Task::EXECUTING;
+          for (size_t ix = 0; ix < expiredTasks.size(); ix++) {
+            if (expiredTasks[ix]->state_ == TimerManager::Task::WAITING) {
+              expiredTasks[ix]->state_ = TimerManager::Task::EXECUTING;
             }
             manager_->taskCount_--;
           }
-          manager_->taskMap_.erase(manager_->taskMap_.begin(), expiredTaskEnd);
         }
       }
 
-      for (std::set<shared_ptr<Task> >::iterator ix = expiredTasks.begin();
-           ix != expiredTasks.end();
-           ++ix) {
-        (*ix)->run();
+      for (size_t ix = 0; ix < expiredTasks.size(); ix++) {
+        expiredTasks[ix]->run();
       }
 
     } while (manager_->state_ == TimerManager::STARTED);
@@ -150,8 +571,11 @@ private:
 #endif
 
 TimerManager::TimerManager()
-  : taskCount_(0),
+  : wheel_(new Wheel(Util::currentTime())),
+    taskPool_(new TaskPool()),
+    taskCount_(0),
     state_(TimerManager::UNINITIALIZED),
+    wakeup_(AWAKE),
     dispatcher_(shared_ptr<Dispatcher>(new Dispatcher(this))) {
 }
 
@@ -171,6 +595,8 @@ TimerManager::~TimerManager() {
       // We're really hosed.
     }
   }
+
+  taskPool_->release();
 }
 
 void TimerManager::start() {
@@ -218,7 +644,7 @@ void TimerManager::stop() {
 
   if (doStop) {
     // Clean up any outstanding tasks
-    taskMap_.clear();
+    wheel_->clear();
 
     // Remove dispatcher's reference to us.
     dispatcher_->manager_ = NULL;
@@ -243,25 +669,21 @@ TimerManager::Timer TimerManager::add(shared_ptr<Runnable> task, int64_t timeout
   int64_t now = Util::currentTime();
   timeout += now;
 
+  shared_ptr<Task> timer
+      = stdcxx::allocate_shared<Task>(TaskPool::Allocator<Task>(taskPool_), task);
+
   {
     Synchronized s(monitor_);
     if (state_ != TimerManager::STARTED) {
       throw IllegalStateException();
     }
 
-    // If the task map is empty, we will kick the dispatcher for sure. Otherwise, we kick him
-    // if the expiration time is shorter than the current value. Need to test before we insert,
-    // because the new task might insert at the front.
-    bool notifyRequired = (taskCount_ == 0) ? true : timeout < taskMap_.begin()->first;
-
-    shared_ptr<Task> timer(new Task(task));
     taskCount_++;
-    timer->it_ = taskMap_.insert(std::pair<int64_t, shared_ptr<Task> >(timeout, timer));
+    wheel_->schedule(timer, timeout);
 
-    // If the task map was empty, or if we have an expiration that is earlier
-    // than any previously seen, kick the dispatcher so it can update its
-    // timeout
-    if (notifyRequired) {
+    // Kick the dispatcher if it sleeps past the new expiration so it can
+    // update its timeout
+    if (timeout < wakeup_) {
       monitor_.notify();
     }
 
@@ -304,19 +726,11 @@ void TimerManager::remove(shared_ptr<Runnable> task) {
   if (state_ != TimerManager::STARTED) {
     throw IllegalStateException();
   }
-  bool found = false;
-  for (task_iterator ix = taskMap_.begin(); ix != taskMap_.end();) {
-    if (*ix->second == task) {
-      found = true;
-      taskCount_--;
-      taskMap_.erase(ix++);
-    } else {
-      ++ix;
-    }
-  }
-  if (!found) {
+  size_t removed = wheel_->cancel(task);
+  if (removed == 0) {
     throw NoSuchTaskException();
   }
+  taskCount_ -= removed;
 }
 
 void TimerManager::remove(Timer handle) {
@@ -330,12 +744,12 @@ void TimerManager::remove(Timer handle) {
     throw NoSuchTaskException();
   }
 
-  if (task->it_ == taskMap_.end()) {
+  if (task->level_ < 0) {
     // Task is being executed
     throw UncancellableTaskException();
   }
 
-  taskMap_.erase(task->it_);
+  wheel_->cancel(task.get());
   taskCount_--;
 }
 
@@ -37,6 +37,12 @@ namespace concurrency {
  *
  * This class dispatches timer tasks when they fall due.
  *
+ * Pending timers live on a hierarchical timing wheel with millisecond ticks,
+ * so adding a timer and cancelling it through its Timer handle take constant
+ * time no matter how many timers are pending.  This suits deadlines that are
+ * almost always cancelled before they fire.  The memory of a task is kept
+ * for reuse by a later add() once its last handle is gone.
+ *
  * @version $Id:$
  */
 class TimerManager {
@@ -129,16 +135,21 @@ public:
 private:
   stdcxx::shared_ptr<const ThreadFactory> threadFactory_;
   friend class Task;
-  std::multimap<int64_t, stdcxx::shared_ptr<Task> > taskMap_;
+  class Wheel;
+  friend class Wheel;
+  stdcxx::shared_ptr<Wheel> wheel_;
+  class TaskPool;
+  friend class TaskPool;
+  TaskPool* taskPool_;
   size_t taskCount_;
   Monitor monitor_;
   STATE state_;
+  /// Time the dispatcher sleeps until; earlier timers must wake it up.
+  int64_t wakeup_;
   class Dispatcher;
   friend class Dispatcher;
   stdcxx::shared_ptr<Dispatcher> dispatcher_;
   stdcxx::shared_ptr<Thread> dispatcherThread_;
-  typedef std::multimap<int64_t, stdcxx::shared_ptr<TimerManager::Task> >::iterator task_iterator;
-  typedef std::pair<task_iterator, task_iterator> task_range;
 };
 }
 }
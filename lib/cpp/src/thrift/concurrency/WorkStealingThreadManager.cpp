@@ -0,0 +1,648 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <thrift/thrift-config.h>
+
+#include <thrift/concurrency/ThreadManager.h>
+#include <thrift/concurrency/Exception.h>
+#include <thrift/concurrency/Monitor.h>
+#include <thrift/concurrency/Util.h>
+
+#include <thrift/stdcxx.h>
+
+#include <boost/atomic.hpp>
+
+#include <deque>
+#include <map>
+#include <set>
+#include <vector>
+
+namespace apache {
+namespace thrift {
+namespace concurrency {
+
+using stdcxx::shared_ptr;
+
+/**
+ * Work-stealing ThreadManager
+ *
+ * Pending tasks are spread over a fixed number of shards, each a deque with
+ * its own mutex.  Every worker has a home shard it serves first and steals
+ * from the others when that runs dry, so producers and workers only meet on
+ * the shard they touch instead of on one queue lock.  Task accounting,
+ * the pending task limit and the decision whether a worker must be woken are
+ * done with atomics; idle workers park on a monitor that producers only
+ * touch when somebody is actually parked.
+ *
+ * The manager mutex_ is only taken to start, stop, add and remove workers,
+ * to block on the pending task limit, and to call the expire callback.
+ *
+ * @version $Id:$
+ */
+class WorkStealingThreadManager : public ThreadManager {
+
+public:
+  WorkStealingThreadManager(size_t workerCount, size_t pendingTaskCountMax)
+    : initialWorkerCount_(workerCount),
+      workerCount_(0),
+      workerMaxCount_(0),
+      nextHome_(0),
+      idleCount_(0),
+      parkedCount_(0),
+      pendingCount_(0),
+      queuedCount_(0),
+      outstandingCount_(0),
+      retireCount_(0),
+      maxWaiters_(0),
+      nextShard_(0),
+      pendingTaskCountMax_(pendingTaskCountMax),
+      expiredCount_(0),
+      state_(ThreadManager::UNINITIALIZED),
+      draining_(false),
+      maxMonitor_(&mutex_),
+      workerMonitor_(&mutex_) {
+    size_t shards = workerCount > 0 ? workerCount : 1;
+    for (size_t ix = 0; ix < shards; ix++) {
+      shards_.push_back(shared_ptr<Shard>(new Shard));
+    }
+  }
+
+  ~WorkStealingThreadManager() { stop(); }
+
+  void start();
+  void stop();
+
+  ThreadManager::STATE state() const { return state_.load(); }
+
+  shared_ptr<ThreadFactory> threadFactory() const {
+    Guard g(mutex_);
+    return threadFactory_;
+  }
+
+  void threadFactory(shared_ptr<ThreadFactory> value) {
+    Guard g(mutex_);
+    if (threadFactory_ && threadFactory_->isDetached() != value->isDetached()) {
+      throw InvalidArgumentException();
+    }
+    threadFactory_ = value;
+  }
+
+  void addWorker(size_t value);
+
+  void removeWorker(size_t value);
+
+  size_t idleWorkerCount() const { return idleCount_.load(); }
+
+  size_t workerCount() const {
+    Guard g(mutex_);
+    return workerCount_;
+  }
+
+  size_t pendingTaskCount() const { return pendingCount_.load(); }
+
+  size_t totalTaskCount() const { return outstandingCount_.load(); }
+
+  size_t pendingTaskCountMax() const { return pendingTaskCountMax_.load(); }
+
+  size_t expiredTaskCount() { return expiredCount_.load(); }
+
+  void add(shared_ptr<Runnable> value, int64_t timeout, int64_t expiration);
+
+  void remove(shared_ptr<Runnable> task);
+
+  shared_ptr<Runnable> removeNextPending();
+
+  void removeExpiredTasks() { removeExpired(false); }
+
+  void setExpireCallback(ExpireCallback expireCallback) {
+    Guard g(mutex_);
+    expireCallback_ = expireCallback;
+  }
+
+private:
+  class Worker;
+  friend class Worker;
+
+  struct Entry {
+    shared_ptr<Runnable> runnable;
+    int64_t expireTime;
+  };
+
+  struct Shard {
+    Mutex mutex;
+    std::deque<Entry> tasks;
+  };
+
+  /**
+   * Claims a pending task slot, honouring pendingTaskCountMax.
+   * \returns false if the limit has been reached
+   */
+  bool reserve() {
+    size_t max = pendingTaskCountMax_.load();
+    size_t pending = pendingCount_.load();
+    do {
+      if (max > 0 && pending >= max) {
+        return false;
+      }
+    } while (!pendingCount_.compare_exchange_weak(pending, pending + 1));
+    return true;
+  }
+
+  /**
+   * Releases count pending task slots and wakes a producer blocked on the
+   * pending task limit, if there is one.
+   */
+  void released(size_t count) {
+    pendingCount_.fetch_sub(count);
+    if (maxWaiters_.load() > 0) {
+      Guard g(mutex_);
+      maxMonitor_.notifyAll();
+    }
+  }
+
+  /// Wakes a parked worker, if there is one.
+  void wakeWorker() {
+    if (parkedCount_.load() > 0) {
+      Synchronized s(sleepMonitor_);
+      sleepMonitor_.notify();
+    }
+  }
+
+  /**
+   * Takes the next task, trying the home shard first and then stealing from
+   * the others.  Shards held by somebody else are skipped while stealing.
+   */
+  bool take(size_t home, Entry& entry);
+
+  /// Runs a task taken by a worker, or expires it if it is too old.
+  void execute(Entry& entry);
+
+  /// Calls the expire callback for each runnable and counts them expired.
+  void expired(const std::vector<shared_ptr<Runnable> >& runnables);
+
+  /**
+   * Remove one or more expired tasks.
+   * \param[in]  justOne  if true, try to remove just one task and return
+   */
+  void removeExpired(bool justOne);
+
+  /**
+   * \returns whether it is acceptable to block, depending on the current thread id
+   */
+  bool canSleep() const;
+
+  /**
+   * Lowers the maximum worker count and blocks until enough worker threads complete
+   * to get to the new maximum worker limit.  The caller is responsible for acquiring
+   * a lock on the class mutex_.
+   */
+  void removeWorkersUnderLock(size_t value);
+
+  const size_t initialWorkerCount_;
+
+  // Worker bookkeeping, guarded by mutex_.
+  size_t workerCount_;
+  size_t workerMaxCount_;
+  size_t nextHome_;
+
+  boost::atomic<size_t> idleCount_;
+  boost::atomic<size_t> parkedCount_;
+  boost::atomic<size_t> pendingCount_;   // reserved against pendingTaskCountMax
+  boost::atomic<size_t> queuedCount_;    // actually sitting in a shard
+  boost::atomic<size_t> outstandingCount_;
+  boost::atomic<size_t> retireCount_;
+  boost::atomic<size_t> maxWaiters_;
+  boost::atomic<size_t> nextShard_;
+  boost::atomic<size_t> pendingTaskCountMax_;
+  boost::atomic<size_t> expiredCount_;
+  boost::atomic<ThreadManager::STATE> state_;
+  boost::atomic<bool> draining_;
+
+  ExpireCallback expireCallback_;
+  shared_ptr<ThreadFactory> threadFactory_;
+
+  std::vector<shared_ptr<Shard> > shards_;
+
+  Mutex mutex_;
+  Monitor maxMonitor_;
+  Monitor workerMonitor_;       // used to synchronize changes in worker count
+  Monitor sleepMonitor_;        // idle workers park here
+
+  std::set<shared_ptr<Thread> > workers_;
+  std::set<shared_ptr<Thread> > deadWorkers_;
+  std::map<const Thread::id_t, shared_ptr<Thread> > idMap_;
+};
+
+class WorkStealingThreadManager::Worker : public Runnable {
+
+public:
+  Worker(WorkStealingThreadManager* manager, size_t home) : manager_(manager), home_(home) {}
+
+  /**
+   * Worker entry point
+   *
+   * A worker counts as idle whenever it is not running a task.  It takes
+   * tasks until it is asked to retire; when none can be found it parks until
+   * a producer or a retirement request wakes it up.
+   */
+  void run() {
+    {
+      Guard g(manager_->mutex_);
+      if (manager_->workerCount_ >= manager_->workerMaxCount_) {
+        manager_->deadWorkers_.insert(this->thread());
+        return;
+      }
+      // Counted idle before addWorker() can see this worker.
+      manager_->idleCount_.fetch_add(1);
+      if (++manager_->workerCount_ == manager_->workerMaxCount_) {
+        manager_->workerMonitor_.notify();
+      }
+    }
+
+    for (;;) {
+      if (retire()) {
+        break;
+      }
+
+      Entry entry;
+      if (manager_->take(home_, entry)) {
+        manager_->idleCount_.fetch_sub(1);
+        manager_->execute(entry);
+        manager_->idleCount_.fetch_add(1);
+        continue;
+      }
+
+      // The worker counts itself parked before it reads the queued count,
+      // and producers bump the queued count before they read parkedCount_,
+      // so either this worker sees the task or the producer sees this worker
+      // and notifies it once it is waiting.
+      Synchronized s(manager_->sleepMonitor_);
+      manager_->parkedCount_.fetch_add(1);
+      while (manager_->queuedCount_.load() == 0 && manager_->retireCount_.load() == 0) {
+        manager_->sleepMonitor_.wait();
+      }
+      manager_->parkedCount_.fetch_sub(1);
+    }
+
+    manager_->idleCount_.fetch_sub(1);
+
+    /**
+     * Final accounting for the worker thread that is done working
+     */
+    Guard g(manager_->mutex_);
+    manager_->deadWorkers_.insert(this->thread());
+    if (--manager_->workerCount_ == manager_->workerMaxCount_) {
+      manager_->workerMonitor_.notify();
+    }
+  }
+
+private:
+  /// Claims one outstanding retirement request; while stopping the queue is
+  /// drained first.
+  bool retire() {
+    size_t retire = manager_->retireCount_.load();
+    while (retire > 0) {
+      if (manager_->draining_.load() && manager_->pendingCount_.load() > 0) {
+        return false;
+      }
+      if (manager_->retireCount_.compare_exchange_weak(retire, retire - 1)) {
+        return true;
+      }
+    }
+    return false;
+  }
+
+  WorkStealingThreadManager* manager_;
+  const size_t home_;
+};
+
+bool WorkStealingThreadManager::take(size_t home, Entry& entry) {
+  size_t shards = shards_.size();
+  bool skipped = false;
+  for (int pass = 0; pass < 2; pass++) {
+    for (size_t ix = pass; ix < shards; ix++) {
+      Shard& shard = *shards_[(home + ix) % shards];
+      // Busy shards are skipped on the first pass and waited for on the
+      // second, so that a preempted lock holder cannot keep us spinning.
+      if (ix == 0 || pass == 1) {
+        shard.mutex.lock();
+      } else if (!shard.mutex.trylock()) {
+        skipped = true;
+        continue;
+      }
+      if (shard.tasks.empty()) {
+        shard.mutex.unlock();
+        continue;
+      }
+      // Thieves take from the back so that they rarely collide with the owner.
+      if (ix == 0) {
+        entry = shard.tasks.front();
+        shard.tasks.pop_front();
+      } else {
+        entry = shard.tasks.back();
+        shard.tasks.pop_back();
+      }
+      shard.mutex.unlock();
+      queuedCount_.fetch_sub(1);
+      released(1);
+      return true;
+    }
+    if (!skipped) {
+      break;
+    }
+  }
+  return false;
+}
+
+void WorkStealingThreadManager::execute(Entry& entry) {
+  if (entry.expireTime && entry.expireTime < Util::currentTime()) {
+    expired(std::vector<shared_ptr<Runnable> >(1, entry.runnable));
+  } else {
+    try {
+      entry.runnable->run();
+    } catch (const std::exception& e) {
+      GlobalOutput.printf("[ERROR] task->run() raised an exception: %s", e.what());
+    } catch (...) {
+      GlobalOutput.printf("[ERROR] task->run() raised an unknown exception");
+    }
+  }
+  entry.runnable.reset();
+  outstandingCount_.fetch_sub(1);
+}
+
+void WorkStealingThreadManager::expired(const std::vector<shared_ptr<Runnable> >& runnables) {
+  if (runnables.empty()) {
+    return;
+  }
+  Guard g(mutex_);
+  for (size_t ix = 0; ix < runnables.size(); ix++) {
+    if (expireCallback_) {
+      expireCallback_(runnables[ix]);
+    }
+    expiredCount_.fetch_add(1);
+  }
+}
+
+void WorkStealingThreadManager::addWorker(size_t value) {
+  Guard g(mutex_);
+  std::set<shared_ptr<Thread> > newThreads;
+  for (size_t ix = 0; ix < value; ix++) {
+    shared_ptr<Worker> worker(new Worker(this, nextHome_++ % shards_.size()));
+    newThreads.insert(threadFactory_->newThread(worker));
+  }
+
+  workerMaxCount_ += value;
+  workers_.insert(newThreads.begin(), newThreads.end());
+
+  for (std::set<shared_ptr<Thread> >::iterator ix = newThreads.begin(); ix != newThreads.end();
+       ++ix) {
+    (*ix)->start();
+    idMap_.insert(std::pair<const Thread::id_t, shared_ptr<Thread> >((*ix)->getId(), *ix));
+  }
+
+  while (workerCount_ != workerMaxCount_) {
+    workerMonitor_.wait();
+  }
+}
+
+void WorkStealingThreadManager::start() {
+  {
+    Guard g(mutex_);
+    if (state_ == ThreadManager::STOPPED) {
+      return;
+    }
+
+    if (state_ != ThreadManager::UNINITIALIZED) {
+      return;
+    }
+    if (!threadFactory_) {
+      throw InvalidArgumentException();
+    }
+    state_ = ThreadManager::STARTED;
+  }
+  addWorker(initialWorkerCount_);
+}
+
+void WorkStealingThreadManager::stop() {
+  Guard g(mutex_);
+  bool doStop = false;
+
+  ThreadManager::STATE state = state_;
+  if (state != ThreadManager::STOPPING && state != ThreadManager::JOINING
+      && state != ThreadManager::STOPPED) {
+    doStop = true;
+    state_ = ThreadManager::JOINING;
+    draining_ = true;
+  }
+
+  if (doStop) {
+    removeWorkersUnderLock(workerCount_);
+  }
+
+  state_ = ThreadManager::STOPPED;
+}
+
+void WorkStealingThreadManager::removeWorker(size_t value) {
+  Guard g(mutex_);
+  removeWorkersUnderLock(value);
+}
+
+void WorkStealingThreadManager::removeWorkersUnderLock(size_t value) {
+  if (value > workerMaxCount_) {
+    throw InvalidArgumentException();
+  }
+
+  workerMaxCount_ -= value;
+  retireCount_.fetch_add(value);
+
+  {
+    Synchronized s(sleepMonitor_);
+    sleepMonitor_.notifyAll();
+  }
+
+  while (workerCount_ != workerMaxCount_) {
+    workerMonitor_.wait();
+  }
+
+  for (std::set<shared_ptr<Thread> >::iterator ix = deadWorkers_.begin();
+       ix != deadWorkers_.end();
+       ++ix) {
+
+    // when used with a joinable thread factory, we join the threads as we remove them
+    if (!threadFactory_->isDetached()) {
+      (*ix)->join();
+    }
+
+    idMap_.erase((*ix)->getId());
+    workers_.erase(*ix);
+  }
+
+  deadWorkers_.clear();
+}
+
+bool WorkStealingThreadManager::canSleep() const {
+  Guard g(mutex_);
+  const Thread::id_t id = threadFactory_->getCurrentThreadId();
+  return idMap_.find(id) == idMap_.end();
+}
+
+void WorkStealingThreadManager::add(shared_ptr<Runnable> value,
+                                    int64_t timeout,
+                                    int64_t expiration) {
+  if (state_ != ThreadManager::STARTED) {
+    throw IllegalStateException(
+        "WorkStealingThreadManager::add ThreadManager "
+        "not started");
+  }
+
+  if (!reserve()) {
+    // if we're at a limit, remove an expired task to see if the limit clears
+    removeExpired(true);
+
+    if (!reserve()) {
+      if (!canSleep() || timeout < 0) {
+        throw TooManyPendingTasksException();
+      }
+      Guard g(mutex_);
+      maxWaiters_.fetch_add(1);
+      try {
+        while (!reserve()) {
+          maxMonitor_.wait(timeout);
+        }
+      } catch (...) {
+        maxWaiters_.fetch_sub(1);
+        throw;
+      }
+      maxWaiters_.fetch_sub(1);
+    }
+  }
+
+  outstandingCount_.fetch_add(1);
+  Entry entry;
+  entry.runnable = value;
+  entry.expireTime = expiration != 0LL ? Util::currentTime() + expiration : 0LL;
+  // Count the task before it can be taken, so that the count never drops
+  // below zero when a worker gets to it first.
+  queuedCount_.fetch_add(1);
+  try {
+    Shard& shard = *shards_[nextShard_.fetch_add(1, boost::memory_order_relaxed) % shards_.size()];
+    Guard g(shard.mutex);
+    shard.tasks.push_back(entry);
+  } catch (...) {
+    queuedCount_.fetch_sub(1);
+    outstandingCount_.fetch_sub(1);
+    released(1);
+    throw;
+  }
+
+  wakeWorker();
+}
+
+void WorkStealingThreadManager::remove(shared_ptr<Runnable> task) {
+  if (state_ != ThreadManager::STARTED) {
+    throw IllegalStateException(
+        "WorkStealingThreadManager::remove ThreadManager not "
+        "started");
+  }
+
+  for (size_t ix = 0; ix < shards_.size(); ix++) {
+    Shard& shard = *shards_[ix];
+    bool found = false;
+    {
+      Guard g(shard.mutex);
+      for (std::deque<Entry>::iterator it = shard.tasks.begin(); it != shard.tasks.end(); ++it) {
+        if (it->runnable == task) {
+          shard.tasks.erase(it);
+          found = true;
+          break;
+        }
+      }
+    }
+    if (found) {
+      queuedCount_.fetch_sub(1);
+      outstandingCount_.fetch_sub(1);
+      released(1);
+      return;
+    }
+  }
+}
+
+shared_ptr<Runnable> WorkStealingThreadManager::removeNextPending() {
+  if (state_ != ThreadManager::STARTED) {
+    throw IllegalStateException(
+        "WorkStealingThreadManager::removeNextPending "
+        "ThreadManager not started");
+  }
+
+  for (size_t ix = 0; ix < shards_.size(); ix++) {
+    Shard& shard = *shards_[ix];
+    shared_ptr<Runnable> task;
+    {
+      Guard g(shard.mutex);
+      if (!shard.tasks.empty()) {
+        task = shard.tasks.front().runnable;
+        shard.tasks.pop_front();
+      }
+    }
+    if (task) {
+      queuedCount_.fetch_sub(1);
+      outstandingCount_.fetch_sub(1);
+      released(1);
+      return task;
+    }
+  }
+
+  return shared_ptr<Runnable>();
+}
+
+void WorkStealingThreadManager::removeExpired(bool justOne) {
+  std::vector<shared_ptr<Runnable> > removed;
+  int64_t now = Util::currentTime();
+
+  for (size_t ix = 0; ix < shards_.size() && !(justOne && !removed.empty()); ix++) {
+    Shard& shard = *shards_[ix];
+    Guard g(shard.mutex);
+    for (std::deque<Entry>::iterator it = shard.tasks.begin(); it != shard.tasks.end();) {
+      if (it->expireTime > 0LL && it->expireTime < now) {
+        removed.push_back(it->runnable);
+        it = shard.tasks.erase(it);
+        if (justOne) {
+          break;
+        }
+      } else {
+        ++it;
+      }
+    }
+  }
+
+  if (!removed.empty()) {
+    queuedCount_.fetch_sub(removed.size());
+    outstandingCount_.fetch_sub(removed.size());
+    released(removed.size());
+    expired(removed);
+  }
+}
+
+shared_ptr<ThreadManager> ThreadManager::newWorkStealingThreadManager(size_t count,
+                                                                      size_t pendingTaskCountMax) {
+  return shared_ptr<ThreadManager>(new WorkStealingThreadManager(count, pendingTaskCountMax));
+}
+}
+}
+} // apache::thrift::concurrency
@@ -23,7 +23,9 @@
 #include <thrift/protocol/TProtocolDecorator.h>
 #include <thrift/TApplicationException.h>
 #include <thrift/TProcessor.h>
-#include <boost/tokenizer.hpp>
+#include <boost/functional/hash.hpp>
+#include <boost/unordered_map.hpp>
+#include <cstring>
 
 namespace apache {
 namespace thrift {
@@ -85,7 +87,7 @@ public:
  */
 class TMultiplexedProcessor : public TProcessor {
 public:
-  typedef std::map<std::string, stdcxx::shared_ptr<TProcessor> > services_t;
+  typedef boost::unordered_map<std::string, stdcxx::shared_ptr<TProcessor> > services_t;
 
   /**
     * 'Register' a service with this <code>TMultiplexedProcessor</code>.  This
@@ -164,52 +166,68 @@ public:
       throw protocol_error(in, out, name, seqid, "Unexpected message type");
     }
 
-    // Extract the service name
-    boost::tokenizer<boost::char_separator<char> > tok(name, boost::char_separator<char>(":"));
-
-    std::vector<std::string> tokens;
-    std::copy(tok.begin(), tok.end(), std::back_inserter(tokens));
-
-    // A valid message should consist of two tokens: the service
-    // name and the name of the method to call.
-    if (tokens.size() == 2) {
-      // Search for a processor associated with this service name.
-      services_t::iterator it = services.find(tokens[0]);
-
-      if (it != services.end()) {
-        stdcxx::shared_ptr<TProcessor> processor = it->second;
-        // Let the processor registered for this service name
-        // process the message.
-        return processor
-            ->process(stdcxx::shared_ptr<protocol::TProtocol>(
-                          new protocol::StoredMessageProtocol(in, tokens[1], type, seqid)),
+    // Extract the service name.  A valid message name consists of the
+    // service name and the name of the method to call, separated by ':'.
+    std::string::size_type sep = name.find(':');
+    if (sep == std::string::npos) {
+      if (defaultProcessor) {
+        // non-multiplexed client forwards to default processor
+        return defaultProcessor
+            ->process(stdcxx::make_shared<protocol::StoredMessageProtocol>(in, name, type, seqid),
                       out,
                       connectionContext);
       } else {
-        // Unknown service.
-        throw protocol_error(in, out, name, seqid, 
-            "Unknown service: " + tokens[0] +
-				". Did you forget to call registerProcessor()?");
+        throw protocol_error(in, out, name, seqid,
+            "Non-multiplexed client request dropped. "
+            "Did you forget to call defaultProcessor()?");
       }
-    } else if (tokens.size() == 1) {
-	  if (defaultProcessor) {
-        // non-multiplexed client forwards to default processor
-        return defaultProcessor            
-            ->process(stdcxx::shared_ptr<protocol::TProtocol>(
-                          new protocol::StoredMessageProtocol(in, tokens[0], type, seqid)),
-                      out,
-                      connectionContext);
-	  } else {
-		throw protocol_error(in, out, name, seqid,
-			"Non-multiplexed client request dropped. "
-			"Did you forget to call defaultProcessor()?");
-	  }
+    }
+    if (sep == 0 || sep + 1 == name.size() || name.find(':', sep + 1) != std::string::npos) {
+      throw protocol_error(in, out, name, seqid, "Wrong number of tokens.");
+    }
+
+    // Search for a processor associated with this service name, without
+    // copying it out of the message name.
+    NameRef service = {name.data(), sep};
+    services_t::const_iterator it = services.find(service, NameRefHash(), NameRefEqual());
+
+    if (it != services.end()) {
+      // Let the processor registered for this service name
+      // process the message.
+      return it->second->process(stdcxx::make_shared<protocol::StoredMessageProtocol>(
+                                     in, name.substr(sep + 1), type, seqid),
+                                 out,
+                                 connectionContext);
     } else {
-		throw protocol_error(in, out, name, seqid,
-		    "Wrong number of tokens.");
+      // Unknown service.
+      throw protocol_error(in, out, name, seqid,
+          "Unknown service: " + name.substr(0, sep) +
+          ". Did you forget to call registerProcessor()?");
     }
   }
 
+private:
+  /**
+   * A service name inside a message name, to look services up by.  Hashes
+   * the same way as the std::string keys.
+   */
+  struct NameRef {
+    const char* data;
+    std::string::size_type size;
+  };
+
+  struct NameRefHash {
+    std::size_t operator()(const NameRef& ref) const {
+      return boost::hash_range(ref.data, ref.data + ref.size);
+    }
+  };
+
+  struct NameRefEqual {
+    bool operator()(const NameRef& ref, const std::string& key) const {
+      return key.size() == ref.size && std::memcmp(key.data(), ref.data, ref.size) == 0;
+    }
+  };
+
 private:
   /** Map of service processor objects, indexed by service names. */
   services_t services;
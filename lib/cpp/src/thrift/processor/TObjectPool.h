@@ -0,0 +1,116 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef THRIFT_PROCESSOR_TOBJECTPOOL_H_
+#define THRIFT_PROCESSOR_TOBJECTPOOL_H_ 1
+
+#include <cstddef>
+
+#include <boost/atomic.hpp>
+#include <boost/noncopyable.hpp>
+
+namespace apache {
+namespace thrift {
+namespace processor {
+
+/**
+ * Keeps a few idle objects of a generated struct type, so that the strings
+ * and containers of the objects keep the memory they grew from one call to
+ * the next.  Objects are reset with __clear() (see the cpp:reuse_objects
+ * generator option) when they are released.
+ *
+ * acquire() and release() are lock-free.  A processor that serves a single
+ * connection always finds its objects in the pool; when more threads share
+ * a processor than the pool has slots, the extra calls fall back to
+ * allocating and freeing their objects.
+ */
+template <class T, std::size_t Slots = 4>
+class TObjectPool : boost::noncopyable {
+public:
+  TObjectPool() {
+    for (std::size_t i = 0; i < Slots; ++i) {
+      slots_[i].store(NULL, boost::memory_order_relaxed);
+    }
+  }
+
+  ~TObjectPool() {
+    for (std::size_t i = 0; i < Slots; ++i) {
+      delete slots_[i].load(boost::memory_order_relaxed);
+    }
+  }
+
+  /**
+   * Returns an idle object, or a new one if there is none.
+   */
+  T* acquire() {
+    for (std::size_t i = 0; i < Slots; ++i) {
+      if (slots_[i].load(boost::memory_order_relaxed) != NULL) {
+        T* obj = slots_[i].exchange(NULL, boost::memory_order_acquire);
+        if (obj != NULL) {
+          return obj;
+        }
+      }
+    }
+    return new T();
+  }
+
+  /**
+   * Clears obj and keeps it for a later acquire(), or deletes it if the
+   * pool is full.
+   */
+  void release(T* obj) {
+    obj->__clear();
+    for (std::size_t i = 0; i < Slots; ++i) {
+      T* expected = NULL;
+      if (slots_[i].load(boost::memory_order_relaxed) == NULL
+          && slots_[i].compare_exchange_strong(expected,
+                                               obj,
+                                               boost::memory_order_release,
+                                               boost::memory_order_relaxed)) {
+        return;
+      }
+    }
+    delete obj;
+  }
+
+  /**
+   * Holds an object of a pool for the lifetime of the lease.
+   */
+  class Lease : boost::noncopyable {
+  public:
+    explicit Lease(TObjectPool& pool) : pool_(pool), obj_(pool.acquire()) {}
+
+    ~Lease() { pool_.release(obj_); }
+
+    T& operator*() const { return *obj_; }
+    T* operator->() const { return obj_; }
+
+  private:
+    TObjectPool& pool_;
+    T* obj_;
+  };
+
+private:
+  boost::atomic<T*> slots_[Slots];
+};
+}
+}
+} // apache::thrift::processor
+
+#endif // #ifndef THRIFT_PROCESSOR_TOBJECTPOOL_H_
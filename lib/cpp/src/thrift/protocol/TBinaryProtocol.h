@@ -119,6 +119,24 @@ public:
 
   inline uint32_t writeBinary(const std::string& str);
 
+  inline uint32_t writeStringView(const TStringView& str);
+
+  inline uint32_t writeBinaryView(const TStringView& str);
+
+  /**
+   * Primitive lists are written as one block, byte swapped only when
+   * ByteOrder_ differs from the host's.
+   */
+  inline uint32_t writeByteList(const int8_t* bytes, uint32_t count);
+
+  inline uint32_t writeI16List(const int16_t* i16s, uint32_t count);
+
+  inline uint32_t writeI32List(const int32_t* i32s, uint32_t count);
+
+  inline uint32_t writeI64List(const int64_t* i64s, uint32_t count);
+
+  inline uint32_t writeDoubleList(const double* dubs, uint32_t count);
+
   /**
    * Reading functions
    */
@@ -166,10 +184,60 @@ public:
 
   inline uint32_t readBinary(std::string& str);
 
+  /**
+   * Reads into a view of the transport's buffer when the transport can lend
+   * it out (see TTransport::borrowShared), and into a private copy otherwise.
+   */
+  uint32_t readStringView(TStringView& str);
+
+  inline uint32_t readBinaryView(TStringView& str);
+
+  /**
+   * Primitive lists are read as one block, byte swapped in place only when
+   * ByteOrder_ differs from the host's.
+   */
+  inline uint32_t readByteList(int8_t* bytes, uint32_t count);
+
+  inline uint32_t readI16List(int16_t* i16s, uint32_t count);
+
+  inline uint32_t readI32List(int32_t* i32s, uint32_t count);
+
+  inline uint32_t readI64List(int64_t* i64s, uint32_t count);
+
+  inline uint32_t readDoubleList(double* dubs, uint32_t count);
+
+  /**
+   * Skips a value without materializing it.  String payloads and containers
+   * of fixed-width elements are stepped over on the transport directly, so
+   * skipping unknown fields never allocates.
+   */
+  uint32_t skip(TType type);
+
+  /**
+   * Values are self-contained; big and little endian byte orders are
+   * different encodings.
+   */
+  TValueEncoding getValueEncoding() const;
+
 protected:
   template <typename StrType>
   uint32_t readStringBody(StrType& str, int32_t sz);
 
+  template <typename StrType>
+  uint32_t writeStringBody(const StrType& str, bool byRef);
+
+  uint32_t skipFixedElements(uint32_t count, uint32_t width);
+
+  template <typename Wire, Wire (*Convert)(Wire)>
+  uint32_t writeFixedList(const void* values, uint32_t count);
+
+  template <typename Wire, Wire (*Convert)(Wire)>
+  uint32_t readFixedList(void* values, uint32_t count);
+
+  static uint32_t fixedListBytes(uint32_t count, uint32_t width);
+
+  static uint32_t getFixedTypeSize(TType type);
+
   Transport_* trans_;
 
   int32_t string_limit_;
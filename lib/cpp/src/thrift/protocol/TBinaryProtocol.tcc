@@ -22,6 +22,8 @@
 
 #include <thrift/protocol/TBinaryProtocol.h>
 
+#include <algorithm>
+#include <cstring>
 #include <limits>
 
 namespace apache {
@@ -36,12 +38,12 @@ uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::writeMessageBegin(const std::
     int32_t version = (VERSION_1) | ((int32_t)messageType);
     uint32_t wsize = 0;
     wsize += writeI32(version);
-    wsize += writeString(name);
+    wsize += writeStringBody(name, false);
     wsize += writeI32(seqid);
     return wsize;
   } else {
     uint32_t wsize = 0;
-    wsize += writeString(name);
+    wsize += writeStringBody(name, false);
     wsize += writeByte((int8_t)messageType);
     wsize += writeI32(seqid);
     return wsize;
@@ -177,19 +179,108 @@ uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::writeDouble(const double dub)
 template <class Transport_, class ByteOrder_>
 template <typename StrType>
 uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::writeString(const StrType& str) {
+  return writeStringBody(str, true);
+}
+
+template <class Transport_, class ByteOrder_>
+uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::writeBinary(const std::string& str) {
+  return TBinaryProtocolT<Transport_, ByteOrder_>::writeString(str);
+}
+
+template <class Transport_, class ByteOrder_>
+uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::writeStringView(const TStringView& str) {
+  return TBinaryProtocolT<Transport_, ByteOrder_>::writeString(str);
+}
+
+template <class Transport_, class ByteOrder_>
+uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::writeBinaryView(const TStringView& str) {
+  return TBinaryProtocolT<Transport_, ByteOrder_>::writeString(str);
+}
+
+template <class Transport_, class ByteOrder_>
+uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::writeByteList(const int8_t* bytes,
+                                                                 uint32_t count) {
+  this->trans_->writeRef((const uint8_t*)bytes, count);
+  return count;
+}
+
+template <class Transport_, class ByteOrder_>
+uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::writeI16List(const int16_t* i16s,
+                                                                uint32_t count) {
+  return writeFixedList<uint16_t, &ByteOrder_::toWire16>(i16s, count);
+}
+
+template <class Transport_, class ByteOrder_>
+uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::writeI32List(const int32_t* i32s,
+                                                                uint32_t count) {
+  return writeFixedList<uint32_t, &ByteOrder_::toWire32>(i32s, count);
+}
+
+template <class Transport_, class ByteOrder_>
+uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::writeI64List(const int64_t* i64s,
+                                                                uint32_t count) {
+  return writeFixedList<uint64_t, &ByteOrder_::toWire64>(i64s, count);
+}
+
+template <class Transport_, class ByteOrder_>
+uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::writeDoubleList(const double* dubs,
+                                                                   uint32_t count) {
+  BOOST_STATIC_ASSERT(sizeof(double) == sizeof(uint64_t));
+  BOOST_STATIC_ASSERT(std::numeric_limits<double>::is_iec559);
+  return writeFixedList<uint64_t, &ByteOrder_::toWire64>(dubs, count);
+}
+
+/**
+ * Field values are handed to the transport by reference, so a transport
+ * that supports it can send large ones without copying.  Message names may
+ * be temporaries and are always copied.
+ */
+template <class Transport_, class ByteOrder_>
+template <typename StrType>
+uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::writeStringBody(const StrType& str,
+                                                                   bool byRef) {
   if (str.size() > static_cast<size_t>((std::numeric_limits<int32_t>::max)()))
     throw TProtocolException(TProtocolException::SIZE_LIMIT);
   uint32_t size = static_cast<uint32_t>(str.size());
   uint32_t result = writeI32((int32_t)size);
   if (size > 0) {
-    this->trans_->write((uint8_t*)str.data(), size);
+    if (byRef) {
+      this->trans_->writeRef((uint8_t*)str.data(), size);
+    } else {
+      this->trans_->write((uint8_t*)str.data(), size);
+    }
   }
   return result + size;
 }
 
+/**
+ * Writes count values of width sizeof(Wire). In host order the array goes
+ * to the transport as is; otherwise it is converted through a stack buffer.
+ */
 template <class Transport_, class ByteOrder_>
-uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::writeBinary(const std::string& str) {
-  return TBinaryProtocolT<Transport_, ByteOrder_>::writeString(str);
+template <typename Wire, Wire (*Convert)(Wire)>
+uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::writeFixedList(const void* values,
+                                                                  uint32_t count) {
+  uint32_t bytes = fixedListBytes(count, sizeof(Wire));
+  const uint8_t* in = static_cast<const uint8_t*>(values);
+  if (TByteOrderIsNative<ByteOrder_>::value) {
+    this->trans_->writeRef(in, bytes);
+    return bytes;
+  }
+
+  Wire buf[256];
+  while (count > 0) {
+    uint32_t n = (std::min)(count, static_cast<uint32_t>(sizeof(buf) / sizeof(Wire)));
+    for (uint32_t i = 0; i < n; ++i) {
+      Wire value;
+      std::memcpy(&value, in + i * sizeof(Wire), sizeof(Wire));
+      buf[i] = Convert(value);
+    }
+    this->trans_->write((const uint8_t*)buf, n * sizeof(Wire));
+    in += n * sizeof(Wire);
+    count -= n;
+  }
+  return bytes;
 }
 
 /**
@@ -415,6 +506,94 @@ uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::readBinary(std::string& str)
   return TBinaryProtocolT<Transport_, ByteOrder_>::readString(str);
 }
 
+template <class Transport_, class ByteOrder_>
+uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::readStringView(TStringView& str) {
+  int32_t size;
+  uint32_t result = readI32(size);
+
+  // Catch error cases
+  if (size < 0) {
+    throw TProtocolException(TProtocolException::NEGATIVE_SIZE);
+  }
+  if (this->string_limit_ > 0 && size > this->string_limit_) {
+    throw TProtocolException(TProtocolException::SIZE_LIMIT);
+  }
+
+  // Catch empty string case
+  if (size == 0) {
+    str.clear();
+    return result;
+  }
+
+  // Refer to the transport's buffer if it will let us keep it
+  stdcxx::shared_ptr<void> owner;
+  uint32_t got = size;
+  const uint8_t* borrow_buf = this->trans_->borrowShared(&got, owner);
+  if (borrow_buf != NULL) {
+    str = TStringView(reinterpret_cast<const char*>(borrow_buf), size, owner);
+    this->trans_->consume(size);
+    return result + size;
+  }
+
+  stdcxx::shared_ptr<std::string> copy(new std::string);
+  result += readStringBody(*copy, size);
+  str = TStringView(copy);
+  return result;
+}
+
+template <class Transport_, class ByteOrder_>
+uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::readBinaryView(TStringView& str) {
+  return TBinaryProtocolT<Transport_, ByteOrder_>::readStringView(str);
+}
+
+template <class Transport_, class ByteOrder_>
+uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::readByteList(int8_t* bytes, uint32_t count) {
+  return this->trans_->readAll((uint8_t*)bytes, count);
+}
+
+template <class Transport_, class ByteOrder_>
+uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::readI16List(int16_t* i16s, uint32_t count) {
+  return readFixedList<uint16_t, &ByteOrder_::fromWire16>(i16s, count);
+}
+
+template <class Transport_, class ByteOrder_>
+uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::readI32List(int32_t* i32s, uint32_t count) {
+  return readFixedList<uint32_t, &ByteOrder_::fromWire32>(i32s, count);
+}
+
+template <class Transport_, class ByteOrder_>
+uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::readI64List(int64_t* i64s, uint32_t count) {
+  return readFixedList<uint64_t, &ByteOrder_::fromWire64>(i64s, count);
+}
+
+template <class Transport_, class ByteOrder_>
+uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::readDoubleList(double* dubs, uint32_t count) {
+  BOOST_STATIC_ASSERT(sizeof(double) == sizeof(uint64_t));
+  BOOST_STATIC_ASSERT(std::numeric_limits<double>::is_iec559);
+  return readFixedList<uint64_t, &ByteOrder_::fromWire64>(dubs, count);
+}
+
+/**
+ * Reads count values of width sizeof(Wire) straight into the caller's
+ * array, then converts them in place unless the wire is in host order.
+ */
+template <class Transport_, class ByteOrder_>
+template <typename Wire, Wire (*Convert)(Wire)>
+uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::readFixedList(void* values, uint32_t count) {
+  uint32_t bytes = fixedListBytes(count, sizeof(Wire));
+  uint8_t* out = static_cast<uint8_t*>(values);
+  this->trans_->readAll(out, bytes);
+  if (!TByteOrderIsNative<ByteOrder_>::value) {
+    for (uint32_t i = 0; i < count; ++i) {
+      Wire value;
+      std::memcpy(&value, out + i * sizeof(Wire), sizeof(Wire));
+      value = Convert(value);
+      std::memcpy(out + i * sizeof(Wire), &value, sizeof(Wire));
+    }
+  }
+  return bytes;
+}
+
 template <class Transport_, class ByteOrder_>
 template <typename StrType>
 uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::readStringBody(StrType& str, int32_t size) {
@@ -447,6 +626,157 @@ uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::readStringBody(StrType& str,
   this->trans_->readAll(reinterpret_cast<uint8_t*>(&str[0]), size);
   return (uint32_t)size;
 }
+
+template <class Transport_, class ByteOrder_>
+uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::skip(TType type) {
+  TInputRecursionTracker tracker(*this);
+
+  switch (type) {
+  case T_BOOL:
+  case T_BYTE:
+  case T_I16:
+  case T_I32:
+  case T_I64:
+  case T_DOUBLE: {
+    uint8_t buf[8];
+    return this->trans_->readAll(buf, getFixedTypeSize(type));
+  }
+  case T_STRING: {
+    int32_t size;
+    uint32_t result = readI32(size);
+    if (size < 0) {
+      throw TProtocolException(TProtocolException::NEGATIVE_SIZE);
+    }
+    if (this->string_limit_ > 0 && size > this->string_limit_) {
+      throw TProtocolException(TProtocolException::SIZE_LIMIT);
+    }
+    return result + transport::skipAll(*this->trans_, (uint32_t)size);
+  }
+  case T_STRUCT: {
+    uint32_t result = 0;
+    while (true) {
+      int8_t ftype;
+      int16_t fid;
+      result += readByte(ftype);
+      if (ftype == T_STOP) {
+        break;
+      }
+      result += readI16(fid);
+      result += skip((TType)ftype);
+    }
+    return result;
+  }
+  case T_MAP: {
+    TType keyType;
+    TType valType;
+    uint32_t size;
+    uint32_t result = readMapBegin(keyType, valType, size);
+    uint32_t keySize = getFixedTypeSize(keyType);
+    uint32_t valSize = getFixedTypeSize(valType);
+    if (keySize != 0 && valSize != 0) {
+      return result + skipFixedElements(size, keySize + valSize);
+    }
+    for (uint32_t i = 0; i < size; i++) {
+      result += skip(keyType);
+      result += skip(valType);
+    }
+    return result;
+  }
+  case T_SET:
+  case T_LIST: {
+    TType elemType;
+    uint32_t size;
+    uint32_t result = readListBegin(elemType, size);
+    uint32_t elemSize = getFixedTypeSize(elemType);
+    if (elemSize != 0) {
+      return result + skipFixedElements(size, elemSize);
+    }
+    for (uint32_t i = 0; i < size; i++) {
+      result += skip(elemType);
+    }
+    return result;
+  }
+  case T_STOP:
+  case T_VOID:
+  case T_U64:
+  case T_UTF8:
+  case T_UTF16:
+    break;
+  default:
+    throw TProtocolException(TProtocolException::INVALID_DATA);
+  }
+  return 0;
+}
+
+namespace detail { namespace binary {
+inline TValueEncoding binaryValueEncoding(const TNetworkBigEndian*) {
+  return T_VALUE_ENCODING_BINARY;
+}
+
+inline TValueEncoding binaryValueEncoding(const TNetworkLittleEndian*) {
+  return T_VALUE_ENCODING_BINARY_LE;
+}
+
+template <class ByteOrder_>
+inline TValueEncoding binaryValueEncoding(const ByteOrder_*) {
+  return T_VALUE_ENCODING_NONE;
+}
+}} // detail::binary
+
+template <class Transport_, class ByteOrder_>
+TValueEncoding TBinaryProtocolT<Transport_, ByteOrder_>::getValueEncoding() const {
+  return detail::binary::binaryValueEncoding(static_cast<const ByteOrder_*>(NULL));
+}
+
+/**
+ * Skips count container elements of a fixed wire width as one contiguous
+ * block.
+ */
+template <class Transport_, class ByteOrder_>
+uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::skipFixedElements(uint32_t count,
+                                                                     uint32_t width) {
+  uint64_t bytes = (uint64_t)count * width;
+  if (bytes > (std::numeric_limits<uint32_t>::max)()) {
+    throw TProtocolException(TProtocolException::SIZE_LIMIT);
+  }
+  return transport::skipAll(*this->trans_, (uint32_t)bytes);
+}
+
+/**
+ * Returns the size of a list of count values of the given width, which must
+ * fit in a single transport call.
+ */
+template <class Transport_, class ByteOrder_>
+uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::fixedListBytes(uint32_t count,
+                                                                  uint32_t width) {
+  uint64_t bytes = (uint64_t)count * width;
+  if (bytes > (std::numeric_limits<uint32_t>::max)()) {
+    throw TProtocolException(TProtocolException::SIZE_LIMIT);
+  }
+  return (uint32_t)bytes;
+}
+
+/**
+ * Returns the encoded width of a fixed-width type, or 0 if values of the
+ * type have a variable length on the wire.
+ */
+template <class Transport_, class ByteOrder_>
+uint32_t TBinaryProtocolT<Transport_, ByteOrder_>::getFixedTypeSize(TType type) {
+  switch (type) {
+  case T_BOOL:
+  case T_BYTE:
+    return 1;
+  case T_I16:
+    return 2;
+  case T_I32:
+    return 4;
+  case T_I64:
+  case T_DOUBLE:
+    return 8;
+  default:
+    return 0;
+  }
+}
 }
 }
 } // apache::thrift::protocol
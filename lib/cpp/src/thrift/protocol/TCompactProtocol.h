@@ -21,6 +21,7 @@
 #define _THRIFT_PROTOCOL_TCOMPACTPROTOCOL_H_ 1
 
 #include <thrift/protocol/TVirtualProtocol.h>
+#include <thrift/protocol/TVarintDecoder.h>
 
 #include <stack>
 #include <thrift/stdcxx.h>
@@ -140,6 +141,24 @@ public:
 
   uint32_t writeBinary(const std::string& str);
 
+  uint32_t writeStringView(const TStringView& str);
+
+  uint32_t writeBinaryView(const TStringView& str);
+
+  /**
+   * Primitive list writers. Integers are varint encoded into a stack buffer
+   * and handed to the transport in batches; bytes and doubles go as a block.
+   */
+  uint32_t writeByteList(const int8_t* bytes, uint32_t count);
+
+  uint32_t writeI16List(const int16_t* i16s, uint32_t count);
+
+  uint32_t writeI32List(const int32_t* i32s, uint32_t count);
+
+  uint32_t writeI64List(const int64_t* i64s, uint32_t count);
+
+  uint32_t writeDoubleList(const double* dubs, uint32_t count);
+
   /**
   * These methods are called by structs, but don't actually have any wired
   * output or purpose
@@ -158,6 +177,10 @@ protected:
   uint32_t writeCollectionBegin(const TType elemType, int32_t size);
   uint32_t writeVarint32(uint32_t n);
   uint32_t writeVarint64(uint64_t n);
+  template <typename StrType>
+  uint32_t writeStringBody(const StrType& str, bool byRef);
+  template <typename T>
+  uint32_t writeZigzagList(const T* in, uint32_t count);
   uint64_t i64ToZigzag(const int64_t l);
   uint32_t i32ToZigzag(const int32_t n);
   inline int8_t getCompactType(const TType ttype);
@@ -195,6 +218,41 @@ public:
 
   uint32_t readBinary(std::string& str);
 
+  /**
+   * Reads into a view of the transport's buffer when the transport can lend
+   * it out (see TTransport::borrowShared), and into a private copy otherwise.
+   */
+  uint32_t readStringView(TStringView& str);
+
+  uint32_t readBinaryView(TStringView& str);
+
+  /**
+   * Primitive list readers. Integers are decoded in whole runs from the
+   * transport's buffer at once (see TVarintDecoder.h).
+   */
+  uint32_t readByteList(int8_t* bytes, uint32_t count);
+
+  uint32_t readI16List(int16_t* i16s, uint32_t count);
+
+  uint32_t readI32List(int32_t* i32s, uint32_t count);
+
+  uint32_t readI64List(int64_t* i64s, uint32_t count);
+
+  uint32_t readDoubleList(double* dubs, uint32_t count);
+
+  /**
+   * Skips a value without materializing it.  String payloads and containers
+   * of fixed-width elements are stepped over on the transport directly, so
+   * skipping unknown fields never allocates.
+   */
+  uint32_t skip(TType type);
+
+  /**
+   * Values are self-contained: field ids are deltas within a struct only,
+   * and booleans are folded into field headers only.
+   */
+  TValueEncoding getValueEncoding() const { return T_VALUE_ENCODING_COMPACT; }
+
   /*
    *These methods are here for the struct to call, but don't have any wire
    * encoding.
@@ -208,6 +266,10 @@ public:
 protected:
   uint32_t readVarint32(int32_t& i32);
   uint32_t readVarint64(int64_t& i64);
+  uint32_t skipVarint();
+  uint32_t skipElements(TType elemType, uint32_t count);
+  template <typename T>
+  uint32_t readZigzagList(T* out, uint32_t count);
   int32_t zigzagToI32(uint32_t n);
   int64_t zigzagToI64(uint64_t n);
   TType getTType(int8_t type);
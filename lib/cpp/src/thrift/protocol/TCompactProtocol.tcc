@@ -19,6 +19,8 @@
 #ifndef _THRIFT_PROTOCOL_TCOMPACTPROTOCOL_TCC_
 #define _THRIFT_PROTOCOL_TCOMPACTPROTOCOL_TCC_ 1
 
+#include <algorithm>
+#include <cstring>
 #include <limits>
 
 #include "thrift/config.h"
@@ -82,6 +84,22 @@ const int8_t TTypeToCType[16] = {
   CT_LIST, // T_LIST
 };
 
+/**
+ * Wire width of a container element that is not varint encoded, or 0 if
+ * the element has a variable length.  Bools inside containers take a byte.
+ */
+inline uint32_t fixedElementSize(TType ttype) {
+  switch (ttype) {
+    case T_BOOL:
+    case T_BYTE:
+      return 1;
+    case T_DOUBLE:
+      return 8;
+    default:
+      return 0;
+  }
+}
+
 }} // end detail::compact namespace
 
 
@@ -94,7 +112,7 @@ uint32_t TCompactProtocolT<Transport_>::writeMessageBegin(
   wsize += writeByte(PROTOCOL_ID);
   wsize += writeByte((VERSION_N & VERSION_MASK) | (((int32_t)messageType << TYPE_SHIFT_AMOUNT) & TYPE_MASK));
   wsize += writeVarint32(seqid);
-  wsize += writeString(name);
+  wsize += writeStringBody(name, false);
   return wsize;
 }
 
@@ -272,6 +290,114 @@ uint32_t TCompactProtocolT<Transport_>::writeString(const std::string& str) {
 
 template <class Transport_>
 uint32_t TCompactProtocolT<Transport_>::writeBinary(const std::string& str) {
+  return writeStringBody(str, true);
+}
+
+template <class Transport_>
+uint32_t TCompactProtocolT<Transport_>::writeStringView(const TStringView& str) {
+  return writeStringBody(str, true);
+}
+
+template <class Transport_>
+uint32_t TCompactProtocolT<Transport_>::writeBinaryView(const TStringView& str) {
+  return writeStringBody(str, true);
+}
+
+template <class Transport_>
+uint32_t TCompactProtocolT<Transport_>::writeByteList(const int8_t* bytes, uint32_t count) {
+  trans_->writeRef((const uint8_t*)bytes, count);
+  return count;
+}
+
+template <class Transport_>
+uint32_t TCompactProtocolT<Transport_>::writeI16List(const int16_t* i16s, uint32_t count) {
+  return writeZigzagList(i16s, count);
+}
+
+template <class Transport_>
+uint32_t TCompactProtocolT<Transport_>::writeI32List(const int32_t* i32s, uint32_t count) {
+  return writeZigzagList(i32s, count);
+}
+
+template <class Transport_>
+uint32_t TCompactProtocolT<Transport_>::writeI64List(const int64_t* i64s, uint32_t count) {
+  return writeZigzagList(i64s, count);
+}
+
+/**
+ * Doubles are little endian on the wire, so on little-endian hosts the
+ * array is written as is.
+ */
+template <class Transport_>
+uint32_t TCompactProtocolT<Transport_>::writeDoubleList(const double* dubs, uint32_t count) {
+  BOOST_STATIC_ASSERT(sizeof(double) == sizeof(uint64_t));
+  BOOST_STATIC_ASSERT(std::numeric_limits<double>::is_iec559);
+
+  uint64_t bytes = (uint64_t)count * 8;
+  if (bytes > (std::numeric_limits<uint32_t>::max)()) {
+    throw TProtocolException(TProtocolException::SIZE_LIMIT);
+  }
+  if (TByteOrderIsNative<TNetworkLittleEndian>::value) {
+    trans_->writeRef((const uint8_t*)dubs, (uint32_t)bytes);
+    return (uint32_t)bytes;
+  }
+
+  uint64_t buf[256];
+  while (count > 0) {
+    uint32_t n = (std::min)(count, static_cast<uint32_t>(sizeof(buf) / sizeof(buf[0])));
+    for (uint32_t i = 0; i < n; ++i) {
+      buf[i] = THRIFT_htolell(bitwise_cast<uint64_t>(dubs[i]));
+    }
+    trans_->write((const uint8_t*)buf, n * 8);
+    dubs += n;
+    count -= n;
+  }
+  return (uint32_t)bytes;
+}
+
+/**
+ * Write count integers as zigzag varints, encoding into a stack buffer so
+ * that the transport sees one write per few hundred bytes.
+ */
+template <class Transport_>
+template <typename T>
+uint32_t TCompactProtocolT<Transport_>::writeZigzagList(const T* in, uint32_t count) {
+  uint8_t buf[512];
+  uint32_t pos = 0;
+  uint32_t wsize = 0;
+
+  for (uint32_t i = 0; i < count; ++i) {
+    uint64_t n = sizeof(T) == sizeof(int64_t) ? i64ToZigzag((int64_t)in[i])
+                                              : i32ToZigzag((int32_t)in[i]);
+    while ((n & ~0x7FL) != 0) {
+      buf[pos++] = (uint8_t)((n & 0x7F) | 0x80);
+      n >>= 7;
+    }
+    buf[pos++] = (uint8_t)n;
+    if (pos > sizeof(buf) - 10) {
+      trans_->write(buf, pos);
+      wsize += pos;
+      pos = 0;
+    }
+  }
+  if (pos > 0) {
+    trans_->write(buf, pos);
+    wsize += pos;
+  }
+  return wsize;
+}
+
+//
+// Internal Writing methods
+//
+
+/**
+ * Write a length-prefixed string.  Field values go to the transport with
+ * writeRef(); message names may be temporaries and are always copied.
+ */
+template <class Transport_>
+template <typename StrType>
+uint32_t TCompactProtocolT<Transport_>::writeStringBody(const StrType& str, bool byRef) {
   if(str.size() > (std::numeric_limits<uint32_t>::max)())
     throw TProtocolException(TProtocolException::SIZE_LIMIT);
   uint32_t ssize = static_cast<uint32_t>(str.size());
@@ -281,14 +407,14 @@ uint32_t TCompactProtocolT<Transport_>::writeBinary(const std::string& str) {
   if(ssize > (std::numeric_limits<uint32_t>::max)() - wsize)
     throw TProtocolException(TProtocolException::SIZE_LIMIT);
   wsize += ssize;
-  trans_->write((uint8_t*)str.data(), ssize);
+  if (byRef) {
+    trans_->writeRef((uint8_t*)str.data(), ssize);
+  } else {
+    trans_->write((uint8_t*)str.data(), ssize);
+  }
   return wsize;
 }
 
-//
-// Internal Writing methods
-//
-
 /**
  * The workhorse of writeFieldBegin. It has the option of doing a
  * 'type override' of the type header. This is used specifically in the
@@ -648,6 +774,84 @@ uint32_t TCompactProtocolT<Transport_>::readI64(int64_t& i64) {
   return rsize;
 }
 
+template <class Transport_>
+uint32_t TCompactProtocolT<Transport_>::readByteList(int8_t* bytes, uint32_t count) {
+  return trans_->readAll((uint8_t*)bytes, count);
+}
+
+template <class Transport_>
+uint32_t TCompactProtocolT<Transport_>::readI16List(int16_t* i16s, uint32_t count) {
+  return readZigzagList(i16s, count);
+}
+
+template <class Transport_>
+uint32_t TCompactProtocolT<Transport_>::readI32List(int32_t* i32s, uint32_t count) {
+  return readZigzagList(i32s, count);
+}
+
+template <class Transport_>
+uint32_t TCompactProtocolT<Transport_>::readI64List(int64_t* i64s, uint32_t count) {
+  return readZigzagList(i64s, count);
+}
+
+template <class Transport_>
+uint32_t TCompactProtocolT<Transport_>::readDoubleList(double* dubs, uint32_t count) {
+  BOOST_STATIC_ASSERT(sizeof(double) == sizeof(uint64_t));
+  BOOST_STATIC_ASSERT(std::numeric_limits<double>::is_iec559);
+
+  uint64_t bytes = (uint64_t)count * 8;
+  if (bytes > (std::numeric_limits<uint32_t>::max)()) {
+    throw TProtocolException(TProtocolException::SIZE_LIMIT);
+  }
+  trans_->readAll((uint8_t*)dubs, (uint32_t)bytes);
+  if (!TByteOrderIsNative<TNetworkLittleEndian>::value) {
+    for (uint32_t i = 0; i < count; ++i) {
+      uint64_t bits;
+      std::memcpy(&bits, &dubs[i], 8);
+      dubs[i] = bitwise_cast<double>(THRIFT_letohll(bits));
+    }
+  }
+  return (uint32_t)bytes;
+}
+
+/**
+ * Read count zigzag varints. Whatever the transport has buffered is decoded
+ * in one call; a varint that straddles the end of the buffer (or a transport
+ * that cannot lend its buffer) is read a byte at a time.
+ */
+template <class Transport_>
+template <typename T>
+uint32_t TCompactProtocolT<Transport_>::readZigzagList(T* out, uint32_t count) {
+  uint32_t rsize = 0;
+  while (count > 0) {
+    uint32_t avail = 1;
+    const uint8_t* borrowed = trans_->borrow(NULL, &avail);
+    uint32_t decoded = 0;
+    uint32_t used = 0;
+    if (borrowed != NULL) {
+      decoded = detail::compact::decodeZigzagVarints(borrowed, avail, out, count, &used);
+      trans_->consume(used);
+      rsize += used;
+    }
+
+    if (decoded == 0) {
+      uint8_t buf[10];  // 64 bits / (7 bits/byte) = 10 bytes.
+      uint32_t len = 0;
+      do {
+        if (UNLIKELY(len == sizeof(buf))) {
+          throw TProtocolException(TProtocolException::INVALID_DATA, "Variable-length int over 10 bytes.");
+        }
+        rsize += trans_->readAll(&buf[len], 1);
+      } while (buf[len++] & 0x80);
+      decoded = detail::compact::decodeZigzagVarints(buf, len, out, 1, &used);
+    }
+
+    out += decoded;
+    count -= decoded;
+  }
+  return rsize;
+}
+
 /**
  * No magic here - just read a double off the wire.
  */
@@ -709,6 +913,49 @@ uint32_t TCompactProtocolT<Transport_>::readBinary(std::string& str) {
   return rsize + (uint32_t)size;
 }
 
+template <class Transport_>
+uint32_t TCompactProtocolT<Transport_>::readStringView(TStringView& str) {
+  return readBinaryView(str);
+}
+
+template <class Transport_>
+uint32_t TCompactProtocolT<Transport_>::readBinaryView(TStringView& str) {
+  int32_t rsize = 0;
+  int32_t size;
+
+  rsize += readVarint32(size);
+  // Catch empty string case
+  if (size == 0) {
+    str.clear();
+    return rsize;
+  }
+
+  // Catch error cases
+  if (size < 0) {
+    throw TProtocolException(TProtocolException::NEGATIVE_SIZE);
+  }
+  if (string_limit_ > 0 && size > string_limit_) {
+    throw TProtocolException(TProtocolException::SIZE_LIMIT);
+  }
+
+  // Refer to the transport's buffer if it will let us keep it
+  stdcxx::shared_ptr<void> owner;
+  uint32_t got = size;
+  const uint8_t* borrow_buf = trans_->borrowShared(&got, owner);
+  if (borrow_buf != NULL) {
+    str = TStringView(reinterpret_cast<const char*>(borrow_buf), size, owner);
+    trans_->consume(size);
+    return rsize + (uint32_t)size;
+  }
+
+  // Otherwise read straight into the copy the view will own
+  stdcxx::shared_ptr<std::string> copy(new std::string(size, '\0'));
+  trans_->readAll(reinterpret_cast<uint8_t*>(&(*copy)[0]), size);
+  str = TStringView(copy);
+
+  return rsize + (uint32_t)size;
+}
+
 /**
  * Read an i32 from the wire as a varint. The MSB of each byte is set
  * if there is another byte to follow. This can read up to 5 bytes.
@@ -772,6 +1019,160 @@ uint32_t TCompactProtocolT<Transport_>::readVarint64(int64_t& i64) {
   }
 }
 
+/**
+ * Skip a value without materializing it. Struct field ids are tracked on
+ * the stack rather than through readStructBegin(), and string payloads are
+ * consumed straight off the transport.
+ */
+template <class Transport_>
+uint32_t TCompactProtocolT<Transport_>::skip(TType type) {
+  TInputRecursionTracker tracker(*this);
+
+  switch (type) {
+    case T_BOOL: {
+      bool value;
+      return readBool(value);
+    }
+    case T_BYTE: {
+      int8_t byte;
+      return readByte(byte);
+    }
+    case T_I16:
+    case T_I32:
+    case T_I64:
+      return skipVarint();
+    case T_DOUBLE: {
+      uint8_t buf[8];
+      return trans_->readAll(buf, 8);
+    }
+    case T_STRING: {
+      int32_t size;
+      uint32_t rsize = readVarint32(size);
+      if (size < 0) {
+        throw TProtocolException(TProtocolException::NEGATIVE_SIZE);
+      }
+      if (string_limit_ > 0 && size > string_limit_) {
+        throw TProtocolException(TProtocolException::SIZE_LIMIT);
+      }
+      return rsize + transport::skipAll(*trans_, (uint32_t)size);
+    }
+    case T_STRUCT: {
+      uint32_t rsize = 0;
+      std::string name;
+      TType fieldType;
+      int16_t fieldId;
+      int16_t parentFieldId = lastFieldId_;
+      lastFieldId_ = 0;
+      while (true) {
+        rsize += readFieldBegin(name, fieldType, fieldId);
+        if (fieldType == T_STOP) {
+          break;
+        }
+        rsize += skip(fieldType);
+      }
+      lastFieldId_ = parentFieldId;
+      return rsize;
+    }
+    case T_MAP: {
+      TType keyType;
+      TType valType;
+      uint32_t size;
+      uint32_t rsize = readMapBegin(keyType, valType, size);
+      uint32_t keySize = detail::compact::fixedElementSize(keyType);
+      uint32_t valSize = detail::compact::fixedElementSize(valType);
+      if (keySize != 0 && valSize != 0) {
+        uint64_t bytes = (uint64_t)size * (keySize + valSize);
+        if (bytes > (std::numeric_limits<uint32_t>::max)()) {
+          throw TProtocolException(TProtocolException::SIZE_LIMIT);
+        }
+        return rsize + transport::skipAll(*trans_, (uint32_t)bytes);
+      }
+      for (uint32_t i = 0; i < size; i++) {
+        rsize += skip(keyType);
+        rsize += skip(valType);
+      }
+      return rsize;
+    }
+    case T_SET:
+    case T_LIST: {
+      TType elemType;
+      uint32_t size;
+      uint32_t rsize = readListBegin(elemType, size);
+      return rsize + skipElements(elemType, size);
+    }
+    case T_STOP:
+    case T_VOID:
+    case T_U64:
+    case T_UTF8:
+    case T_UTF16:
+      break;
+    default:
+      throw TProtocolException(TProtocolException::INVALID_DATA);
+  }
+  return 0;
+}
+
+/**
+ * Skip count list or set elements. Fixed-width elements are skipped as one
+ * block, varints are scanned for their terminating byte without decoding.
+ */
+template <class Transport_>
+uint32_t TCompactProtocolT<Transport_>::skipElements(TType elemType, uint32_t count) {
+  uint32_t elemSize = detail::compact::fixedElementSize(elemType);
+  if (elemSize != 0) {
+    uint64_t bytes = (uint64_t)count * elemSize;
+    if (bytes > (std::numeric_limits<uint32_t>::max)()) {
+      throw TProtocolException(TProtocolException::SIZE_LIMIT);
+    }
+    return transport::skipAll(*trans_, (uint32_t)bytes);
+  }
+
+  uint32_t rsize = 0;
+  for (uint32_t i = 0; i < count; i++) {
+    rsize += skip(elemType);
+  }
+  return rsize;
+}
+
+/**
+ * Skip a varint by looking for the first byte without the continuation bit.
+ * This can consume up to 10 bytes.
+ */
+template <class Transport_>
+uint32_t TCompactProtocolT<Transport_>::skipVarint() {
+  uint32_t rsize = 0;
+  uint8_t buf[10];  // 64 bits / (7 bits/byte) = 10 bytes.
+  uint32_t buf_size = sizeof(buf);
+  const uint8_t* borrowed = trans_->borrow(buf, &buf_size);
+
+  // Fast path.
+  if (borrowed != NULL) {
+    while (true) {
+      uint8_t byte = borrowed[rsize];
+      rsize++;
+      if (!(byte & 0x80)) {
+        trans_->consume(rsize);
+        return rsize;
+      }
+      if (UNLIKELY(rsize == sizeof(buf))) {
+        throw TProtocolException(TProtocolException::INVALID_DATA, "Variable-length int over 10 bytes.");
+      }
+    }
+  }
+
+  // Slow path.
+  while (true) {
+    uint8_t byte;
+    rsize += trans_->readAll(&byte, 1);
+    if (!(byte & 0x80)) {
+      return rsize;
+    }
+    if (UNLIKELY(rsize >= sizeof(buf))) {
+      throw TProtocolException(TProtocolException::INVALID_DATA, "Variable-length int over 10 bytes.");
+    }
+  }
+}
+
 /**
  * Convert from zigzag int to int.
  */
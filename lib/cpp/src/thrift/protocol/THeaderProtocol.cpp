@@ -147,6 +147,34 @@ uint32_t THeaderProtocol::writeBinary(const std::string& str) {
   return proto_->writeBinary(str);
 }
 
+uint32_t THeaderProtocol::writeStringView(const TStringView& str) {
+  return proto_->writeStringView(str);
+}
+
+uint32_t THeaderProtocol::writeBinaryView(const TStringView& str) {
+  return proto_->writeBinaryView(str);
+}
+
+uint32_t THeaderProtocol::writeByteList(const int8_t* bytes, uint32_t count) {
+  return proto_->writeByteList(bytes, count);
+}
+
+uint32_t THeaderProtocol::writeI16List(const int16_t* i16s, uint32_t count) {
+  return proto_->writeI16List(i16s, count);
+}
+
+uint32_t THeaderProtocol::writeI32List(const int32_t* i32s, uint32_t count) {
+  return proto_->writeI32List(i32s, count);
+}
+
+uint32_t THeaderProtocol::writeI64List(const int64_t* i64s, uint32_t count) {
+  return proto_->writeI64List(i64s, count);
+}
+
+uint32_t THeaderProtocol::writeDoubleList(const double* dubs, uint32_t count) {
+  return proto_->writeDoubleList(dubs, count);
+}
+
 /**
  * Reading functions
  */
@@ -247,6 +275,34 @@ uint32_t THeaderProtocol::readString(std::string& str) {
 uint32_t THeaderProtocol::readBinary(std::string& binary) {
   return proto_->readBinary(binary);
 }
+
+uint32_t THeaderProtocol::readStringView(TStringView& str) {
+  return proto_->readStringView(str);
+}
+
+uint32_t THeaderProtocol::readBinaryView(TStringView& binary) {
+  return proto_->readBinaryView(binary);
+}
+
+uint32_t THeaderProtocol::readByteList(int8_t* bytes, uint32_t count) {
+  return proto_->readByteList(bytes, count);
+}
+
+uint32_t THeaderProtocol::readI16List(int16_t* i16s, uint32_t count) {
+  return proto_->readI16List(i16s, count);
+}
+
+uint32_t THeaderProtocol::readI32List(int32_t* i32s, uint32_t count) {
+  return proto_->readI32List(i32s, count);
+}
+
+uint32_t THeaderProtocol::readI64List(int64_t* i64s, uint32_t count) {
+  return proto_->readI64List(i64s, count);
+}
+
+uint32_t THeaderProtocol::readDoubleList(double* dubs, uint32_t count) {
+  return proto_->readDoubleList(dubs, count);
+}
 }
 }
 } // apache::thrift::protocol
@@ -135,6 +135,20 @@ public:
 
   uint32_t writeBinary(const std::string& str);
 
+  uint32_t writeStringView(const TStringView& str);
+
+  uint32_t writeBinaryView(const TStringView& str);
+
+  uint32_t writeByteList(const int8_t* bytes, uint32_t count);
+
+  uint32_t writeI16List(const int16_t* i16s, uint32_t count);
+
+  uint32_t writeI32List(const int32_t* i32s, uint32_t count);
+
+  uint32_t writeI64List(const int64_t* i64s, uint32_t count);
+
+  uint32_t writeDoubleList(const double* dubs, uint32_t count);
+
   /**
    * Reading functions
    */
@@ -181,6 +195,20 @@ public:
 
   uint32_t readBinary(std::string& binary);
 
+  uint32_t readStringView(TStringView& str);
+
+  uint32_t readBinaryView(TStringView& binary);
+
+  uint32_t readByteList(int8_t* bytes, uint32_t count);
+
+  uint32_t readI16List(int16_t* i16s, uint32_t count);
+
+  uint32_t readI32List(int32_t* i32s, uint32_t count);
+
+  uint32_t readI64List(int64_t* i64s, uint32_t count);
+
+  uint32_t readDoubleList(double* dubs, uint32_t count);
+
 protected:
   stdcxx::shared_ptr<THeaderTransport> trans_;
 
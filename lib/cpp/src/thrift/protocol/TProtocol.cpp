@@ -28,6 +28,108 @@ uint32_t TProtocol::skip_virt(TType type) {
   return ::apache::thrift::protocol::skip(*this, type);
 }
 
+uint32_t TProtocol::writeStringView_virt(const TStringView& str) {
+  return writeString_virt(str.str());
+}
+
+uint32_t TProtocol::writeBinaryView_virt(const TStringView& str) {
+  return writeBinary_virt(str.str());
+}
+
+uint32_t TProtocol::readStringView_virt(TStringView& str) {
+  stdcxx::shared_ptr<std::string> copy(new std::string);
+  uint32_t result = readString_virt(*copy);
+  str = TStringView(copy);
+  return result;
+}
+
+uint32_t TProtocol::readBinaryView_virt(TStringView& str) {
+  stdcxx::shared_ptr<std::string> copy(new std::string);
+  uint32_t result = readBinary_virt(*copy);
+  str = TStringView(copy);
+  return result;
+}
+
+uint32_t TProtocol::writeByteList_virt(const int8_t* bytes, uint32_t count) {
+  uint32_t result = 0;
+  for (uint32_t i = 0; i < count; ++i) {
+    result += writeByte_virt(bytes[i]);
+  }
+  return result;
+}
+
+uint32_t TProtocol::writeI16List_virt(const int16_t* i16s, uint32_t count) {
+  uint32_t result = 0;
+  for (uint32_t i = 0; i < count; ++i) {
+    result += writeI16_virt(i16s[i]);
+  }
+  return result;
+}
+
+uint32_t TProtocol::writeI32List_virt(const int32_t* i32s, uint32_t count) {
+  uint32_t result = 0;
+  for (uint32_t i = 0; i < count; ++i) {
+    result += writeI32_virt(i32s[i]);
+  }
+  return result;
+}
+
+uint32_t TProtocol::writeI64List_virt(const int64_t* i64s, uint32_t count) {
+  uint32_t result = 0;
+  for (uint32_t i = 0; i < count; ++i) {
+    result += writeI64_virt(i64s[i]);
+  }
+  return result;
+}
+
+uint32_t TProtocol::writeDoubleList_virt(const double* dubs, uint32_t count) {
+  uint32_t result = 0;
+  for (uint32_t i = 0; i < count; ++i) {
+    result += writeDouble_virt(dubs[i]);
+  }
+  return result;
+}
+
+uint32_t TProtocol::readByteList_virt(int8_t* bytes, uint32_t count) {
+  uint32_t result = 0;
+  for (uint32_t i = 0; i < count; ++i) {
+    result += readByte_virt(bytes[i]);
+  }
+  return result;
+}
+
+uint32_t TProtocol::readI16List_virt(int16_t* i16s, uint32_t count) {
+  uint32_t result = 0;
+  for (uint32_t i = 0; i < count; ++i) {
+    result += readI16_virt(i16s[i]);
+  }
+  return result;
+}
+
+uint32_t TProtocol::readI32List_virt(int32_t* i32s, uint32_t count) {
+  uint32_t result = 0;
+  for (uint32_t i = 0; i < count; ++i) {
+    result += readI32_virt(i32s[i]);
+  }
+  return result;
+}
+
+uint32_t TProtocol::readI64List_virt(int64_t* i64s, uint32_t count) {
+  uint32_t result = 0;
+  for (uint32_t i = 0; i < count; ++i) {
+    result += readI64_virt(i64s[i]);
+  }
+  return result;
+}
+
+uint32_t TProtocol::readDoubleList_virt(double* dubs, uint32_t count) {
+  uint32_t result = 0;
+  for (uint32_t i = 0; i < count; ++i) {
+    result += readDouble_virt(dubs[i]);
+  }
+  return result;
+}
+
 TProtocolFactory::~TProtocolFactory() {}
 
 }}} // apache::thrift::protocol
@@ -27,6 +27,8 @@
 
 #include <thrift/transport/TTransport.h>
 #include <thrift/protocol/TProtocolException.h>
+#include <thrift/TStringView.h>
+#include <thrift/TArena.h>
 
 #include <thrift/stdcxx.h>
 #include <boost/static_assert.hpp>
@@ -205,6 +207,18 @@ enum TMessageType {
   T_ONEWAY     = 4
 };
 
+/**
+ * Encodings in which a value's bytes stand on their own, so that they can be
+ * kept and written out again without decoding them; see
+ * TProtocol::getValueEncoding().
+ */
+enum TValueEncoding {
+  T_VALUE_ENCODING_NONE      = 0,
+  T_VALUE_ENCODING_BINARY    = 1,
+  T_VALUE_ENCODING_BINARY_LE = 2,
+  T_VALUE_ENCODING_COMPACT   = 3
+};
+
 static const uint32_t DEFAULT_RECURSION_LIMIT = 64;
 
 /**
@@ -383,6 +397,57 @@ public:
     return writeBinary_virt(str);
   }
 
+  /**
+   * Write a string or binary value held in a TStringView.  The defaults go
+   * through a temporary std::string.
+   */
+  uint32_t writeStringView(const TStringView& str) {
+    T_VIRTUAL_CALL();
+    return writeStringView_virt(str);
+  }
+  virtual uint32_t writeStringView_virt(const TStringView& str);
+
+  uint32_t writeBinaryView(const TStringView& str) {
+    T_VIRTUAL_CALL();
+    return writeBinaryView_virt(str);
+  }
+  virtual uint32_t writeBinaryView_virt(const TStringView& str);
+
+  /**
+   * Write count list elements of a primitive type from a contiguous array,
+   * after writeListBegin().  The defaults write one element at a time;
+   * protocols override them with block copies or batched encoding.
+   */
+  uint32_t writeByteList(const int8_t* bytes, uint32_t count) {
+    T_VIRTUAL_CALL();
+    return writeByteList_virt(bytes, count);
+  }
+  virtual uint32_t writeByteList_virt(const int8_t* bytes, uint32_t count);
+
+  uint32_t writeI16List(const int16_t* i16s, uint32_t count) {
+    T_VIRTUAL_CALL();
+    return writeI16List_virt(i16s, count);
+  }
+  virtual uint32_t writeI16List_virt(const int16_t* i16s, uint32_t count);
+
+  uint32_t writeI32List(const int32_t* i32s, uint32_t count) {
+    T_VIRTUAL_CALL();
+    return writeI32List_virt(i32s, count);
+  }
+  virtual uint32_t writeI32List_virt(const int32_t* i32s, uint32_t count);
+
+  uint32_t writeI64List(const int64_t* i64s, uint32_t count) {
+    T_VIRTUAL_CALL();
+    return writeI64List_virt(i64s, count);
+  }
+  virtual uint32_t writeI64List_virt(const int64_t* i64s, uint32_t count);
+
+  uint32_t writeDoubleList(const double* dubs, uint32_t count) {
+    T_VIRTUAL_CALL();
+    return writeDoubleList_virt(dubs, count);
+  }
+  virtual uint32_t writeDoubleList_virt(const double* dubs, uint32_t count);
+
   /**
    * Reading functions
    */
@@ -531,6 +596,58 @@ public:
     return readBinary_virt(str);
   }
 
+  /**
+   * Read a string or binary value into a TStringView.  Protocols that can
+   * lend out the transport's buffer (see TTransport::borrowShared) make the
+   * view refer to it directly; the defaults read into a private copy.
+   */
+  uint32_t readStringView(TStringView& str) {
+    T_VIRTUAL_CALL();
+    return readStringView_virt(str);
+  }
+  virtual uint32_t readStringView_virt(TStringView& str);
+
+  uint32_t readBinaryView(TStringView& str) {
+    T_VIRTUAL_CALL();
+    return readBinaryView_virt(str);
+  }
+  virtual uint32_t readBinaryView_virt(TStringView& str);
+
+  /**
+   * Read count list elements of a primitive type into a contiguous array,
+   * after readListBegin() has returned the size.  The defaults read one
+   * element at a time; protocols with a cheaper bulk decoding override them.
+   */
+  uint32_t readByteList(int8_t* bytes, uint32_t count) {
+    T_VIRTUAL_CALL();
+    return readByteList_virt(bytes, count);
+  }
+  virtual uint32_t readByteList_virt(int8_t* bytes, uint32_t count);
+
+  uint32_t readI16List(int16_t* i16s, uint32_t count) {
+    T_VIRTUAL_CALL();
+    return readI16List_virt(i16s, count);
+  }
+  virtual uint32_t readI16List_virt(int16_t* i16s, uint32_t count);
+
+  uint32_t readI32List(int32_t* i32s, uint32_t count) {
+    T_VIRTUAL_CALL();
+    return readI32List_virt(i32s, count);
+  }
+  virtual uint32_t readI32List_virt(int32_t* i32s, uint32_t count);
+
+  uint32_t readI64List(int64_t* i64s, uint32_t count) {
+    T_VIRTUAL_CALL();
+    return readI64List_virt(i64s, count);
+  }
+  virtual uint32_t readI64List_virt(int64_t* i64s, uint32_t count);
+
+  uint32_t readDoubleList(double* dubs, uint32_t count) {
+    T_VIRTUAL_CALL();
+    return readDoubleList_virt(dubs, count);
+  }
+  virtual uint32_t readDoubleList_virt(double* dubs, uint32_t count);
+
   /*
    * std::vector is specialized for bool, and its elements are individual bits
    * rather than bools.   We need to define a different version of readBool()
@@ -550,6 +667,16 @@ public:
   }
   virtual uint32_t skip_virt(TType type);
 
+  /**
+   * The encoding of this protocol's values, if the bytes of a value stand on
+   * their own: skip() steps over exactly the bytes of one value, and every
+   * protocol with the same encoding reads them back as that value and would
+   * write the same bytes for it.  Fields marked cpp.lazy keep such bytes
+   * instead of decoding them.  T_VALUE_ENCODING_NONE, the default, for
+   * protocols whose values depend on what surrounds them.
+   */
+  virtual TValueEncoding getValueEncoding() const { return T_VALUE_ENCODING_NONE; }
+
   inline stdcxx::shared_ptr<TTransport> getTransport() { return ptrans_; }
 
   // TODO: remove these two calls, they are for backwards
@@ -637,6 +764,18 @@ struct TNetworkLittleEndian
   static uint64_t fromWire64(uint64_t x) {return THRIFT_letohll(x);}
 };
 
+// True if ByteOrder_ matches the host, so arrays can be copied to and from
+// the wire without converting each element.
+template <class ByteOrder_>
+struct TByteOrderIsNative { static const bool value = false; };
+#if __THRIFT_BYTE_ORDER == __THRIFT_LITTLE_ENDIAN
+template <>
+struct TByteOrderIsNative<TNetworkLittleEndian> { static const bool value = true; };
+#else
+template <>
+struct TByteOrderIsNative<TNetworkBigEndian> { static const bool value = true; };
+#endif
+
 struct TOutputRecursionTracker {
   TProtocol &prot_;
   TOutputRecursionTracker(TProtocol &prot) : prot_(prot) {
@@ -759,6 +898,28 @@ uint32_t skip(Protocol_& prot, TType type) {
   return 0;
 }
 
+/**
+ * Helpers for the TArenaString fields of code generated with cpp:arena.
+ * Reads go through the current arena's scratch string, so once it has grown
+ * they do not touch the heap.  Writes hand the string's bytes to the
+ * protocol in place.
+ */
+template <class Protocol_>
+uint32_t readArenaString(Protocol_& prot, TArenaString& str, bool binary = false) {
+  TArena* arena = TArena::current();
+  std::string local;
+  std::string& scratch = arena != NULL ? arena->scratch() : local;
+  uint32_t result = binary ? prot.readBinary(scratch) : prot.readString(scratch);
+  str.assign(scratch.data(), scratch.size());
+  return result;
+}
+
+template <class Protocol_>
+uint32_t writeArenaString(Protocol_& prot, const TArenaString& str, bool binary = false) {
+  TStringView view(str.data(), str.size(), stdcxx::shared_ptr<void>());
+  return binary ? prot.writeBinaryView(view) : prot.writeStringView(view);
+}
+
 }}} // apache::thrift::protocol
 
 #endif // #define _THRIFT_PROTOCOL_TPROTOCOL_H_ 1
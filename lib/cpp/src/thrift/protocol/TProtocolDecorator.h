@@ -92,6 +92,27 @@ public:
   virtual uint32_t writeDouble_virt(const double dub) { return protocol->writeDouble(dub); }
   virtual uint32_t writeString_virt(const std::string& str) { return protocol->writeString(str); }
   virtual uint32_t writeBinary_virt(const std::string& str) { return protocol->writeBinary(str); }
+  virtual uint32_t writeStringView_virt(const TStringView& str) {
+    return protocol->writeStringView(str);
+  }
+  virtual uint32_t writeBinaryView_virt(const TStringView& str) {
+    return protocol->writeBinaryView(str);
+  }
+  virtual uint32_t writeByteList_virt(const int8_t* bytes, uint32_t count) {
+    return protocol->writeByteList(bytes, count);
+  }
+  virtual uint32_t writeI16List_virt(const int16_t* i16s, uint32_t count) {
+    return protocol->writeI16List(i16s, count);
+  }
+  virtual uint32_t writeI32List_virt(const int32_t* i32s, uint32_t count) {
+    return protocol->writeI32List(i32s, count);
+  }
+  virtual uint32_t writeI64List_virt(const int64_t* i64s, uint32_t count) {
+    return protocol->writeI64List(i64s, count);
+  }
+  virtual uint32_t writeDoubleList_virt(const double* dubs, uint32_t count) {
+    return protocol->writeDoubleList(dubs, count);
+  }
 
   virtual uint32_t readMessageBegin_virt(std::string& name,
                                          TMessageType& messageType,
@@ -140,6 +161,24 @@ public:
 
   virtual uint32_t readString_virt(std::string& str) { return protocol->readString(str); }
   virtual uint32_t readBinary_virt(std::string& str) { return protocol->readBinary(str); }
+  virtual uint32_t readStringView_virt(TStringView& str) { return protocol->readStringView(str); }
+  virtual uint32_t readBinaryView_virt(TStringView& str) { return protocol->readBinaryView(str); }
+
+  virtual uint32_t readByteList_virt(int8_t* bytes, uint32_t count) {
+    return protocol->readByteList(bytes, count);
+  }
+  virtual uint32_t readI16List_virt(int16_t* i16s, uint32_t count) {
+    return protocol->readI16List(i16s, count);
+  }
+  virtual uint32_t readI32List_virt(int32_t* i32s, uint32_t count) {
+    return protocol->readI32List(i32s, count);
+  }
+  virtual uint32_t readI64List_virt(int64_t* i64s, uint32_t count) {
+    return protocol->readI64List(i64s, count);
+  }
+  virtual uint32_t readDoubleList_virt(double* dubs, uint32_t count) {
+    return protocol->readDoubleList(dubs, count);
+  }
 
 private:
   shared_ptr<TProtocol> protocol;
@@ -0,0 +1,213 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _THRIFT_PROTOCOL_TSERIALIZEDSIZE_H_
+#define _THRIFT_PROTOCOL_TSERIALIZEDSIZE_H_ 1
+
+#include <thrift/protocol/TBinaryProtocol.h>
+#include <thrift/protocol/TCompactProtocol.h>
+
+namespace apache {
+namespace thrift {
+namespace protocol {
+
+/**
+ * Sizers count the bytes that a protocol would write for a struct, without
+ * writing them.  Code generated with cpp:serialized_size has a
+ * serializedSize<Protocol_>() method that makes the same calls on a sizer
+ * as write() makes on the protocol, so that buffers can be sized up front;
+ * see TTransport::beginFrame().
+ *
+ * TSerializedSize<Protocol_>::Sizer is the sizer of a protocol, and
+ * encoding() the encoding of its values, which tells whether the kept bytes
+ * of a TLazy field are written as they are.  Only the binary and compact
+ * protocols have one, since the sizes of other encodings depend on the
+ * values in more ways than their lengths.
+ */
+template <class Protocol_>
+struct TSerializedSize;
+
+/**
+ * Sizes of the binary protocol.  Everything but strings and containers has
+ * a fixed size, which the compiler folds into constants.
+ */
+class TBinarySizer {
+public:
+  uint32_t structBegin() { return 0; }
+  uint32_t structEnd() { return 0; }
+  uint32_t fieldBegin(TType, int16_t) { return 3; }
+  uint32_t fieldStop() { return 1; }
+  uint32_t mapBegin(TType, TType, uint32_t) { return 6; }
+  uint32_t listBegin(TType, uint32_t) { return 5; }
+  uint32_t setBegin(TType, uint32_t) { return 5; }
+  uint32_t boolean(bool) { return 1; }
+  uint32_t byte(int8_t) { return 1; }
+  uint32_t i16(int16_t) { return 2; }
+  uint32_t i32(int32_t) { return 4; }
+  uint32_t i64(int64_t) { return 8; }
+  uint32_t dbl(double) { return 8; }
+
+  /// Strings and binaries, of any type with a size().
+  template <class String_>
+  uint32_t string(const String_& str) {
+    return 4 + static_cast<uint32_t>(str.size());
+  }
+
+  /// A list<byte>, list<i16>, ... of n elements.
+  uint32_t byteList(const int8_t*, uint32_t n) { return n; }
+  uint32_t i16List(const int16_t*, uint32_t n) { return 2 * n; }
+  uint32_t i32List(const int32_t*, uint32_t n) { return 4 * n; }
+  uint32_t i64List(const int64_t*, uint32_t n) { return 8 * n; }
+  uint32_t doubleList(const double*, uint32_t n) { return 8 * n; }
+};
+
+/**
+ * Sizes of the compact protocol.  Like the protocol, a sizer is used for
+ * one struct only, since field headers depend on the previous field.
+ */
+class TCompactSizer {
+public:
+  TCompactSizer() : lastFieldId_(0), boolField_(false) {}
+
+  /// The number of bytes of n as a varint.
+  static uint32_t varint32(uint32_t n) {
+#if defined(__GNUC__)
+    return (38 - __builtin_clz(n | 1)) / 7;
+#else
+    uint32_t size = 1;
+    while (n >= 0x80) {
+      n >>= 7;
+      ++size;
+    }
+    return size;
+#endif
+  }
+
+  static uint32_t varint64(uint64_t n) {
+#if defined(__GNUC__)
+    return (70 - __builtin_clzll(n | 1)) / 7;
+#else
+    uint32_t size = 1;
+    while (n >= 0x80) {
+      n >>= 7;
+      ++size;
+    }
+    return size;
+#endif
+  }
+
+  static uint32_t zigzag32(int32_t n) {
+    return (static_cast<uint32_t>(n) << 1) ^ static_cast<uint32_t>(n >> 31);
+  }
+
+  static uint64_t zigzag64(int64_t n) {
+    return (static_cast<uint64_t>(n) << 1) ^ static_cast<uint64_t>(n >> 63);
+  }
+
+  uint32_t structBegin() { return 0; }
+  uint32_t structEnd() { return 0; }
+
+  uint32_t fieldBegin(TType type, int16_t id) {
+    // A bool field's value goes into the field header.
+    boolField_ = type == T_BOOL;
+    uint32_t size = 1;
+    if (!(id > lastFieldId_ && id - lastFieldId_ <= 15)) {
+      size += varint32(zigzag32(id));
+    }
+    lastFieldId_ = id;
+    return size;
+  }
+
+  uint32_t fieldStop() { return 1; }
+
+  uint32_t mapBegin(TType, TType, uint32_t n) { return n == 0 ? 1 : varint32(n) + 1; }
+  uint32_t listBegin(TType, uint32_t n) { return n <= 14 ? 1 : varint32(n) + 1; }
+  uint32_t setBegin(TType, uint32_t n) { return n <= 14 ? 1 : varint32(n) + 1; }
+
+  uint32_t boolean(bool) {
+    if (boolField_) {
+      boolField_ = false;
+      return 0;
+    }
+    return 1;
+  }
+
+  uint32_t byte(int8_t) { return 1; }
+  uint32_t i16(int16_t n) { return varint32(zigzag32(n)); }
+  uint32_t i32(int32_t n) { return varint32(zigzag32(n)); }
+  uint32_t i64(int64_t n) { return varint64(zigzag64(n)); }
+  uint32_t dbl(double) { return 8; }
+
+  template <class String_>
+  uint32_t string(const String_& str) {
+    uint32_t n = static_cast<uint32_t>(str.size());
+    return varint32(n) + n;
+  }
+
+  uint32_t byteList(const int8_t*, uint32_t n) { return n; }
+
+  uint32_t i16List(const int16_t* elems, uint32_t n) {
+    uint32_t size = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+      size += i16(elems[i]);
+    }
+    return size;
+  }
+
+  uint32_t i32List(const int32_t* elems, uint32_t n) {
+    uint32_t size = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+      size += i32(elems[i]);
+    }
+    return size;
+  }
+
+  uint32_t i64List(const int64_t* elems, uint32_t n) {
+    uint32_t size = 0;
+    for (uint32_t i = 0; i < n; ++i) {
+      size += i64(elems[i]);
+    }
+    return size;
+  }
+
+  uint32_t doubleList(const double*, uint32_t n) { return 8 * n; }
+
+private:
+  int16_t lastFieldId_;
+  bool boolField_;
+};
+
+template <class Transport_, class ByteOrder_>
+struct TSerializedSize<TBinaryProtocolT<Transport_, ByteOrder_> > {
+  typedef TBinarySizer Sizer;
+  static TValueEncoding encoding() {
+    return detail::binary::binaryValueEncoding(static_cast<const ByteOrder_*>(NULL));
+  }
+};
+
+template <class Transport_>
+struct TSerializedSize<TCompactProtocolT<Transport_> > {
+  typedef TCompactSizer Sizer;
+  static TValueEncoding encoding() { return T_VALUE_ENCODING_COMPACT; }
+};
+}
+}
+} // apache::thrift::protocol
+
+#endif // #ifndef _THRIFT_PROTOCOL_TSERIALIZEDSIZE_H_
@@ -0,0 +1,358 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <thrift/protocol/TTableSerializer.h>
+
+#include <typeinfo>
+
+#include <thrift/protocol/TBinaryProtocol.h>
+#include <thrift/protocol/TCompactProtocol.h>
+
+namespace apache {
+namespace thrift {
+namespace protocol {
+
+namespace {
+
+/**
+ * Finds the field with the given id, trying the one after the previous
+ * field first since writers go by ascending id.
+ */
+const TFieldSpec* findField(const TStructSpec& spec, int16_t fid, uint32_t& next) {
+  if (next < spec.numFields && spec.fields[next].id == fid) {
+    return &spec.fields[next++];
+  }
+  uint32_t lo = 0;
+  uint32_t hi = spec.numFields;
+  while (lo < hi) {
+    uint32_t mid = (lo + hi) / 2;
+    if (spec.fields[mid].id < fid) {
+      lo = mid + 1;
+    } else {
+      hi = mid;
+    }
+  }
+  if (lo < spec.numFields && spec.fields[lo].id == fid) {
+    next = lo + 1;
+    return &spec.fields[lo];
+  }
+  return NULL;
+}
+
+template <class Protocol_>
+uint32_t readFields(Protocol_* iprot, void* obj, const TStructSpec& spec);
+
+template <class Protocol_>
+uint32_t writeFields(Protocol_* oprot, const void* obj, const TStructSpec& spec);
+
+template <class Protocol_>
+uint32_t readValue(Protocol_* iprot, const TValueSpec& spec, void* value);
+
+template <class Protocol_>
+uint32_t writeValue(Protocol_* oprot, const TValueSpec& spec, const void* value);
+
+/// What TElementReader and TElementWriter callbacks get as their context.
+template <class Protocol_>
+struct ElementContext {
+  Protocol_* prot;
+  const TValueSpec* key;
+  const TValueSpec* value;
+  uint32_t xfer;
+};
+
+template <class Protocol_>
+void readElement(void* ctx, void* key, void* value) {
+  ElementContext<Protocol_>* c = static_cast<ElementContext<Protocol_>*>(ctx);
+  if (key != NULL) {
+    c->xfer += readValue(c->prot, *c->key, key);
+  }
+  if (value != NULL) {
+    c->xfer += readValue(c->prot, *c->value, value);
+  }
+}
+
+template <class Protocol_>
+void writeElement(void* ctx, const void* key, const void* value) {
+  ElementContext<Protocol_>* c = static_cast<ElementContext<Protocol_>*>(ctx);
+  c->xfer += writeValue(c->prot, *c->key, key);
+  if (value != NULL) {
+    c->xfer += writeValue(c->prot, *c->value, value);
+  }
+}
+
+template <class Protocol_>
+uint32_t readList(Protocol_* iprot, const TValueSpec& spec, void* value) {
+  const TContainerOps& ops = *spec.containerOps;
+  uint32_t xfer = 0;
+  TType etype;
+  uint32_t size;
+  ops.clear(value);
+  xfer += iprot->readListBegin(etype, size);
+  char* elems = static_cast<char*>(ops.resize(value, size));
+  if (size > 0) {
+    switch (spec.elem->kind) {
+    case T_KIND_BYTE:
+      xfer += iprot->readByteList(reinterpret_cast<int8_t*>(elems), size);
+      break;
+    case T_KIND_I16:
+      xfer += iprot->readI16List(reinterpret_cast<int16_t*>(elems), size);
+      break;
+    case T_KIND_I32:
+      xfer += iprot->readI32List(reinterpret_cast<int32_t*>(elems), size);
+      break;
+    case T_KIND_I64:
+      xfer += iprot->readI64List(reinterpret_cast<int64_t*>(elems), size);
+      break;
+    case T_KIND_DOUBLE:
+      xfer += iprot->readDoubleList(reinterpret_cast<double*>(elems), size);
+      break;
+    default:
+      for (uint32_t i = 0; i < size; ++i) {
+        xfer += readValue(iprot, *spec.elem, elems + i * ops.elemSize);
+      }
+      break;
+    }
+  }
+  xfer += iprot->readListEnd();
+  return xfer;
+}
+
+template <class Protocol_>
+uint32_t writeList(Protocol_* oprot, const TValueSpec& spec, const void* value) {
+  const TContainerOps& ops = *spec.containerOps;
+  uint32_t xfer = 0;
+  uint32_t size = ops.size(value);
+  xfer += oprot->writeListBegin(spec.elem->type, size);
+  const char* elems = static_cast<const char*>(ops.data(value));
+  if (size > 0) {
+    switch (spec.elem->kind) {
+    case T_KIND_BYTE:
+      xfer += oprot->writeByteList(reinterpret_cast<const int8_t*>(elems), size);
+      break;
+    case T_KIND_I16:
+      xfer += oprot->writeI16List(reinterpret_cast<const int16_t*>(elems), size);
+      break;
+    case T_KIND_I32:
+      xfer += oprot->writeI32List(reinterpret_cast<const int32_t*>(elems), size);
+      break;
+    case T_KIND_I64:
+      xfer += oprot->writeI64List(reinterpret_cast<const int64_t*>(elems), size);
+      break;
+    case T_KIND_DOUBLE:
+      xfer += oprot->writeDoubleList(reinterpret_cast<const double*>(elems), size);
+      break;
+    default:
+      for (uint32_t i = 0; i < size; ++i) {
+        xfer += writeValue(oprot, *spec.elem, elems + i * ops.elemSize);
+      }
+      break;
+    }
+  }
+  xfer += oprot->writeListEnd();
+  return xfer;
+}
+
+template <class Protocol_>
+uint32_t readValue(Protocol_* iprot, const TValueSpec& spec, void* value) {
+  switch (spec.kind) {
+  case T_KIND_BOOL: {
+    bool v;
+    uint32_t xfer = iprot->readBool(v);
+    *static_cast<bool*>(value) = v;
+    return xfer;
+  }
+  case T_KIND_BYTE:
+    return iprot->readByte(*static_cast<int8_t*>(value));
+  case T_KIND_I16:
+    return iprot->readI16(*static_cast<int16_t*>(value));
+  case T_KIND_I32:
+  case T_KIND_ENUM:
+    return iprot->readI32(*static_cast<int32_t*>(value));
+  case T_KIND_I64:
+    return iprot->readI64(*static_cast<int64_t*>(value));
+  case T_KIND_DOUBLE:
+    return iprot->readDouble(*static_cast<double*>(value));
+  case T_KIND_STRING:
+    return iprot->readString(*static_cast<std::string*>(value));
+  case T_KIND_BINARY:
+    return iprot->readBinary(*static_cast<std::string*>(value));
+  case T_KIND_STRUCT:
+    if (spec.table != NULL) {
+      return readFields(iprot, value, *spec.table);
+    }
+    return spec.structOps->read(iprot, value);
+  case T_KIND_LIST:
+    return readList(iprot, spec, value);
+  case T_KIND_SET: {
+    ElementContext<Protocol_> ctx = {iprot, spec.elem, NULL, 0};
+    TType etype;
+    uint32_t size;
+    spec.containerOps->clear(value);
+    ctx.xfer += iprot->readSetBegin(etype, size);
+    for (uint32_t i = 0; i < size; ++i) {
+      spec.containerOps->insert(value, &readElement<Protocol_>, &ctx);
+    }
+    ctx.xfer += iprot->readSetEnd();
+    return ctx.xfer;
+  }
+  case T_KIND_MAP: {
+    ElementContext<Protocol_> ctx = {iprot, spec.key, spec.elem, 0};
+    TType ktype;
+    TType vtype;
+    uint32_t size;
+    spec.containerOps->clear(value);
+    ctx.xfer += iprot->readMapBegin(ktype, vtype, size);
+    for (uint32_t i = 0; i < size; ++i) {
+      spec.containerOps->insert(value, &readElement<Protocol_>, &ctx);
+    }
+    ctx.xfer += iprot->readMapEnd();
+    return ctx.xfer;
+  }
+  }
+  throw TProtocolException(TProtocolException::INVALID_DATA, "Bad kind in struct table");
+}
+
+template <class Protocol_>
+uint32_t writeValue(Protocol_* oprot, const TValueSpec& spec, const void* value) {
+  switch (spec.kind) {
+  case T_KIND_BOOL:
+    return oprot->writeBool(*static_cast<const bool*>(value));
+  case T_KIND_BYTE:
+    return oprot->writeByte(*static_cast<const int8_t*>(value));
+  case T_KIND_I16:
+    return oprot->writeI16(*static_cast<const int16_t*>(value));
+  case T_KIND_I32:
+  case T_KIND_ENUM:
+    return oprot->writeI32(*static_cast<const int32_t*>(value));
+  case T_KIND_I64:
+    return oprot->writeI64(*static_cast<const int64_t*>(value));
+  case T_KIND_DOUBLE:
+    return oprot->writeDouble(*static_cast<const double*>(value));
+  case T_KIND_STRING:
+    return oprot->writeString(*static_cast<const std::string*>(value));
+  case T_KIND_BINARY:
+    return oprot->writeBinary(*static_cast<const std::string*>(value));
+  case T_KIND_STRUCT:
+    if (spec.table != NULL) {
+      return writeFields(oprot, value, *spec.table);
+    }
+    return spec.structOps->write(oprot, value);
+  case T_KIND_LIST:
+    return writeList(oprot, spec, value);
+  case T_KIND_SET: {
+    ElementContext<Protocol_> ctx = {oprot, spec.elem, NULL, 0};
+    ctx.xfer += oprot->writeSetBegin(spec.elem->type, spec.containerOps->size(value));
+    spec.containerOps->visit(value, &writeElement<Protocol_>, &ctx);
+    ctx.xfer += oprot->writeSetEnd();
+    return ctx.xfer;
+  }
+  case T_KIND_MAP: {
+    ElementContext<Protocol_> ctx = {oprot, spec.key, spec.elem, 0};
+    ctx.xfer += oprot->writeMapBegin(spec.key->type,
+                                     spec.elem->type,
+                                     spec.containerOps->size(value));
+    spec.containerOps->visit(value, &writeElement<Protocol_>, &ctx);
+    ctx.xfer += oprot->writeMapEnd();
+    return ctx.xfer;
+  }
+  }
+  throw TProtocolException(TProtocolException::INVALID_DATA, "Bad kind in struct table");
+}
+
+template <class Protocol_>
+uint32_t readFields(Protocol_* iprot, void* obj, const TStructSpec& spec) {
+  TInputRecursionTracker tracker(*iprot);
+  uint32_t xfer = 0;
+  std::string fname;
+  TType ftype;
+  int16_t fid;
+  uint64_t required = 0;
+  uint32_t next = 0;
+
+  xfer += iprot->readStructBegin(fname);
+  while (true) {
+    xfer += iprot->readFieldBegin(fname, ftype, fid);
+    if (ftype == T_STOP) {
+      break;
+    }
+    const TFieldSpec* field = findField(spec, fid, next);
+    if (field != NULL && field->value.type == ftype) {
+      xfer += readValue(iprot, field->value, static_cast<char*>(obj) + field->offset);
+      if (field->flags & T_FIELD_REQUIRED) {
+        required |= static_cast<uint64_t>(1) << field->bit;
+      } else {
+        spec.setIsset(obj, field->bit);
+      }
+    } else {
+      xfer += iprot->skip(ftype);
+    }
+    xfer += iprot->readFieldEnd();
+  }
+  xfer += iprot->readStructEnd();
+
+  uint64_t all = spec.numRequired >= 64 ? ~static_cast<uint64_t>(0)
+                                        : (static_cast<uint64_t>(1) << spec.numRequired) - 1;
+  if (required != all) {
+    throw TProtocolException(TProtocolException::INVALID_DATA);
+  }
+  return xfer;
+}
+
+template <class Protocol_>
+uint32_t writeFields(Protocol_* oprot, const void* obj, const TStructSpec& spec) {
+  TOutputRecursionTracker tracker(*oprot);
+  uint32_t xfer = 0;
+  xfer += oprot->writeStructBegin(spec.name);
+  for (uint32_t i = 0; i < spec.numFields; ++i) {
+    const TFieldSpec& field = spec.fields[i];
+    if ((field.flags & T_FIELD_CHECK_ISSET) && !spec.testIsset(obj, field.bit)) {
+      continue;
+    }
+    xfer += oprot->writeFieldBegin(field.name, field.value.type, field.id);
+    xfer += writeValue(oprot, field.value, static_cast<const char*>(obj) + field.offset);
+    xfer += oprot->writeFieldEnd();
+  }
+  xfer += oprot->writeFieldStop();
+  xfer += oprot->writeStructEnd();
+  return xfer;
+}
+}
+
+uint32_t readTable(TProtocol* iprot, void* obj, const TStructSpec& spec) {
+  const std::type_info& type = typeid(*iprot);
+  if (type == typeid(TBinaryProtocol)) {
+    return readFields(static_cast<TBinaryProtocol*>(iprot), obj, spec);
+  } else if (type == typeid(TCompactProtocol)) {
+    return readFields(static_cast<TCompactProtocol*>(iprot), obj, spec);
+  }
+  return readFields(iprot, obj, spec);
+}
+
+uint32_t writeTable(TProtocol* oprot, const void* obj, const TStructSpec& spec) {
+  const std::type_info& type = typeid(*oprot);
+  if (type == typeid(TBinaryProtocol)) {
+    return writeFields(static_cast<TBinaryProtocol*>(oprot), obj, spec);
+  } else if (type == typeid(TCompactProtocol)) {
+    return writeFields(static_cast<TCompactProtocol*>(oprot), obj, spec);
+  }
+  return writeFields(oprot, obj, spec);
+}
+}
+}
+} // apache::thrift::protocol
@@ -0,0 +1,276 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _THRIFT_PROTOCOL_TTABLESERIALIZER_H_
+#define _THRIFT_PROTOCOL_TTABLESERIALIZER_H_ 1
+
+#include <cstddef>
+#include <string>
+
+#include <boost/static_assert.hpp>
+#include <boost/type_traits/is_virtual_base_of.hpp>
+
+#include <thrift/protocol/TProtocol.h>
+
+namespace apache {
+namespace thrift {
+namespace protocol {
+
+/**
+ * Table-driven serialization of generated structs.
+ *
+ * Structs generated with the cpp.table annotation, or with the cpp:tables
+ * option, describe their fields in constant TStructSpec tables, and their
+ * read() and write() methods only call readTable() and writeTable().  One
+ * copy of the serialization loop is shared by all such structs, so the
+ * generated code shrinks to a few words of data per field, at some cost in
+ * speed compared with the unrolled methods.
+ */
+
+/**
+ * How a value described by a TValueSpec is held in memory.
+ */
+enum TValueKind {
+  T_KIND_BOOL,   // bool
+  T_KIND_BYTE,   // int8_t
+  T_KIND_I16,    // int16_t
+  T_KIND_I32,    // int32_t
+  T_KIND_I64,    // int64_t
+  T_KIND_DOUBLE, // double
+  T_KIND_ENUM,   // a generated enum, which has the size of an int32_t
+  T_KIND_STRING, // std::string
+  T_KIND_BINARY, // std::string
+  T_KIND_STRUCT, // a generated struct
+  T_KIND_LIST,   // a container with contiguous elements, such as std::vector
+  T_KIND_SET,    // a std::set or alike
+  T_KIND_MAP     // a std::map or alike
+};
+
+/// Flags of a TFieldSpec.
+enum TFieldFlags {
+  /// The field has no isset bit, and read() fails without it.
+  T_FIELD_REQUIRED = 1,
+  /// The field is only written if its isset bit is set.
+  T_FIELD_CHECK_ISSET = 2
+};
+
+struct TStructSpec;
+
+/**
+ * Reads and writes a struct that has no table, through its own methods.
+ */
+struct TStructOps {
+  uint32_t (*read)(TProtocol* iprot, void* obj);
+  uint32_t (*write)(TProtocol* oprot, const void* obj);
+};
+
+/// Fills in the key or the value of a container element, whichever is set.
+typedef void (*TElementReader)(void* ctx, void* key, void* value);
+
+/// Writes a container element.  value is NULL for sets.
+typedef void (*TElementWriter)(void* ctx, const void* key, const void* value);
+
+/**
+ * Type-erased access to a container.  Lists use resize() and data(), sets
+ * and maps insert() and visit().
+ */
+struct TContainerOps {
+  size_t elemSize;
+  uint32_t (*size)(const void* c);
+  void (*clear)(void* c);
+  void* (*resize)(void* c, uint32_t n);
+  const void* (*data)(const void* c);
+  void (*insert)(void* c, TElementReader read, void* ctx);
+  void (*visit)(const void* c, TElementWriter write, void* ctx);
+};
+
+/**
+ * The type of a field or container element.
+ */
+struct TValueSpec {
+  /// The type on the wire.
+  TType type;
+  TValueKind kind;
+  /// Structs: the struct's table, or NULL to go through structOps instead.
+  const TStructSpec* table;
+  const TStructOps* structOps;
+  /// Containers
+  const TContainerOps* containerOps;
+  /// List and set elements, and map values.
+  const TValueSpec* elem;
+  /// Map keys
+  const TValueSpec* key;
+};
+
+struct TFieldSpec {
+  int16_t id;
+  uint16_t flags;
+  /// The field's index among the members of __isset, or for a required
+  /// field its index among the required fields.
+  uint16_t bit;
+  uint32_t offset;
+  const char* name;
+  TValueSpec value;
+};
+
+struct TStructSpec {
+  const char* name;
+  /// The fields by ascending id.
+  const TFieldSpec* fields;
+  uint16_t numFields;
+  /// At most 64.
+  uint16_t numRequired;
+  /// Get and set the member of __isset for a field's bit, as the layout of
+  /// bit-fields differs between ABIs; NULL if the struct has no __isset.
+  bool (*testIsset)(const void* obj, uint16_t bit);
+  void (*setIsset)(void* obj, uint16_t bit);
+};
+
+/**
+ * Reads a struct described by spec into obj, as its generated read() would.
+ * The binary and compact protocols are called directly, others through
+ * their virtual methods.
+ */
+uint32_t readTable(TProtocol* iprot, void* obj, const TStructSpec& spec);
+
+/**
+ * Writes a struct described by spec, as its generated write() would.
+ */
+uint32_t writeTable(TProtocol* oprot, const void* obj, const TStructSpec& spec);
+
+/// TStructOps of a generated struct.
+template <class Struct_>
+struct TStructMethods {
+  static uint32_t read(TProtocol* iprot, void* obj) { return static_cast<Struct_*>(obj)->read(iprot); }
+
+  static uint32_t write(TProtocol* oprot, const void* obj) {
+    return static_cast<const Struct_*>(obj)->write(oprot);
+  }
+
+  static const TStructOps ops;
+};
+
+template <class Struct_>
+const TStructOps TStructMethods<Struct_>::ops = {&TStructMethods<Struct_>::read,
+                                                 &TStructMethods<Struct_>::write};
+
+/// TContainerOps of a std::vector, or any list with contiguous elements.
+template <class List_>
+struct TListOps {
+  static uint32_t size(const void* c) {
+    return static_cast<uint32_t>(static_cast<const List_*>(c)->size());
+  }
+
+  static void clear(void* c) { static_cast<List_*>(c)->clear(); }
+
+  static void* resize(void* c, uint32_t n) {
+    List_& list = *static_cast<List_*>(c);
+    list.resize(n);
+    return n == 0 ? NULL : &list[0];
+  }
+
+  static const void* data(const void* c) {
+    const List_& list = *static_cast<const List_*>(c);
+    return list.empty() ? NULL : &list[0];
+  }
+
+  static const TContainerOps ops;
+};
+
+template <class List_>
+const TContainerOps TListOps<List_>::ops = {sizeof(typename List_::value_type),
+                                            &TListOps<List_>::size,
+                                            &TListOps<List_>::clear,
+                                            &TListOps<List_>::resize,
+                                            &TListOps<List_>::data,
+                                            NULL,
+                                            NULL};
+
+/// TContainerOps of a std::set.
+template <class Set_>
+struct TSetOps {
+  static uint32_t size(const void* c) {
+    return static_cast<uint32_t>(static_cast<const Set_*>(c)->size());
+  }
+
+  static void clear(void* c) { static_cast<Set_*>(c)->clear(); }
+
+  static void insert(void* c, TElementReader read, void* ctx) {
+    typename Set_::value_type elem = typename Set_::value_type();
+    read(ctx, &elem, NULL);
+    static_cast<Set_*>(c)->insert(elem);
+  }
+
+  static void visit(const void* c, TElementWriter write, void* ctx) {
+    const Set_& set = *static_cast<const Set_*>(c);
+    for (typename Set_::const_iterator it = set.begin(); it != set.end(); ++it) {
+      write(ctx, &*it, NULL);
+    }
+  }
+
+  static const TContainerOps ops;
+};
+
+template <class Set_>
+const TContainerOps TSetOps<Set_>::ops = {sizeof(typename Set_::value_type),
+                                          &TSetOps<Set_>::size,
+                                          &TSetOps<Set_>::clear,
+                                          NULL,
+                                          NULL,
+                                          &TSetOps<Set_>::insert,
+                                          &TSetOps<Set_>::visit};
+
+/// TContainerOps of a std::map.
+template <class Map_>
+struct TMapOps {
+  static uint32_t size(const void* c) {
+    return static_cast<uint32_t>(static_cast<const Map_*>(c)->size());
+  }
+
+  static void clear(void* c) { static_cast<Map_*>(c)->clear(); }
+
+  static void insert(void* c, TElementReader read, void* ctx) {
+    typename Map_::key_type key = typename Map_::key_type();
+    read(ctx, &key, NULL);
+    read(ctx, NULL, &(*static_cast<Map_*>(c))[key]);
+  }
+
+  static void visit(const void* c, TElementWriter write, void* ctx) {
+    const Map_& map = *static_cast<const Map_*>(c);
+    for (typename Map_::const_iterator it = map.begin(); it != map.end(); ++it) {
+      write(ctx, &it->first, &it->second);
+    }
+  }
+
+  static const TContainerOps ops;
+};
+
+template <class Map_>
+const TContainerOps TMapOps<Map_>::ops = {sizeof(typename Map_::value_type),
+                                          &TMapOps<Map_>::size,
+                                          &TMapOps<Map_>::clear,
+                                          NULL,
+                                          NULL,
+                                          &TMapOps<Map_>::insert,
+                                          &TMapOps<Map_>::visit};
+}
+}
+} // apache::thrift::protocol
+
+#endif // #ifndef _THRIFT_PROTOCOL_TTABLESERIALIZER_H_
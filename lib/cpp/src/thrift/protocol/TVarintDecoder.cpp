@@ -0,0 +1,315 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <thrift/protocol/TVarintDecoder.h>
+#include <thrift/protocol/TProtocolException.h>
+
+#include <algorithm>
+
+// SSE2 is part of the x86-64 baseline, so it needs no runtime check.  The
+// AVX2 kernel is compiled with a per-function target attribute and only
+// called after asking the CPU, so the library itself is still built for the
+// baseline instruction set.
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+#define THRIFT_VARINT_SSE2 1
+#if defined(__clang__) || __GNUC__ > 4 || (__GNUC__ == 4 && __GNUC_MINOR__ >= 9)
+#define THRIFT_VARINT_AVX2 1
+#define THRIFT_VARINT_AVX2_TARGET __attribute__((target("avx2")))
+#endif
+#elif defined(_MSC_VER) && defined(_M_X64)
+#define THRIFT_VARINT_SSE2 1
+#endif
+
+#if defined(THRIFT_VARINT_AVX2)
+#include <immintrin.h>
+#elif defined(THRIFT_VARINT_SSE2)
+#include <emmintrin.h>
+#endif
+
+namespace apache {
+namespace thrift {
+namespace protocol {
+namespace detail {
+namespace compact {
+
+namespace {
+
+inline int16_t unzigzag(uint64_t n, int16_t*) {
+  uint32_t n32 = static_cast<uint32_t>(n);
+  return static_cast<int16_t>((n32 >> 1) ^ static_cast<uint32_t>(-static_cast<int32_t>(n32 & 1)));
+}
+
+inline int32_t unzigzag(uint64_t n, int32_t*) {
+  uint32_t n32 = static_cast<uint32_t>(n);
+  return static_cast<int32_t>((n32 >> 1) ^ static_cast<uint32_t>(-static_cast<int32_t>(n32 & 1)));
+}
+
+inline int64_t unzigzag(uint64_t n, int64_t*) {
+  return static_cast<int64_t>((n >> 1) ^ static_cast<uint64_t>(-static_cast<int64_t>(n & 1)));
+}
+
+/**
+ * Decodes the one-byte varints at the start of buf, stopping at the first
+ * byte with the continuation bit set.  Returns how many were decoded.
+ */
+template <typename T>
+uint32_t decodeRunScalar(const uint8_t* buf, uint32_t len, T* out, uint32_t count) {
+  uint32_t n = (std::min)(len, count);
+  uint32_t i = 0;
+  while (i < n && buf[i] < 0x80) {
+    out[i] = static_cast<T>((buf[i] >> 1) ^ -static_cast<int>(buf[i] & 1));
+    ++i;
+  }
+  return i;
+}
+
+#ifdef THRIFT_VARINT_SSE2
+
+// Unzigzags 16 one-byte varints into 16 signed bytes.
+inline __m128i unzigzagBytes(__m128i v) {
+  __m128i half = _mm_and_si128(_mm_srli_epi16(v, 1), _mm_set1_epi8(0x7f));
+  __m128i sign = _mm_sub_epi8(_mm_setzero_si128(), _mm_and_si128(v, _mm_set1_epi8(1)));
+  return _mm_xor_si128(half, sign);
+}
+
+// Sign-extends 16 signed bytes into out[0..15].
+inline void storeSse2(__m128i v, int16_t* out) {
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 8),
+                   _mm_srai_epi16(_mm_unpackhi_epi8(v, v), 8));
+}
+
+inline void storeSse2(__m128i v, int32_t* out) {
+  __m128i lo = _mm_srai_epi16(_mm_unpacklo_epi8(v, v), 8);
+  __m128i hi = _mm_srai_epi16(_mm_unpackhi_epi8(v, v), 8);
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out), _mm_srai_epi32(_mm_unpacklo_epi16(lo, lo), 16));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 4),
+                   _mm_srai_epi32(_mm_unpackhi_epi16(lo, lo), 16));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 8),
+                   _mm_srai_epi32(_mm_unpacklo_epi16(hi, hi), 16));
+  _mm_storeu_si128(reinterpret_cast<__m128i*>(out + 12),
+                   _mm_srai_epi32(_mm_unpackhi_epi16(hi, hi), 16));
+}
+
+inline void storeSse2(__m128i v, int64_t* out) {
+  int32_t words[16];
+  storeSse2(v, words);
+  for (int i = 0; i < 16; i += 4) {
+    __m128i x = _mm_loadu_si128(reinterpret_cast<const __m128i*>(words + i));
+    __m128i sign = _mm_srai_epi32(x, 31);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), _mm_unpacklo_epi32(x, sign));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i + 2), _mm_unpackhi_epi32(x, sign));
+  }
+}
+
+template <typename T>
+uint32_t decodeRunSse2(const uint8_t* buf, uint32_t len, T* out, uint32_t count) {
+  uint32_t n = (std::min)(len, count);
+  uint32_t i = 0;
+  while (n - i >= 16) {
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(buf + i));
+    if (_mm_movemask_epi8(v) != 0) {
+      return i + decodeRunScalar(buf + i, 16, out + i, 16);
+    }
+    storeSse2(unzigzagBytes(v), out + i);
+    i += 16;
+  }
+  return i + decodeRunScalar(buf + i, len - i, out + i, count - i);
+}
+
+#endif // THRIFT_VARINT_SSE2
+
+#ifdef THRIFT_VARINT_AVX2
+
+THRIFT_VARINT_AVX2_TARGET inline __m256i unzigzagBytesAvx2(__m256i v) {
+  __m256i half = _mm256_and_si256(_mm256_srli_epi16(v, 1), _mm256_set1_epi8(0x7f));
+  __m256i sign = _mm256_sub_epi8(_mm256_setzero_si256(), _mm256_and_si256(v, _mm256_set1_epi8(1)));
+  return _mm256_xor_si256(half, sign);
+}
+
+// Sign-extends 16 signed bytes into out[0..15].
+THRIFT_VARINT_AVX2_TARGET inline void storeAvx2(__m128i v, int16_t* out) {
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), _mm256_cvtepi8_epi16(v));
+}
+
+THRIFT_VARINT_AVX2_TARGET inline void storeAvx2(__m128i v, int32_t* out) {
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), _mm256_cvtepi8_epi32(v));
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 8),
+                      _mm256_cvtepi8_epi32(_mm_srli_si128(v, 8)));
+}
+
+THRIFT_VARINT_AVX2_TARGET inline void storeAvx2(__m128i v, int64_t* out) {
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(out), _mm256_cvtepi8_epi64(v));
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 4),
+                      _mm256_cvtepi8_epi64(_mm_srli_si128(v, 4)));
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 8),
+                      _mm256_cvtepi8_epi64(_mm_srli_si128(v, 8)));
+  _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + 12),
+                      _mm256_cvtepi8_epi64(_mm_srli_si128(v, 12)));
+}
+
+template <typename T>
+THRIFT_VARINT_AVX2_TARGET uint32_t
+decodeRunAvx2(const uint8_t* buf, uint32_t len, T* out, uint32_t count) {
+  uint32_t n = (std::min)(len, count);
+  uint32_t i = 0;
+  while (n - i >= 32) {
+    __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(buf + i));
+    if (_mm256_movemask_epi8(v) != 0) {
+      return i + decodeRunScalar(buf + i, 32, out + i, 32);
+    }
+    __m256i values = unzigzagBytesAvx2(v);
+    storeAvx2(_mm256_castsi256_si128(values), out + i);
+    storeAvx2(_mm256_extracti128_si256(values, 1), out + i + 16);
+    i += 32;
+  }
+  return i + decodeRunScalar(buf + i, len - i, out + i, count - i);
+}
+
+#endif // THRIFT_VARINT_AVX2
+
+struct Kernel {
+  const char* name;
+  uint32_t (*run16)(const uint8_t*, uint32_t, int16_t*, uint32_t);
+  uint32_t (*run32)(const uint8_t*, uint32_t, int32_t*, uint32_t);
+  uint32_t (*run64)(const uint8_t*, uint32_t, int64_t*, uint32_t);
+};
+
+const Kernel scalarKernel = {"scalar",
+                             &decodeRunScalar<int16_t>,
+                             &decodeRunScalar<int32_t>,
+                             &decodeRunScalar<int64_t>};
+
+#ifdef THRIFT_VARINT_SSE2
+const Kernel sse2Kernel
+    = {"sse2", &decodeRunSse2<int16_t>, &decodeRunSse2<int32_t>, &decodeRunSse2<int64_t>};
+#endif
+
+#ifdef THRIFT_VARINT_AVX2
+const Kernel avx2Kernel
+    = {"avx2", &decodeRunAvx2<int16_t>, &decodeRunAvx2<int32_t>, &decodeRunAvx2<int64_t>};
+#endif
+
+const Kernel* selectKernel() {
+#ifdef THRIFT_VARINT_AVX2
+  __builtin_cpu_init();
+  if (__builtin_cpu_supports("avx2")) {
+    return &avx2Kernel;
+  }
+#endif
+#ifdef THRIFT_VARINT_SSE2
+  return &sse2Kernel;
+#else
+  return &scalarKernel;
+#endif
+}
+
+const Kernel& kernel() {
+  static const Kernel* selected = selectKernel();
+  return *selected;
+}
+
+inline uint32_t decodeRun(const uint8_t* buf, uint32_t len, int16_t* out, uint32_t count) {
+  return kernel().run16(buf, len, out, count);
+}
+
+inline uint32_t decodeRun(const uint8_t* buf, uint32_t len, int32_t* out, uint32_t count) {
+  return kernel().run32(buf, len, out, count);
+}
+
+inline uint32_t decodeRun(const uint8_t* buf, uint32_t len, int64_t* out, uint32_t count) {
+  return kernel().run64(buf, len, out, count);
+}
+
+/**
+ * Alternates between the vectorized run decoder and a scalar decode of the
+ * multi-byte varint that ended the run.
+ */
+template <typename T>
+uint32_t decode(const uint8_t* buf, uint32_t len, T* out, uint32_t count, uint32_t* consumed) {
+  uint32_t pos = 0;
+  uint32_t i = 0;
+  while (i < count && pos < len) {
+    uint32_t run = decodeRun(buf + pos, len - pos, out + i, count - i);
+    pos += run;
+    i += run;
+    if (i == count || pos == len) {
+      break;
+    }
+
+    uint64_t val = 0;
+    int shift = 0;
+    uint32_t end = pos;
+    while (true) {
+      if (end == len) {
+        // Truncated by the end of the buffer; let the caller refill.
+        *consumed = pos;
+        return i;
+      }
+      uint8_t byte = buf[end++];
+      val |= (uint64_t)(byte & 0x7f) << shift;
+      if (!(byte & 0x80)) {
+        break;
+      }
+      shift += 7;
+      if (end - pos == 10) {
+        throw TProtocolException(TProtocolException::INVALID_DATA,
+                                 "Variable-length int over 10 bytes.");
+      }
+    }
+    out[i++] = unzigzag(val, static_cast<T*>(NULL));
+    pos = end;
+  }
+  *consumed = pos;
+  return i;
+}
+}
+
+uint32_t decodeZigzagVarints(const uint8_t* buf,
+                             uint32_t len,
+                             int16_t* out,
+                             uint32_t count,
+                             uint32_t* consumed) {
+  return decode(buf, len, out, count, consumed);
+}
+
+uint32_t decodeZigzagVarints(const uint8_t* buf,
+                             uint32_t len,
+                             int32_t* out,
+                             uint32_t count,
+                             uint32_t* consumed) {
+  return decode(buf, len, out, count, consumed);
+}
+
+uint32_t decodeZigzagVarints(const uint8_t* buf,
+                             uint32_t len,
+                             int64_t* out,
+                             uint32_t count,
+                             uint32_t* consumed) {
+  return decode(buf, len, out, count, consumed);
+}
+
+const char* varintDecoderKernel() {
+  return kernel().name;
+}
+}
+}
+}
+}
+} // apache::thrift::protocol::detail::compact
@@ -0,0 +1,74 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _THRIFT_PROTOCOL_TVARINTDECODER_H_
+#define _THRIFT_PROTOCOL_TVARINTDECODER_H_ 1
+
+#include <thrift/Thrift.h>
+
+namespace apache {
+namespace thrift {
+namespace protocol {
+namespace detail {
+namespace compact {
+
+/**
+ * Decodes up to count zigzag-encoded varints, as written by the compact
+ * protocol for i16, i32 and i64 values, from the len bytes at buf.
+ *
+ * Runs of one-byte varints (small magnitudes, the common case for lists of
+ * counts, ids and quantized features) are decoded 16 or 32 at a time with
+ * SSE2 or AVX2 where the CPU supports it; the kernel is chosen once at
+ * runtime and a portable scalar loop is used everywhere else.
+ *
+ * Decoding stops early at a varint that runs past the end of the buffer, so
+ * callers can refill and continue.  i16 and i32 values are truncated to 32
+ * bits before being unzigzagged, exactly as readI16/readI32 do.
+ *
+ * @param consumed  Receives the number of bytes used.
+ * @return The number of values stored in out.
+ * @throws TProtocolException if a varint is longer than 10 bytes
+ */
+uint32_t decodeZigzagVarints(const uint8_t* buf,
+                             uint32_t len,
+                             int16_t* out,
+                             uint32_t count,
+                             uint32_t* consumed);
+uint32_t decodeZigzagVarints(const uint8_t* buf,
+                             uint32_t len,
+                             int32_t* out,
+                             uint32_t count,
+                             uint32_t* consumed);
+uint32_t decodeZigzagVarints(const uint8_t* buf,
+                             uint32_t len,
+                             int64_t* out,
+                             uint32_t count,
+                             uint32_t* consumed);
+
+/**
+ * Name of the kernel selected for this CPU ("avx2", "sse2" or "scalar").
+ */
+const char* varintDecoderKernel();
+}
+}
+}
+}
+} // apache::thrift::protocol::detail::compact
+
+#endif // #ifndef _THRIFT_PROTOCOL_TVARINTDECODER_H_
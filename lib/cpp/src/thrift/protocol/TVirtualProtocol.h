@@ -393,6 +393,34 @@ public:
     return static_cast<Protocol_*>(this)->writeBinary(str);
   }
 
+  virtual uint32_t writeStringView_virt(const TStringView& str) {
+    return static_cast<Protocol_*>(this)->writeStringView(str);
+  }
+
+  virtual uint32_t writeBinaryView_virt(const TStringView& str) {
+    return static_cast<Protocol_*>(this)->writeBinaryView(str);
+  }
+
+  virtual uint32_t writeByteList_virt(const int8_t* bytes, uint32_t count) {
+    return static_cast<Protocol_*>(this)->writeByteList(bytes, count);
+  }
+
+  virtual uint32_t writeI16List_virt(const int16_t* i16s, uint32_t count) {
+    return static_cast<Protocol_*>(this)->writeI16List(i16s, count);
+  }
+
+  virtual uint32_t writeI32List_virt(const int32_t* i32s, uint32_t count) {
+    return static_cast<Protocol_*>(this)->writeI32List(i32s, count);
+  }
+
+  virtual uint32_t writeI64List_virt(const int64_t* i64s, uint32_t count) {
+    return static_cast<Protocol_*>(this)->writeI64List(i64s, count);
+  }
+
+  virtual uint32_t writeDoubleList_virt(const double* dubs, uint32_t count) {
+    return static_cast<Protocol_*>(this)->writeDoubleList(dubs, count);
+  }
+
   /**
    * Reading functions
    */
@@ -471,6 +499,34 @@ public:
     return static_cast<Protocol_*>(this)->readBinary(str);
   }
 
+  virtual uint32_t readStringView_virt(TStringView& str) {
+    return static_cast<Protocol_*>(this)->readStringView(str);
+  }
+
+  virtual uint32_t readBinaryView_virt(TStringView& str) {
+    return static_cast<Protocol_*>(this)->readBinaryView(str);
+  }
+
+  virtual uint32_t readByteList_virt(int8_t* bytes, uint32_t count) {
+    return static_cast<Protocol_*>(this)->readByteList(bytes, count);
+  }
+
+  virtual uint32_t readI16List_virt(int16_t* i16s, uint32_t count) {
+    return static_cast<Protocol_*>(this)->readI16List(i16s, count);
+  }
+
+  virtual uint32_t readI32List_virt(int32_t* i32s, uint32_t count) {
+    return static_cast<Protocol_*>(this)->readI32List(i32s, count);
+  }
+
+  virtual uint32_t readI64List_virt(int64_t* i64s, uint32_t count) {
+    return static_cast<Protocol_*>(this)->readI64List(i64s, count);
+  }
+
+  virtual uint32_t readDoubleList_virt(double* dubs, uint32_t count) {
+    return static_cast<Protocol_*>(this)->readDoubleList(dubs, count);
+  }
+
   virtual uint32_t skip_virt(TType type) { return static_cast<Protocol_*>(this)->skip(type); }
 
   /*
@@ -503,6 +559,117 @@ public:
   }
   using Super_::readBool; // so we don't hide readBool(bool&)
 
+  /*
+   * Provide default TStringView readers and writers that copy through a
+   * std::string using the non-virtual string methods.  Protocols that can
+   * refer to the transport's buffer directly should override the readers.
+   */
+  uint32_t readStringView(TStringView& str) {
+    stdcxx::shared_ptr<std::string> copy(new std::string);
+    uint32_t ret = static_cast<Protocol_*>(this)->readString(*copy);
+    str = TStringView(copy);
+    return ret;
+  }
+
+  uint32_t readBinaryView(TStringView& str) {
+    stdcxx::shared_ptr<std::string> copy(new std::string);
+    uint32_t ret = static_cast<Protocol_*>(this)->readBinary(*copy);
+    str = TStringView(copy);
+    return ret;
+  }
+
+  uint32_t writeStringView(const TStringView& str) {
+    return static_cast<Protocol_*>(this)->writeString(str.str());
+  }
+
+  uint32_t writeBinaryView(const TStringView& str) {
+    return static_cast<Protocol_*>(this)->writeBinary(str.str());
+  }
+
+  /*
+   * Provide default primitive list readers and writers that handle one
+   * element at a time with the non-virtual element methods.
+   */
+  uint32_t writeByteList(const int8_t* bytes, uint32_t count) {
+    uint32_t ret = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+      ret += static_cast<Protocol_*>(this)->writeByte(bytes[i]);
+    }
+    return ret;
+  }
+
+  uint32_t writeI16List(const int16_t* i16s, uint32_t count) {
+    uint32_t ret = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+      ret += static_cast<Protocol_*>(this)->writeI16(i16s[i]);
+    }
+    return ret;
+  }
+
+  uint32_t writeI32List(const int32_t* i32s, uint32_t count) {
+    uint32_t ret = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+      ret += static_cast<Protocol_*>(this)->writeI32(i32s[i]);
+    }
+    return ret;
+  }
+
+  uint32_t writeI64List(const int64_t* i64s, uint32_t count) {
+    uint32_t ret = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+      ret += static_cast<Protocol_*>(this)->writeI64(i64s[i]);
+    }
+    return ret;
+  }
+
+  uint32_t writeDoubleList(const double* dubs, uint32_t count) {
+    uint32_t ret = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+      ret += static_cast<Protocol_*>(this)->writeDouble(dubs[i]);
+    }
+    return ret;
+  }
+
+  uint32_t readByteList(int8_t* bytes, uint32_t count) {
+    uint32_t ret = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+      ret += static_cast<Protocol_*>(this)->readByte(bytes[i]);
+    }
+    return ret;
+  }
+
+  uint32_t readI16List(int16_t* i16s, uint32_t count) {
+    uint32_t ret = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+      ret += static_cast<Protocol_*>(this)->readI16(i16s[i]);
+    }
+    return ret;
+  }
+
+  uint32_t readI32List(int32_t* i32s, uint32_t count) {
+    uint32_t ret = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+      ret += static_cast<Protocol_*>(this)->readI32(i32s[i]);
+    }
+    return ret;
+  }
+
+  uint32_t readI64List(int64_t* i64s, uint32_t count) {
+    uint32_t ret = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+      ret += static_cast<Protocol_*>(this)->readI64(i64s[i]);
+    }
+    return ret;
+  }
+
+  uint32_t readDoubleList(double* dubs, uint32_t count) {
+    uint32_t ret = 0;
+    for (uint32_t i = 0; i < count; ++i) {
+      ret += static_cast<Protocol_*>(this)->readDouble(dubs[i]);
+    }
+    return ret;
+  }
+
 protected:
   TVirtualProtocol(stdcxx::shared_ptr<TTransport> ptrans) : Super_(ptrans) {}
 };
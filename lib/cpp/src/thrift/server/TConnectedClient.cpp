@@ -23,6 +23,7 @@ namespace apache {
 namespace thrift {
 namespace server {
 
+using apache::thrift::TRequestArenaScope;
 using apache::thrift::TProcessor;
 using apache::thrift::protocol::TProtocol;
 using apache::thrift::server::TServerEventHandler;
@@ -59,7 +60,12 @@ void TConnectedClient::run() {
     }
 
     try {
-      if (!processor_->process(inputProtocol_, outputProtocol_, opaqueContext_)) {
+      // The arguments and result of cpp:arena calls come from the
+      // connection's arena and are gone once the request completes.
+      TRequestArenaScope scope(&arena_);
+      bool keepGoing = processor_->process(inputProtocol_, outputProtocol_, opaqueContext_);
+      arena_.reset();
+      if (!keepGoing) {
         break;
       }
     } catch (const TTransportException& ttx) {
@@ -89,6 +95,7 @@ void TConnectedClient::run() {
     }
   }
 
+  arena_.reset();
   cleanup();
 }
 
@@ -21,6 +21,7 @@
 #define _THRIFT_SERVER_TCONNECTEDCLIENT_H_ 1
 
 #include <thrift/stdcxx.h>
+#include <thrift/TArena.h>
 #include <thrift/TProcessor.h>
 #include <thrift/protocol/TProtocol.h>
 #include <thrift/server/TServer.h>
@@ -102,6 +103,9 @@ private:
    * Context acquired from the eventHandler_ if one exists.
    */
   void* opaqueContext_;
+
+  /// Per-request memory for cpp:arena types, reset after every call.
+  apache::thrift::TArena arena_;
 };
 }
 }
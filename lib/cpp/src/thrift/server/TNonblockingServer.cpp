@@ -20,12 +20,14 @@
 #include <thrift/thrift-config.h>
 
 #include <thrift/server/TNonblockingServer.h>
+#include <thrift/TArena.h>
 #include <thrift/concurrency/Exception.h>
 #include <thrift/transport/TSocket.h>
 #include <thrift/concurrency/PlatformThreadFactory.h>
 #include <thrift/transport/PlatformSocket.h>
 
 #include <algorithm>
+#include <deque>
 #include <iostream>
 
 #ifdef HAVE_SYS_SELECT_H
@@ -59,6 +61,10 @@
 #include <sched.h>
 #endif
 
+#ifdef HAVE_SYS_EVENTFD_H
+#include <sys/eventfd.h>
+#endif
+
 #ifndef AF_LOCAL
 #define AF_LOCAL AF_UNIX
 #endif
@@ -92,6 +98,10 @@ enum TSocketState { SOCKET_RECV_FRAMING, SOCKET_RECV, SOCKET_SEND };
  *  3) read frame of data
  *  4) send back data (if any)
  *  5) force immediate connection close
+ *
+ * A pipelined connection only uses these for reading; it waits for a task
+ * when it has as many requests in flight as it may, and keeps its responses
+ * in a queue of its own.
  */
 enum TAppState {
   APP_INIT,
@@ -108,9 +118,16 @@ enum TAppState {
  */
 class TNonblockingServer::TConnection {
 private:
+  friend class TNonblockingIOThread;
+
   /// Server IO Thread handling this connection
   TNonblockingIOThread* ioThread_;
 
+  /// Next connection in the completion queue of the IO thread.  A connection
+  /// is queued at most once, since it only notifies again once the IO thread
+  /// has taken it off the queue and handled its completions.
+  TConnection* notifyNext_;
+
   /// Server handle
   TNonblockingServer* server_;
 
@@ -181,6 +198,46 @@ private:
   /// Thrift call context, if any
   void* connectionContext_;
 
+  /// Per-request memory for cpp:arena types, reset after every call
+  TArena arena_;
+
+  class PipelinedRequest;
+
+  /// Whether this connection keeps reading while its requests are processed
+  bool pipelined_;
+
+  /// # of requests dispatched and not yet written or dropped
+  size_t outstanding_;
+
+  /// Set when close() waits for outstanding requests to finish
+  bool closing_;
+
+  /// Requests of this connection that are ready for reuse
+  std::vector<PipelinedRequest*> freeRequests_;
+
+  /// Processed requests whose responses are to be written, in order
+  std::deque<PipelinedRequest*> writeQueue_;
+
+  /**
+   * Leads the requests still processing back to their connection.  The
+   * connection is cleared when the server goes away, and requests that
+   * complete after that are deleted instead.
+   */
+  struct RequestLink {
+    /// Also guards completed_, which worker threads append to
+    Mutex mutex;
+    TConnection* connection;
+  };
+
+  /// Held by every request this connection dispatched
+  stdcxx::shared_ptr<RequestLink> requestLink_;
+
+  /// Processed requests not yet seen by the IO thread
+  std::vector<PipelinedRequest*> completed_;
+
+  /// Swapped with completed_ by the IO thread to take its contents
+  std::vector<PipelinedRequest*> completedBatch_;
+
   /// Go into read mode
   void setRead() { setFlags(EV_READ | EV_PERSIST); }
 
@@ -205,6 +262,28 @@ private:
    */
   void workSocket();
 
+  /// Like workSocket() for a pipelined connection, which reads and writes at once.
+  void workPipelinedSocket(short which);
+
+  /// Hand the frame just read to the thread manager as a request of its own.
+  void dispatchPipelined();
+
+  /// Write as much of the queued responses as the socket takes.
+  /// @return false if the connection was closed.
+  bool writeResponses();
+
+  /// Start reading the next frame if another request may be dispatched.
+  void resumeReading();
+
+  /// Set the event flags of a pipelined connection from its state.
+  void updatePipelinedFlags();
+
+  /// Make a request available for reuse.
+  void releaseRequest(PipelinedRequest* request) {
+    --outstanding_;
+    freeRequests_.push_back(request);
+  }
+
 public:
   class Task;
 
@@ -225,10 +304,16 @@ public:
 
     tSocket_ =  socket;
 
+    notifyNext_ = NULL;
+    requestLink_.reset(new RequestLink);
+    requestLink_->connection = this;
+    outstanding_ = 0;
+    closing_ = false;
+
     init(ioThread);
   }
 
-  ~TConnection() { std::free(readBuffer_); }
+  ~TConnection();
 
   /// Close this connection and free or reset its resources.
   void close();
@@ -262,11 +347,40 @@ public:
    * @param which the flags associated with the event.
    * @param v void* callback arg where we placed TConnection's "this".
    */
-  static void eventHandler(evutil_socket_t fd, short /* which */, void* v) {
-    assert(fd == static_cast<evutil_socket_t>(((TConnection*)v)->getTSocket()->getSocketFD()));
-    ((TConnection*)v)->workSocket();
+  static void eventHandler(evutil_socket_t fd, short which, void* v) {
+    TConnection* connection = (TConnection*)v;
+    assert(fd == static_cast<evutil_socket_t>(connection->getTSocket()->getSocketFD()));
+    if (connection->pipelined_) {
+      connection->workPipelinedSocket(which);
+    } else {
+      connection->workSocket();
+    }
   }
 
+  /**
+   * Called by the IO thread for every notification it receives for this
+   * connection: a task finished, or the connection was just handed to it.
+   */
+  void handleNotification();
+
+  /**
+   * Notification to server that processing has ended on a request of a
+   * pipelined connection.
+   *
+   * @param link the link of the connection that dispatched the request.
+   * @param request the request, which the caller must not touch afterwards.
+   * @param processed false to close the connection instead of answering.
+   */
+  static void completeRequest(const stdcxx::shared_ptr<RequestLink>& link,
+                              PipelinedRequest* request,
+                              bool processed);
+
+  /**
+   * Drops the processed requests, and leaves those still processing to be
+   * deleted as they complete, for shutting down the server.
+   */
+  void abandonRequests();
+
   /**
    * Notification to server that processing has ended on this request.
    * Can be called either when processing is completed or when a waiting
@@ -308,18 +422,80 @@ public:
 
   /// return the Thrift connection context if any
   void* getConnectionContext() { return connectionContext_; }
+
+  TArena* getArena() { return &arena_; }
+};
+
+/**
+ * A request of a pipelined connection, from the time its frame is read until
+ * its response is written.  A connection keeps its requests, with their
+ * buffers, transports and protocols, for the following requests until it is
+ * closed.
+ */
+class TNonblockingServer::TConnection::PipelinedRequest {
+public:
+  explicit PipelinedRequest(TNonblockingServer* server)
+    : readBuffer_(NULL), readBufferSize_(0), failed_(false) {
+    inputTransport_.reset(new TMemoryBuffer(readBuffer_, readBufferSize_));
+    outputTransport_.reset(
+        new TMemoryBuffer(static_cast<uint32_t>(server->getWriteBufferDefaultSize())));
+    factoryInputTransport_ = server->getInputTransportFactory()->getTransport(inputTransport_);
+    factoryOutputTransport_ = server->getOutputTransportFactory()->getTransport(outputTransport_);
+    if (server->getHeaderTransport()) {
+      inputProtocol_ = server->getInputProtocolFactory()->getProtocol(factoryInputTransport_,
+                                                                      factoryOutputTransport_);
+      outputProtocol_ = inputProtocol_;
+    } else {
+      inputProtocol_ = server->getInputProtocolFactory()->getProtocol(factoryInputTransport_);
+      outputProtocol_ = server->getOutputProtocolFactory()->getProtocol(factoryOutputTransport_);
+    }
+  }
+
+  ~PipelinedRequest() {
+    factoryInputTransport_->close();
+    factoryOutputTransport_->close();
+    std::free(readBuffer_);
+  }
+
+  /// Frame of the request, swapped with the read buffer of the connection
+  uint8_t* readBuffer_;
+  uint32_t readBufferSize_;
+
+  stdcxx::shared_ptr<TMemoryBuffer> inputTransport_;
+  stdcxx::shared_ptr<TMemoryBuffer> outputTransport_;
+  stdcxx::shared_ptr<TTransport> factoryInputTransport_;
+  stdcxx::shared_ptr<TTransport> factoryOutputTransport_;
+  stdcxx::shared_ptr<TProtocol> inputProtocol_;
+  stdcxx::shared_ptr<TProtocol> outputProtocol_;
+
+  /// Per-request memory for cpp:arena types
+  TArena arena_;
+
+  /// Set if the request expired or was dropped unprocessed
+  bool failed_;
 };
 
+TNonblockingServer::TConnection::~TConnection() {
+  for (size_t i = 0; i < freeRequests_.size(); ++i) {
+    delete freeRequests_[i];
+  }
+  std::free(readBuffer_);
+}
+
 class TNonblockingServer::TConnection::Task : public Runnable {
 public:
   Task(stdcxx::shared_ptr<TProcessor> processor,
        stdcxx::shared_ptr<TProtocol> input,
        stdcxx::shared_ptr<TProtocol> output,
-       TConnection* connection)
+       TConnection* connection,
+       PipelinedRequest* request = NULL)
     : processor_(processor),
       input_(input),
       output_(output),
       connection_(connection),
+      request_(request),
+      requestLink_(connection->requestLink_),
+      socket_(connection->getTSocket()),
       serverEventHandler_(connection_->getServerEventHandler()),
       connectionContext_(connection_->getConnectionContext()) {}
 
@@ -327,10 +503,16 @@ public:
     try {
       for (;;) {
         if (serverEventHandler_) {
-          serverEventHandler_->processContext(connectionContext_, connection_->getTSocket());
+          serverEventHandler_->processContext(connectionContext_, socket_);
         }
-        if (!processor_->process(input_, output_, connectionContext_)
-            || !input_->getTransport()->peek()) {
+        TArena* arena = request_ ? &request_->arena_ : connection_->getArena();
+        bool keepGoing;
+        {
+          TRequestArenaScope scope(arena);
+          keepGoing = processor_->process(input_, output_, connectionContext_);
+        }
+        arena->reset();
+        if (!keepGoing || !input_->getTransport()->peek()) {
           break;
         }
       }
@@ -347,6 +529,11 @@ public:
       GlobalOutput.printf("TNonblockingServer: unknown exception while processing.");
     }
 
+    if (request_) {
+      completeRequest(requestLink_, request_, true);
+      return;
+    }
+
     // Signal completion back to the libevent thread via a pipe
     if (!connection_->notifyIOThread()) {
       GlobalOutput.printf("TNonblockingServer: failed to notifyIOThread, closing.");
@@ -358,11 +545,24 @@ public:
 
   TConnection* getTConnection() { return connection_; }
 
+  /// Close the connection of a task that is dropped without running.
+  void forceClose() {
+    if (request_) {
+      completeRequest(requestLink_, request_, false);
+    } else {
+      assert(connection_->getServer() && connection_->getState() == APP_WAIT_TASK);
+      connection_->forceClose();
+    }
+  }
+
 private:
   stdcxx::shared_ptr<TProcessor> processor_;
   stdcxx::shared_ptr<TProtocol> input_;
   stdcxx::shared_ptr<TProtocol> output_;
   TConnection* connection_;
+  PipelinedRequest* request_;
+  stdcxx::shared_ptr<RequestLink> requestLink_;
+  stdcxx::shared_ptr<TSocket> socket_;
   stdcxx::shared_ptr<TServerEventHandler> serverEventHandler_;
   void* connectionContext_;
 };
@@ -384,6 +584,9 @@ void TNonblockingServer::TConnection::init(TNonblockingIOThread* ioThread) {
   socketState_ = SOCKET_RECV_FRAMING;
   callsForResize_ = 0;
 
+  pipelined_ = server_->asyncProcessor_
+               || (server_->isThreadPoolProcessing() && server_->getMaxPipelinedRequests() > 1);
+
   // get input/transports
   factoryInputTransport_ = server_->getInputTransportFactory()->getTransport(inputTransport_);
   factoryOutputTransport_ = server_->getOutputTransportFactory()->getTransport(outputTransport_);
@@ -571,6 +774,11 @@ void TNonblockingServer::TConnection::transition() {
   switch (appState_) {
 
   case APP_READ_REQUEST:
+    if (pipelined_) {
+      dispatchPipelined();
+      return;
+    }
+
     // We are done reading the request, package the read buffer into transport
     // and get back some data from the dispatch function
     if (server_->getHeaderTransport()) {
@@ -624,7 +832,11 @@ void TNonblockingServer::TConnection::transition() {
           serverEventHandler_->processContext(connectionContext_, getTSocket());
         }
         // Invoke the processor
-        processor_->process(inputProtocol_, outputProtocol_, connectionContext_);
+        {
+          TRequestArenaScope scope(&arena_);
+          processor_->process(inputProtocol_, outputProtocol_, connectionContext_);
+        }
+        arena_.reset();
       } catch (const TTransportException& ttx) {
         GlobalOutput.printf(
             "TNonblockingServer transport error in "
@@ -769,6 +981,214 @@ void TNonblockingServer::TConnection::transition() {
   }
 }
 
+void TNonblockingServer::TConnection::dispatchPipelined() {
+  PipelinedRequest* request;
+  if (freeRequests_.empty()) {
+    request = new PipelinedRequest(server_);
+  } else {
+    request = freeRequests_.back();
+    freeRequests_.pop_back();
+  }
+  ++outstanding_;
+
+  // Hand the frame to the request without copying it; the connection reads
+  // the next frame into the buffer of the previous request instead.
+  std::swap(readBuffer_, request->readBuffer_);
+  std::swap(readBufferSize_, request->readBufferSize_);
+  request->failed_ = false;
+  request->outputTransport_->resetBuffer();
+  if (server_->getHeaderTransport()) {
+    request->inputTransport_->resetBuffer(request->readBuffer_, readBufferPos_);
+  } else {
+    request->inputTransport_->resetBuffer(request->readBuffer_ + 4, readBufferPos_ - 4);
+    request->outputTransport_->getWritePtr(4);
+    request->outputTransport_->wroteBytes(4);
+  }
+
+  server_->incrementActiveProcessors();
+  if (server_->asyncProcessor_) {
+    // The processor answers through completeRequest(), right away or later
+    // and from any thread.
+    if (serverEventHandler_) {
+      serverEventHandler_->processContext(connectionContext_, getTSocket());
+    }
+    try {
+      server_->asyncProcessor_->process(stdcxx::bind(&TConnection::completeRequest,
+                                                     requestLink_,
+                                                     request,
+                                                     stdcxx::placeholders::_1),
+                                        request->inputProtocol_,
+                                        request->outputProtocol_);
+    } catch (const std::exception& x) {
+      GlobalOutput.printf("TNonblockingServer: async process() exception: %s: %s",
+                          typeid(x).name(),
+                          x.what());
+      completeRequest(requestLink_, request, false);
+    }
+  } else {
+    try {
+      server_->addTask(stdcxx::shared_ptr<Runnable>(
+          new Task(processor_, request->inputProtocol_, request->outputProtocol_, this, request)));
+    } catch (IllegalStateException& ise) {
+      GlobalOutput.printf("IllegalStateException: Server::process() %s", ise.what());
+      server_->decrementActiveProcessors();
+      releaseRequest(request);
+      close();
+      return;
+    } catch (TimedOutException& to) {
+      GlobalOutput.printf("[ERROR] TimedOutException: Server::process() %s", to.what());
+      server_->decrementActiveProcessors();
+      releaseRequest(request);
+      close();
+      return;
+    }
+  }
+
+  appState_ = APP_WAIT_TASK;
+  resumeReading();
+  updatePipelinedFlags();
+}
+
+void TNonblockingServer::TConnection::resumeReading() {
+  if (appState_ == APP_WAIT_TASK && outstanding_ < server_->getMaxPipelinedRequests()) {
+    socketState_ = SOCKET_RECV_FRAMING;
+    appState_ = APP_READ_FRAME_SIZE;
+    readBufferPos_ = 0;
+  }
+}
+
+void TNonblockingServer::TConnection::updatePipelinedFlags() {
+  short flags = 0;
+  if (appState_ != APP_WAIT_TASK) {
+    flags |= EV_READ;
+  }
+  if (!writeQueue_.empty()) {
+    flags |= EV_WRITE;
+  }
+  setFlags(flags ? flags | EV_PERSIST : 0);
+}
+
+void TNonblockingServer::TConnection::workPipelinedSocket(short which) {
+  if ((which & EV_WRITE) && !writeResponses()) {
+    return;
+  }
+  if ((which & EV_READ) && appState_ != APP_WAIT_TASK) {
+    workSocket();
+  }
+}
+
+bool TNonblockingServer::TConnection::writeResponses() {
+  while (!writeQueue_.empty()) {
+    PipelinedRequest* request = writeQueue_.front();
+    uint8_t* buffer;
+    uint32_t size;
+    request->outputTransport_->getBuffer(&buffer, &size);
+
+    uint32_t sent;
+    try {
+      sent = tSocket_->write_partial(buffer + writeBufferPos_, size - writeBufferPos_);
+    } catch (TTransportException& te) {
+      GlobalOutput.printf("TConnection::writeResponses(): %s ", te.what());
+      close();
+      return false;
+    }
+
+    writeBufferPos_ += sent;
+    if (writeBufferPos_ < size) {
+      // The socket takes no more for now.
+      break;
+    }
+    writeBufferPos_ = 0;
+    writeQueue_.pop_front();
+    releaseRequest(request);
+  }
+
+  resumeReading();
+  updatePipelinedFlags();
+  return true;
+}
+
+void TNonblockingServer::TConnection::completeRequest(const stdcxx::shared_ptr<RequestLink>& link,
+                                                      PipelinedRequest* request,
+                                                      bool processed) {
+  Guard g(link->mutex);
+  TConnection* connection = link->connection;
+  if (connection == NULL) {
+    // The server is gone.
+    delete request;
+    return;
+  }
+
+  request->failed_ = !processed;
+  bool first = connection->completed_.empty();
+  connection->completed_.push_back(request);
+
+  // The IO thread takes all completed requests on one notification, so only
+  // the first one since it last looked needs to send one.  Without the IO
+  // thread the request stays queued, and is dropped with the connection when
+  // the server shuts down.
+  if (first && !connection->notifyIOThread()) {
+    GlobalOutput.printf("TNonblockingServer: failed to notifyIOThread for pipelined request.");
+  }
+}
+
+void TNonblockingServer::TConnection::abandonRequests() {
+  while (!writeQueue_.empty()) {
+    releaseRequest(writeQueue_.front());
+    writeQueue_.pop_front();
+  }
+
+  Guard g(requestLink_->mutex);
+  for (size_t i = 0; i < completed_.size(); ++i) {
+    server_->decrementActiveProcessors();
+    releaseRequest(completed_[i]);
+  }
+  completed_.clear();
+  requestLink_->connection = NULL;
+  outstanding_ = 0;
+}
+
+void TNonblockingServer::TConnection::handleNotification() {
+  if (!pipelined_ || appState_ == APP_INIT) {
+    transition();
+    return;
+  }
+
+  {
+    Guard g(requestLink_->mutex);
+    completed_.swap(completedBatch_);
+  }
+  for (size_t i = 0; i < completedBatch_.size(); ++i) {
+    PipelinedRequest* request = completedBatch_[i];
+    server_->decrementActiveProcessors();
+    if (request->failed_) {
+      closing_ = true;
+    }
+
+    uint8_t* buffer;
+    uint32_t size;
+    request->outputTransport_->getBuffer(&buffer, &size);
+
+    // 4 bytes were reserved for frame size; oneway calls have nothing to send
+    if (closing_ || size <= 4) {
+      releaseRequest(request);
+      continue;
+    }
+    int32_t frameSize = (int32_t)htonl(size - 4);
+    memcpy(buffer, &frameSize, 4);
+    writeQueue_.push_back(request);
+  }
+  completedBatch_.clear();
+
+  if (closing_) {
+    close();
+    return;
+  }
+
+  // Try to send the responses right away rather than on the next event.
+  writeResponses();
+}
+
 void TNonblockingServer::TConnection::setFlags(short eventFlags) {
   // Catch the do nothing case
   if (eventFlags_ == eventFlags) {
@@ -829,6 +1249,23 @@ void TNonblockingServer::TConnection::setFlags(short eventFlags) {
  * Closes a connection
  */
 void TNonblockingServer::TConnection::close() {
+  // Drop responses not written yet; requests still processing have to come
+  // back before the connection can be reused.
+  while (!writeQueue_.empty()) {
+    releaseRequest(writeQueue_.front());
+    writeQueue_.pop_front();
+  }
+  if (outstanding_ > 0) {
+    closing_ = true;
+    setIdle();
+    return;
+  }
+  closing_ = false;
+  for (size_t i = 0; i < freeRequests_.size(); ++i) {
+    delete freeRequests_[i];
+  }
+  freeRequests_.clear();
+
   setIdle();
 
   if (serverEventHandler_) {
@@ -846,6 +1283,9 @@ void TNonblockingServer::TConnection::close() {
   // release processor and handler
   processor_.reset();
 
+  // release anything left over from a request that failed part way
+  arena_.reset();
+
   // Give this object back to the server that owns it
   server_->returnConnection(this);
 }
@@ -867,6 +1307,7 @@ void TNonblockingServer::TConnection::checkIdleBufferMemLimit(size_t readLimit,
 TNonblockingServer::~TNonblockingServer() {
   // Close any active connections (moves them to the idle connection stack)
   while (activeConnections_.size()) {
+    activeConnections_.front()->abandonRequests();
     activeConnections_.front()->close();
   }
   // Clean up unused TConnection objects in connectionStack_
@@ -889,16 +1330,20 @@ TNonblockingServer::~TNonblockingServer() {
  * Creates a new connection either by reusing an object off the stack or
  * by allocating a new one entirely
  */
-TNonblockingServer::TConnection* TNonblockingServer::createConnection(stdcxx::shared_ptr<TSocket> socket) {
+TNonblockingServer::TConnection* TNonblockingServer::createConnection(stdcxx::shared_ptr<TSocket> socket,
+                                                                     TNonblockingIOThread* ioThread) {
   // Check the stack
   Guard g(connMutex_);
 
-  // pick an IO thread to handle this connection -- currently round robin
-  assert(nextIOThread_ < ioThreads_.size());
-  int selectedThreadIdx = nextIOThread_;
-  nextIOThread_ = static_cast<uint32_t>((nextIOThread_ + 1) % ioThreads_.size());
+  // pick an IO thread to handle this connection -- round robin unless the
+  // caller has one in mind
+  if (ioThread == NULL) {
+    assert(nextIOThread_ < ioThreads_.size());
+    int selectedThreadIdx = nextIOThread_;
+    nextIOThread_ = static_cast<uint32_t>((nextIOThread_ + 1) % ioThreads_.size());
 
-  TNonblockingIOThread* ioThread = ioThreads_[selectedThreadIdx].get();
+    ioThread = ioThreads_[selectedThreadIdx].get();
+  }
 
   // Check the connection stack to see if we can re-use
   TConnection* result = NULL;
@@ -939,21 +1384,35 @@ void TNonblockingServer::returnConnection(TConnection* connection) {
  * Server socket had something happen.  We accept all waiting client
  * connections on fd and assign TConnection objects to handle those requests.
  */
-void TNonblockingServer::handleEvent(THRIFT_SOCKET fd, short which) {
+void TNonblockingServer::handleEvent(THRIFT_SOCKET fd,
+                                     short which,
+                                     TNonblockingIOThread* ioThread) {
   (void)which;
+  int ioThreadNumber = ioThread->getThreadNumber();
+  assert(ioThreadNumber < static_cast<int>(acceptTransports_.size()));
+  const stdcxx::shared_ptr<TNonblockingServerTransport>& acceptor
+      = acceptTransports_[ioThreadNumber];
   // Make sure that libevent didn't mess up the socket handles
-  assert(fd == serverSocket_);
+  assert(fd == acceptor->getSocketFD());
+  (void)fd;
 
   // Going to accept a new client socket
   stdcxx::shared_ptr<TSocket> clientSocket;
 
-  clientSocket = serverTransport_->accept();
+  clientSocket = acceptor->accept();
   if (clientSocket) {
-    // If we're overloaded, take action here
-    if (overloadAction_ != T_OVERLOAD_NO_ACTION && serverOverloaded()) {
+    // If we're overloaded, take action here.  Every IO thread may be
+    // accepting at once.
+    bool overloaded = false;
+    if (overloadAction_ != T_OVERLOAD_NO_ACTION) {
       Guard g(connMutex_);
-      nConnectionsDropped_++;
-      nTotalConnectionsDropped_++;
+      overloaded = updateOverloaded();
+      if (overloaded) {
+        nConnectionsDropped_++;
+        nTotalConnectionsDropped_++;
+      }
+    }
+    if (overloaded) {
       if (overloadAction_ == T_OVERLOAD_CLOSE_ON_ACCEPT) {
         clientSocket->close();
         return;
@@ -966,8 +1425,10 @@ void TNonblockingServer::handleEvent(THRIFT_SOCKET fd, short which) {
       }
     }
 
-    // Create a new TConnection for this client socket.
-    TConnection* clientConnection = createConnection(clientSocket);
+    // Create a new TConnection for this client socket.  With one listener
+    // per IO thread the accepting thread keeps the connection.
+    TConnection* clientConnection
+        = createConnection(clientSocket, useReusePortAcceptors_ ? ioThread : NULL);
 
     // Fail fast if we could not create a TConnection object
     if (clientConnection == NULL) {
@@ -984,11 +1445,10 @@ void TNonblockingServer::handleEvent(THRIFT_SOCKET fd, short which) {
      * (We need to avoid writing to our own notification pipe, to
      * avoid possible deadlocks if the pipe is full.)
      *
-     * The IO thread #0 is the only one that handles these listen
-     * events, so unless the connection has been assigned to thread #0
-     * we know it's not on our thread.
+     * Unless the connection has been assigned to the IO thread that
+     * handled this listen event, we know it's not on our thread.
      */
-    if (clientConnection->getIOThreadNumber() == 0) {
+    if (clientConnection->getIOThreadNumber() == ioThreadNumber) {
       clientConnection->transition();
     } else {
       if (!clientConnection->notifyIOThread()) {
@@ -1003,6 +1463,9 @@ void TNonblockingServer::handleEvent(THRIFT_SOCKET fd, short which) {
  * Creates a socket to listen on and binds it to the local port.
  */
 void TNonblockingServer::createAndListenOnSocket() {
+  if (useReusePortAcceptors_) {
+    serverTransport_->setReusePort(true);
+  }
   serverTransport_->listen();
   serverSocket_ = serverTransport_->getSocketFD();
 }
@@ -1022,6 +1485,11 @@ void TNonblockingServer::setThreadManager(stdcxx::shared_ptr<ThreadManager> thre
 }
 
 bool TNonblockingServer::serverOverloaded() {
+  Guard g(connMutex_);
+  return updateOverloaded();
+}
+
+bool TNonblockingServer::updateOverloaded() {
   size_t activeConnections = numTConnections_ - connectionStack_.size();
   if (numActiveProcessors_ > maxActiveProcessors_ || activeConnections > maxConnections_) {
     if (!overloaded_) {
@@ -1048,9 +1516,7 @@ bool TNonblockingServer::drainPendingTask() {
   if (threadManager_) {
     stdcxx::shared_ptr<Runnable> task = threadManager_->removeNextPending();
     if (task) {
-      TConnection* connection = static_cast<TConnection::Task*>(task.get())->getTConnection();
-      assert(connection && connection->getServer() && connection->getState() == APP_WAIT_TASK);
-      connection->forceClose();
+      static_cast<TConnection::Task*>(task.get())->forceClose();
       return true;
     }
   }
@@ -1058,9 +1524,31 @@ bool TNonblockingServer::drainPendingTask() {
 }
 
 void TNonblockingServer::expireClose(stdcxx::shared_ptr<Runnable> task) {
-  TConnection* connection = static_cast<TConnection::Task*>(task.get())->getTConnection();
-  assert(connection && connection->getServer() && connection->getState() == APP_WAIT_TASK);
-  connection->forceClose();
+  static_cast<TConnection::Task*>(task.get())->forceClose();
+}
+
+uint64_t TNonblockingServer::getNotifyCompletions() const {
+  uint64_t total = 0;
+  for (uint32_t i = 0; i < ioThreads_.size(); ++i) {
+    total += ioThreads_[i]->getNotifyCompletions();
+  }
+  return total;
+}
+
+uint64_t TNonblockingServer::getNotifySignals() const {
+  uint64_t total = 0;
+  for (uint32_t i = 0; i < ioThreads_.size(); ++i) {
+    total += ioThreads_[i]->getNotifySignals();
+  }
+  return total;
+}
+
+uint64_t TNonblockingServer::getNotifyWakeups() const {
+  uint64_t total = 0;
+  for (uint32_t i = 0; i < ioThreads_.size(); ++i) {
+    total += ioThreads_[i]->getNotifyWakeups();
+  }
+  return total;
 }
 
 void TNonblockingServer::stop() { 
@@ -1085,9 +1573,18 @@ void TNonblockingServer::registerEvents(event_base* user_event_base) {
   // User-provided event-base doesn't works for multi-threaded servers
   assert(numIOThreads_ == 1 || !userEventBase_);
 
+  // the first IO thread also does the listening on server socket; with
+  // SO_REUSEPORT every other thread gets a listener of its own
+  acceptTransports_.assign(1, serverTransport_);
+  for (uint32_t id = 1; useReusePortAcceptors_ && id < numIOThreads_; ++id) {
+    acceptTransports_.push_back(serverTransport_->listenShared());
+  }
+
   for (uint32_t id = 0; id < numIOThreads_; ++id) {
-    // the first IO thread also does the listening on server socket
     THRIFT_SOCKET listenFd = (id == 0 ? serverSocket_ : THRIFT_INVALID_SOCKET);
+    if (id > 0 && id < acceptTransports_.size()) {
+      listenFd = acceptTransports_[id]->getSocketFD();
+    }
 
     shared_ptr<TNonblockingIOThread> thread(
         new TNonblockingIOThread(this, id, listenFd, useHighPriorityIOThreads_));
@@ -1161,7 +1658,12 @@ TNonblockingIOThread::TNonblockingIOThread(TNonblockingServer* server,
     listenSocket_(listenSocket),
     useHighPriority_(useHighPriority),
     eventBase_(NULL),
-    ownEventBase_(false) {
+    ownEventBase_(false),
+    notifyHead_(NULL),
+    notifyStop_(false),
+    notifyCompletions_(0),
+    notifySignals_(0),
+    notifyWakeups_(0) {
   notificationPipeFDs_[0] = -1;
   notificationPipeFDs_[1] = -1;
 }
@@ -1175,13 +1677,18 @@ TNonblockingIOThread::~TNonblockingIOThread() {
     ownEventBase_ = false;
   }
 
-  if (listenSocket_ != THRIFT_INVALID_SOCKET) {
+  // The listeners of the other threads, with SO_REUSEPORT, are closed by
+  // the server transports they came from.
+  if (listenSocket_ != THRIFT_INVALID_SOCKET && number_ == 0) {
     if (0 != ::THRIFT_CLOSESOCKET(listenSocket_)) {
       GlobalOutput.perror("TNonblockingIOThread listenSocket_ close(): ", THRIFT_GET_SOCKET_ERROR);
     }
     listenSocket_ = THRIFT_INVALID_SOCKET;
   }
 
+  if (notificationPipeFDs_[1] == notificationPipeFDs_[0]) {
+    notificationPipeFDs_[1] = THRIFT_INVALID_SOCKET;
+  }
   for (int i = 0; i < 2; ++i) {
     if (notificationPipeFDs_[i] >= 0) {
       if (0 != ::THRIFT_CLOSESOCKET(notificationPipeFDs_[i])) {
@@ -1194,6 +1701,15 @@ TNonblockingIOThread::~TNonblockingIOThread() {
 }
 
 void TNonblockingIOThread::createNotificationPipe() {
+#if defined(HAVE_SYS_EVENTFD_H) && defined(EFD_NONBLOCK) && defined(EFD_CLOEXEC)
+  int efd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (efd >= 0) {
+    notificationPipeFDs_[0] = efd;
+    notificationPipeFDs_[1] = efd;
+    return;
+  }
+  GlobalOutput.perror("TNonblockingServer::createNotificationPipe eventfd ", errno);
+#endif
   if (evutil_socketpair(AF_LOCAL, SOCK_STREAM, 0, notificationPipeFDs_) == -1) {
     GlobalOutput.perror("TNonblockingServer::createNotificationPipe ", EVUTIL_SOCKET_ERROR());
     throw TException("can't create notification pipe");
@@ -1247,7 +1763,7 @@ void TNonblockingIOThread::registerEvents() {
               listenSocket_,
               EV_READ | EV_PERSIST,
               TNonblockingIOThread::listenHandler,
-              server_);
+              this);
     event_base_set(eventBase_, &serverEvent_);
 
     // Add the event and start up the server
@@ -1281,50 +1797,98 @@ void TNonblockingIOThread::registerEvents() {
 }
 
 bool TNonblockingIOThread::notify(TNonblockingServer::TConnection* conn) {
-  THRIFT_SOCKET fd = getNotificationSendFD();
-  if (fd < 0) {
+  if (getNotificationSendFD() < 0) {
     return false;
   }
 
-  fd_set wfds, efds;
-  long ret = -1;
-  long kSize = sizeof(conn);
-  const char* pos = reinterpret_cast<const char*>(&conn);
-
-  while (kSize > 0) {
-    FD_ZERO(&wfds);
-    FD_ZERO(&efds);
-    FD_SET(fd, &wfds);
-    FD_SET(fd, &efds);
-    ret = select(static_cast<int>(fd + 1), NULL, &wfds, &efds, NULL);
-    if (ret < 0) {
-      return false;
-    } else if (ret == 0) {
-      continue;
+  if (conn == NULL) {
+    notifyStop_.store(true, boost::memory_order_release);
+  } else {
+    TNonblockingServer::TConnection* head = notifyHead_.load(boost::memory_order_relaxed);
+    do {
+      conn->notifyNext_ = head;
+    } while (!notifyHead_.compare_exchange_weak(head,
+                                                conn,
+                                                boost::memory_order_release,
+                                                boost::memory_order_relaxed));
+
+    // A non-empty queue already has a wakeup in flight that will drain it.
+    if (head != NULL) {
+      return true;
     }
+  }
+  notifySignals_.fetch_add(1, boost::memory_order_relaxed);
+  if (!signalNotification()) {
+    // The notification is already queued and will be delivered by the next
+    // successful wakeup, so there is nothing to undo here.
+    GlobalOutput.perror("TNonblocking: notify() failed to signal IO thread: ",
+                        THRIFT_GET_SOCKET_ERROR);
+  }
+  return true;
+}
 
-    if (FD_ISSET(fd, &efds)) {
-      ::THRIFT_CLOSESOCKET(fd);
-      return false;
+bool TNonblockingIOThread::signalNotification() {
+  THRIFT_SOCKET fd = getNotificationSendFD();
+#if defined(HAVE_SYS_EVENTFD_H) && defined(EFD_NONBLOCK) && defined(EFD_CLOEXEC)
+  if (fd == getNotificationRecvFD()) {
+    uint64_t one = 1;
+    while (::write(fd, &one, sizeof(one)) < 0) {
+      if (errno != EINTR) {
+        return false;
+      }
     }
+    return true;
+  }
+#endif
 
-    if (FD_ISSET(fd, &wfds)) {
-      ret = send(fd, pos, kSize, 0);
-      if (ret < 0) {
-        if (errno == EAGAIN) {
-          continue;
-        }
-
-        ::THRIFT_CLOSESOCKET(fd);
+  char wakeup = 0;
+  while (true) {
+    long ret = send(fd, cast_sockopt(&wakeup), 1, 0);
+    if (ret == 1) {
+      return true;
+    }
+    if (ret < 0) {
+      int err = THRIFT_GET_SOCKET_ERROR;
+      // A full socket buffer means a wakeup is pending already.
+      if (err == THRIFT_EWOULDBLOCK || err == THRIFT_EAGAIN) {
+        return true;
+      }
+      if (err != THRIFT_EINTR) {
         return false;
       }
+    }
+  }
+}
 
-      kSize -= ret;
-      pos += ret;
+bool TNonblockingIOThread::clearNotification(evutil_socket_t fd) {
+#if defined(HAVE_SYS_EVENTFD_H) && defined(EFD_NONBLOCK) && defined(EFD_CLOEXEC)
+  if (fd == getNotificationSendFD()) {
+    uint64_t count;
+    if (::read(fd, &count, sizeof(count)) < 0 && errno != EAGAIN && errno != EINTR) {
+      GlobalOutput.perror("TNonblocking: notifyHandler read() failed: ", errno);
+      breakLoop(true);
     }
+    return true;
   }
+#endif
 
-  return true;
+  char buf[64];
+  while (true) {
+    long nBytes = recv(fd, cast_sockopt(buf), sizeof(buf), 0);
+    if (nBytes == 0) {
+      GlobalOutput.printf("notifyHandler: Notify socket closed!");
+      return false;
+    } else if (nBytes < 0) {
+      int err = THRIFT_GET_SOCKET_ERROR;
+      if (err == THRIFT_EWOULDBLOCK || err == THRIFT_EAGAIN) {
+        return true;
+      }
+      if (err != THRIFT_EINTR) {
+        GlobalOutput.perror("TNonblocking: notifyHandler read() failed: ", err);
+        breakLoop(true);
+      }
+    }
+  }
 }
 
 /* static */
@@ -1333,37 +1897,43 @@ void TNonblockingIOThread::notifyHandler(evutil_socket_t fd, short which, void*
   assert(ioThread);
   (void)which;
 
-  while (true) {
-    TNonblockingServer::TConnection* connection = 0;
-    const int kSize = sizeof(connection);
-    long nBytes = recv(fd, cast_sockopt(&connection), kSize, 0);
-    if (nBytes == kSize) {
-      if (connection == NULL) {
-        // this is the command to stop our thread, exit the handler!
-        ioThread->breakLoop(false);
-        return;
-      }
-      connection->transition();
-    } else if (nBytes > 0) {
-      // throw away these bytes and hope that next time we get a solid read
-      GlobalOutput.printf("notifyHandler: Bad read of %d bytes, wanted %d", nBytes, kSize);
-      ioThread->breakLoop(true);
-      return;
-    } else if (nBytes == 0) {
-      GlobalOutput.printf("notifyHandler: Notify socket closed!");
-      ioThread->breakLoop(false);
-      // exit the loop
-      break;
-    } else { // nBytes < 0
-      if (THRIFT_GET_SOCKET_ERROR != THRIFT_EWOULDBLOCK
-          && THRIFT_GET_SOCKET_ERROR != THRIFT_EAGAIN) {
-        GlobalOutput.perror("TNonblocking: notifyHandler read() failed: ", THRIFT_GET_SOCKET_ERROR);
-        ioThread->breakLoop(true);
-        return;
-      }
-      // exit the loop
-      break;
-    }
+  // Clear the descriptor before taking the queue: anything pushed after the
+  // exchange below signals again and gets its own wakeup.
+  if (!ioThread->clearNotification(fd)) {
+    ioThread->breakLoop(false);
+    return;
+  }
+  ioThread->notifyWakeups_.fetch_add(1, boost::memory_order_relaxed);
+
+  TNonblockingServer::TConnection* pending
+      = ioThread->notifyHead_.exchange(NULL, boost::memory_order_acquire);
+
+  // The queue is a stack; reverse it to transition in completion order.
+  TNonblockingServer::TConnection* ordered = NULL;
+  uint64_t completions = 0;
+  while (pending != NULL) {
+    TNonblockingServer::TConnection* next = pending->notifyNext_;
+    pending->notifyNext_ = ordered;
+    ordered = pending;
+    pending = next;
+    ++completions;
+  }
+
+  // Count before transitioning so that the counters are up to date by the
+  // time a client sees its response.
+  ioThread->notifyCompletions_.fetch_add(completions, boost::memory_order_relaxed);
+
+  while (ordered != NULL) {
+    // The connection may be queued again as soon as it has been handled.
+    TNonblockingServer::TConnection* connection = ordered;
+    ordered = connection->notifyNext_;
+    connection->notifyNext_ = NULL;
+    connection->handleNotification();
+  }
+
+  if (ioThread->notifyStop_.exchange(false, boost::memory_order_acquire)) {
+    // this is the command to stop our thread, exit the handler!
+    ioThread->breakLoop(false);
   }
 }
 
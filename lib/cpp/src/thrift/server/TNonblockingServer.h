@@ -22,6 +22,7 @@
 
 #include <thrift/Thrift.h>
 #include <thrift/stdcxx.h>
+#include <thrift/async/TAsyncProcessor.h>
 #include <thrift/server/TServer.h>
 #include <thrift/transport/PlatformSocket.h>
 #include <thrift/transport/TBufferTransports.h>
@@ -32,6 +33,7 @@
 #include <thrift/concurrency/Thread.h>
 #include <thrift/concurrency/PlatformThreadFactory.h>
 #include <thrift/concurrency/Mutex.h>
+#include <boost/atomic.hpp>
 #include <stack>
 #include <vector>
 #include <string>
@@ -147,12 +149,18 @@ private:
   /// # of IO threads to use by default
   static const int DEFAULT_IO_THREADS = 1;
 
+  /// Default limit on requests in flight per connection (1 = no pipelining)
+  static const int MAX_PIPELINED_REQUESTS = 1;
+
   /// # of IO threads this server will use
   size_t numIOThreads_;
 
   /// Whether to set high scheduling priority for IO threads
   bool useHighPriorityIOThreads_;
 
+  /// Whether every IO thread accepts on its own SO_REUSEPORT listener
+  bool useReusePortAcceptors_;
+
   /// Server socket file descriptor
   THRIFT_SOCKET serverSocket_;
 
@@ -165,12 +173,20 @@ private:
   /// Is thread pool processing?
   bool threadPoolProcessing_;
 
+  /// Processor that completes calls through a callback, used instead of the TProcessor if set
+  stdcxx::shared_ptr<async::TAsyncProcessor> asyncProcessor_;
+
   // Factory to create the IO threads
   stdcxx::shared_ptr<PlatformThreadFactory> ioThreadFactory_;
 
   // Vector of IOThread objects that will handle our IO
   std::vector<stdcxx::shared_ptr<TNonblockingIOThread> > ioThreads_;
 
+  // Listener of each IO thread that accepts connections, indexed by thread
+  // number.  Entry 0 is serverTransport_; the others are only set up when
+  // useReusePortAcceptors_ is on.
+  std::vector<stdcxx::shared_ptr<TNonblockingServerTransport> > acceptTransports_;
+
   // Index of next IO Thread to be used (for round-robin)
   uint32_t nextIOThread_;
 
@@ -198,6 +214,9 @@ private:
   /// Time in milliseconds before an unperformed task expires (0 == infinite).
   int64_t taskExpireTime_;
 
+  /// Limit for requests of one connection processing or waiting to be sent
+  size_t maxPipelinedRequests_;
+
   /**
    * Hysteresis for overload state.  This is the fraction of the overload
    * value that needs to be reached before the overload state is cleared;
@@ -272,14 +291,16 @@ private:
    * to handle those requests.
    *
    * @param which the event flag that triggered the handler.
+   * @param ioThread the IO thread that owns the listen socket.
    */
-  void handleEvent(THRIFT_SOCKET fd, short which);
+  void handleEvent(THRIFT_SOCKET fd, short which, TNonblockingIOThread* ioThread);
 
   void init() {
     serverSocket_ = THRIFT_INVALID_SOCKET;
     numIOThreads_ = DEFAULT_IO_THREADS;
     nextIOThread_ = 0;
     useHighPriorityIOThreads_ = false;
+    useReusePortAcceptors_ = false;
     userEventBase_ = NULL;
     threadPoolProcessing_ = false;
     numTConnections_ = 0;
@@ -289,6 +310,7 @@ private:
     maxConnections_ = MAX_CONNECTIONS;
     maxFrameSize_ = MAX_FRAME_SIZE;
     taskExpireTime_ = 0;
+    maxPipelinedRequests_ = MAX_PIPELINED_REQUESTS;
     overloadHysteresis_ = 0.8;
     overloadAction_ = T_OVERLOAD_NO_ACTION;
     writeBufferDefaultSize_ = WRITE_BUFFER_DEFAULT_SIZE;
@@ -340,6 +362,28 @@ public:
     setThreadManager(threadManager);
   }
 
+  /**
+   * A server whose IO threads hand requests to an asynchronous processor,
+   * such as the AsyncProcessor generated with the cpp:cob_style option,
+   * and write each response once the processor calls back.  A connection
+   * reads up to getMaxPipelinedRequests() requests ahead and writes their
+   * responses in the order they complete, so that one IO thread serves many
+   * calls that wait on something else, such as calls to other servers made
+   * with a future client.  The processor is called on the IO thread, and
+   * must not block it; it may complete a call from any thread.  All calls
+   * must be complete when the server is destroyed.
+   */
+  TNonblockingServer(const stdcxx::shared_ptr<async::TAsyncProcessor>& asyncProcessor,
+                     const stdcxx::shared_ptr<TProtocolFactory>& protocolFactory,
+                     const stdcxx::shared_ptr<apache::thrift::transport::TNonblockingServerTransport>& serverTransport)
+    : TServer(stdcxx::shared_ptr<TProcessor>()), serverTransport_(serverTransport) {
+    init();
+
+    asyncProcessor_ = asyncProcessor;
+    setInputProtocolFactory(protocolFactory);
+    setOutputProtocolFactory(protocolFactory);
+  }
+
   TNonblockingServer(const stdcxx::shared_ptr<TProcessorFactory>& processorFactory,
                      const stdcxx::shared_ptr<TTransportFactory>& inputTransportFactory,
                      const stdcxx::shared_ptr<TTransportFactory>& outputTransportFactory,
@@ -405,6 +449,20 @@ public:
   /** Return the number of IO threads used by this server. */
   size_t getNumIOThreads() const { return numIOThreads_; }
 
+  /** Return whether each IO thread accepts on its own listen socket */
+  bool useReusePortAcceptors() const { return useReusePortAcceptors_; }
+
+  /**
+   * Set whether each IO thread accepts on its own listen socket.  By default
+   * IO thread #0 accepts every connection and hands them out round-robin.
+   * With this set, the server transport opens one SO_REUSEPORT listener per
+   * IO thread, the kernel balances new connections across them and each
+   * thread keeps the connections it accepted.  The server transport must
+   * support SO_REUSEPORT (TNonblockingServerSocket does on most platforms).
+   * Can only be used before the call to serve().
+   */
+  void setUseReusePortAcceptors(bool val) { useReusePortAcceptors_ = val; }
+
   /**
    * Get the maximum number of unused TConnection we will hold in reserve.
    *
@@ -421,6 +479,9 @@ public:
 
   bool isThreadPoolProcessing() const { return threadPoolProcessing_; }
 
+  /// The asynchronous processor the server was built with, if any.
+  stdcxx::shared_ptr<async::TAsyncProcessor> getAsyncProcessor() const { return asyncProcessor_; }
+
   void addTask(stdcxx::shared_ptr<Runnable> task) {
     threadManager_->add(task, 0LL, taskExpireTime_);
   }
@@ -456,6 +517,26 @@ public:
    */
   size_t getNumActiveProcessors() const { return numActiveProcessors_; }
 
+  /**
+   * Return the number of task completions handed back to the IO threads,
+   * summed over all IO threads.
+   */
+  uint64_t getNotifyCompletions() const;
+
+  /**
+   * Return how often a worker thread had to signal an IO thread about a
+   * completion.  Completions that arrive while an IO thread has not yet
+   * drained its queue ride along with the earlier signal.
+   */
+  uint64_t getNotifySignals() const;
+
+  /**
+   * Return how often the IO threads woke up to drain completions.  Each
+   * wakeup costs one read of the notification descriptor, so the ratio to
+   * getNotifyCompletions() is the notification syscall overhead per task.
+   */
+  uint64_t getNotifyWakeups() const;
+
   /// Increment the count of connections currently processing.
   void incrementActiveProcessors() {
     Guard g(connMutex_);
@@ -564,6 +645,32 @@ public:
    */
   void setTaskExpireTime(int64_t taskExpireTime) { taskExpireTime_ = taskExpireTime; }
 
+  /**
+   * Get the maximum # of requests a connection may have in flight.
+   *
+   * @return current setting.
+   */
+  size_t getMaxPipelinedRequests() const { return maxPipelinedRequests_; }
+
+  /**
+   * Set the maximum # of requests a connection may have in flight.  With the
+   * default of 1 a connection stops reading while its request is processed
+   * and its response written.  With a larger value and a thread manager, the
+   * connection keeps reading frames and hands each one to the thread manager
+   * as its own task until this many requests are processing or waiting to be
+   * sent; responses are written in the order they complete, so clients must
+   * match them by seqid (as the generated concurrent clients do).  The
+   * processor and any server event handler of a connection are then called
+   * from several threads at once.  A server with an asynchronous processor
+   * always reads ahead like this.  Can only be used before the call to
+   * serve().
+   *
+   * @param maxPipelinedRequests new setting, at least 1.
+   */
+  void setMaxPipelinedRequests(size_t maxPipelinedRequests) {
+    maxPipelinedRequests_ = maxPipelinedRequests > 0 ? maxPipelinedRequests : 1;
+  }
+
   /**
    * Determine if the server is currently overloaded.
    * This function checks the maximums for open connections and connections
@@ -711,17 +818,23 @@ private:
    */
   void expireClose(stdcxx::shared_ptr<Runnable> task);
 
+  /**
+   * serverOverloaded() for a caller that holds connMutex_, which guards
+   * the counts it looks at and the overload state.
+   */
+  bool updateOverloaded();
+
   /**
    * Return an initialized connection object.  Creates or recovers from
    * pool a TConnection and initializes it with the provided socket FD
    * and flags.
    *
    * @param socket FD of socket associated with this connection.
-   * @param addr the sockaddr of the client
-   * @param addrLen the length of addr
+   * @param ioThread the IO thread to assign it to, or NULL for round-robin.
    * @return pointer to initialized TConnection object.
    */
-  TConnection* createConnection(stdcxx::shared_ptr<TSocket> socket);
+  TConnection* createConnection(stdcxx::shared_ptr<TSocket> socket,
+                                TNonblockingIOThread* ioThread);
 
   /**
    * Returns a connection to pool or deletion.  If the connection pool
@@ -758,12 +871,25 @@ public:
   // only be called after the thread has been started.
   Thread::id_t getThreadId() const { return threadId_; }
 
-  // Returns the send-fd for task complete notifications.
+  // Returns the send-fd for task complete notifications.  With eventfd this
+  // is the same descriptor as the read-fd.
   evutil_socket_t getNotificationSendFD() const { return notificationPipeFDs_[1]; }
 
   // Returns the read-fd for task complete notifications.
   evutil_socket_t getNotificationRecvFD() const { return notificationPipeFDs_[0]; }
 
+  // Returns the number of task completions delivered to this thread.
+  uint64_t getNotifyCompletions() const {
+    return notifyCompletions_.load(boost::memory_order_relaxed);
+  }
+
+  // Returns the number of times a producer had to signal the notification
+  // descriptor, i.e. found the completion queue empty.
+  uint64_t getNotifySignals() const { return notifySignals_.load(boost::memory_order_relaxed); }
+
+  // Returns the number of times this thread woke up to drain completions.
+  uint64_t getNotifyWakeups() const { return notifyWakeups_.load(boost::memory_order_relaxed); }
+
   // Returns the actual thread object associated with this IO thread.
   stdcxx::shared_ptr<Thread> getThread() const { return thread_; }
 
@@ -788,30 +914,39 @@ public:
 private:
   /**
    * C-callable event handler for signaling task completion.  Provides a
-   * callback that libevent can understand that will read a connection
-   * object's address from a pipe and call connection->transition() for
-   * that object.
+   * callback that libevent can understand that will clear the notification
+   * descriptor, drain the completion queue and call
+   * connection->transition() for every connection found on it.
    *
    * @param fd the descriptor the event occurred on.
    */
   static void notifyHandler(evutil_socket_t fd, short which, void* v);
 
+  /// Reads pending wakeups off the notification descriptor; false once the
+  /// descriptor has been closed.
+  bool clearNotification(evutil_socket_t fd);
+
+  /// Wakes up the event loop; called when a producer finds the queue empty.
+  bool signalNotification();
+
   /**
    * C-callable event handler for listener events.  Provides a callback
    * that libevent can understand which invokes server->handleEvent().
    *
    * @param fd the descriptor the event occurred on.
    * @param which the flags associated with the event.
-   * @param v void* callback arg where we placed TNonblockingServer's "this".
+   * @param v void* callback arg where we placed TNonblockingIOThread's "this".
    */
   static void listenHandler(evutil_socket_t fd, short which, void* v) {
-    ((TNonblockingServer*)v)->handleEvent(fd, which);
+    TNonblockingIOThread* ioThread = (TNonblockingIOThread*)v;
+    ioThread->server_->handleEvent(fd, which, ioThread);
   }
 
   /// Exits the loop ASAP in case of shutdown or error.
   void breakLoop(bool error);
 
-  /// Create the pipe used to notify I/O process of task completion.
+  /// Create the eventfd (or pipe) used to notify I/O process of task
+  /// completion.
   void createNotificationPipe();
 
   /// Unregisters our events for notification and listen sockets.
@@ -849,9 +984,24 @@ private:
   /// Used with eventBase_ for task completion notification
   struct event notificationEvent_;
 
-  /// File descriptors for pipe used for task completion notification.
+  /// File descriptors for pipe used for task completion notification.  Both
+  /// hold the same descriptor when an eventfd is used.
   evutil_socket_t notificationPipeFDs_[2];
 
+  /// Lock-free stack of connections with completions pushed by worker
+  /// threads, newest first, linked through the connections themselves.
+  /// Only the thread that finds it empty signals the notification descriptor,
+  /// so a burst of completions costs a single wakeup.
+  boost::atomic<TNonblockingServer::TConnection*> notifyHead_;
+
+  /// Set by notify(NULL) to ask the loop to stop.
+  boost::atomic<bool> notifyStop_;
+
+  /// Counters for completions, producer signals and loop wakeups.
+  boost::atomic<uint64_t> notifyCompletions_;
+  boost::atomic<uint64_t> notifySignals_;
+  boost::atomic<uint64_t> notifyWakeups_;
+
   /// Actual IO Thread
   stdcxx::shared_ptr<Thread> thread_;
 };
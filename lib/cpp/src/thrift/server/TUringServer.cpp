@@ -0,0 +1,1140 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <thrift/thrift-config.h>
+
+#include <thrift/server/TUringServer.h>
+#include <thrift/TArena.h>
+#include <thrift/transport/PlatformSocket.h>
+#include <thrift/transport/TBufferTransports.h>
+#include <thrift/transport/TSocket.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstdlib>
+#include <cstring>
+#include <typeinfo>
+
+#ifdef HAVE_SYS_SOCKET_H
+#include <sys/socket.h>
+#endif
+
+#ifdef HAVE_NETINET_IN_H
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#endif
+
+#ifdef HAVE_UNISTD_H
+#include <unistd.h>
+#endif
+
+#ifdef HAVE_FCNTL_H
+#include <fcntl.h>
+#endif
+
+#if defined(HAVE_SYS_EPOLL_H) && defined(HAVE_SYS_EVENTFD_H)
+#define THRIFT_URING_SERVER_SUPPORTED 1
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#endif
+
+#if defined(THRIFT_URING_SERVER_SUPPORTED) && defined(HAVE_LINUX_IO_URING_H)
+#include <linux/io_uring.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+// IORING_FEAT_FAST_POLL came with the socket operations used here.
+#if defined(__NR_io_uring_setup) && defined(IORING_FEAT_FAST_POLL)
+#define THRIFT_URING_SERVER_IO_URING 1
+#endif
+#endif
+
+namespace apache {
+namespace thrift {
+namespace server {
+
+using apache::thrift::concurrency::Guard;
+using apache::thrift::concurrency::Runnable;
+using apache::thrift::protocol::TProtocol;
+using apache::thrift::transport::TMemoryBuffer;
+using apache::thrift::transport::TSocket;
+using apache::thrift::transport::TTransportException;
+using stdcxx::shared_ptr;
+
+/**
+ * A client connection.  It always waits for exactly one thing: a receive,
+ * a send, or the task processing its request.
+ */
+class TUringServer::Connection {
+public:
+  enum State { READING, PROCESSING, SENDING };
+
+  Connection(int fd, uint8_t* zone, int zoneIndex)
+    : socket(new TSocket(fd)),
+      fd(fd),
+      state(READING),
+      zone(zone),
+      zoneIndex(zoneIndex),
+      zoneStart(0),
+      zoneEnd(0),
+      big(false),
+      bigHave(0),
+      requestLen(0),
+      in(new TMemoryBuffer()),
+      out(new TMemoryBuffer()),
+      context(NULL),
+      keepOpen(true),
+      sent(0),
+      opBuf(NULL),
+      opLen(0),
+      opWrite(false),
+      waiting(false) {}
+
+  shared_ptr<TSocket> socket;
+  int fd;
+  State state;
+
+  /// Read buffer; the bytes from zoneStart to zoneEnd are not used up yet.
+  uint8_t* zone;
+  int zoneIndex;
+  uint32_t zoneStart;
+  uint32_t zoneEnd;
+
+  /// A request too long for the zone, bigHave bytes of it read so far
+  bool big;
+  std::vector<uint8_t> bigRequest;
+  uint32_t bigHave;
+
+  /// Length of the request being processed
+  uint32_t requestLen;
+
+  shared_ptr<TMemoryBuffer> in;
+  shared_ptr<TMemoryBuffer> out;
+  shared_ptr<TProtocol> inputProtocol;
+  shared_ptr<TProtocol> outputProtocol;
+  shared_ptr<TProcessor> processor;
+  void* context;
+  TArena arena;
+  bool keepOpen;
+  uint32_t sent;
+
+  /// The receive or send the epoll backend waits to retry
+  uint8_t* opBuf;
+  uint32_t opLen;
+  bool opWrite;
+  bool waiting;
+};
+
+class TUringServer::Task : public Runnable {
+public:
+  Task(TUringServer* server, Connection* connection)
+    : server_(server), connection_(connection) {}
+
+  void run() {
+    server_->process(connection_);
+    server_->notifyProcessed(connection_);
+  }
+
+private:
+  TUringServer* server_;
+  Connection* connection_;
+};
+
+struct TUringServer::Event {
+  enum Type { ACCEPTED, IO, WAKE };
+
+  Event(Type type, Connection* connection, int result)
+    : type(type), connection(connection), result(result) {}
+
+  Type type;
+  Connection* connection;
+
+  /// The accepted descriptor, or the bytes moved; -errno on failure
+  int result;
+};
+
+/**
+ * Turns the sockets of the server into a stream of completions, whether
+ * the kernel completes the operations (io_uring) or the poller does once
+ * a socket is ready (epoll).
+ */
+class TUringServer::Poller {
+public:
+  virtual ~Poller() {}
+
+  /// Accepts connections on a listening socket, each one an ACCEPTED event.
+  virtual void startAccepting(int fd) = 0;
+  virtual void stopAccepting() = 0;
+
+  /// Registers read buffers; false if they are used as ordinary memory.
+  virtual bool registerBuffers(uint8_t* base, uint32_t size, int count) {
+    (void)base;
+    (void)size;
+    (void)count;
+    return false;
+  }
+
+  virtual bool add(Connection* connection) = 0;
+  virtual void remove(Connection* connection) = 0;
+
+  /// Receives into buf, which is in registered buffer bufIndex if not negative.
+  virtual void recv(Connection* connection, uint8_t* buf, uint32_t len, int bufIndex) = 0;
+  virtual void send(Connection* connection, const uint8_t* buf, uint32_t len) = 0;
+
+  /// Starts what was asked for, then waits for at least one event.
+  virtual void wait(std::vector<Event>& events) = 0;
+
+  /// Whether no operation is left but waiting for the wake descriptor
+  virtual bool idle() = 0;
+};
+
+#ifdef THRIFT_URING_SERVER_SUPPORTED
+
+static int setNonBlocking(int fd) {
+  int flags = ::fcntl(fd, F_GETFL, 0);
+  if (flags < 0) {
+    return flags;
+  }
+  return ::fcntl(fd, F_SETFL, flags | O_NONBLOCK);
+}
+
+class TUringServer::EpollPoller : public Poller {
+public:
+  explicit EpollPoller(int wakeFd) : wakeFd_(wakeFd), listenFd_(-1), waiting_(0) {
+    epollFd_ = ::epoll_create1(EPOLL_CLOEXEC);
+    if (epollFd_ < 0) {
+      int errno_copy = errno;
+      throw TTransportException(TTransportException::INTERNAL_ERROR,
+                                "TUringServer: epoll_create1() failed",
+                                errno_copy);
+    }
+    control(EPOLL_CTL_ADD, wakeFd_, EPOLLIN, &wakeFd_);
+  }
+
+  virtual ~EpollPoller() { ::close(epollFd_); }
+
+  void startAccepting(int fd) {
+    listenFd_ = fd;
+    control(EPOLL_CTL_ADD, fd, EPOLLIN, &listenFd_);
+  }
+
+  void stopAccepting() {
+    if (listenFd_ >= 0) {
+      control(EPOLL_CTL_DEL, listenFd_, 0, NULL);
+      listenFd_ = -1;
+    }
+  }
+
+  bool add(Connection* connection) {
+    return control(EPOLL_CTL_ADD,
+                   connection->fd,
+                   EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET,
+                   connection);
+  }
+
+  void remove(Connection* connection) {
+    control(EPOLL_CTL_DEL, connection->fd, 0, NULL);
+    if (connection->waiting) {
+      connection->waiting = false;
+      --waiting_;
+    }
+  }
+
+  void recv(Connection* connection, uint8_t* buf, uint32_t len, int bufIndex) {
+    (void)bufIndex;
+    connection->opBuf = buf;
+    connection->opLen = len;
+    connection->opWrite = false;
+    attempt(connection);
+  }
+
+  void send(Connection* connection, const uint8_t* buf, uint32_t len) {
+    connection->opBuf = const_cast<uint8_t*>(buf);
+    connection->opLen = len;
+    connection->opWrite = true;
+    attempt(connection);
+  }
+
+  void wait(std::vector<Event>& events) {
+    events.clear();
+    events.swap(ready_);
+
+    epoll_event ready[64];
+    int n = ::epoll_wait(epollFd_, ready, 64, events.empty() ? -1 : 0);
+    if (n < 0 && errno != EINTR) {
+      GlobalOutput.perror("TUringServer: epoll_wait() ", errno);
+    }
+    for (int i = 0; i < n; ++i) {
+      void* tag = ready[i].data.ptr;
+      if (tag == &wakeFd_) {
+        uint64_t value;
+        if (::read(wakeFd_, &value, sizeof(value)) < 0 && errno != EAGAIN) {
+          GlobalOutput.perror("TUringServer: eventfd read() ", errno);
+        }
+        events.push_back(Event(Event::WAKE, NULL, 0));
+      } else if (tag == &listenFd_) {
+        acceptAll(events);
+      } else {
+        Connection* connection = static_cast<Connection*>(tag);
+        if (connection->waiting) {
+          connection->waiting = false;
+          --waiting_;
+          attempt(connection);
+        }
+      }
+    }
+    events.insert(events.end(), ready_.begin(), ready_.end());
+    ready_.clear();
+  }
+
+  bool idle() { return waiting_ == 0 && ready_.empty(); }
+
+private:
+  bool control(int op, int fd, uint32_t flags, void* tag) {
+    epoll_event ev;
+    std::memset(&ev, 0, sizeof(ev));
+    ev.events = flags;
+    ev.data.ptr = tag;
+    if (::epoll_ctl(epollFd_, op, fd, &ev) < 0) {
+      GlobalOutput.perror("TUringServer: epoll_ctl() ", errno);
+      return false;
+    }
+    return true;
+  }
+
+  void attempt(Connection* connection) {
+    ssize_t n;
+    do {
+      n = connection->opWrite
+              ? ::send(connection->fd, connection->opBuf, connection->opLen, MSG_NOSIGNAL)
+              : ::recv(connection->fd, connection->opBuf, connection->opLen, 0);
+    } while (n < 0 && errno == EINTR);
+    if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      // Edge triggered: the next readiness event of the socket retries.
+      connection->waiting = true;
+      ++waiting_;
+      return;
+    }
+    ready_.push_back(Event(Event::IO, connection, n < 0 ? -errno : static_cast<int>(n)));
+  }
+
+  void acceptAll(std::vector<Event>& events) {
+    // Take a bounded batch, so that busy connections are not starved.
+    for (int i = 0; i < 64; ++i) {
+      int fd = ::accept4(listenFd_, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+      if (fd < 0) {
+        if (errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR) {
+          events.push_back(Event(Event::ACCEPTED, NULL, -errno));
+        }
+        return;
+      }
+      events.push_back(Event(Event::ACCEPTED, NULL, fd));
+    }
+  }
+
+  int epollFd_;
+  int wakeFd_;
+  int listenFd_;
+  int waiting_;
+  std::vector<Event> ready_;
+};
+
+#ifdef THRIFT_URING_SERVER_IO_URING
+
+/**
+ * Drives an io_uring through the system calls, so there is no dependency
+ * on liburing.  Every operation is tagged with its connection; the tags
+ * below stand for the others.
+ */
+class TUringServer::UringPoller : public Poller {
+public:
+  enum { TAG_ACCEPT = 1, TAG_WAKE = 2, TAG_CANCEL = 3 };
+
+  UringPoller(int wakeFd, unsigned entries)
+    : wakeFd_(wakeFd),
+      listenFd_(-1),
+      accepting_(false),
+      acceptPending_(false),
+      wakePending_(false),
+      fixedBuffers_(false),
+      inFlight_(0),
+      unsubmitted_(0),
+      wakeValue_(0) {
+    io_uring_params params;
+    std::memset(&params, 0, sizeof(params));
+    // Room for a completion per connection beyond the submission queue
+    params.flags = IORING_SETUP_CQSIZE;
+    params.cq_entries = entries * 8;
+    ringFd_ = static_cast<int>(::syscall(__NR_io_uring_setup, entries, &params));
+    if (ringFd_ < 0) {
+      int errno_copy = errno;
+      throw TTransportException(TTransportException::INTERNAL_ERROR,
+                                "TUringServer: io_uring_setup() failed",
+                                errno_copy);
+    }
+    if (!(params.features & IORING_FEAT_FAST_POLL)) {
+      ::close(ringFd_);
+      throw TTransportException(TTransportException::INTERNAL_ERROR,
+                                "TUringServer: io_uring cannot poll sockets");
+    }
+
+    sqSize_ = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    cqSize_ = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+    if (single) {
+      sqSize_ = cqSize_ = (std::max)(sqSize_, cqSize_);
+    }
+    sqRing_ = map(sqSize_, IORING_OFF_SQ_RING);
+    cqRing_ = single ? sqRing_ : map(cqSize_, IORING_OFF_CQ_RING);
+    sqesSize_ = params.sq_entries * sizeof(io_uring_sqe);
+    sqes_ = static_cast<io_uring_sqe*>(map(sqesSize_, IORING_OFF_SQES));
+    if (sqRing_ == MAP_FAILED || cqRing_ == MAP_FAILED || sqes_ == MAP_FAILED) {
+      int errno_copy = errno;
+      unmap();
+      ::close(ringFd_);
+      throw TTransportException(TTransportException::INTERNAL_ERROR,
+                                "TUringServer: mmap() of the ring failed",
+                                errno_copy);
+    }
+
+    uint8_t* sq = static_cast<uint8_t*>(sqRing_);
+    sqHead_ = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    sqTail_ = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    sqMask_ = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    sqEntries_ = params.sq_entries;
+    // Entries are always filled in order, so the index array never changes.
+    unsigned* array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    for (unsigned i = 0; i < sqEntries_; ++i) {
+      array[i] = i;
+    }
+
+    uint8_t* cq = static_cast<uint8_t*>(cqRing_);
+    cqHead_ = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    cqTail_ = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    cqMask_ = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    armWake();
+  }
+
+  virtual ~UringPoller() {
+    // Complete the read of the wake descriptor, which would otherwise write
+    // into this object after it is gone.
+    if (wakePending_) {
+      uint64_t one = 1;
+      if (::write(wakeFd_, &one, sizeof(one)) == sizeof(one)) {
+        std::vector<Event> events;
+        wakePending_ = false;
+        while (!drained()) {
+          // The read may still be queued rather than submitted.
+          enter(unsubmitted_, 1);
+          reap(events);
+        }
+      }
+    }
+    unmap();
+    ::close(ringFd_);
+  }
+
+  void startAccepting(int fd) {
+    listenFd_ = fd;
+    accepting_ = true;
+    armAccept();
+  }
+
+  void stopAccepting() {
+    accepting_ = false;
+    if (acceptPending_) {
+      io_uring_sqe* sqe = getSqe();
+      sqe->opcode = IORING_OP_ASYNC_CANCEL;
+      sqe->fd = -1;
+      sqe->addr = TAG_ACCEPT;
+      sqe->user_data = TAG_CANCEL;
+    }
+  }
+
+  bool registerBuffers(uint8_t* base, uint32_t size, int count) {
+    std::vector<iovec> iovecs(count);
+    for (int i = 0; i < count; ++i) {
+      iovecs[i].iov_base = base + static_cast<size_t>(i) * size;
+      iovecs[i].iov_len = size;
+    }
+    if (::syscall(__NR_io_uring_register, ringFd_, IORING_REGISTER_BUFFERS, &iovecs[0], count)
+        < 0) {
+      GlobalOutput.perror("TUringServer: registering read buffers ", errno);
+      return false;
+    }
+    fixedBuffers_ = true;
+    return true;
+  }
+
+  bool add(Connection* connection) {
+    (void)connection;
+    return true;
+  }
+
+  void remove(Connection* connection) { (void)connection; }
+
+  void recv(Connection* connection, uint8_t* buf, uint32_t len, int bufIndex) {
+    io_uring_sqe* sqe = getSqe();
+    if (fixedBuffers_ && bufIndex >= 0) {
+      sqe->opcode = IORING_OP_READ_FIXED;
+      sqe->buf_index = static_cast<uint16_t>(bufIndex);
+    } else {
+      sqe->opcode = IORING_OP_RECV;
+    }
+    sqe->fd = connection->fd;
+    sqe->addr = reinterpret_cast<uintptr_t>(buf);
+    sqe->len = len;
+    sqe->user_data = reinterpret_cast<uintptr_t>(connection);
+  }
+
+  void send(Connection* connection, const uint8_t* buf, uint32_t len) {
+    io_uring_sqe* sqe = getSqe();
+    sqe->opcode = IORING_OP_SEND;
+    sqe->fd = connection->fd;
+    sqe->addr = reinterpret_cast<uintptr_t>(buf);
+    sqe->len = len;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = reinterpret_cast<uintptr_t>(connection);
+  }
+
+  void wait(std::vector<Event>& events) {
+    events.clear();
+    events.swap(pending_);
+    reap(events);
+    // One system call submits everything queued since the last one and, if
+    // nothing completed meanwhile, waits for the next completion.
+    enter(unsubmitted_, events.empty() ? 1 : 0);
+    reap(events);
+    // Completions reaped while queueing the operations above
+    events.insert(events.end(), pending_.begin(), pending_.end());
+    pending_.clear();
+  }
+
+  bool idle() { return pending_.empty() && inFlight_ == (wakePending_ ? 1 : 0); }
+
+private:
+  void* map(size_t size, off_t offset) {
+    return ::mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ringFd_, offset);
+  }
+
+  void unmap() {
+    if (sqes_ != MAP_FAILED) {
+      ::munmap(sqes_, sqesSize_);
+    }
+    if (cqRing_ != MAP_FAILED && cqRing_ != sqRing_) {
+      ::munmap(cqRing_, cqSize_);
+    }
+    if (sqRing_ != MAP_FAILED) {
+      ::munmap(sqRing_, sqSize_);
+    }
+  }
+
+  bool drained() { return inFlight_ == 0; }
+
+  io_uring_sqe* getSqe() {
+    while (*sqTail_ - __atomic_load_n(sqHead_, __ATOMIC_ACQUIRE) >= sqEntries_) {
+      // The submission queue is full: hand it to the kernel first.  If
+      // completions are backed up it takes nothing until they are reaped,
+      // which may queue entries of its own; wait() delivers them later.
+      if (!enter(unsubmitted_, 0)) {
+        reap(pending_);
+      }
+    }
+    unsigned tail = *sqTail_;
+    io_uring_sqe* sqe = &sqes_[tail & sqMask_];
+    std::memset(sqe, 0, sizeof(*sqe));
+    __atomic_store_n(sqTail_, tail + 1, __ATOMIC_RELEASE);
+    ++unsubmitted_;
+    ++inFlight_;
+    return sqe;
+  }
+
+  /// False if the kernel refused because completions are backed up
+  bool enter(unsigned toSubmit, unsigned minComplete) {
+    while (true) {
+      int r = static_cast<int>(::syscall(__NR_io_uring_enter,
+                                         ringFd_,
+                                         toSubmit,
+                                         minComplete,
+                                         minComplete > 0 ? IORING_ENTER_GETEVENTS : 0,
+                                         NULL,
+                                         0));
+      if (r >= 0) {
+        unsubmitted_ -= static_cast<unsigned>(r);
+        return true;
+      }
+      if (errno == EINTR) {
+        continue;
+      }
+      if (errno == EBUSY || errno == EAGAIN) {
+        // Completions are backed up; the caller reaps them and comes back.
+        return false;
+      }
+      int errno_copy = errno;
+      throw TTransportException(TTransportException::INTERNAL_ERROR,
+                                "TUringServer: io_uring_enter() failed",
+                                errno_copy);
+    }
+  }
+
+  void reap(std::vector<Event>& events) {
+    // Each completion is consumed before it is handled: rearming may need
+    // a submission entry, and getting one may reap in turn.
+    unsigned head;
+    while ((head = *cqHead_) != __atomic_load_n(cqTail_, __ATOMIC_ACQUIRE)) {
+      const io_uring_cqe cqe = cqes_[head & cqMask_];
+      __atomic_store_n(cqHead_, head + 1, __ATOMIC_RELEASE);
+      --inFlight_;
+      switch (cqe.user_data) {
+      case TAG_ACCEPT:
+        acceptPending_ = false;
+        if (cqe.res != -ECANCELED && cqe.res != -EAGAIN && cqe.res != -EINTR) {
+          events.push_back(Event(Event::ACCEPTED, NULL, cqe.res));
+        }
+        if (accepting_) {
+          armAccept();
+        }
+        break;
+      case TAG_WAKE:
+        if (wakePending_) {
+          wakePending_ = false;
+          events.push_back(Event(Event::WAKE, NULL, 0));
+          armWake();
+        }
+        break;
+      case TAG_CANCEL:
+        break;
+      default:
+        events.push_back(Event(Event::IO,
+                               reinterpret_cast<Connection*>(static_cast<uintptr_t>(cqe.user_data)),
+                               cqe.res));
+      }
+    }
+  }
+
+  void armAccept() {
+    io_uring_sqe* sqe = getSqe();
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = listenFd_;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    sqe->user_data = TAG_ACCEPT;
+    acceptPending_ = true;
+  }
+
+  void armWake() {
+    io_uring_sqe* sqe = getSqe();
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = wakeFd_;
+    sqe->addr = reinterpret_cast<uintptr_t>(&wakeValue_);
+    sqe->len = sizeof(wakeValue_);
+    sqe->user_data = TAG_WAKE;
+    wakePending_ = true;
+  }
+
+  int ringFd_;
+  int wakeFd_;
+  int listenFd_;
+  bool accepting_;
+  bool acceptPending_;
+  bool wakePending_;
+  bool fixedBuffers_;
+
+  /// Operations submitted or queued and not completed yet
+  int inFlight_;
+  unsigned unsubmitted_;
+  uint64_t wakeValue_;
+  /// Events reaped outside wait(), which returns them next
+  std::vector<Event> pending_;
+
+  void* sqRing_;
+  void* cqRing_;
+  io_uring_sqe* sqes_;
+  size_t sqSize_;
+  size_t cqSize_;
+  size_t sqesSize_;
+  unsigned* sqHead_;
+  unsigned* sqTail_;
+  unsigned sqMask_;
+  unsigned sqEntries_;
+  unsigned* cqHead_;
+  unsigned* cqTail_;
+  unsigned cqMask_;
+  io_uring_cqe* cqes_;
+};
+
+#endif // THRIFT_URING_SERVER_IO_URING
+#endif // THRIFT_URING_SERVER_SUPPORTED
+
+TUringServer::TUringServer(const shared_ptr<TProcessorFactory>& processorFactory,
+                           const shared_ptr<TServerSocket>& serverSocket,
+                           const shared_ptr<TProtocolFactory>& protocolFactory,
+                           const shared_ptr<ThreadManager>& threadManager)
+  : TServer(processorFactory,
+            serverSocket,
+            shared_ptr<TTransportFactory>(new TTransportFactory()),
+            protocolFactory),
+    serverSocket_(serverSocket),
+    threadManager_(threadManager),
+    backend_(BACKEND_AUTO),
+    activeBackend_(BACKEND_AUTO),
+    ringEntries_(256),
+    readBufferSize_(16384),
+    registeredBuffers_(64),
+    maxFrameSize_(256 * 1024 * 1024),
+    poller_(NULL),
+    processing_(0),
+    registered_(NULL),
+    wakeFd_(-1),
+    stop_(false),
+    numConnections_(0) {
+  init();
+}
+
+TUringServer::TUringServer(const shared_ptr<TProcessor>& processor,
+                           const shared_ptr<TServerSocket>& serverSocket,
+                           const shared_ptr<TProtocolFactory>& protocolFactory,
+                           const shared_ptr<ThreadManager>& threadManager)
+  : TServer(processor,
+            serverSocket,
+            shared_ptr<TTransportFactory>(new TTransportFactory()),
+            protocolFactory),
+    serverSocket_(serverSocket),
+    threadManager_(threadManager),
+    backend_(BACKEND_AUTO),
+    activeBackend_(BACKEND_AUTO),
+    ringEntries_(256),
+    readBufferSize_(16384),
+    registeredBuffers_(64),
+    maxFrameSize_(256 * 1024 * 1024),
+    poller_(NULL),
+    processing_(0),
+    registered_(NULL),
+    wakeFd_(-1),
+    stop_(false),
+    numConnections_(0) {
+  init();
+}
+
+TUringServer::~TUringServer() {
+#ifdef THRIFT_URING_SERVER_SUPPORTED
+  if (wakeFd_ >= 0) {
+    ::close(wakeFd_);
+  }
+#endif
+}
+
+void TUringServer::init() {
+#ifdef THRIFT_URING_SERVER_SUPPORTED
+  wakeFd_ = ::eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+  if (wakeFd_ < 0) {
+    int errno_copy = errno;
+    throw TTransportException(TTransportException::INTERNAL_ERROR,
+                              "TUringServer: eventfd() failed",
+                              errno_copy);
+  }
+#endif
+}
+
+void TUringServer::stop() {
+  stop_ = true;
+#ifdef THRIFT_URING_SERVER_SUPPORTED
+  uint64_t one = 1;
+  if (::write(wakeFd_, &one, sizeof(one)) < 0) {
+    GlobalOutput.perror("TUringServer::stop() eventfd write() ", errno);
+  }
+#endif
+}
+
+#ifndef THRIFT_URING_SERVER_SUPPORTED
+
+void TUringServer::serve() {
+  throw TException("TUringServer: this platform has neither epoll nor io_uring");
+}
+
+#else
+
+TUringServer::Poller* TUringServer::createPoller() {
+#ifdef THRIFT_URING_SERVER_IO_URING
+  if (backend_ != BACKEND_EPOLL) {
+    try {
+      Poller* poller = new UringPoller(wakeFd_, ringEntries_);
+      activeBackend_ = BACKEND_IO_URING;
+      return poller;
+    } catch (const TTransportException& tte) {
+      if (backend_ == BACKEND_IO_URING) {
+        throw;
+      }
+      GlobalOutput.printf("TUringServer: falling back to epoll: %s", tte.what());
+    }
+  }
+#else
+  if (backend_ == BACKEND_IO_URING) {
+    throw TTransportException(TTransportException::INTERNAL_ERROR,
+                              "TUringServer: built without io_uring");
+  }
+#endif
+  Poller* poller = new EpollPoller(wakeFd_);
+  activeBackend_ = BACKEND_EPOLL;
+  return poller;
+}
+
+void TUringServer::serve() {
+  serverSocket_->listen();
+  int listenFd = static_cast<int>(serverSocket_->getSocketFD());
+  if (setNonBlocking(listenFd) < 0) {
+    int errno_copy = errno;
+    serverSocket_->close();
+    throw TTransportException(TTransportException::NOT_OPEN,
+                              "TUringServer: fcntl() O_NONBLOCK failed",
+                              errno_copy);
+  }
+
+  try {
+    poller_ = createPoller();
+  } catch (...) {
+    serverSocket_->close();
+    throw;
+  }
+
+  if (registeredBuffers_ > 0) {
+    registered_ = static_cast<uint8_t*>(
+        std::malloc(static_cast<size_t>(registeredBuffers_) * readBufferSize_));
+    if (registered_ == NULL) {
+      throw std::bad_alloc();
+    }
+    poller_->registerBuffers(registered_, readBufferSize_, registeredBuffers_);
+    for (int i = registeredBuffers_ - 1; i >= 0; --i) {
+      freeRegistered_.push_back(i);
+    }
+  }
+
+  poller_->startAccepting(listenFd);
+
+  if (eventHandler_) {
+    eventHandler_->preServe();
+  }
+
+  std::vector<Event> events;
+  bool accepting = true;
+  while (true) {
+    if (stop_ && accepting) {
+      accepting = false;
+      poller_->stopAccepting();
+      // Idle connections are shut down so their receives complete; the
+      // others are closed once their reply is out.
+      for (std::set<Connection*>::iterator it = connections_.begin(); it != connections_.end();
+           ++it) {
+        if ((*it)->state == Connection::READING) {
+          ::shutdown((*it)->fd, SHUT_RDWR);
+        }
+      }
+    }
+    if (!accepting && connections_.empty() && processing_ == 0 && poller_->idle()) {
+      break;
+    }
+
+    poller_->wait(events);
+    for (size_t i = 0; i < events.size(); ++i) {
+      const Event& event = events[i];
+      switch (event.type) {
+      case Event::ACCEPTED:
+        if (accepting) {
+          onAccept(event.result);
+        } else if (event.result >= 0) {
+          ::close(event.result);
+        }
+        break;
+      case Event::IO:
+        if (event.connection->state == Connection::SENDING) {
+          onSend(event.connection, event.result);
+        } else {
+          onRecv(event.connection, event.result);
+        }
+        break;
+      case Event::WAKE:
+        drainProcessed();
+        break;
+      }
+    }
+  }
+
+  delete poller_;
+  poller_ = NULL;
+  std::free(registered_);
+  registered_ = NULL;
+  freeRegistered_.clear();
+  serverSocket_->close();
+}
+
+void TUringServer::onAccept(int result) {
+  if (result < 0) {
+    GlobalOutput.perror("TUringServer: accept() ", -result);
+    return;
+  }
+
+  int fd = result;
+  int one = 1;
+  ::setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+
+  uint8_t* zone;
+  int zoneIndex = -1;
+  if (!freeRegistered_.empty()) {
+    zoneIndex = freeRegistered_.back();
+    freeRegistered_.pop_back();
+    zone = registered_ + static_cast<size_t>(zoneIndex) * readBufferSize_;
+  } else {
+    zone = static_cast<uint8_t*>(std::malloc(readBufferSize_));
+    if (zone == NULL) {
+      ::close(fd);
+      throw std::bad_alloc();
+    }
+  }
+
+  Connection* connection = new Connection(fd, zone, zoneIndex);
+  connections_.insert(connection);
+  ++numConnections_;
+  connection->inputProtocol = inputProtocolFactory_->getProtocol(connection->in);
+  connection->outputProtocol = outputProtocolFactory_->getProtocol(connection->out);
+  connection->processor
+      = getProcessor(connection->inputProtocol, connection->outputProtocol, connection->socket);
+  if (eventHandler_) {
+    connection->context
+        = eventHandler_->createContext(connection->inputProtocol, connection->outputProtocol);
+  }
+
+  if (!poller_->add(connection)) {
+    closeConnection(connection);
+    return;
+  }
+  startRead(connection);
+}
+
+void TUringServer::startRead(Connection* c) {
+  c->state = Connection::READING;
+  uint32_t avail = c->zoneEnd - c->zoneStart;
+  if (avail >= 4) {
+    uint32_t size;
+    std::memcpy(&size, c->zone + c->zoneStart, sizeof(size));
+    size = ntohl(size);
+    if (size == 0 || size > maxFrameSize_) {
+      GlobalOutput.printf("TUringServer: closing a connection that sent a frame of %u bytes",
+                          size);
+      closeConnection(c);
+      return;
+    }
+    if (avail - 4 >= size) {
+      dispatch(c, c->zone + c->zoneStart + 4, size);
+      return;
+    }
+    if (size > readBufferSize_ - 4) {
+      // The request will not fit: read the rest of it into a buffer of its own.
+      c->big = true;
+      c->bigRequest.resize(size);
+      c->bigHave = avail - 4;
+      std::memcpy(&c->bigRequest[0], c->zone + c->zoneStart + 4, c->bigHave);
+      c->zoneStart = c->zoneEnd = 0;
+      poller_->recv(c, &c->bigRequest[c->bigHave], size - c->bigHave, -1);
+      return;
+    }
+  }
+
+  if (c->zoneStart > 0) {
+    std::memmove(c->zone, c->zone + c->zoneStart, avail);
+    c->zoneStart = 0;
+    c->zoneEnd = avail;
+  }
+  poller_->recv(c, c->zone + c->zoneEnd, readBufferSize_ - c->zoneEnd, c->zoneIndex);
+}
+
+void TUringServer::onRecv(Connection* c, int result) {
+  if (result <= 0 || stop_) {
+    if (result < 0 && result != -ECONNRESET) {
+      GlobalOutput.perror("TUringServer: recv() ", -result);
+    }
+    closeConnection(c);
+    return;
+  }
+
+  if (c->big) {
+    c->bigHave += static_cast<uint32_t>(result);
+    if (c->bigHave < c->bigRequest.size()) {
+      poller_->recv(c,
+                    &c->bigRequest[c->bigHave],
+                    static_cast<uint32_t>(c->bigRequest.size()) - c->bigHave,
+                    -1);
+    } else {
+      dispatch(c, &c->bigRequest[0], static_cast<uint32_t>(c->bigRequest.size()));
+    }
+    return;
+  }
+
+  c->zoneEnd += static_cast<uint32_t>(result);
+  startRead(c);
+}
+
+void TUringServer::dispatch(Connection* c, const uint8_t* request, uint32_t len) {
+  c->state = Connection::PROCESSING;
+  c->requestLen = len;
+  c->in->resetBuffer(const_cast<uint8_t*>(request), len, TMemoryBuffer::OBSERVE);
+  c->out->resetBuffer();
+  // Room for the frame size, filled in once the reply is written
+  uint8_t placeholder[4] = {0, 0, 0, 0};
+  c->out->write(placeholder, sizeof(placeholder));
+
+  ++processing_;
+  if (!threadManager_) {
+    process(c);
+    onProcessed(c);
+    return;
+  }
+
+  try {
+    threadManager_->add(shared_ptr<Runnable>(new Task(this, c)));
+  } catch (const TException& x) {
+    GlobalOutput.printf("TUringServer: dropping a request: %s", x.what());
+    --processing_;
+    closeConnection(c);
+  }
+}
+
+void TUringServer::process(Connection* c) {
+  try {
+    if (eventHandler_) {
+      eventHandler_->processContext(c->context, c->socket);
+    }
+    {
+      TRequestArenaScope scope(&c->arena);
+      c->keepOpen = c->processor->process(c->inputProtocol, c->outputProtocol, c->context);
+    }
+    c->arena.reset();
+  } catch (const TTransportException& ttx) {
+    GlobalOutput.printf("TUringServer: client died: %s", ttx.what());
+    c->keepOpen = false;
+  } catch (const std::bad_alloc&) {
+    GlobalOutput("TUringServer: caught bad_alloc exception.");
+    exit(1);
+  } catch (const std::exception& x) {
+    GlobalOutput.printf("TUringServer: process() exception: %s: %s", typeid(x).name(), x.what());
+    c->keepOpen = false;
+  } catch (...) {
+    GlobalOutput.printf("TUringServer: unknown exception while processing.");
+    c->keepOpen = false;
+  }
+}
+
+void TUringServer::notifyProcessed(Connection* c) {
+  bool wake;
+  {
+    Guard g(processedMutex_);
+    wake = processed_.empty();
+    processed_.push_back(c);
+  }
+  if (wake) {
+    uint64_t one = 1;
+    if (::write(wakeFd_, &one, sizeof(one)) < 0) {
+      GlobalOutput.perror("TUringServer: eventfd write() ", errno);
+    }
+  }
+}
+
+void TUringServer::drainProcessed() {
+  std::vector<Connection*> processed;
+  {
+    Guard g(processedMutex_);
+    processed.swap(processed_);
+  }
+  for (size_t i = 0; i < processed.size(); ++i) {
+    onProcessed(processed[i]);
+  }
+}
+
+void TUringServer::onProcessed(Connection* c) {
+  --processing_;
+  if (c->big) {
+    c->big = false;
+    std::vector<uint8_t>().swap(c->bigRequest);
+  } else {
+    c->zoneStart += 4 + c->requestLen;
+  }
+  if (!c->keepOpen || stop_) {
+    closeConnection(c);
+    return;
+  }
+
+  uint8_t* reply;
+  uint32_t len;
+  c->out->getBuffer(&reply, &len);
+  if (len <= 4) {
+    // oneway
+    startRead(c);
+    return;
+  }
+  uint32_t frameSize = htonl(len - 4);
+  std::memcpy(reply, &frameSize, sizeof(frameSize));
+  c->state = Connection::SENDING;
+  c->sent = 0;
+  poller_->send(c, reply, len);
+}
+
+void TUringServer::onSend(Connection* c, int result) {
+  if (result < 0) {
+    if (result != -EPIPE && result != -ECONNRESET) {
+      GlobalOutput.perror("TUringServer: send() ", -result);
+    }
+    closeConnection(c);
+    return;
+  }
+
+  uint8_t* reply;
+  uint32_t len;
+  c->out->getBuffer(&reply, &len);
+  c->sent += static_cast<uint32_t>(result);
+  if (c->sent < len) {
+    poller_->send(c, reply + c->sent, len - c->sent);
+    return;
+  }
+  if (stop_) {
+    closeConnection(c);
+    return;
+  }
+  startRead(c);
+}
+
+void TUringServer::closeConnection(Connection* c) {
+  poller_->remove(c);
+  if (eventHandler_) {
+    eventHandler_->deleteContext(c->context, c->inputProtocol, c->outputProtocol);
+  }
+  c->socket->close();
+  if (c->zoneIndex >= 0) {
+    freeRegistered_.push_back(c->zoneIndex);
+  } else {
+    std::free(c->zone);
+  }
+  connections_.erase(c);
+  --numConnections_;
+  delete c;
+}
+
+#endif // THRIFT_URING_SERVER_SUPPORTED
+}
+}
+} // apache::thrift::server
@@ -0,0 +1,186 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _THRIFT_SERVER_TURINGSERVER_H_
+#define _THRIFT_SERVER_TURINGSERVER_H_ 1
+
+#include <set>
+#include <vector>
+
+#include <boost/atomic.hpp>
+
+#include <thrift/concurrency/Mutex.h>
+#include <thrift/concurrency/ThreadManager.h>
+#include <thrift/server/TServer.h>
+#include <thrift/stdcxx.h>
+#include <thrift/transport/TServerSocket.h>
+
+namespace apache {
+namespace thrift {
+namespace server {
+
+using apache::thrift::concurrency::ThreadManager;
+using apache::thrift::transport::TServerSocket;
+
+/**
+ * A server for framed clients that, unlike TThreadedServer and
+ * TThreadPoolServer, does not need a thread per connection: one I/O thread
+ * reads requests from all connections, and hands them to a ThreadManager,
+ * or processes them itself if there is none.  Long-lived connections that
+ * are idle most of the time cost a buffer each, not a thread.
+ *
+ * On Linux the I/O thread drives an io_uring: the receives, sends and
+ * accepts it starts while handling a batch of completions are submitted
+ * together with a single system call, which also waits for the next batch.
+ * Requests are read into buffers registered with the ring, so the kernel
+ * does not map them for every read.  Where io_uring is missing or not
+ * permitted, the server falls back to epoll and non-blocking sockets.
+ *
+ * Like TNonblockingServer, clients must use TFramedTransport; the transport
+ * factories of TServer are not used.  A connection has one request in
+ * process at a time; requests a client sends ahead are kept until the
+ * previous reply is sent.
+ */
+class TUringServer : public TServer {
+public:
+  enum Backend { BACKEND_AUTO, BACKEND_IO_URING, BACKEND_EPOLL };
+
+  TUringServer(const stdcxx::shared_ptr<TProcessorFactory>& processorFactory,
+               const stdcxx::shared_ptr<TServerSocket>& serverSocket,
+               const stdcxx::shared_ptr<TProtocolFactory>& protocolFactory
+               = stdcxx::shared_ptr<TProtocolFactory>(new TBinaryProtocolFactory()),
+               const stdcxx::shared_ptr<ThreadManager>& threadManager
+               = stdcxx::shared_ptr<ThreadManager>());
+
+  TUringServer(const stdcxx::shared_ptr<TProcessor>& processor,
+               const stdcxx::shared_ptr<TServerSocket>& serverSocket,
+               const stdcxx::shared_ptr<TProtocolFactory>& protocolFactory
+               = stdcxx::shared_ptr<TProtocolFactory>(new TBinaryProtocolFactory()),
+               const stdcxx::shared_ptr<ThreadManager>& threadManager
+               = stdcxx::shared_ptr<ThreadManager>());
+
+  virtual ~TUringServer();
+
+  /**
+   * Selects how the I/O thread waits for sockets.  BACKEND_AUTO, the
+   * default, takes io_uring when the kernel allows it and epoll otherwise;
+   * BACKEND_IO_URING fails to serve without io_uring.
+   */
+  void setBackend(Backend backend) { backend_ = backend; }
+
+  /// The backend serve() settled on; BACKEND_AUTO before it did.
+  Backend getActiveBackend() const { return activeBackend_; }
+
+  /// Submission queue entries of the ring; 256 by default.
+  void setRingEntries(unsigned entries) { ringEntries_ = entries; }
+
+  /**
+   * Bytes read from a connection at a time.  Every connection has a buffer
+   * this size; longer requests are read into a buffer of their own.
+   * 16 KB by default.
+   */
+  void setReadBufferSize(uint32_t size) { readBufferSize_ = size; }
+
+  /**
+   * Read buffers registered with the ring, for as many connections; other
+   * connections read into ordinary buffers.  64 by default, 0 registers
+   * none.  Registered buffers are locked in memory, and count against
+   * RLIMIT_MEMLOCK; the server does without if the kernel refuses them.
+   */
+  void setRegisteredBuffers(int count) { registeredBuffers_ = count; }
+
+  /// Longest request accepted, in bytes; 256 MB by default.
+  void setMaxFrameSize(uint32_t size) { maxFrameSize_ = size; }
+
+  stdcxx::shared_ptr<ThreadManager> getThreadManager() { return threadManager_; }
+
+  /// Open client connections
+  int getNumConnections() const { return numConnections_; }
+
+  /**
+   * Listens, and serves until stop() is called.  Throws a
+   * TTransportException if it cannot listen, and a TException on platforms
+   * without epoll or io_uring.
+   */
+  void serve();
+
+  /**
+   * Stops accepting, closes connections once the request they are
+   * processing is answered, and makes serve() return.  Can be called from
+   * any thread, also before serve(), which then returns right away.
+   */
+  void stop();
+
+private:
+  class Connection;
+  class Task;
+  class Poller;
+  class UringPoller;
+  class EpollPoller;
+  struct Event;
+
+  void onAccept(int result);
+  void onRecv(Connection* connection, int result);
+  void onSend(Connection* connection, int result);
+  void startRead(Connection* connection);
+  void dispatch(Connection* connection, const uint8_t* request, uint32_t len);
+  void process(Connection* connection);
+  void onProcessed(Connection* connection);
+  void closeConnection(Connection* connection);
+  void drainProcessed();
+
+  /// Called by the tasks to hand a processed connection back to the I/O thread.
+  void notifyProcessed(Connection* connection);
+
+  void init();
+  Poller* createPoller();
+
+  stdcxx::shared_ptr<TServerSocket> serverSocket_;
+  stdcxx::shared_ptr<ThreadManager> threadManager_;
+
+  Backend backend_;
+  Backend activeBackend_;
+  unsigned ringEntries_;
+  uint32_t readBufferSize_;
+  int registeredBuffers_;
+  uint32_t maxFrameSize_;
+
+  /// Everything below belongs to the I/O thread while serving, except where noted.
+  Poller* poller_;
+  std::set<Connection*> connections_;
+  int processing_;
+
+  /// Read buffers of registeredBuffers_ connections, in one block
+  uint8_t* registered_;
+  std::vector<int> freeRegistered_;
+
+  /// Written by the tasks and stop() to wake up the I/O thread
+  int wakeFd_;
+  boost::atomic<bool> stop_;
+  boost::atomic<int> numConnections_;
+
+  /// Connections whose tasks are done; guarded by processedMutex_
+  concurrency::Mutex processedMutex_;
+  std::vector<Connection*> processed_;
+};
+}
+}
+} // apache::thrift::server
+
+#endif // #ifndef _THRIFT_SERVER_TURINGSERVER_H_
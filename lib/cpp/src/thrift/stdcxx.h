@@ -97,6 +97,7 @@ namespace apache { namespace thrift { namespace stdcxx {
 
 #if defined(BOOST_NO_CXX11_SMART_PTR) || (defined(_MSC_VER) && _MSC_VER < 1800) || defined(FORCE_BOOST_SMART_PTR)
 
+  using ::boost::allocate_shared;
   using ::boost::const_pointer_cast;
   using ::boost::dynamic_pointer_cast;
   using ::boost::enable_shared_from_this;
@@ -108,6 +109,7 @@ namespace apache { namespace thrift { namespace stdcxx {
 
 #else
 
+  using ::std::allocate_shared;
   using ::std::const_pointer_cast;
   using ::std::dynamic_pointer_cast;
   using ::std::enable_shared_from_this;
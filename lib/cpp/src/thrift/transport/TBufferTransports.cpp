@@ -83,15 +83,17 @@ void TBufferedTransport::writeSlow(const uint8_t* buf, uint32_t len) {
   // policy would require predicting the size of future writes, so we're just
   // going to always eschew syscalls if we have less than 2N bytes to write.
 
-  // The case where we have to do two syscalls.
+  // The case where we have to do two syscalls, or one writeSegments() call
+  // on transports that support it.
   // This case also covers the case where the buffer is empty,
   // but it is clearer (I think) to think of it as two separate cases.
   if ((have_bytes + len >= 2 * wBufSize_) || (have_bytes == 0)) {
-    // TODO(dreiss): writev
     if (have_bytes > 0) {
-      transport_->write(wBuf_.get(), have_bytes);
+      TWriteSegment segs[2] = {{wBuf_.get(), have_bytes}, {buf, len}};
+      transport_->writeSegments(segs, 2);
+    } else {
+      transport_->write(buf, len);
     }
-    transport_->write(buf, len);
     wBase_ = wBuf_.get();
     return;
   }
@@ -205,10 +207,11 @@ bool TFramedTransport::readFrame() {
   if (sz > static_cast<int32_t>(maxFrameSize_))
     throw TTransportException(TTransportException::CORRUPTED_DATA, "Received an oversized frame");
 
-  // Read the frame payload, and reset markers.
-  if (sz > static_cast<int32_t>(rBufSize_)) {
-    rBuf_.reset(new uint8_t[sz]);
-    rBufSize_ = sz;
+  // Read the frame payload, and reset markers.  A frame that has been lent
+  // out through borrowShared() must not be overwritten.
+  if (releaseFrame() || sz > static_cast<int32_t>(rBufSize_)) {
+    rBufSize_ = (std::max)(static_cast<uint32_t>(sz), rBufSize_);
+    rBuf_.reset(new uint8_t[rBufSize_]);
   }
   transport_->readAll(rBuf_.get(), sz);
   setReadBuffer(rBuf_.get(), sz);
@@ -219,7 +222,8 @@ void TFramedTransport::writeSlow(const uint8_t* buf, uint32_t len) {
   // Double buffer size until sufficient.
   uint32_t have = static_cast<uint32_t>(wBase_ - wBuf_.get());
   uint32_t new_size = wBufSize_;
-  if (len + have < have /* overflow */ || len + have > 0x7fffffff) {
+  if (len + have < have /* overflow */
+      || static_cast<uint64_t>(len) + have + wRefBytes_ > 0x7fffffff) {
     throw TTransportException(TTransportException::BAD_ARGS,
                               "Attempted to write over 2 GB to TFramedTransport.");
   }
@@ -251,10 +255,15 @@ void TFramedTransport::flush() {
   int32_t sz_hbo, sz_nbo;
   assert(wBufSize_ > sizeof(sz_nbo));
 
-  // Slip the frame size into the start of the buffer.
-  sz_hbo = static_cast<uint32_t>(wBase_ - (wBuf_.get() + sizeof(sz_nbo)));
-  sz_nbo = (int32_t)htonl((uint32_t)(sz_hbo));
-  memcpy(wBuf_.get(), (uint8_t*)&sz_nbo, sizeof(sz_nbo));
+  // Slip the frame size into the start of the buffer, unless beginFrame()
+  // already did.
+  uint32_t have = static_cast<uint32_t>(wBase_ - wBuf_.get());
+  sz_hbo = static_cast<int32_t>(have - sizeof(sz_nbo) + wRefBytes_);
+  if (sz_hbo != wFrameSize_) {
+    sz_nbo = (int32_t)htonl((uint32_t)(sz_hbo));
+    memcpy(wBuf_.get(), (uint8_t*)&sz_nbo, sizeof(sz_nbo));
+  }
+  wFrameSize_ = -1;
 
   if (sz_hbo > 0) {
     // Note that we reset wBase_ (with a pad for the frame size)
@@ -264,7 +273,11 @@ void TFramedTransport::flush() {
     wBase_ = wBuf_.get() + sizeof(sz_nbo);
 
     // Write size and frame body.
-    transport_->write(wBuf_.get(), static_cast<uint32_t>(sizeof(sz_nbo)) + sz_hbo);
+    if (wRefs_.empty()) {
+      transport_->write(wBuf_.get(), have);
+    } else {
+      flushRefs(have);
+    }
   }
 
   // Flush the underlying transport.
@@ -282,8 +295,67 @@ void TFramedTransport::flush() {
   }
 }
 
+void TFramedTransport::beginFrame(uint32_t size) {
+  if (wBase_ != wBuf_.get() + sizeof(uint32_t) || wRefBytes_ != 0) {
+    throw TTransportException(TTransportException::BAD_ARGS,
+                              "beginFrame() after the frame was written to");
+  }
+  if (size > 0x7fffffff - sizeof(uint32_t)) {
+    throw TTransportException(TTransportException::BAD_ARGS,
+                              "Attempted to write over 2 GB to TFramedTransport.");
+  }
+
+  uint32_t need = size + sizeof(uint32_t);
+  if (need > wBufSize_) {
+    wBuf_.reset(new uint8_t[need]);
+    wBufSize_ = need;
+    setWriteBuffer(wBuf_.get(), wBufSize_);
+    wBase_ = wBuf_.get() + sizeof(uint32_t);
+  }
+
+  int32_t sz_nbo = (int32_t)htonl(size);
+  memcpy(wBuf_.get(), (uint8_t*)&sz_nbo, sizeof(sz_nbo));
+  wFrameSize_ = static_cast<int32_t>(size);
+}
+
+void TFramedTransport::writeRefSlow(const uint8_t* buf, uint32_t len) {
+  uint32_t have = static_cast<uint32_t>(wBase_ - wBuf_.get());
+  if (static_cast<uint64_t>(len) + have + wRefBytes_ > 0x7fffffff) {
+    throw TTransportException(TTransportException::BAD_ARGS,
+                              "Attempted to write over 2 GB to TFramedTransport.");
+  }
+  WriteRef ref = {have, buf, len};
+  wRefs_.push_back(ref);
+  wRefBytes_ += len;
+}
+
+void TFramedTransport::flushRefs(uint32_t have) {
+  // Interleave the buffered bytes with the referenced buffers in the order
+  // they were written.  The first segment always carries the frame size.
+  wSegs_.clear();
+  uint32_t pos = 0;
+  for (std::vector<WriteRef>::const_iterator it = wRefs_.begin(); it != wRefs_.end(); ++it) {
+    if (it->offset > pos) {
+      TWriteSegment body = {wBuf_.get() + pos, it->offset - pos};
+      wSegs_.push_back(body);
+      pos = it->offset;
+    }
+    TWriteSegment ref = {it->data, it->len};
+    wSegs_.push_back(ref);
+  }
+  if (have > pos) {
+    TWriteSegment tail = {wBuf_.get() + pos, have - pos};
+    wSegs_.push_back(tail);
+  }
+
+  // As with wBase_, forget the references before the write can throw.
+  wRefs_.clear();
+  wRefBytes_ = 0;
+  transport_->writeSegments(&wSegs_[0], static_cast<uint32_t>(wSegs_.size()));
+}
+
 uint32_t TFramedTransport::writeEnd() {
-  return static_cast<uint32_t>(wBase_ - wBuf_.get());
+  return static_cast<uint32_t>(wBase_ - wBuf_.get()) + wRefBytes_;
 }
 
 const uint8_t* TFramedTransport::borrowSlow(uint8_t* buf, uint32_t* len) {
@@ -295,12 +367,38 @@ const uint8_t* TFramedTransport::borrowSlow(uint8_t* buf, uint32_t* len) {
   return NULL;
 }
 
+namespace {
+// Deleter that pins a frame buffer for as long as a borrowed handle exists.
+struct FrameHolder {
+  explicit FrameHolder(const boost::shared_array<uint8_t>& frame) : frame_(frame) {}
+  void operator()(void*) { frame_.reset(); }
+  boost::shared_array<uint8_t> frame_;
+};
+}
+
+const uint8_t* TFramedTransport::borrowShared(uint32_t* len, stdcxx::shared_ptr<void>& owner) {
+  // Subclasses may point the read window elsewhere; only the frame can be lent.
+  if (!rBuf_ || rBase_ < rBuf_.get() || rBound_ > rBuf_.get() + rBufSize_) {
+    return NULL;
+  }
+  const uint8_t* buf = borrow(NULL, len);
+  if (buf != NULL) {
+    // Every string read out of this frame shares one handle.
+    if (!rBufOwner_ || rBufOwner_.get() != rBuf_.get()) {
+      rBufOwner_ = stdcxx::shared_ptr<void>(rBuf_.get(), FrameHolder(rBuf_));
+    }
+    owner = rBufOwner_;
+  }
+  return buf;
+}
+
 uint32_t TFramedTransport::readEnd() {
   // include framing bytes
   uint32_t bytes_read = static_cast<uint32_t>(rBound_ - rBuf_.get() + sizeof(uint32_t));
 
   if (rBufSize_ > bufReclaimThresh_) {
     rBufSize_ = 0;
+    rBufOwner_.reset();
     rBuf_.reset();
     setReadBuffer(rBuf_.get(), rBufSize_);
   }
@@ -371,6 +469,33 @@ void TMemoryBuffer::ensureCanWrite(uint32_t len) {
     avail = available_write() + (new_size - bufferSize_);
   }
 
+  growBuffer(new_size);
+}
+
+void TMemoryBuffer::reserve(uint32_t len) {
+  uint32_t avail = available_write();
+  if (len <= avail) {
+    return;
+  }
+
+  if (!owner_) {
+    throw TTransportException("Insufficient space in external MemoryBuffer");
+  }
+
+  uint64_t new_size = static_cast<uint64_t>(bufferSize_) + (len - avail);
+  if (new_size > maxBufferSize_) {
+    throw TTransportException(TTransportException::BAD_ARGS, "Internal buffer size overflow");
+  }
+  growBuffer(new_size);
+}
+
+void TMemoryBuffer::growBuffer(uint64_t new_size) {
+  if (sharedBuffer_) {
+    // Borrowers may still be looking at the old buffer; leave it in place.
+    unshareBuffer(true, static_cast<uint32_t>(new_size));
+    return;
+  }
+
   // Allocate into a new pointer so we don't bork ours if it fails.
   uint8_t* new_buffer = static_cast<uint8_t*>(std::realloc(buffer_, new_size));
   if (new_buffer == NULL) {
@@ -385,6 +510,26 @@ void TMemoryBuffer::ensureCanWrite(uint32_t len) {
   bufferSize_ = new_size;
 }
 
+void TMemoryBuffer::unshareBuffer(bool preserve, uint32_t newSize) {
+  newSize = (std::max)(newSize, bufferSize_);
+  uint8_t* new_buffer = static_cast<uint8_t*>(std::malloc(newSize));
+  if (new_buffer == NULL && newSize != 0) {
+    throw std::bad_alloc();
+  }
+
+  if (preserve) {
+    memcpy(new_buffer, buffer_, wBase_ - buffer_);
+  }
+
+  rBase_ = new_buffer + (rBase_ - buffer_);
+  rBound_ = new_buffer + (rBound_ - buffer_);
+  wBase_ = new_buffer + (wBase_ - buffer_);
+  wBound_ = new_buffer + newSize;
+  buffer_ = new_buffer;
+  bufferSize_ = newSize;
+  sharedBuffer_.reset();
+}
+
 void TMemoryBuffer::writeSlow(const uint8_t* buf, uint32_t len) {
   ensureCanWrite(len);
 
@@ -410,6 +555,20 @@ const uint8_t* TMemoryBuffer::borrowSlow(uint8_t* buf, uint32_t* len) {
   }
   return NULL;
 }
+
+const uint8_t* TMemoryBuffer::borrowShared(uint32_t* len, stdcxx::shared_ptr<void>& owner) {
+  if (!owner_) {
+    return NULL;
+  }
+  const uint8_t* buf = borrow(NULL, len);
+  if (buf != NULL) {
+    if (!sharedBuffer_) {
+      sharedBuffer_.reset(buffer_, std::free);
+    }
+    owner = sharedBuffer_;
+  }
+  return buf;
+}
 }
 }
 } // apache::thrift::transport
@@ -23,7 +23,9 @@
 #include <cstdlib>
 #include <cstring>
 #include <limits>
+#include <vector>
 #include <boost/scoped_array.hpp>
+#include <boost/shared_array.hpp>
 
 #include <thrift/transport/TTransport.h>
 #include <thrift/transport/TVirtualTransport.h>
@@ -103,6 +105,21 @@ public:
     writeSlow(buf, len);
   }
 
+  /**
+   * Fast-path writeRef.
+   *
+   * Buffers shorter than the subclass's threshold are copied exactly like
+   * write(); only larger ones go to the slow path, which may keep a
+   * reference instead.
+   */
+  void writeRef(const uint8_t* buf, uint32_t len) {
+    if (TDB_LIKELY(len < wRefMin_)) {
+      write(buf, len);
+      return;
+    }
+    writeRefSlow(buf, len);
+  }
+
   /**
    * Fast-path borrow.  A lot like the fast-path read.
    */
@@ -134,6 +151,9 @@ protected:
   /// Slow path write.
   virtual void writeSlow(const uint8_t* buf, uint32_t len) = 0;
 
+  /// Slow path writeRef.  By default the data is copied after all.
+  virtual void writeRefSlow(const uint8_t* buf, uint32_t len) { write(buf, len); }
+
   /**
    * Slow path borrow.
    *
@@ -148,7 +168,12 @@ protected:
    * performance-sensitive operation, so it is okay to just leave it to
    * the concrete class to set up pointers correctly.
    */
-  TBufferBase() : rBase_(NULL), rBound_(NULL), wBase_(NULL), wBound_(NULL) {}
+  TBufferBase()
+    : rBase_(NULL),
+      rBound_(NULL),
+      wBase_(NULL),
+      wBound_(NULL),
+      wRefMin_((std::numeric_limits<uint32_t>::max)()) {}
 
   /// Convenience mutator for setting the read buffer.
   void setReadBuffer(uint8_t* buf, uint32_t len) {
@@ -173,6 +198,9 @@ protected:
   uint8_t* wBase_;
   /// Writes may extend to just before here.
   uint8_t* wBound_;
+
+  /// writeRef() calls of at least this many bytes take the slow path.
+  uint32_t wRefMin_;
 };
 
 /**
@@ -315,7 +343,9 @@ public:
       wBufSize_(DEFAULT_BUFFER_SIZE),
       rBuf_(),
       wBuf_(new uint8_t[wBufSize_]),
-      bufReclaimThresh_((std::numeric_limits<uint32_t>::max)()) {
+      bufReclaimThresh_((std::numeric_limits<uint32_t>::max)()),
+      wFrameSize_(-1),
+      wRefBytes_(0) {
     initPointers();
   }
 
@@ -326,7 +356,9 @@ public:
       rBuf_(),
       wBuf_(new uint8_t[wBufSize_]),
       bufReclaimThresh_((std::numeric_limits<uint32_t>::max)()),
-      maxFrameSize_(DEFAULT_MAX_FRAME_SIZE) {
+      maxFrameSize_(DEFAULT_MAX_FRAME_SIZE),
+      wFrameSize_(-1),
+      wRefBytes_(0) {
     initPointers();
   }
 
@@ -339,7 +371,9 @@ public:
       rBuf_(),
       wBuf_(new uint8_t[wBufSize_]),
       bufReclaimThresh_(bufReclaimThresh),
-      maxFrameSize_(DEFAULT_MAX_FRAME_SIZE) {
+      maxFrameSize_(DEFAULT_MAX_FRAME_SIZE),
+      wFrameSize_(-1),
+      wRefBytes_(0) {
     initPointers();
   }
 
@@ -360,12 +394,27 @@ public:
 
   virtual void flush();
 
+  /**
+   * Starts a frame whose body will be size bytes long, as counted by
+   * serializedSize() for instance.  The write buffer is grown once to hold
+   * all of it and the frame header is written now, so flush() sends the
+   * frame as it is.  It only fills in the header again if a different
+   * number of bytes was written.  Must come before the frame's first write.
+   */
+  virtual void beginFrame(uint32_t size);
+
   uint32_t readEnd();
 
   uint32_t writeEnd();
 
   const uint8_t* borrowSlow(uint8_t* buf, uint32_t* len);
 
+  /**
+   * Lends out the current frame.  While any handle is alive the next frame
+   * is read into a freshly allocated buffer.
+   */
+  virtual const uint8_t* borrowShared(uint32_t* len, stdcxx::shared_ptr<void>& owner);
+
   stdcxx::shared_ptr<TTransport> getUnderlyingTransport() { return transport_; }
 
   /*
@@ -389,6 +438,17 @@ public:
    */
   uint32_t getMaxFrameSize() { return maxFrameSize_; }
 
+  /**
+   * Lets writeRef() keep a reference to buffers of at least minBytes rather
+   * than copying them into the frame.  flush() then sends the frame header,
+   * the buffered bytes and the referenced buffers in one writeSegments()
+   * call.  Only enable this when every writer keeps such buffers alive until
+   * flush(), as generated code does.  0 (the default) always copies.
+   */
+  void setWriteRefThreshold(uint32_t minBytes) {
+    wRefMin_ = minBytes > 0 ? minBytes : (std::numeric_limits<uint32_t>::max)();
+  }
+
 protected:
   /**
    * Reads a frame of input from the underlying stream.
@@ -398,6 +458,18 @@ protected:
    */
   virtual bool readFrame();
 
+  virtual void writeRefSlow(const uint8_t* buf, uint32_t len);
+
+  /**
+   * Drops this transport's handle on the current frame.  Returns true if a
+   * borrowed handle still keeps the frame alive, in which case the next frame
+   * must be read into a new buffer.
+   */
+  bool releaseFrame() {
+    rBufOwner_.reset();
+    return !rBuf_.unique();
+  }
+
   void initPointers() {
     setReadBuffer(NULL, 0);
     setWriteBuffer(wBuf_.get(), wBufSize_);
@@ -411,10 +483,29 @@ protected:
 
   uint32_t rBufSize_;
   uint32_t wBufSize_;
-  boost::scoped_array<uint8_t> rBuf_;
+  // Shared so that borrowShared() can keep a frame alive past the next read.
+  boost::shared_array<uint8_t> rBuf_;
+  // The handle borrowShared() gives out for rBuf_, made once per frame.
+  stdcxx::shared_ptr<void> rBufOwner_;
   boost::scoped_array<uint8_t> wBuf_;
   uint32_t bufReclaimThresh_;
   uint32_t maxFrameSize_;
+  /// The size that beginFrame() wrote into the header, or -1.
+  int32_t wFrameSize_;
+
+private:
+  /// A buffer passed to writeRef() that goes out before wBuf_[offset].
+  struct WriteRef {
+    uint32_t offset;
+    const uint8_t* data;
+    uint32_t len;
+  };
+
+  void flushRefs(uint32_t have);
+
+  std::vector<WriteRef> wRefs_;
+  uint32_t wRefBytes_;
+  std::vector<TWriteSegment> wSegs_;
 };
 
 /**
@@ -545,7 +636,7 @@ public:
   }
 
   ~TMemoryBuffer() {
-    if (owner_) {
+    if (owner_ && !sharedBuffer_) {
       std::free(buffer_);
     }
   }
@@ -585,6 +676,10 @@ public:
   }
 
   void resetBuffer() {
+    if (sharedBuffer_ && !sharedBuffer_.unique()) {
+      // Somebody still holds views into the data; leave it to them.
+      unshareBuffer(false);
+    }
     rBase_ = buffer_;
     rBound_ = buffer_;
     wBase_ = buffer_;
@@ -666,6 +761,16 @@ public:
     return wBase_;
   }
 
+  /**
+   * Makes room for len more bytes, as counted by serializedSize() for
+   * instance.  The buffer is grown at most once and only as much as needed,
+   * rather than doubled as often as the writes would.
+   */
+  void reserve(uint32_t len);
+
+  /// Reserves room for the frame.
+  virtual void beginFrame(uint32_t size) { reserve(size); }
+
   // Informs the buffer that the client has written 'len' bytes into storage
   // that had been provided by getWritePtr().
   void wroteBytes(uint32_t len);
@@ -676,6 +781,14 @@ public:
    */
   uint32_t readAll(uint8_t* buf, uint32_t len) { return TBufferBase::readAll(buf, len); }
 
+  /**
+   * Lends out the unread data of an owned buffer.  Once lent, the buffer is
+   * never written over or reallocated in place again; resetting or growing
+   * it moves to new storage.  Observed buffers are not lent out, since their
+   * lifetime is up to the caller.
+   */
+  virtual const uint8_t* borrowShared(uint32_t* len, stdcxx::shared_ptr<void>& owner);
+
   //! \brief Get the current buffer size
   //! \returns the current buffer size
   uint32_t getBufferSize() const {
@@ -711,11 +824,19 @@ protected:
     swap(wBound_, that.wBound_);
 
     swap(owner_, that.owner_);
+    sharedBuffer_.swap(that.sharedBuffer_);
   }
 
   // Make sure there's at least 'len' bytes available for writing.
   void ensureCanWrite(uint32_t len);
 
+  // Move to a buffer of newSize bytes, keeping the data.
+  void growBuffer(uint64_t newSize);
+
+  // Move to a private buffer of at least newSize bytes, copying the unread
+  // data over if 'preserve' is set, and drop our handle on the lent one.
+  void unshareBuffer(bool preserve, uint32_t newSize = 0);
+
   // Compute the position and available data for reading.
   void computeRead(uint32_t len, uint8_t** out_start, uint32_t* out_give);
 
@@ -737,6 +858,10 @@ protected:
   // Is this object the owner of the buffer?
   bool owner_;
 
+  // Set once buffer_ has been lent out by borrowShared(); it then owns
+  // buffer_ jointly with the borrowers.
+  stdcxx::shared_ptr<uint8_t> sharedBuffer_;
+
   // Don't forget to update constrctors, initCommon, and swap if
   // you add new members.
 };
@@ -0,0 +1,616 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <thrift/thrift-config.h>
+
+#include <algorithm>
+#include <cstring>
+#include <sstream>
+
+#ifdef HAVE_SYS_POLL_H
+#include <sys/poll.h>
+#endif
+
+#include <thrift/concurrency/Util.h>
+#include <thrift/transport/PlatformSocket.h>
+#include <thrift/transport/TConnectionPool.h>
+
+using std::pair;
+using std::string;
+using std::vector;
+
+namespace apache {
+namespace thrift {
+namespace transport {
+
+using concurrency::Guard;
+using concurrency::Util;
+using stdcxx::shared_ptr;
+
+TConnectionPool::TConnectionPool(const vector<pair<string, int> >& servers,
+                                 shared_ptr<TTransportFactory> transportFactory)
+  : transportFactory_(transportFactory),
+    balancing_(LEAST_OUTSTANDING),
+    maxIdlePerHost_(8),
+    connTimeout_(0),
+    recvTimeout_(0),
+    sendTimeout_(0),
+    maxConsecutiveFailures_(1),
+    ejectionTime_(30000),
+    outlierFactor_(3.0),
+    outlierMinCalls_(20),
+    latencyWeight_(0.1),
+    maxEjectedFraction_(0.5),
+    random_(static_cast<uint64_t>(Util::currentTimeUsec()) | 1),
+    next_(0) {
+  for (size_t i = 0; i < servers.size(); ++i) {
+    Host host;
+    host.host = servers[i].first;
+    host.port = servers[i].second;
+    host.outstanding = 0;
+    host.latencyUsec = 0;
+    host.calls = 0;
+    host.consecutiveFailures = 0;
+    host.ejectedUntil = 0;
+    host.ejectedForLatency = false;
+    hosts_.push_back(host);
+  }
+}
+
+TConnectionPool::~TConnectionPool() {
+  for (size_t i = 0; i < hosts_.size(); ++i) {
+    closeAll(vector<shared_ptr<Connection> >(hosts_[i].idle.begin(), hosts_[i].idle.end()));
+  }
+}
+
+void TConnectionPool::setBalancing(Balancing balancing) {
+  balancing_ = balancing;
+}
+
+void TConnectionPool::setMaxIdlePerHost(int maxIdle) {
+  maxIdlePerHost_ = maxIdle;
+}
+
+void TConnectionPool::setConnTimeout(int ms) {
+  connTimeout_ = ms;
+}
+
+void TConnectionPool::setRecvTimeout(int ms) {
+  recvTimeout_ = ms;
+}
+
+void TConnectionPool::setSendTimeout(int ms) {
+  sendTimeout_ = ms;
+}
+
+void TConnectionPool::setMaxConsecutiveFailures(int maxConsecutiveFailures) {
+  maxConsecutiveFailures_ = maxConsecutiveFailures;
+}
+
+void TConnectionPool::setEjectionTime(int ms) {
+  ejectionTime_ = ms;
+}
+
+void TConnectionPool::setOutlierFactor(double factor) {
+  outlierFactor_ = factor;
+}
+
+void TConnectionPool::setOutlierMinCalls(int calls) {
+  outlierMinCalls_ = calls;
+}
+
+void TConnectionPool::setLatencyWeight(double weight) {
+  latencyWeight_ = weight;
+}
+
+void TConnectionPool::setMaxEjectedFraction(double fraction) {
+  maxEjectedFraction_ = fraction;
+}
+
+void TConnectionPool::warmUp(int connectionsPerHost) {
+  for (size_t i = 0; i < hosts_.size(); ++i) {
+    while (true) {
+      {
+        Guard g(mutex_);
+        Host& host = hosts_[i];
+        readmitHosts(Util::currentTime());
+        if (host.ejectedUntil != 0 || static_cast<int>(host.idle.size()) >= connectionsPerHost) {
+          break;
+        }
+      }
+
+      shared_ptr<Connection> connection;
+      try {
+        connection = connect(i);
+      } catch (const TTransportException& te) {
+        GlobalOutput.printf("TConnectionPool::warmUp: %s:%d: %s",
+                            hosts_[i].host.c_str(),
+                            hosts_[i].port,
+                            te.what());
+        vector<shared_ptr<Connection> > toClose;
+        {
+          Guard g(mutex_);
+          countFailure(hosts_[i], Util::currentTime(), toClose);
+        }
+        closeAll(toClose);
+        break;
+      }
+
+      Guard g(mutex_);
+      hosts_[i].idle.push_back(connection);
+    }
+  }
+}
+
+shared_ptr<TConnectionPool::Connection> TConnectionPool::acquire() {
+  for (size_t attempt = 0; attempt < hosts_.size(); ++attempt) {
+    size_t index;
+    shared_ptr<Connection> connection;
+    {
+      Guard g(mutex_);
+      index = pickHost(Util::currentTime());
+      Host& host = hosts_[index];
+      ++host.outstanding;
+      if (!host.idle.empty()) {
+        // The most recently used connection is the least likely to have
+        // been closed by the server.
+        connection = host.idle.back();
+        host.idle.pop_back();
+      }
+    }
+    while (connection && !stillOpen(*connection)) {
+      // Closed by the server while idle, which is no fault of the host
+      closeAll(vector<shared_ptr<Connection> >(1, connection));
+      connection.reset();
+      Guard g(mutex_);
+      Host& host = hosts_[index];
+      if (!host.idle.empty()) {
+        connection = host.idle.back();
+        host.idle.pop_back();
+      }
+    }
+    if (connection) {
+      connection->reused_ = true;
+      return connection;
+    }
+
+    try {
+      return connect(index);
+    } catch (const TTransportException& te) {
+      GlobalOutput.printf("TConnectionPool::acquire: %s:%d: %s",
+                          hosts_[index].host.c_str(),
+                          hosts_[index].port,
+                          te.what());
+      vector<shared_ptr<Connection> > toClose;
+      {
+        Guard g(mutex_);
+        --hosts_[index].outstanding;
+        countFailure(hosts_[index], Util::currentTime(), toClose);
+      }
+      closeAll(toClose);
+    }
+  }
+
+  throw TTransportException(TTransportException::NOT_OPEN,
+                            "TConnectionPool: no host could be reached");
+}
+
+shared_ptr<TConnectionPool::Connection> TConnectionPool::reconnect(
+    const shared_ptr<Connection>& stale) {
+  size_t index = stale->index_;
+  closeAll(vector<shared_ptr<Connection> >(1, stale));
+  try {
+    return connect(index);
+  } catch (const TTransportException&) {
+    vector<shared_ptr<Connection> > toClose;
+    {
+      Guard g(mutex_);
+      --hosts_[index].outstanding;
+      countFailure(hosts_[index], Util::currentTime(), toClose);
+    }
+    closeAll(toClose);
+    throw;
+  }
+}
+
+void TConnectionPool::release(const shared_ptr<Connection>& connection,
+                              bool healthy,
+                              int64_t latencyUsec) {
+  if (!connection) {
+    return;
+  }
+
+  vector<shared_ptr<Connection> > toClose;
+  {
+    Guard g(mutex_);
+    Host& host = hosts_[connection->index_];
+    int64_t now = Util::currentTime();
+    --host.outstanding;
+    if (!healthy) {
+      toClose.push_back(connection);
+      countFailure(host, now, toClose);
+    } else {
+      host.consecutiveFailures = 0;
+      if (latencyUsec >= 0) {
+        double latency = static_cast<double>(latencyUsec);
+        host.latencyUsec = host.calls == 0
+                               ? latency
+                               : host.latencyUsec + latencyWeight_ * (latency - host.latencyUsec);
+        ++host.calls;
+        checkOutlier(host, now, toClose);
+      }
+      if (host.ejectedUntil == 0 && static_cast<int>(host.idle.size()) < maxIdlePerHost_) {
+        host.idle.push_back(connection);
+      } else {
+        toClose.push_back(connection);
+      }
+    }
+  }
+  closeAll(toClose);
+}
+
+void TConnectionPool::discard(const shared_ptr<Connection>& connection) {
+  if (!connection) {
+    return;
+  }
+
+  {
+    Guard g(mutex_);
+    --hosts_[connection->index_].outstanding;
+  }
+  closeAll(vector<shared_ptr<Connection> >(1, connection));
+}
+
+void TConnectionPool::getHostStats(vector<TConnectionPoolHostStats>& stats) {
+  Guard g(mutex_);
+  readmitHosts(Util::currentTime());
+  stats.resize(hosts_.size());
+  for (size_t i = 0; i < hosts_.size(); ++i) {
+    stats[i].host = hosts_[i].host;
+    stats[i].port = hosts_[i].port;
+    stats[i].outstanding = hosts_[i].outstanding;
+    stats[i].idle = static_cast<int>(hosts_[i].idle.size());
+    stats[i].latencyUsec = hosts_[i].latencyUsec;
+    stats[i].ejected = hosts_[i].ejectedUntil != 0;
+    stats[i].calls = hosts_[i].calls;
+  }
+}
+
+size_t TConnectionPool::pickHost(int64_t now) {
+  if (hosts_.empty()) {
+    throw TTransportException(TTransportException::NOT_OPEN, "TConnectionPool: no hosts");
+  }
+  readmitHosts(now);
+
+  vector<size_t> candidates;
+  candidates.reserve(hosts_.size());
+  for (size_t i = 0; i < hosts_.size(); ++i) {
+    if (hosts_[i].ejectedUntil == 0) {
+      candidates.push_back(i);
+    }
+  }
+  if (candidates.empty()) {
+    // Everything is ejected; try the host that is due back first.
+    size_t first = 0;
+    for (size_t i = 1; i < hosts_.size(); ++i) {
+      if (hosts_[i].ejectedUntil < hosts_[first].ejectedUntil) {
+        first = i;
+      }
+    }
+    return first;
+  }
+
+  if (balancing_ == POWER_OF_TWO_CHOICES && candidates.size() > 2) {
+    // xorshift64
+    random_ ^= random_ << 13;
+    random_ ^= random_ >> 7;
+    random_ ^= random_ << 17;
+    size_t a = static_cast<size_t>(random_ % candidates.size());
+    size_t b = static_cast<size_t>((random_ >> 32) % (candidates.size() - 1));
+    if (b >= a) {
+      ++b;
+    }
+    const Host& hostA = hosts_[candidates[a]];
+    const Host& hostB = hosts_[candidates[b]];
+    return better(hostB, hostA) ? candidates[b] : candidates[a];
+  }
+
+  // Start at a different host every time, so that ties are spread out.
+  size_t start = next_++ % candidates.size();
+  size_t best = candidates[start];
+  for (size_t i = 1; i < candidates.size(); ++i) {
+    size_t index = candidates[(start + i) % candidates.size()];
+    if (better(hosts_[index], hosts_[best])) {
+      best = index;
+    }
+  }
+  return best;
+}
+
+bool TConnectionPool::better(const Host& a, const Host& b) const {
+  if (a.outstanding != b.outstanding) {
+    return a.outstanding < b.outstanding;
+  }
+  return a.latencyUsec < b.latencyUsec;
+}
+
+void TConnectionPool::readmitHosts(int64_t now) {
+  for (size_t i = 0; i < hosts_.size(); ++i) {
+    Host& host = hosts_[i];
+    if (host.ejectedUntil != 0 && host.ejectedUntil <= now) {
+      // Back on probation: its latency starts over.
+      host.ejectedUntil = 0;
+      host.ejectedForLatency = false;
+      host.consecutiveFailures = 0;
+      host.latencyUsec = 0;
+      host.calls = 0;
+    }
+  }
+}
+
+void TConnectionPool::countFailure(Host& host,
+                                   int64_t now,
+                                   vector<shared_ptr<Connection> >& toClose) {
+  if (++host.consecutiveFailures > maxConsecutiveFailures_) {
+    GlobalOutput.printf("TConnectionPool: ejecting %s:%d after %d failures",
+                        host.host.c_str(),
+                        host.port,
+                        host.consecutiveFailures);
+    host.consecutiveFailures = 0;
+    host.ejectedForLatency = false;
+    eject(host, now, toClose);
+  }
+}
+
+void TConnectionPool::checkOutlier(Host& host,
+                                   int64_t now,
+                                   vector<shared_ptr<Connection> >& toClose) {
+  if (outlierFactor_ <= 0 || host.ejectedUntil != 0 || host.calls < outlierMinCalls_) {
+    return;
+  }
+
+  vector<double> others;
+  size_t ejectedForLatency = 0;
+  for (size_t i = 0; i < hosts_.size(); ++i) {
+    const Host& other = hosts_[i];
+    if (other.ejectedUntil != 0) {
+      if (other.ejectedForLatency) {
+        ++ejectedForLatency;
+      }
+    } else if (&other != &host && other.calls >= outlierMinCalls_) {
+      others.push_back(other.latencyUsec);
+    }
+  }
+  if (others.empty()
+      || static_cast<double>(ejectedForLatency + 1) > maxEjectedFraction_ * hosts_.size()) {
+    return;
+  }
+
+  std::nth_element(others.begin(), others.begin() + others.size() / 2, others.end());
+  double median = others[others.size() / 2];
+  if (host.latencyUsec > outlierFactor_ * median) {
+    GlobalOutput.printf("TConnectionPool: ejecting %s:%d, latency %.0f us against %.0f us",
+                        host.host.c_str(),
+                        host.port,
+                        host.latencyUsec,
+                        median);
+    host.ejectedForLatency = true;
+    eject(host, now, toClose);
+  }
+}
+
+void TConnectionPool::eject(Host& host, int64_t now, vector<shared_ptr<Connection> >& toClose) {
+  host.ejectedUntil = now + (std::max)(ejectionTime_, 1);
+  toClose.insert(toClose.end(), host.idle.begin(), host.idle.end());
+  host.idle.clear();
+}
+
+shared_ptr<TConnectionPool::Connection> TConnectionPool::connect(size_t index) {
+  // hosts_ never changes size, and the names and ports of its hosts stay put.
+  shared_ptr<TSocket> socket(new TSocket(hosts_[index].host, hosts_[index].port));
+  socket->setConnTimeout(connTimeout_);
+  socket->setRecvTimeout(recvTimeout_);
+  socket->setSendTimeout(sendTimeout_);
+  socket->open();
+
+  shared_ptr<Connection> connection(new Connection);
+  connection->host_ = hosts_[index].host;
+  connection->port_ = hosts_[index].port;
+  connection->index_ = index;
+  connection->reused_ = false;
+  connection->socket_ = socket;
+  connection->transport_ = transportFactory_ ? transportFactory_->getTransport(socket)
+                                             : shared_ptr<TTransport>(socket);
+  return connection;
+}
+
+bool TConnectionPool::stillOpen(const Connection& connection) {
+  // Nothing is due on an idle connection: readable means that the server
+  // closed it, or sent something out of turn.
+  struct THRIFT_POLLFD fds[1];
+  std::memset(fds, 0, sizeof(fds));
+  fds[0].fd = connection.socket_->getSocketFD();
+  fds[0].events = THRIFT_POLLIN;
+  return THRIFT_POLL(fds, 1, 0) == 0;
+}
+
+void TConnectionPool::closeAll(const vector<shared_ptr<Connection> >& connections) {
+  for (size_t i = 0; i < connections.size(); ++i) {
+    try {
+      connections[i]->transport_->close();
+    } catch (const TTransportException& te) {
+      GlobalOutput.printf("TConnectionPool: close(): %s", te.what());
+    }
+  }
+}
+
+TPooledTransport::TPooledTransport(shared_ptr<TConnectionPool> pool)
+  : pool_(pool), sentUsec_(0), reading_(false), oneway_(false), received_(false) {
+}
+
+TPooledTransport::~TPooledTransport() {
+  close();
+}
+
+void TPooledTransport::close() {
+  if (!connection_) {
+    return;
+  }
+  if (oneway_ && sentUsec_ != 0 && !reading_) {
+    release(true, -1);
+  } else {
+    // A call given up half way leaves the connection out of step.
+    shared_ptr<TConnectionPool::Connection> connection;
+    connection.swap(connection_);
+    sentUsec_ = 0;
+    reading_ = false;
+    received_ = false;
+    request_.clear();
+    pool_->discard(connection);
+  }
+}
+
+void TPooledTransport::beginCall(bool oneway) {
+  if (connection_ && sentUsec_ != 0) {
+    close();
+  }
+  oneway_ = oneway;
+}
+
+uint32_t TPooledTransport::read(uint8_t* buf, uint32_t len) {
+  if (!connection_ || sentUsec_ == 0) {
+    throw TTransportException(TTransportException::NOT_OPEN, "TPooledTransport: no request sent");
+  }
+  reading_ = true;
+  uint32_t got;
+  try {
+    got = connection_->getTransport()->read(buf, len);
+  } catch (const TTransportException& te) {
+    if (!retry(te, true)) {
+      release(false, -1);
+      throw;
+    }
+    return read(buf, len);
+  }
+  if (got == 0 && retry(TTransportException(TTransportException::END_OF_FILE), true)) {
+    return read(buf, len);
+  }
+  received_ = received_ || got > 0;
+  return got;
+}
+
+uint32_t TPooledTransport::readEnd() {
+  if (!connection_) {
+    return 0;
+  }
+  uint32_t bytes;
+  try {
+    bytes = connection_->getTransport()->readEnd();
+  } catch (const TTransportException&) {
+    release(false, -1);
+    throw;
+  }
+  release(true, Util::currentTimeUsec() - sentUsec_);
+  return bytes;
+}
+
+void TPooledTransport::write(const uint8_t* buf, uint32_t len) {
+  if (connection_ && sentUsec_ != 0) {
+    // The last call was oneway, or its reply was not read to the end.
+    close();
+  }
+  if (!connection_) {
+    connection_ = pool_->acquire();
+  }
+  if (connection_->isReused()) {
+    request_.append(reinterpret_cast<const char*>(buf), len);
+  }
+  try {
+    connection_->getTransport()->write(buf, len);
+  } catch (const TTransportException& te) {
+    if (!retry(te, false)) {
+      release(false, -1);
+      throw;
+    }
+  }
+}
+
+void TPooledTransport::flush() {
+  if (!connection_) {
+    return;
+  }
+  try {
+    connection_->getTransport()->flush();
+  } catch (const TTransportException& te) {
+    if (!retry(te, true)) {
+      release(false, -1);
+      throw;
+    }
+  }
+  sentUsec_ = Util::currentTimeUsec();
+}
+
+const std::string TPooledTransport::getOrigin() {
+  if (!connection_) {
+    return "Unknown";
+  }
+  std::ostringstream oss;
+  oss << connection_->getHost() << ":" << connection_->getPort();
+  return oss.str();
+}
+
+void TPooledTransport::release(bool healthy, int64_t latencyUsec) {
+  shared_ptr<TConnectionPool::Connection> connection;
+  connection.swap(connection_);
+  sentUsec_ = 0;
+  reading_ = false;
+  received_ = false;
+  request_.clear();
+  pool_->release(connection, healthy, latencyUsec);
+}
+
+bool TPooledTransport::retry(const TTransportException& cause, bool flush) {
+  // A request that timed out may be running on the server; sending it
+  // again could run it twice.
+  if (!connection_->isReused() || received_ || cause.getType() == TTransportException::TIMED_OUT) {
+    return false;
+  }
+
+  shared_ptr<TConnectionPool::Connection> stale;
+  stale.swap(connection_);
+  std::string request;
+  request.swap(request_);
+  sentUsec_ = 0;
+  connection_ = pool_->reconnect(stale);
+  try {
+    connection_->getTransport()->write(reinterpret_cast<const uint8_t*>(request.data()),
+                                       static_cast<uint32_t>(request.size()));
+    if (flush) {
+      connection_->getTransport()->flush();
+      sentUsec_ = Util::currentTimeUsec();
+    }
+  } catch (const TTransportException&) {
+    release(false, -1);
+    throw;
+  }
+  return true;
+}
+}
+}
+} // apache::thrift::transport
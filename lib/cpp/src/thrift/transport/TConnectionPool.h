@@ -0,0 +1,363 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef _THRIFT_TRANSPORT_TCONNECTIONPOOL_H_
+#define _THRIFT_TRANSPORT_TCONNECTIONPOOL_H_ 1
+
+#include <deque>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <thrift/concurrency/Mutex.h>
+#include <thrift/protocol/TProtocolDecorator.h>
+#include <thrift/stdcxx.h>
+#include <thrift/transport/TSocket.h>
+#include <thrift/transport/TVirtualTransport.h>
+
+namespace apache {
+namespace thrift {
+namespace transport {
+
+/**
+ * What a TConnectionPool knows about one of its hosts.
+ */
+struct TConnectionPoolHostStats {
+  std::string host;
+  int port;
+
+  /// Connections handed out and not released yet
+  int outstanding;
+
+  /// Open connections waiting to be handed out
+  int idle;
+
+  /// Moving average of the call latency, in microseconds; 0 before any call
+  double latencyUsec;
+
+  /// Whether the host is ejected, and is only used if all others are too
+  bool ejected;
+
+  /// Calls made through the host since it last joined the pool
+  int64_t calls;
+};
+
+/**
+ * A client-side pool of connections to a set of equivalent servers, shared
+ * by any number of threads.  Unlike TSocketPool, which picks a server once
+ * when it is opened, the pool picks a host for every call:
+ *
+ *  - LEAST_OUTSTANDING takes the host with the fewest calls in flight, and
+ *    of those the one with the lowest latency.
+ *  - POWER_OF_TWO_CHOICES compares two hosts picked at random the same way,
+ *    which spreads load as well without herding all clients of a busy
+ *    service onto the same least loaded host.
+ *
+ * Connections are kept open between calls, up to a number per host, and can
+ * be opened ahead of the first calls with warmUp().  A host is ejected for
+ * a while when connecting to it fails too often, or when its latency,
+ * averaged over recent calls, is far above the median of the others.  As
+ * long as there are hosts left, ejected hosts get no calls.
+ *
+ * Calls are usually made through a TPooledTransport, which takes a
+ * connection from the pool for every call and gives it back once the reply
+ * is read, and a TPooledProtocol on top of it.
+ */
+class TConnectionPool {
+public:
+  enum Balancing { LEAST_OUTSTANDING, POWER_OF_TWO_CHOICES };
+
+  /**
+   * A connection handed out by the pool, to be given back with release().
+   */
+  class Connection {
+  public:
+    /// The transport to make the call on, as made by the transport factory
+    const stdcxx::shared_ptr<TTransport>& getTransport() const { return transport_; }
+
+    const std::string& getHost() const { return host_; }
+    int getPort() const { return port_; }
+
+    /**
+     * Whether the connection was idle in the pool before it was handed
+     * out, so that the server may have closed it since.
+     */
+    bool isReused() const { return reused_; }
+
+  private:
+    friend class TConnectionPool;
+
+    std::string host_;
+    int port_;
+    size_t index_;
+    bool reused_;
+    stdcxx::shared_ptr<TSocket> socket_;
+    stdcxx::shared_ptr<TTransport> transport_;
+  };
+
+  /**
+   * @param servers pairs of host name and port
+   * @param transportFactory wraps every connection, for example in a
+   *        TFramedTransport; by default the bare socket is used.
+   */
+  TConnectionPool(const std::vector<std::pair<std::string, int> >& servers,
+                  stdcxx::shared_ptr<TTransportFactory> transportFactory
+                  = stdcxx::shared_ptr<TTransportFactory>());
+
+  virtual ~TConnectionPool();
+
+  void setBalancing(Balancing balancing);
+
+  /// Most connections to keep open per host between calls; 8 by default.
+  void setMaxIdlePerHost(int maxIdle);
+
+  /// Timeouts of new connections, in milliseconds, as for TSocket.
+  void setConnTimeout(int ms);
+  void setRecvTimeout(int ms);
+  void setSendTimeout(int ms);
+
+  /**
+   * Failures of a host in a row, to connect or of calls on its connections,
+   * that are tolerated; one more ejects the host.  1 by default.
+   */
+  void setMaxConsecutiveFailures(int maxConsecutiveFailures);
+
+  /// How long a host stays ejected, in milliseconds; 30 seconds by default.
+  void setEjectionTime(int ms);
+
+  /**
+   * A host whose latency is more than factor times the median of the other
+   * hosts in the pool is ejected; 0 turns this off.  3 by default.
+   */
+  void setOutlierFactor(double factor);
+
+  /// Calls a host must have made before its latency counts; 20 by default.
+  void setOutlierMinCalls(int calls);
+
+  /// Weight of the latest call in the moving average of latency; 0.1 by default.
+  void setLatencyWeight(double weight);
+
+  /// Most hosts that may be ejected for their latency at once, as a fraction; 0.5 by default.
+  void setMaxEjectedFraction(double fraction);
+
+  /**
+   * Opens connections to every host that is not ejected until it has
+   * connectionsPerHost idle ones.  Hosts that cannot be reached are counted
+   * as failures, like when a call needs a connection.
+   */
+  void warmUp(int connectionsPerHost);
+
+  /**
+   * Picks a host and hands out an idle connection to it, or opens one.
+   * Idle connections that the server has closed are dropped on the way.
+   * Tries other hosts when connecting fails, and throws a
+   * TTransportException if none can be reached.
+   */
+  stdcxx::shared_ptr<Connection> acquire();
+
+  /**
+   * Closes a reused connection that failed before any of its reply came
+   * back, without counting a failure of its host, and hands out a new
+   * connection to the same host in its place.  Throws a
+   * TTransportException, counting a failure, if that cannot be opened.
+   */
+  stdcxx::shared_ptr<Connection> reconnect(const stdcxx::shared_ptr<Connection>& stale);
+
+  /**
+   * Gives back a connection.  A healthy connection is kept for later calls,
+   * and the latency of its call, if not negative, goes into the average of
+   * its host.  Otherwise the connection is closed and counts as a failure
+   * of its host.
+   */
+  void release(const stdcxx::shared_ptr<Connection>& connection, bool healthy, int64_t latencyUsec);
+
+  /**
+   * Closes a connection that cannot be used again through no fault of its
+   * host, such as one whose call was given up before its reply was read.
+   */
+  void discard(const stdcxx::shared_ptr<Connection>& connection);
+
+  void getHostStats(std::vector<TConnectionPoolHostStats>& stats);
+
+private:
+  struct Host {
+    std::string host;
+    int port;
+    int outstanding;
+    std::deque<stdcxx::shared_ptr<Connection> > idle;
+    double latencyUsec;
+    int64_t calls;
+    int consecutiveFailures;
+    int64_t ejectedUntil;
+    bool ejectedForLatency;
+  };
+
+  /// Picks the host for a call; requires mutex_.
+  size_t pickHost(int64_t now);
+
+  /// Whether host a is the better choice than host b; requires mutex_.
+  bool better(const Host& a, const Host& b) const;
+
+  /// Brings back hosts whose ejection has run out; requires mutex_.
+  void readmitHosts(int64_t now);
+
+  /// Counts a failure of a host, and ejects it if there were too many; requires mutex_.
+  void countFailure(Host& host,
+                    int64_t now,
+                    std::vector<stdcxx::shared_ptr<Connection> >& toClose);
+
+  /// Ejects a host whose latency is an outlier; requires mutex_.
+  void checkOutlier(Host& host,
+                    int64_t now,
+                    std::vector<stdcxx::shared_ptr<Connection> >& toClose);
+
+  /// Takes the idle connections of an ejected host to close; requires mutex_.
+  void eject(Host& host,
+             int64_t now,
+             std::vector<stdcxx::shared_ptr<Connection> >& toClose);
+
+  stdcxx::shared_ptr<Connection> connect(size_t host);
+
+  /// Whether an idle connection has nothing to read, not even its end.
+  static bool stillOpen(const Connection& connection);
+
+  static void closeAll(const std::vector<stdcxx::shared_ptr<Connection> >& connections);
+
+  stdcxx::shared_ptr<TTransportFactory> transportFactory_;
+  Balancing balancing_;
+  int maxIdlePerHost_;
+  int connTimeout_;
+  int recvTimeout_;
+  int sendTimeout_;
+  int maxConsecutiveFailures_;
+  int ejectionTime_;
+  double outlierFactor_;
+  int outlierMinCalls_;
+  double latencyWeight_;
+  double maxEjectedFraction_;
+
+  /// Guards the state of hosts_, random_ and next_
+  concurrency::Mutex mutex_;
+  std::vector<Host> hosts_;
+  uint64_t random_;
+  size_t next_;
+};
+
+/**
+ * A transport that makes every call on a connection from a TConnectionPool.
+ * It takes a connection when a request is written and gives it back when
+ * readEnd() is called after the reply is read, so generated clients using it
+ * spread their calls over the hosts of the pool.  A oneway call gives back
+ * its connection when the next request is written, if the client writes it
+ * through a TPooledProtocol.  The connection of any other call given up
+ * before its reply is read to the end is closed, as a reply could still be
+ * on its way.
+ *
+ * A call on a reused connection that fails before any of its reply arrives
+ * is sent once more on a new connection, as the server most likely closed
+ * the idle connection; the request is kept until then.
+ *
+ * As with other transports, one thread at a time may use a TPooledTransport;
+ * every thread can have its own on the same pool.
+ */
+class TPooledTransport : public TVirtualTransport<TPooledTransport> {
+public:
+  TPooledTransport(stdcxx::shared_ptr<TConnectionPool> pool);
+
+  virtual ~TPooledTransport();
+
+  /// Connections are opened by the pool as needed.
+  bool isOpen() { return true; }
+  void open() {}
+
+  /// Gives up the connection of a call in progress.
+  void close();
+
+  /**
+   * Starts a call, giving up the connection of the last one.  Called by
+   * TPooledProtocol as a message is written; a oneway call needs no reply
+   * for its connection to be used again.
+   */
+  void beginCall(bool oneway);
+
+  uint32_t read(uint8_t* buf, uint32_t len);
+  uint32_t readEnd();
+  void write(const uint8_t* buf, uint32_t len);
+  void flush();
+
+  virtual const std::string getOrigin();
+
+  /// The connection of the call in progress, if any
+  stdcxx::shared_ptr<TConnectionPool::Connection> getConnection() const { return connection_; }
+
+private:
+  void release(bool healthy, int64_t latencyUsec);
+
+  /// Sends the request again on a new connection; false if it may not be.
+  bool retry(const TTransportException& cause, bool flush);
+
+  stdcxx::shared_ptr<TConnectionPool> pool_;
+  stdcxx::shared_ptr<TConnectionPool::Connection> connection_;
+
+  /// When the request of the call was flushed, 0 before
+  int64_t sentUsec_;
+
+  /// Set once the reply of the call is being read
+  bool reading_;
+
+  /// Whether the call was written as oneway through a TPooledProtocol
+  bool oneway_;
+
+  /// Set once some of the reply has been read
+  bool received_;
+
+  /// The request written on a reused connection, to send again
+  std::string request_;
+};
+
+/**
+ * Wraps the protocol of a client on a TPooledTransport, telling the
+ * transport which calls are oneway.
+ */
+class TPooledProtocol : public protocol::TProtocolDecorator {
+public:
+  TPooledProtocol(stdcxx::shared_ptr<protocol::TProtocol> protocol)
+    : protocol::TProtocolDecorator(protocol),
+      transport_(stdcxx::dynamic_pointer_cast<TPooledTransport>(protocol->getTransport())) {
+    if (!transport_) {
+      throw TTransportException(TTransportException::BAD_ARGS,
+                                "TPooledProtocol: not on a TPooledTransport");
+    }
+  }
+
+  virtual uint32_t writeMessageBegin_virt(const std::string& name,
+                                          const protocol::TMessageType messageType,
+                                          const int32_t seqid) {
+    transport_->beginCall(messageType == protocol::T_ONEWAY);
+    return protocol::TProtocolDecorator::writeMessageBegin_virt(name, messageType, seqid);
+  }
+
+private:
+  stdcxx::shared_ptr<TPooledTransport> transport_;
+};
+}
+}
+} // apache::thrift::transport
+
+#endif // #ifndef _THRIFT_TRANSPORT_TCONNECTIONPOOL_H_
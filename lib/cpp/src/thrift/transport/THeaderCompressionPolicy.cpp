@@ -0,0 +1,135 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <thrift/transport/THeaderCompressionPolicy.h>
+#include <thrift/transport/THeaderTransport.h>
+
+namespace apache {
+namespace thrift {
+namespace transport {
+
+namespace {
+// Weight of the newest sample in the moving averages.
+const double SAMPLE_WEIGHT = 0.125;
+}
+
+TAdaptiveCompressionPolicy::TAdaptiveCompressionPolicy(const std::vector<uint16_t>& codecs)
+  : minSize_(DEFAULT_MIN_SIZE),
+    maxRatio_(0.9),
+    maxNanosPerByte_(40.0),
+    probeInterval_(DEFAULT_PROBE_INTERVAL),
+    eligible_(0),
+    nextProbe_(0) {
+  addCodecs(codecs);
+}
+
+TAdaptiveCompressionPolicy::TAdaptiveCompressionPolicy()
+  : minSize_(DEFAULT_MIN_SIZE),
+    maxRatio_(0.9),
+    maxNanosPerByte_(40.0),
+    probeInterval_(DEFAULT_PROBE_INTERVAL),
+    eligible_(0),
+    nextProbe_(0) {
+  // Whether the peer has any other codec is not known.
+  addCodecs(std::vector<uint16_t>(1, THeaderTransport::ZLIB_TRANSFORM));
+}
+
+void TAdaptiveCompressionPolicy::addCodecs(const std::vector<uint16_t>& codecs) {
+  for (std::vector<uint16_t>::const_iterator it = codecs.begin(); it != codecs.end(); ++it) {
+    if (THeaderTransport::isTransformRegistered(*it) && find(*it) == NULL) {
+      Codec codec = {*it, 0, 1.0, 0.0};
+      codecs_.push_back(codec);
+    }
+  }
+}
+
+const TAdaptiveCompressionPolicy::Codec* TAdaptiveCompressionPolicy::find(uint16_t transId) const {
+  for (std::vector<Codec>::const_iterator it = codecs_.begin(); it != codecs_.end(); ++it) {
+    if (it->transId == transId) {
+      return &*it;
+    }
+  }
+  return NULL;
+}
+
+uint16_t TAdaptiveCompressionPolicy::select(uint32_t len) {
+  THRIFT_UNUSED_VARIABLE(len);
+  if (codecs_.empty()) {
+    return 0;
+  }
+
+  for (std::vector<Codec>::const_iterator it = codecs_.begin(); it != codecs_.end(); ++it) {
+    if (it->samples == 0) {
+      return it->transId;
+    }
+  }
+
+  if (++eligible_ % probeInterval_ == 0) {
+    nextProbe_ = (nextProbe_ + 1) % codecs_.size();
+    return codecs_[nextProbe_].transId;
+  }
+
+  const Codec* best = NULL;
+  for (std::vector<Codec>::const_iterator it = codecs_.begin(); it != codecs_.end(); ++it) {
+    if (it->nanosPerByte <= maxNanosPerByte_ && (best == NULL || it->ratio < best->ratio)) {
+      best = &*it;
+    }
+  }
+  if (best == NULL || best->ratio > maxRatio_) {
+    return 0;
+  }
+  return best->transId;
+}
+
+void TAdaptiveCompressionPolicy::record(uint16_t transId,
+                                        uint32_t len,
+                                        uint32_t compressedLen,
+                                        int64_t nanos) {
+  if (len == 0) {
+    return;
+  }
+  for (std::vector<Codec>::iterator it = codecs_.begin(); it != codecs_.end(); ++it) {
+    if (it->transId != transId) {
+      continue;
+    }
+    double ratio = static_cast<double>(compressedLen) / len;
+    double nanosPerByte = static_cast<double>(nanos) / len;
+    if (it->samples++ == 0) {
+      it->ratio = ratio;
+      it->nanosPerByte = nanosPerByte;
+    } else {
+      it->ratio += SAMPLE_WEIGHT * (ratio - it->ratio);
+      it->nanosPerByte += SAMPLE_WEIGHT * (nanosPerByte - it->nanosPerByte);
+    }
+    return;
+  }
+}
+
+double TAdaptiveCompressionPolicy::getRatio(uint16_t transId) const {
+  const Codec* codec = find(transId);
+  return codec != NULL && codec->samples > 0 ? codec->ratio : -1.0;
+}
+
+double TAdaptiveCompressionPolicy::getNanosPerByte(uint16_t transId) const {
+  const Codec* codec = find(transId);
+  return codec != NULL && codec->samples > 0 ? codec->nanosPerByte : -1.0;
+}
+}
+}
+} // apache::thrift::transport
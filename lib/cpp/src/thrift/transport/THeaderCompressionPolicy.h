@@ -0,0 +1,173 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef THRIFT_TRANSPORT_THEADERCOMPRESSIONPOLICY_H_
+#define THRIFT_TRANSPORT_THEADERCOMPRESSIONPOLICY_H_ 1
+
+#include <vector>
+
+#include <thrift/Thrift.h>
+
+namespace apache {
+namespace thrift {
+namespace transport {
+
+/**
+ * Compression counters of a THeaderTransport.  Frames only count when they
+ * went through the compression policy.
+ */
+struct THeaderCompressionStats {
+  THeaderCompressionStats()
+    : frames(0),
+      compressedFrames(0),
+      skippedSmall(0),
+      skippedByPolicy(0),
+      incompressible(0),
+      bytesIn(0),
+      bytesOut(0),
+      compressNanos(0) {}
+
+  uint64_t frames;
+  uint64_t compressedFrames;
+  uint64_t skippedSmall;      // below the policy's size threshold
+  uint64_t skippedByPolicy;   // no codec was worth it
+  uint64_t incompressible;    // compressed, but sent as is because it grew
+  uint64_t bytesIn;           // payload bytes before compression
+  uint64_t bytesOut;          // payload bytes sent
+  uint64_t compressNanos;     // time spent compressing, including wasted attempts
+
+  int64_t bytesSaved() const {
+    return static_cast<int64_t>(bytesIn) - static_cast<int64_t>(bytesOut);
+  }
+};
+
+/**
+ * Decides, frame by frame, whether and how a THeaderTransport compresses
+ * what it sends.  The transport reports the outcome of every compression
+ * back, so a policy can learn from it.  A policy belongs to one transport.
+ */
+class THeaderCompressionPolicy {
+public:
+  virtual ~THeaderCompressionPolicy() {}
+
+  /**
+   * Returns the transform id to compress a frame of len bytes with, or 0 to
+   * send it as is.
+   */
+  virtual uint16_t select(uint32_t len) = 0;
+
+  /**
+   * Reports that a frame of len bytes compressed to compressedLen bytes with
+   * transId in nanos nanoseconds.
+   */
+  virtual void record(uint16_t transId, uint32_t len, uint32_t compressedLen, int64_t nanos) = 0;
+
+  /**
+   * Returns the size below which frames are never compressed.
+   */
+  virtual uint32_t getMinSize() const = 0;
+};
+
+/**
+ * Picks, among a set of codecs, the one that currently saves the most bytes
+ * within a CPU budget.  Each codec keeps a moving average of its compression
+ * ratio and cost per input byte; codecs that have not been seen yet are
+ * tried first, and every probeInterval-th eligible frame tries the next
+ * codec in turn so that the averages follow changing traffic.  Frames are
+ * sent uncompressed when they are small or when even the best codec would
+ * save too little.
+ */
+class TAdaptiveCompressionPolicy : public THeaderCompressionPolicy {
+public:
+  static const uint32_t DEFAULT_MIN_SIZE = 512;
+  static const uint32_t DEFAULT_PROBE_INTERVAL = 64;
+
+  /**
+   * @param codecs transform ids to choose from, in order of preference when
+   *        they compress equally well; ids that are not registered are ignored
+   */
+  explicit TAdaptiveCompressionPolicy(const std::vector<uint16_t>& codecs);
+
+  /**
+   * Uses zlib only, which every THeaderTransport can decode.  Codecs such as
+   * LZ4, Snappy and Zstd are only built in when their libraries are found,
+   * so pass them explicitly when the peer is known to have them.
+   */
+  TAdaptiveCompressionPolicy();
+
+  uint16_t select(uint32_t len);
+
+  void record(uint16_t transId, uint32_t len, uint32_t compressedLen, int64_t nanos);
+
+  uint32_t getMinSize() const { return minSize_; }
+
+  void setMinSize(uint32_t minSize) { minSize_ = minSize; }
+
+  /**
+   * Compression has to shrink frames to at most this fraction of their size
+   * to be used.  Default 0.9.
+   */
+  void setMaxRatio(double maxRatio) { maxRatio_ = maxRatio; }
+
+  /**
+   * Codecs that cost more than this many nanoseconds per input byte are not
+   * picked.  Default 40, about what zlib costs at its default level.
+   */
+  void setMaxNanosPerByte(double maxNanosPerByte) { maxNanosPerByte_ = maxNanosPerByte; }
+
+  void setProbeInterval(uint32_t probeInterval) {
+    probeInterval_ = probeInterval > 0 ? probeInterval : 1;
+  }
+
+  /**
+   * Returns the average compression ratio seen for transId, or a negative
+   * number if it has not been tried.
+   */
+  double getRatio(uint16_t transId) const;
+
+  /**
+   * Returns the average cost in nanoseconds per input byte seen for
+   * transId, or a negative number if it has not been tried.
+   */
+  double getNanosPerByte(uint16_t transId) const;
+
+private:
+  struct Codec {
+    uint16_t transId;
+    uint64_t samples;
+    double ratio;
+    double nanosPerByte;
+  };
+
+  void addCodecs(const std::vector<uint16_t>& codecs);
+  const Codec* find(uint16_t transId) const;
+
+  std::vector<Codec> codecs_;
+  uint32_t minSize_;
+  double maxRatio_;
+  double maxNanosPerByte_;
+  uint32_t probeInterval_;
+  uint32_t eligible_;
+  size_t nextProbe_;
+};
+}
+}
+} // apache::thrift::transport
+
+#endif // #ifndef THRIFT_TRANSPORT_THEADERCOMPRESSIONPOLICY_H_
@@ -0,0 +1,425 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <thrift/thrift-config.h>
+
+#include <thrift/transport/THeaderTransform.h>
+#include <thrift/transport/TTransportException.h>
+
+#include <algorithm>
+#include <limits>
+#include <string.h>
+#include <zlib.h>
+
+#ifdef HAVE_LZ4_H
+#include <lz4.h>
+#endif
+#ifdef HAVE_ZSTD_H
+#include <zstd.h>
+#endif
+#ifdef HAVE_SNAPPY_C_H
+#include <snappy-c.h>
+#endif
+
+namespace apache {
+namespace thrift {
+namespace transport {
+
+using stdcxx::shared_ptr;
+
+uint8_t* THeaderTransformBuffer::reserve(uint32_t len) {
+  if (len > capacity_) {
+    uint32_t newCapacity = (std::max)(len, capacity_ < 0x80000000u ? capacity_ * 2 : len);
+    uint8_t* newBuf = new uint8_t[newCapacity];
+    if (size_ > 0) {
+      memcpy(newBuf, buf_.get(), size_);
+    }
+    buf_.reset(newBuf);
+    capacity_ = newCapacity;
+  }
+  return buf_.get();
+}
+
+void THeaderTransformBuffer::swap(boost::scoped_array<uint8_t>& buf, uint32_t& capacity) {
+  buf_.swap(buf);
+  std::swap(capacity_, capacity);
+  size_ = 0;
+}
+
+namespace {
+
+void checkedSize(uint64_t len, uint32_t maxLen, const char* codec) {
+  if (len > maxLen) {
+    throw TTransportException(TTransportException::CORRUPTED_DATA,
+                              std::string(codec) + " frame decodes past the maximum frame size");
+  }
+}
+
+/**
+ * zlib streams are set up on first use and reset, rather than rebuilt, for
+ * every further frame.
+ */
+class ZlibTransform : public THeaderTransform {
+public:
+  explicit ZlibTransform(int level) : level_(level), deflateReady_(false), inflateReady_(false) {
+    memset(&deflate_, 0, sizeof(deflate_));
+    memset(&inflate_, 0, sizeof(inflate_));
+  }
+
+  ~ZlibTransform() {
+    if (deflateReady_) {
+      deflateEnd(&deflate_);
+    }
+    if (inflateReady_) {
+      inflateEnd(&inflate_);
+    }
+  }
+
+  void transform(const uint8_t* in, uint32_t len, THeaderTransformBuffer& out) {
+    if (!deflateReady_) {
+      if (deflateInit(&deflate_, level_) != Z_OK) {
+        throw TTransportException(TTransportException::CORRUPTED_DATA,
+                                  "Error while zlib deflateInit");
+      }
+      deflateReady_ = true;
+    } else if (deflateReset(&deflate_) != Z_OK) {
+      throw TTransportException(TTransportException::CORRUPTED_DATA,
+                                "Error while zlib deflateReset");
+    }
+
+    uint32_t bound = static_cast<uint32_t>(deflateBound(&deflate_, len));
+    deflate_.next_in = const_cast<Bytef*>(in);
+    deflate_.avail_in = len;
+    deflate_.next_out = out.reserve(bound);
+    deflate_.avail_out = out.capacity();
+    if (deflate(&deflate_, Z_FINISH) != Z_STREAM_END) {
+      throw TTransportException(TTransportException::CORRUPTED_DATA,
+                                "Error while zlib deflate");
+    }
+    out.setSize(static_cast<uint32_t>(deflate_.total_out));
+  }
+
+  void untransform(const uint8_t* in, uint32_t len, THeaderTransformBuffer& out, uint32_t maxLen) {
+    if (!inflateReady_) {
+      if (inflateInit(&inflate_) != Z_OK) {
+        throw TTransportException(TTransportException::CORRUPTED_DATA,
+                                  "Error while zlib inflateInit");
+      }
+      inflateReady_ = true;
+    } else if (inflateReset(&inflate_) != Z_OK) {
+      throw TTransportException(TTransportException::CORRUPTED_DATA,
+                                "Error while zlib inflateReset");
+    }
+
+    inflate_.next_in = const_cast<Bytef*>(in);
+    inflate_.avail_in = len;
+    out.setSize(0);
+    uint64_t guess
+        = (std::max)(static_cast<uint64_t>(out.capacity()), static_cast<uint64_t>(len) * 4);
+    out.reserve(static_cast<uint32_t>((std::min)(guess, static_cast<uint64_t>(maxLen))));
+    while (true) {
+      inflate_.next_out = out.data() + inflate_.total_out;
+      inflate_.avail_out = out.capacity() - static_cast<uint32_t>(inflate_.total_out);
+      int err = inflate(&inflate_, Z_FINISH);
+      if (err == Z_STREAM_END) {
+        break;
+      }
+      if ((err != Z_BUF_ERROR && err != Z_OK) || inflate_.avail_out > 0) {
+        throw TTransportException(TTransportException::CORRUPTED_DATA,
+                                  "Error while zlib inflate");
+      }
+      // Out of room: grow and carry on where inflate stopped.
+      checkedSize(static_cast<uint64_t>(out.capacity()) + 1, maxLen, "zlib");
+      out.setSize(static_cast<uint32_t>(inflate_.total_out));
+      uint64_t grown = static_cast<uint64_t>(out.capacity()) * 2;
+      out.reserve(static_cast<uint32_t>((std::min)(grown, static_cast<uint64_t>(maxLen))));
+    }
+    out.setSize(static_cast<uint32_t>(inflate_.total_out));
+  }
+
+private:
+  int level_;
+  bool deflateReady_;
+  bool inflateReady_;
+  z_stream deflate_;
+  z_stream inflate_;
+};
+
+class ZlibTransformFactory : public THeaderTransformFactory {
+public:
+  explicit ZlibTransformFactory(int level) : level_(level) {}
+
+  shared_ptr<THeaderTransform> newTransform() {
+    return shared_ptr<THeaderTransform>(new ZlibTransform(level_));
+  }
+
+private:
+  int level_;
+};
+
+#ifdef HAVE_LZ4_H
+// LZ4 blocks do not record their decoded size, so frames carry it up front
+// as a 4-byte big-endian integer.
+const uint32_t LZ4_SIZE_BYTES = 4;
+
+class Lz4Transform : public THeaderTransform {
+public:
+  explicit Lz4Transform(int acceleration)
+    : acceleration_(acceleration), state_(new char[LZ4_sizeofState()]) {}
+
+  void transform(const uint8_t* in, uint32_t len, THeaderTransformBuffer& out) {
+    int bound = LZ4_compressBound(static_cast<int>(len));
+    if (bound <= 0) {
+      throw TTransportException(TTransportException::CORRUPTED_DATA,
+                                "Frame too large for lz4");
+    }
+    uint8_t* buf = out.reserve(LZ4_SIZE_BYTES + static_cast<uint32_t>(bound));
+    buf[0] = static_cast<uint8_t>(len >> 24);
+    buf[1] = static_cast<uint8_t>(len >> 16);
+    buf[2] = static_cast<uint8_t>(len >> 8);
+    buf[3] = static_cast<uint8_t>(len);
+    int written = LZ4_compress_fast_extState(state_.get(),
+                                             reinterpret_cast<const char*>(in),
+                                             reinterpret_cast<char*>(buf + LZ4_SIZE_BYTES),
+                                             static_cast<int>(len),
+                                             bound,
+                                             acceleration_);
+    if (written <= 0) {
+      throw TTransportException(TTransportException::CORRUPTED_DATA, "Error while lz4 compress");
+    }
+    out.setSize(LZ4_SIZE_BYTES + static_cast<uint32_t>(written));
+  }
+
+  void untransform(const uint8_t* in, uint32_t len, THeaderTransformBuffer& out, uint32_t maxLen) {
+    if (len < LZ4_SIZE_BYTES) {
+      throw TTransportException(TTransportException::CORRUPTED_DATA, "Truncated lz4 frame");
+    }
+    uint32_t size = (static_cast<uint32_t>(in[0]) << 24) | (static_cast<uint32_t>(in[1]) << 16)
+                    | (static_cast<uint32_t>(in[2]) << 8) | static_cast<uint32_t>(in[3]);
+    checkedSize(size, (std::min)(maxLen, static_cast<uint32_t>(LZ4_MAX_INPUT_SIZE)), "lz4");
+    out.setSize(0);
+    uint8_t* buf = out.reserve(size);
+    int decoded = LZ4_decompress_safe(reinterpret_cast<const char*>(in + LZ4_SIZE_BYTES),
+                                      reinterpret_cast<char*>(buf),
+                                      static_cast<int>(len - LZ4_SIZE_BYTES),
+                                      static_cast<int>(size));
+    if (decoded < 0 || static_cast<uint32_t>(decoded) != size) {
+      throw TTransportException(TTransportException::CORRUPTED_DATA,
+                                "Error while lz4 decompress");
+    }
+    out.setSize(size);
+  }
+
+private:
+  int acceleration_;
+  boost::scoped_array<char> state_;
+};
+
+class Lz4TransformFactory : public THeaderTransformFactory {
+public:
+  explicit Lz4TransformFactory(int acceleration) : acceleration_(acceleration) {}
+
+  shared_ptr<THeaderTransform> newTransform() {
+    return shared_ptr<THeaderTransform>(new Lz4Transform(acceleration_));
+  }
+
+private:
+  int acceleration_;
+};
+#endif // HAVE_LZ4_H
+
+#ifdef HAVE_ZSTD_H
+/**
+ * Compression and decompression contexts live as long as the transform;
+ * digested dictionaries are shared by every transform of a factory.
+ */
+class ZstdTransform : public THeaderTransform {
+public:
+  ZstdTransform(int level, shared_ptr<ZSTD_CDict> cdict, shared_ptr<ZSTD_DDict> ddict)
+    : level_(level), cdict_(cdict), ddict_(ddict), cctx_(NULL), dctx_(NULL) {}
+
+  ~ZstdTransform() {
+    if (cctx_ != NULL) {
+      ZSTD_freeCCtx(cctx_);
+    }
+    if (dctx_ != NULL) {
+      ZSTD_freeDCtx(dctx_);
+    }
+  }
+
+  void transform(const uint8_t* in, uint32_t len, THeaderTransformBuffer& out) {
+    if (cctx_ == NULL && (cctx_ = ZSTD_createCCtx()) == NULL) {
+      throw TTransportException(TTransportException::CORRUPTED_DATA,
+                                "Error while zstd createCCtx");
+    }
+    size_t bound = ZSTD_compressBound(len);
+    uint8_t* buf = out.reserve(static_cast<uint32_t>(bound));
+    size_t written = cdict_ ? ZSTD_compress_usingCDict(cctx_, buf, bound, in, len, cdict_.get())
+                            : ZSTD_compressCCtx(cctx_, buf, bound, in, len, level_);
+    if (ZSTD_isError(written)) {
+      throw TTransportException(TTransportException::CORRUPTED_DATA,
+                                std::string("Error while zstd compress: ")
+                                    + ZSTD_getErrorName(written));
+    }
+    out.setSize(static_cast<uint32_t>(written));
+  }
+
+  void untransform(const uint8_t* in, uint32_t len, THeaderTransformBuffer& out, uint32_t maxLen) {
+    if (dctx_ == NULL && (dctx_ = ZSTD_createDCtx()) == NULL) {
+      throw TTransportException(TTransportException::CORRUPTED_DATA,
+                                "Error while zstd createDCtx");
+    }
+    unsigned long long size = ZSTD_getFrameContentSize(in, len);
+    if (size == ZSTD_CONTENTSIZE_UNKNOWN || size == ZSTD_CONTENTSIZE_ERROR) {
+      throw TTransportException(TTransportException::CORRUPTED_DATA,
+                                "Invalid zstd frame header");
+    }
+    checkedSize(size, maxLen, "zstd");
+    out.setSize(0);
+    uint8_t* buf = out.reserve(static_cast<uint32_t>(size));
+    size_t decoded = ddict_ ? ZSTD_decompress_usingDDict(dctx_, buf, size, in, len, ddict_.get())
+                         : ZSTD_decompressDCtx(dctx_, buf, size, in, len);
+    if (ZSTD_isError(decoded) || decoded != size) {
+      throw TTransportException(TTransportException::CORRUPTED_DATA,
+                                "Error while zstd decompress");
+    }
+    out.setSize(static_cast<uint32_t>(size));
+  }
+
+private:
+  int level_;
+  shared_ptr<ZSTD_CDict> cdict_;
+  shared_ptr<ZSTD_DDict> ddict_;
+  ZSTD_CCtx* cctx_;
+  ZSTD_DCtx* dctx_;
+};
+
+class ZstdTransformFactory : public THeaderTransformFactory {
+public:
+  ZstdTransformFactory(int level, const std::string& dictionary) : level_(level) {
+    if (!dictionary.empty()) {
+      cdict_.reset(ZSTD_createCDict(dictionary.data(), dictionary.size(), level),
+                   ZSTD_freeCDict);
+      ddict_.reset(ZSTD_createDDict(dictionary.data(), dictionary.size()), ZSTD_freeDDict);
+      if (!cdict_ || !ddict_) {
+        throw TTransportException(TTransportException::BAD_ARGS, "Invalid zstd dictionary");
+      }
+    }
+  }
+
+  shared_ptr<THeaderTransform> newTransform() {
+    return shared_ptr<THeaderTransform>(new ZstdTransform(level_, cdict_, ddict_));
+  }
+
+private:
+  int level_;
+  shared_ptr<ZSTD_CDict> cdict_;
+  shared_ptr<ZSTD_DDict> ddict_;
+};
+#endif // HAVE_ZSTD_H
+
+#ifdef HAVE_SNAPPY_C_H
+/**
+ * Snappy keeps no state between calls.
+ */
+class SnappyTransform : public THeaderTransform {
+public:
+  void transform(const uint8_t* in, uint32_t len, THeaderTransformBuffer& out) {
+    size_t written = snappy_max_compressed_length(len);
+    uint8_t* buf = out.reserve(static_cast<uint32_t>(written));
+    if (snappy_compress(reinterpret_cast<const char*>(in),
+                        len,
+                        reinterpret_cast<char*>(buf),
+                        &written) != SNAPPY_OK) {
+      throw TTransportException(TTransportException::CORRUPTED_DATA,
+                                "Error while snappy compress");
+    }
+    out.setSize(static_cast<uint32_t>(written));
+  }
+
+  void untransform(const uint8_t* in, uint32_t len, THeaderTransformBuffer& out, uint32_t maxLen) {
+    size_t size;
+    if (snappy_uncompressed_length(reinterpret_cast<const char*>(in), len, &size) != SNAPPY_OK) {
+      throw TTransportException(TTransportException::CORRUPTED_DATA, "Invalid snappy frame");
+    }
+    checkedSize(size, maxLen, "snappy");
+    out.setSize(0);
+    uint8_t* buf = out.reserve(static_cast<uint32_t>(size));
+    if (snappy_uncompress(reinterpret_cast<const char*>(in),
+                          len,
+                          reinterpret_cast<char*>(buf),
+                          &size) != SNAPPY_OK) {
+      throw TTransportException(TTransportException::CORRUPTED_DATA,
+                                "Error while snappy uncompress");
+    }
+    out.setSize(static_cast<uint32_t>(size));
+  }
+};
+
+class SnappyTransformFactory : public THeaderTransformFactory {
+public:
+  shared_ptr<THeaderTransform> newTransform() {
+    return shared_ptr<THeaderTransform>(new SnappyTransform);
+  }
+};
+#endif // HAVE_SNAPPY_C_H
+
+void notCompiledIn(const char* codec) {
+  throw TTransportException(TTransportException::INTERNAL_ERROR,
+                            std::string("Thrift was built without ") + codec + " support");
+}
+}
+
+shared_ptr<THeaderTransformFactory> newZlibTransformFactory(int level) {
+  return shared_ptr<THeaderTransformFactory>(new ZlibTransformFactory(level));
+}
+
+shared_ptr<THeaderTransformFactory> newLz4TransformFactory(int acceleration) {
+#ifdef HAVE_LZ4_H
+  return shared_ptr<THeaderTransformFactory>(new Lz4TransformFactory(acceleration));
+#else
+  THRIFT_UNUSED_VARIABLE(acceleration);
+  notCompiledIn("lz4");
+  return shared_ptr<THeaderTransformFactory>();
+#endif
+}
+
+shared_ptr<THeaderTransformFactory> newZstdTransformFactory(int level,
+                                                            const std::string& dictionary) {
+#ifdef HAVE_ZSTD_H
+  return shared_ptr<THeaderTransformFactory>(new ZstdTransformFactory(level, dictionary));
+#else
+  THRIFT_UNUSED_VARIABLE(level);
+  THRIFT_UNUSED_VARIABLE(dictionary);
+  notCompiledIn("zstd");
+  return shared_ptr<THeaderTransformFactory>();
+#endif
+}
+
+shared_ptr<THeaderTransformFactory> newSnappyTransformFactory() {
+#ifdef HAVE_SNAPPY_C_H
+  return shared_ptr<THeaderTransformFactory>(new SnappyTransformFactory);
+#else
+  notCompiledIn("snappy");
+  return shared_ptr<THeaderTransformFactory>();
+#endif
+}
+}
+}
+} // apache::thrift::transport
@@ -0,0 +1,125 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#ifndef THRIFT_TRANSPORT_THEADERTRANSFORM_H_
+#define THRIFT_TRANSPORT_THEADERTRANSFORM_H_ 1
+
+#include <string>
+
+#include <boost/scoped_array.hpp>
+#include <thrift/Thrift.h>
+#include <thrift/stdcxx.h>
+
+namespace apache {
+namespace thrift {
+namespace transport {
+
+/**
+ * Output buffer for header transforms.  It keeps its storage from frame to
+ * frame, so a connection in steady state does not allocate.
+ */
+class THeaderTransformBuffer {
+public:
+  THeaderTransformBuffer() : size_(0), capacity_(0) {}
+
+  uint8_t* data() const { return buf_.get(); }
+
+  uint32_t size() const { return size_; }
+
+  uint32_t capacity() const { return capacity_; }
+
+  /**
+   * Makes room for at least len bytes, keeping the first size() bytes, and
+   * returns the start of the buffer.
+   */
+  uint8_t* reserve(uint32_t len);
+
+  void setSize(uint32_t len) { size_ = len; }
+
+  /**
+   * Exchanges the storage with an external buffer of the given capacity.
+   * The buffer is left empty.
+   */
+  void swap(boost::scoped_array<uint8_t>& buf, uint32_t& capacity);
+
+private:
+  boost::scoped_array<uint8_t> buf_;
+  uint32_t size_;
+  uint32_t capacity_;
+};
+
+/**
+ * A transform of THeaderTransport frame data, usually a compression codec.
+ * Every transport creates its own instances, so a transform may keep state
+ * such as compression contexts from one frame to the next.
+ */
+class THeaderTransform {
+public:
+  virtual ~THeaderTransform() {}
+
+  /**
+   * Encodes len bytes at in, replacing the contents of out.
+   */
+  virtual void transform(const uint8_t* in, uint32_t len, THeaderTransformBuffer& out) = 0;
+
+  /**
+   * Decodes len bytes at in, replacing the contents of out.
+   *
+   * @throws TTransportException CORRUPTED_DATA if the data cannot be decoded
+   *         or decodes to more than maxLen bytes
+   */
+  virtual void untransform(const uint8_t* in,
+                           uint32_t len,
+                           THeaderTransformBuffer& out,
+                           uint32_t maxLen) = 0;
+};
+
+/**
+ * Creates the transform instances of one transform id.
+ */
+class THeaderTransformFactory {
+public:
+  virtual ~THeaderTransformFactory() {}
+
+  virtual stdcxx::shared_ptr<THeaderTransform> newTransform() = 0;
+};
+
+/**
+ * Factories for the built-in codecs.  Codecs whose library was not found at
+ * build time throw TTransportException INTERNAL_ERROR.
+ */
+stdcxx::shared_ptr<THeaderTransformFactory> newZlibTransformFactory(int level = -1);
+
+stdcxx::shared_ptr<THeaderTransformFactory> newLz4TransformFactory(int acceleration = 1);
+
+/**
+ * With a non-empty dictionary every connection compresses against the same
+ * pre-digested dictionary, which helps small messages a lot.  Both ends must
+ * register the same dictionary.
+ */
+stdcxx::shared_ptr<THeaderTransformFactory> newZstdTransformFactory(
+    int level = 1,
+    const std::string& dictionary = std::string());
+
+stdcxx::shared_ptr<THeaderTransformFactory> newSnappyTransformFactory();
+}
+}
+} // apache::thrift::transport
+
+#endif // #ifndef THRIFT_TRANSPORT_THEADERTRANSFORM_H_
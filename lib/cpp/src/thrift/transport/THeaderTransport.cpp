@@ -17,18 +17,22 @@
  * under the License.
  */
 
+#include <thrift/thrift-config.h>
+
 #include <thrift/transport/THeaderTransport.h>
 #include <thrift/TApplicationException.h>
+#include <thrift/concurrency/Mutex.h>
+#include <thrift/concurrency/Util.h>
 #include <thrift/protocol/TProtocolTypes.h>
 #include <thrift/protocol/TBinaryProtocol.h>
 #include <thrift/protocol/TCompactProtocol.h>
 #include <thrift/stdcxx.h>
 
+#include <algorithm>
 #include <limits>
 #include <utility>
 #include <string>
 #include <string.h>
-#include <zlib.h>
 
 using std::map;
 using std::string;
@@ -63,9 +67,9 @@ uint16_t THeaderTransport::getProtocolId() const {
 }
 
 void THeaderTransport::ensureReadBuffer(uint32_t sz) {
-  if (sz > rBufSize_) {
-    rBuf_.reset(new uint8_t[sz]);
-    rBufSize_ = sz;
+  if (releaseFrame() || sz > rBufSize_) {
+    rBufSize_ = (std::max)(sz, rBufSize_);
+    rBuf_.reset(new uint8_t[rBufSize_]);
   }
 }
 
@@ -261,48 +265,84 @@ void THeaderTransport::readHeaderFormat(uint16_t headerSize, uint32_t sz) {
   untransform(data, safe_numeric_cast<uint32_t>(static_cast<ptrdiff_t>(sz) - (data - rBuf_.get())));
 }
 
-void THeaderTransport::untransform(uint8_t* ptr, uint32_t sz) {
-  // Update the transform buffer size if needed
-  resizeTransformBuffer();
+namespace {
+const int64_t NS_PER_S = 1000000000LL;
 
-  for (vector<uint16_t>::const_iterator it = readTrans_.begin(); it != readTrans_.end(); ++it) {
-    const uint16_t transId = *it;
+typedef std::map<uint16_t, shared_ptr<THeaderTransformFactory> > TransformRegistry;
 
-    if (transId == ZLIB_TRANSFORM) {
-      z_stream stream;
-      int err;
+concurrency::Mutex& transformRegistryMutex() {
+  static concurrency::Mutex mutex;
+  return mutex;
+}
 
-      stream.next_in = ptr;
-      stream.avail_in = sz;
+TransformRegistry& transformRegistry() {
+  static TransformRegistry registry;
+  if (registry.empty()) {
+    registry[THeaderTransport::ZLIB_TRANSFORM] = newZlibTransformFactory();
+#ifdef HAVE_LZ4_H
+    registry[THeaderTransport::LZ4_TRANSFORM] = newLz4TransformFactory();
+#endif
+#ifdef HAVE_ZSTD_H
+    registry[THeaderTransport::ZSTD_TRANSFORM] = newZstdTransformFactory();
+#endif
+#ifdef HAVE_SNAPPY_C_H
+    registry[THeaderTransport::SNAPPY_TRANSFORM] = newSnappyTransformFactory();
+#endif
+  }
+  return registry;
+}
+}
 
-      // Setting these to 0 means use the default free/alloc functions
-      stream.zalloc = (alloc_func)0;
-      stream.zfree = (free_func)0;
-      stream.opaque = (voidpf)0;
-      err = inflateInit(&stream);
-      if (err != Z_OK) {
-        throw TApplicationException(TApplicationException::MISSING_RESULT,
-                                    "Error while zlib deflateInit");
-      }
-      stream.next_out = tBuf_.get();
-      stream.avail_out = tBufSize_;
-      err = inflate(&stream, Z_FINISH);
-      if (err != Z_STREAM_END || stream.avail_out == 0) {
-        throw TApplicationException(TApplicationException::MISSING_RESULT,
-                                    "Error while zlib deflate");
-      }
-      sz = stream.total_out;
+void THeaderTransport::registerTransform(uint16_t transId,
+                                         shared_ptr<THeaderTransformFactory> factory) {
+  if (!factory) {
+    throw std::invalid_argument("factory is empty");
+  }
+  concurrency::Guard g(transformRegistryMutex());
+  transformRegistry()[transId] = factory;
+}
 
-      err = inflateEnd(&stream);
-      if (err != Z_OK) {
-        throw TApplicationException(TApplicationException::MISSING_RESULT,
-                                    "Error while zlib deflateEnd");
-      }
+bool THeaderTransport::isTransformRegistered(uint16_t transId) {
+  concurrency::Guard g(transformRegistryMutex());
+  return transformRegistry().count(transId) > 0;
+}
 
-      memcpy(ptr, tBuf_.get(), sz);
-    } else {
+THeaderTransform* THeaderTransport::getTransform(uint16_t transId) {
+  map<uint16_t, shared_ptr<THeaderTransform> >::const_iterator it = transforms_.find(transId);
+  if (it != transforms_.end()) {
+    return it->second.get();
+  }
+
+  shared_ptr<THeaderTransformFactory> factory;
+  {
+    concurrency::Guard g(transformRegistryMutex());
+    TransformRegistry& registry = transformRegistry();
+    TransformRegistry::const_iterator found = registry.find(transId);
+    if (found == registry.end()) {
+      return NULL;
+    }
+    factory = found->second;
+  }
+  shared_ptr<THeaderTransform> transform = factory->newTransform();
+  transforms_[transId] = transform;
+  return transform.get();
+}
+
+void THeaderTransport::untransform(uint8_t* ptr, uint32_t sz) {
+  THeaderTransformBuffer* out = NULL;
+
+  // Transforms are listed in the order they were applied; undo the last first.
+  for (vector<uint16_t>::const_reverse_iterator it = readTrans_.rbegin(); it != readTrans_.rend();
+       ++it) {
+    THeaderTransform* transform = getTransform(*it);
+    if (transform == NULL) {
       throw TApplicationException(TApplicationException::MISSING_RESULT, "Unknown transform");
     }
+
+    out = (out == &rTransBufs_[0]) ? &rTransBufs_[1] : &rTransBufs_[0];
+    transform->untransform(ptr, sz, *out, maxFrameSize_);
+    ptr = out->data();
+    sz = out->size();
   }
 
   setReadBuffer(ptr, sz);
@@ -312,8 +352,8 @@ void THeaderTransport::untransform(uint8_t* ptr, uint32_t sz) {
  * We may have updated the wBuf size, update the tBuf size to match.
  * Should be called in transform.
  *
- * The buffer should be slightly larger than write buffer size due to
- * compression transforms (that may slightly grow on small frame sizes)
+ * The buffer should be slightly larger than write buffer size so that the
+ * header fits in front of a full write buffer.
  */
 void THeaderTransport::resizeTransformBuffer(uint32_t additionalSize) {
   if (tBufSize_ < wBufSize_ + DEFAULT_BUFFER_SIZE) {
@@ -325,51 +365,62 @@ void THeaderTransport::resizeTransformBuffer(uint32_t additionalSize) {
 }
 
 void THeaderTransport::transform(uint8_t* ptr, uint32_t sz) {
-  // Update the transform buffer size if needed
-  resizeTransformBuffer();
-
   for (vector<uint16_t>::const_iterator it = writeTrans_.begin(); it != writeTrans_.end(); ++it) {
-    const uint16_t transId = *it;
+    THeaderTransform* transform = getTransform(*it);
+    if (transform == NULL) {
+      throw TTransportException(TTransportException::CORRUPTED_DATA, "Unknown transform");
+    }
 
-    if (transId == ZLIB_TRANSFORM) {
-      z_stream stream;
-      int err;
+    transform->transform(ptr, sz, wTransBuf_);
+    sz = wTransBuf_.size();
+    // The output becomes the write buffer and the old write buffer is kept
+    // for the next transform.
+    wTransBuf_.swap(wBuf_, wBufSize_);
+    ptr = wBuf_.get();
+  }
 
-      stream.next_in = ptr;
-      stream.avail_in = sz;
+  setWriteBuffer(wBuf_.get(), wBufSize_);
+  wBase_ = wBuf_.get() + sz;
 
-      stream.zalloc = (alloc_func)0;
-      stream.zfree = (free_func)0;
-      stream.opaque = (voidpf)0;
-      err = deflateInit(&stream, Z_DEFAULT_COMPRESSION);
-      if (err != Z_OK) {
-        throw TTransportException(TTransportException::CORRUPTED_DATA,
-                                  "Error while zlib deflateInit");
-      }
-      uint32_t tbuf_size = 0;
-      while (err == Z_OK) {
-        resizeTransformBuffer(tbuf_size);
-
-        stream.next_out = tBuf_.get();
-        stream.avail_out = tBufSize_;
-        err = deflate(&stream, Z_FINISH);
-        tbuf_size += DEFAULT_BUFFER_SIZE;
-      }
-      sz = stream.total_out;
+  // Update the transform buffer size if needed
+  resizeTransformBuffer();
+}
 
-      err = deflateEnd(&stream);
-      if (err != Z_OK) {
-        throw TTransportException(TTransportException::CORRUPTED_DATA,
-                                  "Error while zlib deflateEnd");
-      }
+void THeaderTransport::compressFrame(uint32_t sz) {
+  compressionStats_.frames++;
+  compressionStats_.bytesIn += sz;
 
-      memcpy(ptr, tBuf_.get(), sz);
-    } else {
+  uint16_t transId = 0;
+  if (sz < compressionPolicy_->getMinSize()) {
+    compressionStats_.skippedSmall++;
+  } else if ((transId = compressionPolicy_->select(sz)) == 0) {
+    compressionStats_.skippedByPolicy++;
+  } else {
+    THeaderTransform* transform = getTransform(transId);
+    if (transform == NULL) {
       throw TTransportException(TTransportException::CORRUPTED_DATA, "Unknown transform");
     }
+
+    int64_t start = concurrency::Util::currentTimeTicks(NS_PER_S);
+    transform->transform(wBuf_.get(), sz, wTransBuf_);
+    int64_t nanos = concurrency::Util::currentTimeTicks(NS_PER_S) - start;
+    compressionStats_.compressNanos += nanos;
+    compressionPolicy_->record(transId, sz, wTransBuf_.size(), nanos);
+
+    if (wTransBuf_.size() < sz) {
+      sz = wTransBuf_.size();
+      wTransBuf_.swap(wBuf_, wBufSize_);
+      setWriteBuffer(wBuf_.get(), wBufSize_);
+      wBase_ = wBuf_.get() + sz;
+      resizeTransformBuffer();
+      frameCodec_ = transId;
+      compressionStats_.compressedFrames++;
+    } else {
+      compressionStats_.incompressible++;
+    }
   }
 
-  wBase_ = wBuf_.get() + sz;
+  compressionStats_.bytesOut += sz;
 }
 
 void THeaderTransport::resetProtocol() {
@@ -415,13 +466,37 @@ void THeaderTransport::clearHeaders() {
   writeHeaders_.clear();
 }
 
+void THeaderTransport::beginFrame(uint32_t size) {
+  uint32_t have = getWriteBytes();
+  if (static_cast<uint64_t>(have) + size <= wBufSize_) {
+    return;
+  }
+  if (static_cast<uint64_t>(have) + size > 0x7fffffff) {
+    throw TTransportException(TTransportException::BAD_ARGS,
+                              "Attempted to write over 2 GB to THeaderTransport.");
+  }
+
+  uint32_t new_size = have + size;
+  uint8_t* new_buf = new uint8_t[new_size];
+  memcpy(new_buf, wBuf_.get(), have);
+  wBuf_.reset(new_buf);
+  wBufSize_ = new_size;
+  setWriteBuffer(wBuf_.get(), wBufSize_);
+  wBase_ = wBuf_.get() + have;
+  resizeTransformBuffer();
+}
+
 void THeaderTransport::flush() {
   // Write out any data waiting in the write buffer.
   uint32_t haveBytes = getWriteBytes();
 
   if (clientType == THRIFT_HEADER_CLIENT_TYPE) {
     transform(wBuf_.get(), haveBytes);
-    haveBytes = getWriteBytes(); // transform may have changed the size
+    frameCodec_ = 0;
+    if (compressionPolicy_) {
+      compressFrame(getWriteBytes());
+    }
+    haveBytes = getWriteBytes(); // transforms may have changed the size
   }
 
   // Note that we reset wBase_ prior to the underlying write
@@ -437,7 +512,8 @@ void THeaderTransport::flush() {
   if (clientType == THRIFT_HEADER_CLIENT_TYPE) {
     // header size will need to be updated at the end because of varints.
     // Make it big enough here for max varint size, plus 4 for padding.
-    uint32_t headerSize = (2 + getNumTransforms()) * THRIFT_MAX_VARINT32_BYTES + 4;
+    uint16_t numTransforms = static_cast<uint16_t>(getNumTransforms() + (frameCodec_ != 0 ? 1 : 0));
+    uint32_t headerSize = (2 + numTransforms) * THRIFT_MAX_VARINT32_BYTES + 4;
     // add approximate size of info headers
     headerSize += getMaxWriteHeadersSize();
 
@@ -475,12 +551,15 @@ void THeaderTransport::flush() {
     headerStart = pkt;
 
     pkt += writeVarint32(protoId, pkt);
-    pkt += writeVarint32(getNumTransforms(), pkt);
+    pkt += writeVarint32(numTransforms, pkt);
 
     // For now, each transform is only the ID, no following data.
     for (vector<uint16_t>::const_iterator it = writeTrans_.begin(); it != writeTrans_.end(); ++it) {
       pkt += writeVarint32(*it, pkt);
     }
+    if (frameCodec_ != 0) {
+      pkt += writeVarint32(frameCodec_, pkt);
+    }
 
     // write info headers
 
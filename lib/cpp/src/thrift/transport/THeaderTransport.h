@@ -38,6 +38,8 @@
 
 #include <thrift/protocol/TProtocolTypes.h>
 #include <thrift/transport/TBufferTransports.h>
+#include <thrift/transport/THeaderCompressionPolicy.h>
+#include <thrift/transport/THeaderTransform.h>
 #include <thrift/transport/TTransport.h>
 #include <thrift/transport/TVirtualTransport.h>
 
@@ -68,6 +70,10 @@ using apache::thrift::protocol::T_COMPACT_PROTOCOL;
  * Header Transport *must* be the same transport for both input and
  * output when used on the server side - client responses should be
  * the same protocol as those in the request.
+ *
+ * Transforms are looked up by id in a process-wide registry; each transport
+ * creates its own instance of every transform it uses and keeps it, along
+ * with the transform buffers, for the life of the connection.
  */
 class THeaderTransport : public TVirtualTransport<THeaderTransport, TFramedTransport> {
 public:
@@ -83,7 +89,8 @@ public:
       seqId(0),
       flags(0),
       tBufSize_(0),
-      tBuf_(NULL) {
+      tBuf_(NULL),
+      frameCodec_(0) {
     if (!transport_) throw std::invalid_argument("transport is empty");
     initBuffers();
   }
@@ -97,7 +104,8 @@ public:
       seqId(0),
       flags(0),
       tBufSize_(0),
-      tBuf_(NULL) {
+      tBuf_(NULL),
+      frameCodec_(0) {
     if (!transport_) throw std::invalid_argument("inTransport is empty");
     if (!outTransport_) throw std::invalid_argument("outTransport is empty");
     initBuffers();
@@ -106,6 +114,12 @@ public:
   virtual uint32_t readSlow(uint8_t* buf, uint32_t len);
   virtual void flush();
 
+  /**
+   * Only makes room for size more bytes.  The headers are written by
+   * flush(), after the transforms.
+   */
+  virtual void beginFrame(uint32_t size);
+
   void resizeTransformBuffer(uint32_t additionalSize = 0);
 
   uint16_t getProtocolId() const;
@@ -134,7 +148,7 @@ public:
   /**
    * Transform the data based on our write transform flags
    * At conclusion of function the write buffer is set to the
-   * transformed data.
+   * transformed data, which may have moved to a different buffer.
    *
    * @param ptr Ptr to data to transform
    * @param sz Size of data buffer
@@ -147,6 +161,24 @@ public:
 
   void setTransform(uint16_t transId) { writeTrans_.push_back(transId); }
 
+  /**
+   * Lets policy pick a compression codec for every frame written from now
+   * on.  The codec is applied after the transforms set with setTransform().
+   * Frames that do not get smaller are sent uncompressed.  NULL turns
+   * per-frame compression off again.
+   */
+  void setCompressionPolicy(stdcxx::shared_ptr<THeaderCompressionPolicy> policy) {
+    compressionPolicy_ = policy;
+  }
+
+  stdcxx::shared_ptr<THeaderCompressionPolicy> getCompressionPolicy() const {
+    return compressionPolicy_;
+  }
+
+  const THeaderCompressionStats& getCompressionStats() const { return compressionStats_; }
+
+  void resetCompressionStats() { compressionStats_ = THeaderCompressionStats(); }
+
   // Info headers
 
   typedef std::map<std::string, std::string> StringToStringMap;
@@ -165,10 +197,29 @@ public:
   int32_t getSequenceNumber() const { return seqId; }
   void setSequenceNumber(int32_t seqId) { this->seqId = seqId; }
 
+  // Ids 0x02 and 0x04 are taken by transforms of other implementations
+  // that this one does not support.
   enum TRANSFORMS {
     ZLIB_TRANSFORM = 0x01,
+    SNAPPY_TRANSFORM = 0x03,
+    ZSTD_TRANSFORM = 0x05,
+    LZ4_TRANSFORM = 0x06,
   };
 
+  /**
+   * Makes transform id available to every THeaderTransport created from now
+   * on, replacing any earlier registration of the id.  zlib is always
+   * registered; lz4, zstd and snappy are when Thrift was built with them.
+   * Register a codec again to change its settings, e.g. a zstd dictionary.
+   */
+  static void registerTransform(uint16_t transId,
+                                stdcxx::shared_ptr<THeaderTransformFactory> factory);
+
+  /**
+   * Returns whether transform id is registered.
+   */
+  static bool isTransformRegistered(uint16_t transId);
+
 protected:
   /**
    * Reads a frame of input from the underlying stream.
@@ -178,6 +229,12 @@ protected:
    */
   virtual bool readFrame();
 
+  /**
+   * flush() transforms the whole write buffer in place, so referenced
+   * buffers are always copied in.
+   */
+  virtual void writeRefSlow(const uint8_t* buf, uint32_t len) { write(buf, len); }
+
   void ensureReadBuffer(uint32_t sz);
   uint32_t getWriteBytes();
 
@@ -220,10 +277,33 @@ protected:
     };
   };
 
-  // Buffers to use for transform processing
+  // Buffer the header is assembled in
   uint32_t tBufSize_;
   boost::scoped_array<uint8_t> tBuf_;
 
+  /**
+   * Returns this transport's instance of transform id, or NULL if the id is
+   * not registered.
+   */
+  THeaderTransform* getTransform(uint16_t transId);
+
+  std::map<uint16_t, stdcxx::shared_ptr<THeaderTransform> > transforms_;
+
+  // Transform output; written data is swapped into wBuf_, read data stays
+  // here, alternating between the two buffers when transforms are chained.
+  THeaderTransformBuffer wTransBuf_;
+  THeaderTransformBuffer rTransBufs_[2];
+
+  /**
+   * Compresses the sz bytes of the write buffer as the compression policy
+   * says, and sets frameCodec_ to the codec used.
+   */
+  void compressFrame(uint32_t sz);
+
+  stdcxx::shared_ptr<THeaderCompressionPolicy> compressionPolicy_;
+  THeaderCompressionStats compressionStats_;
+  uint16_t frameCodec_; // codec the policy applied to the frame being sent, or 0
+
   void readString(uint8_t*& ptr, /* out */ std::string& str, uint8_t const* headerBoundary);
 
   void writeString(uint8_t*& ptr, const std::string& str);
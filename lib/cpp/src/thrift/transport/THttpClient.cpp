@@ -35,13 +35,14 @@ namespace transport {
 THttpClient::THttpClient(stdcxx::shared_ptr<TTransport> transport,
                          std::string host,
                          std::string path)
-  : THttpTransport(transport), host_(host), path_(path) {
+  : THttpTransport(transport), host_(host), path_(path), keepAlive_(true) {
 }
 
 THttpClient::THttpClient(string host, int port, string path)
   : THttpTransport(stdcxx::shared_ptr<TTransport>(new TSocket(host, port))),
     host_(host),
-    path_(path) {
+    path_(path),
+    keepAlive_(true) {
 }
 
 THttpClient::~THttpClient() {
@@ -61,6 +62,12 @@ void THttpClient::parseHeader(char* header) {
   } else if (boost::istarts_with(header, "Content-Length")) {
     chunked_ = false;
     contentLength_ = atoi(value);
+  } else if (boost::istarts_with(header, "Connection")) {
+    if (boost::icontains(value, "close")) {
+      keepAlive_ = false;
+    } else if (boost::icontains(value, "keep-alive")) {
+      keepAlive_ = true;
+    }
   }
 }
 
@@ -76,6 +83,9 @@ bool THttpClient::parseStatusLine(char* status) {
   while (*(code++) == ' ') {
   };
 
+  // HTTP/1.1 connections stay open unless the server says otherwise.
+  keepAlive_ = strcmp(http, "HTTP/1.0") != 0;
+
   char* msg = strchr(code, ' ');
   if (msg == NULL) {
     throw TTransportException(string("Bad Status: ") + status);
@@ -94,6 +104,19 @@ bool THttpClient::parseStatusLine(char* status) {
 }
 
 void THttpClient::flush() {
+  // Reuse the connection unless the server closes it, or the last response
+  // was not read to its end and the connection is out of step.
+  if (!keepAlive_ || bodyLeft_ > 0 || (chunked_ && !chunkedDone_)) {
+    transport_->close();
+    transport_->open();
+    httpPos_ = 0;
+    httpBufLen_ = 0;
+    httpBuf_[0] = '\0';
+    bodyLeft_ = 0;
+    chunked_ = false;
+    keepAlive_ = true;
+  }
+
   // Fetch the contents of the write buffer
   uint8_t* buf;
   uint32_t len;
@@ -40,6 +40,9 @@ protected:
   std::string host_;
   std::string path_;
 
+  /// Whether the server keeps the connection open after its last response
+  bool keepAlive_;
+
   virtual void parseHeader(char* header);
   virtual bool parseStatusLine(char* status);
 };
@@ -17,6 +17,8 @@
  * under the License.
  */
 
+#include <algorithm>
+#include <cstring>
 #include <sstream>
 
 #include <thrift/transport/THttpTransport.h>
@@ -37,8 +39,9 @@ THttpTransport::THttpTransport(stdcxx::shared_ptr<TTransport> transport)
     readHeaders_(true),
     chunked_(false),
     chunkedDone_(false),
-    chunkSize_(0),
     contentLength_(0),
+    bodyLeft_(0),
+    inChunk_(false),
     httpBuf_(NULL),
     httpPos_(0),
     httpBufLen_(0),
@@ -61,60 +64,99 @@ THttpTransport::~THttpTransport() {
 }
 
 uint32_t THttpTransport::read(uint8_t* buf, uint32_t len) {
-  if (readBuffer_.available_read() == 0) {
-    readBuffer_.resetBuffer();
-    uint32_t got = readMoreData();
-    if (got == 0) {
-      return 0;
+  uint32_t left = readMoreData();
+  if (left == 0) {
+    return 0;
+  }
+  uint32_t give = (std::min)(len, left);
+
+  if (httpPos_ == httpBufLen_) {
+    if (give >= httpBufSize_) {
+      // Nothing is buffered and the caller wants more than the buffer holds:
+      // read straight into the caller's memory.
+      uint32_t got = transport_->read(buf, give);
+      if (got == 0) {
+        throw TTransportException(TTransportException::END_OF_FILE, "Could not read body");
+      }
+      bodyLeft_ -= got;
+      return got;
     }
+    refill();
   }
-  return readBuffer_.read(buf, len);
+
+  give = (std::min)(give, httpBufLen_ - httpPos_);
+  std::memcpy(buf, httpBuf_ + httpPos_, give);
+  httpPos_ += give;
+  bodyLeft_ -= give;
+  return give;
 }
 
 uint32_t THttpTransport::readEnd() {
-  // Read any pending chunked data (footers etc.)
+  // Skip whatever the reader left of the body, so that the next message on
+  // the connection is read from its start.
+  skipBody();
   if (chunked_) {
     while (!chunkedDone_) {
-      readChunked();
+      readChunkSize();
+      skipBody();
     }
   }
   return 0;
 }
 
-uint32_t THttpTransport::readMoreData() {
-  uint32_t size;
-
-  // Get more data!
-  refill();
-
-  if (readHeaders_) {
-    readHeaders();
+const uint8_t* THttpTransport::borrow(uint8_t* buf, uint32_t* len) {
+  (void)buf;
+  uint32_t avail = (std::min)(bodyLeft_, httpBufLen_ - httpPos_);
+  if (avail == 0 || avail < *len) {
+    return NULL;
   }
+  *len = avail;
+  return reinterpret_cast<const uint8_t*>(httpBuf_ + httpPos_);
+}
 
-  if (chunked_) {
-    size = readChunked();
-  } else {
-    size = readContent(contentLength_);
-    readHeaders_ = true;
+void THttpTransport::consume(uint32_t len) {
+  if (len > (std::min)(bodyLeft_, httpBufLen_ - httpPos_)) {
+    throw TTransportException(TTransportException::BAD_ARGS, "consume did not follow a borrow.");
   }
+  httpPos_ += len;
+  bodyLeft_ -= len;
+}
 
-  return size;
+uint32_t THttpTransport::readMoreData() {
+  while (bodyLeft_ == 0) {
+    if (readHeaders_) {
+      readHeaders();
+      if (!chunked_) {
+        // The content is the whole message; whatever is read after it
+        // belongs to the next one.
+        bodyLeft_ = contentLength_;
+        readHeaders_ = true;
+        break;
+      }
+    } else if (chunked_ && !chunkedDone_) {
+      readChunkSize();
+    } else {
+      break;
+    }
+  }
+  return bodyLeft_;
 }
 
-uint32_t THttpTransport::readChunked() {
-  uint32_t length = 0;
+void THttpTransport::readChunkSize() {
+  if (inChunk_) {
+    // Trailing CRLF after the data of the previous chunk
+    readLine();
+    inChunk_ = false;
+  }
 
   char* line = readLine();
   uint32_t chunkSize = parseChunkSize(line);
   if (chunkSize == 0) {
     readChunkedFooters();
   } else {
-    // Read data content
-    length += readContent(chunkSize);
-    // Read trailing CRLF after content
-    readLine();
+    bodyLeft_ = chunkSize;
+    inChunk_ = true;
   }
-  return length;
 }
 
 void THttpTransport::readChunkedFooters() {
@@ -138,28 +180,15 @@ uint32_t THttpTransport::parseChunkSize(char* line) {
   return size;
 }
 
-uint32_t THttpTransport::readContent(uint32_t size) {
-  uint32_t need = size;
-  while (need > 0) {
-    uint32_t avail = httpBufLen_ - httpPos_;
-    if (avail == 0) {
-      // We have given all the data, reset position to head of the buffer
-      httpPos_ = 0;
-      httpBufLen_ = 0;
+void THttpTransport::skipBody() {
+  while (bodyLeft_ > 0) {
+    if (httpPos_ == httpBufLen_) {
       refill();
-
-      // Now have available however much we read
-      avail = httpBufLen_;
     }
-    uint32_t give = avail;
-    if (need < give) {
-      give = need;
-    }
-    readBuffer_.write((uint8_t*)(httpBuf_ + httpPos_), give);
-    httpPos_ += give;
-    need -= give;
+    uint32_t skip = (std::min)(bodyLeft_, httpBufLen_ - httpPos_);
+    httpPos_ += skip;
+    bodyLeft_ -= skip;
   }
-  return size;
 }
 
 char* THttpTransport::readLine() {
@@ -170,8 +199,6 @@ char* THttpTransport::readLine() {
 
     // No CRLF yet?
     if (eol == NULL) {
-      // Shift whatever we have now to front and refill
-      shift();
       refill();
     } else {
       // Return pointer to next line
@@ -197,8 +224,13 @@ void THttpTransport::shift() {
 }
 
 void THttpTransport::refill() {
-  uint32_t avail = httpBufSize_ - httpBufLen_;
-  if (avail <= (httpBufSize_ / 4)) {
+  if (httpPos_ == httpBufLen_ || httpBufSize_ - httpBufLen_ <= httpBufSize_ / 4) {
+    // Body bytes are always taken before the buffer is refilled, so at most
+    // the start of a line is left to move down.
+    shift();
+  }
+  if (httpBufSize_ - httpBufLen_ <= httpBufSize_ / 4) {
+    // A line that fills most of the buffer; make room for the rest of it.
     httpBufSize_ *= 2;
     httpBuf_ = (char*)std::realloc(httpBuf_, httpBufSize_ + 1);
     if (httpBuf_ == NULL) {
@@ -221,7 +253,8 @@ void THttpTransport::readHeaders() {
   contentLength_ = 0;
   chunked_ = false;
   chunkedDone_ = false;
-  chunkSize_ = 0;
+  bodyLeft_ = 0;
+  inChunk_ = false;
 
   // Control state flow
   bool statusLine = true;
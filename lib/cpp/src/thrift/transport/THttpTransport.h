@@ -52,6 +52,14 @@ public:
 
   uint32_t readEnd();
 
+  /**
+   * Lends out body bytes that are already buffered, as long as they belong
+   * to the current chunk.  Never reads from the underlying transport.
+   */
+  const uint8_t* borrow(uint8_t* buf, uint32_t* len);
+
+  void consume(uint32_t len);
+
   void write(const uint8_t* buf, uint32_t len);
 
   virtual void flush() = 0;
@@ -63,14 +71,23 @@ protected:
   std::string origin_;
 
   TMemoryBuffer writeBuffer_;
-  TMemoryBuffer readBuffer_;
 
   bool readHeaders_;
   bool chunked_;
   bool chunkedDone_;
-  uint32_t chunkSize_;
   uint32_t contentLength_;
 
+  /// Body bytes of the content or of the current chunk not read yet
+  uint32_t bodyLeft_;
+
+  /// Set from the start of a chunk's data until the CRLF after it is read
+  bool inChunk_;
+
+  /**
+   * Bytes read from the transport and not taken yet, from httpPos_ to
+   * httpBufLen_.  Body bytes are handed out from here as they are, so only
+   * a header line cut off at the end of the buffer is ever moved.
+   */
   char* httpBuf_;
   uint32_t httpPos_;
   uint32_t httpBufLen_;
@@ -78,6 +95,11 @@ protected:
 
   virtual void init();
 
+  /**
+   * Reads headers and chunk sizes until there is body to read, and returns
+   * how much is left of the content or the current chunk; 0 at the end of
+   * the message.
+   */
   uint32_t readMoreData();
   char* readLine();
 
@@ -85,11 +107,12 @@ protected:
   virtual void parseHeader(char* header) = 0;
   virtual bool parseStatusLine(char* status) = 0;
 
-  uint32_t readChunked();
+  void readChunkSize();
   void readChunkedFooters();
   uint32_t parseChunkSize(char* line);
 
-  uint32_t readContent(uint32_t size);
+  /// Drops what is left of the content or of the current chunk.
+  void skipBody();
 
   void refill();
   void shift();
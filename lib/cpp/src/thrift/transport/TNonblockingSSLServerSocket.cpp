@@ -53,6 +53,11 @@ stdcxx::shared_ptr<TSocket> TNonblockingSSLServerSocket::createSocket(THRIFT_SOC
   tSSLSocket->setLibeventSafe();
   return tSSLSocket;
 }
+
+TNonblockingServerSocket* TNonblockingSSLServerSocket::createSibling(const std::string& address,
+                                                                     int port) {
+  return new TNonblockingSSLServerSocket(address, port, factory_);
+}
 }
 }
 }
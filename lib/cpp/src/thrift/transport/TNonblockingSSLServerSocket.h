@@ -68,6 +68,7 @@ public:
 
 protected:
   stdcxx::shared_ptr<TSocket> createSocket(THRIFT_SOCKET socket);
+  TNonblockingServerSocket* createSibling(const std::string& address, int port);
   stdcxx::shared_ptr<TSSLSocketFactory> factory_;
 };
 }
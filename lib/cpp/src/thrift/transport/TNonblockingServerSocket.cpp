@@ -88,6 +88,7 @@ TNonblockingServerSocket::TNonblockingServerSocket(int port)
     tcpSendBuffer_(0),
     tcpRecvBuffer_(0),
     keepAlive_(false),
+    reusePort_(false),
     listening_(false) {
 }
 
@@ -103,6 +104,7 @@ TNonblockingServerSocket::TNonblockingServerSocket(int port, int sendTimeout, in
     tcpSendBuffer_(0),
     tcpRecvBuffer_(0),
     keepAlive_(false),
+    reusePort_(false),
     listening_(false) {
 }
 
@@ -119,6 +121,7 @@ TNonblockingServerSocket::TNonblockingServerSocket(const string& address, int po
     tcpSendBuffer_(0),
     tcpRecvBuffer_(0),
     keepAlive_(false),
+    reusePort_(false),
     listening_(false) {
 }
 
@@ -135,6 +138,7 @@ TNonblockingServerSocket::TNonblockingServerSocket(const string& path)
     tcpSendBuffer_(0),
     tcpRecvBuffer_(0),
     keepAlive_(false),
+    reusePort_(false),
     listening_(false) {
 }
 
@@ -170,6 +174,20 @@ void TNonblockingServerSocket::setTcpRecvBuffer(int tcpRecvBuffer) {
   tcpRecvBuffer_ = tcpRecvBuffer;
 }
 
+void TNonblockingServerSocket::setReusePort(bool reusePort) {
+#ifndef SO_REUSEPORT
+  if (reusePort) {
+    throw TTransportException(TTransportException::BAD_ARGS,
+                              "SO_REUSEPORT is not supported on this platform");
+  }
+#endif
+  if (reusePort && !path_.empty()) {
+    throw TTransportException(TTransportException::BAD_ARGS,
+                              "SO_REUSEPORT is not supported for Unix Domain sockets");
+  }
+  reusePort_ = reusePort;
+}
+
 void TNonblockingServerSocket::listen() {
   listening_ = true;
 #ifdef _WIN32
@@ -246,6 +264,25 @@ void TNonblockingServerSocket::listen() {
 #endif
   }
 
+#ifdef SO_REUSEPORT
+  // Let other listeners bind the same port; the kernel balances accepts
+  if (reusePort_) {
+    if (-1 == setsockopt(serverSocket_,
+                         SOL_SOCKET,
+                         SO_REUSEPORT,
+                         cast_sockopt(&one),
+                         sizeof(one))) {
+      int errno_copy = THRIFT_GET_SOCKET_ERROR;
+      GlobalOutput.perror("TNonblockingServerSocket::listen() setsockopt() SO_REUSEPORT ",
+                          errno_copy);
+      close();
+      throw TTransportException(TTransportException::NOT_OPEN,
+                                "Could not set SO_REUSEPORT",
+                                errno_copy);
+    }
+  }
+#endif
+
   // Set TCP buffer sizes
   if (tcpSendBuffer_ > 0) {
     if (-1 == setsockopt(serverSocket_,
@@ -535,6 +572,33 @@ shared_ptr<TSocket> TNonblockingServerSocket::createSocket(THRIFT_SOCKET clientS
   return shared_ptr<TSocket>(new TSocket(clientSocket));
 }
 
+shared_ptr<TNonblockingServerTransport> TNonblockingServerSocket::listenShared() {
+  if (!reusePort_ || serverSocket_ == THRIFT_INVALID_SOCKET) {
+    throw TTransportException(TTransportException::NOT_OPEN,
+                              "listenShared() needs a listening socket with SO_REUSEPORT set");
+  }
+
+  // Bind the port actually in use, which matters if port_ was 0
+  shared_ptr<TNonblockingServerSocket> sibling(createSibling(address_, listenPort_));
+  sibling->acceptBacklog_ = acceptBacklog_;
+  sibling->sendTimeout_ = sendTimeout_;
+  sibling->recvTimeout_ = recvTimeout_;
+  sibling->retryLimit_ = retryLimit_;
+  sibling->retryDelay_ = retryDelay_;
+  sibling->tcpSendBuffer_ = tcpSendBuffer_;
+  sibling->tcpRecvBuffer_ = tcpRecvBuffer_;
+  sibling->keepAlive_ = keepAlive_;
+  sibling->reusePort_ = true;
+  sibling->listenCallback_ = listenCallback_;
+  sibling->acceptCallback_ = acceptCallback_;
+  sibling->listen();
+  return sibling;
+}
+
+TNonblockingServerSocket* TNonblockingServerSocket::createSibling(const string& address, int port) {
+  return new TNonblockingServerSocket(address, port);
+}
+
 void TNonblockingServerSocket::close() {
   if (serverSocket_ != THRIFT_INVALID_SOCKET) {
     shutdown(serverSocket_, THRIFT_SHUT_RDWR);
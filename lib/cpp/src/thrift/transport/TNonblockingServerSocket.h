@@ -87,6 +87,10 @@ public:
   void setTcpSendBuffer(int tcpSendBuffer);
   void setTcpRecvBuffer(int tcpRecvBuffer);
 
+  // Sets SO_REUSEPORT on the listening socket so that listenShared() can
+  // open more listeners on the same port.  TCP only.
+  void setReusePort(bool reusePort);
+
   // listenCallback gets called just before listen, and after all Thrift
   // setsockopt calls have been made.  If you have custom setsockopt
   // things that need to happen on the listening socket, this is the place to do it.
@@ -107,10 +111,15 @@ public:
   void listen();
   void close();
 
+  stdcxx::shared_ptr<TNonblockingServerTransport> listenShared();
+
 protected:
   apache::thrift::stdcxx::shared_ptr<TSocket> acceptImpl();
   virtual apache::thrift::stdcxx::shared_ptr<TSocket> createSocket(THRIFT_SOCKET client);
 
+  // Creates the (not yet listening) socket returned by listenShared().
+  virtual TNonblockingServerSocket* createSibling(const std::string& address, int port);
+
 private:
   int port_;
   int listenPort_;
@@ -125,6 +134,7 @@ private:
   int tcpSendBuffer_;
   int tcpRecvBuffer_;
   bool keepAlive_;
+  bool reusePort_;
   bool listening_;
 
   socket_func_t listenCallback_;
@@ -82,6 +82,33 @@ public:
    */
   virtual void close() = 0;
 
+  /**
+   * Lets several listeners bind the same address with SO_REUSEPORT, so that
+   * the kernel spreads incoming connections across them.  Must be called
+   * before listen().
+   *
+   * @throws TTransportException if the transport cannot share its address
+   */
+  virtual void setReusePort(bool reusePort) {
+    if (reusePort) {
+      throw TTransportException(TTransportException::BAD_ARGS,
+                                "SO_REUSEPORT is not supported by this transport");
+    }
+  }
+
+  /**
+   * Creates another listener on the address this one is listening on.  The
+   * new transport is already listening.  Requires setReusePort(true) before
+   * this transport's listen().
+   *
+   * @return A new listening transport
+   * @throws TTransportException if the listener cannot be created
+   */
+  virtual stdcxx::shared_ptr<TNonblockingServerTransport> listenShared() {
+    throw TTransportException(TTransportException::BAD_ARGS,
+                              "SO_REUSEPORT is not supported by this transport");
+  }
+
 protected:
   TNonblockingServerTransport() {}
 
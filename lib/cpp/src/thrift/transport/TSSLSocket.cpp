@@ -525,6 +525,13 @@ uint32_t TSSLSocket::write_partial(const uint8_t* buf, uint32_t len) {
   return written;
 }
 
+void TSSLSocket::writeSegments(const TWriteSegment* segs, uint32_t count) {
+  // Every byte has to go through SSL_write, so sendmsg() is of no use here.
+  for (uint32_t i = 0; i < count; ++i) {
+    write(segs[i].data, segs[i].len);
+  }
+}
+
 void TSSLSocket::flush() {
   // Don't throw exception if not open. Thrift servers close socket twice.
   if (ssl_ == NULL) {
@@ -81,6 +81,7 @@ public:
   uint32_t read(uint8_t* buf, uint32_t len);
   void write(const uint8_t* buf, uint32_t len);
   uint32_t write_partial(const uint8_t* buf, uint32_t len);
+  void writeSegments(const TWriteSegment* segs, uint32_t count);
   void flush();
   /**
   * Set whether to use client or server side SSL handshake protocol.
@@ -669,6 +669,81 @@ uint32_t TSocket::write_partial(const uint8_t* buf, uint32_t len) {
   return b;
 }
 
+void TSocket::writeSegments(const TWriteSegment* segs, uint32_t count) {
+#ifdef _WIN32
+  TVirtualTransport<TSocket>::writeSegments(segs, count);
+#else
+  if (socket_ == THRIFT_INVALID_SOCKET) {
+    throw TTransportException(TTransportException::NOT_OPEN, "Called write on non-open socket");
+  }
+
+  int flags = 0;
+#ifdef MSG_NOSIGNAL
+  flags |= MSG_NOSIGNAL;
+#endif // ifdef MSG_NOSIGNAL
+
+  // Segments go out in batches of up to 64; seg and offset track how far
+  // the kernel has got, so a short send resumes mid-segment.
+  struct iovec iov[64];
+  uint32_t seg = 0;
+  uint32_t offset = 0;
+  while (seg < count) {
+    int n = 0;
+    for (uint32_t i = seg; i < count && n < 64; ++i) {
+      uint32_t skip = (i == seg) ? offset : 0;
+      if (segs[i].len > skip) {
+        iov[n].iov_base = const_cast<uint8_t*>(segs[i].data + skip);
+        iov[n].iov_len = segs[i].len - skip;
+        ++n;
+      }
+    }
+    if (n == 0) {
+      break;
+    }
+
+    struct msghdr msg;
+    std::memset(&msg, 0, sizeof(msg));
+    msg.msg_iov = iov;
+    msg.msg_iovlen = n;
+    ssize_t b = sendmsg(socket_, &msg, flags);
+
+    if (b < 0) {
+      int errno_copy = THRIFT_GET_SOCKET_ERROR;
+      if (errno_copy == THRIFT_EWOULDBLOCK || errno_copy == THRIFT_EAGAIN) {
+        // Only the timeout set with SO_SNDTIMEO gets us here, as in write().
+        throw TTransportException(TTransportException::TIMED_OUT, "send timeout expired");
+      }
+      GlobalOutput.perror("TSocket::writeSegments() sendmsg() " + getSocketInfo(), errno_copy);
+
+      if (errno_copy == THRIFT_EPIPE || errno_copy == THRIFT_ECONNRESET
+          || errno_copy == THRIFT_ENOTCONN) {
+        throw TTransportException(TTransportException::NOT_OPEN, "write() sendmsg()", errno_copy);
+      }
+
+      throw TTransportException(TTransportException::UNKNOWN, "write() sendmsg()", errno_copy);
+    }
+
+    // Fail on blocked send
+    if (b == 0) {
+      throw TTransportException(TTransportException::NOT_OPEN, "Socket send returned 0.");
+    }
+
+    size_t left = static_cast<size_t>(b);
+    while (left > 0) {
+      uint32_t rest = segs[seg].len - offset;
+      if (left < rest) {
+        offset += static_cast<uint32_t>(left);
+        left = 0;
+      } else {
+        left -= rest;
+        ++seg;
+        offset = 0;
+      }
+    }
+  }
+#endif // _WIN32
+}
+
 std::string TSocket::getHost() {
   return host_;
 }
@@ -122,6 +122,13 @@ public:
    */
   virtual uint32_t write_partial(const uint8_t* buf, uint32_t len);
 
+  /**
+   * Writes all segments to the underlying socket with sendmsg(), looping
+   * until done or fail.  Falls back to one write() per segment where
+   * sendmsg() is not available.
+   */
+  virtual void writeSegments(const TWriteSegment* segs, uint32_t count);
+
   /**
    * Get the host that the socket is connected to
    *
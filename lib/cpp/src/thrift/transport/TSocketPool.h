@@ -63,6 +63,8 @@ public:
 /**
  * TCP Socket implementation of the TTransport interface.
  *
+ * The server is picked once, when the socket is opened; TConnectionPool
+ * picks one for every call.
  */
 class TSocketPool : public TSocket {
 
@@ -23,6 +23,7 @@
 #include <thrift/Thrift.h>
 #include <thrift/stdcxx.h>
 #include <thrift/transport/TTransportException.h>
+#include <algorithm>
 #include <string>
 
 namespace apache {
@@ -48,6 +49,39 @@ uint32_t readAll(Transport_& trans, uint8_t* buf, uint32_t len) {
   return have;
 }
 
+/**
+ * Helper template to discard len bytes from a transport without allocating.
+ * Whatever the transport has buffered is stepped over with borrow/consume;
+ * the remainder is read through a small stack buffer.
+ */
+template <class Transport_>
+uint32_t skipAll(Transport_& trans, uint32_t len) {
+  uint8_t scratch[512];
+  uint32_t have = 0;
+
+  while (have < len) {
+    uint32_t want = len - have;
+    uint32_t got = 1;
+    if (trans.borrow(NULL, &got) != NULL) {
+      uint32_t give = (std::min)(got, want);
+      trans.consume(give);
+      have += give;
+    } else {
+      have += trans.readAll(scratch, (std::min)(want, static_cast<uint32_t>(sizeof(scratch))));
+    }
+  }
+
+  return have;
+}
+
+/**
+ * One buffer of a scatter-gather write.  See TTransport::writeSegments().
+ */
+struct TWriteSegment {
+  const uint8_t* data;
+  uint32_t len;
+};
+
 /**
  * Generic interface for a method of transporting data. A TTransport may be
  * capable of either reading or writing, but not necessarily both.
@@ -156,6 +190,38 @@ public:
     throw TTransportException(TTransportException::NOT_OPEN, "Base TTransport cannot write.");
   }
 
+  /**
+   * Like write(), but the transport may keep a pointer to buf and send it
+   * from there on the next flush() instead of copying it.  The data must
+   * stay valid and unmodified until flush() returns.  Protocols use this for
+   * string and binary bodies, which generated code keeps alive across the
+   * flush; transports that buffer but do not take references copy as usual.
+   *
+   * @param buf  The data to write out
+   * @throws TTransportException if an error occurs
+   */
+  void writeRef(const uint8_t* buf, uint32_t len) {
+    T_VIRTUAL_CALL();
+    writeRef_virt(buf, len);
+  }
+  virtual void writeRef_virt(const uint8_t* buf, uint32_t len) { write(buf, len); }
+
+  /**
+   * Writes count buffers in order, with the same result as one write() per
+   * segment.  Transports that can hand the whole list to the kernel at once
+   * (TSocket uses sendmsg) override this so that a frame header, the
+   * buffered body and any referenced blobs go out in a single system call.
+   *
+   * @param segs   The buffers to write out
+   * @param count  Number of entries in segs
+   * @throws TTransportException if an error occurs
+   */
+  virtual void writeSegments(const TWriteSegment* segs, uint32_t count) {
+    for (uint32_t i = 0; i < count; ++i) {
+      write(segs[i].data, segs[i].len);
+    }
+  }
+
   /**
    * Called when write is completed.
    * This can be over-ridden to perform a transport-specific action
@@ -168,6 +234,17 @@ public:
     return 0;
   }
 
+  /**
+   * Announces that the next message will be size bytes long, as counted by
+   * serializedSize() for instance, before any of it is written.  Buffering
+   * transports can then make room for all of it at once.
+   *
+   * @param size   Number of bytes the message will take
+   */
+  virtual void beginFrame(uint32_t /* size */) {
+    // default behaviour is to do nothing
+  }
+
   /**
    * Flushes any pending data to be written. Typically used with buffered
    * transport mechanisms.
@@ -228,6 +305,24 @@ public:
     throw TTransportException(TTransportException::NOT_OPEN, "Base TTransport cannot consume.");
   }
 
+  /**
+   * Like borrow(NULL, len), but for callers that keep referring to the bytes
+   * after consuming them.  On success \c owner is set to a handle that keeps
+   * the returned memory alive and unmodified for as long as the handle (or a
+   * copy of it) exists; the transport moves on to fresh storage instead of
+   * reusing it.  The caller must still consume() what it uses.
+   *
+   * Transports whose buffers cannot outlive the next read return NULL, and
+   * callers must then fall back to copying the data.
+   *
+   * @param len    Same as for borrow().
+   * @param owner  Receives the keep-alive handle on success.
+   * @return A pointer into the transport's buffer, or NULL.
+   */
+  virtual const uint8_t* borrowShared(uint32_t* /* len */, stdcxx::shared_ptr<void>& /* owner */) {
+    return NULL;
+  }
+
   /**
    * Returns the origin of the transports call. The value depends on the
    * transport used. An IP based transport for example will return the
@@ -21,6 +21,7 @@
 #define _THRIFT_TEST_GENERICPROTOCOLTEST_TCC_ 1
 
 #include <limits>
+#include <vector>
 
 #include <thrift/protocol/TBinaryProtocol.h>
 #include <thrift/transport/TBufferTransports.h>
@@ -125,6 +126,171 @@ void testMessage() {
   }
 }
 
+inline uint32_t writeSkipStruct(shared_ptr<TProtocol> protocol) {
+  uint32_t wsize = 0;
+  std::string blob(1000, 'x');
+
+  wsize += protocol->writeStructBegin("skipped");
+  wsize += protocol->writeFieldBegin("b", T_BOOL, 1);
+  wsize += protocol->writeBool(true);
+  wsize += protocol->writeFieldEnd();
+  wsize += protocol->writeFieldBegin("i64", T_I64, 2);
+  wsize += protocol->writeI64(-(1LL << 40));
+  wsize += protocol->writeFieldEnd();
+  wsize += protocol->writeFieldBegin("blob", T_STRING, 30);
+  wsize += protocol->writeBinary(blob);
+  wsize += protocol->writeFieldEnd();
+
+  wsize += protocol->writeFieldBegin("nested", T_STRUCT, 4);
+  wsize += protocol->writeStructBegin("nested");
+  wsize += protocol->writeFieldBegin("d", T_DOUBLE, 1);
+  wsize += protocol->writeDouble(1.5);
+  wsize += protocol->writeFieldEnd();
+  wsize += protocol->writeFieldBegin("b", T_BOOL, 2);
+  wsize += protocol->writeBool(false);
+  wsize += protocol->writeFieldEnd();
+  wsize += protocol->writeFieldStop();
+  wsize += protocol->writeStructEnd();
+  wsize += protocol->writeFieldEnd();
+
+  wsize += protocol->writeFieldBegin("ints", T_LIST, 5);
+  wsize += protocol->writeListBegin(T_I32, 100);
+  for (int32_t i = 0; i < 100; i++) {
+    wsize += protocol->writeI32(i * 1000 - 50000);
+  }
+  wsize += protocol->writeListEnd();
+  wsize += protocol->writeFieldEnd();
+
+  wsize += protocol->writeFieldBegin("doubles", T_SET, 6);
+  wsize += protocol->writeSetBegin(T_DOUBLE, 20);
+  for (int32_t i = 0; i < 20; i++) {
+    wsize += protocol->writeDouble(i / 3.0);
+  }
+  wsize += protocol->writeSetEnd();
+  wsize += protocol->writeFieldEnd();
+
+  wsize += protocol->writeFieldBegin("strings", T_MAP, 7);
+  wsize += protocol->writeMapBegin(T_STRING, T_BOOL, 3);
+  for (int32_t i = 0; i < 3; i++) {
+    wsize += protocol->writeString(blob.substr(0, i * 100));
+    wsize += protocol->writeBool(i % 2 == 0);
+  }
+  wsize += protocol->writeMapEnd();
+  wsize += protocol->writeFieldEnd();
+
+  wsize += protocol->writeFieldBegin("bytes", T_MAP, 8);
+  wsize += protocol->writeMapBegin(T_BYTE, T_DOUBLE, 4);
+  for (int32_t i = 0; i < 4; i++) {
+    wsize += protocol->writeByte((int8_t)i);
+    wsize += protocol->writeDouble(i * 2.0);
+  }
+  wsize += protocol->writeMapEnd();
+  wsize += protocol->writeFieldEnd();
+
+  wsize += protocol->writeFieldStop();
+  wsize += protocol->writeStructEnd();
+  return wsize;
+}
+
+template <typename TProto>
+void testSkip(shared_ptr<TTransport> writeTransport, shared_ptr<TTransport> readTransport) {
+  shared_ptr<TProtocol> oprot(new TProto(writeTransport));
+  shared_ptr<TProtocol> iprot(new TProto(readTransport));
+
+  uint32_t wsize = writeSkipStruct(oprot);
+  oprot->writeI32(0x5eed);
+  oprot->getTransport()->flush();
+
+  uint32_t rsize = iprot->skip(T_STRUCT);
+  int32_t sentinel = 0;
+  iprot->readI32(sentinel);
+
+  if (rsize != wsize) {
+    THRIFT_SNPRINTF(errorMessage, ERR_LEN, "Skip consumed %u bytes, expected %u", rsize, wsize);
+    throw TException(errorMessage);
+  }
+  if (sentinel != 0x5eed) {
+    throw TException("Skip did not stop at the end of the struct");
+  }
+}
+
+template <typename TProto>
+void testSkip() {
+  shared_ptr<TMemoryBuffer> buffer(new TMemoryBuffer());
+  testSkip<TProto>(buffer, buffer);
+
+  // TBufferedTransport cannot borrow past its buffer, which exercises the
+  // scratch buffer path.
+  shared_ptr<TMemoryBuffer> underlying(new TMemoryBuffer());
+  shared_ptr<TTransport> buffered(new TBufferedTransport(underlying, 64));
+  testSkip<TProto>(underlying, buffered);
+}
+
+template <typename TProto, typename Val>
+void testList(const std::vector<Val>& vals,
+              uint32_t (TProtocol::*writeList)(const Val*, uint32_t),
+              uint32_t (TProtocol::*readList)(Val*, uint32_t)) {
+  shared_ptr<TMemoryBuffer> expected(new TMemoryBuffer());
+  shared_ptr<TProtocol> eprot(new TProto(expected));
+  for (size_t i = 0; i < vals.size(); ++i) {
+    GenericIO::write(eprot, vals[i]);
+  }
+
+  shared_ptr<TMemoryBuffer> buffer(new TMemoryBuffer());
+  shared_ptr<TProtocol> protocol(new TProto(buffer));
+  uint32_t count = static_cast<uint32_t>(vals.size());
+  uint32_t wsize = count > 0 ? (protocol.get()->*writeList)(&vals[0], count) : 0;
+
+  // The bulk encoding must be byte-for-byte the per-element encoding.
+  if (buffer->getBufferAsString() != expected->getBufferAsString()
+      || wsize != expected->available_read()) {
+    THRIFT_SNPRINTF(errorMessage,
+                    ERR_LEN,
+                    "Invalid bulk list write (type: %s, count: %u)",
+                    ClassNames::getName<Val>(),
+                    count);
+    throw TException(errorMessage);
+  }
+
+  std::vector<Val> out(vals.size());
+  uint32_t rsize = count > 0 ? (protocol.get()->*readList)(&out[0], count) : 0;
+  if (out != vals || rsize != wsize) {
+    THRIFT_SNPRINTF(errorMessage,
+                    ERR_LEN,
+                    "Invalid bulk list read (type: %s, count: %u)",
+                    ClassNames::getName<Val>(),
+                    count);
+    throw TException(errorMessage);
+  }
+}
+
+template <typename TProto, typename Val>
+void testLists(uint32_t (TProtocol::*writeList)(const Val*, uint32_t),
+               uint32_t (TProtocol::*readList)(Val*, uint32_t)) {
+  // Long enough to span several stack buffers in the converting paths.
+  for (size_t count = 0; count < 3000; count = count * 3 + 1) {
+    std::vector<Val> vals;
+    for (size_t i = 0; i < count; ++i) {
+      Val v = static_cast<Val>(i * 7919);
+      vals.push_back(i % 2 ? v : static_cast<Val>(-v));
+    }
+    if (count > 2) {
+      vals[1] = (std::numeric_limits<Val>::min)();
+      vals[2] = (std::numeric_limits<Val>::max)();
+    }
+    testList<TProto, Val>(vals, writeList, readList);
+  }
+}
+
+template <typename TProto>
+void testLists() {
+  testLists<TProto, int8_t>(&TProtocol::writeByteList, &TProtocol::readByteList);
+  testLists<TProto, int16_t>(&TProtocol::writeI16List, &TProtocol::readI16List);
+  testLists<TProto, int32_t>(&TProtocol::writeI32List, &TProtocol::readI32List);
+  testLists<TProto, int64_t>(&TProtocol::writeI64List, &TProtocol::readI64List);
+  testLists<TProto, double>(&TProtocol::writeDoubleList, &TProtocol::readDoubleList);
+}
+
 template <typename TProto>
 void testProtocol(const char* protoname) {
   try {
@@ -215,6 +381,10 @@ void testProtocol(const char* protoname) {
 
     testMessage<TProto>();
 
+    testSkip<TProto>();
+
+    testLists<TProto>();
+
     printf("%s => OK\n", protoname);
   } catch (TException e) {
     THRIFT_SNPRINTF(errorMessage, ERR_LEN, "%s => Test FAILED: %s", protoname, e.what());
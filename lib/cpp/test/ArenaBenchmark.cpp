@@ -0,0 +1,177 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Counts heap allocations per deserialized request for DebugProtoTest
+ * structs generated with cpp:arena, first with no arena in scope (every
+ * string and container goes to the heap, as with plain generated code) and
+ * then inside a per-request TArenaScope that is reset after each call.
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <cstdlib>
+#include <iostream>
+#include <new>
+#include <thrift/TArena.h>
+#include <thrift/protocol/TBinaryProtocol.h>
+#include <thrift/stdcxx.h>
+#include <thrift/transport/TBufferTransports.h>
+#include "gen-arena/DebugProtoTest_types.h"
+
+#ifdef HAVE_SYS_TIME_H
+#include <sys/time.h>
+#endif
+
+static unsigned long allocations = 0;
+
+void* operator new(std::size_t size) {
+  ++allocations;
+  void* p = std::malloc(size == 0 ? 1 : size);
+  if (p == NULL) {
+    throw std::bad_alloc();
+  }
+  return p;
+}
+
+void operator delete(void* p) throw() {
+  std::free(p);
+}
+
+class Timer {
+public:
+  timeval vStart;
+
+  Timer() { THRIFT_GETTIMEOFDAY(&vStart, 0); }
+  void start() { THRIFT_GETTIMEOFDAY(&vStart, 0); }
+
+  double frame() {
+    timeval vEnd;
+    THRIFT_GETTIMEOFDAY(&vEnd, 0);
+    double dstart = vStart.tv_sec + ((double)vStart.tv_usec / 1000000.0);
+    double dend = vEnd.tv_sec + ((double)vEnd.tv_usec / 1000000.0);
+    return dend - dstart;
+  }
+};
+
+namespace thrift {
+namespace test {
+namespace debug {
+
+// Normally provided by DebugProtoTest_extras.cpp, which is built against gen-cpp.
+bool Empty::operator<(Empty const& other) const {
+  (void)other;
+  return false;
+}
+}
+}
+}
+
+using namespace thrift::test::debug;
+using namespace apache::thrift;
+using namespace apache::thrift::transport;
+using namespace apache::thrift::protocol;
+using std::cout;
+using std::endl;
+
+static void buildRequest(HolyMoley& hm) {
+  OneOfEach ooe;
+  ooe.im_true = true;
+  ooe.integer32 = 1 << 24;
+  ooe.some_characters = "Debug THIS! with a string long enough to need the heap";
+  ooe.zomg_unicode = "\xd7\n\a\t";
+  ooe.base64 = "\1\2\3\255";
+  for (int i = 0; i < 20; ++i) {
+    hm.big.push_back(ooe);
+  }
+
+  for (int i = 0; i < 10; ++i) {
+    std::vector<TArenaString, TArenaAllocator<TArenaString> > names;
+    names.push_back("and a one");
+    names.push_back("and a two");
+    names.push_back(TArenaString(i + 1, 'x'));
+    hm.contain.insert(names);
+  }
+
+  for (int i = 0; i < 10; ++i) {
+    Bonk bonk;
+    bonk.type = i;
+    bonk.message = "Wait.. a bonk with a message that is not short";
+    hm.bonks[TArenaString(i + 1, 'k')].assign(3, bonk);
+  }
+}
+
+/**
+ * Deserializes count requests from buf and returns the heap allocations
+ * made per request.
+ */
+static double run(const stdcxx::shared_ptr<TMemoryBuffer>& buf,
+                  uint8_t* data,
+                  uint32_t size,
+                  int count,
+                  TArena* arena) {
+  TBinaryProtocolT<TMemoryBuffer> prot(buf);
+  unsigned long before = allocations;
+  Timer timer;
+  for (int i = 0; i < count; ++i) {
+    buf->resetBuffer(data, size);
+    {
+      TArenaScope scope(arena);
+      HolyMoley request;
+      request.read(&prot);
+    }
+    if (arena != NULL) {
+      arena->reset();
+    }
+  }
+  double elapsed = timer.frame();
+  double perRequest = static_cast<double>(allocations - before) / count;
+  cout << " " << perRequest << " allocations/request, " << count / (1000 * elapsed)
+       << " kHz" << endl;
+  return perRequest;
+}
+
+int main() {
+  stdcxx::shared_ptr<TMemoryBuffer> out(new TMemoryBuffer());
+  {
+    HolyMoley hm;
+    buildRequest(hm);
+    TBinaryProtocolT<TMemoryBuffer> prot(out);
+    hm.write(&prot);
+  }
+  uint8_t* data;
+  uint32_t size;
+  out->getBuffer(&data, &size);
+  cout << "HolyMoley request: " << size << " bytes" << endl;
+
+  const int count = 10000;
+  stdcxx::shared_ptr<TMemoryBuffer> buf(new TMemoryBuffer());
+
+  cout << "Heap:";
+  double heap = run(buf, data, size, count, NULL);
+
+  TArena arena;
+  cout << "Arena:";
+  double pooled = run(buf, data, size, count, &arena);
+  cout << "Arena holds " << arena.bytesReserved() << " bytes between requests" << endl;
+
+  // The arena is sized after the first request and never touches the heap again.
+  return pooled < heap ? 0 : 1;
+}
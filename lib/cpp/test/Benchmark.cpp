@@ -24,6 +24,7 @@
 #define _USE_MATH_DEFINES
 #include <math.h>
 #include "thrift/protocol/TBinaryProtocol.h"
+#include "thrift/protocol/TCompactProtocol.h"
 #include "thrift/stdcxx.h"
 #include "thrift/transport/TBufferTransports.h"
 #include "gen-cpp/DebugProtoTest_types.h"
@@ -240,5 +241,98 @@ int main() {
   }
 
 
+  // Skipping a payload that is made up almost entirely of unknown fields,
+  // as a reader on an older schema would see it.
+  HolyMoley hm;
+  for (int i = 0; i < 10; ++i) {
+    ooe.base64.assign(1024, (char)i);
+    hm.big.push_back(ooe);
+  }
+  for (int i = 0; i < 10; ++i) {
+    std::vector<std::string> strings(4, std::string(64, 'a' + (char)i));
+    hm.contain.insert(strings);
+    Bonk bonk;
+    bonk.type = i;
+    bonk.message.assign(256, 'b');
+    hm.bonks[strings[0]].push_back(bonk);
+  }
+
+  num = 2000;
+  buf.reset(new TMemoryBuffer(num * 20000));
+
+  {
+    buf->resetBuffer();
+    TBinaryProtocolT<TMemoryBuffer> prot(buf);
+    for (int i = 0; i < num; i++) {
+      hm.write(&prot);
+    }
+  }
+
+  buf->getBuffer(&data, &datasize);
+
+  {
+    apache::thrift::stdcxx::shared_ptr<TMemoryBuffer> buf2(new TMemoryBuffer(data, datasize));
+    TBinaryProtocolT<TMemoryBuffer> prot(buf2);
+    double elapsed = 0.0;
+    Timer timer;
+
+    for (int i = 0; i < num; i++) {
+      apache::thrift::protocol::skip(prot, T_STRUCT);
+    }
+    elapsed = timer.frame();
+    cout << "Generic skip binary: " << num / (1000 * elapsed) << " kHz" << endl;
+  }
+
+  {
+    apache::thrift::stdcxx::shared_ptr<TMemoryBuffer> buf2(new TMemoryBuffer(data, datasize));
+    TBinaryProtocolT<TMemoryBuffer> prot(buf2);
+    Empty empty;
+    double elapsed = 0.0;
+    Timer timer;
+
+    for (int i = 0; i < num; i++) {
+      empty.read(&prot);
+    }
+    elapsed = timer.frame();
+    cout << "        Skip binary: " << num / (1000 * elapsed) << " kHz" << endl;
+  }
+
+  {
+    buf->resetBuffer();
+    TCompactProtocolT<TMemoryBuffer> prot(buf);
+    for (int i = 0; i < num; i++) {
+      hm.write(&prot);
+    }
+  }
+
+  buf->getBuffer(&data, &datasize);
+
+  {
+    apache::thrift::stdcxx::shared_ptr<TMemoryBuffer> buf2(new TMemoryBuffer(data, datasize));
+    TCompactProtocolT<TMemoryBuffer> prot(buf2);
+    double elapsed = 0.0;
+    Timer timer;
+
+    for (int i = 0; i < num; i++) {
+      apache::thrift::protocol::skip(prot, T_STRUCT);
+    }
+    elapsed = timer.frame();
+    cout << "Generic skip compact: " << num / (1000 * elapsed) << " kHz" << endl;
+  }
+
+  {
+    apache::thrift::stdcxx::shared_ptr<TMemoryBuffer> buf2(new TMemoryBuffer(data, datasize));
+    TCompactProtocolT<TMemoryBuffer> prot(buf2);
+    Empty empty;
+    double elapsed = 0.0;
+    Timer timer;
+
+    for (int i = 0; i < num; i++) {
+      empty.read(&prot);
+    }
+    elapsed = timer.frame();
+    cout << "        Skip compact: " << num / (1000 * elapsed) << " kHz" << endl;
+  }
+
   return 0;
 }
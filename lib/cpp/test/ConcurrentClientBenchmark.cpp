@@ -0,0 +1,193 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Throughput of one generated concurrent client shared by 1 to 256 calling
+ * threads.  The calls go over a single connection to a TNonblockingServer
+ * that pipelines them on a ThreadManager, so responses come back out of
+ * order and most of them are read by a thread other than the caller.  Every
+ * caller asks for a reply of its own length and checks that it got it.
+ *
+ * Usage: ConcurrentClientBenchmark [milliseconds per measurement] [max callers]
+ */
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <vector>
+
+#include <thrift/concurrency/Monitor.h>
+#include <thrift/concurrency/PlatformThreadFactory.h>
+#include <thrift/concurrency/ThreadManager.h>
+#include <thrift/concurrency/Util.h>
+#include <thrift/protocol/TBinaryProtocol.h>
+#include <thrift/server/TNonblockingServer.h>
+#include <thrift/stdcxx.h>
+#include <thrift/transport/TBufferTransports.h>
+#include <thrift/transport/TNonblockingServerSocket.h>
+#include <thrift/transport/TSocket.h>
+
+#include "gen-cpp/ParentService.h"
+
+using namespace apache::thrift;
+using namespace apache::thrift::concurrency;
+using namespace apache::thrift::protocol;
+using namespace apache::thrift::server;
+using namespace apache::thrift::transport;
+using stdcxx::shared_ptr;
+using std::cout;
+using std::endl;
+
+struct Handler : public test::ParentServiceIf {
+  int32_t incrementGeneration() { return 0; }
+  int32_t getGeneration() { return 0; }
+  void addString(const std::string&) {}
+  void getStrings(std::vector<std::string>&) {}
+  void getDataWait(std::string& _return, const int32_t length) { _return.assign(length, 'x'); }
+  void onewayWait() {}
+  void exceptionWait(const std::string&) {}
+  void unexpectedExceptionWait(const std::string&) {}
+};
+
+class ReadyHandler : public TServerEventHandler {
+public:
+  ReadyHandler() : ready_(false) {}
+
+  void preServe() {
+    Synchronized s(monitor_);
+    ready_ = true;
+    monitor_.notifyAll();
+  }
+
+  void wait() {
+    Synchronized s(monitor_);
+    while (!ready_) {
+      monitor_.wait();
+    }
+  }
+
+private:
+  Monitor monitor_;
+  bool ready_;
+};
+
+class ServerRunner : public Runnable {
+public:
+  explicit ServerRunner(shared_ptr<TNonblockingServer> server) : server_(server) {}
+  void run() { server_->serve(); }
+
+private:
+  shared_ptr<TNonblockingServer> server_;
+};
+
+class Caller : public Runnable {
+public:
+  Caller(shared_ptr<test::ParentServiceConcurrentClient> client, int32_t length, int64_t deadline)
+    : client_(client), length_(length), deadline_(deadline), calls_(0), errors_(0) {}
+
+  void run() {
+    std::string data;
+    while (Util::currentTime() < deadline_) {
+      client_->getDataWait(data, length_);
+      if (data.size() != static_cast<size_t>(length_)) {
+        ++errors_;
+      }
+      ++calls_;
+    }
+  }
+
+  uint64_t calls() const { return calls_; }
+  uint64_t errors() const { return errors_; }
+
+private:
+  shared_ptr<test::ParentServiceConcurrentClient> client_;
+  int32_t length_;
+  int64_t deadline_;
+  uint64_t calls_;
+  uint64_t errors_;
+};
+
+int main(int argc, char** argv) {
+  int millis = argc > 1 ? std::atoi(argv[1]) : 1000;
+  int maxCallers = argc > 2 ? std::atoi(argv[2]) : 256;
+
+  shared_ptr<ThreadManager> threadManager = ThreadManager::newSimpleThreadManager(4);
+  threadManager->threadFactory(shared_ptr<ThreadFactory>(new PlatformThreadFactory));
+  threadManager->start();
+
+  shared_ptr<TNonblockingServerSocket> socket(new TNonblockingServerSocket("localhost", 0));
+  shared_ptr<TNonblockingServer> server(new TNonblockingServer(
+      shared_ptr<TProcessor>(new test::ParentServiceProcessor(shared_ptr<Handler>(new Handler))),
+      shared_ptr<TProtocolFactory>(new TBinaryProtocolFactory),
+      socket,
+      threadManager));
+  server->setMaxPipelinedRequests(256);
+  shared_ptr<ReadyHandler> ready(new ReadyHandler);
+  server->setServerEventHandler(ready);
+
+  PlatformThreadFactory factory;
+  factory.setDetached(false);
+  shared_ptr<Thread> serverThread
+      = factory.newThread(shared_ptr<Runnable>(new ServerRunner(server)));
+  serverThread->start();
+  ready->wait();
+
+  bool failed = false;
+  for (int callers = 1; callers <= maxCallers; callers *= 4) {
+    shared_ptr<TSocket> clientSocket(new TSocket("localhost", server->getListenPort()));
+    shared_ptr<test::ParentServiceConcurrentClient> client(
+        new test::ParentServiceConcurrentClient(shared_ptr<TProtocol>(new TBinaryProtocol(
+            shared_ptr<TTransport>(new TFramedTransport(clientSocket))))));
+    clientSocket->open();
+
+    int64_t start = Util::currentTime();
+    std::vector<shared_ptr<Caller> > runners;
+    std::vector<shared_ptr<Thread> > threads;
+    for (int i = 0; i < callers; ++i) {
+      runners.push_back(shared_ptr<Caller>(new Caller(client, i % 64, start + millis)));
+      threads.push_back(factory.newThread(runners.back()));
+    }
+    for (int i = 0; i < callers; ++i) {
+      threads[i]->start();
+    }
+
+    uint64_t calls = 0;
+    uint64_t errors = 0;
+    for (int i = 0; i < callers; ++i) {
+      threads[i]->join();
+      calls += runners[i]->calls();
+      errors += runners[i]->errors();
+    }
+    double elapsed = (Util::currentTime() - start) / 1000.0;
+    clientSocket->close();
+
+    cout << std::setw(4) << callers << " callers: " << std::setw(9) << std::fixed
+         << std::setprecision(0) << calls / elapsed << " calls/s";
+    if (errors > 0) {
+      cout << " (" << errors << " wrong replies)";
+      failed = true;
+    }
+    cout << endl;
+  }
+
+  server->stop();
+  serverThread->join();
+  threadManager->stop();
+  return failed ? 1 : 0;
+}
@@ -0,0 +1,184 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Connection storm against TNonblockingServer: client threads connect, make
+ * one call and disconnect as fast as they can.  Runs once with IO thread #0
+ * accepting every connection and once with one SO_REUSEPORT listener per IO
+ * thread, and reports completed connections per second for each.
+ *
+ * Usage: ConnectionStormBenchmark [seconds] [client threads] [io threads]
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include <thrift/concurrency/Monitor.h>
+#include <thrift/concurrency/PlatformThreadFactory.h>
+#include <thrift/concurrency/Util.h>
+#include <thrift/protocol/TBinaryProtocol.h>
+#include <thrift/server/TNonblockingServer.h>
+#include <thrift/stdcxx.h>
+#include <thrift/transport/TBufferTransports.h>
+#include <thrift/transport/TNonblockingServerSocket.h>
+#include <thrift/transport/TSocket.h>
+
+#include "gen-cpp/ParentService.h"
+
+using namespace apache::thrift;
+using namespace apache::thrift::concurrency;
+using namespace apache::thrift::protocol;
+using namespace apache::thrift::server;
+using namespace apache::thrift::transport;
+using stdcxx::shared_ptr;
+using std::cout;
+using std::endl;
+
+struct Handler : public test::ParentServiceIf {
+  int32_t incrementGeneration() { return 0; }
+  int32_t getGeneration() { return 0; }
+  void addString(const std::string&) {}
+  void getStrings(std::vector<std::string>&) {}
+  void getDataWait(std::string&, const int32_t) {}
+  void onewayWait() {}
+  void exceptionWait(const std::string&) {}
+  void unexpectedExceptionWait(const std::string&) {}
+};
+
+class ReadyHandler : public TServerEventHandler {
+public:
+  ReadyHandler() : ready_(false) {}
+
+  void preServe() {
+    Synchronized s(monitor_);
+    ready_ = true;
+    monitor_.notifyAll();
+  }
+
+  void wait() {
+    Synchronized s(monitor_);
+    while (!ready_) {
+      monitor_.wait();
+    }
+  }
+
+private:
+  Monitor monitor_;
+  bool ready_;
+};
+
+class ServerRunner : public Runnable {
+public:
+  explicit ServerRunner(shared_ptr<TNonblockingServer> server) : server_(server) {}
+  void run() { server_->serve(); }
+
+private:
+  shared_ptr<TNonblockingServer> server_;
+};
+
+class StormClient : public Runnable {
+public:
+  StormClient(int port, int64_t deadline) : port_(port), deadline_(deadline), connections_(0) {}
+
+  void run() {
+    while (Util::currentTime() < deadline_) {
+      shared_ptr<TSocket> socket(new TSocket("localhost", port_));
+      // Reset on close so that the client side does not run out of ports
+      // to TIME_WAIT.
+      socket->setLinger(true, 0);
+      try {
+        socket->open();
+        test::ParentServiceClient client(
+            shared_ptr<TProtocol>(new TBinaryProtocol(
+                shared_ptr<TTransport>(new TFramedTransport(socket)))));
+        client.getGeneration();
+        socket->close();
+        ++connections_;
+      } catch (TException&) {
+        // Refused or reset under load; counts as a failed attempt.
+      }
+    }
+  }
+
+  uint64_t connections() const { return connections_; }
+
+private:
+  int port_;
+  int64_t deadline_;
+  uint64_t connections_;
+};
+
+static double storm(bool reusePort, int seconds, int clients, size_t ioThreads) {
+  shared_ptr<TNonblockingServerSocket> socket(new TNonblockingServerSocket("localhost", 0));
+  shared_ptr<TNonblockingServer> server(new TNonblockingServer(
+      shared_ptr<TProcessor>(new test::ParentServiceProcessor(shared_ptr<Handler>(new Handler))),
+      socket));
+  shared_ptr<ReadyHandler> ready(new ReadyHandler);
+  server->setServerEventHandler(ready);
+  server->setNumIOThreads(ioThreads);
+  server->setUseReusePortAcceptors(reusePort);
+
+  PlatformThreadFactory factory;
+  factory.setDetached(false);
+  shared_ptr<Thread> serverThread = factory.newThread(
+      shared_ptr<Runnable>(new ServerRunner(server)));
+  serverThread->start();
+  ready->wait();
+
+  int64_t start = Util::currentTime();
+  int64_t deadline = start + seconds * 1000;
+  std::vector<shared_ptr<StormClient> > runners;
+  std::vector<shared_ptr<Thread> > threads;
+  for (int i = 0; i < clients; ++i) {
+    runners.push_back(shared_ptr<StormClient>(new StormClient(server->getListenPort(), deadline)));
+    threads.push_back(factory.newThread(runners.back()));
+    threads.back()->start();
+  }
+
+  uint64_t total = 0;
+  for (int i = 0; i < clients; ++i) {
+    threads[i]->join();
+    total += runners[i]->connections();
+  }
+  double elapsed = (Util::currentTime() - start) / 1000.0;
+
+  server->stop();
+  serverThread->join();
+
+  double rate = total / elapsed;
+  cout << (reusePort ? "SO_REUSEPORT per IO thread: " : "accept on IO thread #0:     ")
+       << total << " connections, " << rate << " connections/s" << endl;
+  return rate;
+}
+
+int main(int argc, char** argv) {
+  int seconds = argc > 1 ? std::atoi(argv[1]) : 3;
+  int clients = argc > 2 ? std::atoi(argv[2]) : 16;
+  size_t ioThreads = argc > 3 ? static_cast<size_t>(std::atoi(argv[3])) : 4;
+
+  cout << clients << " clients, " << ioThreads << " IO threads, " << seconds << "s each" << endl;
+  double single = storm(false, seconds, clients, ioThreads);
+  double sharded = storm(true, seconds, clients, ioThreads);
+  cout << "speedup: " << sharded / single << "x" << endl;
+  return 0;
+}
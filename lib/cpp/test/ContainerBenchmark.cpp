@@ -0,0 +1,194 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Writes, reads and looks up the maps and the set of a struct generated
+ * with std::map and std::set, with cpp:containers=flat and with
+ * cpp:containers=hash.  The flat struct is also read from the bytes of the
+ * hash one, whose elements are not in key order.
+ *
+ * Usage: ContainerBenchmark [thousands of elements]
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <thrift/concurrency/Util.h>
+#include <thrift/protocol/TBinaryProtocol.h>
+#include <thrift/stdcxx.h>
+#include <thrift/transport/TBufferTransports.h>
+#include "gen-cpp/ContainerBenchmarkFlat_types.h"
+#include "gen-cpp/ContainerBenchmarkHash_types.h"
+#include "gen-cpp/ContainerBenchmarkStd_types.h"
+
+using namespace apache::thrift::protocol;
+using namespace apache::thrift::transport;
+using apache::thrift::concurrency::Util;
+using apache::thrift::stdcxx::shared_ptr;
+using std::cout;
+using std::endl;
+
+namespace ordered = thrift::test::containers::ordered;
+namespace flat = thrift::test::containers::flat;
+namespace hash = thrift::test::containers::hash;
+
+static const int rounds = 10;
+
+/// Keys in random order, and the same number of misses.
+struct Keys {
+  std::vector<int64_t> ids;
+  std::vector<std::string> names;
+  std::vector<int64_t> missingIds;
+  std::vector<std::string> missingNames;
+};
+
+static std::string name(int64_t id) {
+  std::ostringstream s;
+  s << "user-" << id;
+  return s.str();
+}
+
+static Keys makeKeys(int count) {
+  Keys keys;
+  std::srand(1);
+  for (int i = 0; i < count; ++i) {
+    int64_t id = (static_cast<int64_t>(std::rand()) << 16) ^ std::rand();
+    keys.ids.push_back(id * 2);
+    keys.names.push_back(name(id * 2));
+    keys.missingIds.push_back(id * 2 + 1);
+    keys.missingNames.push_back(name(id * 2 + 1));
+  }
+  return keys;
+}
+
+/// Inserts the keys one at a time, in random order.
+template <typename Index>
+static void fill(Index& index, const Keys& keys) {
+  for (size_t i = 0; i < keys.ids.size(); ++i) {
+    index.byId[keys.ids[i]] = static_cast<double>(i) / 2;
+    index.byName[keys.names[i]] = static_cast<int32_t>(i);
+    index.ids.insert(static_cast<int32_t>(keys.ids[i]));
+  }
+}
+
+/// Copies an ordered index, which is how a flat one is best built.
+template <typename Index>
+static void copy(Index& index, const ordered::Index& from) {
+  index.byId.insert(from.byId.begin(), from.byId.end());
+  index.byName.insert(from.byName.begin(), from.byName.end());
+  index.ids.insert(from.ids.begin(), from.ids.end());
+}
+
+static void report(const char* name, const char* what, int64_t usec, size_t ops) {
+  cout << "  " << std::left << std::setw(20) << name << std::setw(8) << what << std::right
+       << std::fixed << std::setprecision(1) << std::setw(10)
+       << static_cast<double>(usec) * 1000 / ops << " ns per element" << endl;
+}
+
+template <typename Index>
+static std::string timeWrite(const char* name, const Index& index) {
+  shared_ptr<TMemoryBuffer> buf(new TMemoryBuffer());
+  TBinaryProtocolT<TMemoryBuffer> prot(buf);
+  int64_t start = Util::currentTimeUsec();
+  for (int r = 0; r < rounds; ++r) {
+    buf->resetBuffer();
+    index.write(&prot);
+  }
+  size_t elements = index.byId.size() + index.byName.size() + index.ids.size();
+  report(name, "write", Util::currentTimeUsec() - start, elements * rounds);
+  return buf->getBufferAsString();
+}
+
+template <typename Index>
+static bool timeRead(const char* name, const std::string& bytes, const Index& expected) {
+  shared_ptr<TMemoryBuffer> buf(new TMemoryBuffer());
+  TBinaryProtocolT<TMemoryBuffer> prot(buf);
+  bool same = true;
+  int64_t start = Util::currentTimeUsec();
+  for (int r = 0; r < rounds; ++r) {
+    buf->resetBuffer(reinterpret_cast<uint8_t*>(const_cast<char*>(bytes.data())),
+                     static_cast<uint32_t>(bytes.size()));
+    Index index;
+    index.read(&prot);
+    same = same && index == expected;
+  }
+  size_t elements = expected.byId.size() + expected.byName.size() + expected.ids.size();
+  report(name, "read", Util::currentTimeUsec() - start, elements * rounds);
+  return same;
+}
+
+template <typename Index>
+static int64_t timeLookup(const char* name, const Index& index, const Keys& keys) {
+  int64_t found = 0;
+  int64_t start = Util::currentTimeUsec();
+  for (int r = 0; r < rounds; ++r) {
+    for (size_t i = 0; i < keys.ids.size(); ++i) {
+      found += index.byId.count(keys.ids[i]) + index.byId.count(keys.missingIds[i]);
+      found += index.byName.count(keys.names[i]) + index.byName.count(keys.missingNames[i]);
+      found += index.ids.count(static_cast<int32_t>(keys.ids[i]));
+    }
+  }
+  report(name, "lookup", Util::currentTimeUsec() - start, keys.ids.size() * 5 * rounds);
+  return found;
+}
+
+int main(int argc, char** argv) {
+  int count = (argc > 1 ? std::atoi(argv[1]) : 50) * 1000;
+  Keys keys = makeKeys(count);
+
+  ordered::Index stdIndex;
+  fill(stdIndex, keys);
+  flat::Index flatIndex;
+  copy(flatIndex, stdIndex);
+  hash::Index hashIndex;
+  fill(hashIndex, keys);
+
+  cout << stdIndex.byId.size() << " i64 keys, " << stdIndex.byName.size() << " string keys, "
+       << stdIndex.ids.size() << " i32 elements:" << endl;
+
+  std::string stdBytes = timeWrite("std::map/set", stdIndex);
+  std::string flatBytes = timeWrite("flat", flatIndex);
+  std::string hashBytes = timeWrite("hash", hashIndex);
+  if (flatBytes != stdBytes || hashBytes.size() != stdBytes.size()) {
+    cout << "encodings differ" << endl;
+    return 1;
+  }
+
+  bool same = timeRead("std::map/set", stdBytes, stdIndex);
+  same = timeRead("flat", flatBytes, flatIndex) && same;
+  same = timeRead("flat, unordered", hashBytes, flatIndex) && same;
+  same = timeRead("hash", hashBytes, hashIndex) && same;
+  if (!same) {
+    cout << "read mismatch" << endl;
+    return 1;
+  }
+
+  int64_t found = timeLookup("std::map/set", stdIndex, keys);
+  if (timeLookup("flat", flatIndex, keys) != found
+      || timeLookup("hash", hashIndex, keys) != found) {
+    cout << "lookup mismatch" << endl;
+    return 1;
+  }
+  return 0;
+}
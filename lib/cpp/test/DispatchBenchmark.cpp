@@ -0,0 +1,196 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Cost of dispatching calls through generated processors of services with 5,
+ * 50 and 500 methods, directly and through a TMultiplexedProcessor.  Calls
+ * are pre-encoded with TBinaryProtocol, go round-robin over all the methods
+ * of the service and are handled by the empty *Null handlers.  The cost of a
+ * std::map lookup of the same names is printed for reference.
+ *
+ * Usage: DispatchBenchmark [thousands of calls per measurement]
+ */
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <map>
+#include <string>
+#include <vector>
+
+#include <thrift/concurrency/Util.h>
+#include <thrift/processor/TMultiplexedProcessor.h>
+#include <thrift/protocol/TBinaryProtocol.h>
+#include <thrift/stdcxx.h>
+#include <thrift/transport/TBufferTransports.h>
+
+#include "gen-cpp/LargeService.h"
+#include "gen-cpp/MediumService.h"
+#include "gen-cpp/SmallService.h"
+
+using namespace apache::thrift;
+using namespace apache::thrift::protocol;
+using namespace apache::thrift::transport;
+using apache::thrift::concurrency::Util;
+using apache::thrift::stdcxx::shared_ptr;
+using std::cout;
+using std::endl;
+
+/**
+ * Returns the names of the first count methods of LargeService, which are
+ * also those of the smaller services.
+ */
+static std::vector<std::string> methodNames(size_t count) {
+  const char* verbs[] = {"get", "set", "list", "create", "update",
+                         "delete", "find", "count", "watch", "sync"};
+  const char* nouns[] = {"User", "Account", "Order", "Invoice", "Session",
+                         "Profile", "Group", "Role", "Token", "Device",
+                         "Address", "Payment", "Refund", "Product", "Category",
+                         "Review", "Cart", "Coupon", "Shipment", "Warehouse",
+                         "Report", "Alert", "Metric", "Quota", "Region"};
+  const char* suffixes[] = {"", "ById"};
+
+  std::vector<std::string> names;
+  for (size_t s = 0; s < sizeof(suffixes) / sizeof(suffixes[0]); ++s) {
+    for (size_t n = 0; n < sizeof(nouns) / sizeof(nouns[0]); ++n) {
+      for (size_t v = 0; v < sizeof(verbs) / sizeof(verbs[0]); ++v) {
+        names.push_back(std::string(verbs[v]) + nouns[n] + suffixes[s]);
+      }
+    }
+  }
+  names.resize(count);
+  return names;
+}
+
+static void measure(const char* label,
+                    shared_ptr<TProcessor> processor,
+                    const std::vector<std::string>& names,
+                    const std::string& prefix,
+                    int calls) {
+  // One buffer holding every call of a round, read back repeatedly.
+  shared_ptr<TMemoryBuffer> requests(new TMemoryBuffer());
+  TBinaryProtocol writer(requests);
+  for (size_t i = 0; i < names.size(); ++i) {
+    writer.writeMessageBegin(prefix + names[i], T_CALL, static_cast<int32_t>(i));
+    writer.writeStructBegin("args");
+    writer.writeFieldBegin("id", T_I32, 1);
+    writer.writeI32(static_cast<int32_t>(i));
+    writer.writeFieldEnd();
+    writer.writeFieldStop();
+    writer.writeStructEnd();
+    writer.writeMessageEnd();
+  }
+  std::string encoded = requests->getBufferAsString();
+
+  shared_ptr<TMemoryBuffer> in(new TMemoryBuffer());
+  shared_ptr<TMemoryBuffer> out(new TMemoryBuffer());
+  shared_ptr<TBinaryProtocol> iprot(new TBinaryProtocol(in));
+  shared_ptr<TBinaryProtocol> oprot(new TBinaryProtocol(out));
+
+  // Every call has to reach its method.
+  in->resetBuffer(reinterpret_cast<uint8_t*>(&encoded[0]), static_cast<uint32_t>(encoded.size()));
+  for (size_t i = 0; i < names.size(); ++i) {
+    processor->process(iprot, oprot, NULL);
+    std::string name;
+    TMessageType type;
+    int32_t seqid;
+    oprot->readMessageBegin(name, type, seqid);
+    if (type != T_REPLY || name != names[i]) {
+      cout << label << ": " << prefix << names[i] << " was not dispatched" << endl;
+      std::exit(1);
+    }
+    out->resetBuffer();
+  }
+
+  int rounds = static_cast<int>(calls / names.size()) + 1;
+  int64_t start = Util::currentTimeUsec();
+  for (int r = 0; r < rounds; ++r) {
+    in->resetBuffer(reinterpret_cast<uint8_t*>(&encoded[0]),
+                    static_cast<uint32_t>(encoded.size()));
+    out->resetBuffer();
+    for (size_t i = 0; i < names.size(); ++i) {
+      processor->process(iprot, oprot, NULL);
+    }
+  }
+  int64_t usec = Util::currentTimeUsec() - start;
+
+  cout << "  " << std::left << std::setw(14) << label << std::right << std::fixed
+       << std::setprecision(1) << std::setw(8)
+       << usec * 1000.0 / (static_cast<double>(rounds) * names.size()) << " ns/call" << endl;
+}
+
+static void measureMap(const std::vector<std::string>& names, int calls) {
+  std::map<std::string, size_t> map;
+  for (size_t i = 0; i < names.size(); ++i) {
+    map[names[i]] = i;
+  }
+
+  int rounds = static_cast<int>(calls / names.size()) + 1;
+  volatile size_t sink = 0;
+  int64_t start = Util::currentTimeUsec();
+  for (int r = 0; r < rounds; ++r) {
+    for (size_t i = 0; i < names.size(); ++i) {
+      sink = map.find(names[i])->second;
+    }
+  }
+  int64_t usec = Util::currentTimeUsec() - start;
+
+  cout << "  " << std::left << std::setw(14) << "std::map find" << std::right << std::fixed
+       << std::setprecision(1) << std::setw(8)
+       << usec * 1000.0 / (static_cast<double>(rounds) * names.size()) << " ns/lookup" << endl;
+  (void)sink;
+}
+
+static void run(const char* service, size_t methods, shared_ptr<TProcessor> processor, int calls) {
+  std::vector<std::string> names = methodNames(methods);
+  cout << service << " (" << names.size() << " methods):" << endl;
+
+  shared_ptr<TMultiplexedProcessor> multiplexed(new TMultiplexedProcessor());
+  multiplexed->registerProcessor("Other", processor);
+  multiplexed->registerProcessor(service, processor);
+  multiplexed->registerProcessor("Another", processor);
+
+  measure("direct", processor, names, "", calls);
+  measure("multiplexed", multiplexed, names, std::string(service) + ":", calls);
+  measureMap(names, calls);
+}
+
+int main(int argc, char** argv) {
+  int calls = (argc > 1 ? std::atoi(argv[1]) : 1000) * 1000;
+
+  run("SmallService",
+      5,
+      shared_ptr<TProcessor>(new thrift::test::dispatch::SmallServiceProcessor(
+          shared_ptr<thrift::test::dispatch::SmallServiceIf>(
+              new thrift::test::dispatch::SmallServiceNull()))),
+      calls);
+  run("MediumService",
+      50,
+      shared_ptr<TProcessor>(new thrift::test::dispatch::MediumServiceProcessor(
+          shared_ptr<thrift::test::dispatch::MediumServiceIf>(
+              new thrift::test::dispatch::MediumServiceNull()))),
+      calls);
+  run("LargeService",
+      500,
+      shared_ptr<TProcessor>(new thrift::test::dispatch::LargeServiceProcessor(
+          shared_ptr<thrift::test::dispatch::LargeServiceIf>(
+              new thrift::test::dispatch::LargeServiceNull()))),
+      calls);
+  return 0;
+}
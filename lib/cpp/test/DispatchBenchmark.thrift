@@ -0,0 +1,589 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Services of 5, 50 and 500 methods, named like real APIs so that many
+ * names share prefixes and lengths, for DispatchBenchmark.
+ */
+
+namespace cpp thrift.test.dispatch
+
+service SmallService {
+  void getUser(1: i32 id)
+  void setUser(1: i32 id)
+  void listUser(1: i32 id)
+  void createUser(1: i32 id)
+  void updateUser(1: i32 id)
+}
+
+service MediumService {
+  void getUser(1: i32 id)
+  void setUser(1: i32 id)
+  void listUser(1: i32 id)
+  void createUser(1: i32 id)
+  void updateUser(1: i32 id)
+  void deleteUser(1: i32 id)
+  void findUser(1: i32 id)
+  void countUser(1: i32 id)
+  void watchUser(1: i32 id)
+  void syncUser(1: i32 id)
+  void getAccount(1: i32 id)
+  void setAccount(1: i32 id)
+  void listAccount(1: i32 id)
+  void createAccount(1: i32 id)
+  void updateAccount(1: i32 id)
+  void deleteAccount(1: i32 id)
+  void findAccount(1: i32 id)
+  void countAccount(1: i32 id)
+  void watchAccount(1: i32 id)
+  void syncAccount(1: i32 id)
+  void getOrder(1: i32 id)
+  void setOrder(1: i32 id)
+  void listOrder(1: i32 id)
+  void createOrder(1: i32 id)
+  void updateOrder(1: i32 id)
+  void deleteOrder(1: i32 id)
+  void findOrder(1: i32 id)
+  void countOrder(1: i32 id)
+  void watchOrder(1: i32 id)
+  void syncOrder(1: i32 id)
+  void getInvoice(1: i32 id)
+  void setInvoice(1: i32 id)
+  void listInvoice(1: i32 id)
+  void createInvoice(1: i32 id)
+  void updateInvoice(1: i32 id)
+  void deleteInvoice(1: i32 id)
+  void findInvoice(1: i32 id)
+  void countInvoice(1: i32 id)
+  void watchInvoice(1: i32 id)
+  void syncInvoice(1: i32 id)
+  void getSession(1: i32 id)
+  void setSession(1: i32 id)
+  void listSession(1: i32 id)
+  void createSession(1: i32 id)
+  void updateSession(1: i32 id)
+  void deleteSession(1: i32 id)
+  void findSession(1: i32 id)
+  void countSession(1: i32 id)
+  void watchSession(1: i32 id)
+  void syncSession(1: i32 id)
+}
+
+service LargeService {
+  void getUser(1: i32 id)
+  void setUser(1: i32 id)
+  void listUser(1: i32 id)
+  void createUser(1: i32 id)
+  void updateUser(1: i32 id)
+  void deleteUser(1: i32 id)
+  void findUser(1: i32 id)
+  void countUser(1: i32 id)
+  void watchUser(1: i32 id)
+  void syncUser(1: i32 id)
+  void getAccount(1: i32 id)
+  void setAccount(1: i32 id)
+  void listAccount(1: i32 id)
+  void createAccount(1: i32 id)
+  void updateAccount(1: i32 id)
+  void deleteAccount(1: i32 id)
+  void findAccount(1: i32 id)
+  void countAccount(1: i32 id)
+  void watchAccount(1: i32 id)
+  void syncAccount(1: i32 id)
+  void getOrder(1: i32 id)
+  void setOrder(1: i32 id)
+  void listOrder(1: i32 id)
+  void createOrder(1: i32 id)
+  void updateOrder(1: i32 id)
+  void deleteOrder(1: i32 id)
+  void findOrder(1: i32 id)
+  void countOrder(1: i32 id)
+  void watchOrder(1: i32 id)
+  void syncOrder(1: i32 id)
+  void getInvoice(1: i32 id)
+  void setInvoice(1: i32 id)
+  void listInvoice(1: i32 id)
+  void createInvoice(1: i32 id)
+  void updateInvoice(1: i32 id)
+  void deleteInvoice(1: i32 id)
+  void findInvoice(1: i32 id)
+  void countInvoice(1: i32 id)
+  void watchInvoice(1: i32 id)
+  void syncInvoice(1: i32 id)
+  void getSession(1: i32 id)
+  void setSession(1: i32 id)
+  void listSession(1: i32 id)
+  void createSession(1: i32 id)
+  void updateSession(1: i32 id)
+  void deleteSession(1: i32 id)
+  void findSession(1: i32 id)
+  void countSession(1: i32 id)
+  void watchSession(1: i32 id)
+  void syncSession(1: i32 id)
+  void getProfile(1: i32 id)
+  void setProfile(1: i32 id)
+  void listProfile(1: i32 id)
+  void createProfile(1: i32 id)
+  void updateProfile(1: i32 id)
+  void deleteProfile(1: i32 id)
+  void findProfile(1: i32 id)
+  void countProfile(1: i32 id)
+  void watchProfile(1: i32 id)
+  void syncProfile(1: i32 id)
+  void getGroup(1: i32 id)
+  void setGroup(1: i32 id)
+  void listGroup(1: i32 id)
+  void createGroup(1: i32 id)
+  void updateGroup(1: i32 id)
+  void deleteGroup(1: i32 id)
+  void findGroup(1: i32 id)
+  void countGroup(1: i32 id)
+  void watchGroup(1: i32 id)
+  void syncGroup(1: i32 id)
+  void getRole(1: i32 id)
+  void setRole(1: i32 id)
+  void listRole(1: i32 id)
+  void createRole(1: i32 id)
+  void updateRole(1: i32 id)
+  void deleteRole(1: i32 id)
+  void findRole(1: i32 id)
+  void countRole(1: i32 id)
+  void watchRole(1: i32 id)
+  void syncRole(1: i32 id)
+  void getToken(1: i32 id)
+  void setToken(1: i32 id)
+  void listToken(1: i32 id)
+  void createToken(1: i32 id)
+  void updateToken(1: i32 id)
+  void deleteToken(1: i32 id)
+  void findToken(1: i32 id)
+  void countToken(1: i32 id)
+  void watchToken(1: i32 id)
+  void syncToken(1: i32 id)
+  void getDevice(1: i32 id)
+  void setDevice(1: i32 id)
+  void listDevice(1: i32 id)
+  void createDevice(1: i32 id)
+  void updateDevice(1: i32 id)
+  void deleteDevice(1: i32 id)
+  void findDevice(1: i32 id)
+  void countDevice(1: i32 id)
+  void watchDevice(1: i32 id)
+  void syncDevice(1: i32 id)
+  void getAddress(1: i32 id)
+  void setAddress(1: i32 id)
+  void listAddress(1: i32 id)
+  void createAddress(1: i32 id)
+  void updateAddress(1: i32 id)
+  void deleteAddress(1: i32 id)
+  void findAddress(1: i32 id)
+  void countAddress(1: i32 id)
+  void watchAddress(1: i32 id)
+  void syncAddress(1: i32 id)
+  void getPayment(1: i32 id)
+  void setPayment(1: i32 id)
+  void listPayment(1: i32 id)
+  void createPayment(1: i32 id)
+  void updatePayment(1: i32 id)
+  void deletePayment(1: i32 id)
+  void findPayment(1: i32 id)
+  void countPayment(1: i32 id)
+  void watchPayment(1: i32 id)
+  void syncPayment(1: i32 id)
+  void getRefund(1: i32 id)
+  void setRefund(1: i32 id)
+  void listRefund(1: i32 id)
+  void createRefund(1: i32 id)
+  void updateRefund(1: i32 id)
+  void deleteRefund(1: i32 id)
+  void findRefund(1: i32 id)
+  void countRefund(1: i32 id)
+  void watchRefund(1: i32 id)
+  void syncRefund(1: i32 id)
+  void getProduct(1: i32 id)
+  void setProduct(1: i32 id)
+  void listProduct(1: i32 id)
+  void createProduct(1: i32 id)
+  void updateProduct(1: i32 id)
+  void deleteProduct(1: i32 id)
+  void findProduct(1: i32 id)
+  void countProduct(1: i32 id)
+  void watchProduct(1: i32 id)
+  void syncProduct(1: i32 id)
+  void getCategory(1: i32 id)
+  void setCategory(1: i32 id)
+  void listCategory(1: i32 id)
+  void createCategory(1: i32 id)
+  void updateCategory(1: i32 id)
+  void deleteCategory(1: i32 id)
+  void findCategory(1: i32 id)
+  void countCategory(1: i32 id)
+  void watchCategory(1: i32 id)
+  void syncCategory(1: i32 id)
+  void getReview(1: i32 id)
+  void setReview(1: i32 id)
+  void listReview(1: i32 id)
+  void createReview(1: i32 id)
+  void updateReview(1: i32 id)
+  void deleteReview(1: i32 id)
+  void findReview(1: i32 id)
+  void countReview(1: i32 id)
+  void watchReview(1: i32 id)
+  void syncReview(1: i32 id)
+  void getCart(1: i32 id)
+  void setCart(1: i32 id)
+  void listCart(1: i32 id)
+  void createCart(1: i32 id)
+  void updateCart(1: i32 id)
+  void deleteCart(1: i32 id)
+  void findCart(1: i32 id)
+  void countCart(1: i32 id)
+  void watchCart(1: i32 id)
+  void syncCart(1: i32 id)
+  void getCoupon(1: i32 id)
+  void setCoupon(1: i32 id)
+  void listCoupon(1: i32 id)
+  void createCoupon(1: i32 id)
+  void updateCoupon(1: i32 id)
+  void deleteCoupon(1: i32 id)
+  void findCoupon(1: i32 id)
+  void countCoupon(1: i32 id)
+  void watchCoupon(1: i32 id)
+  void syncCoupon(1: i32 id)
+  void getShipment(1: i32 id)
+  void setShipment(1: i32 id)
+  void listShipment(1: i32 id)
+  void createShipment(1: i32 id)
+  void updateShipment(1: i32 id)
+  void deleteShipment(1: i32 id)
+  void findShipment(1: i32 id)
+  void countShipment(1: i32 id)
+  void watchShipment(1: i32 id)
+  void syncShipment(1: i32 id)
+  void getWarehouse(1: i32 id)
+  void setWarehouse(1: i32 id)
+  void listWarehouse(1: i32 id)
+  void createWarehouse(1: i32 id)
+  void updateWarehouse(1: i32 id)
+  void deleteWarehouse(1: i32 id)
+  void findWarehouse(1: i32 id)
+  void countWarehouse(1: i32 id)
+  void watchWarehouse(1: i32 id)
+  void syncWarehouse(1: i32 id)
+  void getReport(1: i32 id)
+  void setReport(1: i32 id)
+  void listReport(1: i32 id)
+  void createReport(1: i32 id)
+  void updateReport(1: i32 id)
+  void deleteReport(1: i32 id)
+  void findReport(1: i32 id)
+  void countReport(1: i32 id)
+  void watchReport(1: i32 id)
+  void syncReport(1: i32 id)
+  void getAlert(1: i32 id)
+  void setAlert(1: i32 id)
+  void listAlert(1: i32 id)
+  void createAlert(1: i32 id)
+  void updateAlert(1: i32 id)
+  void deleteAlert(1: i32 id)
+  void findAlert(1: i32 id)
+  void countAlert(1: i32 id)
+  void watchAlert(1: i32 id)
+  void syncAlert(1: i32 id)
+  void getMetric(1: i32 id)
+  void setMetric(1: i32 id)
+  void listMetric(1: i32 id)
+  void createMetric(1: i32 id)
+  void updateMetric(1: i32 id)
+  void deleteMetric(1: i32 id)
+  void findMetric(1: i32 id)
+  void countMetric(1: i32 id)
+  void watchMetric(1: i32 id)
+  void syncMetric(1: i32 id)
+  void getQuota(1: i32 id)
+  void setQuota(1: i32 id)
+  void listQuota(1: i32 id)
+  void createQuota(1: i32 id)
+  void updateQuota(1: i32 id)
+  void deleteQuota(1: i32 id)
+  void findQuota(1: i32 id)
+  void countQuota(1: i32 id)
+  void watchQuota(1: i32 id)
+  void syncQuota(1: i32 id)
+  void getRegion(1: i32 id)
+  void setRegion(1: i32 id)
+  void listRegion(1: i32 id)
+  void createRegion(1: i32 id)
+  void updateRegion(1: i32 id)
+  void deleteRegion(1: i32 id)
+  void findRegion(1: i32 id)
+  void countRegion(1: i32 id)
+  void watchRegion(1: i32 id)
+  void syncRegion(1: i32 id)
+  void getUserById(1: i32 id)
+  void setUserById(1: i32 id)
+  void listUserById(1: i32 id)
+  void createUserById(1: i32 id)
+  void updateUserById(1: i32 id)
+  void deleteUserById(1: i32 id)
+  void findUserById(1: i32 id)
+  void countUserById(1: i32 id)
+  void watchUserById(1: i32 id)
+  void syncUserById(1: i32 id)
+  void getAccountById(1: i32 id)
+  void setAccountById(1: i32 id)
+  void listAccountById(1: i32 id)
+  void createAccountById(1: i32 id)
+  void updateAccountById(1: i32 id)
+  void deleteAccountById(1: i32 id)
+  void findAccountById(1: i32 id)
+  void countAccountById(1: i32 id)
+  void watchAccountById(1: i32 id)
+  void syncAccountById(1: i32 id)
+  void getOrderById(1: i32 id)
+  void setOrderById(1: i32 id)
+  void listOrderById(1: i32 id)
+  void createOrderById(1: i32 id)
+  void updateOrderById(1: i32 id)
+  void deleteOrderById(1: i32 id)
+  void findOrderById(1: i32 id)
+  void countOrderById(1: i32 id)
+  void watchOrderById(1: i32 id)
+  void syncOrderById(1: i32 id)
+  void getInvoiceById(1: i32 id)
+  void setInvoiceById(1: i32 id)
+  void listInvoiceById(1: i32 id)
+  void createInvoiceById(1: i32 id)
+  void updateInvoiceById(1: i32 id)
+  void deleteInvoiceById(1: i32 id)
+  void findInvoiceById(1: i32 id)
+  void countInvoiceById(1: i32 id)
+  void watchInvoiceById(1: i32 id)
+  void syncInvoiceById(1: i32 id)
+  void getSessionById(1: i32 id)
+  void setSessionById(1: i32 id)
+  void listSessionById(1: i32 id)
+  void createSessionById(1: i32 id)
+  void updateSessionById(1: i32 id)
+  void deleteSessionById(1: i32 id)
+  void findSessionById(1: i32 id)
+  void countSessionById(1: i32 id)
+  void watchSessionById(1: i32 id)
+  void syncSessionById(1: i32 id)
+  void getProfileById(1: i32 id)
+  void setProfileById(1: i32 id)
+  void listProfileById(1: i32 id)
+  void createProfileById(1: i32 id)
+  void updateProfileById(1: i32 id)
+  void deleteProfileById(1: i32 id)
+  void findProfileById(1: i32 id)
+  void countProfileById(1: i32 id)
+  void watchProfileById(1: i32 id)
+  void syncProfileById(1: i32 id)
+  void getGroupById(1: i32 id)
+  void setGroupById(1: i32 id)
+  void listGroupById(1: i32 id)
+  void createGroupById(1: i32 id)
+  void updateGroupById(1: i32 id)
+  void deleteGroupById(1: i32 id)
+  void findGroupById(1: i32 id)
+  void countGroupById(1: i32 id)
+  void watchGroupById(1: i32 id)
+  void syncGroupById(1: i32 id)
+  void getRoleById(1: i32 id)
+  void setRoleById(1: i32 id)
+  void listRoleById(1: i32 id)
+  void createRoleById(1: i32 id)
+  void updateRoleById(1: i32 id)
+  void deleteRoleById(1: i32 id)
+  void findRoleById(1: i32 id)
+  void countRoleById(1: i32 id)
+  void watchRoleById(1: i32 id)
+  void syncRoleById(1: i32 id)
+  void getTokenById(1: i32 id)
+  void setTokenById(1: i32 id)
+  void listTokenById(1: i32 id)
+  void createTokenById(1: i32 id)
+  void updateTokenById(1: i32 id)
+  void deleteTokenById(1: i32 id)
+  void findTokenById(1: i32 id)
+  void countTokenById(1: i32 id)
+  void watchTokenById(1: i32 id)
+  void syncTokenById(1: i32 id)
+  void getDeviceById(1: i32 id)
+  void setDeviceById(1: i32 id)
+  void listDeviceById(1: i32 id)
+  void createDeviceById(1: i32 id)
+  void updateDeviceById(1: i32 id)
+  void deleteDeviceById(1: i32 id)
+  void findDeviceById(1: i32 id)
+  void countDeviceById(1: i32 id)
+  void watchDeviceById(1: i32 id)
+  void syncDeviceById(1: i32 id)
+  void getAddressById(1: i32 id)
+  void setAddressById(1: i32 id)
+  void listAddressById(1: i32 id)
+  void createAddressById(1: i32 id)
+  void updateAddressById(1: i32 id)
+  void deleteAddressById(1: i32 id)
+  void findAddressById(1: i32 id)
+  void countAddressById(1: i32 id)
+  void watchAddressById(1: i32 id)
+  void syncAddressById(1: i32 id)
+  void getPaymentById(1: i32 id)
+  void setPaymentById(1: i32 id)
+  void listPaymentById(1: i32 id)
+  void createPaymentById(1: i32 id)
+  void updatePaymentById(1: i32 id)
+  void deletePaymentById(1: i32 id)
+  void findPaymentById(1: i32 id)
+  void countPaymentById(1: i32 id)
+  void watchPaymentById(1: i32 id)
+  void syncPaymentById(1: i32 id)
+  void getRefundById(1: i32 id)
+  void setRefundById(1: i32 id)
+  void listRefundById(1: i32 id)
+  void createRefundById(1: i32 id)
+  void updateRefundById(1: i32 id)
+  void deleteRefundById(1: i32 id)
+  void findRefundById(1: i32 id)
+  void countRefundById(1: i32 id)
+  void watchRefundById(1: i32 id)
+  void syncRefundById(1: i32 id)
+  void getProductById(1: i32 id)
+  void setProductById(1: i32 id)
+  void listProductById(1: i32 id)
+  void createProductById(1: i32 id)
+  void updateProductById(1: i32 id)
+  void deleteProductById(1: i32 id)
+  void findProductById(1: i32 id)
+  void countProductById(1: i32 id)
+  void watchProductById(1: i32 id)
+  void syncProductById(1: i32 id)
+  void getCategoryById(1: i32 id)
+  void setCategoryById(1: i32 id)
+  void listCategoryById(1: i32 id)
+  void createCategoryById(1: i32 id)
+  void updateCategoryById(1: i32 id)
+  void deleteCategoryById(1: i32 id)
+  void findCategoryById(1: i32 id)
+  void countCategoryById(1: i32 id)
+  void watchCategoryById(1: i32 id)
+  void syncCategoryById(1: i32 id)
+  void getReviewById(1: i32 id)
+  void setReviewById(1: i32 id)
+  void listReviewById(1: i32 id)
+  void createReviewById(1: i32 id)
+  void updateReviewById(1: i32 id)
+  void deleteReviewById(1: i32 id)
+  void findReviewById(1: i32 id)
+  void countReviewById(1: i32 id)
+  void watchReviewById(1: i32 id)
+  void syncReviewById(1: i32 id)
+  void getCartById(1: i32 id)
+  void setCartById(1: i32 id)
+  void listCartById(1: i32 id)
+  void createCartById(1: i32 id)
+  void updateCartById(1: i32 id)
+  void deleteCartById(1: i32 id)
+  void findCartById(1: i32 id)
+  void countCartById(1: i32 id)
+  void watchCartById(1: i32 id)
+  void syncCartById(1: i32 id)
+  void getCouponById(1: i32 id)
+  void setCouponById(1: i32 id)
+  void listCouponById(1: i32 id)
+  void createCouponById(1: i32 id)
+  void updateCouponById(1: i32 id)
+  void deleteCouponById(1: i32 id)
+  void findCouponById(1: i32 id)
+  void countCouponById(1: i32 id)
+  void watchCouponById(1: i32 id)
+  void syncCouponById(1: i32 id)
+  void getShipmentById(1: i32 id)
+  void setShipmentById(1: i32 id)
+  void listShipmentById(1: i32 id)
+  void createShipmentById(1: i32 id)
+  void updateShipmentById(1: i32 id)
+  void deleteShipmentById(1: i32 id)
+  void findShipmentById(1: i32 id)
+  void countShipmentById(1: i32 id)
+  void watchShipmentById(1: i32 id)
+  void syncShipmentById(1: i32 id)
+  void getWarehouseById(1: i32 id)
+  void setWarehouseById(1: i32 id)
+  void listWarehouseById(1: i32 id)
+  void createWarehouseById(1: i32 id)
+  void updateWarehouseById(1: i32 id)
+  void deleteWarehouseById(1: i32 id)
+  void findWarehouseById(1: i32 id)
+  void countWarehouseById(1: i32 id)
+  void watchWarehouseById(1: i32 id)
+  void syncWarehouseById(1: i32 id)
+  void getReportById(1: i32 id)
+  void setReportById(1: i32 id)
+  void listReportById(1: i32 id)
+  void createReportById(1: i32 id)
+  void updateReportById(1: i32 id)
+  void deleteReportById(1: i32 id)
+  void findReportById(1: i32 id)
+  void countReportById(1: i32 id)
+  void watchReportById(1: i32 id)
+  void syncReportById(1: i32 id)
+  void getAlertById(1: i32 id)
+  void setAlertById(1: i32 id)
+  void listAlertById(1: i32 id)
+  void createAlertById(1: i32 id)
+  void updateAlertById(1: i32 id)
+  void deleteAlertById(1: i32 id)
+  void findAlertById(1: i32 id)
+  void countAlertById(1: i32 id)
+  void watchAlertById(1: i32 id)
+  void syncAlertById(1: i32 id)
+  void getMetricById(1: i32 id)
+  void setMetricById(1: i32 id)
+  void listMetricById(1: i32 id)
+  void createMetricById(1: i32 id)
+  void updateMetricById(1: i32 id)
+  void deleteMetricById(1: i32 id)
+  void findMetricById(1: i32 id)
+  void countMetricById(1: i32 id)
+  void watchMetricById(1: i32 id)
+  void syncMetricById(1: i32 id)
+  void getQuotaById(1: i32 id)
+  void setQuotaById(1: i32 id)
+  void listQuotaById(1: i32 id)
+  void createQuotaById(1: i32 id)
+  void updateQuotaById(1: i32 id)
+  void deleteQuotaById(1: i32 id)
+  void findQuotaById(1: i32 id)
+  void countQuotaById(1: i32 id)
+  void watchQuotaById(1: i32 id)
+  void syncQuotaById(1: i32 id)
+  void getRegionById(1: i32 id)
+  void setRegionById(1: i32 id)
+  void listRegionById(1: i32 id)
+  void createRegionById(1: i32 id)
+  void updateRegionById(1: i32 id)
+  void deleteRegionById(1: i32 id)
+  void findRegionById(1: i32 id)
+  void countRegionById(1: i32 id)
+  void watchRegionById(1: i32 id)
+  void syncRegionById(1: i32 id)
+}
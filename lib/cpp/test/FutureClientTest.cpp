@@ -0,0 +1,271 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#define BOOST_TEST_MODULE FutureClientTest
+#include <boost/test/unit_test.hpp>
+
+#include "thrift/async/TFramedClientChannel.h"
+#include "thrift/async/TFuture.h"
+#include "thrift/concurrency/Monitor.h"
+#include "thrift/concurrency/Thread.h"
+#include "thrift/protocol/TBinaryProtocol.h"
+#include "thrift/server/TNonblockingServer.h"
+#include "thrift/transport/TNonblockingServerSocket.h"
+#include "thrift/stdcxx.h"
+
+#include "gen-cpp/ParentService.h"
+
+#include <event.h>
+#include <vector>
+
+using apache::thrift::async::TFramedClientChannel;
+using apache::thrift::async::TFuture;
+using apache::thrift::async::TPromise;
+using apache::thrift::concurrency::Guard;
+using apache::thrift::concurrency::Monitor;
+using apache::thrift::concurrency::Mutex;
+using apache::thrift::concurrency::PlatformThreadFactory;
+using apache::thrift::concurrency::Runnable;
+using apache::thrift::concurrency::Synchronized;
+using apache::thrift::concurrency::Thread;
+using apache::thrift::protocol::TBinaryProtocolFactory;
+using apache::thrift::protocol::TProtocolFactory;
+using apache::thrift::server::TServerEventHandler;
+using apache::thrift::stdcxx::function;
+using apache::thrift::stdcxx::shared_ptr;
+using apache::thrift::transport::TTransportException;
+
+using namespace apache::thrift;
+
+BOOST_AUTO_TEST_CASE(promise_value) {
+  TPromise<int> promise;
+  TFuture<int> future = promise.getFuture();
+  BOOST_CHECK(future.valid());
+  BOOST_CHECK(!future.isReady());
+  promise.setValue(42);
+  BOOST_CHECK(future.isReady());
+  BOOST_CHECK_EQUAL(future.get(), 42);
+  BOOST_CHECK_EQUAL(future.get(), 42);
+  BOOST_CHECK_THROW(promise.setValue(43), TException);
+}
+
+BOOST_AUTO_TEST_CASE(promise_exception) {
+  TPromise<void> promise;
+  TFuture<void> future = promise.getFuture();
+  promise.setException(test::MyError());
+  // A failed future throws on every get().
+  BOOST_CHECK_THROW(future.get(), test::MyError);
+  BOOST_CHECK_THROW(future.get(), test::MyError);
+  BOOST_CHECK_THROW(promise.setValue(), TException);
+}
+
+static void addValue(int* sum, const TFuture<int>& future) {
+  *sum += future.get();
+}
+
+BOOST_AUTO_TEST_CASE(future_then) {
+  int sum = 0;
+  TPromise<int> promise;
+  promise.getFuture().then(apache::thrift::stdcxx::bind(addValue, &sum, apache::thrift::stdcxx::placeholders::_1));
+  BOOST_CHECK_EQUAL(sum, 0);
+  promise.setValue(3);
+  BOOST_CHECK_EQUAL(sum, 3);
+
+  // Continuations of a ready future run right away.
+  promise.getFuture().then(apache::thrift::stdcxx::bind(addValue, &sum, apache::thrift::stdcxx::placeholders::_1));
+  BOOST_CHECK_EQUAL(sum, 6);
+}
+
+/**
+ * Holds the getDataWait calls until a whole batch has arrived, then answers
+ * them last first, so that the client gets its replies out of order.
+ */
+class Handler : public test::ParentServiceCobSvNull {
+public:
+  typedef function<void(std::string const& _return)> DataCob;
+
+  Handler() : batch_(1) {}
+
+  void setBatch(size_t batch) {
+    Guard g(mutex_);
+    batch_ = batch;
+  }
+
+  void getDataWait(DataCob cob, const int32_t length) {
+    std::vector<std::pair<DataCob, int32_t> > calls;
+    {
+      Guard g(mutex_);
+      calls_.push_back(std::make_pair(cob, length));
+      if (calls_.size() < batch_) {
+        return;
+      }
+      calls.swap(calls_);
+    }
+    for (size_t i = calls.size(); i-- > 0;) {
+      calls[i].first(std::string(calls[i].second, 'x'));
+    }
+  }
+
+  void exceptionWait(function<void()> cob,
+                     function<void(TDelayedException* _throw)> exn_cob,
+                     const std::string& message) {
+    (void)cob;
+    test::MyError error;
+    error.message = message;
+    exn_cob(TDelayedException::delayException(error));
+  }
+
+private:
+  Mutex mutex_;
+  size_t batch_;
+  std::vector<std::pair<DataCob, int32_t> > calls_;
+};
+
+class Fixture {
+private:
+  struct ListenEventHandler : public TServerEventHandler {
+    ListenEventHandler() : ready_(false) {}
+
+    void preServe() /* override */ {
+      Synchronized s(monitor_);
+      ready_ = true;
+      monitor_.notify();
+    }
+
+    Monitor monitor_;
+    bool ready_;
+  };
+
+  struct ServerRunner : public Runnable {
+    shared_ptr<server::TNonblockingServer> server;
+    void run() { server->serve(); }
+  };
+
+  struct LoopRunner : public Runnable {
+    event_base* eventBase;
+    void run() { event_base_dispatch(eventBase); }
+  };
+
+  static shared_ptr<Thread> newThread(const shared_ptr<Runnable>& runnable) {
+    PlatformThreadFactory threadFactory(
+#if !USE_BOOST_THREAD && !USE_STD_THREAD
+        PlatformThreadFactory::OTHER, PlatformThreadFactory::NORMAL,
+        1,
+#endif
+        false);
+    return threadFactory.newThread(runnable);
+  }
+
+protected:
+  Fixture() : handler(new Handler), protocolFactory(new TBinaryProtocolFactory) {
+    shared_ptr<ServerRunner> runner(new ServerRunner);
+    runner->server.reset(
+        new server::TNonblockingServer(shared_ptr<async::TAsyncProcessor>(
+                                           new test::ParentServiceAsyncProcessor(handler)),
+                                       protocolFactory,
+                                       shared_ptr<transport::TNonblockingServerSocket>(
+                                           new transport::TNonblockingServerSocket(0))));
+    runner->server->setMaxPipelinedRequests(256);
+    shared_ptr<ListenEventHandler> listenHandler(new ListenEventHandler);
+    runner->server->setServerEventHandler(listenHandler);
+    server = runner->server;
+
+    serverThread = newThread(runner);
+    serverThread->start();
+    {
+      Synchronized s(listenHandler->monitor_);
+      while (!listenHandler->ready_) {
+        listenHandler->monitor_.waitForever();
+      }
+    }
+
+    eventBase = event_base_new();
+    channel.reset(new TFramedClientChannel("localhost", server->getListenPort(), eventBase,
+                                           protocolFactory));
+    client.reset(new test::ParentServiceFutureClient(channel, protocolFactory));
+
+    shared_ptr<LoopRunner> loop(new LoopRunner);
+    loop->eventBase = eventBase;
+    loopThread = newThread(loop);
+    loopThread->start();
+  }
+
+  ~Fixture() {
+    // Closing the channel leaves the event loop with nothing to wait for.
+    channel->close();
+    loopThread->join();
+    client.reset();
+    channel.reset();
+    event_base_free(eventBase);
+
+    server->stop();
+    serverThread->join();
+  }
+
+  shared_ptr<Handler> handler;
+  shared_ptr<TProtocolFactory> protocolFactory;
+  shared_ptr<server::TNonblockingServer> server;
+  shared_ptr<Thread> serverThread;
+  event_base* eventBase;
+  shared_ptr<TFramedClientChannel> channel;
+  shared_ptr<test::ParentServiceFutureClient> client;
+  shared_ptr<Thread> loopThread;
+};
+
+BOOST_FIXTURE_TEST_SUITE(FutureClientTest, Fixture)
+
+BOOST_AUTO_TEST_CASE(many_calls_in_flight) {
+  const int32_t calls = 200;
+  handler->setBatch(calls);
+
+  std::vector<TFuture<std::string> > futures;
+  for (int32_t i = 0; i < calls; ++i) {
+    futures.push_back(client->getDataWait(i));
+  }
+  for (int32_t i = 0; i < calls; ++i) {
+    BOOST_CHECK_EQUAL(futures[i].get().size(), static_cast<size_t>(i));
+  }
+  BOOST_CHECK(channel->good());
+}
+
+BOOST_AUTO_TEST_CASE(declared_exception) {
+  TFuture<void> future = client->exceptionWait("boom");
+  try {
+    future.get();
+    BOOST_FAIL("expected MyError");
+  } catch (const test::MyError& e) {
+    BOOST_CHECK_EQUAL(e.message, "boom");
+  }
+
+  // The connection goes on after a failed call.
+  BOOST_CHECK_EQUAL(client->getDataWait(5).get(), std::string(5, 'x'));
+}
+
+BOOST_AUTO_TEST_CASE(close_fails_outstanding_calls) {
+  // The handler never answers a call short of a full batch.
+  handler->setBatch(1000);
+  TFuture<std::string> pending = client->getDataWait(1);
+
+  channel->close();
+  BOOST_CHECK_THROW(pending.get(), TTransportException);
+  BOOST_CHECK(channel->error());
+  BOOST_CHECK_THROW(client->getDataWait(1).get(), TTransportException);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
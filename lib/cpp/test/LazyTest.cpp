@@ -0,0 +1,268 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#define BOOST_TEST_MODULE LazyTest
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+
+#include <thrift/protocol/TBinaryProtocol.h>
+#include <thrift/protocol/TCompactProtocol.h>
+#include <thrift/protocol/TJSONProtocol.h>
+#include <thrift/stdcxx.h>
+#include <thrift/transport/TBufferTransports.h>
+
+#include "gen-cpp/LazyTest_types.h"
+
+using apache::thrift::protocol::TBinaryProtocol;
+using apache::thrift::protocol::TCompactProtocol;
+using apache::thrift::protocol::TJSONProtocol;
+using apache::thrift::stdcxx::shared_ptr;
+using apache::thrift::transport::TFramedTransport;
+using apache::thrift::transport::TMemoryBuffer;
+using namespace thrift::test::lazy;
+
+static Payload makePayload(int64_t id) {
+  Payload p;
+  p.__set_id(id);
+  p.__set_name("payload-" + std::string(1, static_cast<char>('a' + id % 26)));
+  for (int32_t i = 0; i < 10; ++i) {
+    p.values.push_back(static_cast<int32_t>(id) * i);
+  }
+  return p;
+}
+
+static Envelope makeEnvelope() {
+  Envelope e;
+  e.__set_route("a.b.c");
+  e.__set_payload(makePayload(1));
+  for (int64_t i = 2; i < 6; ++i) {
+    e.items.push_back(makePayload(i));
+  }
+  e.counts["x"] = 1;
+  e.counts["y"] = 2;
+  e.__isset.counts = true;
+  return e;
+}
+
+template <typename Protocol, typename Struct>
+static std::string serialize(const Struct& s) {
+  shared_ptr<TMemoryBuffer> buf(new TMemoryBuffer());
+  Protocol prot(buf);
+  s.write(&prot);
+  return buf->getBufferAsString();
+}
+
+/// Reads from a buffer that owns a copy of bytes and so can lend it out.
+template <typename Protocol, typename Struct>
+static void deserialize(const std::string& bytes, Struct& s) {
+  shared_ptr<TMemoryBuffer> buf(
+      new TMemoryBuffer(reinterpret_cast<uint8_t*>(const_cast<char*>(bytes.data())),
+                        static_cast<uint32_t>(bytes.size()),
+                        TMemoryBuffer::COPY));
+  Protocol prot(buf);
+  s.read(&prot);
+}
+
+static void checkSame(const LazyEnvelope& lazy, const Envelope& e) {
+  BOOST_CHECK_EQUAL(lazy.route, e.route);
+  BOOST_CHECK(lazy.payload.get() == e.payload);
+  BOOST_CHECK(lazy.items.get() == e.items);
+  BOOST_CHECK_EQUAL(lazy.__isset.counts, e.__isset.counts);
+  BOOST_CHECK(lazy.counts.get() == e.counts);
+  BOOST_CHECK(lazy.fallback.get() == e.fallback);
+}
+
+BOOST_AUTO_TEST_CASE(test_defaults) {
+  LazyEnvelope lazy;
+  BOOST_CHECK(lazy.payload.isDecoded());
+  BOOST_CHECK(!lazy.payload.hasBytes());
+  BOOST_CHECK_EQUAL(lazy.fallback.get().id, 7);
+  BOOST_CHECK_EQUAL(lazy.fallback.get().name, "none");
+  BOOST_CHECK_EQUAL(serialize<TBinaryProtocol>(lazy), serialize<TBinaryProtocol>(Envelope()));
+}
+
+BOOST_AUTO_TEST_CASE(test_untouched_fields_pass_through) {
+  Envelope e = makeEnvelope();
+  std::string bytes = serialize<TBinaryProtocol>(e);
+
+  LazyEnvelope lazy;
+  deserialize<TBinaryProtocol>(bytes, lazy);
+  BOOST_CHECK_EQUAL(lazy.route, e.route);
+  BOOST_CHECK(!lazy.payload.isDecoded());
+  BOOST_CHECK(!lazy.items.isDecoded());
+  BOOST_CHECK(!lazy.counts.isDecoded());
+  BOOST_CHECK(lazy.payload.hasBytes());
+  BOOST_CHECK_EQUAL(lazy.payload.getBytes().str(), serialize<TBinaryProtocol>(e.payload));
+
+  // Writing copies the kept bytes without decoding them.
+  BOOST_CHECK_EQUAL(serialize<TBinaryProtocol>(lazy), bytes);
+  BOOST_CHECK(!lazy.payload.isDecoded());
+  BOOST_CHECK(!lazy.items.isDecoded());
+
+  // Copies share the bytes.
+  LazyEnvelope copy(lazy);
+  BOOST_CHECK(!copy.items.isDecoded());
+  BOOST_CHECK(copy == lazy);
+  BOOST_CHECK(!copy.items.isDecoded());
+}
+
+BOOST_AUTO_TEST_CASE(test_decode_on_first_use) {
+  Envelope e = makeEnvelope();
+  std::string bytes = serialize<TBinaryProtocol>(e);
+
+  LazyEnvelope lazy;
+  deserialize<TBinaryProtocol>(bytes, lazy);
+  BOOST_CHECK_EQUAL(lazy.items.get().size(), 4u);
+  BOOST_CHECK(lazy.items.isDecoded());
+  BOOST_CHECK(!lazy.payload.isDecoded());
+  checkSame(lazy, e);
+
+  // Reading a value keeps its bytes, so writing it is still a copy.
+  BOOST_CHECK(lazy.items.hasBytes());
+  BOOST_CHECK_EQUAL(serialize<TBinaryProtocol>(lazy), bytes);
+  BOOST_CHECK(apache::thrift::to_string(lazy).find("payload-b") != std::string::npos);
+}
+
+BOOST_AUTO_TEST_CASE(test_changed_fields_are_encoded_again) {
+  Envelope e = makeEnvelope();
+  std::string bytes = serialize<TBinaryProtocol>(e);
+
+  LazyEnvelope lazy;
+  deserialize<TBinaryProtocol>(bytes, lazy);
+  lazy.payload.getMutable().__set_id(99);
+  BOOST_CHECK(!lazy.payload.hasBytes());
+  lazy.__set_items(std::vector<Payload>(1, makePayload(42)));
+  BOOST_CHECK(!lazy.items.hasBytes());
+
+  e.payload.__set_id(99);
+  e.items.assign(1, makePayload(42));
+  BOOST_CHECK_EQUAL(serialize<TBinaryProtocol>(lazy), serialize<TBinaryProtocol>(e));
+
+  Envelope back;
+  deserialize<TBinaryProtocol>(serialize<TBinaryProtocol>(lazy), back);
+  BOOST_CHECK(back == e);
+}
+
+BOOST_AUTO_TEST_CASE(test_bytes_outlive_buffer) {
+  Envelope e = makeEnvelope();
+  LazyEnvelope lazy;
+  {
+    std::string bytes = serialize<TBinaryProtocol>(e);
+    deserialize<TBinaryProtocol>(bytes, lazy);
+  }
+  checkSame(lazy, e);
+}
+
+BOOST_AUTO_TEST_CASE(test_framed_transport) {
+  Envelope e = makeEnvelope();
+  shared_ptr<TMemoryBuffer> wire(new TMemoryBuffer());
+  {
+    shared_ptr<TFramedTransport> framed(new TFramedTransport(wire));
+    TBinaryProtocol prot(framed);
+    e.write(&prot);
+    framed->flush();
+    e.payload.__set_id(2);
+    e.write(&prot);
+    framed->flush();
+  }
+
+  shared_ptr<TFramedTransport> framed(new TFramedTransport(wire));
+  TBinaryProtocol prot(framed);
+  LazyEnvelope first;
+  first.read(&prot);
+  LazyEnvelope second;
+  second.read(&prot);
+  BOOST_CHECK(!first.payload.isDecoded());
+  BOOST_CHECK(!second.payload.isDecoded());
+
+  // The first frame stays intact after the second one has been read.
+  BOOST_CHECK_EQUAL(first.payload.get().id, 1);
+  BOOST_CHECK_EQUAL(second.payload.get().id, 2);
+  checkSame(second, e);
+}
+
+BOOST_AUTO_TEST_CASE(test_compact_protocol) {
+  Envelope e = makeEnvelope();
+  std::string bytes = serialize<TCompactProtocol>(e);
+
+  LazyEnvelope lazy;
+  deserialize<TCompactProtocol>(bytes, lazy);
+  BOOST_CHECK(!lazy.payload.isDecoded());
+  BOOST_CHECK_EQUAL(serialize<TCompactProtocol>(lazy), bytes);
+
+  // Another encoding decodes and encodes the values again.
+  BOOST_CHECK_EQUAL(serialize<TBinaryProtocol>(lazy), serialize<TBinaryProtocol>(e));
+  BOOST_CHECK(lazy.payload.isDecoded());
+  checkSame(lazy, e);
+}
+
+BOOST_AUTO_TEST_CASE(test_serialized_size) {
+  Envelope e = makeEnvelope();
+  std::string bytes = serialize<TBinaryProtocol>(e);
+  LazyEnvelope lazy;
+  deserialize<TBinaryProtocol>(bytes, lazy);
+
+  // Kept bytes are sized without decoding them.
+  BOOST_CHECK_EQUAL(lazy.serializedSize<TBinaryProtocol>(), bytes.size());
+  BOOST_CHECK(!lazy.payload.isDecoded());
+  BOOST_CHECK(!lazy.items.isDecoded());
+  BOOST_CHECK(!lazy.counts.isDecoded());
+
+  // Another encoding sizes the values.
+  BOOST_CHECK_EQUAL(lazy.serializedSize<TCompactProtocol>(), serialize<TCompactProtocol>(e).size());
+  BOOST_CHECK(lazy.payload.isDecoded());
+}
+
+BOOST_AUTO_TEST_CASE(test_eager_fallback) {
+  Envelope e = makeEnvelope();
+
+  // A buffer that only observes its memory cannot lend it out.
+  std::string bytes = serialize<TBinaryProtocol>(e);
+  shared_ptr<TMemoryBuffer> buf(
+      new TMemoryBuffer(reinterpret_cast<uint8_t*>(const_cast<char*>(bytes.data())),
+                        static_cast<uint32_t>(bytes.size())));
+  TBinaryProtocol prot(buf);
+  LazyEnvelope lazy;
+  lazy.read(&prot);
+  BOOST_CHECK(lazy.payload.isDecoded());
+  BOOST_CHECK(!lazy.payload.hasBytes());
+  checkSame(lazy, e);
+  BOOST_CHECK_EQUAL(serialize<TBinaryProtocol>(lazy), bytes);
+
+  // JSON values depend on what surrounds them.
+  std::string json = serialize<TJSONProtocol>(e);
+  LazyEnvelope fromJson;
+  deserialize<TJSONProtocol>(json, fromJson);
+  BOOST_CHECK(fromJson.items.isDecoded());
+  checkSame(fromJson, e);
+  BOOST_CHECK_EQUAL(serialize<TJSONProtocol>(fromJson), json);
+}
+
+BOOST_AUTO_TEST_CASE(test_reread_replaces_value) {
+  Envelope e = makeEnvelope();
+  LazyEnvelope lazy;
+  lazy.payload.getMutable().__set_id(5);
+  deserialize<TBinaryProtocol>(serialize<TBinaryProtocol>(e), lazy);
+  BOOST_CHECK_EQUAL(lazy.payload.get().id, 1);
+
+  lazy.payload.reset();
+  BOOST_CHECK(lazy.payload.isDecoded());
+  BOOST_CHECK(lazy.payload.get() == Payload());
+}
@@ -0,0 +1,48 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+/*
+ * LazyTest reads the bytes of an Envelope into a LazyEnvelope and back.
+ * Both structs have the same fields, the second with cpp.lazy.
+ */
+
+namespace cpp thrift.test.lazy
+
+struct Payload {
+  1: i64 id
+  2: string name
+  3: list<i32> values
+}
+
+struct Envelope {
+  1: string route
+  2: Payload payload
+  3: list<Payload> items
+  4: optional map<string, i64> counts
+  5: Payload fallback = {"id": 7, "name": "none"}
+}
+
+struct LazyEnvelope {
+  1: string route
+  2: Payload payload (cpp.lazy = "true")
+  3: list<Payload> items (cpp.lazy = "true")
+  4: optional map<string, i64> counts (cpp.lazy = "true")
+  5: Payload fallback = {"id": 7, "name": "none"} (cpp.lazy = "true")
+}
@@ -0,0 +1,187 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Task-completion notification cost in TNonblockingServer: client threads
+ * keep one connection each and issue small calls back to back, the calls run
+ * on a ThreadManager and every completion is handed back to its IO thread.
+ * Reports how many notification syscalls that took per completion; the old
+ * pipe protocol paid one send() and one recv() for each.
+ *
+ * Usage: NotifyBenchmark [seconds] [client threads] [workers] [io threads]
+ */
+
+#ifdef HAVE_CONFIG_H
+#include <config.h>
+#endif
+#include <cstdlib>
+#include <iostream>
+#include <vector>
+
+#include <thrift/concurrency/Monitor.h>
+#include <thrift/concurrency/PlatformThreadFactory.h>
+#include <thrift/concurrency/ThreadManager.h>
+#include <thrift/concurrency/Util.h>
+#include <thrift/protocol/TBinaryProtocol.h>
+#include <thrift/server/TNonblockingServer.h>
+#include <thrift/stdcxx.h>
+#include <thrift/transport/TBufferTransports.h>
+#include <thrift/transport/TNonblockingServerSocket.h>
+#include <thrift/transport/TSocket.h>
+
+#include "gen-cpp/ParentService.h"
+
+using namespace apache::thrift;
+using namespace apache::thrift::concurrency;
+using namespace apache::thrift::protocol;
+using namespace apache::thrift::server;
+using namespace apache::thrift::transport;
+using stdcxx::shared_ptr;
+using std::cout;
+using std::endl;
+
+struct Handler : public test::ParentServiceIf {
+  int32_t incrementGeneration() { return 0; }
+  int32_t getGeneration() { return 0; }
+  void addString(const std::string&) {}
+  void getStrings(std::vector<std::string>&) {}
+  void getDataWait(std::string&, const int32_t) {}
+  void onewayWait() {}
+  void exceptionWait(const std::string&) {}
+  void unexpectedExceptionWait(const std::string&) {}
+};
+
+class ReadyHandler : public TServerEventHandler {
+public:
+  ReadyHandler() : ready_(false) {}
+
+  void preServe() {
+    Synchronized s(monitor_);
+    ready_ = true;
+    monitor_.notifyAll();
+  }
+
+  void wait() {
+    Synchronized s(monitor_);
+    while (!ready_) {
+      monitor_.wait();
+    }
+  }
+
+private:
+  Monitor monitor_;
+  bool ready_;
+};
+
+class ServerRunner : public Runnable {
+public:
+  explicit ServerRunner(shared_ptr<TNonblockingServer> server) : server_(server) {}
+  void run() { server_->serve(); }
+
+private:
+  shared_ptr<TNonblockingServer> server_;
+};
+
+class CallClient : public Runnable {
+public:
+  CallClient(int port, int64_t deadline) : port_(port), deadline_(deadline), calls_(0) {}
+
+  void run() {
+    shared_ptr<TSocket> socket(new TSocket("localhost", port_));
+    test::ParentServiceClient client(shared_ptr<TProtocol>(
+        new TBinaryProtocol(shared_ptr<TTransport>(new TFramedTransport(socket)))));
+    socket->open();
+    while (Util::currentTime() < deadline_) {
+      client.getGeneration();
+      ++calls_;
+    }
+    socket->close();
+  }
+
+  uint64_t calls() const { return calls_; }
+
+private:
+  int port_;
+  int64_t deadline_;
+  uint64_t calls_;
+};
+
+int main(int argc, char** argv) {
+  int seconds = argc > 1 ? std::atoi(argv[1]) : 3;
+  int clients = argc > 2 ? std::atoi(argv[2]) : 32;
+  size_t workers = argc > 3 ? static_cast<size_t>(std::atoi(argv[3])) : 8;
+  size_t ioThreads = argc > 4 ? static_cast<size_t>(std::atoi(argv[4])) : 1;
+
+  shared_ptr<ThreadManager> threadManager = ThreadManager::newSimpleThreadManager(workers);
+  threadManager->threadFactory(shared_ptr<ThreadFactory>(new PlatformThreadFactory));
+  threadManager->start();
+
+  shared_ptr<TNonblockingServerSocket> socket(new TNonblockingServerSocket("localhost", 0));
+  shared_ptr<TNonblockingServer> server(new TNonblockingServer(
+      shared_ptr<TProcessor>(new test::ParentServiceProcessor(shared_ptr<Handler>(new Handler))),
+      shared_ptr<TProtocolFactory>(new TBinaryProtocolFactory),
+      socket,
+      threadManager));
+  shared_ptr<ReadyHandler> ready(new ReadyHandler);
+  server->setServerEventHandler(ready);
+  server->setNumIOThreads(ioThreads);
+
+  PlatformThreadFactory factory;
+  factory.setDetached(false);
+  shared_ptr<Thread> serverThread = factory.newThread(
+      shared_ptr<Runnable>(new ServerRunner(server)));
+  serverThread->start();
+  ready->wait();
+
+  int64_t start = Util::currentTime();
+  int64_t deadline = start + seconds * 1000;
+  std::vector<shared_ptr<CallClient> > runners;
+  std::vector<shared_ptr<Thread> > threads;
+  for (int i = 0; i < clients; ++i) {
+    runners.push_back(shared_ptr<CallClient>(new CallClient(server->getListenPort(), deadline)));
+    threads.push_back(factory.newThread(runners.back()));
+    threads.back()->start();
+  }
+
+  uint64_t calls = 0;
+  for (int i = 0; i < clients; ++i) {
+    threads[i]->join();
+    calls += runners[i]->calls();
+  }
+  double elapsed = (Util::currentTime() - start) / 1000.0;
+
+  uint64_t completions = server->getNotifyCompletions();
+  uint64_t signals = server->getNotifySignals();
+  uint64_t wakeups = server->getNotifyWakeups();
+  server->stop();
+  serverThread->join();
+  threadManager->stop();
+
+  cout << clients << " clients, " << workers << " workers, " << ioThreads << " IO threads, "
+       << seconds << "s" << endl;
+  cout << "calls:        " << calls << " (" << calls / elapsed << "/s)" << endl;
+  cout << "completions:  " << completions << endl;
+  cout << "signals:      " << signals << endl;
+  cout << "wakeups:      " << wakeups << endl;
+  if (completions > 0) {
+    cout << "notify syscalls per completion: "
+         << static_cast<double>(signals + wakeups) / completions << " (pipe: 2)" << endl;
+  }
+  return 0;
+}
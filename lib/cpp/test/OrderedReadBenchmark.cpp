@@ -0,0 +1,144 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Reads a feature record of 240 optional fields, generated with plain cpp
+ * and with cpp:ordered_reads, over the binary and compact protocols.  The
+ * record is read with all of its fields set, with every fourth field set,
+ * and with every other field set, where the next field is never the one
+ * that read() expects.
+ *
+ * Usage: OrderedReadBenchmark [thousands of records]
+ */
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+
+#include <thrift/concurrency/Util.h>
+#include <thrift/protocol/TBinaryProtocol.h>
+#include <thrift/protocol/TCompactProtocol.h>
+#include <thrift/stdcxx.h>
+#include <thrift/transport/TBufferTransports.h>
+#include "gen-cpp/OrderedReadBenchmarkOrdered_types.h"
+#include "gen-cpp/OrderedReadBenchmarkSwitch_types.h"
+
+using namespace apache::thrift::protocol;
+using namespace apache::thrift::transport;
+using apache::thrift::concurrency::Util;
+using apache::thrift::stdcxx::shared_ptr;
+using std::cout;
+using std::endl;
+
+namespace ordered = thrift::test::ordered::ordered;
+namespace switched = thrift::test::ordered::switched;
+
+static const int16_t NUM_FIELDS = 240;
+
+/// Writes a Features record with every stride-th field set.
+static std::string encode(TProtocol* prot, TMemoryBuffer* buf, int16_t stride) {
+  buf->resetBuffer();
+  prot->writeStructBegin("Features");
+  for (int16_t id = 1; id <= NUM_FIELDS; id += stride) {
+    switch ((id - 1) % 5) {
+    case 0:
+      prot->writeFieldBegin("", T_I32, id);
+      prot->writeI32(id * 1000);
+      break;
+    case 1:
+      prot->writeFieldBegin("", T_I64, id);
+      prot->writeI64(static_cast<int64_t>(id) << 40);
+      break;
+    case 2:
+      prot->writeFieldBegin("", T_DOUBLE, id);
+      prot->writeDouble(id / 7.0);
+      break;
+    case 3:
+      prot->writeFieldBegin("", T_BOOL, id);
+      prot->writeBool(id % 2 == 0);
+      break;
+    default:
+      prot->writeFieldBegin("", T_STRING, id);
+      prot->writeString("feature");
+      break;
+    }
+    prot->writeFieldEnd();
+  }
+  prot->writeFieldStop();
+  prot->writeStructEnd();
+  return buf->getBufferAsString();
+}
+
+static void report(const char* name, const char* what, int64_t usec, int count) {
+  cout << "  " << std::left << std::setw(20) << name << std::setw(10) << what << std::right
+       << std::fixed << std::setprecision(1) << std::setw(10)
+       << static_cast<double>(usec) * 1000 / count << " ns per record" << endl;
+}
+
+/// Reads bytes count times into a Features, and returns it written again.
+template <typename Protocol, typename Features>
+static std::string timeRead(const char* name, const char* what, const std::string& bytes, int count) {
+  shared_ptr<TMemoryBuffer> buf(new TMemoryBuffer());
+  Protocol prot(buf);
+  Features features;
+
+  int64_t start = Util::currentTimeUsec();
+  for (int i = 0; i < count; ++i) {
+    buf->resetBuffer(reinterpret_cast<uint8_t*>(const_cast<char*>(bytes.data())),
+                     static_cast<uint32_t>(bytes.size()));
+    features.read(&prot);
+  }
+  report(name, what, Util::currentTimeUsec() - start, count);
+
+  shared_ptr<TMemoryBuffer> out(new TMemoryBuffer());
+  Protocol outProt(out);
+  features.write(&outProt);
+  return out->getBufferAsString();
+}
+
+template <typename Protocol>
+static bool run(const char* protocol, int count) {
+  shared_ptr<TMemoryBuffer> buf(new TMemoryBuffer());
+  Protocol prot(buf);
+
+  cout << protocol << ":" << endl;
+  const int16_t strides[] = {1, 4, 2};
+  const char* names[] = {"all fields", "every 4th field", "every other field"};
+  for (int s = 0; s < 3; ++s) {
+    std::string bytes = encode(&prot, buf.get(), strides[s]);
+    std::string plain = timeRead<Protocol, switched::Features>(names[s], "switch", bytes, count);
+    std::string fast = timeRead<Protocol, ordered::Features>(names[s], "ordered", bytes, count);
+    if (plain != bytes || fast != bytes) {
+      return false;
+    }
+  }
+  return true;
+}
+
+int main(int argc, char** argv) {
+  int count = (argc > 1 ? std::atoi(argv[1]) : 200) * 1000;
+
+  if (!run<TBinaryProtocol>("binary", count)
+      || !run<TCompactProtocol>("compact", count)) {
+    cout << "records differ" << endl;
+    return 1;
+  }
+  return 0;
+}
@@ -0,0 +1,271 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * The feature record of OrderedReadBenchmark, generated without options.
+ * The two OrderedReadBenchmark*.thrift files differ only in their namespace,
+ * so that the generated versions can be linked together.  Like the structs
+ * of test/ManyOptionals.thrift, the record has many fields, all of them
+ * optional here.
+ */
+
+namespace cpp thrift.test.ordered.switched
+
+struct Features {
+  1: optional i32 f1
+  2: optional i64 f2
+  3: optional double f3
+  4: optional bool f4
+  5: optional string f5
+  6: optional i32 f6
+  7: optional i64 f7
+  8: optional double f8
+  9: optional bool f9
+  10: optional string f10
+  11: optional i32 f11
+  12: optional i64 f12
+  13: optional double f13
+  14: optional bool f14
+  15: optional string f15
+  16: optional i32 f16
+  17: optional i64 f17
+  18: optional double f18
+  19: optional bool f19
+  20: optional string f20
+  21: optional i32 f21
+  22: optional i64 f22
+  23: optional double f23
+  24: optional bool f24
+  25: optional string f25
+  26: optional i32 f26
+  27: optional i64 f27
+  28: optional double f28
+  29: optional bool f29
+  30: optional string f30
+  31: optional i32 f31
+  32: optional i64 f32
+  33: optional double f33
+  34: optional bool f34
+  35: optional string f35
+  36: optional i32 f36
+  37: optional i64 f37
+  38: optional double f38
+  39: optional bool f39
+  40: optional string f40
+  41: optional i32 f41
+  42: optional i64 f42
+  43: optional double f43
+  44: optional bool f44
+  45: optional string f45
+  46: optional i32 f46
+  47: optional i64 f47
+  48: optional double f48
+  49: optional bool f49
+  50: optional string f50
+  51: optional i32 f51
+  52: optional i64 f52
+  53: optional double f53
+  54: optional bool f54
+  55: optional string f55
+  56: optional i32 f56
+  57: optional i64 f57
+  58: optional double f58
+  59: optional bool f59
+  60: optional string f60
+  61: optional i32 f61
+  62: optional i64 f62
+  63: optional double f63
+  64: optional bool f64
+  65: optional string f65
+  66: optional i32 f66
+  67: optional i64 f67
+  68: optional double f68
+  69: optional bool f69
+  70: optional string f70
+  71: optional i32 f71
+  72: optional i64 f72
+  73: optional double f73
+  74: optional bool f74
+  75: optional string f75
+  76: optional i32 f76
+  77: optional i64 f77
+  78: optional double f78
+  79: optional bool f79
+  80: optional string f80
+  81: optional i32 f81
+  82: optional i64 f82
+  83: optional double f83
+  84: optional bool f84
+  85: optional string f85
+  86: optional i32 f86
+  87: optional i64 f87
+  88: optional double f88
+  89: optional bool f89
+  90: optional string f90
+  91: optional i32 f91
+  92: optional i64 f92
+  93: optional double f93
+  94: optional bool f94
+  95: optional string f95
+  96: optional i32 f96
+  97: optional i64 f97
+  98: optional double f98
+  99: optional bool f99
+  100: optional string f100
+  101: optional i32 f101
+  102: optional i64 f102
+  103: optional double f103
+  104: optional bool f104
+  105: optional string f105
+  106: optional i32 f106
+  107: optional i64 f107
+  108: optional double f108
+  109: optional bool f109
+  110: optional string f110
+  111: optional i32 f111
+  112: optional i64 f112
+  113: optional double f113
+  114: optional bool f114
+  115: optional string f115
+  116: optional i32 f116
+  117: optional i64 f117
+  118: optional double f118
+  119: optional bool f119
+  120: optional string f120
+  121: optional i32 f121
+  122: optional i64 f122
+  123: optional double f123
+  124: optional bool f124
+  125: optional string f125
+  126: optional i32 f126
+  127: optional i64 f127
+  128: optional double f128
+  129: optional bool f129
+  130: optional string f130
+  131: optional i32 f131
+  132: optional i64 f132
+  133: optional double f133
+  134: optional bool f134
+  135: optional string f135
+  136: optional i32 f136
+  137: optional i64 f137
+  138: optional double f138
+  139: optional bool f139
+  140: optional string f140
+  141: optional i32 f141
+  142: optional i64 f142
+  143: optional double f143
+  144: optional bool f144
+  145: optional string f145
+  146: optional i32 f146
+  147: optional i64 f147
+  148: optional double f148
+  149: optional bool f149
+  150: optional string f150
+  151: optional i32 f151
+  152: optional i64 f152
+  153: optional double f153
+  154: optional bool f154
+  155: optional string f155
+  156: optional i32 f156
+  157: optional i64 f157
+  158: optional double f158
+  159: optional bool f159
+  160: optional string f160
+  161: optional i32 f161
+  162: optional i64 f162
+  163: optional double f163
+  164: optional bool f164
+  165: optional string f165
+  166: optional i32 f166
+  167: optional i64 f167
+  168: optional double f168
+  169: optional bool f169
+  170: optional string f170
+  171: optional i32 f171
+  172: optional i64 f172
+  173: optional double f173
+  174: optional bool f174
+  175: optional string f175
+  176: optional i32 f176
+  177: optional i64 f177
+  178: optional double f178
+  179: optional bool f179
+  180: optional string f180
+  181: optional i32 f181
+  182: optional i64 f182
+  183: optional double f183
+  184: optional bool f184
+  185: optional string f185
+  186: optional i32 f186
+  187: optional i64 f187
+  188: optional double f188
+  189: optional bool f189
+  190: optional string f190
+  191: optional i32 f191
+  192: optional i64 f192
+  193: optional double f193
+  194: optional bool f194
+  195: optional string f195
+  196: optional i32 f196
+  197: optional i64 f197
+  198: optional double f198
+  199: optional bool f199
+  200: optional string f200
+  201: optional i32 f201
+  202: optional i64 f202
+  203: optional double f203
+  204: optional bool f204
+  205: optional string f205
+  206: optional i32 f206
+  207: optional i64 f207
+  208: optional double f208
+  209: optional bool f209
+  210: optional string f210
+  211: optional i32 f211
+  212: optional i64 f212
+  213: optional double f213
+  214: optional bool f214
+  215: optional string f215
+  216: optional i32 f216
+  217: optional i64 f217
+  218: optional double f218
+  219: optional bool f219
+  220: optional string f220
+  221: optional i32 f221
+  222: optional i64 f222
+  223: optional double f223
+  224: optional bool f224
+  225: optional string f225
+  226: optional i32 f226
+  227: optional i64 f227
+  228: optional double f228
+  229: optional bool f229
+  230: optional string f230
+  231: optional i32 f231
+  232: optional i64 f232
+  233: optional double f233
+  234: optional bool f234
+  235: optional string f235
+  236: optional i32 f236
+  237: optional i64 f237
+  238: optional double f238
+  239: optional bool f239
+  240: optional string f240
+}
@@ -0,0 +1,182 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#define BOOST_TEST_MODULE OrderedReadTest
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+
+#include <thrift/protocol/TBinaryProtocol.h>
+#include <thrift/protocol/TCompactProtocol.h>
+#include <thrift/stdcxx.h>
+#include <thrift/transport/TBufferTransports.h>
+
+#include "gen-cpp/OrderedReadTest_types.h"
+
+using namespace apache::thrift::protocol;
+using apache::thrift::stdcxx::shared_ptr;
+using apache::thrift::transport::TMemoryBuffer;
+using namespace thrift::test::ordered;
+
+static Record makeRecord() {
+  Record r;
+  r.__set_id(7);
+  r.__set_name("seven");
+  r.__set_stamp(1234567890123LL);
+  Item item;
+  item.__set_id(1);
+  item.__set_label("one");
+  r.items.push_back(item);
+  item.__set_id(2);
+  r.items.push_back(item);
+  r.__isset.items = true;
+  r.__set_item(item);
+  r.counts["a"] = 1;
+  r.__isset.counts = true;
+  r.__set_flag(true);
+  r.failure.__set_message("none");
+  r.__isset.failure = true;
+  return r;
+}
+
+template <typename Protocol>
+static void roundTrip(const Record& r) {
+  shared_ptr<TMemoryBuffer> buf(new TMemoryBuffer());
+  Protocol prot(buf);
+  r.write(&prot);
+  Record back;
+  back.read(&prot);
+  BOOST_CHECK(back == r);
+  BOOST_CHECK_EQUAL(buf->available_read(), 0u);
+}
+
+/// Writes the fields of makeRecord() by hand, last to first.
+static void writeBackwards(TProtocol* prot) {
+  prot->writeStructBegin("Record");
+  prot->writeFieldBegin("failure", T_STRUCT, 12);
+  prot->writeStructBegin("Failure");
+  prot->writeFieldBegin("message", T_STRING, 1);
+  prot->writeString("none");
+  prot->writeFieldEnd();
+  prot->writeFieldStop();
+  prot->writeStructEnd();
+  prot->writeFieldEnd();
+  prot->writeFieldBegin("flag", T_BOOL, 10);
+  prot->writeBool(true);
+  prot->writeFieldEnd();
+  prot->writeFieldBegin("counts", T_MAP, 7);
+  prot->writeMapBegin(T_STRING, T_I32, 1);
+  prot->writeString("a");
+  prot->writeI32(1);
+  prot->writeMapEnd();
+  prot->writeFieldEnd();
+  prot->writeFieldBegin("stamp", T_I64, 3);
+  prot->writeI64(1234567890123LL);
+  prot->writeFieldEnd();
+  prot->writeFieldBegin("name", T_STRING, 2);
+  prot->writeString("seven");
+  prot->writeFieldEnd();
+  prot->writeFieldBegin("id", T_I32, 1);
+  prot->writeI32(7);
+  prot->writeFieldEnd();
+  prot->writeFieldStop();
+  prot->writeStructEnd();
+}
+
+BOOST_AUTO_TEST_CASE(test_round_trip) {
+  roundTrip<TBinaryProtocol>(makeRecord());
+  roundTrip<TCompactProtocol>(makeRecord());
+
+  // Gaps between the fields that are set.
+  Record sparse;
+  sparse.__set_stamp(1);
+  sparse.__set_item(Item());
+  roundTrip<TBinaryProtocol>(sparse);
+  roundTrip<TCompactProtocol>(sparse);
+}
+
+BOOST_AUTO_TEST_CASE(test_out_of_order) {
+  Record expected = makeRecord();
+  expected.items.clear();
+  expected.__isset.items = false;
+  expected.__isset.item = false;
+  expected.item = Item();
+
+  shared_ptr<TMemoryBuffer> buf(new TMemoryBuffer());
+  TCompactProtocol prot(buf);
+  writeBackwards(&prot);
+  Record r;
+  r.read(&prot);
+  BOOST_CHECK(r == expected);
+  BOOST_CHECK(r.__isset.name);
+  BOOST_CHECK(!r.__isset.items);
+  BOOST_CHECK_EQUAL(buf->available_read(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(test_unknown_fields) {
+  shared_ptr<TMemoryBuffer> buf(new TMemoryBuffer());
+  TBinaryProtocol prot(buf);
+  prot.writeStructBegin("Record");
+  prot.writeFieldBegin("id", T_I32, 1);
+  prot.writeI32(3);
+  prot.writeFieldEnd();
+  // An id that Record does not have, where name is expected next.
+  prot.writeFieldBegin("extra", T_STRING, 6);
+  prot.writeString(std::string("skipped"));
+  prot.writeFieldEnd();
+  // A known id with another type.
+  prot.writeFieldBegin("stamp", T_STRING, 3);
+  prot.writeString(std::string("not a stamp"));
+  prot.writeFieldEnd();
+  prot.writeFieldBegin("stamp", T_I64, 3);
+  prot.writeI64(5);
+  prot.writeFieldEnd();
+  // A field that comes twice; the last one wins.
+  prot.writeFieldBegin("id", T_I32, 1);
+  prot.writeI32(4);
+  prot.writeFieldEnd();
+  prot.writeFieldStop();
+  prot.writeStructEnd();
+  prot.writeI32(99);
+
+  Record r;
+  r.read(&prot);
+  BOOST_CHECK_EQUAL(r.id, 4);
+  BOOST_CHECK_EQUAL(r.stamp, 5);
+  BOOST_CHECK(!r.__isset.name);
+
+  // The struct ends where it should.
+  int32_t after = 0;
+  prot.readI32(after);
+  BOOST_CHECK_EQUAL(after, 99);
+}
+
+BOOST_AUTO_TEST_CASE(test_missing_required) {
+  shared_ptr<TMemoryBuffer> buf(new TMemoryBuffer());
+  TBinaryProtocol prot(buf);
+  prot.writeStructBegin("Record");
+  prot.writeFieldBegin("id", T_I32, 1);
+  prot.writeI32(3);
+  prot.writeFieldEnd();
+  prot.writeFieldStop();
+  prot.writeStructEnd();
+
+  Record r;
+  BOOST_CHECK_THROW(r.read(&prot), TProtocolException);
+}
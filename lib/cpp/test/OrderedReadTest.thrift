@@ -0,0 +1,45 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * OrderedReadTest checks that structs generated with cpp:ordered_reads read
+ * fields in any order, and skip the ones they do not know.
+ */
+
+namespace cpp thrift.test.ordered
+
+struct Item {
+  1: i32 id
+  2: string label
+}
+
+exception Failure {
+  1: string message
+}
+
+struct Record {
+  1: i32 id
+  2: optional string name
+  3: required i64 stamp
+  4: optional list<Item> items
+  5: optional Item item
+  7: optional map<string, i32> counts
+  10: bool flag
+  12: Failure failure
+}
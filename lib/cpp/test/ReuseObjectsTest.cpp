@@ -0,0 +1,157 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#define BOOST_TEST_MODULE ReuseObjectsTest
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+
+#include <thrift/processor/TObjectPool.h>
+#include <thrift/protocol/TBinaryProtocol.h>
+#include <thrift/protocol/TDebugProtocol.h>
+#include <thrift/stdcxx.h>
+#include <thrift/transport/TBufferTransports.h>
+
+#include "gen-reuse/ThriftTest.h"
+
+using apache::thrift::processor::TObjectPool;
+using apache::thrift::protocol::TBinaryProtocol;
+using apache::thrift::stdcxx::shared_ptr;
+using apache::thrift::transport::TMemoryBuffer;
+using namespace thrift::test;
+
+// Needed by sets of Insanity, as in ThriftTest_extras.cpp.
+bool Insanity::operator<(thrift::test::Insanity const& other) const {
+  using apache::thrift::ThriftDebugString;
+  return ThriftDebugString(*this) < ThriftDebugString(other);
+}
+
+BOOST_AUTO_TEST_CASE(test_clear_restores_defaults) {
+  BoolTest bt;
+  bt.__set_b(false);
+  bt.__set_s("false");
+  bt.__isset.b = false;
+  bt.__clear();
+  BOOST_CHECK(bt == BoolTest());
+  BOOST_CHECK(bt.b);
+  BOOST_CHECK_EQUAL(bt.s, "true");
+  BOOST_CHECK(bt.__isset.b);
+  BOOST_CHECK(bt.__isset.s);
+
+  Xtruct2 x;
+  x.byte_thing = 1;
+  x.struct_thing.string_thing = "nested";
+  x.struct_thing.__isset.string_thing = true;
+  x.i32_thing = 2;
+  x.__isset.struct_thing = true;
+  x.__clear();
+  BOOST_CHECK(x == Xtruct2());
+  BOOST_CHECK(!x.__isset.struct_thing);
+  BOOST_CHECK(!x.struct_thing.__isset.string_thing);
+}
+
+BOOST_AUTO_TEST_CASE(test_clear_keeps_capacity) {
+  Insanity insanity;
+  insanity.xtructs.resize(100);
+  insanity.userMap[Numberz::ONE] = 1;
+  std::vector<Xtruct>::size_type capacity = insanity.xtructs.capacity();
+
+  insanity.__clear();
+  BOOST_CHECK(insanity.xtructs.empty());
+  BOOST_CHECK(insanity.userMap.empty());
+  BOOST_CHECK_EQUAL(insanity.xtructs.capacity(), capacity);
+
+  Xtruct xtruct;
+  xtruct.string_thing.assign(1000, 'x');
+  std::string::size_type stringCapacity = xtruct.string_thing.capacity();
+  xtruct.__clear();
+  BOOST_CHECK(xtruct.string_thing.empty());
+  BOOST_CHECK_EQUAL(xtruct.string_thing.capacity(), stringCapacity);
+}
+
+BOOST_AUTO_TEST_CASE(test_object_pool) {
+  TObjectPool<Xtruct, 2> pool;
+  Xtruct* a = pool.acquire();
+  Xtruct* b = pool.acquire();
+  Xtruct* c = pool.acquire();
+  BOOST_CHECK(a != b && b != c && a != c);
+
+  a->string_thing = "used";
+  pool.release(a);
+  pool.release(b);
+  // No slot left for c, so it is deleted.
+  pool.release(c);
+
+  {
+    TObjectPool<Xtruct, 2>::Lease lease(pool);
+    BOOST_CHECK(&*lease == a || &*lease == b);
+    BOOST_CHECK(lease->string_thing.empty());
+  }
+  Xtruct* d = pool.acquire();
+  Xtruct* e = pool.acquire();
+  BOOST_CHECK((d == a && e == b) || (d == b && e == a));
+  pool.release(d);
+  pool.release(e);
+}
+
+namespace {
+
+class Handler : public ThriftTestNull {
+public:
+  void testMultiException(Xtruct& _return, const std::string& arg0, const std::string& arg1) {
+    if (arg0 == "Xception") {
+      Xception e;
+      e.errorCode = 1001;
+      e.message = arg1;
+      throw e;
+    }
+    _return.string_thing += arg1;
+  }
+};
+}
+
+BOOST_AUTO_TEST_CASE(test_processor_reuses_objects) {
+  shared_ptr<TMemoryBuffer> requests(new TMemoryBuffer());
+  shared_ptr<TMemoryBuffer> replies(new TMemoryBuffer());
+  shared_ptr<TBinaryProtocol> requestProt(new TBinaryProtocol(requests));
+  shared_ptr<TBinaryProtocol> replyProt(new TBinaryProtocol(replies));
+  ThriftTestClient client(replyProt, requestProt);
+  ThriftTestProcessor processor(shared_ptr<ThriftTestIf>(new Handler));
+
+  // Results of one call must not leak into the next through the reused
+  // args and result objects.
+  for (int i = 0; i < 3; ++i) {
+    client.send_testMultiException("Xception", "first");
+    processor.process(requestProt, replyProt, NULL);
+    try {
+      Xtruct result;
+      client.recv_testMultiException(result);
+      BOOST_FAIL("expected Xception");
+    } catch (const Xception& e) {
+      BOOST_CHECK_EQUAL(e.errorCode, 1001);
+      BOOST_CHECK_EQUAL(e.message, "first");
+    }
+
+    client.send_testMultiException("ok", "second");
+    processor.process(requestProt, replyProt, NULL);
+    Xtruct result;
+    client.recv_testMultiException(result);
+    BOOST_CHECK_EQUAL(result.string_thing, "second");
+  }
+}
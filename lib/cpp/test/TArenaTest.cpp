@@ -0,0 +1,199 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <cstring>
+#include <map>
+#include <vector>
+
+#include <boost/test/auto_unit_test.hpp>
+
+#include <thrift/TArena.h>
+#include <thrift/protocol/TBinaryProtocol.h>
+#include <thrift/protocol/TCompactProtocol.h>
+#include <thrift/stdcxx.h>
+#include <thrift/transport/TBufferTransports.h>
+
+BOOST_AUTO_TEST_SUITE(TArenaTest)
+
+using apache::thrift::TArena;
+using apache::thrift::TArenaAllocator;
+using apache::thrift::TArenaScope;
+using apache::thrift::TArenaString;
+using apache::thrift::TRequestArenaScope;
+using apache::thrift::protocol::TBinaryProtocol;
+using apache::thrift::protocol::TCompactProtocol;
+using apache::thrift::protocol::readArenaString;
+using apache::thrift::protocol::writeArenaString;
+using apache::thrift::stdcxx::shared_ptr;
+using apache::thrift::transport::TMemoryBuffer;
+
+BOOST_AUTO_TEST_CASE(test_allocate_and_reset) {
+  TArena arena(1024);
+  BOOST_CHECK_EQUAL(arena.bytesReserved(), 0u);
+
+  char* a = static_cast<char*>(arena.allocate(10));
+  char* b = static_cast<char*>(arena.allocate(10));
+  BOOST_CHECK_EQUAL(reinterpret_cast<size_t>(a) % 16, 0u);
+  BOOST_CHECK_EQUAL(reinterpret_cast<size_t>(b) % 16, 0u);
+  BOOST_CHECK(b > a);
+  BOOST_CHECK_EQUAL(arena.bytesUsed(), 32u);
+  BOOST_CHECK_EQUAL(arena.bytesReserved(), 1024u);
+
+  // Rewinding a single block hands the same memory out again.
+  arena.reset();
+  BOOST_CHECK_EQUAL(arena.bytesUsed(), 0u);
+  BOOST_CHECK_EQUAL(arena.allocate(10), static_cast<void*>(a));
+}
+
+BOOST_AUTO_TEST_CASE(test_reset_coalesces_blocks) {
+  TArena arena(64);
+  for (int i = 0; i < 10; ++i) {
+    arena.allocate(48);
+  }
+  BOOST_CHECK(arena.bytesReserved() >= 480u);
+
+  // The chain is replaced by one block big enough for the whole round.
+  arena.reset();
+  BOOST_CHECK_EQUAL(arena.bytesReserved(), 480u);
+  for (int i = 0; i < 10; ++i) {
+    arena.allocate(48);
+  }
+  BOOST_CHECK_EQUAL(arena.bytesReserved(), 480u);
+}
+
+BOOST_AUTO_TEST_CASE(test_oversized_allocation) {
+  TArena arena(64);
+  arena.allocate(1000);
+  BOOST_CHECK(arena.bytesReserved() >= 1000u);
+  BOOST_CHECK_EQUAL(arena.bytesUsed(), 1008u);
+}
+
+BOOST_AUTO_TEST_CASE(test_scope_binds_allocators) {
+  TArena arena;
+  BOOST_CHECK(TArena::current() == NULL);
+  {
+    TArenaScope scope(&arena);
+    BOOST_CHECK(TArena::current() == &arena);
+
+    std::vector<int, TArenaAllocator<int> > v;
+    for (int i = 0; i < 100; ++i) {
+      v.push_back(i);
+    }
+    BOOST_CHECK(v.get_allocator().arena() == &arena);
+    BOOST_CHECK(arena.bytesUsed() >= 100 * sizeof(int));
+
+    {
+      // Nested NULL scope goes back to the heap.
+      TArenaScope heap(NULL);
+      TArenaString s("outlives the arena");
+      BOOST_CHECK(s.get_allocator().arena() == NULL);
+    }
+    BOOST_CHECK(TArena::current() == &arena);
+  }
+  BOOST_CHECK(TArena::current() == NULL);
+
+  std::map<int, int, std::less<int>, TArenaAllocator<std::pair<const int, int> > > m;
+  m[1] = 2;
+  BOOST_CHECK(m.get_allocator().arena() == NULL);
+}
+
+BOOST_AUTO_TEST_CASE(test_request_scope_leaves_allocators_alone) {
+  TArena arena;
+  {
+    TRequestArenaScope scope(&arena);
+    BOOST_CHECK(TArena::request() == &arena);
+    BOOST_CHECK(TArena::current() == NULL);
+
+    // What a handler builds must survive the arena being reset.
+    TArenaString kept("outlives the request");
+    BOOST_CHECK(kept.get_allocator().arena() == NULL);
+
+    TArenaString owned(TArenaAllocator<char>(TArena::request()));
+    owned.assign(100, 'x');
+    BOOST_CHECK(owned.get_allocator().arena() == &arena);
+  }
+  BOOST_CHECK(TArena::request() == NULL);
+}
+
+#ifndef BOOST_NO_CXX11_RVALUE_REFERENCES
+BOOST_AUTO_TEST_CASE(test_move_out_of_request_outlives_reset) {
+  // Built by a handler, outside any arena
+  TArenaString cached;
+  std::vector<int, TArenaAllocator<int> > cachedList;
+  TArenaString swapped;
+
+  TArena arena;
+  {
+    TArenaAllocator<char> chars(&arena);
+    TArenaAllocator<int> ints(&arena);
+    TArenaString field(chars);
+    field.assign(200, 'r');
+    std::vector<int, TArenaAllocator<int> > list(ints);
+    list.assign(50, 7);
+    TArenaString other(chars);
+    other.assign(300, 'o');
+
+    cached = std::move(field);
+    cachedList = std::move(list);
+    apache::thrift::arenaSwap(swapped, other);
+    BOOST_CHECK(other.empty());
+    BOOST_CHECK(other.get_allocator().arena() == &arena);
+  }
+  arena.reset();
+  std::memset(arena.allocate(4096), 0, 4096);
+
+  BOOST_CHECK(cached.get_allocator().arena() == NULL);
+  BOOST_CHECK(cached == TArenaString(200, 'r'));
+  BOOST_CHECK(cachedList.get_allocator().arena() == NULL);
+  BOOST_CHECK_EQUAL(cachedList.size(), 50u);
+  BOOST_CHECK_EQUAL(cachedList[49], 7);
+  BOOST_CHECK(swapped.get_allocator().arena() == NULL);
+  BOOST_CHECK(swapped == TArenaString(300, 'o'));
+}
+#endif
+
+template <typename Protocol_>
+void checkArenaStringRoundTrip() {
+  shared_ptr<TMemoryBuffer> buffer(new TMemoryBuffer());
+  Protocol_ prot(buffer);
+
+  TArena arena;
+  TArenaScope scope(&arena);
+  TArenaString out(300, 'x');
+  TArenaString bin("\x01\x00\x02", 3);
+  writeArenaString(prot, out);
+  writeArenaString(prot, bin, true);
+
+  TArenaString in, binIn;
+  readArenaString(prot, in);
+  readArenaString(prot, binIn, true);
+  BOOST_CHECK(in == out);
+  BOOST_CHECK(binIn == bin);
+  BOOST_CHECK(in.get_allocator().arena() == &arena);
+}
+
+BOOST_AUTO_TEST_CASE(test_arena_string_binary_protocol) {
+  checkArenaStringRoundTrip<TBinaryProtocol>();
+}
+
+BOOST_AUTO_TEST_CASE(test_arena_string_compact_protocol) {
+  checkArenaStringRoundTrip<TCompactProtocol>();
+}
+
+BOOST_AUTO_TEST_SUITE_END()
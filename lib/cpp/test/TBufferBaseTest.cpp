@@ -27,9 +27,25 @@ using apache::thrift::stdcxx::shared_ptr;
 using apache::thrift::transport::TMemoryBuffer;
 using apache::thrift::transport::TBufferedTransport;
 using apache::thrift::transport::TFramedTransport;
+using apache::thrift::transport::TWriteSegment;
 using apache::thrift::transport::test::TShortReadTransport;
 using std::string;
 
+// Counts the writeSegments() calls that reach the memory buffer.
+class TSegmentCountingBuffer : public TMemoryBuffer {
+public:
+  TSegmentCountingBuffer() : calls(0), segments(0) {}
+
+  void writeSegments(const TWriteSegment* segs, uint32_t count) {
+    ++calls;
+    segments += count;
+    TMemoryBuffer::writeSegments(segs, count);
+  }
+
+  int calls;
+  uint32_t segments;
+};
+
 // Shamelessly copied from ZlibTransport.  TODO: refactor.
 unsigned int dist[][5000] = {
  { 1<<15 },
@@ -642,5 +658,60 @@ BOOST_AUTO_TEST_CASE( test_FramedTransport_Empty_Flush ) {
   BOOST_CHECK_EQUAL(buffer->getBufferAsString(), output2);
 }
 
+BOOST_AUTO_TEST_CASE( test_BufferedTransport_Write_Segments ) {
+  init_data();
+
+  shared_ptr<TSegmentCountingBuffer> buffer(new TSegmentCountingBuffer());
+  TBufferedTransport trans(buffer, 512);
+
+  // A write that overflows a partly full buffer goes out together with the
+  // buffered bytes in one call.
+  trans.write(data, 100);
+  trans.write(&data[100], 2000);
+  BOOST_CHECK_EQUAL(buffer->calls, 1);
+  BOOST_CHECK_EQUAL(buffer->segments, 2u);
+  trans.write(&data[2100], (1<<15) - 2100);
+  trans.flush();
+  BOOST_CHECK_EQUAL(data_str, buffer->getBufferAsString());
+}
+
+BOOST_AUTO_TEST_CASE( test_FramedTransport_WriteRef ) {
+  init_data();
+
+  for (int d1 = 0; d1 < 3; d1++) {
+    shared_ptr<TSegmentCountingBuffer> buffer(new TSegmentCountingBuffer());
+    TFramedTransport trans(buffer);
+    trans.setWriteRefThreshold(64);
+
+    int offset = 0;
+    int index = 0;
+    while (offset < 1<<15) {
+      // Mix copied and referenced writes.
+      if (index % 2) {
+        trans.writeRef(&data[offset], dist[d1][index]);
+      } else {
+        trans.write(&data[offset], dist[d1][index]);
+      }
+      offset += dist[d1][index];
+      index++;
+    }
+    BOOST_CHECK_EQUAL(trans.writeEnd(), (1u<<15) + 4);
+    trans.flush();
+    BOOST_CHECK_EQUAL(buffer->calls, d1 == 0 ? 0 : 1);
+
+    int32_t frame_size = -1;
+    buffer->read(reinterpret_cast<uint8_t*>(&frame_size), sizeof(frame_size));
+    frame_size = (int32_t)ntohl((uint32_t)frame_size);
+    BOOST_CHECK_EQUAL(frame_size, 1<<15);
+    BOOST_CHECK_EQUAL(data_str, buffer->getBufferAsString());
+
+    // References do not outlive the flush.
+    buffer->resetBuffer();
+    trans.write((const uint8_t*)"bc", 2);
+    trans.flush();
+    BOOST_CHECK_EQUAL(buffer->getBufferAsString(), string("\x00\x00\x00\x02""bc", 6));
+  }
+}
+
 BOOST_AUTO_TEST_SUITE_END()
 
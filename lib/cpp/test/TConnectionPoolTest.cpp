@@ -0,0 +1,404 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#define BOOST_TEST_MODULE TConnectionPoolTest
+#include <boost/test/auto_unit_test.hpp>
+#include <boost/atomic.hpp>
+#include <boost/date_time/posix_time/ptime.hpp>
+#include <boost/thread.hpp>
+#include <algorithm>
+#include <string>
+#include <utility>
+#include <vector>
+#include <thrift/concurrency/Monitor.h>
+#include <thrift/protocol/TBinaryProtocol.h>
+#include <thrift/server/TThreadedServer.h>
+#include <thrift/stdcxx.h>
+#include <thrift/transport/TBufferTransports.h>
+#include <thrift/transport/TConnectionPool.h>
+#include <thrift/transport/TServerSocket.h>
+#include "gen-cpp/ParentService.h"
+
+using apache::thrift::TProcessor;
+using apache::thrift::concurrency::Monitor;
+using apache::thrift::concurrency::Synchronized;
+using apache::thrift::protocol::TBinaryProtocol;
+using apache::thrift::protocol::TBinaryProtocolFactory;
+using apache::thrift::protocol::TProtocol;
+using apache::thrift::server::TServerEventHandler;
+using apache::thrift::server::TThreadedServer;
+using apache::thrift::stdcxx::shared_ptr;
+using apache::thrift::test::ParentServiceClient;
+using apache::thrift::test::ParentServiceIf;
+using apache::thrift::test::ParentServiceProcessor;
+using apache::thrift::transport::TConnectionPool;
+using apache::thrift::transport::TConnectionPoolHostStats;
+using apache::thrift::transport::TMemoryBuffer;
+using apache::thrift::transport::TPooledProtocol;
+using apache::thrift::transport::TPooledTransport;
+using apache::thrift::transport::TServerSocket;
+using apache::thrift::transport::TTransportException;
+using apache::thrift::transport::TTransportFactory;
+using boost::posix_time::milliseconds;
+
+/**
+ * Answers getDataWait() after a delay, and counts the calls it got.
+ */
+class SlowHandler : public ParentServiceIf {
+public:
+  explicit SlowHandler(int delayMs) : delayMs_(delayMs), calls_(0) {}
+
+  int32_t incrementGeneration() { return 0; }
+  int32_t getGeneration() { return 0; }
+  void addString(const std::string&) {}
+  void getStrings(std::vector<std::string>&) {}
+
+  void getDataWait(std::string& _return, const int32_t length) {
+    if (delayMs_ > 0) {
+      boost::this_thread::sleep(milliseconds(delayMs_));
+    }
+    _return.assign(length, 'x');
+    ++calls_;
+  }
+
+  void onewayWait() {}
+  void exceptionWait(const std::string&) {}
+  void unexpectedExceptionWait(const std::string&) {}
+
+  int calls() const { return calls_; }
+
+private:
+  int delayMs_;
+  boost::atomic<int> calls_;
+};
+
+class ListeningHandler : public TServerEventHandler, public Monitor {
+public:
+  ListeningHandler() : listening_(false) {}
+  virtual void preServe() {
+    Synchronized sync(*this);
+    listening_ = true;
+    notify();
+  }
+  bool listening_;
+};
+
+/**
+ * A TThreadedServer on a free port of the loopback interface; with an idle
+ * timeout it closes connections that send nothing for that long.
+ */
+class Server {
+public:
+  explicit Server(int delayMs = 0, int idleTimeoutMs = 0)
+    : handler_(new SlowHandler(delayMs)),
+      socket_(new TServerSocket("localhost", 0)),
+      server_(shared_ptr<TProcessor>(new ParentServiceProcessor(handler_)),
+              socket_,
+              shared_ptr<TTransportFactory>(new TTransportFactory),
+              shared_ptr<TBinaryProtocolFactory>(new TBinaryProtocolFactory)),
+      listening_(new ListeningHandler) {
+    socket_->setRecvTimeout(idleTimeoutMs);
+    server_.setServerEventHandler(listening_);
+    thread_.reset(new boost::thread(apache::thrift::stdcxx::bind(&TThreadedServer::serve, &server_)));
+    Synchronized sync(*listening_);
+    while (!listening_->listening_) {
+      listening_->wait();
+    }
+  }
+
+  ~Server() {
+    server_.stop();
+    thread_->join();
+  }
+
+  std::pair<std::string, int> address() { return std::make_pair("localhost", socket_->getPort()); }
+
+  int calls() const { return handler_->calls(); }
+
+private:
+  shared_ptr<SlowHandler> handler_;
+  shared_ptr<TServerSocket> socket_;
+  TThreadedServer server_;
+  shared_ptr<ListeningHandler> listening_;
+  shared_ptr<boost::thread> thread_;
+};
+
+static int freePort() {
+  TServerSocket socket("localhost", 0);
+  socket.listen();
+  int port = socket.getPort();
+  socket.close();
+  return port;
+}
+
+static std::vector<TConnectionPoolHostStats> stats(TConnectionPool& pool) {
+  std::vector<TConnectionPoolHostStats> result;
+  pool.getHostStats(result);
+  return result;
+}
+
+BOOST_AUTO_TEST_SUITE(TConnectionPoolTest)
+
+BOOST_AUTO_TEST_CASE(test_least_outstanding_spreads_calls) {
+  Server a, b, c;
+  std::vector<std::pair<std::string, int> > servers;
+  servers.push_back(a.address());
+  servers.push_back(b.address());
+  servers.push_back(c.address());
+  TConnectionPool pool(servers);
+
+  std::vector<shared_ptr<TConnectionPool::Connection> > leases;
+  for (int i = 0; i < 6; ++i) {
+    leases.push_back(pool.acquire());
+  }
+  std::vector<TConnectionPoolHostStats> s = stats(pool);
+  for (size_t i = 0; i < s.size(); ++i) {
+    BOOST_CHECK_EQUAL(s[i].outstanding, 2);
+  }
+
+  for (size_t i = 0; i < leases.size(); ++i) {
+    pool.release(leases[i], true, -1);
+  }
+  s = stats(pool);
+  for (size_t i = 0; i < s.size(); ++i) {
+    BOOST_CHECK_EQUAL(s[i].outstanding, 0);
+    BOOST_CHECK_EQUAL(s[i].idle, 2);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_power_of_two_choices_spreads_calls) {
+  Server a, b, c, d;
+  std::vector<std::pair<std::string, int> > servers;
+  servers.push_back(a.address());
+  servers.push_back(b.address());
+  servers.push_back(c.address());
+  servers.push_back(d.address());
+  TConnectionPool pool(servers);
+  pool.setBalancing(TConnectionPool::POWER_OF_TWO_CHOICES);
+
+  std::vector<shared_ptr<TConnectionPool::Connection> > leases;
+  for (int i = 0; i < 40; ++i) {
+    leases.push_back(pool.acquire());
+  }
+  std::vector<TConnectionPoolHostStats> s = stats(pool);
+  int least = s[0].outstanding;
+  int most = s[0].outstanding;
+  for (size_t i = 1; i < s.size(); ++i) {
+    least = (std::min)(least, s[i].outstanding);
+    most = (std::max)(most, s[i].outstanding);
+  }
+  BOOST_CHECK_GT(least, 0);
+  BOOST_CHECK_LE(most - least, 6);
+
+  for (size_t i = 0; i < leases.size(); ++i) {
+    pool.release(leases[i], true, -1);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_latency_outlier_is_ejected) {
+  Server a, b, c;
+  std::vector<std::pair<std::string, int> > servers;
+  servers.push_back(a.address());
+  servers.push_back(b.address());
+  servers.push_back(c.address());
+  TConnectionPool pool(servers);
+  pool.setOutlierMinCalls(5);
+
+  for (int round = 0; round < 10; ++round) {
+    std::vector<shared_ptr<TConnectionPool::Connection> > leases;
+    for (int i = 0; i < 3; ++i) {
+      leases.push_back(pool.acquire());
+    }
+    for (int i = 0; i < 3; ++i) {
+      bool slow = leases[i]->getPort() == servers[2].second;
+      pool.release(leases[i], true, slow ? 50000 : 500);
+    }
+  }
+
+  std::vector<TConnectionPoolHostStats> s = stats(pool);
+  BOOST_CHECK(!s[0].ejected);
+  BOOST_CHECK(!s[1].ejected);
+  BOOST_CHECK(s[2].ejected);
+  BOOST_CHECK_EQUAL(s[2].idle, 0);
+
+  // No more than half of the hosts go for their latency.
+  for (int i = 0; i < 10; ++i) {
+    shared_ptr<TConnectionPool::Connection> lease = pool.acquire();
+    BOOST_CHECK(lease->getPort() != servers[2].second);
+    pool.release(lease, true, lease->getPort() == servers[1].second ? 50000 : 500);
+  }
+  s = stats(pool);
+  BOOST_CHECK(!s[0].ejected);
+  BOOST_CHECK(!s[1].ejected);
+}
+
+BOOST_AUTO_TEST_CASE(test_ejected_host_comes_back) {
+  Server a, b;
+  std::vector<std::pair<std::string, int> > servers;
+  servers.push_back(a.address());
+  servers.push_back(b.address());
+  TConnectionPool pool(servers);
+  pool.setMaxConsecutiveFailures(0);
+  pool.setEjectionTime(100);
+
+  shared_ptr<TConnectionPool::Connection> lease = pool.acquire();
+  int port = lease->getPort();
+  pool.release(lease, false, -1);
+  std::vector<TConnectionPoolHostStats> s = stats(pool);
+  BOOST_CHECK(s[port == servers[0].second ? 0 : 1].ejected);
+
+  boost::this_thread::sleep(milliseconds(150));
+  s = stats(pool);
+  BOOST_CHECK(!s[0].ejected);
+  BOOST_CHECK(!s[1].ejected);
+}
+
+BOOST_AUTO_TEST_CASE(test_unreachable_host_is_skipped) {
+  Server live;
+  std::vector<std::pair<std::string, int> > servers;
+  servers.push_back(std::make_pair(std::string("localhost"), freePort()));
+  servers.push_back(live.address());
+  TConnectionPool pool(servers);
+  pool.warmUp(2);
+
+  for (int i = 0; i < 5; ++i) {
+    shared_ptr<TConnectionPool::Connection> lease = pool.acquire();
+    BOOST_CHECK_EQUAL(lease->getPort(), servers[1].second);
+    pool.release(lease, true, -1);
+  }
+  std::vector<TConnectionPoolHostStats> s = stats(pool);
+  BOOST_CHECK(s[0].ejected);
+  BOOST_CHECK_EQUAL(s[0].outstanding, 0);
+  BOOST_CHECK_EQUAL(s[1].idle, 2);
+
+  std::vector<std::pair<std::string, int> > dead(1, servers[0]);
+  TConnectionPool nowhere(dead);
+  BOOST_CHECK_THROW(nowhere.acquire(), TTransportException);
+}
+
+BOOST_AUTO_TEST_CASE(test_pooled_transport_calls) {
+  Server fast, slow(20);
+  std::vector<std::pair<std::string, int> > servers;
+  servers.push_back(fast.address());
+  servers.push_back(slow.address());
+  shared_ptr<TConnectionPool> pool(new TConnectionPool(servers));
+
+  shared_ptr<TPooledTransport> transport(new TPooledTransport(pool));
+  ParentServiceClient client(
+      shared_ptr<TProtocol>(new TPooledProtocol(shared_ptr<TProtocol>(new TBinaryProtocol(transport)))));
+  for (int i = 0; i < 20; ++i) {
+    std::string data;
+    client.getDataWait(data, 100);
+    BOOST_CHECK_EQUAL(data, std::string(100, 'x'));
+    BOOST_CHECK(!transport->getConnection());
+    if (i % 5 == 0) {
+      client.onewayWait();
+    }
+  }
+
+  // Once both hosts have answered, the slow one is passed over.
+  BOOST_CHECK_GE(fast.calls(), 18);
+  BOOST_CHECK_LE(slow.calls(), 2);
+
+  std::vector<TConnectionPoolHostStats> s = stats(*pool);
+  BOOST_CHECK_EQUAL(s[0].outstanding + s[1].outstanding, 0);
+  BOOST_CHECK_EQUAL(s[0].idle, 1);
+  BOOST_CHECK_GT(s[1].latencyUsec, s[0].latencyUsec);
+}
+
+BOOST_AUTO_TEST_CASE(test_pooled_transport_abandoned_call) {
+  Server server;
+  std::vector<std::pair<std::string, int> > servers(1, server.address());
+  shared_ptr<TConnectionPool> pool(new TConnectionPool(servers));
+  pool->setMaxConsecutiveFailures(0);
+
+  shared_ptr<TPooledTransport> transport(new TPooledTransport(pool));
+  ParentServiceClient client(
+      shared_ptr<TProtocol>(new TPooledProtocol(shared_ptr<TProtocol>(new TBinaryProtocol(transport)))));
+
+  // The reply of a call given up is never taken for that of the next one.
+  client.send_getDataWait(10);
+  std::string data;
+  client.getDataWait(data, 100);
+  BOOST_CHECK_EQUAL(data, std::string(100, 'x'));
+
+  client.send_getDataWait(10);
+  transport->close();
+  client.getDataWait(data, 50);
+  BOOST_CHECK_EQUAL(data, std::string(50, 'x'));
+
+  // Neither counts against the host.
+  std::vector<TConnectionPoolHostStats> s = stats(*pool);
+  BOOST_CHECK(!s[0].ejected);
+  BOOST_CHECK_EQUAL(s[0].outstanding, 0);
+  BOOST_CHECK_EQUAL(s[0].idle, 1);
+}
+
+BOOST_AUTO_TEST_CASE(test_idle_connections_closed_by_server) {
+  Server server(0, 50);
+  std::vector<std::pair<std::string, int> > servers(1, server.address());
+  shared_ptr<TConnectionPool> pool(new TConnectionPool(servers));
+
+  // The server takes on a connection once a request arrives on it.
+  std::vector<shared_ptr<TConnectionPool::Connection> > leases;
+  std::string data;
+  for (int i = 0; i < 2; ++i) {
+    leases.push_back(pool->acquire());
+    ParentServiceClient(shared_ptr<TProtocol>(new TBinaryProtocol(leases[i]->getTransport())))
+        .getDataWait(data, 10);
+  }
+  for (int i = 0; i < 2; ++i) {
+    pool->release(leases[i], true, -1);
+  }
+  leases.clear();
+
+  shared_ptr<TPooledTransport> transport(new TPooledTransport(pool));
+  ParentServiceClient client(
+      shared_ptr<TProtocol>(new TPooledProtocol(shared_ptr<TProtocol>(new TBinaryProtocol(transport)))));
+
+  // Both idle connections are closed by now, and are passed over.
+  boost::this_thread::sleep(milliseconds(200));
+  client.getDataWait(data, 100);
+  BOOST_CHECK_EQUAL(data, std::string(100, 'x'));
+  std::vector<TConnectionPoolHostStats> s = stats(*pool);
+  BOOST_CHECK(!s[0].ejected);
+  BOOST_CHECK_EQUAL(s[0].idle, 1);
+
+  // A connection closed after it was handed out gets the request again on
+  // a new one.
+  shared_ptr<TMemoryBuffer> buffer(new TMemoryBuffer);
+  ParentServiceClient(shared_ptr<TProtocol>(new TBinaryProtocol(buffer))).send_getDataWait(60);
+  std::string request = buffer->getBufferAsString();
+  transport->write(reinterpret_cast<const uint8_t*>(request.data()), 4);
+  BOOST_CHECK(transport->getConnection()->isReused());
+  boost::this_thread::sleep(milliseconds(200));
+  transport->write(reinterpret_cast<const uint8_t*>(request.data()) + 4,
+                   static_cast<uint32_t>(request.size()) - 4);
+  transport->flush();
+  client.recv_getDataWait(data);
+  BOOST_CHECK_EQUAL(data, std::string(60, 'x'));
+  BOOST_CHECK_EQUAL(server.calls(), 4);
+
+  s = stats(*pool);
+  BOOST_CHECK(!s[0].ejected);
+  BOOST_CHECK_EQUAL(s[0].outstanding, 0);
+  BOOST_CHECK_EQUAL(s[0].idle, 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,137 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <cstdlib>
+#include <map>
+#include <stdexcept>
+#include <string>
+
+#include <boost/test/auto_unit_test.hpp>
+
+#include <thrift/TFlatMap.h>
+
+BOOST_AUTO_TEST_SUITE(TFlatMapTest)
+
+using apache::thrift::TFlatMap;
+using apache::thrift::TFlatSet;
+
+BOOST_AUTO_TEST_CASE(test_map_lookup_and_insert) {
+  TFlatMap<int, std::string> m;
+  BOOST_CHECK(m.empty());
+  m[3] = "three";
+  m[1] = "one";
+  BOOST_CHECK(m.insert(std::make_pair(2, std::string("two"))).second);
+  BOOST_CHECK(!m.insert(std::make_pair(2, std::string("deux"))).second);
+  BOOST_CHECK_EQUAL(m.size(), 3u);
+
+  int expected = 1;
+  for (TFlatMap<int, std::string>::const_iterator it = m.begin(); it != m.end(); ++it) {
+    BOOST_CHECK_EQUAL(it->first, expected++);
+  }
+  BOOST_CHECK_EQUAL(m.at(2), "two");
+  BOOST_CHECK(m.find(4) == m.end());
+  BOOST_CHECK_EQUAL(m.count(3), 1u);
+  BOOST_CHECK_THROW(m.at(4), std::out_of_range);
+  BOOST_CHECK(m.lower_bound(2) == m.find(2));
+  BOOST_CHECK(m.upper_bound(2) == m.find(3));
+
+  BOOST_CHECK_EQUAL(m.erase(2), 1u);
+  BOOST_CHECK_EQUAL(m.erase(2), 0u);
+  BOOST_CHECK_EQUAL(m.size(), 2u);
+  BOOST_CHECK_EQUAL(apache::thrift::to_string(m), "{1: one, 3: three}");
+}
+
+BOOST_AUTO_TEST_CASE(test_map_hinted_insert) {
+  TFlatMap<int, int> m;
+  for (int i = 0; i < 100; ++i) {
+    m.insert(m.end(), std::make_pair(i, i));
+  }
+  // A wrong hint still lands the element in place.
+  m.insert(m.begin(), std::make_pair(50, 0));
+  m.insert(m.end(), std::make_pair(-1, -1));
+  BOOST_CHECK_EQUAL(m.size(), 101u);
+  BOOST_CHECK_EQUAL(m.begin()->first, -1);
+  BOOST_CHECK_EQUAL(m[50], 50);
+}
+
+BOOST_AUTO_TEST_CASE(test_map_append_and_sort) {
+  std::map<int, int> expected;
+  TFlatMap<int, int> m;
+  std::srand(1);
+  for (int i = 0; i < 1000; ++i) {
+    int key = std::rand() % 300;
+    expected[key] = i;
+    m.append(key) = i;
+  }
+  m.sort();
+  BOOST_REQUIRE_EQUAL(m.size(), expected.size());
+  TFlatMap<int, int>::const_iterator it = m.begin();
+  for (std::map<int, int>::const_iterator e = expected.begin(); e != expected.end(); ++e, ++it) {
+    BOOST_CHECK_EQUAL(it->first, e->first);
+    // The last value appended for a key wins, as with operator[].
+    BOOST_CHECK_EQUAL(it->second, e->second);
+  }
+
+  TFlatMap<int, int> ordered;
+  ordered.reserve(3);
+  ordered.append(1) = 1;
+  ordered.append(2) = 2;
+  ordered.append(3) = 3;
+  ordered.sort();
+  BOOST_CHECK_EQUAL(ordered.size(), 3u);
+  BOOST_CHECK_EQUAL(ordered[2], 2);
+}
+
+BOOST_AUTO_TEST_CASE(test_map_compare) {
+  TFlatMap<int, int> a;
+  TFlatMap<int, int> b;
+  a[1] = 1;
+  b.append(1) = 1;
+  b.sort();
+  BOOST_CHECK(a == b);
+  b[2] = 2;
+  BOOST_CHECK(a != b);
+  BOOST_CHECK(a < b);
+  swap(a, b);
+  BOOST_CHECK_EQUAL(a.size(), 2u);
+  BOOST_CHECK_EQUAL(b.size(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(test_set) {
+  TFlatSet<std::string> s;
+  BOOST_CHECK(s.insert("b").second);
+  BOOST_CHECK(s.insert("a").second);
+  BOOST_CHECK(!s.insert("b").second);
+  BOOST_CHECK_EQUAL(s.size(), 2u);
+  BOOST_CHECK_EQUAL(*s.begin(), "a");
+  BOOST_CHECK_EQUAL(s.count("b"), 1u);
+  BOOST_CHECK(s.find("c") == s.end());
+
+  s.append("d");
+  s.append("c");
+  s.append("d");
+  s.sort();
+  BOOST_CHECK_EQUAL(apache::thrift::to_string(s), "{a, b, c, d}");
+
+  BOOST_CHECK_EQUAL(s.erase("b"), 1u);
+  s.erase(s.begin());
+  BOOST_CHECK_EQUAL(apache::thrift::to_string(s), "{c, d}");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,163 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <cstdlib>
+#include <map>
+#include <set>
+#include <stdexcept>
+#include <string>
+
+#include <boost/test/auto_unit_test.hpp>
+
+#include <thrift/THashMap.h>
+
+BOOST_AUTO_TEST_SUITE(THashMapTest)
+
+using apache::thrift::THashMap;
+using apache::thrift::THashSet;
+using apache::thrift::TStringView;
+using apache::thrift::stdcxx::shared_ptr;
+
+BOOST_AUTO_TEST_CASE(test_map_lookup_and_insert) {
+  THashMap<int64_t, std::string> m;
+  BOOST_CHECK(m.empty());
+  BOOST_CHECK(m.find(1) == m.end());
+  m[3] = "three";
+  m[1] = "one";
+  BOOST_CHECK(m.insert(std::make_pair(2, std::string("two"))).second);
+  BOOST_CHECK(!m.insert(std::make_pair(2, std::string("deux"))).second);
+  BOOST_CHECK_EQUAL(m.size(), 3u);
+
+  // Elements are kept in insertion order.
+  BOOST_CHECK_EQUAL(m.begin()->first, 3);
+  BOOST_CHECK_EQUAL(m.at(2), "two");
+  BOOST_CHECK_EQUAL(m.count(1), 1u);
+  BOOST_CHECK_EQUAL(m.count(4), 0u);
+  BOOST_CHECK_THROW(m.at(4), std::out_of_range);
+  BOOST_CHECK_EQUAL(apache::thrift::to_string(m), "{3: three, 1: one, 2: two}");
+
+  BOOST_CHECK_EQUAL(m.erase(3), 1u);
+  BOOST_CHECK_EQUAL(m.erase(3), 0u);
+  BOOST_CHECK_EQUAL(m.size(), 2u);
+  BOOST_CHECK_EQUAL(m[1], "one");
+  BOOST_CHECK_EQUAL(m[2], "two");
+}
+
+BOOST_AUTO_TEST_CASE(test_map_matches_std_map) {
+  std::map<int, int> expected;
+  THashMap<int, int> m;
+  std::srand(1);
+  for (int i = 0; i < 20000; ++i) {
+    int key = std::rand() % 2000;
+    switch (std::rand() % 3) {
+    case 0:
+      expected[key] = i;
+      m[key] = i;
+      break;
+    case 1:
+      BOOST_REQUIRE_EQUAL(m.erase(key), expected.erase(key));
+      break;
+    default:
+      if (!m.empty()) {
+        // Erase through an iterator, from the middle of the vector.
+        THashMap<int, int>::iterator it = m.begin() + (key % m.size());
+        expected.erase(it->first);
+        m.erase(it);
+      }
+      break;
+    }
+  }
+  BOOST_REQUIRE_EQUAL(m.size(), expected.size());
+  for (std::map<int, int>::const_iterator e = expected.begin(); e != expected.end(); ++e) {
+    THashMap<int, int>::const_iterator it = m.find(e->first);
+    BOOST_REQUIRE(it != m.end());
+    BOOST_CHECK_EQUAL(it->second, e->second);
+  }
+  for (int key = 0; key < 2000; ++key) {
+    BOOST_CHECK_EQUAL(m.count(key), expected.count(key));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_map_reserve_and_clear) {
+  THashMap<int, int> m;
+  m.reserve(1000);
+  for (int i = 0; i < 1000; ++i) {
+    m[i * 7919] = i;
+  }
+  BOOST_CHECK_EQUAL(m.size(), 1000u);
+  BOOST_CHECK_EQUAL(m[500 * 7919], 500);
+
+  m.clear();
+  BOOST_CHECK(m.empty());
+  BOOST_CHECK(m.find(500 * 7919) == m.end());
+  m[1] = 1;
+  BOOST_CHECK_EQUAL(m.size(), 1u);
+}
+
+BOOST_AUTO_TEST_CASE(test_map_compare) {
+  THashMap<int, int> a;
+  THashMap<int, int> b;
+  a[1] = 1;
+  a[2] = 2;
+  b[2] = 2;
+  b[1] = 1;
+  // Insertion order does not matter.
+  BOOST_CHECK(a == b);
+  BOOST_CHECK(!(a < b) && !(b < a));
+  b[2] = 3;
+  BOOST_CHECK(a != b);
+  BOOST_CHECK(a < b);
+  b.erase(2);
+  BOOST_CHECK(b < a);
+}
+
+BOOST_AUTO_TEST_CASE(test_set) {
+  THashSet<std::string> s;
+  BOOST_CHECK(s.insert("b").second);
+  BOOST_CHECK(s.insert("a").second);
+  BOOST_CHECK(!s.insert("b").second);
+  BOOST_CHECK_EQUAL(s.size(), 2u);
+  BOOST_CHECK_EQUAL(s.count("a"), 1u);
+  BOOST_CHECK(s.find("c") == s.end());
+  BOOST_CHECK_EQUAL(apache::thrift::to_string(s), "{b, a}");
+
+  BOOST_CHECK_EQUAL(s.erase("b"), 1u);
+  BOOST_CHECK_EQUAL(apache::thrift::to_string(s), "{a}");
+
+  THashSet<std::string> t;
+  t.insert("a");
+  BOOST_CHECK(s == t);
+
+  // Hash sets can be keys of an ordered map.
+  std::map<THashSet<std::string>, int> bySet;
+  bySet[s] = 1;
+  BOOST_CHECK_EQUAL(bySet[t], 1);
+}
+
+BOOST_AUTO_TEST_CASE(test_string_view_keys) {
+  std::string storage("alphabetagamma");
+  shared_ptr<void> none;
+  THashSet<TStringView> s;
+  s.insert(TStringView(storage.data(), 5, none));
+  s.insert(TStringView(storage.data() + 5, 4, none));
+  BOOST_CHECK_EQUAL(s.count(TStringView(std::string("beta"))), 1u);
+  BOOST_CHECK_EQUAL(s.count(TStringView(std::string("gamma"))), 0u);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
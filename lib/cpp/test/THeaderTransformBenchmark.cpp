@@ -0,0 +1,215 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Throughput and compression ratio of the THeaderTransport transforms on
+ * compact-encoded frames of three sizes: a single small struct, a typical
+ * request and a bulk replication batch.  zlib also runs once with a fresh
+ * context per frame, which is what every frame used to pay.
+ *
+ * Then sends a mix of tiny, typical and bulk frames through THeaderTransport
+ * uncompressed, always compressed with zlib, and with the adaptive
+ * compression policy, and reports time and bytes on the wire.
+ *
+ * Usage: THeaderTransformBenchmark [MB per measurement]
+ */
+
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <thrift/concurrency/Util.h>
+#include <thrift/protocol/TCompactProtocol.h>
+#include <thrift/stdcxx.h>
+#include <thrift/transport/TBufferTransports.h>
+#include <thrift/transport/THeaderTransport.h>
+
+#include "gen-cpp/DebugProtoTest_types.h"
+
+using namespace apache::thrift::protocol;
+using namespace apache::thrift::transport;
+using apache::thrift::concurrency::Util;
+using apache::thrift::stdcxx::shared_ptr;
+using std::cout;
+using std::endl;
+using thrift::test::debug::OneOfEach;
+
+static std::string makeFrame(int structs) {
+  shared_ptr<TMemoryBuffer> buf(new TMemoryBuffer());
+  TCompactProtocol prot(buf);
+  OneOfEach ooe;
+  for (int i = 0; i < structs; ++i) {
+    ooe.im_true = true;
+    ooe.im_false = false;
+    ooe.a_bite = static_cast<int8_t>(i);
+    ooe.integer16 = static_cast<int16_t>(i * 7);
+    ooe.integer32 = 1000000 + i * 13;
+    ooe.integer64 = static_cast<int64_t>(i) * 6000 * 1000 * 1000;
+    ooe.double_precision = i / 3.0;
+    ooe.some_characters = "user-" + std::string(1, static_cast<char>('a' + i % 26)) + "-session";
+    ooe.zomg_unicode = "\xd7\n\a\t";
+    ooe.base64 = std::string(8, static_cast<char>(i));
+    ooe.write(&prot);
+  }
+  return buf->getBufferAsString();
+}
+
+struct Codec {
+  const char* name;
+  shared_ptr<THeaderTransformFactory> factory;
+  bool freshPerFrame;
+};
+
+static void measure(const Codec& codec, const std::string& frame, uint64_t totalBytes) {
+  const uint8_t* in = reinterpret_cast<const uint8_t*>(frame.data());
+  uint32_t len = static_cast<uint32_t>(frame.size());
+  uint64_t frames = totalBytes / len + 1;
+
+  shared_ptr<THeaderTransform> transform = codec.factory->newTransform();
+  THeaderTransformBuffer encoded;
+  THeaderTransformBuffer decoded;
+
+  int64_t start = Util::currentTimeUsec();
+  for (uint64_t i = 0; i < frames; ++i) {
+    if (codec.freshPerFrame) {
+      transform = codec.factory->newTransform();
+    }
+    transform->transform(in, len, encoded);
+  }
+  int64_t encodeUsec = Util::currentTimeUsec() - start;
+
+  start = Util::currentTimeUsec();
+  for (uint64_t i = 0; i < frames; ++i) {
+    if (codec.freshPerFrame) {
+      transform = codec.factory->newTransform();
+    }
+    transform->untransform(encoded.data(), encoded.size(), decoded, 0x7fffffff);
+  }
+  int64_t decodeUsec = Util::currentTimeUsec() - start;
+
+  if (decoded.size() != len || memcmp(decoded.data(), in, len) != 0) {
+    cout << codec.name << ": round trip mismatch" << endl;
+    std::exit(1);
+  }
+
+  double mb = static_cast<double>(frames) * len / (1024.0 * 1024.0);
+  cout << "  " << std::left << std::setw(20) << codec.name << std::right << std::fixed
+       << std::setprecision(1) << std::setw(9) << mb / (encodeUsec / 1e6 + 1e-9) << " MB/s enc"
+       << std::setw(9) << mb / (decodeUsec / 1e6 + 1e-9) << " MB/s dec" << std::setprecision(2)
+       << std::setw(8) << static_cast<double>(len) / encoded.size() << "x ratio" << endl;
+}
+
+static void mixedTraffic(const char* name,
+                         const std::vector<std::string>& frames,
+                         uint16_t staticTransform,
+                         shared_ptr<THeaderCompressionPolicy> policy) {
+  shared_ptr<TMemoryBuffer> wire(new TMemoryBuffer());
+  THeaderTransport transport(wire);
+  if (staticTransform != 0) {
+    transport.setTransform(staticTransform);
+  }
+  transport.setCompressionPolicy(policy);
+
+  uint64_t rawBytes = 0;
+  uint64_t wireBytes = 0;
+  int64_t start = Util::currentTimeUsec();
+  for (size_t i = 0; i < frames.size(); ++i) {
+    transport.write(reinterpret_cast<const uint8_t*>(frames[i].data()),
+                    static_cast<uint32_t>(frames[i].size()));
+    transport.flush();
+    rawBytes += frames[i].size();
+    wireBytes += wire->available_read();
+    wire->resetBuffer();
+  }
+  int64_t usec = Util::currentTimeUsec() - start;
+
+  cout << "  " << std::left << std::setw(20) << name << std::right << std::setw(8) << usec / 1000
+       << " ms" << std::setw(12) << wireBytes << " wire bytes (" << std::setprecision(2)
+       << static_cast<double>(wireBytes) / rawBytes << " of raw)" << endl;
+  if (policy) {
+    const THeaderCompressionStats& stats = transport.getCompressionStats();
+    cout << "  " << std::setw(20) << "" << stats.compressedFrames << " compressed, "
+         << stats.skippedSmall << " small, " << stats.skippedByPolicy << " not worth it, "
+         << stats.bytesSaved() << " bytes saved for " << stats.compressNanos / 1000000
+         << " ms of compression" << endl;
+  }
+}
+
+int main(int argc, char** argv) {
+  uint64_t totalBytes = static_cast<uint64_t>(argc > 1 ? std::atoi(argv[1]) : 16) * 1024 * 1024;
+
+  std::vector<Codec> codecs;
+  Codec zlib = {"zlib", newZlibTransformFactory(), false};
+  Codec zlibFresh = {"zlib (new per frame)", newZlibTransformFactory(), true};
+  Codec zlibFast = {"zlib level 1", newZlibTransformFactory(1), false};
+  codecs.push_back(zlib);
+  codecs.push_back(zlibFresh);
+  codecs.push_back(zlibFast);
+  if (THeaderTransport::isTransformRegistered(THeaderTransport::LZ4_TRANSFORM)) {
+    Codec lz4 = {"lz4", newLz4TransformFactory(), false};
+    codecs.push_back(lz4);
+  }
+  if (THeaderTransport::isTransformRegistered(THeaderTransport::ZSTD_TRANSFORM)) {
+    Codec zstd = {"zstd", newZstdTransformFactory(), false};
+    Codec zstdDict = {"zstd + dictionary", newZstdTransformFactory(1, makeFrame(20)), false};
+    codecs.push_back(zstd);
+    codecs.push_back(zstdDict);
+  }
+  if (THeaderTransport::isTransformRegistered(THeaderTransport::SNAPPY_TRANSFORM)) {
+    Codec snappy = {"snappy", newSnappyTransformFactory(), false};
+    codecs.push_back(snappy);
+  }
+
+  const int sizes[] = {1, 40, 10000};
+  for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); ++s) {
+    std::string frame = makeFrame(sizes[s]);
+    cout << frame.size() << " byte frames:" << endl;
+    for (size_t c = 0; c < codecs.size(); ++c) {
+      measure(codecs[c], frame, totalBytes);
+    }
+  }
+
+  // 90% pings, 9% typical requests, 1% bulk batches.
+  std::string ping = makeFrame(1);
+  std::string request = makeFrame(40);
+  std::string bulk = makeFrame(1000);
+  std::vector<std::string> frames;
+  while (frames.size() * request.size() < totalBytes) {
+    for (int i = 0; i < 100; ++i) {
+      frames.push_back(i == 0 ? bulk : i < 10 ? request : ping);
+    }
+  }
+  cout << frames.size() << " mixed frames:" << endl;
+  mixedTraffic("uncompressed", frames, 0, shared_ptr<THeaderCompressionPolicy>());
+  mixedTraffic("zlib every frame", frames, THeaderTransport::ZLIB_TRANSFORM,
+               shared_ptr<THeaderCompressionPolicy>());
+  mixedTraffic("adaptive", frames, 0,
+               shared_ptr<THeaderCompressionPolicy>(new TAdaptiveCompressionPolicy()));
+  std::vector<uint16_t> allCodecs;
+  allCodecs.push_back(THeaderTransport::LZ4_TRANSFORM);
+  allCodecs.push_back(THeaderTransport::SNAPPY_TRANSFORM);
+  allCodecs.push_back(THeaderTransport::ZSTD_TRANSFORM);
+  allCodecs.push_back(THeaderTransport::ZLIB_TRANSFORM);
+  mixedTraffic("adaptive, all codecs", frames, 0,
+               shared_ptr<THeaderCompressionPolicy>(new TAdaptiveCompressionPolicy(allCodecs)));
+  return 0;
+}
@@ -0,0 +1,254 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#define BOOST_TEST_MODULE THeaderTransportTest
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+#include <vector>
+
+#include <thrift/stdcxx.h>
+#include <thrift/transport/TBufferTransports.h>
+#include <thrift/transport/THeaderTransport.h>
+
+using apache::thrift::stdcxx::shared_ptr;
+using apache::thrift::transport::THeaderTransform;
+using apache::thrift::transport::THeaderTransformBuffer;
+using apache::thrift::transport::THeaderTransformFactory;
+using apache::thrift::transport::THeaderTransport;
+using apache::thrift::transport::TMemoryBuffer;
+using apache::thrift::transport::TTransportException;
+
+namespace {
+
+std::string makePayload(size_t len) {
+  std::string payload;
+  uint32_t state = 7;
+  while (payload.size() < len) {
+    state = state * 1103515245 + 12345;
+    // Mostly repetitive with some noise, like real messages.
+    if ((state >> 16) % 5 == 0) {
+      payload += static_cast<char>(state >> 24);
+    } else {
+      payload += "thrift header frame ";
+    }
+  }
+  payload.resize(len);
+  return payload;
+}
+
+std::string roundTrip(const std::vector<uint16_t>& transforms,
+                      const std::string& payload,
+                      int frames = 1) {
+  shared_ptr<TMemoryBuffer> wire(new TMemoryBuffer());
+  THeaderTransport writer(wire);
+  for (size_t i = 0; i < transforms.size(); ++i) {
+    writer.setTransform(transforms[i]);
+  }
+  THeaderTransport reader(wire);
+
+  std::string result;
+  for (int i = 0; i < frames; ++i) {
+    writer.write(reinterpret_cast<const uint8_t*>(payload.data()),
+                 static_cast<uint32_t>(payload.size()));
+    writer.flush();
+
+    result.assign(payload.size(), '\0');
+    reader.readAll(reinterpret_cast<uint8_t*>(&result[0]), static_cast<uint32_t>(result.size()));
+    BOOST_CHECK_EQUAL(wire->available_read(), 0u);
+  }
+  return result;
+}
+
+/**
+ * Adds a constant to every byte, and counts the instances created.
+ */
+class AddTransform : public THeaderTransform {
+public:
+  void transform(const uint8_t* in, uint32_t len, THeaderTransformBuffer& out) {
+    uint8_t* buf = out.reserve(len);
+    for (uint32_t i = 0; i < len; ++i) {
+      buf[i] = static_cast<uint8_t>(in[i] + 1);
+    }
+    out.setSize(len);
+  }
+
+  void untransform(const uint8_t* in, uint32_t len, THeaderTransformBuffer& out, uint32_t) {
+    uint8_t* buf = out.reserve(len);
+    for (uint32_t i = 0; i < len; ++i) {
+      buf[i] = static_cast<uint8_t>(in[i] - 1);
+    }
+    out.setSize(len);
+  }
+};
+
+class AddTransformFactory : public THeaderTransformFactory {
+public:
+  AddTransformFactory() : created(0) {}
+
+  shared_ptr<THeaderTransform> newTransform() {
+    ++created;
+    return shared_ptr<THeaderTransform>(new AddTransform);
+  }
+
+  int created;
+};
+
+const uint16_t ADD_TRANSFORM = 0x40;
+}
+
+BOOST_AUTO_TEST_CASE(test_no_transform) {
+  std::string payload = makePayload(1000);
+  BOOST_CHECK(roundTrip(std::vector<uint16_t>(), payload) == payload);
+}
+
+BOOST_AUTO_TEST_CASE(test_builtin_codecs) {
+  const uint16_t codecs[] = {THeaderTransport::ZLIB_TRANSFORM,
+                             THeaderTransport::SNAPPY_TRANSFORM,
+                             THeaderTransport::ZSTD_TRANSFORM,
+                             THeaderTransport::LZ4_TRANSFORM};
+  BOOST_CHECK(THeaderTransport::isTransformRegistered(THeaderTransport::ZLIB_TRANSFORM));
+
+  for (size_t i = 0; i < sizeof(codecs) / sizeof(codecs[0]); ++i) {
+    if (!THeaderTransport::isTransformRegistered(codecs[i])) {
+      BOOST_TEST_MESSAGE("transform " << codecs[i] << " not built in");
+      continue;
+    }
+    std::vector<uint16_t> transforms(1, codecs[i]);
+    // Several frames through the same transports reuse their codec state;
+    // the large frame decodes to more than the read buffer holds.
+    std::string small = makePayload(300);
+    std::string large = makePayload(3 * 1024 * 1024);
+    BOOST_CHECK(roundTrip(transforms, small, 5) == small);
+    BOOST_CHECK(roundTrip(transforms, large, 2) == large);
+    BOOST_CHECK(roundTrip(transforms, std::string(1, 'x')) == std::string(1, 'x'));
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_chained_transforms) {
+  std::vector<uint16_t> transforms(2, THeaderTransport::ZLIB_TRANSFORM);
+  std::string payload = makePayload(100000);
+  BOOST_CHECK(roundTrip(transforms, payload, 3) == payload);
+}
+
+BOOST_AUTO_TEST_CASE(test_registered_transform) {
+  shared_ptr<AddTransformFactory> factory(new AddTransformFactory);
+  BOOST_CHECK(!THeaderTransport::isTransformRegistered(ADD_TRANSFORM));
+  THeaderTransport::registerTransform(ADD_TRANSFORM, factory);
+  BOOST_CHECK(THeaderTransport::isTransformRegistered(ADD_TRANSFORM));
+
+  std::vector<uint16_t> transforms;
+  transforms.push_back(ADD_TRANSFORM);
+  transforms.push_back(THeaderTransport::ZLIB_TRANSFORM);
+  std::string payload = makePayload(5000);
+  BOOST_CHECK(roundTrip(transforms, payload, 4) == payload);
+  // One instance for the writer, one for the reader, however many frames.
+  BOOST_CHECK_EQUAL(factory->created, 2);
+}
+
+BOOST_AUTO_TEST_CASE(test_unknown_transform) {
+  shared_ptr<TMemoryBuffer> wire(new TMemoryBuffer());
+  THeaderTransport writer(wire);
+  writer.setTransform(0x7f);
+  writer.write(reinterpret_cast<const uint8_t*>("x"), 1);
+  BOOST_CHECK_THROW(writer.flush(), TTransportException);
+}
+
+BOOST_AUTO_TEST_CASE(test_corrupt_frame) {
+  std::string payload = makePayload(10000);
+  shared_ptr<TMemoryBuffer> wire(new TMemoryBuffer());
+  THeaderTransport writer(wire);
+  writer.setTransform(THeaderTransport::ZLIB_TRANSFORM);
+  writer.write(reinterpret_cast<const uint8_t*>(payload.data()),
+               static_cast<uint32_t>(payload.size()));
+  writer.flush();
+
+  // Flip bits in the compressed data near the end of the frame.
+  uint8_t* buf;
+  uint32_t len;
+  wire->getBuffer(&buf, &len);
+  buf[len - 10] ^= 0x55;
+  buf[len - 20] ^= 0x55;
+
+  THeaderTransport reader(wire);
+  std::string result(payload.size(), '\0');
+  BOOST_CHECK_THROW(reader.readAll(reinterpret_cast<uint8_t*>(&result[0]),
+                                   static_cast<uint32_t>(result.size())),
+                    TTransportException);
+}
+
+BOOST_AUTO_TEST_CASE(test_adaptive_compression_default_codecs) {
+  using apache::thrift::transport::TAdaptiveCompressionPolicy;
+
+  // Other codecs may be built in here but missing on the peer.
+  TAdaptiveCompressionPolicy policy;
+  BOOST_CHECK_EQUAL(policy.select(4096), THeaderTransport::ZLIB_TRANSFORM);
+  policy.record(THeaderTransport::ZLIB_TRANSFORM, 4096, 1024, 4096);
+  for (int i = 0; i < 1000; ++i) {
+    BOOST_CHECK_EQUAL(policy.select(4096), THeaderTransport::ZLIB_TRANSFORM);
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_adaptive_compression) {
+  using apache::thrift::transport::TAdaptiveCompressionPolicy;
+  using apache::thrift::transport::THeaderCompressionStats;
+
+  shared_ptr<TMemoryBuffer> wire(new TMemoryBuffer());
+  THeaderTransport writer(wire);
+  THeaderTransport reader(wire);
+  shared_ptr<TAdaptiveCompressionPolicy> policy(
+      new TAdaptiveCompressionPolicy(std::vector<uint16_t>(1, THeaderTransport::ZLIB_TRANSFORM)));
+  policy->setMaxNanosPerByte(1e9);
+  writer.setCompressionPolicy(policy);
+
+  std::string ping = makePayload(40);
+  std::string bulk = makePayload(64 * 1024);
+  std::string noise;
+  uint32_t state = 99;
+  for (int i = 0; i < 4096; ++i) {
+    state = state * 1664525 + 1013904223;
+    noise += static_cast<char>(state >> 24);
+  }
+
+  const std::string* frames[] = {&ping, &bulk, &ping, &bulk, &noise};
+  size_t wireBytes = 0;
+  for (int round = 0; round < 20; ++round) {
+    for (size_t i = 0; i < sizeof(frames) / sizeof(frames[0]); ++i) {
+      const std::string& payload = *frames[i];
+      writer.write(reinterpret_cast<const uint8_t*>(payload.data()),
+                   static_cast<uint32_t>(payload.size()));
+      writer.flush();
+      wireBytes += wire->available_read();
+
+      std::string result(payload.size(), '\0');
+      reader.readAll(reinterpret_cast<uint8_t*>(&result[0]), static_cast<uint32_t>(result.size()));
+      BOOST_CHECK(result == payload);
+    }
+  }
+
+  const THeaderCompressionStats& stats = writer.getCompressionStats();
+  BOOST_CHECK_EQUAL(stats.frames, 100u);
+  BOOST_CHECK_EQUAL(stats.skippedSmall, 40u);
+  BOOST_CHECK_EQUAL(stats.compressedFrames, 40u);
+  // Noise only fails to compress while it looks worth trying.
+  BOOST_CHECK_EQUAL(stats.incompressible + stats.skippedByPolicy, 20u);
+  BOOST_CHECK(stats.bytesOut < stats.bytesIn / 2);
+  BOOST_CHECK(wireBytes < stats.bytesIn / 2);
+  BOOST_CHECK(policy->getRatio(THeaderTransport::ZLIB_TRANSFORM) < 0.5);
+}
@@ -0,0 +1,170 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Reads a large chunked HTTP response through THttpClient, as one bulk
+ * read the size of the body, as a binary field decoded by TBinaryProtocol,
+ * and in the small reads a protocol makes for a list of i64s.  The response
+ * comes from memory in 64 KB reads, like from a socket, with small chunks
+ * and with large ones.
+ *
+ * Usage: THttpChunkedBenchmark [MB of response body]
+ */
+
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+#include <thrift/concurrency/Util.h>
+#include <thrift/protocol/TBinaryProtocol.h>
+#include <thrift/stdcxx.h>
+#include <thrift/transport/THttpClient.h>
+#include <thrift/transport/TVirtualTransport.h>
+
+using namespace apache::thrift::protocol;
+using namespace apache::thrift::transport;
+using apache::thrift::concurrency::Util;
+using apache::thrift::stdcxx::shared_ptr;
+using std::cout;
+using std::endl;
+
+/**
+ * Plays back a response held in memory, at most 64 KB per read, and drops
+ * what is written to it.
+ */
+class ResponseSource : public TVirtualTransport<ResponseSource> {
+public:
+  explicit ResponseSource(const std::string& response) : response_(response), pos_(0) {}
+
+  void rewind() { pos_ = 0; }
+
+  bool isOpen() { return true; }
+
+  uint32_t read(uint8_t* buf, uint32_t len) {
+    uint32_t give = static_cast<uint32_t>(
+        (std::min)(static_cast<size_t>((std::min)(len, 65536u)), response_.size() - pos_));
+    std::memcpy(buf, response_.data() + pos_, give);
+    pos_ += give;
+    return give;
+  }
+
+  void write(const uint8_t* buf, uint32_t len) {
+    (void)buf;
+    (void)len;
+  }
+
+private:
+  const std::string& response_;
+  size_t pos_;
+};
+
+static std::string chunked(const std::string& body, size_t chunkSize) {
+  std::ostringstream r;
+  r << "HTTP/1.1 200 OK\r\nContent-Type: application/x-thrift\r\n"
+    << "Transfer-Encoding: chunked\r\n\r\n";
+  for (size_t pos = 0; pos < body.size(); pos += chunkSize) {
+    size_t len = (std::min)(chunkSize, body.size() - pos);
+    r << std::hex << len << "\r\n";
+    r.write(body.data() + pos, len);
+    r << "\r\n";
+  }
+  r << "0\r\n\r\n";
+  return r.str();
+}
+
+static void report(const char* name, size_t chunkSize, size_t bytes, int64_t usec) {
+  double mb = static_cast<double>(bytes) / (1024.0 * 1024.0);
+  cout << "  " << std::left << std::setw(16) << name << std::right << std::setw(8)
+       << chunkSize / 1024 << " KB chunks" << std::fixed << std::setprecision(1) << std::setw(10)
+       << mb / (usec / 1e6 + 1e-9) << " MB/s" << endl;
+}
+
+int main(int argc, char** argv) {
+  size_t mb = static_cast<size_t>(argc > 1 ? std::atoi(argv[1]) : 64);
+
+  // A binary field holding half of the body, then a list of i64s.
+  shared_ptr<TMemoryBuffer> buf(new TMemoryBuffer());
+  TBinaryProtocol prot(buf);
+  std::string payload(mb * 512 * 1024, 'x');
+  for (size_t i = 0; i < payload.size(); i += 4096) {
+    payload[i] = static_cast<char>(i >> 12);
+  }
+  prot.writeBinary(payload);
+  uint32_t binarySize = buf->available_read();
+  int32_t count = static_cast<int32_t>(payload.size() / 8);
+  prot.writeListBegin(T_I64, count);
+  for (int32_t i = 0; i < count; ++i) {
+    prot.writeI64(i);
+  }
+  prot.writeListEnd();
+  std::string body = buf->getBufferAsString();
+
+  cout << mb << " MB chunked responses:" << endl;
+  const size_t chunkSizes[] = {8 * 1024, 1024 * 1024};
+  for (size_t c = 0; c < sizeof(chunkSizes) / sizeof(chunkSizes[0]); ++c) {
+    std::string response = chunked(body, chunkSizes[c]);
+    shared_ptr<ResponseSource> source(new ResponseSource(response));
+    shared_ptr<THttpClient> client(new THttpClient(source, "localhost", "/"));
+    TBinaryProtocol iprot(client);
+
+    // One read for the whole body
+    std::string whole(body.size(), '\0');
+    source->rewind();
+    client->flush();
+    int64_t start = Util::currentTimeUsec();
+    client->readAll(reinterpret_cast<uint8_t*>(&whole[0]), static_cast<uint32_t>(whole.size()));
+    client->readEnd();
+    report("bulk read", chunkSizes[c], body.size(), Util::currentTimeUsec() - start);
+    if (whole != body) {
+      cout << "bulk read mismatch" << endl;
+      return 1;
+    }
+
+    // The binary field, then the list a field at a time
+    std::string binary;
+    source->rewind();
+    client->flush();
+    start = Util::currentTimeUsec();
+    iprot.readBinary(binary);
+    report("binary field", chunkSizes[c], binarySize, Util::currentTimeUsec() - start);
+
+    start = Util::currentTimeUsec();
+    TType elemType;
+    uint32_t size;
+    iprot.readListBegin(elemType, size);
+    int64_t sum = 0;
+    for (uint32_t i = 0; i < size; ++i) {
+      int64_t value;
+      iprot.readI64(value);
+      sum += value;
+    }
+    iprot.readListEnd();
+    client->readEnd();
+    report("i64 list", chunkSizes[c], body.size() - binarySize, Util::currentTimeUsec() - start);
+    if (binary != payload || sum != static_cast<int64_t>(count) * (count - 1) / 2) {
+      cout << "protocol read mismatch" << endl;
+      return 1;
+    }
+  }
+  return 0;
+}
@@ -0,0 +1,232 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <algorithm>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#include <boost/test/auto_unit_test.hpp>
+
+#include <thrift/stdcxx.h>
+#include <thrift/transport/TBufferTransports.h>
+#include <thrift/transport/THttpClient.h>
+#include <thrift/transport/TVirtualTransport.h>
+
+BOOST_AUTO_TEST_SUITE(THttpTransportTest)
+
+using apache::thrift::stdcxx::shared_ptr;
+using apache::thrift::transport::THttpClient;
+using apache::thrift::transport::TMemoryBuffer;
+using apache::thrift::transport::TTransportException;
+using apache::thrift::transport::TVirtualTransport;
+
+/**
+ * Serves canned responses, at most maxRead bytes per read like a socket
+ * would, and keeps the requests written to it apart.  Every reopen starts a
+ * connection with the next responses passed to addConnection().
+ */
+class CannedTransport : public TVirtualTransport<CannedTransport> {
+public:
+  CannedTransport(const std::string& responses, uint32_t maxRead = 0xffffffff)
+    : maxRead_(maxRead), reopened_(0) {
+    connections_.push_back(responses);
+    connect();
+  }
+
+  void addConnection(const std::string& responses) { connections_.push_back(responses); }
+
+  bool isOpen() { return true; }
+  void open() {
+    ++reopened_;
+    connect();
+  }
+  void close() {}
+
+  uint32_t read(uint8_t* buf, uint32_t len) { return in_.read(buf, (std::min)(len, maxRead_)); }
+  void write(const uint8_t* buf, uint32_t len) { out_.write(buf, len); }
+
+  uint32_t available() { return in_.available_read(); }
+  int reopened() const { return reopened_; }
+
+private:
+  void connect() {
+    in_.resetBuffer();
+    if (static_cast<size_t>(reopened_) < connections_.size()) {
+      const std::string& responses = connections_[reopened_];
+      in_.write(reinterpret_cast<const uint8_t*>(responses.data()),
+                static_cast<uint32_t>(responses.size()));
+    }
+  }
+
+  std::vector<std::string> connections_;
+  TMemoryBuffer in_;
+  TMemoryBuffer out_;
+  uint32_t maxRead_;
+  int reopened_;
+};
+
+static std::string chunkedResponse(const std::string& body, size_t chunkSize) {
+  std::ostringstream r;
+  r << "HTTP/1.1 200 OK\r\nTransfer-Encoding: chunked\r\n\r\n";
+  for (size_t pos = 0; pos < body.size(); pos += chunkSize) {
+    std::string chunk = body.substr(pos, chunkSize);
+    r << std::hex << chunk.size() << ";ext=1\r\n" << chunk << "\r\n";
+  }
+  r << "0\r\nX-Footer: yes\r\n\r\n";
+  return r.str();
+}
+
+static std::string contentResponse(const std::string& body, const char* extraHeaders = "") {
+  std::ostringstream r;
+  r << "HTTP/1.1 200 OK\r\nContent-Length: " << body.size() << "\r\n" << extraHeaders << "\r\n"
+    << body;
+  return r.str();
+}
+
+static std::string readBody(THttpClient& client, uint32_t len) {
+  std::string body(len, '\0');
+  if (len > 0) {
+    client.readAll(reinterpret_cast<uint8_t*>(&body[0]), len);
+  }
+  client.readEnd();
+  return body;
+}
+
+static std::string pattern(size_t len) {
+  std::string s;
+  for (size_t i = 0; i < len; ++i) {
+    s += static_cast<char>('a' + i % 23);
+  }
+  return s;
+}
+
+BOOST_AUTO_TEST_CASE(test_chunked_response_in_small_reads) {
+  std::string body = pattern(10000);
+  shared_ptr<CannedTransport> canned(new CannedTransport(chunkedResponse(body, 777), 100));
+  THttpClient client(canned, "host", "/");
+  client.flush();
+
+  std::string got;
+  uint8_t buf[13];
+  while (got.size() < body.size()) {
+    uint32_t n = client.read(buf, sizeof(buf));
+    BOOST_REQUIRE(n > 0);
+    got.append(reinterpret_cast<char*>(buf), n);
+  }
+  client.readEnd();
+  BOOST_CHECK(got == body);
+  BOOST_CHECK_EQUAL(canned->available(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(test_large_reads_span_chunks) {
+  std::string body = pattern(300000);
+  shared_ptr<CannedTransport> canned(new CannedTransport(chunkedResponse(body, 65536)));
+  THttpClient client(canned, "host", "/");
+  client.flush();
+  BOOST_CHECK(readBody(client, static_cast<uint32_t>(body.size())) == body);
+  BOOST_CHECK_EQUAL(canned->available(), 0u);
+}
+
+BOOST_AUTO_TEST_CASE(test_keep_alive_with_buffered_responses) {
+  // Both responses arrive before the first is read; reading the second must
+  // not wait for more data from the server.
+  std::string first = pattern(50);
+  std::string second = pattern(3000);
+  shared_ptr<CannedTransport> canned(
+      new CannedTransport(chunkedResponse(first, 16) + contentResponse(second)));
+  THttpClient client(canned, "host", "/");
+
+  client.flush();
+  BOOST_CHECK(readBody(client, static_cast<uint32_t>(first.size())) == first);
+  client.flush();
+  BOOST_CHECK(readBody(client, static_cast<uint32_t>(second.size())) == second);
+  BOOST_CHECK_EQUAL(canned->reopened(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(test_read_end_skips_unread_body) {
+  std::string third = pattern(10);
+  shared_ptr<CannedTransport> canned(new CannedTransport(chunkedResponse(pattern(5000), 1000)
+                                                         + contentResponse(pattern(2000))
+                                                         + contentResponse(third)));
+  THttpClient client(canned, "host", "/");
+
+  client.flush();
+  readBody(client, 10);
+  client.flush();
+  readBody(client, 10);
+  client.flush();
+  BOOST_CHECK(readBody(client, static_cast<uint32_t>(third.size())) == third);
+  BOOST_CHECK_EQUAL(canned->reopened(), 0);
+}
+
+BOOST_AUTO_TEST_CASE(test_borrow_stays_within_chunk) {
+  shared_ptr<CannedTransport> canned(new CannedTransport(chunkedResponse("abcdefgh", 4)));
+  THttpClient client(canned, "host", "/");
+  client.flush();
+
+  uint32_t len = 1;
+  BOOST_CHECK(client.borrow(NULL, &len) == NULL);
+
+  uint8_t c;
+  BOOST_CHECK_EQUAL(client.read(&c, 1), 1u);
+  len = 2;
+  const uint8_t* borrowed = client.borrow(NULL, &len);
+  BOOST_REQUIRE(borrowed != NULL);
+  BOOST_CHECK_EQUAL(len, 3u);
+  BOOST_CHECK_EQUAL(std::string(reinterpret_cast<const char*>(borrowed), len), "bcd");
+  client.consume(3);
+
+  len = 1;
+  BOOST_CHECK(client.borrow(NULL, &len) == NULL);
+  BOOST_CHECK_THROW(client.consume(1), TTransportException);
+  BOOST_CHECK_EQUAL(readBody(client, 4), "efgh");
+}
+
+BOOST_AUTO_TEST_CASE(test_reconnect_after_connection_close) {
+  shared_ptr<CannedTransport> canned(
+      new CannedTransport(contentResponse("one", "Connection: close\r\n")));
+  canned->addConnection(contentResponse("two") + contentResponse("three"));
+  THttpClient client(canned, "host", "/");
+
+  client.flush();
+  BOOST_CHECK_EQUAL(readBody(client, 3), "one");
+  client.flush();
+  BOOST_CHECK_EQUAL(canned->reopened(), 1);
+  BOOST_CHECK_EQUAL(readBody(client, 3), "two");
+  client.flush();
+  BOOST_CHECK_EQUAL(canned->reopened(), 1);
+  BOOST_CHECK_EQUAL(readBody(client, 5), "three");
+}
+
+BOOST_AUTO_TEST_CASE(test_reconnect_after_unfinished_response) {
+  shared_ptr<CannedTransport> canned(new CannedTransport(chunkedResponse(pattern(5000), 1000)));
+  canned->addConnection(contentResponse("next"));
+  THttpClient client(canned, "host", "/");
+
+  client.flush();
+  uint8_t buf[10];
+  client.readAll(buf, sizeof(buf));
+  // No readEnd(): the rest of the response is still on the connection.
+  client.flush();
+  BOOST_CHECK_EQUAL(canned->reopened(), 1);
+  BOOST_CHECK_EQUAL(readBody(client, 4), "next");
+}
+
+BOOST_AUTO_TEST_SUITE_END()
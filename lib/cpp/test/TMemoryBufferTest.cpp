@@ -22,13 +22,18 @@
 #include <climits>
 #include <vector>
 #include <thrift/protocol/TBinaryProtocol.h>
+#include <thrift/protocol/TCompactProtocol.h>
 #include <thrift/stdcxx.h>
 #include <thrift/transport/TBufferTransports.h>
 #include "gen-cpp/ThriftTest_types.h"
 
 BOOST_AUTO_TEST_SUITE(TMemoryBufferTest)
 
+using apache::thrift::TStringView;
 using apache::thrift::protocol::TBinaryProtocol;
+using apache::thrift::protocol::TCompactProtocol;
+using apache::thrift::protocol::TProtocol;
+using apache::thrift::transport::TFramedTransport;
 using apache::thrift::transport::TMemoryBuffer;
 using apache::thrift::transport::TTransportException;
 using apache::thrift::stdcxx::shared_ptr;
@@ -157,4 +162,76 @@ BOOST_AUTO_TEST_CASE(test_memory_buffer_to_get_sizeof_objects)
   BOOST_CHECK_EQUAL(47, size);
 }
 
+BOOST_AUTO_TEST_CASE(test_string_view_keeps_buffer)
+{
+  shared_ptr<TMemoryBuffer> buf(new TMemoryBuffer());
+  shared_ptr<TProtocol> prot(new TBinaryProtocol(buf));
+  prot->writeBinary("zero copy payload");
+
+  uint8_t* start;
+  uint32_t sz;
+  buf->getBuffer(&start, &sz);
+
+  TStringView view;
+  prot->readBinaryView(view);
+  BOOST_CHECK(view == "zero copy payload");
+  BOOST_CHECK(reinterpret_cast<const uint8_t*>(view.data()) > start);
+  BOOST_CHECK(reinterpret_cast<const uint8_t*>(view.data()) < start + sz);
+
+  // Reusing and growing the buffer must leave the view alone.
+  buf->readEnd();
+  std::vector<uint8_t> filler(4096, 'x');
+  buf->write(&filler[0], static_cast<uint32_t>(filler.size()));
+  BOOST_CHECK(view == "zero copy payload");
+
+  // The buffer can still be lent out again afterwards.
+  buf->resetBuffer();
+  prot->writeString("second");
+  TStringView view2;
+  prot->readStringView(view2);
+  BOOST_CHECK(view2 == "second");
+  BOOST_CHECK(view == "zero copy payload");
+}
+
+BOOST_AUTO_TEST_CASE(test_string_view_observed_buffer_is_copied)
+{
+  shared_ptr<TMemoryBuffer> src(new TMemoryBuffer());
+  TBinaryProtocol(src).writeString(string("observed"));
+  std::string serialized = src->getBufferAsString();
+  const uint8_t* data = reinterpret_cast<const uint8_t*>(serialized.data());
+  uint32_t sz = static_cast<uint32_t>(serialized.size());
+
+  shared_ptr<TMemoryBuffer> buf(new TMemoryBuffer(const_cast<uint8_t*>(data), sz));
+  TBinaryProtocol prot(buf);
+  TStringView view;
+  prot.readStringView(view);
+  BOOST_CHECK(view == "observed");
+  BOOST_CHECK(reinterpret_cast<const uint8_t*>(view.data()) < data
+              || reinterpret_cast<const uint8_t*>(view.data()) >= data + sz);
+}
+
+BOOST_AUTO_TEST_CASE(test_string_view_framed_compact)
+{
+  shared_ptr<TMemoryBuffer> wire(new TMemoryBuffer());
+  shared_ptr<TFramedTransport> framed(new TFramedTransport(wire));
+  shared_ptr<TProtocol> prot(new TCompactProtocol(framed));
+
+  prot->writeBinary(string(1000, 'a'));
+  framed->flush();
+  prot->writeBinary(string(1000, 'b'));
+  framed->flush();
+
+  TStringView first;
+  prot->readBinaryView(first);
+  framed->readEnd();
+  TStringView second;
+  prot->readBinaryView(second);
+  framed->readEnd();
+
+  BOOST_CHECK(first == string(1000, 'a'));
+  BOOST_CHECK(second == string(1000, 'b'));
+  BOOST_CHECK(first.data() + first.size() <= second.data()
+              || second.data() + second.size() <= first.data());
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -22,6 +22,7 @@
 
 #include "thrift/concurrency/Monitor.h"
 #include "thrift/concurrency/Thread.h"
+#include "thrift/concurrency/ThreadManager.h"
 #include "thrift/server/TNonblockingServer.h"
 #include "thrift/transport/TNonblockingServerSocket.h"
 #include "thrift/stdcxx.h"
@@ -29,6 +30,7 @@
 #include "gen-cpp/ParentService.h"
 
 #include <event.h>
+#include <set>
 
 using apache::thrift::concurrency::Guard;
 using apache::thrift::concurrency::Monitor;
@@ -37,6 +39,7 @@ using apache::thrift::concurrency::PlatformThreadFactory;
 using apache::thrift::concurrency::Runnable;
 using apache::thrift::concurrency::Thread;
 using apache::thrift::concurrency::ThreadFactory;
+using apache::thrift::concurrency::ThreadManager;
 using apache::thrift::server::TServerEventHandler;
 using apache::thrift::stdcxx::make_shared;
 using apache::thrift::stdcxx::shared_ptr;
@@ -48,10 +51,15 @@ struct Handler : public test::ParentServiceIf {
   void getStrings(std::vector<std::string>& _return) { _return = strings_; }
   std::vector<std::string> strings_;
 
+  void getDataWait(std::string& _return, const int32_t length) {
+    // length doubles as the time to take, in milliseconds
+    THRIFT_SLEEP_USEC(length * 1000);
+    _return.assign(length, 'x');
+  }
+
   // dummy overrides not used in this test
   int32_t incrementGeneration() { return 0; }
   int32_t getGeneration() { return 0; }
-  void getDataWait(std::string&, const int32_t) {}
   void onewayWait() {}
   void exceptionWait(const std::string&) {}
   void unexpectedExceptionWait(const std::string&) {}
@@ -80,9 +88,13 @@ private:
     shared_ptr<server::TNonblockingServer> server;
     shared_ptr<ListenEventHandler> listenHandler;
     shared_ptr<transport::TNonblockingServerSocket> socket;
+    size_t numIOThreads;
+    bool useReusePortAcceptors;
+    shared_ptr<ThreadManager> threadManager;
+    size_t maxPipelinedRequests;
     Mutex mutex_;
 
-    Runner() {
+    Runner() : numIOThreads(1), useReusePortAcceptors(false), maxPipelinedRequests(1) {
       listenHandler.reset(new ListenEventHandler(&mutex_));
     }
 
@@ -105,6 +117,12 @@ private:
         socket.reset(new transport::TNonblockingServerSocket(port));
         server.reset(new server::TNonblockingServer(processor, socket));
         server->setServerEventHandler(listenHandler);
+        server->setNumIOThreads(numIOThreads);
+        server->setUseReusePortAcceptors(useReusePortAcceptors);
+        if (threadManager) {
+          server->setThreadManager(threadManager);
+          server->setMaxPipelinedRequests(maxPipelinedRequests);
+        }
         if (userEventBase) {
           server->registerEvents(userEventBase.get());
         }
@@ -125,7 +143,11 @@ private:
   };
 
 protected:
-  Fixture() : processor(new test::ParentServiceProcessor(make_shared<Handler>())) {}
+  Fixture()
+    : processor(new test::ParentServiceProcessor(make_shared<Handler>())),
+      numIOThreads_(1),
+      useReusePortAcceptors_(false),
+      maxPipelinedRequests_(1) {}
 
   ~Fixture() {
     if (server) {
@@ -134,17 +156,36 @@ protected:
     if (thread) {
       thread->join();
     }
+    if (threadManager_) {
+      threadManager_->stop();
+    }
   }
 
   void setEventBase(event_base* user_event_base) {
     userEventBase_.reset(user_event_base, EventDeleter());
   }
 
+  void setIOThreads(size_t numIOThreads, bool useReusePortAcceptors) {
+    numIOThreads_ = numIOThreads;
+    useReusePortAcceptors_ = useReusePortAcceptors;
+  }
+
+  void setPipelining(size_t workers, size_t maxPipelinedRequests) {
+    threadManager_ = ThreadManager::newSimpleThreadManager(workers);
+    threadManager_->threadFactory(make_shared<PlatformThreadFactory>());
+    threadManager_->start();
+    maxPipelinedRequests_ = maxPipelinedRequests;
+  }
+
   int startServer(int port) {
     shared_ptr<Runner> runner(new Runner);
     runner->port = port;
     runner->processor = processor;
     runner->userEventBase = userEventBase_;
+    runner->numIOThreads = numIOThreads_;
+    runner->useReusePortAcceptors = useReusePortAcceptors_;
+    runner->threadManager = threadManager_;
+    runner->maxPipelinedRequests = maxPipelinedRequests_;
 
     shared_ptr<ThreadFactory> threadFactory(
         new PlatformThreadFactory(
@@ -172,9 +213,23 @@ protected:
     return strings.size() == 1 && !(strings[0].compare("foo"));
   }
 
+  size_t countStrings(int serverPort) {
+    shared_ptr<transport::TSocket> socket(new transport::TSocket("localhost", serverPort));
+    socket->open();
+    test::ParentServiceClient client(make_shared<protocol::TBinaryProtocol>(
+        make_shared<transport::TFramedTransport>(socket)));
+    std::vector<std::string> strings;
+    client.getStrings(strings);
+    return strings.size();
+  }
+
 private:
   shared_ptr<event_base> userEventBase_;
   shared_ptr<test::ParentServiceProcessor> processor;
+  size_t numIOThreads_;
+  bool useReusePortAcceptors_;
+  shared_ptr<ThreadManager> threadManager_;
+  size_t maxPipelinedRequests_;
 protected:
   shared_ptr<server::TNonblockingServer> server;
 private:
@@ -216,4 +271,122 @@ BOOST_FIXTURE_TEST_CASE(provide_event_base, Fixture) {
 #endif
 }
 
+BOOST_FIXTURE_TEST_CASE(notify_counters, Fixture) {
+  setIOThreads(4, false);
+  startServer(0);
+  int port = server->getListenPort();
+  BOOST_CHECK(canCommunicate(port));
+
+  // Connections handed from the accepting thread to IO threads #1..#3 are
+  // delivered through the notification queue; 8 round-robin picks land on
+  // thread #0 exactly twice.
+  uint64_t before = server->getNotifyCompletions();
+  for (int i = 0; i < 8; ++i) {
+    BOOST_CHECK_EQUAL(countStrings(port), 1u);
+  }
+  BOOST_CHECK_EQUAL(server->getNotifyCompletions() - before, 6u);
+  BOOST_CHECK_LE(server->getNotifyWakeups(), server->getNotifySignals());
+  BOOST_CHECK_LE(server->getNotifySignals(), server->getNotifyCompletions());
+  BOOST_CHECK_GT(server->getNotifyWakeups(), 0u);
+}
+
+#ifdef SO_REUSEPORT
+BOOST_FIXTURE_TEST_CASE(reuse_port_acceptors, Fixture) {
+  setIOThreads(4, true);
+  startServer(0);
+  int port = server->getListenPort();
+  BOOST_REQUIRE_NE(port, 0);
+  BOOST_CHECK(canCommunicate(port));
+
+  // Every IO thread listens on the same port and serves what it accepts.
+  for (int i = 0; i < 40; ++i) {
+    BOOST_CHECK_EQUAL(countStrings(port), 1u);
+  }
+}
+#endif
+
+BOOST_FIXTURE_TEST_CASE(pipelined_out_of_order, Fixture) {
+  setPipelining(4, 8);
+  startServer(0);
+
+  shared_ptr<transport::TSocket> socket(
+      new transport::TSocket("localhost", server->getListenPort()));
+  socket->open();
+  shared_ptr<protocol::TProtocol> prot = make_shared<protocol::TBinaryProtocol>(
+      make_shared<transport::TFramedTransport>(socket));
+  test::ParentServiceClient client(prot);
+
+  // The slow call is read and dispatched first, but the quick one behind it
+  // on the same connection is answered first.
+  client.send_getDataWait(500);
+  client.send_getGeneration();
+  const char* expected[] = {"getGeneration", "getDataWait"};
+  for (int i = 0; i < 2; ++i) {
+    std::string name;
+    protocol::TMessageType type;
+    int32_t seqid;
+    prot->readMessageBegin(name, type, seqid);
+    BOOST_CHECK_EQUAL(name, expected[i]);
+    BOOST_CHECK_EQUAL(type, protocol::T_REPLY);
+    prot->skip(protocol::T_STRUCT);
+    prot->readMessageEnd();
+    prot->getTransport()->readEnd();
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE(pipelined_window, Fixture) {
+  setPipelining(4, 3);
+  startServer(0);
+
+  shared_ptr<transport::TSocket> socket(
+      new transport::TSocket("localhost", server->getListenPort()));
+  socket->open();
+  shared_ptr<protocol::TProtocol> prot = make_shared<protocol::TBinaryProtocol>(
+      make_shared<transport::TFramedTransport>(socket));
+  test::ParentServiceConcurrentClient client(prot);
+
+  // Many more calls than may be in flight, oneway ones among them, all get
+  // through, each answered once under its own seqid.
+  std::set<int32_t> seqids;
+  for (int32_t i = 0; i < 40; ++i) {
+    if (i % 5 == 0) {
+      client.onewayWait();
+    }
+    seqids.insert(client.send_getDataWait(i % 7));
+  }
+  BOOST_REQUIRE_EQUAL(seqids.size(), 40u);
+  for (int i = 0; i < 40; ++i) {
+    std::string name;
+    protocol::TMessageType type;
+    int32_t seqid;
+    prot->readMessageBegin(name, type, seqid);
+    BOOST_CHECK_EQUAL(name, "getDataWait");
+    BOOST_CHECK_EQUAL(seqids.erase(seqid), 1u);
+    prot->skip(protocol::T_STRUCT);
+    prot->readMessageEnd();
+    prot->getTransport()->readEnd();
+  }
+}
+
+BOOST_FIXTURE_TEST_CASE(pipelined_disconnect, Fixture) {
+  setPipelining(2, 8);
+  startServer(0);
+  int port = server->getListenPort();
+
+  // Hang up with calls still processing; the connection waits for them
+  // before it is reused.
+  for (int c = 0; c < 4; ++c) {
+    shared_ptr<transport::TSocket> socket(new transport::TSocket("localhost", port));
+    socket->open();
+    test::ParentServiceClient client(make_shared<protocol::TBinaryProtocol>(
+        make_shared<transport::TFramedTransport>(socket)));
+    for (int i = 0; i < 4; ++i) {
+      client.send_getDataWait(50);
+    }
+    socket->close();
+  }
+  BOOST_CHECK(canCommunicate(port));
+  BOOST_CHECK_EQUAL(countStrings(port), 1u);
+}
+
 BOOST_AUTO_TEST_SUITE_END()
@@ -0,0 +1,237 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <boost/test/auto_unit_test.hpp>
+#include <limits>
+#include <string>
+#include <thrift/protocol/TBinaryProtocol.h>
+#include <thrift/protocol/TCompactProtocol.h>
+#include <thrift/stdcxx.h>
+#include <thrift/transport/TBufferTransports.h>
+#include "gen-cpp/DebugProtoTest_types.h"
+#include "gen-cpp/Recursive_types.h"
+
+BOOST_AUTO_TEST_SUITE(TSerializedSizeTest)
+
+using apache::thrift::protocol::TBinaryProtocol;
+using apache::thrift::protocol::TCompactProtocol;
+using apache::thrift::protocol::TCompactSizer;
+using apache::thrift::protocol::TLEBinaryProtocol;
+using apache::thrift::stdcxx::shared_ptr;
+using apache::thrift::transport::TFramedTransport;
+using apache::thrift::transport::TMemoryBuffer;
+using apache::thrift::transport::TTransportException;
+using namespace thrift::test::debug;
+
+template <typename Protocol, typename Struct>
+static void checkSize(const Struct& s) {
+  shared_ptr<TMemoryBuffer> buf(new TMemoryBuffer());
+  Protocol prot(buf);
+  // Not what write() returns, which leaves out the empty structs written for
+  // null cpp.ref fields.
+  s.write(&prot);
+  BOOST_CHECK_EQUAL(s.template serializedSize<Protocol>(), buf->available_read());
+}
+
+template <typename Struct>
+static void checkSizes(const Struct& s) {
+  checkSize<TBinaryProtocol>(s);
+  checkSize<TLEBinaryProtocol>(s);
+  checkSize<TCompactProtocol>(s);
+}
+
+static OneOfEach makeOneOfEach() {
+  OneOfEach ooe;
+  ooe.im_true = true;
+  ooe.integer16 = -300;
+  ooe.integer32 = std::numeric_limits<int32_t>::min();
+  ooe.integer64 = std::numeric_limits<int64_t>::max();
+  ooe.double_precision = 3.14;
+  ooe.some_characters = "Debug THIS!";
+  ooe.zomg_unicode = "\xd3\x80\xe2\x85\xae";
+  ooe.base64 = std::string("\0\1\2", 3);
+  for (int16_t i = 0; i < 20; ++i) {
+    ooe.i16_list.push_back(static_cast<int16_t>(i * -1000));
+    ooe.i64_list.push_back(static_cast<int64_t>(i) << (2 * i));
+  }
+  return ooe;
+}
+
+BOOST_AUTO_TEST_CASE(test_varint_sizes) {
+  BOOST_CHECK_EQUAL(TCompactSizer::varint32(0), 1u);
+  BOOST_CHECK_EQUAL(TCompactSizer::varint32(127), 1u);
+  BOOST_CHECK_EQUAL(TCompactSizer::varint32(128), 2u);
+  BOOST_CHECK_EQUAL(TCompactSizer::varint32(16383), 2u);
+  BOOST_CHECK_EQUAL(TCompactSizer::varint32(16384), 3u);
+  BOOST_CHECK_EQUAL(TCompactSizer::varint32(0xffffffff), 5u);
+  BOOST_CHECK_EQUAL(TCompactSizer::varint64(0), 1u);
+  BOOST_CHECK_EQUAL(TCompactSizer::varint64(static_cast<uint64_t>(1) << 63), 10u);
+  BOOST_CHECK_EQUAL(TCompactSizer::zigzag32(-1), 1u);
+  BOOST_CHECK_EQUAL(TCompactSizer::zigzag64(std::numeric_limits<int64_t>::min()),
+                    std::numeric_limits<uint64_t>::max());
+}
+
+BOOST_AUTO_TEST_CASE(test_defaults) {
+  checkSizes(OneOfEach());
+  checkSizes(Empty());
+  checkSizes(Wrapper());
+  checkSizes(CompactProtoTestStruct());
+  checkSizes(TupleProtocolTestStruct());
+}
+
+BOOST_AUTO_TEST_CASE(test_values) {
+  OneOfEach ooe = makeOneOfEach();
+  checkSizes(ooe);
+
+  Nesting n;
+  n.my_ooe = ooe;
+  n.my_bonk.type = 31337;
+  n.my_bonk.message = "I am a bonk... xor!";
+  checkSizes(n);
+
+  HolyMoley hm;
+  hm.big.push_back(ooe);
+  hm.big.push_back(OneOfEach());
+  std::vector<std::string> stage;
+  stage.push_back("and a one");
+  stage.push_back("and a two");
+  hm.contain.insert(stage);
+  hm.contain.insert(std::vector<std::string>());
+  hm.bonks["nothing"];
+  hm.bonks["something"].push_back(n.my_bonk);
+  checkSizes(hm);
+}
+
+BOOST_AUTO_TEST_CASE(test_field_headers) {
+  // Out of order, far apart and negative field ids have headers of their own
+  // in the compact protocol.
+  Backwards b;
+  b.first_tag2 = 1;
+  b.second_tag1 = 2;
+  checkSizes(b);
+
+  BreaksRubyCompactProtocol big;
+  big.field1 = "one";
+  big.field2.field2 = "forty-five";
+  checkSizes(big);
+
+  TupleProtocolTestStruct tuple;
+  tuple.__set_field1(-1);
+  tuple.__set_field12(1 << 20);
+  checkSizes(tuple);
+}
+
+BOOST_AUTO_TEST_CASE(test_containers) {
+  CompactProtoTestStruct c;
+  c.a_i16 = -1;
+  c.true_field = true;
+  for (int i = 0; i < 200; ++i) {
+    c.byte_list.push_back(static_cast<int8_t>(i));
+    c.i32_list.push_back(i * 12345);
+    c.double_list.push_back(i / 3.0);
+    c.boolean_list.push_back(i % 3 == 0);
+    c.i64_set.insert(-static_cast<int64_t>(i) << 40);
+    c.byte_string_map[static_cast<int8_t>(i)] = std::string(i, 'x');
+  }
+  c.string_list.push_back("");
+  c.struct_list.resize(15);
+  c.boolean_set.insert(false);
+  c.byte_map_map[1][2] = 3;
+  c.map_byte_map[std::map<int8_t, int8_t>()] = 1;
+  checkSizes(c);
+
+  StructWithASomemap m;
+  checkSizes(m);
+  m.somemap_field[1] = 2;
+  checkSizes(m);
+}
+
+BOOST_AUTO_TEST_CASE(test_unions_and_references) {
+  TestUnion u;
+  checkSizes(u);
+  u.__set_struct_field(makeOneOfEach());
+  checkSizes(u);
+
+  RecList list;
+  list.item = 1;
+  checkSizes(list);
+  list.nextitem.reset(new RecList());
+  list.nextitem->item = 2;
+  checkSizes(list);
+
+  RecTree tree;
+  tree.children.resize(3);
+  tree.children[1].children.resize(2);
+  checkSizes(tree);
+}
+
+BOOST_AUTO_TEST_CASE(test_memory_buffer_reserve) {
+  HolyMoley hm;
+  hm.big.resize(50, makeOneOfEach());
+  uint32_t size = hm.serializedSize<TBinaryProtocol>();
+
+  shared_ptr<TMemoryBuffer> buf(new TMemoryBuffer(16));
+  buf->reserve(size);
+  BOOST_CHECK_EQUAL(buf->getBufferSize(), size);
+  TBinaryProtocol prot(buf);
+  hm.write(&prot);
+  BOOST_CHECK_EQUAL(buf->getBufferSize(), size);
+  BOOST_CHECK_EQUAL(buf->available_read(), size);
+
+  // Room that is already there is not added to.
+  buf->reserve(0);
+  BOOST_CHECK_EQUAL(buf->getBufferSize(), size);
+
+  uint8_t data[4];
+  TMemoryBuffer observed(data, sizeof(data));
+  BOOST_CHECK_THROW(observed.reserve(8), TTransportException);
+}
+
+BOOST_AUTO_TEST_CASE(test_framed_begin_frame) {
+  HolyMoley hm;
+  hm.big.resize(50, makeOneOfEach());
+  uint32_t size = hm.serializedSize<TCompactProtocol>();
+
+  shared_ptr<TMemoryBuffer> plainOut(new TMemoryBuffer());
+  shared_ptr<TFramedTransport> plain(new TFramedTransport(plainOut));
+  TCompactProtocol plainProt(plain);
+  hm.write(&plainProt);
+  plain->flush();
+
+  shared_ptr<TMemoryBuffer> sizedOut(new TMemoryBuffer());
+  shared_ptr<TFramedTransport> sized(new TFramedTransport(sizedOut));
+  TCompactProtocol sizedProt(sized);
+  // Reachable from any protocol, as the transport it writes to.
+  sizedProt.getTransport()->beginFrame(size);
+  hm.write(&sizedProt);
+  sized->flush();
+  BOOST_CHECK_EQUAL(sizedOut->getBufferAsString(), plainOut->getBufferAsString());
+
+  // A wrong size is corrected when the frame is flushed.
+  sized->beginFrame(size + 10);
+  hm.write(&sizedProt);
+  sized->flush();
+  BOOST_CHECK_EQUAL(sizedOut->getBufferAsString(), plainOut->getBufferAsString() + plainOut->getBufferAsString());
+
+  uint8_t byte = 0;
+  sized->write(&byte, 1);
+  BOOST_CHECK_THROW(sized->beginFrame(1), TTransportException);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
@@ -23,11 +23,14 @@
 #include <thrift/stdcxx.h>
 #include "TTransportCheckThrow.h"
 #include <iostream>
+#include <string>
+#include <vector>
 
 using apache::thrift::transport::TServerSocket;
 using apache::thrift::transport::TSocket;
 using apache::thrift::transport::TTransport;
 using apache::thrift::transport::TTransportException;
+using apache::thrift::transport::TWriteSegment;
 using apache::thrift::stdcxx::shared_ptr;
 
 BOOST_AUTO_TEST_SUITE(TServerSocketTest)
@@ -48,6 +51,38 @@ BOOST_AUTO_TEST_CASE(test_bind_to_address) {
   sock2.close();
 }
 
+BOOST_AUTO_TEST_CASE(test_write_segments) {
+  TServerSocket sock1("localhost", 0);
+  sock1.listen();
+  TSocket clientSock("localhost", sock1.getPort());
+  clientSock.open();
+  shared_ptr<TTransport> accepted = sock1.accept();
+
+  // More segments than one sendmsg() batch, some of them empty.
+  std::string payload;
+  for (int i = 0; i < 150; ++i) {
+    payload.append(std::string(i % 7 == 0 ? 0 : i, static_cast<char>('a' + i % 26)));
+  }
+  std::vector<TWriteSegment> segs;
+  uint32_t pos = 0;
+  for (int i = 0; i < 150; ++i) {
+    uint32_t len = i % 7 == 0 ? 0 : i;
+    TWriteSegment seg = {reinterpret_cast<const uint8_t*>(payload.data()) + pos, len};
+    segs.push_back(seg);
+    pos += len;
+  }
+  clientSock.writeSegments(&segs[0], static_cast<uint32_t>(segs.size()));
+
+  std::string received(payload.size(), '\0');
+  accepted->readAll(reinterpret_cast<uint8_t*>(&received[0]),
+                    static_cast<uint32_t>(received.size()));
+  BOOST_CHECK(received == payload);
+
+  clientSock.close();
+  accepted->close();
+  sock1.close();
+}
+
 BOOST_AUTO_TEST_CASE(test_listen_valid_port) {
   TServerSocket sock1(-1);
   TTRANSPORT_CHECK_THROW(sock1.listen(), TTransportException::BAD_ARGS);
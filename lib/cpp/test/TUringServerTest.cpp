@@ -0,0 +1,366 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#define BOOST_TEST_MODULE TUringServerTest
+#include <boost/test/auto_unit_test.hpp>
+#include <boost/thread.hpp>
+#include <string>
+#include <vector>
+#include <thrift/concurrency/Monitor.h>
+#include <thrift/concurrency/PlatformThreadFactory.h>
+#include <thrift/concurrency/ThreadManager.h>
+#include <thrift/protocol/TBinaryProtocol.h>
+#include <thrift/server/TUringServer.h>
+#include <thrift/stdcxx.h>
+#include <thrift/transport/TBufferTransports.h>
+#include <thrift/transport/TServerSocket.h>
+#include <thrift/transport/TSocket.h>
+#include "gen-cpp/ParentService.h"
+
+using apache::thrift::TException;
+using apache::thrift::TProcessor;
+using apache::thrift::concurrency::Guard;
+using apache::thrift::concurrency::Monitor;
+using apache::thrift::concurrency::Mutex;
+using apache::thrift::concurrency::PlatformThreadFactory;
+using apache::thrift::concurrency::Synchronized;
+using apache::thrift::concurrency::ThreadManager;
+using apache::thrift::protocol::TBinaryProtocol;
+using apache::thrift::protocol::TBinaryProtocolFactory;
+using apache::thrift::protocol::TProtocol;
+using apache::thrift::server::TServerEventHandler;
+using apache::thrift::server::TUringServer;
+using apache::thrift::stdcxx::shared_ptr;
+using apache::thrift::test::ParentServiceClient;
+using apache::thrift::test::ParentServiceIf;
+using apache::thrift::test::ParentServiceProcessor;
+using apache::thrift::transport::TFramedTransport;
+using apache::thrift::transport::TServerSocket;
+using apache::thrift::transport::TSocket;
+using apache::thrift::transport::TTransportException;
+
+class ParentHandler : public ParentServiceIf {
+public:
+  ParentHandler() : generation_(0) {}
+
+  int32_t incrementGeneration() {
+    Guard g(mutex_);
+    return ++generation_;
+  }
+
+  int32_t getGeneration() {
+    Guard g(mutex_);
+    return generation_;
+  }
+
+  void addString(const std::string& s) {
+    Guard g(mutex_);
+    strings_.push_back(s);
+  }
+
+  void getStrings(std::vector<std::string>& _return) {
+    Guard g(mutex_);
+    _return = strings_;
+  }
+
+  void getDataWait(std::string& _return, const int32_t length) { _return.assign(length, 'd'); }
+
+  void onewayWait() { incrementGeneration(); }
+
+  void exceptionWait(const std::string&) {}
+
+  void unexpectedExceptionWait(const std::string&) {}
+
+private:
+  Mutex mutex_;
+  int32_t generation_;
+  std::vector<std::string> strings_;
+};
+
+class ListeningHandler : public TServerEventHandler, public Monitor {
+public:
+  ListeningHandler() : listening_(false) {}
+  virtual void preServe() {
+    Synchronized sync(*this);
+    listening_ = true;
+    notify();
+  }
+  bool listening_;
+};
+
+/**
+ * Runs a TUringServer with the given backend on a free port; started() is
+ * false if the backend is not available here.
+ */
+class ServerFixture {
+public:
+  ServerFixture(TUringServer::Backend backend, int workers, unsigned ringEntries = 0)
+    : handler_(new ParentHandler),
+      socket_(new TServerSocket("localhost", 0)),
+      listening_(new ListeningHandler),
+      failed_(false) {
+    shared_ptr<ThreadManager> threadManager;
+    if (workers > 0) {
+      threadManager = ThreadManager::newSimpleThreadManager(workers);
+      threadManager->threadFactory(shared_ptr<PlatformThreadFactory>(new PlatformThreadFactory));
+      threadManager->start();
+    }
+    server_.reset(new TUringServer(shared_ptr<TProcessor>(new ParentServiceProcessor(handler_)),
+                                   socket_,
+                                   shared_ptr<TBinaryProtocolFactory>(new TBinaryProtocolFactory),
+                                   threadManager));
+    server_->setBackend(backend);
+    server_->setReadBufferSize(4096);
+    server_->setRegisteredBuffers(4);
+    if (ringEntries > 0) {
+      server_->setRingEntries(ringEntries);
+    }
+    server_->setServerEventHandler(listening_);
+    thread_.reset(new boost::thread(apache::thrift::stdcxx::bind(&ServerFixture::run, this)));
+
+    Synchronized sync(*listening_);
+    while (!listening_->listening_ && !failed_) {
+      listening_->wait();
+    }
+  }
+
+  ~ServerFixture() {
+    server_->stop();
+    thread_->join();
+    if (server_->getThreadManager()) {
+      server_->getThreadManager()->stop();
+    }
+  }
+
+  bool started() const { return !failed_; }
+
+  shared_ptr<TFramedTransport> connect() {
+    shared_ptr<TSocket> socket(new TSocket("localhost", socket_->getPort()));
+    shared_ptr<TFramedTransport> framed(new TFramedTransport(socket));
+    framed->open();
+    return framed;
+  }
+
+  shared_ptr<TUringServer> server_;
+
+private:
+  void run() {
+    try {
+      server_->serve();
+    } catch (const TException& x) {
+      BOOST_TEST_MESSAGE(std::string("  serve() failed: ") + x.what());
+      Synchronized sync(*listening_);
+      failed_ = true;
+      listening_->notify();
+    }
+  }
+
+  shared_ptr<ParentHandler> handler_;
+  shared_ptr<TServerSocket> socket_;
+  shared_ptr<ListeningHandler> listening_;
+  shared_ptr<boost::thread> thread_;
+  bool failed_;
+};
+
+static void testManyConnections(TUringServer::Backend backend) {
+  ServerFixture fixture(backend, 2);
+  if (!fixture.started()) {
+    return;
+  }
+
+  // More connections than workers and registered buffers
+  std::vector<shared_ptr<ParentServiceClient> > clients;
+  for (int i = 0; i < 20; ++i) {
+    clients.push_back(shared_ptr<ParentServiceClient>(
+        new ParentServiceClient(shared_ptr<TProtocol>(new TBinaryProtocol(fixture.connect())))));
+  }
+  for (int round = 0; round < 3; ++round) {
+    for (size_t i = 0; i < clients.size(); ++i) {
+      clients[i]->incrementGeneration();
+    }
+  }
+  BOOST_CHECK_EQUAL(clients[0]->getGeneration(), 60);
+  BOOST_CHECK_EQUAL(fixture.server_->getNumConnections(), 20);
+
+  clients.clear();
+  for (int i = 0; i < 100 && fixture.server_->getNumConnections() > 0; ++i) {
+    boost::this_thread::sleep(boost::posix_time::milliseconds(10));
+  }
+  BOOST_CHECK_EQUAL(fixture.server_->getNumConnections(), 0);
+}
+
+static void testCompletionBurst() {
+  // A ring of 2 entries has room for 16 completions; every connection
+  // below has a receive in flight, and they all complete at once.
+  ServerFixture fixture(TUringServer::BACKEND_IO_URING, 0, 2);
+  if (!fixture.started()) {
+    return;
+  }
+
+  std::vector<shared_ptr<ParentServiceClient> > clients;
+  for (int i = 0; i < 100; ++i) {
+    clients.push_back(shared_ptr<ParentServiceClient>(
+        new ParentServiceClient(shared_ptr<TProtocol>(new TBinaryProtocol(fixture.connect())))));
+  }
+  for (int round = 0; round < 3; ++round) {
+    for (size_t i = 0; i < clients.size(); ++i) {
+      clients[i]->send_incrementGeneration();
+    }
+    for (size_t i = 0; i < clients.size(); ++i) {
+      clients[i]->recv_incrementGeneration();
+    }
+  }
+  BOOST_CHECK_EQUAL(clients[0]->getGeneration(), 300);
+}
+
+static void testLargeRequests(TUringServer::Backend backend, int workers) {
+  ServerFixture fixture(backend, workers);
+  if (!fixture.started()) {
+    return;
+  }
+
+  ParentServiceClient client(shared_ptr<TProtocol>(new TBinaryProtocol(fixture.connect())));
+  std::string big(300000, 'b');
+  for (size_t i = 0; i < big.size(); i += 1000) {
+    big[i] = static_cast<char>('a' + i / 1000 % 26);
+  }
+  client.addString("small");
+  client.addString(big);
+  client.addString("after");
+
+  std::vector<std::string> strings;
+  client.getStrings(strings);
+  BOOST_REQUIRE_EQUAL(strings.size(), 3u);
+  BOOST_CHECK(strings[1] == big);
+  BOOST_CHECK_EQUAL(strings[2], "after");
+
+  std::string data;
+  client.getDataWait(data, 1 << 20);
+  BOOST_CHECK_EQUAL(data.size(), 1u << 20);
+}
+
+static void testPipelinedRequests(TUringServer::Backend backend) {
+  ServerFixture fixture(backend, 2);
+  if (!fixture.started()) {
+    return;
+  }
+
+  // Requests written back to back arrive in one read; they are answered
+  // in order.
+  shared_ptr<TFramedTransport> transport = fixture.connect();
+  ParentServiceClient client(shared_ptr<TProtocol>(new TBinaryProtocol(transport)));
+  client.send_onewayWait();
+  client.send_incrementGeneration();
+  client.send_incrementGeneration();
+  client.send_getGeneration();
+  BOOST_CHECK_EQUAL(client.recv_incrementGeneration(), 2);
+  BOOST_CHECK_EQUAL(client.recv_incrementGeneration(), 3);
+  BOOST_CHECK_EQUAL(client.recv_getGeneration(), 3);
+}
+
+static void testBadFrameClosesConnection(TUringServer::Backend backend) {
+  ServerFixture fixture(backend, 0);
+  if (!fixture.started()) {
+    return;
+  }
+
+  shared_ptr<TFramedTransport> transport = fixture.connect();
+  uint8_t frame[8] = {0x7f, 0xff, 0xff, 0xff, 0, 0, 0, 0};
+  transport->getUnderlyingTransport()->write(frame, sizeof(frame));
+  transport->getUnderlyingTransport()->flush();
+  uint8_t buf[4];
+  BOOST_CHECK_EQUAL(transport->getUnderlyingTransport()->read(buf, sizeof(buf)), 0u);
+
+  // Other connections are unaffected.
+  ParentServiceClient client(shared_ptr<TProtocol>(new TBinaryProtocol(fixture.connect())));
+  BOOST_CHECK_EQUAL(client.incrementGeneration(), 1);
+}
+
+static void testStopWithIdleConnections(TUringServer::Backend backend) {
+  shared_ptr<TFramedTransport> idle;
+  {
+    ServerFixture fixture(backend, 1);
+    if (!fixture.started()) {
+      return;
+    }
+    idle = fixture.connect();
+    ParentServiceClient client(shared_ptr<TProtocol>(new TBinaryProtocol(idle)));
+    client.incrementGeneration();
+  }
+  uint8_t buf[4];
+  BOOST_CHECK_EQUAL(idle->getUnderlyingTransport()->read(buf, sizeof(buf)), 0u);
+}
+
+BOOST_AUTO_TEST_SUITE(TUringServerTest)
+
+BOOST_AUTO_TEST_CASE(test_io_uring_many_connections) {
+  testManyConnections(TUringServer::BACKEND_IO_URING);
+}
+
+BOOST_AUTO_TEST_CASE(test_epoll_many_connections) {
+  testManyConnections(TUringServer::BACKEND_EPOLL);
+}
+
+BOOST_AUTO_TEST_CASE(test_io_uring_completion_burst) {
+  testCompletionBurst();
+}
+
+BOOST_AUTO_TEST_CASE(test_io_uring_large_requests) {
+  testLargeRequests(TUringServer::BACKEND_IO_URING, 2);
+  testLargeRequests(TUringServer::BACKEND_IO_URING, 0);
+}
+
+BOOST_AUTO_TEST_CASE(test_epoll_large_requests) {
+  testLargeRequests(TUringServer::BACKEND_EPOLL, 2);
+  testLargeRequests(TUringServer::BACKEND_EPOLL, 0);
+}
+
+BOOST_AUTO_TEST_CASE(test_io_uring_pipelined_requests) {
+  testPipelinedRequests(TUringServer::BACKEND_IO_URING);
+}
+
+BOOST_AUTO_TEST_CASE(test_epoll_pipelined_requests) {
+  testPipelinedRequests(TUringServer::BACKEND_EPOLL);
+}
+
+BOOST_AUTO_TEST_CASE(test_io_uring_bad_frame) {
+  testBadFrameClosesConnection(TUringServer::BACKEND_IO_URING);
+}
+
+BOOST_AUTO_TEST_CASE(test_epoll_bad_frame) {
+  testBadFrameClosesConnection(TUringServer::BACKEND_EPOLL);
+}
+
+BOOST_AUTO_TEST_CASE(test_io_uring_stop) {
+  testStopWithIdleConnections(TUringServer::BACKEND_IO_URING);
+}
+
+BOOST_AUTO_TEST_CASE(test_epoll_stop) {
+  testStopWithIdleConnections(TUringServer::BACKEND_EPOLL);
+}
+
+BOOST_AUTO_TEST_CASE(test_auto_backend) {
+  ServerFixture fixture(TUringServer::BACKEND_AUTO, 1);
+  BOOST_REQUIRE(fixture.started());
+  BOOST_CHECK(fixture.server_->getActiveBackend() != TUringServer::BACKEND_AUTO);
+  ParentServiceClient client(shared_ptr<TProtocol>(new TBinaryProtocol(fixture.connect())));
+  BOOST_CHECK_EQUAL(client.incrementGeneration(), 1);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
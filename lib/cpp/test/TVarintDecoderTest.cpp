@@ -0,0 +1,144 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#include <limits>
+#include <vector>
+
+#include <boost/test/auto_unit_test.hpp>
+
+#include <thrift/protocol/TCompactProtocol.h>
+#include <thrift/protocol/TVarintDecoder.h>
+#include <thrift/stdcxx.h>
+#include <thrift/transport/TBufferTransports.h>
+
+BOOST_AUTO_TEST_SUITE(TVarintDecoderTest)
+
+using apache::thrift::protocol::TCompactProtocol;
+using apache::thrift::protocol::TProtocolException;
+using apache::thrift::protocol::detail::compact::decodeZigzagVarints;
+using apache::thrift::stdcxx::shared_ptr;
+using apache::thrift::transport::TBufferedTransport;
+using apache::thrift::transport::TMemoryBuffer;
+
+// Small values in long runs exercise the vector kernels; the occasional
+// large value forces the multi-byte path in between.
+template <typename T>
+std::vector<T> makeValues(size_t count) {
+  std::vector<T> values;
+  uint64_t state = 12345;
+  for (size_t i = 0; i < count; ++i) {
+    state = state * 6364136223846793005ULL + 1442695040888963407ULL;
+    if (i % 37 == 5) {
+      values.push_back(static_cast<T>(state >> 3));
+    } else if (i % 37 == 20) {
+      values.push_back(static_cast<T>(-static_cast<int64_t>(state >> 50)));
+    } else {
+      values.push_back(static_cast<T>(static_cast<int>(state >> 58) - 32));
+    }
+  }
+  values.push_back((std::numeric_limits<T>::min)());
+  values.push_back((std::numeric_limits<T>::max)());
+  return values;
+}
+
+void writeValue(TCompactProtocol& prot, int16_t value) {
+  prot.writeI16(value);
+}
+void writeValue(TCompactProtocol& prot, int32_t value) {
+  prot.writeI32(value);
+}
+void writeValue(TCompactProtocol& prot, int64_t value) {
+  prot.writeI64(value);
+}
+
+uint32_t readValues(TCompactProtocol& prot, int16_t* out, uint32_t count) {
+  return prot.readI16List(out, count);
+}
+uint32_t readValues(TCompactProtocol& prot, int32_t* out, uint32_t count) {
+  return prot.readI32List(out, count);
+}
+uint32_t readValues(TCompactProtocol& prot, int64_t* out, uint32_t count) {
+  return prot.readI64List(out, count);
+}
+
+template <typename T>
+void checkRoundTrip(size_t count, uint32_t bufferSize) {
+  std::vector<T> values = makeValues<T>(count);
+  shared_ptr<TMemoryBuffer> mem(new TMemoryBuffer());
+  TCompactProtocol writer(mem);
+  for (size_t i = 0; i < values.size(); ++i) {
+    writeValue(writer, values[i]);
+  }
+  writer.writeByte(42);
+  uint32_t written = mem->available_read();
+
+  // A small buffered transport makes varints straddle refills.
+  shared_ptr<TBufferedTransport> buffered(new TBufferedTransport(mem, bufferSize));
+  TCompactProtocol reader(buffered);
+  std::vector<T> decoded(values.size());
+  uint32_t rsize = readValues(reader, &decoded[0], static_cast<uint32_t>(decoded.size()));
+  int8_t trailer;
+  rsize += reader.readByte(trailer);
+
+  BOOST_CHECK(decoded == values);
+  BOOST_CHECK_EQUAL(trailer, 42);
+  BOOST_CHECK_EQUAL(rsize, written);
+}
+
+BOOST_AUTO_TEST_CASE(test_round_trip) {
+  BOOST_TEST_MESSAGE("varint kernel: "
+                     << apache::thrift::protocol::detail::compact::varintDecoderKernel());
+  for (size_t count = 0; count < 100; count += 7) {
+    checkRoundTrip<int16_t>(count, 512);
+    checkRoundTrip<int32_t>(count, 512);
+    checkRoundTrip<int64_t>(count, 512);
+  }
+  checkRoundTrip<int16_t>(100000, 13);
+  checkRoundTrip<int32_t>(100000, 4096);
+  checkRoundTrip<int64_t>(100000, 100);
+}
+
+BOOST_AUTO_TEST_CASE(test_truncated_buffer) {
+  // 3 one-byte values, then the first byte of a two-byte varint.
+  const uint8_t bytes[] = {0x02, 0x03, 0x04, 0x80};
+  int32_t out[4];
+  uint32_t consumed = 0;
+  BOOST_CHECK_EQUAL(decodeZigzagVarints(bytes, sizeof(bytes), out, 4, &consumed), 3u);
+  BOOST_CHECK_EQUAL(consumed, 3u);
+  BOOST_CHECK_EQUAL(out[0], 1);
+  BOOST_CHECK_EQUAL(out[1], -2);
+  BOOST_CHECK_EQUAL(out[2], 2);
+}
+
+BOOST_AUTO_TEST_CASE(test_overlong_varint) {
+  std::vector<uint8_t> bytes(40, 0x00);
+  for (int i = 0; i < 11; ++i) {
+    bytes[20 + i] = 0x80;
+  }
+  std::vector<int64_t> out(40);
+  uint32_t consumed;
+  BOOST_CHECK_THROW(decodeZigzagVarints(&bytes[0], 40, &out[0], 40, &consumed),
+                    TProtocolException);
+
+  shared_ptr<TMemoryBuffer> mem(new TMemoryBuffer(&bytes[0], 40));
+  TCompactProtocol prot(mem);
+  BOOST_CHECK_THROW(prot.readI64List(&out[0], 40), TProtocolException);
+}
+
+BOOST_AUTO_TEST_SUITE_END()
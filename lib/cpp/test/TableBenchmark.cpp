@@ -0,0 +1,180 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * Writes and reads records generated with plain cpp and with cpp:tables,
+ * over the binary and compact protocols.  Each is timed for one struct type
+ * over and over, and for 32 struct types in turn.  With many types the
+ * unrolled read() and write() methods compete for the instruction cache,
+ * whereas all tables go through the same loop.
+ *
+ * Usage: TableBenchmark [thousands of records]
+ */
+
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include <thrift/concurrency/Util.h>
+#include <thrift/protocol/TBinaryProtocol.h>
+#include <thrift/protocol/TCompactProtocol.h>
+#include <thrift/stdcxx.h>
+#include <thrift/transport/TBufferTransports.h>
+#include "gen-cpp/TableBenchmarkCode_types.h"
+#include "gen-cpp/TableBenchmarkTable_types.h"
+
+using namespace apache::thrift::protocol;
+using namespace apache::thrift::transport;
+using apache::thrift::concurrency::Util;
+using apache::thrift::stdcxx::shared_ptr;
+using std::cout;
+using std::endl;
+
+namespace code = thrift::test::tables::code;
+namespace table = thrift::test::tables::table;
+
+#define RECORDS(X)                                                                                 \
+  X(00) X(01) X(02) X(03) X(04) X(05) X(06) X(07) X(08) X(09) X(10) X(11) X(12) X(13) X(14) X(15)  \
+  X(16) X(17) X(18) X(19) X(20) X(21) X(22) X(23) X(24) X(25) X(26) X(27) X(28) X(29) X(30) X(31)
+
+/// The record that is written, the same for every type.
+template <typename Record>
+static const Record& sample() {
+  static Record r;
+  if (r.values.empty()) {
+    int32_t seed = 7;
+    r.__set_id(seed);
+    r.__set_stamp(static_cast<int64_t>(seed) * 1000003);
+    r.__set_name("record name");
+    r.__set_score(seed / 3.0);
+    r.__set_active(seed % 2 == 0);
+    for (int32_t i = 0; i < 8; ++i) {
+      r.values.push_back(seed * i);
+    }
+    r.counters["requests"] = seed;
+    r.counters["errors"] = 1;
+    r.__set_level(static_cast<int16_t>(seed % 7));
+    r.item.__set_id(seed);
+    r.item.__set_label("item");
+    r.tags.insert("a");
+    r.tags.insert("b");
+    r.items.resize(2, r.item);
+  }
+  return r;
+}
+
+/// Writes or reads a record of a given type with a given protocol.
+template <typename Protocol>
+struct Case {
+  uint32_t (*write)(Protocol* prot);
+  uint32_t (*read)(Protocol* prot);
+};
+
+template <typename Protocol, typename Record>
+static uint32_t writeRecord(Protocol* prot) {
+  return sample<Record>().write(prot);
+}
+
+template <typename Protocol, typename Record>
+static uint32_t readRecord(Protocol* prot) {
+  static Record record;
+  return record.read(prot);
+}
+
+static void report(const char* name, const char* what, int64_t usec, size_t ops) {
+  cout << "  " << std::left << std::setw(28) << name << std::setw(8) << what << std::right
+       << std::fixed << std::setprecision(1) << std::setw(10)
+       << static_cast<double>(usec) * 1000 / ops << " ns per record" << endl;
+}
+
+/// Writes and reads count records, going round the first types cases.
+template <typename Protocol>
+static std::string timeCases(const char* name,
+                             const std::vector<Case<Protocol> >& cases,
+                             size_t types,
+                             int count) {
+  shared_ptr<TMemoryBuffer> buf(new TMemoryBuffer());
+  Protocol prot(buf);
+
+  std::vector<std::string> bytes(types);
+  for (size_t t = 0; t < types; ++t) {
+    buf->resetBuffer();
+    cases[t].write(&prot);
+    bytes[t] = buf->getBufferAsString();
+  }
+
+  int64_t start = Util::currentTimeUsec();
+  for (int i = 0; i < count; ++i) {
+    buf->resetBuffer();
+    cases[i % types].write(&prot);
+  }
+  report(name, "write", Util::currentTimeUsec() - start, count);
+
+  start = Util::currentTimeUsec();
+  for (int i = 0; i < count; ++i) {
+    const std::string& b = bytes[i % types];
+    buf->resetBuffer(reinterpret_cast<uint8_t*>(const_cast<char*>(b.data())),
+                     static_cast<uint32_t>(b.size()));
+    cases[i % types].read(&prot);
+  }
+  report(name, "read", Util::currentTimeUsec() - start, count);
+
+  std::string all;
+  for (size_t t = 0; t < types; ++t) {
+    all += bytes[t];
+  }
+  return all;
+}
+
+template <typename Protocol>
+static bool run(const char* protocol, int count) {
+  std::vector<Case<Protocol> > plain;
+  std::vector<Case<Protocol> > tables;
+#define ADD_CASE(n)                                                                                \
+  {                                                                                                \
+    Case<Protocol> c = {&writeRecord<Protocol, code::Record##n>,                                   \
+                        &readRecord<Protocol, code::Record##n>};                                   \
+    plain.push_back(c);                                                                            \
+    Case<Protocol> t = {&writeRecord<Protocol, table::Record##n>,                                  \
+                        &readRecord<Protocol, table::Record##n>};                                  \
+    tables.push_back(t);                                                                           \
+  }
+  RECORDS(ADD_CASE)
+#undef ADD_CASE
+
+  cout << protocol << ":" << endl;
+  std::string one = timeCases("generated, 1 type", plain, 1, count);
+  std::string oneTable = timeCases("tables, 1 type", tables, 1, count);
+  std::string many = timeCases("generated, 32 types", plain, plain.size(), count);
+  std::string manyTable = timeCases("tables, 32 types", tables, tables.size(), count);
+  return one == oneTable && many == manyTable;
+}
+
+int main(int argc, char** argv) {
+  int count = (argc > 1 ? std::atoi(argv[1]) : 500) * 1000;
+
+  if (!run<TBinaryProtocol>("binary", count)
+      || !run<TCompactProtocol>("compact", count)) {
+    cout << "encodings differ" << endl;
+    return 1;
+  }
+  return 0;
+}
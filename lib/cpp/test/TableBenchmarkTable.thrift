@@ -0,0 +1,513 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+/*
+ * The structs of TableBenchmark, generated with cpp:tables.
+ * The two TableBenchmark*.thrift files differ only in their namespace, so
+ * that the generated versions can be linked together.  The records all have
+ * the same fields but are distinct types, each with its own read() and
+ * write(), as in an IDL with many structs.
+ */
+
+namespace cpp thrift.test.tables.table
+
+struct Item {
+  1: i32 id
+  2: string label
+}
+
+struct Record00 {
+  1: i32 id
+  2: i64 stamp
+  3: string name
+  4: double score
+  5: bool active
+  6: list<i32> values
+  7: map<string, i64> counters
+  8: optional i16 level
+  9: Item item
+  10: set<string> tags
+  11: optional string note
+  12: list<Item> items
+}
+
+struct Record01 {
+  1: i32 id
+  2: i64 stamp
+  3: string name
+  4: double score
+  5: bool active
+  6: list<i32> values
+  7: map<string, i64> counters
+  8: optional i16 level
+  9: Item item
+  10: set<string> tags
+  11: optional string note
+  12: list<Item> items
+}
+
+struct Record02 {
+  1: i32 id
+  2: i64 stamp
+  3: string name
+  4: double score
+  5: bool active
+  6: list<i32> values
+  7: map<string, i64> counters
+  8: optional i16 level
+  9: Item item
+  10: set<string> tags
+  11: optional string note
+  12: list<Item> items
+}
+
+struct Record03 {
+  1: i32 id
+  2: i64 stamp
+  3: string name
+  4: double score
+  5: bool active
+  6: list<i32> values
+  7: map<string, i64> counters
+  8: optional i16 level
+  9: Item item
+  10: set<string> tags
+  11: optional string note
+  12: list<Item> items
+}
+
+struct Record04 {
+  1: i32 id
+  2: i64 stamp
+  3: string name
+  4: double score
+  5: bool active
+  6: list<i32> values
+  7: map<string, i64> counters
+  8: optional i16 level
+  9: Item item
+  10: set<string> tags
+  11: optional string note
+  12: list<Item> items
+}
+
+struct Record05 {
+  1: i32 id
+  2: i64 stamp
+  3: string name
+  4: double score
+  5: bool active
+  6: list<i32> values
+  7: map<string, i64> counters
+  8: optional i16 level
+  9: Item item
+  10: set<string> tags
+  11: optional string note
+  12: list<Item> items
+}
+
+struct Record06 {
+  1: i32 id
+  2: i64 stamp
+  3: string name
+  4: double score
+  5: bool active
+  6: list<i32> values
+  7: map<string, i64> counters
+  8: optional i16 level
+  9: Item item
+  10: set<string> tags
+  11: optional string note
+  12: list<Item> items
+}
+
+struct Record07 {
+  1: i32 id
+  2: i64 stamp
+  3: string name
+  4: double score
+  5: bool active
+  6: list<i32> values
+  7: map<string, i64> counters
+  8: optional i16 level
+  9: Item item
+  10: set<string> tags
+  11: optional string note
+  12: list<Item> items
+}
+
+struct Record08 {
+  1: i32 id
+  2: i64 stamp
+  3: string name
+  4: double score
+  5: bool active
+  6: list<i32> values
+  7: map<string, i64> counters
+  8: optional i16 level
+  9: Item item
+  10: set<string> tags
+  11: optional string note
+  12: list<Item> items
+}
+
+struct Record09 {
+  1: i32 id
+  2: i64 stamp
+  3: string name
+  4: double score
+  5: bool active
+  6: list<i32> values
+  7: map<string, i64> counters
+  8: optional i16 level
+  9: Item item
+  10: set<string> tags
+  11: optional string note
+  12: list<Item> items
+}
+
+struct Record10 {
+  1: i32 id
+  2: i64 stamp
+  3: string name
+  4: double score
+  5: bool active
+  6: list<i32> values
+  7: map<string, i64> counters
+  8: optional i16 level
+  9: Item item
+  10: set<string> tags
+  11: optional string note
+  12: list<Item> items
+}
+
+struct Record11 {
+  1: i32 id
+  2: i64 stamp
+  3: string name
+  4: double score
+  5: bool active
+  6: list<i32> values
+  7: map<string, i64> counters
+  8: optional i16 level
+  9: Item item
+  10: set<string> tags
+  11: optional string note
+  12: list<Item> items
+}
+
+struct Record12 {
+  1: i32 id
+  2: i64 stamp
+  3: string name
+  4: double score
+  5: bool active
+  6: list<i32> values
+  7: map<string, i64> counters
+  8: optional i16 level
+  9: Item item
+  10: set<string> tags
+  11: optional string note
+  12: list<Item> items
+}
+
+struct Record13 {
+  1: i32 id
+  2: i64 stamp
+  3: string name
+  4: double score
+  5: bool active
+  6: list<i32> values
+  7: map<string, i64> counters
+  8: optional i16 level
+  9: Item item
+  10: set<string> tags
+  11: optional string note
+  12: list<Item> items
+}
+
+struct Record14 {
+  1: i32 id
+  2: i64 stamp
+  3: string name
+  4: double score
+  5: bool active
+  6: list<i32> values
+  7: map<string, i64> counters
+  8: optional i16 level
+  9: Item item
+  10: set<string> tags
+  11: optional string note
+  12: list<Item> items
+}
+
+struct Record15 {
+  1: i32 id
+  2: i64 stamp
+  3: string name
+  4: double score
+  5: bool active
+  6: list<i32> values
+  7: map<string, i64> counters
+  8: optional i16 level
+  9: Item item
+  10: set<string> tags
+  11: optional string note
+  12: list<Item> items
+}
+
+struct Record16 {
+  1: i32 id
+  2: i64 stamp
+  3: string name
+  4: double score
+  5: bool active
+  6: list<i32> values
+  7: map<string, i64> counters
+  8: optional i16 level
+  9: Item item
+  10: set<string> tags
+  11: optional string note
+  12: list<Item> items
+}
+
+struct Record17 {
+  1: i32 id
+  2: i64 stamp
+  3: string name
+  4: double score
+  5: bool active
+  6: list<i32> values
+  7: map<string, i64> counters
+  8: optional i16 level
+  9: Item item
+  10: set<string> tags
+  11: optional string note
+  12: list<Item> items
+}
+
+struct Record18 {
+  1: i32 id
+  2: i64 stamp
+  3: string name
+  4: double score
+  5: bool active
+  6: list<i32> values
+  7: map<string, i64> counters
+  8: optional i16 level
+  9: Item item
+  10: set<string> tags
+  11: optional string note
+  12: list<Item> items
+}
+
+struct Record19 {
+  1: i32 id
+  2: i64 stamp
+  3: string name
+  4: double score
+  5: bool active
+  6: list<i32> values
+  7: map<string, i64> counters
+  8: optional i16 level
+  9: Item item
+  10: set<string> tags
+  11: optional string note
+  12: list<Item> items
+}
+
+struct Record20 {
+  1: i32 id
+  2: i64 stamp
+  3: string name
+  4: double score
+  5: bool active
+  6: list<i32> values
+  7: map<string, i64> counters
+  8: optional i16 level
+  9: Item item
+  10: set<string> tags
+  11: optional string note
+  12: list<Item> items
+}
+
+struct Record21 {
+  1: i32 id
+  2: i64 stamp
+  3: string name
+  4: double score
+  5: bool active
+  6: list<i32> values
+  7: map<string, i64> counters
+  8: optional i16 level
+  9: Item item
+  10: set<string> tags
+  11: optional string note
+  12: list<Item> items
+}
+
+struct Record22 {
+  1: i32 id
+  2: i64 stamp
+  3: string name
+  4: double score
+  5: bool active
+  6: list<i32> values
+  7: map<string, i64> counters
+  8: optional i16 level
+  9: Item item
+  10: set<string> tags
+  11: optional string note
+  12: list<Item> items
+}
+
+struct Record23 {
+  1: i32 id
+  2: i64 stamp
+  3: string name
+  4: double score
+  5: bool active
+  6: list<i32> values
+  7: map<string, i64> counters
+  8: optional i16 level
+  9: Item item
+  10: set<string> tags
+  11: optional string note
+  12: list<Item> items
+}
+
+struct Record24 {
+  1: i32 id
+  2: i64 stamp
+  3: string name
+  4: double score
+  5: bool active
+  6: list<i32> values
+  7: map<string, i64> counters
+  8: optional i16 level
+  9: Item item
+  10: set<string> tags
+  11: optional string note
+  12: list<Item> items
+}
+
+struct Record25 {
+  1: i32 id
+  2: i64 stamp
+  3: string name
+  4: double score
+  5: bool active
+  6: list<i32> values
+  7: map<string, i64> counters
+  8: optional i16 level
+  9: Item item
+  10: set<string> tags
+  11: optional string note
+  12: list<Item> items
+}
+
+struct Record26 {
+  1: i32 id
+  2: i64 stamp
+  3: string name
+  4: double score
+  5: bool active
+  6: list<i32> values
+  7: map<string, i64> counters
+  8: optional i16 level
+  9: Item item
+  10: set<string> tags
+  11: optional string note
+  12: list<Item> items
+}
+
+struct Record27 {
+  1: i32 id
+  2: i64 stamp
+  3: string name
+  4: double score
+  5: bool active
+  6: list<i32> values
+  7: map<string, i64> counters
+  8: optional i16 level
+  9: Item item
+  10: set<string> tags
+  11: optional string note
+  12: list<Item> items
+}
+
+struct Record28 {
+  1: i32 id
+  2: i64 stamp
+  3: string name
+  4: double score
+  5: bool active
+  6: list<i32> values
+  7: map<string, i64> counters
+  8: optional i16 level
+  9: Item item
+  10: set<string> tags
+  11: optional string note
+  12: list<Item> items
+}
+
+struct Record29 {
+  1: i32 id
+  2: i64 stamp
+  3: string name
+  4: double score
+  5: bool active
+  6: list<i32> values
+  7: map<string, i64> counters
+  8: optional i16 level
+  9: Item item
+  10: set<string> tags
+  11: optional string note
+  12: list<Item> items
+}
+
+struct Record30 {
+  1: i32 id
+  2: i64 stamp
+  3: string name
+  4: double score
+  5: bool active
+  6: list<i32> values
+  7: map<string, i64> counters
+  8: optional i16 level
+  9: Item item
+  10: set<string> tags
+  11: optional string note
+  12: list<Item> items
+}
+
+struct Record31 {
+  1: i32 id
+  2: i64 stamp
+  3: string name
+  4: double score
+  5: bool active
+  6: list<i32> values
+  7: map<string, i64> counters
+  8: optional i16 level
+  9: Item item
+  10: set<string> tags
+  11: optional string note
+  12: list<Item> items
+}
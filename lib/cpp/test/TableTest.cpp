@@ -0,0 +1,245 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#define BOOST_TEST_MODULE TableTest
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+
+#include <thrift/protocol/TBinaryProtocol.h>
+#include <thrift/protocol/TCompactProtocol.h>
+#include <thrift/protocol/TJSONProtocol.h>
+#include <thrift/stdcxx.h>
+#include <thrift/transport/TBufferTransports.h>
+
+#include "gen-cpp/TableTest_types.h"
+
+using apache::thrift::protocol::TBinaryProtocol;
+using apache::thrift::protocol::TCompactProtocol;
+using apache::thrift::protocol::TFieldSpec;
+using apache::thrift::protocol::TJSONProtocol;
+using apache::thrift::protocol::TProtocolException;
+using apache::thrift::protocol::TStructSpec;
+using apache::thrift::protocol::T_FIELD_REQUIRED;
+using apache::thrift::stdcxx::shared_ptr;
+using apache::thrift::transport::TMemoryBuffer;
+using namespace thrift::test::table;
+
+static Point makePoint(int32_t x, int32_t y) {
+  Point p;
+  p.__set_x(x);
+  p.__set_y(y);
+  return p;
+}
+
+static Record makeRecord() {
+  Record r;
+  r.__set_flag(true);
+  r.__set_tiny(-3);
+  r.__set_small(-300);
+  r.__set_medium(70000);
+  r.__set_large(-5000000000LL);
+  r.__set_ratio(0.25);
+  r.__set_color(Color::RED);
+  r.__set_name("record");
+  r.__set_blob(std::string("\0\1\2\3", 4));
+  r.__set_origin(makePoint(1, 2));
+  for (int32_t i = 0; i < 5; ++i) {
+    r.points.push_back(makePoint(i, -i));
+    r.longs.push_back(static_cast<int64_t>(i) << 40);
+    r.doubles.push_back(i / 8.0);
+    r.shorts.push_back(static_cast<int16_t>(i * 1000));
+  }
+  r.tags.insert("b");
+  r.tags.insert("a");
+  r.groups["one"].push_back(1);
+  r.groups["two"].push_back(2);
+  r.groups["two"].push_back(3);
+  r.groups["none"];
+  r.__set_opt(9);
+  r.colors.push_back(Color::GREEN);
+  r.colors.push_back(Color::RED);
+  r.byColor[Color::RED] = makePoint(7, 8);
+  return r;
+}
+
+template <typename Protocol, typename Struct>
+static std::string serialize(const Struct& s) {
+  shared_ptr<TMemoryBuffer> buf(new TMemoryBuffer());
+  Protocol prot(buf);
+  s.write(&prot);
+  return buf->getBufferAsString();
+}
+
+template <typename Protocol, typename Struct>
+static uint32_t deserialize(const std::string& bytes, Struct& s) {
+  shared_ptr<TMemoryBuffer> buf(
+      new TMemoryBuffer(reinterpret_cast<uint8_t*>(const_cast<char*>(bytes.data())),
+                        static_cast<uint32_t>(bytes.size())));
+  Protocol prot(buf);
+  return s.read(&prot);
+}
+
+/// Reads the bytes of a Record into a TRecord and writes them out again.
+template <typename Protocol>
+static void checkRoundTrip(const Record& r) {
+  std::string bytes = serialize<Protocol>(r);
+  TRecord t;
+  BOOST_CHECK_EQUAL(deserialize<Protocol>(bytes, t), bytes.size());
+  BOOST_CHECK_EQUAL(serialize<Protocol>(t), bytes);
+
+  Record back;
+  deserialize<Protocol>(serialize<Protocol>(t), back);
+  BOOST_CHECK(back == r);
+}
+
+BOOST_AUTO_TEST_CASE(test_defaults) {
+  TRecord t;
+  BOOST_CHECK_EQUAL(serialize<TBinaryProtocol>(t), serialize<TBinaryProtocol>(Record()));
+  BOOST_CHECK_EQUAL(serialize<TCompactProtocol>(t), serialize<TCompactProtocol>(Record()));
+}
+
+BOOST_AUTO_TEST_CASE(test_binary_protocol) {
+  checkRoundTrip<TBinaryProtocol>(makeRecord());
+}
+
+BOOST_AUTO_TEST_CASE(test_compact_protocol) {
+  checkRoundTrip<TCompactProtocol>(makeRecord());
+}
+
+BOOST_AUTO_TEST_CASE(test_json_protocol) {
+  checkRoundTrip<TJSONProtocol>(makeRecord());
+}
+
+BOOST_AUTO_TEST_CASE(test_isset) {
+  Record r = makeRecord();
+  r.__isset.opt = false;
+  r.__set_optPoint(makePoint(3, 4));
+  // Setting an exception field does not mark it set.
+  r.failure.__set_code(3);
+  r.__isset.failure = true;
+  checkRoundTrip<TBinaryProtocol>(r);
+
+  TRecord t;
+  deserialize<TBinaryProtocol>(serialize<TBinaryProtocol>(r), t);
+  BOOST_CHECK(t.__isset.flag);
+  BOOST_CHECK(t.__isset.byColor);
+  BOOST_CHECK(!t.__isset.opt);
+  BOOST_CHECK(t.__isset.optPoint);
+  BOOST_CHECK(t.__isset.failure);
+  BOOST_CHECK_EQUAL(t.optPoint.y, 4);
+
+  // Unset optional fields are left out.
+  t.__isset.optPoint = false;
+  r.__isset.optPoint = false;
+  BOOST_CHECK_EQUAL(serialize<TBinaryProtocol>(t), serialize<TBinaryProtocol>(r));
+}
+
+#define ISSET_MEMBER(field)                                                                        \
+  if (name == #field) {                                                                            \
+    return t.__isset.field;                                                                        \
+  }
+
+static bool issetByName(const TRecord& t, const std::string& name) {
+  ISSET_MEMBER(flag)
+  ISSET_MEMBER(tiny)
+  ISSET_MEMBER(small)
+  ISSET_MEMBER(medium)
+  ISSET_MEMBER(large)
+  ISSET_MEMBER(ratio)
+  ISSET_MEMBER(color)
+  ISSET_MEMBER(name)
+  ISSET_MEMBER(blob)
+  ISSET_MEMBER(origin)
+  ISSET_MEMBER(points)
+  ISSET_MEMBER(longs)
+  ISSET_MEMBER(doubles)
+  ISSET_MEMBER(tags)
+  ISSET_MEMBER(groups)
+  ISSET_MEMBER(opt)
+  ISSET_MEMBER(optPoint)
+  ISSET_MEMBER(failure)
+  ISSET_MEMBER(colors)
+  ISSET_MEMBER(byColor)
+  ISSET_MEMBER(shorts)
+  BOOST_ERROR("no __isset member for " << name);
+  return false;
+}
+
+#undef ISSET_MEMBER
+
+BOOST_AUTO_TEST_CASE(test_isset_bits_match_members) {
+  const TStructSpec& spec = TRecord::__table;
+  for (uint16_t i = 0; i < spec.numFields; ++i) {
+    const TFieldSpec& field = spec.fields[i];
+    BOOST_REQUIRE(!(field.flags & T_FIELD_REQUIRED));
+    TRecord t;
+    spec.setIsset(&t, field.bit);
+    BOOST_CHECK_MESSAGE(issetByName(t, field.name), field.name);
+
+    // No other bit than the field's own moves.
+    for (uint16_t j = 0; j < spec.numFields; ++j) {
+      const TFieldSpec& other = spec.fields[j];
+      BOOST_CHECK_EQUAL(spec.testIsset(&t, other.bit), issetByName(t, other.name));
+    }
+  }
+}
+
+BOOST_AUTO_TEST_CASE(test_skips_unknown_and_mismatched_fields) {
+  Record r = makeRecord();
+  TSubset s;
+  s.__set_name(5);
+  std::string bytes = serialize<TCompactProtocol>(r);
+  BOOST_CHECK_EQUAL(deserialize<TCompactProtocol>(bytes, s), bytes.size());
+  BOOST_CHECK_EQUAL(s.medium, r.medium);
+  BOOST_CHECK_EQUAL(s.name, 5);
+  BOOST_CHECK(!s.__isset.name);
+  BOOST_CHECK(s.__isset.opt);
+  BOOST_CHECK_EQUAL(s.opt, 9);
+}
+
+BOOST_AUTO_TEST_CASE(test_required_fields) {
+  Checked c;
+  c.id = 4;
+  c.where.__set_x(5);
+  TChecked t;
+  std::string bytes = serialize<TBinaryProtocol>(c);
+  deserialize<TBinaryProtocol>(bytes, t);
+  BOOST_CHECK_EQUAL(t.id, 4);
+  BOOST_CHECK_EQUAL(t.where.x, 5);
+  BOOST_CHECK(!t.__isset.note);
+  BOOST_CHECK_EQUAL(serialize<TBinaryProtocol>(t), bytes);
+
+  // A TPoint only has fields that a Checked would take as unknown.
+  std::string missing = serialize<TBinaryProtocol>(makePoint(1, 2));
+  BOOST_CHECK_THROW(deserialize<TBinaryProtocol>(missing, t), TProtocolException);
+  Checked plain;
+  BOOST_CHECK_THROW(deserialize<TBinaryProtocol>(missing, plain), TProtocolException);
+}
+
+BOOST_AUTO_TEST_CASE(test_reread_clears_containers) {
+  Record r = makeRecord();
+  TRecord t;
+  std::string bytes = serialize<TBinaryProtocol>(r);
+  deserialize<TBinaryProtocol>(bytes, t);
+  deserialize<TBinaryProtocol>(bytes, t);
+  BOOST_CHECK_EQUAL(t.points.size(), r.points.size());
+  BOOST_CHECK_EQUAL(t.groups["two"].size(), 2u);
+  BOOST_CHECK_EQUAL(serialize<TBinaryProtocol>(t), bytes);
+}
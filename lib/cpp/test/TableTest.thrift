@@ -0,0 +1,116 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+
+/*
+ * TableTest checks that structs annotated cpp.table read and write the same
+ * bytes as their generated counterparts.  Record and TRecord have the same
+ * fields, and so do Point and TPoint, and Checked and TChecked.
+ */
+
+namespace cpp thrift.test.table
+
+enum Color {
+  RED = 1,
+  GREEN = 2
+}
+
+typedef i64 Timestamp
+
+struct Point {
+  1: i32 x
+  2: i32 y
+}
+
+struct TPoint {
+  1: i32 x
+  2: i32 y
+} (cpp.table = "true")
+
+exception Failure {
+  1: string message
+  2: i32 code
+}
+
+struct Record {
+  1: bool flag
+  2: byte tiny
+  3: i16 small
+  4: i32 medium
+  5: Timestamp large
+  6: double ratio
+  7: Color color = Color.GREEN
+  8: string name
+  9: binary blob
+  10: Point origin
+  11: list<Point> points
+  12: list<i64> longs
+  13: list<double> doubles
+  14: set<string> tags
+  15: map<string, list<i32>> groups
+  16: optional i32 opt
+  17: optional Point optPoint
+  18: Failure failure
+  19: list<Color> colors
+  20: map<Color, Point> byColor
+  21: list<i16> shorts
+}
+
+struct TRecord {
+  1: bool flag
+  2: byte tiny
+  3: i16 small
+  4: i32 medium
+  5: Timestamp large
+  6: double ratio
+  7: Color color = Color.GREEN
+  8: string name
+  9: binary blob
+  10: TPoint origin
+  11: list<TPoint> points
+  12: list<i64> longs
+  13: list<double> doubles
+  14: set<string> tags
+  15: map<string, list<i32>> groups
+  16: optional i32 opt
+  17: optional Point optPoint
+  18: Failure failure
+  19: list<Color> colors
+  20: map<Color, TPoint> byColor
+  21: list<i16> shorts
+} (cpp.table = "true")
+
+/* Some of the fields of a Record, with another type for one of them. */
+struct TSubset {
+  4: i32 medium
+  8: i64 name
+  16: optional i32 opt
+} (cpp.table = "true")
+
+struct Checked {
+  3: required i32 id
+  1: optional string note
+  2: required TPoint where
+}
+
+struct TChecked {
+  3: required i32 id
+  1: optional string note
+  2: required TPoint where
+} (cpp.table = "true")
@@ -0,0 +1,166 @@
+/*
+ * Licensed to the Apache Software Foundation (ASF) under one
+ * or more contributor license agreements. See the NOTICE file
+ * distributed with this work for additional information
+ * regarding copyright ownership. The ASF licenses this file
+ * to you under the Apache License, Version 2.0 (the
+ * "License"); you may not use this file except in compliance
+ * with the License. You may obtain a copy of the License at
+ *
+ *   http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing,
+ * software distributed under the License is distributed on an
+ * "AS IS" BASIS, WITHOUT WARRANTIES OR CONDITIONS OF ANY
+ * KIND, either express or implied. See the License for the
+ * specific language governing permissions and limitations
+ * under the License.
+ */
+
+#define BOOST_TEST_MODULE ZeroCopyTest
+#include <boost/test/unit_test.hpp>
+
+#include <string>
+
+#include <thrift/protocol/TBinaryProtocol.h>
+#include <thrift/protocol/TCompactProtocol.h>
+#include <thrift/stdcxx.h>
+#include <thrift/transport/TBufferTransports.h>
+
+#include "gen-cpp/ZeroCopyTest_types.h"
+
+using apache::thrift::protocol::TBinaryProtocol;
+using apache::thrift::protocol::TCompactProtocol;
+using apache::thrift::stdcxx::shared_ptr;
+using apache::thrift::transport::TBufferedTransport;
+using apache::thrift::transport::TFramedTransport;
+using apache::thrift::transport::TMemoryBuffer;
+using namespace thrift::test::zerocopy;
+
+static Record makeRecord(int32_t id) {
+  Record r;
+  r.__set_id(id);
+  r.__set_name("record-" + std::string(1, static_cast<char>('a' + id % 26)));
+  r.__set_blob(std::string(64, static_cast<char>(id)));
+  for (int32_t i = 0; i < 3; ++i) {
+    r.tags.push_back("tag-" + std::string(1, static_cast<char>('0' + i)));
+  }
+  return r;
+}
+
+/// Serializes each record into a frame of its own.
+template <typename Protocol>
+static std::string frames(const Record& first, const Record& second) {
+  shared_ptr<TMemoryBuffer> buf(new TMemoryBuffer());
+  shared_ptr<TFramedTransport> framed(new TFramedTransport(buf));
+  Protocol prot(framed);
+  first.write(&prot);
+  framed->flush();
+  second.write(&prot);
+  framed->flush();
+  return buf->getBufferAsString();
+}
+
+/// Wraps a copy of bytes in a transport that owns it.
+static shared_ptr<TMemoryBuffer> source(const std::string& bytes) {
+  return shared_ptr<TMemoryBuffer>(
+      new TMemoryBuffer(reinterpret_cast<uint8_t*>(const_cast<char*>(bytes.data())),
+                        static_cast<uint32_t>(bytes.size()),
+                        TMemoryBuffer::COPY));
+}
+
+/// Whether two handles share one control block, not just one address.
+static bool sameHandle(const shared_ptr<void>& a, const shared_ptr<void>& b) {
+  return !a.owner_before(b) && !b.owner_before(a);
+}
+
+template <typename Protocol>
+static void checkFramedReadsBorrow() {
+  const Record first = makeRecord(1);
+  const Record second = makeRecord(2);
+  shared_ptr<TFramedTransport> framed(new TFramedTransport(source(frames<Protocol>(first, second))));
+  Protocol prot(framed);
+
+  Record a;
+  a.read(&prot);
+  BOOST_CHECK(a == first);
+
+  // Every string of the frame points into it and shares one handle on it.
+  const char* frame = static_cast<const char*>(a.name.owner().get());
+  BOOST_REQUIRE(frame != NULL);
+  BOOST_CHECK(a.name.data() > frame);
+  BOOST_CHECK(sameHandle(a.blob.owner(), a.name.owner()));
+  for (size_t i = 0; i < a.tags.size(); ++i) {
+    BOOST_CHECK(sameHandle(a.tags[i].owner(), a.name.owner()));
+    BOOST_CHECK(a.tags[i].data() > frame);
+  }
+  BOOST_CHECK(a.blob.data() < a.tags[0].data());
+
+  // The next frame goes into a new buffer while a still refers to the first.
+  Record b;
+  b.read(&prot);
+  BOOST_CHECK(b == second);
+  BOOST_CHECK(b.name.owner() != a.name.owner());
+  BOOST_CHECK(b.name.owner().get() != a.name.owner().get());
+  BOOST_CHECK(a == first);
+}
+
+template <typename Protocol>
+static void checkViewOutlivesTransport() {
+  const Record first = makeRecord(3);
+  Record a;
+  {
+    shared_ptr<TFramedTransport> framed(
+        new TFramedTransport(source(frames<Protocol>(first, makeRecord(4)))));
+    Protocol prot(framed);
+    a.read(&prot);
+    Record b;
+    b.read(&prot);
+  }
+  BOOST_CHECK(a == first);
+  BOOST_CHECK_EQUAL(a.blob.str(), std::string(64, static_cast<char>(3)));
+}
+
+template <typename Protocol>
+static void checkNonLendingTransportCopies() {
+  const Record first = makeRecord(5);
+  shared_ptr<TMemoryBuffer> out(new TMemoryBuffer());
+  Protocol writer(out);
+  first.write(&writer);
+
+  // TBufferedTransport cannot lend out its buffer, so each field gets a copy.
+  shared_ptr<TBufferedTransport> buffered(new TBufferedTransport(source(out->getBufferAsString())));
+  Protocol prot(buffered);
+  Record a;
+  a.read(&prot);
+  BOOST_CHECK(a == first);
+  BOOST_CHECK(a.blob.owner() != a.name.owner());
+  BOOST_CHECK(a.tags[0].owner() != a.tags[1].owner());
+  BOOST_CHECK_EQUAL(static_cast<const void*>(a.name.data()),
+                    static_cast<const void*>(
+                        static_cast<const std::string*>(a.name.owner().get())->data()));
+}
+
+BOOST_AUTO_TEST_CASE(test_binary_framed_reads_borrow) {
+  checkFramedReadsBorrow<TBinaryProtocol>();
+}
+
+BOOST_AUTO_TEST_CASE(test_compact_framed_reads_borrow) {
+  checkFramedReadsBorrow<TCompactProtocol>();
+}
+
+BOOST_AUTO_TEST_CASE(test_binary_view_outlives_transport) {
+  checkViewOutlivesTransport<TBinaryProtocol>();
+}
+
+BOOST_AUTO_TEST_CASE(test_compact_view_outlives_transport) {
+  checkViewOutlivesTransport<TCompactProtocol>();
+}
+
+BOOST_AUTO_TEST_CASE(test_binary_non_lending_transport_copies) {
+  checkNonLendingTransportCopies<TBinaryProtocol>();
+}
+
+BOOST_AUTO_TEST_CASE(test_compact_non_lending_transport_copies) {
+  checkNonLendingTransportCopies<TCompactProtocol>();
+}
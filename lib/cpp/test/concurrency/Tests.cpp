@@ -151,6 +151,25 @@ int main(int argc, char** argv) {
       std::cerr << "\t\tTimerManager tests FAILED" << std::endl;
       return 1;
     }
+
+    std::cout << "\t\tTimerManager test05" << std::endl;
+
+    if (!timerManagerTests.test05()) {
+      std::cerr << "\t\tTimerManager tests FAILED" << std::endl;
+      return 1;
+    }
+  }
+
+  if (runAll || args[0].compare("timer-manager-benchmark") == 0) {
+
+    std::cout << "TimerManager benchmark..." << std::endl;
+
+    TimerManagerTests timerManagerTests;
+
+    if (!timerManagerTests.benchmark(100000 * WEIGHT)) {
+      std::cerr << "\t\tTimerManager benchmark FAILED" << std::endl;
+      return 1;
+    }
   }
 
   if (runAll || args[0].compare("thread-manager") == 0) {
@@ -189,6 +208,42 @@ int main(int argc, char** argv) {
     }
   }
 
+  if (runAll || args[0].compare("work-stealing-thread-manager") == 0) {
+
+    std::cout << "WorkStealingThreadManager tests..." << std::endl;
+
+    {
+      size_t workerCount = 10 * WEIGHT;
+      size_t taskCount = 500 * WEIGHT;
+      int64_t delay = 10LL;
+
+      ThreadManagerTests threadManagerTests(true);
+
+      std::cout << "\t\tWorkStealingThreadManager api test:" << std::endl;
+
+      if (!threadManagerTests.apiTest()) {
+        std::cerr << "\t\tWorkStealingThreadManager apiTest FAILED" << std::endl;
+        return 1;
+      }
+
+      std::cout << "\t\tWorkStealingThreadManager load test: worker count: " << workerCount
+                << " task count: " << taskCount << " delay: " << delay << std::endl;
+
+      if (!threadManagerTests.loadTest(taskCount, delay, workerCount)) {
+        std::cerr << "\t\tWorkStealingThreadManager loadTest FAILED" << std::endl;
+        return 1;
+      }
+
+      std::cout << "\t\tWorkStealingThreadManager block test: worker count: " << workerCount
+                << " delay: " << delay << std::endl;
+
+      if (!threadManagerTests.blockTest(delay, workerCount)) {
+        std::cerr << "\t\tWorkStealingThreadManager blockTest FAILED" << std::endl;
+        return 1;
+      }
+    }
+  }
+
   if (runAll || args[0].compare("thread-manager-benchmark") == 0) {
 
     std::cout << "ThreadManager benchmark tests..." << std::endl;
@@ -221,6 +276,27 @@ int main(int argc, char** argv) {
     }
   }
 
+  if (runAll || args[0].compare("thread-manager-contention") == 0) {
+
+    std::cout << "ThreadManager contention tests..." << std::endl;
+
+    {
+      size_t workerCount = 8;
+      size_t taskCount = 10000 * WEIGHT;
+
+      for (size_t producerCount = 1; producerCount <= 64; producerCount *= 2) {
+        for (int workStealing = 0; workStealing < 2; workStealing++) {
+          ThreadManagerTests threadManagerTests(workStealing != 0);
+
+          if (!threadManagerTests.contentionTest(taskCount, producerCount, workerCount)) {
+            std::cerr << "\t\tThreadManager contentionTest FAILED" << std::endl;
+            return 1;
+          }
+        }
+      }
+    }
+  }
+
   std::cout << "ALL TESTS PASSED" << std::endl;
   return 0;
 }
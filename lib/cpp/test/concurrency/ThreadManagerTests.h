@@ -23,11 +23,14 @@
 #include <thrift/concurrency/Monitor.h>
 #include <thrift/concurrency/Util.h>
 
+#include <boost/atomic.hpp>
+
 #include <assert.h>
 #include <deque>
 #include <set>
 #include <iostream>
 #include <stdint.h>
+#include <vector>
 
 namespace apache {
 namespace thrift {
@@ -58,6 +61,18 @@ static void sleep_(int64_t millisec) {
 class ThreadManagerTests {
 
 public:
+  ThreadManagerTests(bool workStealing = false) : _workStealing(workStealing) {}
+
+  /**
+   * Creates the thread manager under test: the simple one or the
+   * work-stealing one.
+   */
+  shared_ptr<ThreadManager> newThreadManager(size_t workerCount, size_t pendingTaskCountMax = 0) {
+    return _workStealing
+               ? ThreadManager::newWorkStealingThreadManager(workerCount, pendingTaskCountMax)
+               : ThreadManager::newSimpleThreadManager(workerCount, pendingTaskCountMax);
+  }
+
   class Task : public Runnable {
 
   public:
@@ -106,7 +121,7 @@ public:
 
     size_t activeCount = count;
 
-    shared_ptr<ThreadManager> threadManager = ThreadManager::newSimpleThreadManager(workerCount);
+    shared_ptr<ThreadManager> threadManager = newThreadManager(workerCount);
 
     shared_ptr<PlatformThreadFactory> threadFactory
         = shared_ptr<PlatformThreadFactory>(new PlatformThreadFactory(false));
@@ -255,7 +270,7 @@ public:
       size_t activeCounts[] = {workerCount, pendingTaskMaxCount, 1};
 
       shared_ptr<ThreadManager> threadManager
-          = ThreadManager::newSimpleThreadManager(workerCount, pendingTaskMaxCount);
+          = newThreadManager(workerCount, pendingTaskMaxCount);
 
       shared_ptr<PlatformThreadFactory> threadFactory
           = shared_ptr<PlatformThreadFactory>(new PlatformThreadFactory());
@@ -423,7 +438,7 @@ public:
 
   bool apiTestWithThreadFactory(shared_ptr<PlatformThreadFactory> threadFactory)
   {
-    shared_ptr<ThreadManager> threadManager = ThreadManager::newSimpleThreadManager(1);
+    shared_ptr<ThreadManager> threadManager = newThreadManager(1);
     threadManager->threadFactory(threadFactory);
 
 #if !USE_BOOST_THREAD && !USE_STD_THREAD
@@ -675,6 +690,94 @@ public:
     threadManager.reset();
     return true;
   }
+
+  class CountTask : public Runnable {
+
+  public:
+    CountTask(Monitor& monitor, boost::atomic<size_t>& count) : _monitor(monitor), _count(count) {}
+
+    void run() {
+      if (_count.fetch_sub(1) == 1) {
+        Synchronized s(_monitor);
+        _monitor.notify();
+      }
+    }
+
+    Monitor& _monitor;
+    boost::atomic<size_t>& _count;
+  };
+
+  class Producer : public Runnable {
+
+  public:
+    Producer(shared_ptr<ThreadManager> threadManager, shared_ptr<Runnable> task, size_t count)
+      : _threadManager(threadManager), _task(task), _count(count) {}
+
+    void run() {
+      for (size_t ix = 0; ix < _count; ix++) {
+        _threadManager->add(_task);
+      }
+    }
+
+    shared_ptr<ThreadManager> _threadManager;
+    shared_ptr<Runnable> _task;
+    size_t _count;
+  };
+
+  /**
+   * Contention test.  producerCount threads add count trivial tasks between
+   * them as fast as they can; measures how long it takes until workerCount
+   * workers have run them all.
+   */
+  bool contentionTest(size_t count, size_t producerCount, size_t workerCount) {
+
+    Monitor monitor;
+    boost::atomic<size_t> activeCount(count);
+    size_t perProducer = count / producerCount;
+
+    shared_ptr<ThreadManager> threadManager = newThreadManager(workerCount);
+    threadManager->threadFactory(shared_ptr<PlatformThreadFactory>(new PlatformThreadFactory(false)));
+    threadManager->start();
+
+    shared_ptr<Runnable> task(new CountTask(monitor, activeCount));
+    PlatformThreadFactory producerFactory(false);
+    std::vector<shared_ptr<Thread> > producers;
+    for (size_t ix = 0; ix < producerCount; ix++) {
+      size_t tasks = ix + 1 < producerCount ? perProducer : count - perProducer * ix;
+      producers.push_back(producerFactory.newThread(
+          shared_ptr<Runnable>(new Producer(threadManager, task, tasks))));
+    }
+
+    int64_t time00 = Util::currentTime();
+
+    for (size_t ix = 0; ix < producerCount; ix++) {
+      producers[ix]->start();
+    }
+    for (size_t ix = 0; ix < producerCount; ix++) {
+      producers[ix]->join();
+    }
+
+    {
+      Synchronized s(monitor);
+      while (activeCount.load() > 0) {
+        monitor.wait();
+      }
+    }
+
+    int64_t time01 = Util::currentTime();
+    int64_t elapsed = time01 - time00 > 0 ? time01 - time00 : 1;
+
+    std::cout << "\t\t\t" << (_workStealing ? "work-stealing" : "simple       ")
+              << " producers: " << producerCount << " workers: " << workerCount
+              << " tasks: " << count << " elapsed: " << elapsed << "ms ("
+              << (count * 1000) / elapsed << " tasks/s)" << std::endl;
+
+    threadManager->stop();
+    return threadManager->totalTaskCount() == 0;
+  }
+
+private:
+  bool _workStealing;
 };
 
 }
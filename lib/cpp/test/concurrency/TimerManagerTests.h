@@ -24,6 +24,7 @@
 
 #include <assert.h>
 #include <iostream>
+#include <vector>
 
 namespace apache {
 namespace thrift {
@@ -260,6 +261,144 @@ public:
     return true;
   }
 
+  /**
+   * Task for the many-timer tests: counts firings and remembers whether any
+   * of them came before its timeout.
+   */
+  class CountTask : public Runnable {
+  public:
+    CountTask(Monitor& monitor, size_t& count, int64_t timeout)
+      : _timeout(timeout),
+        _startTime(Util::currentTime()),
+        _monitor(monitor),
+        _count(count),
+        _early(false),
+        _fired(false) {}
+
+    void run() {
+      _early = (Util::currentTime() - _startTime) < _timeout;
+      _fired = true;
+      Synchronized s(_monitor);
+      _count--;
+      if (_count == 0) {
+        _monitor.notifyAll();
+      }
+    }
+
+    int64_t _timeout;
+    int64_t _startTime;
+    Monitor& _monitor;
+    size_t& _count;
+    bool _early;
+    bool _fired;
+  };
+
+  /**
+   * This test spreads timers over several wheel levels, cancels every other
+   * one and checks that the rest fire, none of them early, and that none of
+   * the cancelled ones fire.
+   */
+  bool test05(size_t count = 2000, int64_t timeout = 2000LL) {
+    TimerManager timerManager;
+    timerManager.threadFactory(shared_ptr<PlatformThreadFactory>(new PlatformThreadFactory()));
+    timerManager.start();
+    assert(timerManager.state() == TimerManager::STARTED);
+
+    std::vector<shared_ptr<CountTask> > tasks;
+    std::vector<TimerManager::Timer> timers;
+    std::vector<bool> cancelled(count, false);
+    size_t remaining = count - count / 2;
+    {
+      Synchronized s(_monitor);
+      for (size_t ix = 0; ix < count; ix++) {
+        int64_t delay = static_cast<int64_t>((ix * 7919) % static_cast<size_t>(timeout));
+        tasks.push_back(shared_ptr<CountTask>(new CountTask(_monitor, remaining, delay)));
+        timers.push_back(timerManager.add(tasks.back(), delay));
+      }
+      for (size_t ix = 1; ix < count; ix += 2) {
+        try {
+          timerManager.remove(timers[ix]);
+          cancelled[ix] = true;
+        } catch (NoSuchTaskException&) {
+          // Already fired; the check below accounts for it.
+          remaining--;
+        } catch (UncancellableTaskException&) {
+          remaining--;
+        }
+      }
+
+      while (remaining > 0) {
+        try {
+          _monitor.wait(timeout * 2);
+        } catch (TimedOutException&) {
+          std::cerr << "\t\t\t" << remaining << " timers did not fire" << std::endl;
+          return false;
+        }
+      }
+    }
+
+    for (size_t ix = 0; ix < count; ix++) {
+      if (tasks[ix]->_early) {
+        std::cerr << "\t\t\ttimer " << ix << " fired early" << std::endl;
+        return false;
+      }
+    }
+
+    // Give cancelled timers a chance to misfire before checking them.
+    {
+      Synchronized s(_monitor);
+      try {
+        _monitor.wait(timeout / 4);
+      } catch (TimedOutException&) {
+      }
+    }
+    size_t misfired = 0;
+    for (size_t ix = 1; ix < count; ix += 2) {
+      if (cancelled[ix] && tasks[ix]->_fired) {
+        misfired++;
+      }
+    }
+    if (misfired > 0) {
+      std::cerr << "\t\t\t" << misfired << " cancelled timers fired" << std::endl;
+      return false;
+    }
+
+    return timerManager.taskCount() == 0;
+  }
+
+  /**
+   * Schedules and cancels count timers, the usual life of an RPC timeout,
+   * and reports the cost of each pair.
+   */
+  bool benchmark(size_t count) {
+    TimerManager timerManager;
+    timerManager.threadFactory(shared_ptr<PlatformThreadFactory>(new PlatformThreadFactory()));
+    timerManager.start();
+    assert(timerManager.state() == TimerManager::STARTED);
+
+    size_t remaining = 0;
+    shared_ptr<CountTask> task(new CountTask(_monitor, remaining, 0));
+
+    // A standing population of long timers, as a busy server would have.
+    std::vector<TimerManager::Timer> standing;
+    for (size_t ix = 0; ix < 1000; ix++) {
+      standing.push_back(timerManager.add(task, 60000LL + static_cast<int64_t>(ix) * 37));
+    }
+
+    int64_t start = Util::currentTimeUsec();
+    for (size_t ix = 0; ix < count; ix++) {
+      TimerManager::Timer timer
+          = timerManager.add(task, 5000LL + static_cast<int64_t>(ix % 10000));
+      timerManager.remove(timer);
+    }
+    int64_t elapsed = Util::currentTimeUsec() - start;
+
+    std::cout << "\t\t\t" << count << " add/remove pairs: "
+              << (elapsed * 1000.0) / static_cast<double>(count) << "ns per pair" << std::endl;
+
+    return !task->_fired && timerManager.taskCount() == standing.size();
+  }
+
   friend class TestTask;
 
   Monitor _monitor;